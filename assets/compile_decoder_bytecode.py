@@ -0,0 +1,137 @@
+"""
+Compiles the decoder filter tables in `src/Generated/DecoderTables.inc` to the compact bytecode
+representation in `src/Generated/DecoderBytecode.inc`, which is used when configuring with
+`-DZYDIS_COMPACT_DECODER_TABLES=ON`.
+
+Every reachable filter row is emitted once as:
+
+    <presence bitmap> [<rank bytes>] <child node>...
+
+The bitmap holds one bit per child index and only the present children are stored, 3 bytes each
+(node type followed by the little-endian node value). Filters with more than 8 children store one
+rank byte per bitmap byte, holding the number of present children in front of it. Filter node
+values are byte offsets into the bytecode and the root row is placed at offset 0. Identical rows
+are shared and unreachable rows are dropped.
+
+This is the second step of `generate_decoder_tables.py`, which runs it on the ordered tables.
+"""
+
+from typing import Dict, List, Tuple
+
+import re
+import sys
+
+from reorder_decoder_tables import FILTER_REGEXP, NODE_TYPES_PATH, ROOT, TABLE_REGEXP, \
+    parse_tables, split_nodes
+
+NODE_TYPE_REGEXP = re.compile(r'^\s*ZYDIS_NODETYPE_(\w+)\s*=\s*(0x[0-9A-Fa-f]+),?\s*$')
+DEFINITION_REGEXP = re.compile(r'ZYDIS_DEFINITION\((0x[0-9A-Fa-f]+), (0x[0-9A-Fa-f]+)\)')
+
+BYTES_PER_LINE = 16
+
+
+def parse_node_types() -> Dict[str, int]:
+    node_types = {}
+    for line in NODE_TYPES_PATH.read_text().splitlines():
+        match = NODE_TYPE_REGEXP.match(line)
+        if match:
+            node_types[match.group(1)] = int(match.group(2), 16)
+    return node_types
+
+
+def header_size(width: int) -> int:
+    return 1 if width <= 8 else 2 * ((width + 7) // 8)
+
+
+def compile_bytecode(lines: List[str]) -> Tuple[str, str]:
+    """
+    Compiles the filter tables in `lines` to the contents of `DecoderBytecode.inc`.
+
+    Returns the contents and a short summary.
+    """
+    tables = parse_tables(lines)
+    widths = {}
+    for line in lines:
+        match = TABLE_REGEXP.match(line)
+        if match:
+            widths[match.group(1)] = int(match.group(2))
+    node_types = parse_node_types()
+
+    rows = {name: [split_nodes(row) for row in table.rows] for name, table in tables.items()}
+
+    # Collect the reachable rows, starting with the root
+    reachable = {ROOT}
+    pending = [ROOT]
+    while pending:
+        name, row = pending.pop()
+        for node in rows[name][row]:
+            match = FILTER_REGEXP.fullmatch(node)
+            if match:
+                child = (match.group(1), int(match.group(2), 16))
+                if child not in reachable:
+                    reachable.add(child)
+                    pending.append(child)
+
+    # Assign offsets in table order, which keeps the hotness order of the rows within a filter
+    offsets: Dict[Tuple[str, int], int] = {}
+    shared: Dict[Tuple[int, Tuple[str, ...]], int] = {}
+    layout: List[Tuple[str, int]] = []
+    size = 0
+    order = [ROOT] + [(name, row) for name in tables for row in range(len(rows[name]))]
+    for key in order:
+        if key not in reachable or key in offsets:
+            continue
+        name, row = key
+        nodes = tuple(rows[name][row])
+        identity = (widths[name], nodes)
+        if identity in shared:
+            offsets[key] = shared[identity]
+            continue
+        offsets[key] = shared[identity] = size
+        layout.append(key)
+        size += header_size(widths[name]) + 3 * sum(1 for n in nodes if n != 'ZYDIS_INVALID')
+    if size > 0x10000:
+        sys.exit(f'Bytecode size {size:#x} exceeds the 16-bit node value range')
+
+    def encode_node(node: str) -> List[int]:
+        match = FILTER_REGEXP.fullmatch(node)
+        if match:
+            node_type = node_types['FILTER_' + match.group(1)]
+            value = offsets[(match.group(1), int(match.group(2), 16))]
+        else:
+            match = DEFINITION_REGEXP.fullmatch(node)
+            assert match, node
+            node_type = node_types['DEFINITION_MASK'] | int(match.group(1), 16)
+            value = int(match.group(2), 16)
+        return [node_type, value & 0xFF, value >> 8]
+
+    output = ['ZYDIS_TABLE_SECTION static const ZyanU16 FILTER_WIDTHS[] =', '{']
+    width_by_type = {value: widths.get(name[len('FILTER_'):], 0)
+                     for name, value in node_types.items() if name.startswith('FILTER_')}
+    output.append('    ' + ', '.join(str(width_by_type.get(i, 0))
+                                      for i in range(max(width_by_type) + 1)))
+    output += ['};', '', 'ZYDIS_TABLE_SECTION static const ZyanU8 DECODER_BYTECODE[] =', '{']
+    for name, row in layout:
+        width = widths[name]
+        nodes = rows[name][row]
+        present = [i for i, node in enumerate(nodes) if node != 'ZYDIS_INVALID']
+        bitmap = [0] * ((width + 7) // 8)
+        for i in present:
+            bitmap[i // 8] |= 1 << (i % 8)
+        data = list(bitmap)
+        if width > 8:
+            rank = 0
+            for byte in bitmap:
+                data.append(rank)
+                rank += bin(byte).count('1')
+        for i in present:
+            data += encode_node(nodes[i])
+        output.append(f'    /* 0x{offsets[(name, row)]:04X}: FILTERS_{name}[0x{row:X}] */')
+        for i in range(0, len(data), BYTES_PER_LINE):
+            chunk = data[i:i + BYTES_PER_LINE]
+            output.append('    ' + ' '.join(f'0x{byte:02X},' for byte in chunk))
+    output += ['};', '']
+
+    summary = (f'Compiled {len(layout)} of {sum(len(r) for r in rows.values())} rows to '
+               f'{size} bytes')
+    return '\n'.join(output), summary
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+
+"""
+Post-processes the decoder tables emitted by the table generator. Run this script whenever
+`src/Generated/DecoderTables.inc` is regenerated:
+
+1. The rows of the filter tables are ordered by the hotness profile in
+   `assets/decoder_table_profile.txt` (see `reorder_decoder_tables.py`).
+2. `src/Generated/DecoderBytecode.inc` is compiled from the ordered tables (see
+   `compile_decoder_bytecode.py`).
+
+Both steps are deterministic and don't change their own output, so running the pipeline again on
+the committed tables must not change anything. The `ZydisGeneratedTables` test checks this with
+`--check`.
+
+To refresh the profile, configure with `-DZYDIS_PROFILE_DECODER_TABLES=ON`, run `ZydisTableProfile`
+on a training corpus and pass the resulting file to `--import-profile`.
+"""
+
+from argparse import ArgumentParser
+from pathlib import Path
+
+import sys
+
+from compile_decoder_bytecode import compile_bytecode
+from reorder_decoder_tables import TABLES_PATH, ZYDIS_ROOT, convert_tool_profile, read_profile, \
+    reorder_tables, write_profile
+
+BYTECODE_PATH = TABLES_PATH.parent / 'DecoderBytecode.inc'
+PROFILE_PATH = ZYDIS_ROOT / 'assets' / 'decoder_table_profile.txt'
+
+
+def main():
+    parser = ArgumentParser(description='Orders the decoder tables and compiles the bytecode.')
+    parser.add_argument('--tables', type=Path, default=TABLES_PATH,
+                        help='path of DecoderTables.inc (default: %(default)s)')
+    parser.add_argument('--bytecode', type=Path, default=BYTECODE_PATH,
+                        help='path of DecoderBytecode.inc (default: %(default)s)')
+    parser.add_argument('--profile', type=Path, default=PROFILE_PATH,
+                        help='path of the hotness profile (default: %(default)s)')
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument('--import-profile', type=Path, metavar='FILE',
+                       help='replace the hotness profile by a profile written by '
+                            'ZydisTableProfile, which was built with the current tables')
+    group.add_argument('--check', action='store_true',
+                       help='only check that the generated files are up to date')
+    args = parser.parse_args()
+
+    text = args.tables.read_text()
+    lines = text.split('\n')
+
+    if args.import_profile:
+        write_profile(args.profile, convert_tool_profile(args.import_profile, lines))
+
+    hot, reachable = reorder_tables(lines, read_profile(args.profile))
+    tables = '\n'.join(lines)
+    bytecode, summary = compile_bytecode(lines)
+
+    if args.check:
+        stale = []
+        if text != tables:
+            stale.append(args.tables)
+        if args.bytecode.read_text() != bytecode:
+            stale.append(args.bytecode)
+        if stale:
+            sys.exit('Generated files are out of date, run `generate_decoder_tables.py`: ' +
+                     ', '.join(str(path) for path in stale))
+        print('Generated files are up to date')
+        return
+
+    args.tables.write_text(tables)
+    args.bytecode.write_text(bytecode)
+    print(f'Ordered {hot} hot rows, {reachable} reachable rows verified')
+    print(summary)
+
+
+if __name__ == '__main__':
+    main()
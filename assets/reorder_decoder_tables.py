@@ -0,0 +1,236 @@
+"""
+Orders the rows of the decoder filter tables in `src/Generated/DecoderTables.inc` by hotness. This
+is the first step of `generate_decoder_tables.py`.
+
+Rows are sorted by descending visit count, so the rows touched by a typical workload end up packed
+at the beginning of each table. Rows with equal counts keep their relative order and all filter
+references are remapped, which leaves the decoder tree itself unchanged. This is verified by
+walking the old and the new tree in parallel.
+
+The visit counts are written by the `ZydisTableProfile` tool, which is built when configuring with
+`-DZYDIS_PROFILE_DECODER_TABLES=ON`, and refer to the row indices of the tables the tool was built
+with. Before they are stored, the rows are renumbered in depth-first order of the decoder tree.
+These numbers don't depend on the order of the rows, so the same profile applies to the output of
+the table generator as well as to already ordered tables.
+"""
+
+from pathlib import Path
+from typing import Dict, List, Tuple
+
+import re
+import sys
+
+ZYDIS_ROOT = Path(__file__).resolve().parent.parent
+TABLES_PATH = ZYDIS_ROOT / 'src' / 'Generated' / 'DecoderTables.inc'
+NODE_TYPES_PATH = ZYDIS_ROOT / 'include' / 'Zydis' / 'Internal' / 'DecoderData.h'
+
+TABLE_REGEXP = re.compile(
+    r'^const ZydisDecoderTreeNode FILTERS_(\w+)\[\]\[(\d+)\] =$')
+ROW_REGEXP = re.compile(r'^    \{ (.*) \}(,?)(\s*)$')
+FILTER_REGEXP = re.compile(r'ZYDIS_FILTER\(ZYDIS_NODETYPE_FILTER_(\w+), (0x[0-9A-Fa-f]+)\)')
+NODE_TYPE_REGEXP = re.compile(r'^\s*ZYDIS_NODETYPE_FILTER_(\w+)\s*=\s*(0x[0-9A-Fa-f]+),?\s*$')
+
+# The decoder starts every walk at this row (see `zydis_decoder_tree_root`)
+ROOT = ('OPCODE', 0)
+
+
+class Table:
+    def __init__(self, name: str):
+        self.name = name
+        self.rows: List[str] = []
+        self.line_indices: List[int] = []
+
+
+def parse_tables(lines: List[str]) -> Dict[str, Table]:
+    tables = {}
+    table = None
+    for i, line in enumerate(lines):
+        match = TABLE_REGEXP.match(line)
+        if match:
+            table = Table(match.group(1))
+            tables[table.name] = table
+            continue
+        if table is None:
+            continue
+        if line.startswith('};'):
+            table = None
+            continue
+        match = ROW_REGEXP.match(line)
+        if match:
+            table.rows.append(match.group(1))
+            table.line_indices.append(i)
+    return tables
+
+
+def parse_node_types() -> Dict[int, str]:
+    node_types = {}
+    for line in NODE_TYPES_PATH.read_text().splitlines():
+        match = NODE_TYPE_REGEXP.match(line)
+        if match:
+            node_types[int(match.group(2), 16)] = match.group(1)
+    return node_types
+
+
+def parse_tool_profile(path: Path, tables: Dict[str, Table]) -> Dict[Tuple[str, int], int]:
+    """
+    Reads a profile written by `ZydisTableProfile`, which was built with the given tables.
+    """
+    node_types = parse_node_types()
+    visits = {}
+    for line in path.read_text().splitlines():
+        if not line.strip() or line.startswith('#'):
+            continue
+        node_type, row, count = line.split()
+        key = (node_types[int(node_type, 16)], int(row, 16))
+        if key[0] not in tables or key[1] >= len(tables[key[0]].rows):
+            sys.exit(f'Profile does not match the tables: FILTERS_{key[0]}[{key[1]:#x}]')
+        visits[key] = int(count)
+    return visits
+
+
+def read_profile(path: Path) -> Dict[Tuple[str, int], int]:
+    """
+    Reads a profile with depth-first row numbers, as written by `write_profile`.
+    """
+    visits = {}
+    for line in path.read_text().splitlines():
+        if not line.strip() or line.startswith('#'):
+            continue
+        name, number, count = line.split()
+        visits[(name, int(number, 16))] = int(count)
+    return visits
+
+
+def write_profile(path: Path, visits: Dict[Tuple[str, int], int]):
+    lines = [
+        '# Zydis decoder table profile: <filter> <depth-first row number> <visits>',
+        '# Generated by `generate_decoder_tables.py --import-profile`, see '
+        '`reorder_decoder_tables.py`',
+    ]
+    for (name, number), count in sorted(visits.items()):
+        lines.append(f'{name} 0x{number:04X} {count}')
+    path.write_text('\n'.join(lines) + '\n')
+
+
+def split_nodes(row: str) -> List[str]:
+    nodes = []
+    depth = 0
+    start = 0
+    for i, c in enumerate(row):
+        if c == '(':
+            depth += 1
+        elif c == ')':
+            depth -= 1
+        elif c == ',' and depth == 0:
+            nodes.append(row[start:i].strip())
+            start = i + 1
+    nodes.append(row[start:].strip())
+    return nodes
+
+
+def verify(old: Dict[str, List[str]], new: Dict[str, List[str]],
+           mapping: Dict[str, List[int]]):
+    visited = set()
+    pending = [ROOT]
+    while pending:
+        name, row = pending.pop()
+        if (name, row) in visited:
+            continue
+        visited.add((name, row))
+        old_nodes = split_nodes(old[name][row])
+        new_nodes = split_nodes(new[name][mapping[name][row]])
+        assert len(old_nodes) == len(new_nodes)
+        for old_node, new_node in zip(old_nodes, new_nodes):
+            old_match = FILTER_REGEXP.fullmatch(old_node)
+            if not old_match:
+                assert old_node == new_node, (old_node, new_node)
+                continue
+            child_name, child_row = old_match.group(1), int(old_match.group(2), 16)
+            new_match = FILTER_REGEXP.fullmatch(new_node)
+            assert new_match and new_match.group(1) == child_name
+            assert int(new_match.group(2), 16) == mapping[child_name][child_row]
+            pending.append((child_name, child_row))
+    return len(visited)
+
+
+def child_rows(table: Table, row: int) -> List[Tuple[str, int]]:
+    children = []
+    for node in split_nodes(table.rows[row]):
+        match = FILTER_REGEXP.fullmatch(node)
+        if match:
+            children.append((match.group(1), int(match.group(2), 16)))
+    return children
+
+
+def number_rows(tables: Dict[str, Table]) -> Dict[Tuple[str, int], Tuple[str, int]]:
+    """
+    Numbers the reachable rows of every table in the order of a depth-first walk that visits the
+    children of a row by ascending index. Returns `numbers[(name, row)] = (name, number)`.
+    """
+    numbers = {}
+    counts: Dict[str, int] = {}
+    pending = [ROOT]
+    while pending:
+        key = pending.pop()
+        if key in numbers:
+            continue
+        name = key[0]
+        numbers[key] = (name, counts.get(name, 0))
+        counts[name] = numbers[key][1] + 1
+        pending.extend(reversed(child_rows(tables[name], key[1])))
+    return numbers
+
+
+def convert_tool_profile(path: Path, lines: List[str]) -> Dict[Tuple[str, int], int]:
+    """
+    Converts a profile written by `ZydisTableProfile`, which was built with the given tables, to
+    depth-first row numbers.
+    """
+    tables = parse_tables(lines)
+    numbers = number_rows(tables)
+    visits = {}
+    for key, count in parse_tool_profile(path, tables).items():
+        if key not in numbers:
+            sys.exit(f'Profile contains an unreachable row: FILTERS_{key[0]}[{key[1]:#x}]')
+        visits[numbers[key]] = count
+    return visits
+
+
+def reorder_tables(lines: List[str], profile: Dict[Tuple[str, int], int]) -> Tuple[int, int]:
+    """
+    Orders the filter table rows in `lines` by the visit counts in `profile`, in place.
+
+    Returns the number of hot rows and the number of reachable rows that were verified.
+    """
+    tables = parse_tables(lines)
+    numbers = number_rows(tables)
+    visits = {key: profile.get(number, 0) for key, number in numbers.items()}
+
+    # `mapping[name][old row] = new row`
+    mapping = {}
+    for name, table in tables.items():
+        order = sorted(range(len(table.rows)),
+                       key=lambda row: (((name, row) != ROOT), -visits.get((name, row), 0), row))
+        mapping[name] = [0] * len(order)
+        for new_row, old_row in enumerate(order):
+            mapping[name][old_row] = new_row
+
+    def remap(match: re.Match) -> str:
+        name = match.group(1)
+        row = mapping[name][int(match.group(2), 16)]
+        return f'ZYDIS_FILTER(ZYDIS_NODETYPE_FILTER_{name}, 0x{row:X})'
+
+    old_rows = {name: table.rows for name, table in tables.items()}
+    new_rows = {}
+    for name, table in tables.items():
+        rows = [''] * len(table.rows)
+        for old_row, row in enumerate(table.rows):
+            rows[mapping[name][old_row]] = FILTER_REGEXP.sub(remap, row)
+        new_rows[name] = rows
+        for row, line_index in zip(rows, table.line_indices):
+            match = ROW_REGEXP.match(lines[line_index])
+            lines[line_index] = f'    {{ {row} }}{match.group(2)}{match.group(3)}'
+
+    reachable = verify(old_rows, new_rows, mapping)
+    hot = sum(1 for count in visits.values() if count)
+    return hot, reachable
@@ -0,0 +1,429 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+#if defined(ZYAN_WINDOWS)
+#   include <windows.h>
+#elif defined(ZYAN_APPLE)
+#   include <mach/mach_time.h>
+#elif defined(ZYAN_LINUX) || defined(ZYAN_SOLARIS)
+#   include <sys/time.h>
+#   include <pthread.h>
+#elif defined(ZYAN_FREEBSD)
+#   include <sys/time.h>
+#   include <pthread.h>
+#   include <pthread_np.h>
+#else
+#   error "Unsupported platform detected"
+#endif
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_DEFAULT       ZYAN_VT100SGR_FG_DEFAULT
+#define COLOR_ERROR         ZYAN_VT100SGR_FG_BRIGHT_RED
+#define COLOR_VALUE_R       ZYAN_VT100SGR_FG_BRIGHT_RED
+#define COLOR_VALUE_G       ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_VALUE_B       ZYAN_VT100SGR_FG_CYAN
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Global variables                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+static ZyanBool g_vt100_stdout;
+static ZyanBool g_vt100_stderr;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Helper macros                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Conditionally expands to the passed VT100 sequence, if `g_colors_stdout` is
+ * `ZYAN_TRUE`, or an empty string, if not.
+ *
+ * @param   The VT100 SGT sequence.
+ */
+#define CVT100_OUT(sequence) (g_vt100_stdout ? (sequence) : "")
+
+/**
+ * Conditionally expands to the passed VT100 sequence, if `g_colors_stderr` is
+ * `ZYAN_TRUE`, or an empty string, if not.
+ *
+ * @param   The VT100 SGT sequence.
+ */
+#define CVT100_ERR(sequence) (g_vt100_stderr ? (sequence) : "")
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Time measurement                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+#if defined(ZYAN_WINDOWS)
+
+double  counter_freq  = 0.0;
+ZyanU64 counter_start = 0;
+
+static void StartCounter(void)
+{
+    LARGE_INTEGER li;
+    if (!QueryPerformanceFrequency(&li))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sError: QueryPerformanceFrequency failed!%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
+    counter_freq = (double)li.QuadPart / 1000.0;
+    QueryPerformanceCounter(&li);
+    counter_start = li.QuadPart;
+}
+
+static double GetCounter(void)
+{
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    return (double)(li.QuadPart - counter_start) / counter_freq;
+}
+
+#elif defined(ZYAN_APPLE)
+
+ZyanU64 counter_start = 0;
+mach_timebase_info_data_t timebase_info;
+
+static void StartCounter(void)
+{
+    counter_start = mach_absolute_time();
+}
+
+static double GetCounter(void)
+{
+    ZyanU64 elapsed = mach_absolute_time() - counter_start;
+
+    if (timebase_info.denom == 0)
+    {
+        mach_timebase_info(&timebase_info);
+    }
+
+    return (double)elapsed * timebase_info.numer / timebase_info.denom / 1000000;
+}
+
+#elif defined(ZYAN_LINUX) || defined(ZYAN_FREEBSD) || defined(ZYAN_SOLARIS)
+
+struct timeval t1;
+
+static void StartCounter(void)
+{
+    gettimeofday(&t1, NULL);
+}
+
+static double GetCounter(void)
+{
+    struct timeval t2;
+    gettimeofday(&t2, NULL);
+
+    double t = (t2.tv_sec - t1.tv_sec) * 1000.0;
+    return t + (t2.tv_usec - t1.tv_usec) / 1000.0;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Process & Thread Priority                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+static void AdjustProcessAndThreadPriority(void)
+{
+#if defined(ZYAN_WINDOWS)
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    if (info.dwNumberOfProcessors > 1)
+    {
+        if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sWarning: Could not set thread affinity mask%s\n",
+                CVT100_ERR(ZYAN_VT100SGR_FG_YELLOW), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        }
+        if (!SetPriorityClass(GetCurrentProcess(), REALTIME_PRIORITY_CLASS))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sWarning: Could not set process priority class%s\n",
+                CVT100_ERR(ZYAN_VT100SGR_FG_YELLOW), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        }
+        if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sWarning: Could not set thread priority class%s\n",
+                CVT100_ERR(ZYAN_VT100SGR_FG_YELLOW), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        }
+    }
+
+#elif defined(ZYAN_LINUX) || defined(ZYAN_FREEBSD)
+
+    pthread_t thread = pthread_self();
+
+#if defined(ZYAN_LINUX)
+    cpu_set_t cpus;
+#else  // FreeBSD
+    cpuset_t cpus;
+#endif
+
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    if (pthread_setaffinity_np(thread, sizeof(cpus), &cpus))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sWarning: Could not set thread affinity mask%s\n",
+            CVT100_ERR(ZYAN_VT100SGR_FG_YELLOW), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Configuration                                                                                  */
+/* ============================================================================================== */
+
+/**
+ * The number of instructions generated per encoding.
+ */
+#define INSTRUCTION_COUNT 10000
+
+/**
+ * The number of times the whole instruction stream is encoded.
+ */
+#define ITERATION_COUNT 100
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+typedef struct TestData_
+{
+    ZydisEncoderRequest requests[INSTRUCTION_COUNT];
+    ZyanU8 code[INSTRUCTION_COUNT * ZYDIS_MAX_INSTRUCTION_LENGTH];
+} TestData;
+
+/**
+ * Encodes all requests back to back into a single code buffer, the same way a JIT appends
+ * instructions to its code cache.
+ */
+static ZyanUSize EncodeStream(const ZydisEncoderRequest* requests, ZyanUSize count,
+    ZyanU8* code, ZyanUSize size)
+{
+    ZyanUSize offset = 0;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZyanUSize length = size - offset;
+        if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(&requests[i], code + offset, &length)))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sUnexpected encoding error%s\n",
+                CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+            ZYAN_ASSERT(ZYAN_FALSE);
+            exit(EXIT_FAILURE);
+        }
+        offset += length;
+    }
+
+    return offset;
+}
+
+static ZyanBool GenerateTestData(TestData* data, ZydisInstructionEncoding encoding)
+{
+    ZydisDecoder decoder;
+    if (!ZYAN_SUCCESS(
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64)))
+    {
+        return ZYAN_FALSE;
+    }
+
+    ZyanU32 count = 0;
+    ZyanU32 attempts = 0;
+    while (count < INSTRUCTION_COUNT)
+    {
+        if (++attempts > INSTRUCTION_COUNT * 1000)
+        {
+            return ZYAN_FALSE;
+        }
+
+        ZyanU8 bytes[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        for (int i = 0; i < ZYDIS_MAX_INSTRUCTION_LENGTH; ++i)
+        {
+            bytes[i] = rand() % 256;
+        }
+        switch (encoding)
+        {
+        case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+            break;
+        case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+            bytes[0] = 0x0F;
+            bytes[1] = 0x0F;
+            break;
+        case ZYDIS_INSTRUCTION_ENCODING_XOP:
+            bytes[0] = 0x8F;
+            bytes[1] = (bytes[1] & 0xE0) | (0x08 + rand() % 3);
+            break;
+        case ZYDIS_INSTRUCTION_ENCODING_VEX:
+            bytes[0] = (rand() % 2) ? 0xC4 : 0xC5;
+            break;
+        case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+            bytes[0] = 0x62;
+            break;
+        default:
+            ZYAN_UNREACHABLE;
+        }
+
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, bytes, sizeof(bytes), &instruction,
+            operands)) || (instruction.encoding != encoding))
+        {
+            continue;
+        }
+
+        ZydisEncoderRequest* request = &data->requests[count];
+        ZyanUSize length = ZYDIS_MAX_INSTRUCTION_LENGTH;
+        if (!ZYAN_SUCCESS(ZydisEncoderDecodedInstructionToEncoderRequest(&instruction, operands,
+                instruction.operand_count_visible, request)) ||
+            !ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(request, data->code, &length)))
+        {
+            continue;
+        }
+
+        ++count;
+    }
+
+    return ZYAN_TRUE;
+}
+
+static void TestPerformance(TestData* data, const char* name)
+{
+    // Cache warmup
+    const ZyanUSize size = EncodeStream(data->requests, INSTRUCTION_COUNT, data->code,
+        sizeof(data->code));
+
+    // Testing
+    ZyanU64 count = 0;
+    StartCounter();
+    for (ZyanU8 j = 0; j < ITERATION_COUNT; ++j)
+    {
+        EncodeStream(data->requests, INSTRUCTION_COUNT, data->code, sizeof(data->code));
+        count += INSTRUCTION_COUNT;
+    }
+    const double time = GetCounter();
+
+    ZYAN_PRINTF("%s%-6s%s Instructions: %s%6.2fM%s, Bytes/Instruction: %s%5.2f%s, "
+        "Time: %s%8.2f%s msec, Per instruction: %s%7.2f%s nsec\n",
+        CVT100_OUT(ZYAN_VT100SGR_FG_BRIGHT_MAGENTA), name, CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_B), (double)count / 1000000, CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_B), (double)size / INSTRUCTION_COUNT, CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_G), time, CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_G), time * 1000000 / (double)count, CVT100_OUT(COLOR_DEFAULT));
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(int argc, char** argv)
+{
+    // Enable VT100 escape sequences on Windows, if the output is not redirected
+    g_vt100_stdout = (ZyanTerminalIsTTY(ZYAN_STDSTREAM_OUT) == ZYAN_STATUS_TRUE) &&
+                     ZYAN_SUCCESS(ZyanTerminalEnableVT100(ZYAN_STDSTREAM_OUT));
+    g_vt100_stderr = (ZyanTerminalIsTTY(ZYAN_STDSTREAM_ERR) == ZYAN_STATUS_TRUE) &&
+                     ZYAN_SUCCESS(ZyanTerminalEnableVT100(ZYAN_STDSTREAM_ERR));
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    // A fixed seed keeps the instruction mix identical between runs, so results of different
+    // builds can be compared directly
+    unsigned seed = 0;
+    if (argc > 1)
+    {
+        seed = (unsigned)strtoul(argv[1], ZYAN_NULL, 10);
+    }
+    srand(seed);
+
+    static const struct
+    {
+        const char* name;
+        ZydisInstructionEncoding encoding;
+    } tests[5] =
+    {
+        { "DEFAULT", ZYDIS_INSTRUCTION_ENCODING_LEGACY },
+        { "3DNOW"  , ZYDIS_INSTRUCTION_ENCODING_3DNOW  },
+        { "XOP"    , ZYDIS_INSTRUCTION_ENCODING_XOP    },
+        { "VEX"    , ZYDIS_INSTRUCTION_ENCODING_VEX    },
+        { "EVEX"   , ZYDIS_INSTRUCTION_ENCODING_EVEX   }
+    };
+
+    TestData* data = malloc(sizeof(TestData));
+    if (!data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to allocate %" PRIu64 " bytes on the heap%s\n",
+            CVT100_ERR(COLOR_ERROR), (ZyanU64)sizeof(TestData), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    AdjustProcessAndThreadPriority();
+
+    for (ZyanU8 i = 0; i < ZYAN_ARRAY_LENGTH(tests); ++i)
+    {
+        if (!GenerateTestData(data, tests[i].encoding))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to generate %s test data%s\n",
+                CVT100_ERR(COLOR_ERROR), tests[i].name, CVT100_ERR(ZYAN_VT100SGR_RESET));
+            continue;
+        }
+        TestPerformance(data, tests[i].name);
+    }
+
+    free(data);
+
+    return 0;
+}
+
+/* ============================================================================================== */
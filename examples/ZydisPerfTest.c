@@ -229,9 +229,11 @@ typedef struct TestContext_
     ZydisDecodedInstruction instruction;
     ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
     char format_buffer[256];
+    const ZydisDecoderCache* cache;
     ZyanBool minimal_mode;
     ZyanBool format;
     ZyanBool tokenize;
+    ZyanBool fused;
 } TestContext;
 
 static ZyanU64 ProcessBuffer(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
@@ -243,8 +245,26 @@ static ZyanU64 ProcessBuffer(const ZydisDecoder* decoder, const ZydisFormatter*
 
     while (length > offset)
     {
-        status = ZydisDecoderDecodeInstruction(decoder, &context->context, buffer + offset,
-            length - offset, &context->instruction);
+        if (context->fused)
+        {
+            status = ZydisDisassembleFormat(decoder, formatter, offset, buffer + offset,
+                length - offset, &context->instruction, context->format_buffer,
+                sizeof(context->format_buffer), ZYAN_NULL);
+            if (status == ZYDIS_STATUS_NO_MORE_DATA)
+            {
+                break;
+            }
+            ZYAN_ASSERT(ZYAN_SUCCESS(status));
+            offset += context->instruction.length;
+            ++count;
+            continue;
+        }
+
+        status = context->cache ?
+            ZydisDecoderDecodeInstructionCached(context->cache, &context->context,
+                buffer + offset, length - offset, &context->instruction) :
+            ZydisDecoderDecodeInstruction(decoder, &context->context, buffer + offset,
+                length - offset, &context->instruction);
 
         if (status == ZYDIS_STATUS_NO_MORE_DATA)
         {
@@ -294,7 +314,8 @@ static ZyanU64 ProcessBuffer(const ZydisDecoder* decoder, const ZydisFormatter*
 }
 
 static void TestPerformance(const ZyanU8* buffer, ZyanUSize length, ZyanBool minimal_mode,
-    ZyanBool format, ZyanBool tokenize, ZyanBool use_cache)
+    ZyanBool trusted_input, ZyanBool format, ZyanBool tokenize, ZyanBool use_cache,
+    ZyanBool fused)
 {
     ZydisDecoder decoder;
     if (!ZYAN_SUCCESS(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
@@ -304,20 +325,27 @@ static void TestPerformance(const ZyanU8* buffer, ZyanUSize length, ZyanBool min
             CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
         exit(EXIT_FAILURE);
     }
-    if (!ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, minimal_mode)))
+    if (!ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL,
+            minimal_mode)) ||
+        !ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_TRUSTED_INPUT,
+            trusted_input)))
     {
         ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to adjust decoder-mode%s\n",
             CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
         exit(EXIT_FAILURE);
     }
 
-    // ZydisCacheTable cache;
-    // if (use_cache && !ZYAN_SUCCESS(ZydisDecoderInitCache(&decoder, &cache)))
-    // {
-    //     ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder-cache%s\n",
-    //         CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
-    //     exit(EXIT_FAILURE);
-    // }
+    ZyanUSize cache_size;
+    void* cache_memory = ZYAN_NULL;
+    ZydisDecoderCache* cache = ZYAN_NULL;
+    if (use_cache && (!ZYAN_SUCCESS(ZydisDecoderGetCacheSize(&cache_size)) ||
+        !(cache_memory = malloc(cache_size)) ||
+        !ZYAN_SUCCESS(ZydisDecoderInitCache(&decoder, cache_memory, cache_size, &cache))))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder-cache%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
 
     ZydisFormatter formatter;
     if (format)
@@ -335,9 +363,11 @@ static void TestPerformance(const ZyanU8* buffer, ZyanUSize length, ZyanBool min
     }
 
     TestContext context;
+    context.cache = cache;
     context.minimal_mode = minimal_mode;
     context.format = format;
     context.tokenize = tokenize;
+    context.fused = fused;
 
     // Cache warmup
     ProcessBuffer(&decoder, &formatter, &context, buffer, length);
@@ -349,19 +379,229 @@ static void TestPerformance(const ZyanU8* buffer, ZyanUSize length, ZyanBool min
     {
         count += ProcessBuffer(&decoder, &formatter, &context, buffer, length);
     }
-    const char* color[4];
-    color[0] = minimal_mode ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
-    color[1] = format       ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
-    color[2] = tokenize     ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
-    color[3] = use_cache    ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
-    ZYAN_PRINTF("Minimal-Mode %s%d%s, Format %s%d%s, Tokenize %s%d%s, Caching %s%d%s, " \
-        "Instructions: %s%6.2fM%s, Time: %s%8.2f%s msec\n",
+    const char* color[6];
+    color[0] = minimal_mode  ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    color[1] = trusted_input ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    color[2] = format        ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    color[3] = tokenize      ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    color[4] = use_cache     ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    color[5] = fused         ? CVT100_OUT(COLOR_VALUE_G) : CVT100_OUT(COLOR_VALUE_B);
+    ZYAN_PRINTF("Minimal-Mode %s%d%s, Trusted %s%d%s, Format %s%d%s, Tokenize %s%d%s, " \
+        "Caching %s%d%s, Fused %s%d%s, Instructions: %s%6.2fM%s, Time: %s%8.2f%s msec\n",
         color[0], minimal_mode, CVT100_OUT(COLOR_DEFAULT),
-        color[1], format, CVT100_OUT(COLOR_DEFAULT),
-        color[2], tokenize, CVT100_OUT(COLOR_DEFAULT),
-        color[3], use_cache, CVT100_OUT(COLOR_DEFAULT),
+        color[1], trusted_input, CVT100_OUT(COLOR_DEFAULT),
+        color[2], format, CVT100_OUT(COLOR_DEFAULT),
+        color[3], tokenize, CVT100_OUT(COLOR_DEFAULT),
+        color[4], use_cache, CVT100_OUT(COLOR_DEFAULT),
+        color[5], fused, CVT100_OUT(COLOR_DEFAULT),
         CVT100_OUT(COLOR_VALUE_B), (double)count / 1000000, CVT100_OUT(COLOR_DEFAULT),
         CVT100_OUT(COLOR_VALUE_G), GetCounter(), CVT100_OUT(COLOR_DEFAULT));
+
+    free(cache_memory);
+}
+
+/**
+ * The minimum number of code bytes processed per corpus and stage. Small corpora are processed
+ * repeatedly until this amount is reached.
+ */
+#define CORPUS_MIN_BYTES (4 * 1024 * 1024)
+
+static void PrintCorpusResult(const char* stage, ZyanU64 count, ZyanU64 bytes, double time)
+{
+    ZYAN_PRINTF("  %-16s Instructions: %s%6.2fM%s, Throughput: %s%8.2f%s MiB/s, " \
+        "Per instruction: %s%7.2f%s nsec\n", stage,
+        CVT100_OUT(COLOR_VALUE_B), (double)count / 1000000, CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_G), (double)bytes / (1024 * 1024) / (time / 1000),
+        CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(COLOR_VALUE_G), time * 1000000 / (double)count, CVT100_OUT(COLOR_DEFAULT));
+}
+
+static void TestCorpusDecoder(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    const char* stage, const ZyanU8* buffer, ZyanUSize length, ZyanU32 iterations,
+    ZyanBool minimal_mode, ZyanBool format)
+{
+    TestContext context;
+    context.cache = ZYAN_NULL;
+    context.minimal_mode = minimal_mode;
+    context.format = format;
+    context.tokenize = ZYAN_FALSE;
+    context.fused = ZYAN_FALSE;
+
+    // Cache warmup
+    ProcessBuffer(decoder, formatter, &context, buffer, length);
+
+    // Testing
+    ZyanU64 count = 0;
+    StartCounter();
+    for (ZyanU32 j = 0; j < iterations; ++j)
+    {
+        count += ProcessBuffer(decoder, formatter, &context, buffer, length);
+    }
+    PrintCorpusResult(stage, count, (ZyanU64)length * iterations, GetCounter());
+}
+
+#if !defined(ZYDIS_DISABLE_ENCODER)
+
+static void TestCorpusEncoder(const ZydisDecoder* decoder, const ZyanU8* buffer,
+    ZyanUSize length, ZyanU32 iterations)
+{
+    ZyanUSize capacity = length / 2 + 1;
+    ZydisEncoderRequest* requests = malloc(capacity * sizeof(ZydisEncoderRequest));
+    if (!requests)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to allocate encoder requests%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
+
+    // Instructions that can not be represented as an encoder request are skipped
+    ZyanU8 scratch[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    ZyanUSize count = 0;
+    ZyanUSize skipped = 0;
+    ZyanUSize size = 0;
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    for (ZyanUSize offset = 0; offset < length; offset += instruction.length)
+    {
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(decoder, buffer + offset, length - offset,
+            &instruction, operands)))
+        {
+            break;
+        }
+        if (count == capacity)
+        {
+            capacity *= 2;
+            ZydisEncoderRequest* temp = realloc(requests, capacity * sizeof(ZydisEncoderRequest));
+            if (!temp)
+            {
+                ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to allocate encoder requests%s\n",
+                    CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+                exit(EXIT_FAILURE);
+            }
+            requests = temp;
+        }
+        ZyanUSize encoded_length = sizeof(scratch);
+        if (!ZYAN_SUCCESS(ZydisEncoderDecodedInstructionToEncoderRequest(&instruction, operands,
+                instruction.operand_count_visible, &requests[count])) ||
+            !ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(&requests[count], scratch,
+                &encoded_length)))
+        {
+            ++skipped;
+            continue;
+        }
+        size += encoded_length;
+        ++count;
+    }
+
+    const ZyanUSize code_size = (count + 1) * ZYDIS_MAX_INSTRUCTION_LENGTH;
+    ZyanU8* code = malloc(code_size);
+    if (!code)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to allocate %" PRIu64 " bytes on the heap%s\n",
+            CVT100_ERR(COLOR_ERROR), (ZyanU64)code_size, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
+
+    // Testing
+    StartCounter();
+    for (ZyanU32 j = 0; j < iterations; ++j)
+    {
+        ZyanUSize offset = 0;
+        for (ZyanUSize i = 0; i < count; ++i)
+        {
+            ZyanUSize encoded_length = code_size - offset;
+            if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(&requests[i], code + offset,
+                &encoded_length)))
+            {
+                ZYAN_FPRINTF(ZYAN_STDERR, "%sUnexpected encoding error%s\n",
+                    CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+                ZYAN_ASSERT(ZYAN_FALSE);
+                exit(EXIT_FAILURE);
+            }
+            offset += encoded_length;
+        }
+    }
+    PrintCorpusResult("Encode", (ZyanU64)count * iterations, (ZyanU64)size * iterations,
+        GetCounter());
+    if (skipped)
+    {
+        ZYAN_PRINTF("  %-16s %" PRIu64 " instructions not re-encodable\n", "",
+            (ZyanU64)skipped);
+    }
+
+    free(code);
+    free(requests);
+}
+
+#endif
+
+static ZyanU8* ReadCorpus(const char* path, ZyanUSize* length)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCould not open file \"%s\": %s%s\n",
+            CVT100_ERR(COLOR_ERROR), path, strerror(ZYAN_ERRNO),
+            CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return ZYAN_NULL;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    const long size = ftell(file);
+    rewind(file);
+
+    ZyanU8* buffer = (size > 0) ? malloc((ZyanUSize)size) : ZYAN_NULL;
+    if (!buffer || (fread(buffer, 1, (ZyanUSize)size, file) != (ZyanUSize)size))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCould not read corpus file \"%s\"%s\n",
+            CVT100_ERR(COLOR_ERROR), path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        free(buffer);
+        buffer = ZYAN_NULL;
+    }
+    *length = (ZyanUSize)size;
+
+    fclose(file);
+    return buffer;
+}
+
+/**
+ * Measures decode, format and encode throughput of the given corpus (the raw `.text` section
+ * of a compiled program). Every stage processes at least `CORPUS_MIN_BYTES`.
+ */
+static void TestCorpus(const ZyanU8* buffer, ZyanUSize length)
+{
+    ZydisDecoder decoder_minimal;
+    ZydisDecoder decoder;
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&decoder_minimal, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) ||
+        !ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder_minimal, ZYDIS_DECODER_MODE_MINIMAL,
+            ZYAN_TRUE)) ||
+        !ZYAN_SUCCESS(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
+
+    ZydisFormatter formatter;
+    if (!ZYAN_SUCCESS(ZydisFormatterInit(&formatter, ZYDIS_FORMATTER_STYLE_INTEL)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize instruction-formatter%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        exit(EXIT_FAILURE);
+    }
+
+    const ZyanU32 iterations = (ZyanU32)ZYAN_MAX(1, CORPUS_MIN_BYTES / length);
+    TestCorpusDecoder(&decoder_minimal, &formatter, "Decode (minimal)", buffer, length,
+        iterations, ZYAN_TRUE, ZYAN_FALSE);
+    TestCorpusDecoder(&decoder, &formatter, "Decode", buffer, length, iterations, ZYAN_FALSE,
+        ZYAN_FALSE);
+    TestCorpusDecoder(&decoder, &formatter, "Decode + Format", buffer, length, iterations,
+        ZYAN_FALSE, ZYAN_TRUE);
+#if !defined(ZYDIS_DISABLE_ENCODER)
+    TestCorpusEncoder(&decoder, buffer, length, iterations);
+#endif
 }
 
 static void GenerateTestData(FILE* file, ZyanU8 encoding)
@@ -473,14 +713,44 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    if (argc < 3 || (ZYAN_STRCMP(argv[1], "-test") && ZYAN_STRCMP(argv[1], "-generate")))
+    if (argc < 3 || (ZYAN_STRCMP(argv[1], "-test") && ZYAN_STRCMP(argv[1], "-generate") &&
+        ZYAN_STRCMP(argv[1], "-corpus")))
     {
-        ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s -[test|generate] [directory]%s\n",
-            CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "PerfTest"),
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s -[test|generate] [directory]\n" \
+            "       %s -corpus [file]...%s\n", CVT100_ERR(COLOR_ERROR),
+            (argc > 0 ? argv[0] : "PerfTest"), (argc > 0 ? argv[0] : "PerfTest"),
             CVT100_ERR(ZYAN_VT100SGR_RESET));
         return EXIT_FAILURE;
     }
 
+    if (!ZYAN_STRCMP(argv[1], "-corpus"))
+    {
+        AdjustProcessAndThreadPriority();
+
+        int result = EXIT_SUCCESS;
+        for (int i = 2; i < argc; ++i)
+        {
+            ZyanUSize length;
+            ZyanU8* buffer = ReadCorpus(argv[i], &length);
+            if (!buffer)
+            {
+                result = EXIT_FAILURE;
+                continue;
+            }
+
+            const char* name = strrchr(argv[i], '/');
+            ZYAN_PRINTF("%sTesting %s%s%s (%" PRIu64 " bytes) ...\n",
+                CVT100_OUT(ZYAN_VT100SGR_FG_MAGENTA), CVT100_OUT(ZYAN_VT100SGR_FG_BRIGHT_MAGENTA),
+                name ? name + 1 : argv[i], CVT100_OUT(COLOR_DEFAULT), (ZyanU64)length);
+            TestCorpus(buffer, length);
+            ZYAN_PUTS("");
+
+            free(buffer);
+        }
+
+        return result;
+    }
+
     ZyanBool generate = ZYAN_FALSE;
     if (!ZYAN_STRCMP(argv[1], "-generate"))
     {
@@ -510,6 +780,14 @@ int main(int argc, char** argv)
     } else
     {
         AdjustProcessAndThreadPriority();
+
+        if (ZydisIsFeatureEnabled(ZYDIS_FEATURE_HUGE_PAGE_TABLES) == ZYAN_STATUS_TRUE)
+        {
+            const ZyanStatus status = ZydisMapTablesToHugePages();
+            ZYAN_PRINTF("%sHuge page tables: %s%s\n\n", CVT100_OUT(COLOR_DEFAULT),
+                ZYAN_SUCCESS(status) ? "remapped" : "unavailable",
+                CVT100_OUT(ZYAN_VT100SGR_RESET));
+        }
     }
 
     for (ZyanU8 i = 0; i < ZYAN_ARRAY_LENGTH(tests); ++i)
@@ -565,13 +843,28 @@ int main(int argc, char** argv)
             ZYAN_PRINTF("%sTesting %s%s%s ...\n", CVT100_OUT(ZYAN_VT100SGR_FG_MAGENTA),
                 CVT100_OUT(ZYAN_VT100SGR_FG_BRIGHT_MAGENTA), tests[i].encoding,
                 CVT100_OUT(COLOR_DEFAULT));
-            TestPerformance(buffer, length, ZYAN_TRUE , ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE);
-            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE);
-            // TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE);
-            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE, ZYAN_FALSE);
-            // TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE, ZYAN_TRUE);
-            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_TRUE , ZYAN_TRUE , ZYAN_FALSE);
-            // TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_TRUE , ZYAN_TRUE , ZYAN_TRUE);
+            TestPerformance(buffer, length, ZYAN_TRUE , ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_TRUE , ZYAN_TRUE , ZYAN_FALSE, ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE, ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE, ZYAN_FALSE,
+                ZYAN_TRUE , ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE,
+                ZYAN_TRUE , ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_TRUE ,
+                ZYAN_FALSE, ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_TRUE ,
+                ZYAN_TRUE , ZYAN_FALSE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE,
+                ZYAN_FALSE, ZYAN_TRUE);
+            TestPerformance(buffer, length, ZYAN_FALSE, ZYAN_FALSE, ZYAN_TRUE , ZYAN_FALSE,
+                ZYAN_TRUE , ZYAN_TRUE);
             ZYAN_PUTS("");
 
         NextFile1:
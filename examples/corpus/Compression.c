@@ -0,0 +1,492 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * Benchmark corpus: LZ77 style compression, run-length encoding and Huffman code construction.
+ *
+ * This file is never linked into anything. It is compiled with different optimization levels
+ * by the `ZYDIS_BUILD_BENCHMARK_CORPUS` build step and the `.text` section of the resulting
+ * objects is used as realistic input for `ZydisPerfTest -corpus`.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* ============================================================================================== */
+/* LZ77                                                                                           */
+/* ============================================================================================== */
+
+#define LZ_HASH_BITS    14
+#define LZ_HASH_SIZE    (1u << LZ_HASH_BITS)
+#define LZ_WINDOW_SIZE  0xFFFF
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_CHAIN    16
+
+typedef struct LzState_
+{
+    int32_t head[LZ_HASH_SIZE];
+    int32_t prev[LZ_WINDOW_SIZE + 1];
+} LzState;
+
+static uint32_t LzRead32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t LzHash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static size_t LzMatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* end)
+{
+    const uint8_t* start = a;
+    while ((a + 8 <= end) && !memcmp(a, b, 8))
+    {
+        a += 8;
+        b += 8;
+    }
+    while ((a < end) && (*a == *b))
+    {
+        ++a;
+        ++b;
+    }
+    return (size_t)(a - start);
+}
+
+static uint8_t* LzWriteLength(uint8_t* out, size_t length)
+{
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+static uint8_t* LzWriteSequence(uint8_t* out, const uint8_t* literals, size_t literal_count,
+    size_t offset, size_t match_length)
+{
+    uint8_t* token = out++;
+    const size_t ml = match_length ? match_length - LZ_MIN_MATCH : 0;
+    *token = (uint8_t)(((literal_count < 15 ? literal_count : 15) << 4) | (ml < 15 ? ml : 15));
+    if (literal_count >= 15)
+    {
+        out = LzWriteLength(out, literal_count - 15);
+    }
+    memcpy(out, literals, literal_count);
+    out += literal_count;
+    if (match_length)
+    {
+        *out++ = (uint8_t)offset;
+        *out++ = (uint8_t)(offset >> 8);
+        if (ml >= 15)
+        {
+            out = LzWriteLength(out, ml - 15);
+        }
+    }
+    return out;
+}
+
+size_t LzCompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t LzCompress(LzState* state, const uint8_t* in, size_t size, uint8_t* out)
+{
+    const uint8_t* const end = in + size;
+    const uint8_t* ip = in;
+    const uint8_t* anchor = in;
+    uint8_t* op = out;
+
+    for (size_t i = 0; i < LZ_HASH_SIZE; ++i)
+    {
+        state->head[i] = -1;
+    }
+
+    while (ip + LZ_MIN_MATCH <= end)
+    {
+        const int32_t pos = (int32_t)(ip - in);
+        const uint32_t h = LzHash(LzRead32(ip));
+        int32_t candidate = state->head[h];
+        state->prev[pos & LZ_WINDOW_SIZE] = candidate;
+        state->head[h] = pos;
+
+        size_t best_length = 0;
+        size_t best_offset = 0;
+        for (int chain = 0; (chain < LZ_MAX_CHAIN) && (candidate >= 0); ++chain)
+        {
+            const size_t offset = (size_t)(pos - candidate);
+            if (offset > LZ_WINDOW_SIZE)
+            {
+                break;
+            }
+            if (LzRead32(in + candidate) == LzRead32(ip))
+            {
+                const size_t length = LzMatchLength(ip, in + candidate, end);
+                if (length > best_length)
+                {
+                    best_length = length;
+                    best_offset = offset;
+                }
+            }
+            candidate = state->prev[candidate & LZ_WINDOW_SIZE];
+        }
+
+        if (best_length < LZ_MIN_MATCH)
+        {
+            ++ip;
+            continue;
+        }
+
+        op = LzWriteSequence(op, anchor, (size_t)(ip - anchor), best_offset, best_length);
+        ip += best_length;
+        anchor = ip;
+    }
+
+    op = LzWriteSequence(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - out);
+}
+
+size_t LzDecompress(const uint8_t* in, size_t size, uint8_t* out, size_t capacity)
+{
+    const uint8_t* const end = in + size;
+    uint8_t* op = out;
+    uint8_t* const op_end = out + capacity;
+
+    while (in < end)
+    {
+        const uint8_t token = *in++;
+        size_t literal_count = token >> 4;
+        if (literal_count == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (in >= end)
+                {
+                    return 0;
+                }
+                b = *in++;
+                literal_count += b;
+            } while (b == 255);
+        }
+        if ((literal_count > (size_t)(end - in)) || (literal_count > (size_t)(op_end - op)))
+        {
+            return 0;
+        }
+        memcpy(op, in, literal_count);
+        op += literal_count;
+        in += literal_count;
+        if (in >= end)
+        {
+            break;
+        }
+
+        if (end - in < 2)
+        {
+            return 0;
+        }
+        const size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t match_length = (token & 15);
+        if (match_length == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (in >= end)
+                {
+                    return 0;
+                }
+                b = *in++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += LZ_MIN_MATCH;
+        if (!offset || (offset > (size_t)(op - out)) || (match_length > (size_t)(op_end - op)))
+        {
+            return 0;
+        }
+        const uint8_t* match = op - offset;
+        while (match_length--)
+        {
+            *op++ = *match++;
+        }
+    }
+
+    return (size_t)(op - out);
+}
+
+/* ============================================================================================== */
+/* Run-length encoding                                                                            */
+/* ============================================================================================== */
+
+size_t RleEncode(const uint8_t* in, size_t size, uint8_t* out)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < size; )
+    {
+        size_t run = 1;
+        while ((i + run < size) && (in[i + run] == in[i]) && (run < 128))
+        {
+            ++run;
+        }
+        if (run >= 3)
+        {
+            out[o++] = (uint8_t)(0x80 | (run - 1));
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        size_t literals = 0;
+        while ((i + literals < size) && (literals < 128))
+        {
+            if ((i + literals + 2 < size) && (in[i + literals] == in[i + literals + 1]) &&
+                (in[i + literals] == in[i + literals + 2]))
+            {
+                break;
+            }
+            ++literals;
+        }
+        out[o++] = (uint8_t)(literals - 1);
+        memcpy(out + o, in + i, literals);
+        o += literals;
+        i += literals;
+    }
+    return o;
+}
+
+size_t RleDecode(const uint8_t* in, size_t size, uint8_t* out)
+{
+    size_t o = 0;
+    for (size_t i = 0; i < size; )
+    {
+        const uint8_t header = in[i++];
+        const size_t count = (size_t)(header & 0x7F) + 1;
+        if (header & 0x80)
+        {
+            memset(out + o, in[i++], count);
+        } else
+        {
+            memcpy(out + o, in + i, count);
+            i += count;
+        }
+        o += count;
+    }
+    return o;
+}
+
+/* ============================================================================================== */
+/* Huffman coding                                                                                 */
+/* ============================================================================================== */
+
+#define HUFFMAN_SYMBOLS     256
+#define HUFFMAN_MAX_LENGTH  15
+
+typedef struct HuffmanNode_
+{
+    uint32_t weight;
+    int16_t left;
+    int16_t right;
+} HuffmanNode;
+
+static void HeapSiftDown(int16_t* heap, size_t count, size_t i, const HuffmanNode* nodes)
+{
+    for (;;)
+    {
+        size_t smallest = i;
+        const size_t l = 2 * i + 1;
+        const size_t r = 2 * i + 2;
+        if ((l < count) && (nodes[heap[l]].weight < nodes[heap[smallest]].weight))
+        {
+            smallest = l;
+        }
+        if ((r < count) && (nodes[heap[r]].weight < nodes[heap[smallest]].weight))
+        {
+            smallest = r;
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+        const int16_t t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+static void HuffmanAssignLengths(const HuffmanNode* nodes, int16_t node, uint8_t depth,
+    uint8_t* lengths)
+{
+    if (nodes[node].left < 0)
+    {
+        lengths[node] = depth ? depth : 1;
+        return;
+    }
+    HuffmanAssignLengths(nodes, nodes[node].left, depth + 1, lengths);
+    HuffmanAssignLengths(nodes, nodes[node].right, depth + 1, lengths);
+}
+
+void HuffmanHistogram(const uint8_t* data, size_t size, uint32_t* histogram)
+{
+    uint32_t h[4][HUFFMAN_SYMBOLS] = { { 0 } };
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        ++h[0][data[i + 0]];
+        ++h[1][data[i + 1]];
+        ++h[2][data[i + 2]];
+        ++h[3][data[i + 3]];
+    }
+    for (; i < size; ++i)
+    {
+        ++h[0][data[i]];
+    }
+    for (i = 0; i < HUFFMAN_SYMBOLS; ++i)
+    {
+        histogram[i] = h[0][i] + h[1][i] + h[2][i] + h[3][i];
+    }
+}
+
+void HuffmanBuildLengths(const uint32_t* histogram, uint8_t* lengths)
+{
+    HuffmanNode nodes[2 * HUFFMAN_SYMBOLS];
+    int16_t heap[HUFFMAN_SYMBOLS];
+    size_t count = 0;
+
+    for (int16_t i = 0; i < HUFFMAN_SYMBOLS; ++i)
+    {
+        nodes[i].weight = histogram[i];
+        nodes[i].left = nodes[i].right = -1;
+        lengths[i] = 0;
+        if (histogram[i])
+        {
+            heap[count++] = i;
+        }
+    }
+    if (!count)
+    {
+        return;
+    }
+    for (size_t i = count / 2; i-- > 0; )
+    {
+        HeapSiftDown(heap, count, i, nodes);
+    }
+
+    int16_t next = HUFFMAN_SYMBOLS;
+    while (count > 1)
+    {
+        const int16_t a = heap[0];
+        heap[0] = heap[--count];
+        HeapSiftDown(heap, count, 0, nodes);
+        const int16_t b = heap[0];
+
+        nodes[next].weight = nodes[a].weight + nodes[b].weight;
+        nodes[next].left = a;
+        nodes[next].right = b;
+        heap[0] = next++;
+        HeapSiftDown(heap, count, 0, nodes);
+    }
+
+    uint8_t all_lengths[2 * HUFFMAN_SYMBOLS];
+    HuffmanAssignLengths(nodes, heap[0], 0, all_lengths);
+    for (size_t i = 0; i < HUFFMAN_SYMBOLS; ++i)
+    {
+        if (histogram[i])
+        {
+            lengths[i] = all_lengths[i] > HUFFMAN_MAX_LENGTH ? HUFFMAN_MAX_LENGTH : all_lengths[i];
+        }
+    }
+}
+
+void HuffmanBuildCodes(const uint8_t* lengths, uint16_t* codes)
+{
+    uint16_t length_count[HUFFMAN_MAX_LENGTH + 1] = { 0 };
+    uint16_t next_code[HUFFMAN_MAX_LENGTH + 1];
+
+    for (size_t i = 0; i < HUFFMAN_SYMBOLS; ++i)
+    {
+        ++length_count[lengths[i]];
+    }
+    length_count[0] = 0;
+
+    uint16_t code = 0;
+    for (size_t bits = 1; bits <= HUFFMAN_MAX_LENGTH; ++bits)
+    {
+        code = (uint16_t)((code + length_count[bits - 1]) << 1);
+        next_code[bits] = code;
+    }
+    for (size_t i = 0; i < HUFFMAN_SYMBOLS; ++i)
+    {
+        if (lengths[i])
+        {
+            uint16_t c = next_code[lengths[i]]++;
+            uint16_t reversed = 0;
+            for (uint8_t j = 0; j < lengths[i]; ++j)
+            {
+                reversed = (uint16_t)((reversed << 1) | (c & 1));
+                c >>= 1;
+            }
+            codes[i] = reversed;
+        }
+    }
+}
+
+size_t HuffmanEncode(const uint8_t* in, size_t size, const uint8_t* lengths,
+    const uint16_t* codes, uint8_t* out)
+{
+    uint64_t bits = 0;
+    unsigned bit_count = 0;
+    size_t o = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        bits |= (uint64_t)codes[in[i]] << bit_count;
+        bit_count += lengths[in[i]];
+        while (bit_count >= 8)
+        {
+            out[o++] = (uint8_t)bits;
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    }
+    if (bit_count)
+    {
+        out[o++] = (uint8_t)bits;
+    }
+    return o;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,397 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * Benchmark corpus: cryptographic and non-cryptographic hash functions and checksums.
+ *
+ * This file is never linked into anything. It is compiled with different optimization levels
+ * by the `ZYDIS_BUILD_BENCHMARK_CORPUS` build step and the `.text` section of the resulting
+ * objects is used as realistic input for `ZydisPerfTest -corpus`.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* ============================================================================================== */
+/* Helpers                                                                                        */
+/* ============================================================================================== */
+
+static uint32_t Rotr32(uint32_t value, unsigned count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+static uint64_t Rotl64(uint64_t value, unsigned count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static uint32_t LoadBe32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void StoreBe32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static uint64_t LoadLe64(const uint8_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* ============================================================================================== */
+/* SHA-256                                                                                        */
+/* ============================================================================================== */
+
+typedef struct Sha256_
+{
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[64];
+    size_t buffer_size;
+} Sha256;
+
+static const uint32_t SHA256_K[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static void Sha256Transform(uint32_t* state, const uint8_t* block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+    {
+        w[i] = LoadBe32(block + 4 * i);
+    }
+    for (int i = 16; i < 64; ++i)
+    {
+        const uint32_t s0 = Rotr32(w[i - 15], 7) ^ Rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = Rotr32(w[i - 2], 17) ^ Rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i)
+    {
+        const uint32_t s1 = Rotr32(e, 6) ^ Rotr32(e, 11) ^ Rotr32(e, 25);
+        const uint32_t ch = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+        const uint32_t s0 = Rotr32(a, 2) ^ Rotr32(a, 13) ^ Rotr32(a, 22);
+        const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256Init(Sha256* ctx)
+{
+    static const uint32_t iv[8] =
+    {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->length = 0;
+    ctx->buffer_size = 0;
+}
+
+void Sha256Update(Sha256* ctx, const uint8_t* data, size_t size)
+{
+    ctx->length += size;
+    if (ctx->buffer_size)
+    {
+        const size_t n = (64 - ctx->buffer_size < size) ? 64 - ctx->buffer_size : size;
+        memcpy(ctx->buffer + ctx->buffer_size, data, n);
+        ctx->buffer_size += n;
+        data += n;
+        size -= n;
+        if (ctx->buffer_size < 64)
+        {
+            return;
+        }
+        Sha256Transform(ctx->state, ctx->buffer);
+        ctx->buffer_size = 0;
+    }
+    for (; size >= 64; data += 64, size -= 64)
+    {
+        Sha256Transform(ctx->state, data);
+    }
+    memcpy(ctx->buffer, data, size);
+    ctx->buffer_size = size;
+}
+
+void Sha256Final(Sha256* ctx, uint8_t* digest)
+{
+    const uint64_t bit_length = ctx->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    const size_t pad_size = (ctx->buffer_size < 56) ? 56 - ctx->buffer_size
+                                                    : 120 - ctx->buffer_size;
+    for (int i = 0; i < 8; ++i)
+    {
+        pad[pad_size + i] = (uint8_t)(bit_length >> (56 - 8 * i));
+    }
+    const uint64_t length = ctx->length;
+    Sha256Update(ctx, pad, pad_size + 8);
+    ctx->length = length;
+    for (int i = 0; i < 8; ++i)
+    {
+        StoreBe32(digest + 4 * i, ctx->state[i]);
+    }
+}
+
+/* ============================================================================================== */
+/* CRC-32 and Adler-32                                                                            */
+/* ============================================================================================== */
+
+static uint32_t crc32_table[8][256];
+
+void Crc32InitTables(void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc32_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        for (int t = 1; t < 8; ++t)
+        {
+            const uint32_t c = crc32_table[t - 1][i];
+            crc32_table[t][i] = crc32_table[0][c & 0xFF] ^ (c >> 8);
+        }
+    }
+}
+
+uint32_t Crc32Bitwise(uint32_t crc, const uint8_t* data, size_t size)
+{
+    crc = ~crc;
+    while (size--)
+    {
+        crc ^= *data++;
+        for (int k = 0; k < 8; ++k)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t Crc32SliceBy8(uint32_t crc, const uint8_t* data, size_t size)
+{
+    crc = ~crc;
+    while (size >= 8)
+    {
+        const uint32_t lo = (uint32_t)LoadLe64(data) ^ crc;
+        const uint32_t hi = (uint32_t)(LoadLe64(data) >> 32);
+        crc = crc32_table[7][lo & 0xFF] ^ crc32_table[6][(lo >> 8) & 0xFF] ^
+              crc32_table[5][(lo >> 16) & 0xFF] ^ crc32_table[4][lo >> 24] ^
+              crc32_table[3][hi & 0xFF] ^ crc32_table[2][(hi >> 8) & 0xFF] ^
+              crc32_table[1][(hi >> 16) & 0xFF] ^ crc32_table[0][hi >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size--)
+    {
+        crc = crc32_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size)
+    {
+        size_t n = size < 5552 ? size : 5552;
+        size -= n;
+        while (n--)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+/* ============================================================================================== */
+/* Non-cryptographic hashes                                                                       */
+/* ============================================================================================== */
+
+uint64_t Fnv1a64(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t Fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+void Murmur3x64128(const uint8_t* data, size_t size, uint32_t seed, uint64_t* out)
+{
+    const uint64_t c1 = 0x87C37B91114253D5ull;
+    const uint64_t c2 = 0x4CF5AD432745937Full;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+    const size_t blocks = size / 16;
+
+    for (size_t i = 0; i < blocks; ++i)
+    {
+        uint64_t k1 = LoadLe64(data + 16 * i);
+        uint64_t k2 = LoadLe64(data + 16 * i + 8);
+        k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = Rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+        k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = Rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+    }
+
+    const uint8_t* tail = data + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (size & 15)
+    {
+    case 15: k2 ^= (uint64_t)tail[14] << 48; /* fallthrough */
+    case 14: k2 ^= (uint64_t)tail[13] << 40; /* fallthrough */
+    case 13: k2 ^= (uint64_t)tail[12] << 32; /* fallthrough */
+    case 12: k2 ^= (uint64_t)tail[11] << 24; /* fallthrough */
+    case 11: k2 ^= (uint64_t)tail[10] << 16; /* fallthrough */
+    case 10: k2 ^= (uint64_t)tail[ 9] << 8;  /* fallthrough */
+    case  9: k2 ^= (uint64_t)tail[ 8];
+             k2 *= c2; k2 = Rotl64(k2, 33); k2 *= c1; h2 ^= k2; /* fallthrough */
+    case  8: k1 ^= (uint64_t)tail[ 7] << 56; /* fallthrough */
+    case  7: k1 ^= (uint64_t)tail[ 6] << 48; /* fallthrough */
+    case  6: k1 ^= (uint64_t)tail[ 5] << 40; /* fallthrough */
+    case  5: k1 ^= (uint64_t)tail[ 4] << 32; /* fallthrough */
+    case  4: k1 ^= (uint64_t)tail[ 3] << 24; /* fallthrough */
+    case  3: k1 ^= (uint64_t)tail[ 2] << 16; /* fallthrough */
+    case  2: k1 ^= (uint64_t)tail[ 1] << 8;  /* fallthrough */
+    case  1: k1 ^= (uint64_t)tail[ 0];
+             k1 *= c1; k1 = Rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    default:
+        break;
+    }
+
+    h1 ^= size; h2 ^= size;
+    h1 += h2; h2 += h1;
+    h1 = Fmix64(h1); h2 = Fmix64(h2);
+    h1 += h2; h2 += h1;
+    out[0] = h1;
+    out[1] = h2;
+}
+
+#define SIP_ROUND(v0, v1, v2, v3) \
+    do \
+    { \
+        v0 += v1; v1 = Rotl64(v1, 13); v1 ^= v0; v0 = Rotl64(v0, 32); \
+        v2 += v3; v3 = Rotl64(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = Rotl64(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = Rotl64(v1, 17); v1 ^= v2; v2 = Rotl64(v2, 32); \
+    } while (0)
+
+uint64_t SipHash24(const uint8_t* key, const uint8_t* data, size_t size)
+{
+    const uint64_t k0 = LoadLe64(key);
+    const uint64_t k1 = LoadLe64(key + 8);
+    uint64_t v0 = 0x736F6D6570736575ull ^ k0;
+    uint64_t v1 = 0x646F72616E646F6Dull ^ k1;
+    uint64_t v2 = 0x6C7967656E657261ull ^ k0;
+    uint64_t v3 = 0x7465646279746573ull ^ k1;
+
+    const size_t end = size & ~(size_t)7;
+    for (size_t i = 0; i < end; i += 8)
+    {
+        const uint64_t m = LoadLe64(data + i);
+        v3 ^= m;
+        SIP_ROUND(v0, v1, v2, v3);
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t)size << 56;
+    for (size_t i = 0; i < (size & 7); ++i)
+    {
+        b |= (uint64_t)data[end + i] << (8 * i);
+    }
+    v3 ^= b;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xFF;
+    for (int i = 0; i < 4; ++i)
+    {
+        SIP_ROUND(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,285 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * Benchmark corpus: dense linear algebra, FFT, stencil and reduction kernels.
+ *
+ * This file is never linked into anything. It is compiled with different optimization levels
+ * by the `ZYDIS_BUILD_BENCHMARK_CORPUS` build step and the `.text` section of the resulting
+ * objects is used as realistic input for `ZydisPerfTest -corpus`. The loops are written so that
+ * compilers vectorize them at higher optimization levels.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ============================================================================================== */
+/* BLAS style kernels                                                                             */
+/* ============================================================================================== */
+
+void Saxpy(size_t n, float a, const float* restrict x, float* restrict y)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+double Ddot(size_t n, const double* restrict x, const double* restrict y)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+int32_t DotI8(size_t n, const int8_t* restrict x, const int8_t* restrict y)
+{
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum += (int32_t)x[i] * y[i];
+    }
+    return sum;
+}
+
+void Sgemv(size_t rows, size_t cols, const float* restrict a, const float* restrict x,
+    float* restrict y)
+{
+    for (size_t i = 0; i < rows; ++i)
+    {
+        float sum = 0.0f;
+        for (size_t j = 0; j < cols; ++j)
+        {
+            sum += a[i * cols + j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+#define GEMM_BLOCK 64
+
+void Dgemm(size_t n, const double* restrict a, const double* restrict b, double* restrict c)
+{
+    for (size_t i = 0; i < n * n; ++i)
+    {
+        c[i] = 0.0;
+    }
+    for (size_t ii = 0; ii < n; ii += GEMM_BLOCK)
+    {
+        for (size_t kk = 0; kk < n; kk += GEMM_BLOCK)
+        {
+            for (size_t jj = 0; jj < n; jj += GEMM_BLOCK)
+            {
+                const size_t i_end = ii + GEMM_BLOCK < n ? ii + GEMM_BLOCK : n;
+                const size_t k_end = kk + GEMM_BLOCK < n ? kk + GEMM_BLOCK : n;
+                const size_t j_end = jj + GEMM_BLOCK < n ? jj + GEMM_BLOCK : n;
+                for (size_t i = ii; i < i_end; ++i)
+                {
+                    for (size_t k = kk; k < k_end; ++k)
+                    {
+                        const double aik = a[i * n + k];
+                        for (size_t j = jj; j < j_end; ++j)
+                        {
+                            c[i * n + j] += aik * b[k * n + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Transpose(size_t rows, size_t cols, const float* restrict in, float* restrict out)
+{
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < cols; ++j)
+        {
+            out[j * rows + i] = in[i * cols + j];
+        }
+    }
+}
+
+/* ============================================================================================== */
+/* Signal processing                                                                              */
+/* ============================================================================================== */
+
+void FftRadix2(size_t n, double* re, double* im, int inverse)
+{
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const double angle = (inverse ? 2.0 : -2.0) * 3.14159265358979323846 / (double)length;
+        const double w_re = cos(angle);
+        const double w_im = sin(angle);
+        for (size_t i = 0; i < n; i += length)
+        {
+            double u_re = 1.0;
+            double u_im = 0.0;
+            for (size_t j = 0; j < length / 2; ++j)
+            {
+                const size_t p = i + j;
+                const size_t q = p + length / 2;
+                const double t_re = re[q] * u_re - im[q] * u_im;
+                const double t_im = re[q] * u_im + im[q] * u_re;
+                re[q] = re[p] - t_re;
+                im[q] = im[p] - t_im;
+                re[p] += t_re;
+                im[p] += t_im;
+                const double next = u_re * w_re - u_im * w_im;
+                u_im = u_re * w_im + u_im * w_re;
+                u_re = next;
+            }
+        }
+    }
+
+    if (inverse)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            re[i] /= (double)n;
+            im[i] /= (double)n;
+        }
+    }
+}
+
+void FirFilter(size_t n, const float* restrict in, size_t taps, const float* restrict coeffs,
+    float* restrict out)
+{
+    for (size_t i = 0; i + taps <= n; ++i)
+    {
+        float sum = 0.0f;
+        for (size_t k = 0; k < taps; ++k)
+        {
+            sum += in[i + k] * coeffs[k];
+        }
+        out[i] = sum;
+    }
+}
+
+/* ============================================================================================== */
+/* Stencils and reductions                                                                        */
+/* ============================================================================================== */
+
+void Jacobi2D(size_t rows, size_t cols, const float* restrict in, float* restrict out)
+{
+    for (size_t i = 1; i + 1 < rows; ++i)
+    {
+        for (size_t j = 1; j + 1 < cols; ++j)
+        {
+            out[i * cols + j] = 0.2f * (in[i * cols + j] + in[(i - 1) * cols + j] +
+                in[(i + 1) * cols + j] + in[i * cols + j - 1] + in[i * cols + j + 1]);
+        }
+    }
+}
+
+void PrefixSum(size_t n, const int64_t* restrict in, int64_t* restrict out)
+{
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum += in[i];
+        out[i] = sum;
+    }
+}
+
+void MinMax(size_t n, const float* x, float* min, float* max)
+{
+    float lo = INFINITY;
+    float hi = -INFINITY;
+    for (size_t i = 0; i < n; ++i)
+    {
+        lo = x[i] < lo ? x[i] : lo;
+        hi = x[i] > hi ? x[i] : hi;
+    }
+    *min = lo;
+    *max = hi;
+}
+
+double Norm2(size_t n, const double* x)
+{
+    double scale = 0.0;
+    double sum = 1.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (x[i] == 0.0)
+        {
+            continue;
+        }
+        const double a = fabs(x[i]);
+        if (scale < a)
+        {
+            sum = 1.0 + sum * (scale / a) * (scale / a);
+            scale = a;
+        } else
+        {
+            sum += (a / scale) * (a / scale);
+        }
+    }
+    return scale * sqrt(sum);
+}
+
+double Horner(size_t degree, const double* coeffs, double x)
+{
+    double result = coeffs[degree];
+    for (size_t i = degree; i-- > 0; )
+    {
+        result = result * x + coeffs[i];
+    }
+    return result;
+}
+
+void QuantizeU8(size_t n, const float* restrict in, float scale, uint8_t* restrict out)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        float v = in[i] * scale + 0.5f;
+        v = v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+        out[i] = (uint8_t)v;
+    }
+}
+
+/* ============================================================================================== */
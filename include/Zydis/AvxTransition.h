@@ -0,0 +1,174 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for detecting AVX/SSE transition penalties in machine code.
+ */
+
+#ifndef ZYDIS_AVX_TRANSITION_H
+#define ZYDIS_AVX_TRANSITION_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup avx_transition AVX transitions
+ * Functions for detecting AVX/SSE transition penalties in machine code.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisAvxTransitionHazardType` enum.
+ */
+typedef enum ZydisAvxTransitionHazardType_
+{
+    /**
+     * A legacy-encoded SSE instruction is reachable while the upper halves of the vector
+     * registers may be dirty.
+     */
+    ZYDIS_AVX_TRANSITION_HAZARD_SSE,
+    /**
+     * A call or tail-call is made while the upper halves of the vector registers may be dirty.
+     */
+    ZYDIS_AVX_TRANSITION_HAZARD_CALL,
+    /**
+     * The function returns while the upper halves of the vector registers may be dirty.
+     */
+    ZYDIS_AVX_TRANSITION_HAZARD_RETURN,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE = ZYDIS_AVX_TRANSITION_HAZARD_RETURN,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_AVX_TRANSITION_HAZARD_REQUIRED_BITS =
+        ZYAN_BITS_TO_REPRESENT(ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE)
+} ZydisAvxTransitionHazardType;
+
+/**
+ * Describes a single AVX/SSE transition hazard.
+ */
+typedef struct ZydisAvxTransitionHazard_
+{
+    /**
+     * The hazard type.
+     */
+    ZydisAvxTransitionHazardType type;
+    /**
+     * The offset of the affected instruction, relative to the start of the function.
+     */
+    ZyanUSize offset;
+    /**
+     * The runtime address of the affected instruction.
+     */
+    ZyanU64 address;
+    /**
+     * The mnemonic of the affected instruction.
+     */
+    ZydisMnemonic mnemonic;
+} ZydisAvxTransitionHazard;
+
+/**
+ * Defines the `ZydisAvxTransitionCallback` function prototype.
+ *
+ * @param   hazard      A pointer to the `ZydisAvxTransitionHazard` struct.
+ * @param   user_data   A pointer to user-defined data.
+ *
+ * @return  A zyan status code.
+ *
+ * Returning a status code other than `ZYAN_STATUS_SUCCESS` stops the analysis and passes the
+ * status code to the caller.
+ */
+typedef ZyanStatus (*ZydisAvxTransitionCallback)(const ZydisAvxTransitionHazard* hazard,
+    void* user_data);
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Returns the size of the workspace required to analyze a function of the given length.
+ *
+ * @param   length  The length of the function in bytes.
+ * @param   size    Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisAvxTransitionGetWorkspaceSize(ZyanUSize length, ZyanUSize* size);
+
+/**
+ * Analyzes a single function for AVX/SSE transition penalties.
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance. The decoder must not use
+ *                          `ZYDIS_DECODER_MODE_MINIMAL`.
+ * @param   buffer          A pointer to the code of the function. The entry point is expected at
+ *                          the first byte.
+ * @param   length          The length of the function in bytes.
+ * @param   runtime_address The runtime address of the first byte.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 4
+ *                          bytes.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisAvxTransitionGetWorkspaceSize`.
+ * @param   callback        The callback that is invoked for every hazard.
+ * @param   user_data       A pointer to user-defined data passed to the callback.
+ *
+ * @return  A zyan status code.
+ *
+ * The control-flow graph is recovered by following relative branches that stay inside the
+ * function. The upper state is assumed to be clean at the entry point. Instructions that write a
+ * `YMM` or `ZMM` register mark it dirty, `vzeroupper` and `vzeroall` mark it clean. A join point is
+ * considered dirty, if any of its predecessors is. Calls do not change the state.
+ *
+ * Hazards are reported in ascending address order, at most once per instruction and type.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisAvxTransitionAnalyze(const ZydisDecoder* decoder,
+    const void* buffer, ZyanUSize length, ZyanU64 runtime_address, void* workspace,
+    ZyanUSize workspace_size, ZydisAvxTransitionCallback callback, void* user_data);
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_AVX_TRANSITION_H */
@@ -0,0 +1,287 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for mapping between code offsets and instruction indices using a succinct bitmap.
+ */
+
+#ifndef ZYDIS_BOUNDARYBITMAP_H
+#define ZYDIS_BOUNDARYBITMAP_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup boundarybitmap Boundary bitmap
+ * Functions for mapping between code offsets and instruction indices using a succinct bitmap.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The number of bits covered by a single rank superblock.
+ */
+#define ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_BITS 512
+
+/**
+ * The base 2 logarithm of the number of instructions between two select samples.
+ */
+#define ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT 10
+
+/**
+ * The size of the header of the serialized form in bytes.
+ */
+#define ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE 24
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisBoundaryBitmap` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ *
+ * The bitmap uses one bit per code byte. Every 512-bit superblock stores the absolute number of
+ * instruction starts in front of it (32 bits) and the relative counts in front of each of its
+ * words (7 * 9 bits), which adds 0.1875 bits per code byte. The offset of every 1024th
+ * instruction is sampled to speed up select queries.
+ */
+typedef struct ZydisBoundaryBitmap_
+{
+    /**
+     * The length of the code.
+     */
+    ZyanU32 length;
+    /**
+     * The number of instruction starts.
+     */
+    ZyanU32 count;
+    /**
+     * One bit per code byte, set at the start of every instruction.
+     */
+    ZyanU64* bits;
+    /**
+     * The packed relative counts of every superblock.
+     */
+    ZyanU64* relative;
+    /**
+     * The number of instruction starts in front of every superblock.
+     */
+    ZyanU32* absolute;
+    /**
+     * The superblock containing every `2^ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT`-th instruction start.
+     */
+    ZyanU32* samples;
+} ZydisBoundaryBitmap;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Construction                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the size of the workspace required for a `ZydisBoundaryBitmap`.
+ *
+ * @param   length  The length of the code.
+ * @param   size    Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapGetWorkspaceSize(ZyanUSize length, ZyanUSize* size);
+
+/**
+ * Builds the boundary bitmap of the given code using a linear sweep.
+ *
+ * @param   bitmap          A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   decoder         A pointer to the `ZydisDecoder` instance.
+ * @param   buffer          A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 8
+ *                          bytes and must stay valid for the lifetime of the bitmap.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisBoundaryBitmapGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ *
+ * Bytes that can not be decoded are skipped one at a time and are not considered instruction
+ * starts. The decoder should be in minimal mode for best performance.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapBuild(ZydisBoundaryBitmap* bitmap,
+    const ZydisDecoder* decoder, const void* buffer, ZyanUSize length, void* workspace,
+    ZyanUSize workspace_size);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Queries                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of instructions in the given bitmap.
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   count   Receives the number of instructions.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapGetCount(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize* count);
+
+/**
+ * Checks if an instruction starts at the given offset.
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   offset  The offset, relative to the start of the code.
+ *
+ * @return  `ZYAN_STATUS_TRUE`, if an instruction starts at the given offset, `ZYAN_STATUS_FALSE`,
+ *          if not, or another zyan status code, if an error occured.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapIsBoundary(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize offset);
+
+/**
+ * Returns the index of the instruction that starts at or in front of the given offset (rank).
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   offset  The offset, relative to the start of the code.
+ * @param   index   Receives the instruction index.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_NOT_FOUND` is returned, if no instruction starts at or
+ *          in front of the given offset.
+ *
+ * The query takes constant time: one superblock lookup and a single popcount.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapOffsetToIndex(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize offset, ZyanUSize* index);
+
+/**
+ * Returns the offset of the instruction with the given index (select).
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   index   The instruction index.
+ * @param   offset  Receives the offset, relative to the start of the code.
+ *
+ * @return  A zyan status code.
+ *
+ * The sampled superblock narrows the search down to the superblocks spanned by 1024 instructions,
+ * followed by a binary search over them and a constant number of popcounts.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapIndexToOffset(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize index, ZyanUSize* offset);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Serialization                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the size of the serialized form of the given bitmap.
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   size    Receives the size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapGetSerializedSize(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize* size);
+
+/**
+ * Serializes the given bitmap.
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   buffer  A pointer to the output buffer.
+ * @param   length  A pointer to the variable containing the length of the output buffer. Upon
+ *                  successful return this variable receives the length of the serialized form.
+ *
+ * @return  A zyan status code.
+ *
+ * The serialized form consists of a `ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE` byte header (magic
+ * `ZBBM`, version, code length and instruction count) followed by the raw bitmap in little-endian
+ * byte order. The rank and select tables are not stored, as they are rebuilt in a single pass
+ * when the bitmap is deserialized.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapSerialize(const ZydisBoundaryBitmap* bitmap,
+    void* buffer, ZyanUSize* length);
+
+/**
+ * Returns the code length stored in a serialized bitmap.
+ *
+ * @param   buffer      A pointer to the serialized form.
+ * @param   length      The length of the serialized form.
+ * @param   code_length Receives the code length, which can be passed to
+ *                      `ZydisBoundaryBitmapGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapGetSerializedCodeLength(const void* buffer,
+    ZyanUSize length, ZyanUSize* code_length);
+
+/**
+ * Restores a bitmap from its serialized form.
+ *
+ * @param   bitmap          A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   buffer          A pointer to the serialized form.
+ * @param   length          The length of the serialized form.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 8
+ *                          bytes and must stay valid for the lifetime of the bitmap.
+ * @param   workspace_size  The size of the workspace in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisBoundaryBitmapDeserialize(ZydisBoundaryBitmap* bitmap,
+    const void* buffer, ZyanUSize length, void* workspace, ZyanUSize workspace_size);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_BOUNDARYBITMAP_H */
@@ -0,0 +1,275 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for managing executable memory for code generated with the encoder.
+ */
+
+#ifndef ZYDIS_CODEBUFFER_H
+#define ZYDIS_CODEBUFFER_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Encoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup codebuffer Code buffer
+ * Functions for managing executable memory for code generated with the encoder.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The default size of a single region in bytes.
+ */
+#define ZYDIS_CODE_BUFFER_DEFAULT_REGION_SIZE   (1024 * 1024)
+
+/**
+ * The base 2 logarithm of the size of the smallest size class.
+ */
+#define ZYDIS_CODE_BUFFER_MIN_SIZE_CLASS_SHIFT  6
+
+/**
+ * The number of size classes.
+ */
+#define ZYDIS_CODE_BUFFER_SIZE_CLASS_COUNT      26
+
+/**
+ * The byte used to fill unused and freed code memory (`int3`).
+ */
+#define ZYDIS_CODE_BUFFER_FILL_BYTE             0xCC
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisCodeRegion` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisCodeRegion_
+{
+    /**
+     * The next region.
+     */
+    struct ZydisCodeRegion_* next;
+    /**
+     * The writable view of the region.
+     */
+    ZyanU8* writable;
+    /**
+     * The executable view of the region.
+     */
+    ZyanU8* executable;
+    /**
+     * The size of the region in bytes.
+     */
+    ZyanUSize size;
+    /**
+     * The number of bytes handed out by the bump allocator.
+     */
+    ZyanUSize used;
+} ZydisCodeRegion;
+
+/**
+ * Defines the `ZydisCodeBuffer` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisCodeBuffer_
+{
+    /**
+     * The size of newly created regions in bytes.
+     */
+    ZyanUSize region_size;
+    /**
+     * The list of regions. The first region is the one used by the bump allocator.
+     */
+    ZydisCodeRegion* regions;
+    /**
+     * The writable views of the first free slot of every size class.
+     */
+    ZyanU8* free_lists[ZYDIS_CODE_BUFFER_SIZE_CLASS_COUNT];
+} ZydisCodeBuffer;
+
+/**
+ * Defines the `ZydisCodeSlot` struct.
+ *
+ * A slot is a contiguous piece of code memory that is visible at two different addresses: the
+ * writable view is used to emit code, the executable view is used to run it.
+ */
+typedef struct ZydisCodeSlot_
+{
+    /**
+     * The writable view of the slot.
+     */
+    ZyanU8* writable;
+    /**
+     * The executable view of the slot.
+     */
+    const ZyanU8* executable;
+    /**
+     * The size of the slot in bytes.
+     */
+    ZyanUSize size;
+    /**
+     * The number of bytes emitted into the slot.
+     */
+    ZyanUSize length;
+} ZydisCodeSlot;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Code buffer                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisCodeBuffer` instance.
+ *
+ * @param   buffer      A pointer to the `ZydisCodeBuffer` instance.
+ * @param   region_size The size of every region in bytes, or `0` to use
+ *                      `ZYDIS_CODE_BUFFER_DEFAULT_REGION_SIZE`. The size is rounded up to a
+ *                      multiple of the page size.
+ *
+ * @return  A zyan status code.
+ *
+ * Regions are created lazily. Every region is backed by an anonymous `memfd` that is mapped
+ * twice: once read/write for the encoder and once read/execute for running the code. Neither view
+ * is ever remapped or reprotected, so emitting code does not require any system calls after the
+ * region has been created.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeBufferInit(ZydisCodeBuffer* buffer, ZyanUSize region_size);
+
+/**
+ * Releases all regions of the given `ZydisCodeBuffer` instance.
+ *
+ * @param   buffer  A pointer to the `ZydisCodeBuffer` instance.
+ *
+ * @return  A zyan status code.
+ *
+ * All slots allocated from the code buffer become invalid.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeBufferDestroy(ZydisCodeBuffer* buffer);
+
+/**
+ * Allocates a new slot from the given `ZydisCodeBuffer` instance.
+ *
+ * @param   buffer  A pointer to the `ZydisCodeBuffer` instance.
+ * @param   size    The minimum size of the slot in bytes.
+ * @param   slot    Receives the slot.
+ *
+ * @return  A zyan status code.
+ *
+ * The size is rounded up to the next power of two, but at least
+ * `2^ZYDIS_CODE_BUFFER_MIN_SIZE_CLASS_SHIFT` bytes. Slots are aligned to the smallest size class
+ * and filled with `ZYDIS_CODE_BUFFER_FILL_BYTE`. Previously freed slots of the same size class are
+ * reused before new memory is taken from the current region. When the current region is full, its
+ * remaining tail is split into free slots before a new region is created.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeBufferAllocate(ZydisCodeBuffer* buffer, ZyanUSize size,
+    ZydisCodeSlot* slot);
+
+/**
+ * Returns the given slot to its `ZydisCodeBuffer` instance.
+ *
+ * @param   buffer  A pointer to the `ZydisCodeBuffer` instance.
+ * @param   slot    A pointer to the `ZydisCodeSlot` struct.
+ *
+ * @return  A zyan status code.
+ *
+ * The slot is filled with `ZYDIS_CODE_BUFFER_FILL_BYTE`. The caller is responsible for making
+ * sure that no thread is still executing code in the slot.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeBufferFree(ZydisCodeBuffer* buffer, const ZydisCodeSlot* slot);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Code slot                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Encodes an instruction at the end of the given slot.
+ *
+ * @param   slot    A pointer to the `ZydisCodeSlot` struct.
+ * @param   request A pointer to the `ZydisEncoderRequest` struct.
+ *
+ * @return  A zyan status code.
+ *
+ * The instruction is written to the writable view, while relative operands are resolved against
+ * the executable view using `ZydisEncoderEncodeInstructionAbsolute`. Absolute branch targets in
+ * the request should therefore always refer to executable addresses.
+ *
+ * Writes through the writable view are coherent with instruction fetches from the executable
+ * view on x86. Other threads must execute a serializing instruction before running code that was
+ * emitted after they last entered the slot.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeSlotEmit(ZydisCodeSlot* slot, ZydisEncoderRequest* request);
+
+/**
+ * Returns the executable address of the given offset inside of the slot.
+ *
+ * @param   slot    A pointer to the `ZydisCodeSlot` struct.
+ * @param   offset  The offset relative to the start of the slot.
+ * @param   address Receives the runtime address.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisCodeSlotGetRuntimeAddress(const ZydisCodeSlot* slot,
+    ZyanUSize offset, ZyanU64* address);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_CODEBUFFER_H */
@@ -0,0 +1,350 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for decoding instruction streams into columnar arrays and exporting them as Apache
+ * Arrow IPC files.
+ */
+
+#ifndef ZYDIS_COLUMNAR_H
+#define ZYDIS_COLUMNAR_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup columnar Columnar export
+ * Functions for decoding instruction streams into columnar arrays and exporting them as Apache
+ * Arrow IPC files.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The number of operands stored per instruction.
+ */
+#define ZYDIS_COLUMNAR_OPERAND_COUNT    ZYDIS_MAX_OPERAND_COUNT_VISIBLE
+
+/**
+ * The number of dictionaries written to an Arrow file.
+ */
+#define ZYDIS_ARROW_DICTIONARY_COUNT    5
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Columnar batch                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisColumnarBatch` struct.
+ *
+ * Each column stores one value per instruction. Enum columns (mnemonic, category, ISA set,
+ * operand types and registers) store the raw enum values, which double as indices into the
+ * dictionaries of the Arrow file. The operand columns store `ZYDIS_COLUMNAR_OPERAND_COUNT`
+ * consecutive values per instruction.
+ *
+ * Undecodable bytes are stored as single-byte instructions with the `ZYDIS_MNEMONIC_INVALID`
+ * mnemonic.
+ */
+typedef struct ZydisColumnarBatch_
+{
+    /**
+     * The maximum number of instructions.
+     */
+    ZyanUSize capacity;
+    /**
+     * The number of instructions.
+     */
+    ZyanUSize count;
+    /**
+     * The offset of each instruction, relative to the start of the buffer.
+     */
+    ZyanU64* offset;
+    /**
+     * The length of each instruction.
+     */
+    ZyanU8* length;
+    /**
+     * The `ZydisMnemonic` of each instruction.
+     */
+    ZyanU16* mnemonic;
+    /**
+     * The `ZydisInstructionCategory` of each instruction.
+     */
+    ZyanU8* category;
+    /**
+     * The `ZydisISASet` of each instruction.
+     */
+    ZyanU16* isa_set;
+    /**
+     * The number of visible operands of each instruction.
+     */
+    ZyanU8* operand_count;
+    /**
+     * The `ZydisOperandType` of each operand. Missing operands are `ZYDIS_OPERAND_TYPE_UNUSED`.
+     */
+    ZyanU8* operand_type;
+    /**
+     * The `ZydisRegister` of each register operand. All other operands are
+     * `ZYDIS_REGISTER_NONE`.
+     */
+    ZyanU16* operand_register;
+    /**
+     * The value of the first immediate operand or `0`.
+     */
+    ZyanI64* immediate;
+    /**
+     * The base `ZydisRegister` of the first memory operand or `ZYDIS_REGISTER_NONE`.
+     */
+    ZyanU16* memory_base;
+    /**
+     * The index `ZydisRegister` of the first memory operand or `ZYDIS_REGISTER_NONE`.
+     */
+    ZyanU16* memory_index;
+    /**
+     * The scale factor of the first memory operand or `0`.
+     */
+    ZyanU8* memory_scale;
+    /**
+     * The displacement of the first memory operand or `0`.
+     */
+    ZyanI64* memory_displacement;
+} ZydisColumnarBatch;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow writer                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisArrowWriteFunc` function prototype.
+ *
+ * @param   user_data   User-defined data passed to `ZydisArrowWriterInit`.
+ * @param   data        A pointer to the data.
+ * @param   length      The length of the data.
+ *
+ * @return  A zyan status code.
+ *
+ * The function has to write all of the given data.
+ */
+typedef ZyanStatus (*ZydisArrowWriteFunc)(void* user_data, const void* data, ZyanUSize length);
+
+/**
+ * Defines the `ZydisArrowBlock` struct.
+ *
+ * Locates a message in the Arrow file.
+ */
+typedef struct ZydisArrowBlock_
+{
+    /**
+     * The file offset of the message.
+     */
+    ZyanU64 offset;
+    /**
+     * The length of the message metadata, including the prefix and padding.
+     */
+    ZyanU32 metadata_length;
+    /**
+     * The length of the message body.
+     */
+    ZyanU64 body_length;
+} ZydisArrowBlock;
+
+/**
+ * Defines the `ZydisArrowWriter` struct.
+ *
+ * All fields are considered private and should not be accessed directly.
+ */
+typedef struct ZydisArrowWriter_
+{
+    /**
+     * The write function.
+     */
+    ZydisArrowWriteFunc write;
+    /**
+     * User-defined data passed to the write function.
+     */
+    void* user_data;
+    /**
+     * The number of bytes written so far.
+     */
+    ZyanU64 position;
+    /**
+     * The blocks of the dictionary batches.
+     */
+    ZydisArrowBlock dictionaries[ZYDIS_ARROW_DICTIONARY_COUNT];
+    /**
+     * The blocks of the record batches.
+     */
+    ZydisArrowBlock* batches;
+    /**
+     * The maximum number of record batches.
+     */
+    ZyanUSize batch_capacity;
+    /**
+     * The number of record batches.
+     */
+    ZyanUSize batch_count;
+} ZydisArrowWriter;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Columnar batch                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the size of the workspace required for a `ZydisColumnarBatch`.
+ *
+ * @param   capacity    The maximum number of instructions.
+ * @param   size        Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisColumnarGetWorkspaceSize(ZyanUSize capacity, ZyanUSize* size);
+
+/**
+ * Initializes the given `ZydisColumnarBatch` instance.
+ *
+ * @param   batch           A pointer to the `ZydisColumnarBatch` instance.
+ * @param   capacity        The maximum number of instructions.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 8
+ *                          bytes and must stay valid for the lifetime of the batch.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisColumnarGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisColumnarBatchInit(ZydisColumnarBatch* batch, ZyanUSize capacity,
+    void* workspace, ZyanUSize workspace_size);
+
+/**
+ * Decodes a range of instructions and appends them to the given batch.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance.
+ * @param   buffer  A pointer to the code.
+ * @param   length  The length of the code.
+ * @param   begin   The offset of the first instruction to decode.
+ * @param   end     The offset at which decoding stops. The last instruction may extend past it.
+ * @param   batch   A pointer to the `ZydisColumnarBatch` instance.
+ * @param   next    Receives the offset following the last decoded instruction. Can be
+ *                  `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ *
+ * Decoding also stops, if the batch is full. In this case `next` is less than `end` and the
+ * remaining instructions can be decoded into another batch. Since every call only writes to its
+ * own batch, multiple threads can decode different ranges of the same code concurrently.
+ *
+ * Decoders in `ZYDIS_DECODER_MODE_MINIMAL` are rejected, as they do not decode operands.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisColumnarDecode(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanUSize begin, ZyanUSize end, ZydisColumnarBatch* batch,
+    ZyanUSize* next);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow writer                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisArrowWriter` instance and writes the file header, the schema and
+ * the dictionaries.
+ *
+ * @param   writer          A pointer to the `ZydisArrowWriter` instance.
+ * @param   write           The write function.
+ * @param   user_data       User-defined data passed to the write function. Can be `ZYAN_NULL`.
+ * @param   batches         An array that receives the locations of the record batches. It must
+ *                          stay valid until `ZydisArrowWriterFinish` returns.
+ * @param   batch_capacity  The length of the `batches` array.
+ *
+ * @return  A zyan status code.
+ *
+ * Mnemonics, categories, ISA sets, operand types and registers are dictionary-encoded. The
+ * dictionaries contain the strings of all values of the respective enum, e.g. as returned by
+ * `ZydisMnemonicGetString` or `ZydisRegisterGetString`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisArrowWriterInit(ZydisArrowWriter* writer, ZydisArrowWriteFunc write,
+    void* user_data, ZydisArrowBlock* batches, ZyanUSize batch_capacity);
+
+/**
+ * Writes a range of instructions of the given batch as a record batch.
+ *
+ * @param   writer  A pointer to the `ZydisArrowWriter` instance.
+ * @param   batch   A pointer to the `ZydisColumnarBatch` instance.
+ * @param   first   The index of the first instruction.
+ * @param   count   The number of instructions.
+ *
+ * @return  A zyan status code.
+ *
+ * The column arrays are written as they are, without copying them. As Arrow requires
+ * little-endian data in files that declare little-endian byte order, this function should only be
+ * used on little-endian hosts.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisArrowWriterWriteBatch(ZydisArrowWriter* writer,
+    const ZydisColumnarBatch* batch, ZyanUSize first, ZyanUSize count);
+
+/**
+ * Writes the file footer.
+ *
+ * @param   writer  A pointer to the `ZydisArrowWriter` instance.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisArrowWriterFinish(ZydisArrowWriter* writer);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_COLUMNAR_H */
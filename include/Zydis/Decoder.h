@@ -153,17 +153,49 @@ typedef enum ZydisDecoderMode_
      * This mode is disabled by default.
      */
     ZYDIS_DECODER_MODE_UD0_COMPAT,
+    /**
+     * Enables the trusted-input mode.
+     *
+     * In this mode the decoder skips the semantic validity checks that are performed after an
+     * instruction definition was found (e.g. `LOCK` acceptance, register-kind and register-id
+     * constraints, gather register overlap, EVEX zero-masking and mask policies). Use this mode
+     * only for code that is known to be valid, e.g. because it was emitted by your own code
+     * generator or previously decoded without this mode.
+     *
+     * Malformed input might decode to an unspecified instruction (or an instruction with
+     * unspecified operands) instead of returning an error status. The decoder never reads or
+     * writes out of bounds in this mode.
+     *
+     * This mode is disabled by default.
+     */
+    ZYDIS_DECODER_MODE_TRUSTED_INPUT,
 
     /**
      * Maximum value of this enum.
      */
-    ZYDIS_DECODER_MODE_MAX_VALUE = ZYDIS_DECODER_MODE_UD0_COMPAT,
+    ZYDIS_DECODER_MODE_MAX_VALUE = ZYDIS_DECODER_MODE_TRUSTED_INPUT,
     /**
      * The minimum number of bits required to represent all values of this enum.
      */
     ZYDIS_DECODER_MODE_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_DECODER_MODE_MAX_VALUE)
 } ZydisDecoderMode;
 
+/* ---------------------------------------------------------------------------------------------- */
+/* Decoder cache                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisDecoderCache` struct.
+ *
+ * The cache contains a fully decoded instruction template for every first opcode byte that forms
+ * an instruction without prefixes, `ModRM` and displacement. Such instructions are decoded by
+ * copying the template and patching the immediate values, skipping the regular decoding path.
+ *
+ * The layout of this struct is internal. Use `ZydisDecoderGetCacheSize` and
+ * `ZydisDecoderInitCache` to create a cache in memory provided by the caller.
+ */
+typedef struct ZydisDecoderCache_ ZydisDecoderCache;
+
 /* ---------------------------------------------------------------------------------------------- */
 /* Decoder struct                                                                                 */
 /* ---------------------------------------------------------------------------------------------- */
@@ -226,6 +258,33 @@ ZYDIS_EXPORT ZyanStatus ZydisDecoderInit(ZydisDecoder* decoder, ZydisMachineMode
 ZYDIS_EXPORT ZyanStatus ZydisDecoderEnableMode(ZydisDecoder* decoder, ZydisDecoderMode mode,
     ZyanBool enabled);
 
+/**
+ * Returns the size of the memory required for a decoder cache.
+ *
+ * @param   size    Receives the size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisDecoderGetCacheSize(ZyanUSize* size);
+
+/**
+ * Builds a decoder cache for the given decoder.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance.
+ * @param   memory  A pointer to the memory that receives the cache. The memory must be aligned to
+ *                  8 bytes and must stay valid for the lifetime of the cache.
+ * @param   size    The size of the memory in bytes, as returned by `ZydisDecoderGetCacheSize`.
+ * @param   cache   Receives a pointer to the `ZydisDecoderCache` instance inside of `memory`.
+ *
+ * @return  A zyan status code.
+ *
+ * The cache is built by running the regular decoding path for the machine mode, stack width and
+ * decoder modes of the given decoder. The decoder is copied, so later changes to it do not affect
+ * the cache.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisDecoderInitCache(const ZydisDecoder* decoder, void* memory,
+    ZyanUSize size, ZydisDecoderCache** cache);
+
 /**
  * Decodes the instruction in the given input `buffer` and returns all details (e.g. operands).
  *
@@ -279,6 +338,27 @@ ZYDIS_EXPORT ZyanStatus ZydisDecoderDecodeInstruction(const ZydisDecoder* decode
     ZydisDecoderContext* context, const void* buffer, ZyanUSize length,
     ZydisDecodedInstruction* instruction);
 
+/**
+ * Decodes the instruction in the given input `buffer` using the given decoder cache.
+ *
+ * @param   cache       A pointer to the `ZydisDecoderCache` instance.
+ * @param   context     A pointer to a decoder context struct which is required for further
+ *                      decoding (e.g. operand decoding using `ZydisDecoderDecodeOperands`) or
+ *                      `ZYAN_NULL` if not needed.
+ * @param   buffer      A pointer to the input buffer.
+ * @param   length      The length of the input buffer.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct, that receives the
+ *                      details about the decoded instruction.
+ *
+ * @return  A zyan status code.
+ *
+ * Decoding results are bit-identical to `ZydisDecoderDecodeInstruction` with the decoder the
+ * cache was built for. Instructions that are not cached take the regular decoding path.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisDecoderDecodeInstructionCached(const ZydisDecoderCache* cache,
+    ZydisDecoderContext* context, const void* buffer, ZyanUSize length,
+    ZydisDecodedInstruction* instruction);
+
 /**
  * Decodes the instruction operands.
  *
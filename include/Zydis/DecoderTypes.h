@@ -42,6 +42,23 @@
 extern "C" {
 #endif
 
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * Declares the type of an enum field in the decoded instruction and operand structs.
+ *
+ * When building with `ZYDIS_PACKED_TYPES`, the field is stored as the given fixed-width integer
+ * type instead of the (`int` sized) enum type. The storage type is wide enough to hold the
+ * `*_REQUIRED_BITS` of the respective enum, which is verified at compile time.
+ */
+#ifdef ZYDIS_PACKED_TYPES
+#   define ZYDIS_ENUM_FIELD(enum_type, storage_type) storage_type
+#else
+#   define ZYDIS_ENUM_FIELD(enum_type, storage_type) enum_type
+#endif
+
 /* ============================================================================================== */
 /* Decoded operand                                                                                */
 /* ============================================================================================== */
@@ -116,7 +133,7 @@ typedef struct ZydisDecodedOperandReg_
     /**
      * The register value.
      */
-    ZydisRegister value;
+    ZYDIS_ENUM_FIELD(ZydisRegister, ZyanU16) value;
 } ZydisDecodedOperandReg;
 
 /**
@@ -127,19 +144,19 @@ typedef struct ZydisDecodedOperandMem_
     /**
      * The type of the memory operand.
      */
-    ZydisMemoryOperandType type;
+    ZYDIS_ENUM_FIELD(ZydisMemoryOperandType, ZyanU8) type;
     /**
      * The segment register.
      */
-    ZydisRegister segment;
+    ZYDIS_ENUM_FIELD(ZydisRegister, ZyanU16) segment;
     /**
      * The base register.
      */
-    ZydisRegister base;
+    ZYDIS_ENUM_FIELD(ZydisRegister, ZyanU16) base;
     /**
      * The index register.
      */
-    ZydisRegister index;
+    ZYDIS_ENUM_FIELD(ZydisRegister, ZyanU16) index;
     /**
      * The scale factor.
      */
@@ -219,7 +236,7 @@ typedef struct ZydisDecodedOperand_
     /**
      * The visibility of the operand.
      */
-    ZydisOperandVisibility visibility;
+    ZYDIS_ENUM_FIELD(ZydisOperandVisibility, ZyanU8) visibility;
     /**
      * The operand-actions.
      */
@@ -227,7 +244,7 @@ typedef struct ZydisDecodedOperand_
     /**
      * The operand-encoding.
      */
-    ZydisOperandEncoding encoding;
+    ZYDIS_ENUM_FIELD(ZydisOperandEncoding, ZyanU8) encoding;
     /**
      * The logical size of the operand (in bits).
      */
@@ -235,7 +252,7 @@ typedef struct ZydisDecodedOperand_
     /**
      * The element-type.
      */
-    ZydisElementType element_type;
+    ZYDIS_ENUM_FIELD(ZydisElementType, ZyanU8) element_type;
     /**
      * The size of a single element.
      */
@@ -251,7 +268,7 @@ typedef struct ZydisDecodedOperand_
     /**
      * The type of the operand.
      */
-    ZydisOperandType type;
+    ZYDIS_ENUM_FIELD(ZydisOperandType, ZyanU8) type;
     /*
      * Operand type specific information.
      *
@@ -1009,11 +1026,11 @@ typedef struct ZydisDecodedInstructionAvx_
         /**
          * The masking mode.
          */
-        ZydisMaskMode mode;
+        ZYDIS_ENUM_FIELD(ZydisMaskMode, ZyanU8) mode;
         /**
          * The mask register.
          */
-        ZydisRegister reg;
+        ZYDIS_ENUM_FIELD(ZydisRegister, ZyanU16) reg;
     } mask;
     /**
      * Contains info about the `AVX` broadcast.
@@ -1030,7 +1047,7 @@ typedef struct ZydisDecodedInstructionAvx_
         /**
          * The `AVX` broadcast-mode.
          */
-        ZydisBroadcastMode mode;
+        ZYDIS_ENUM_FIELD(ZydisBroadcastMode, ZyanU8) mode;
     } broadcast;
     /**
      * Contains info about the `AVX` rounding.
@@ -1040,7 +1057,7 @@ typedef struct ZydisDecodedInstructionAvx_
         /**
          * The `AVX` rounding-mode.
          */
-        ZydisRoundingMode mode;
+        ZYDIS_ENUM_FIELD(ZydisRoundingMode, ZyanU8) mode;
     } rounding;
     /**
      * Contains info about the `AVX` register-swizzle (`KNC` only).
@@ -1050,7 +1067,7 @@ typedef struct ZydisDecodedInstructionAvx_
         /**
          * The `AVX` register-swizzle mode.
          */
-        ZydisSwizzleMode mode;
+        ZYDIS_ENUM_FIELD(ZydisSwizzleMode, ZyanU8) mode;
     } swizzle;
     /**
      * Contains info about the `AVX` data-conversion (`KNC` only).
@@ -1060,7 +1077,7 @@ typedef struct ZydisDecodedInstructionAvx_
         /**
          * The `AVX` data-conversion mode.
          */
-        ZydisConversionMode mode;
+        ZYDIS_ENUM_FIELD(ZydisConversionMode, ZyanU8) mode;
     } conversion;
     /**
      * Signals, if the `SAE` (suppress-all-exceptions) functionality is
@@ -1082,23 +1099,23 @@ typedef struct ZydisDecodedInstructionMeta_
     /**
      * The instruction category.
      */
-    ZydisInstructionCategory category;
+    ZYDIS_ENUM_FIELD(ZydisInstructionCategory, ZyanU8) category;
     /**
      * The ISA-set.
      */
-    ZydisISASet isa_set;
+    ZYDIS_ENUM_FIELD(ZydisISASet, ZyanU8) isa_set;
     /**
      * The ISA-set extension.
      */
-    ZydisISAExt isa_ext;
+    ZYDIS_ENUM_FIELD(ZydisISAExt, ZyanU8) isa_ext;
     /**
      * The branch type.
      */
-    ZydisBranchType branch_type;
+    ZYDIS_ENUM_FIELD(ZydisBranchType, ZyanU8) branch_type;
     /**
      * The exception class.
      */
-    ZydisExceptionClass exception_class;
+    ZYDIS_ENUM_FIELD(ZydisExceptionClass, ZyanU8) exception_class;
 } ZydisDecodedInstructionMeta;
 
 /**
@@ -1119,7 +1136,7 @@ typedef struct ZydisDecodedInstructionRaw_
         /**
          * The prefix type.
          */
-        ZydisPrefixType type;
+        ZYDIS_ENUM_FIELD(ZydisPrefixType, ZyanU8) type;
         /**
          * The prefix byte.
          */
@@ -1132,7 +1149,7 @@ typedef struct ZydisDecodedInstructionRaw_
      * This is here to allow the Rust bindings to treat the following union as an `enum`,
      * sparing us a lot of unsafe code. Prefer using the regular `encoding` field in C/C++ code.
      */
-    ZydisInstructionEncoding encoding2;
+    ZYDIS_ENUM_FIELD(ZydisInstructionEncoding, ZyanU8) encoding2;
     /*
      * Union for things from various mutually exclusive encodings.
      */
@@ -1253,11 +1270,11 @@ typedef struct ZydisDecodedInstruction_
     /**
      * The machine mode used to decode this instruction.
      */
-    ZydisMachineMode machine_mode;
+    ZYDIS_ENUM_FIELD(ZydisMachineMode, ZyanU8) machine_mode;
     /**
      * The instruction-mnemonic.
      */
-    ZydisMnemonic mnemonic;
+    ZYDIS_ENUM_FIELD(ZydisMnemonic, ZyanU16) mnemonic;
     /**
      * The length of the decoded instruction.
      */
@@ -1265,11 +1282,11 @@ typedef struct ZydisDecodedInstruction_
     /**
      * The instruction-encoding (`LEGACY`, `3DNOW`, `VEX`, `EVEX`, `XOP`).
      */
-    ZydisInstructionEncoding encoding;
+    ZYDIS_ENUM_FIELD(ZydisInstructionEncoding, ZyanU8) encoding;
     /**
      * The opcode-map.
      */
-    ZydisOpcodeMap opcode_map;
+    ZYDIS_ENUM_FIELD(ZydisOpcodeMap, ZyanU8) opcode_map;
     /**
      * The instruction-opcode.
      */
@@ -126,6 +126,40 @@ ZYDIS_EXPORT ZyanStatus ZydisDisassembleATT(ZydisMachineMode machine_mode,
     ZyanU64 runtime_address, const void* buffer, ZyanUSize length,
     ZydisDisassembledInstruction *instruction);
 
+/**
+ * Decodes an instruction and formats it to human-readable text in a single call, using the given
+ * decoder and formatter.
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance.
+ * @param   formatter       A pointer to the `ZydisFormatter` instance.
+ * @param   runtime_address The runtime address of the instruction or `ZYDIS_RUNTIME_ADDRESS_NONE`
+ *                          to print relative addresses.
+ * @param   buffer          A pointer to the input buffer.
+ * @param   length          The length of the input buffer.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct that receives the
+ *                          decoded instruction.
+ * @param   text            A pointer to the output buffer.
+ * @param   text_length     The length of the output buffer (in characters).
+ * @param   user_data       A pointer to user-defined data which can be used in custom formatter
+ *                          callbacks. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_INVALID_ARGUMENT` is returned for decoders in
+ *          `ZYDIS_DECODER_MODE_MINIMAL`, as they do not decode operands.
+ *
+ * This is a convenience function with the same output as calling
+ * `ZydisDecoderDecodeInstruction`, `ZydisDecoderDecodeOperands` and
+ * `ZydisFormatterFormatInstruction`. The formatter still works on `ZydisDecodedOperand` structs,
+ * but only the visible operands are decoded and their operand-actions and element information
+ * are not computed. Custom formatter callbacks receive these fields zeroed.
+ *
+ * Unlike `ZydisDisassembleIntel` and `ZydisDisassembleATT`, this function reuses the given
+ * decoder and formatter, which makes it suitable for disassembling large amounts of code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisDisassembleFormat(const ZydisDecoder* decoder,
+    const ZydisFormatter* formatter, ZyanU64 runtime_address, const void* buffer,
+    ZyanUSize length, ZydisDecodedInstruction* instruction, char* text, ZyanUSize text_length,
+    void* user_data);
+
 /* ============================================================================================== */
 
 #ifdef __cplusplus
@@ -0,0 +1,183 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for auditing indirect branch tracking (`CET` `IBT`) landing pads.
+ */
+
+#ifndef ZYDIS_IBT_H
+#define ZYDIS_IBT_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup ibt Indirect branch tracking
+ * Functions for collecting code references and verifying `IBT` landing pads.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisIbtReferenceType` enum.
+ */
+typedef enum ZydisIbtReferenceType_
+{
+    /**
+     * A direct relative call.
+     */
+    ZYDIS_IBT_REFERENCE_CALL,
+    /**
+     * A direct relative jump.
+     */
+    ZYDIS_IBT_REFERENCE_JUMP,
+    /**
+     * An address materialized by a `RIP`-relative `lea`.
+     */
+    ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS,
+    /**
+     * An absolute address materialized by a `mov` or `push` immediate or a `lea` without base and
+     * index register.
+     *
+     * These are only meaningful in position-dependent code. In position-independent code, they
+     * are usually plain constants.
+     */
+    ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS,
+    /**
+     * An indirect jump. The `target` field receives the displacement of memory operands without
+     * base register (usually the address of a jump table) or `0`.
+     */
+    ZYDIS_IBT_REFERENCE_INDIRECT_JUMP,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_IBT_REFERENCE_MAX_VALUE = ZYDIS_IBT_REFERENCE_INDIRECT_JUMP,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_IBT_REFERENCE_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_IBT_REFERENCE_MAX_VALUE)
+} ZydisIbtReferenceType;
+
+/**
+ * Describes a single code reference.
+ */
+typedef struct ZydisIbtReference_
+{
+    /**
+     * The reference type.
+     */
+    ZydisIbtReferenceType type;
+    /**
+     * The runtime address of the referencing instruction.
+     */
+    ZyanU64 source;
+    /**
+     * The referenced runtime address.
+     */
+    ZyanU64 target;
+    /**
+     * Signals, if an indirect jump carries the `notrack` prefix and thus does not require a
+     * landing pad at its target.
+     */
+    ZyanBool is_notrack;
+} ZydisIbtReference;
+
+/**
+ * Defines the `ZydisIbtReferenceCallback` function prototype.
+ *
+ * @param   reference   A pointer to the `ZydisIbtReference` struct.
+ * @param   user_data   A pointer to user-defined data.
+ *
+ * @return  A zyan status code.
+ *
+ * Returning a status code other than `ZYAN_STATUS_SUCCESS` stops the sweep and passes the status
+ * code to the caller.
+ */
+typedef ZyanStatus (*ZydisIbtReferenceCallback)(const ZydisIbtReference* reference,
+    void* user_data);
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Collects all code references of the given code in a single linear sweep.
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance. `ZYDIS_DECODER_MODE_MINIMAL`
+ *                          is not supported and `ZYDIS_DECODER_MODE_CET` has to be enabled to
+ *                          detect `notrack` prefixes.
+ * @param   buffer          A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the first byte.
+ * @param   callback        The callback that is invoked for every reference.
+ * @param   user_data       A pointer to user-defined data passed to the callback.
+ *
+ * @return  A zyan status code.
+ *
+ * Bytes that can not be decoded are skipped one at a time. Referenced addresses are not
+ * validated, so the callback usually has to filter them against the memory layout of the image.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisIbtCollectReferences(const ZydisDecoder* decoder,
+    const void* buffer, ZyanUSize length, ZyanU64 runtime_address,
+    ZydisIbtReferenceCallback callback, void* user_data);
+
+/**
+ * Checks if the given code starts with a valid landing pad.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance. `ZYDIS_DECODER_MODE_CET` must be
+ *                  enabled.
+ * @param   buffer  A pointer to the code.
+ * @param   length  The length of the code.
+ *
+ * @return  `ZYAN_STATUS_TRUE`, if the code starts with `endbr64` (64-bit mode) or `endbr32`
+ *          (all other modes), `ZYAN_STATUS_FALSE`, if not, or another zyan status code, if an
+ *          error occured.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisIbtIsLandingPad(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length);
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_IBT_H */
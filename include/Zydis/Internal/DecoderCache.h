@@ -0,0 +1,86 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Defines the layout of the decoder cache.
+ */
+
+#ifndef ZYDIS_INTERNAL_DECODERCACHE_H
+#define ZYDIS_INTERNAL_DECODERCACHE_H
+
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisDecoderCacheEntry` struct.
+ */
+typedef struct ZydisDecoderCacheEntry_
+{
+    /**
+     * The decoded instruction template.
+     */
+    ZydisDecodedInstruction instruction;
+    /**
+     * The decoder context template.
+     */
+    ZydisDecoderContext context;
+} ZydisDecoderCacheEntry;
+
+/**
+ * Defines the `ZydisDecoderCache` struct.
+ */
+struct ZydisDecoderCache_
+{
+    /**
+     * A copy of the decoder the cache was built for.
+     */
+    ZydisDecoder decoder;
+    /**
+     * One bit for each first opcode byte, signaling if a cache entry exists.
+     */
+    ZyanU64 mask[4];
+    /**
+     * The cache entries, indexed by the first opcode byte.
+     */
+    ZydisDecoderCacheEntry entries[256];
+};
+
+/* ============================================================================================== */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_INTERNAL_DECODERCACHE_H */
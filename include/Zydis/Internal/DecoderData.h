@@ -29,6 +29,7 @@
 
 #include <Zycore/Defines.h>
 #include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
 #include <Zydis/Defines.h>
 
 #ifdef __cplusplus
@@ -202,6 +203,19 @@ typedef struct ZydisDecoderTreeNode_
     ZydisDecoderTreeNodeValue value;
 } ZydisDecoderTreeNode;
 
+/**
+ * Refers to a node of the decoder tree. Use `ZydisDecoderTreeNodeGet` to access the node.
+ *
+ * The default tables store `ZydisDecoderTreeNode` structs, so the decoder walks the tree by
+ * pointer. The compact tables (see `ZYDIS_COMPACT_DECODER_TABLES`) decode every node on access,
+ * so their nodes are passed by value instead.
+ */
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+typedef ZydisDecoderTreeNode ZydisDecoderTreeNodeRef;
+#else
+typedef const ZydisDecoderTreeNode* ZydisDecoderTreeNodeRef;
+#endif
+
 /* ---------------------------------------------------------------------------------------------- */
 
 #pragma pack(pop)
@@ -303,9 +317,29 @@ extern const ZydisDecoderTreeNode zydis_decoder_tree_root;
  *
  * @return  The root node of the instruction tree.
  */
-ZYAN_INLINE const ZydisDecoderTreeNode* ZydisDecoderTreeGetRootNode(void)
+ZYAN_INLINE ZydisDecoderTreeNodeRef ZydisDecoderTreeGetRootNode(void)
 {
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+    return zydis_decoder_tree_root;
+#else
     return &zydis_decoder_tree_root;
+#endif
+}
+
+/**
+ * Returns the node that is referred to by `ref`.
+ *
+ * @param   ref A pointer to the node reference.
+ *
+ * @return  The node that is referred to by `ref`.
+ */
+ZYAN_INLINE const ZydisDecoderTreeNode* ZydisDecoderTreeNodeGet(const ZydisDecoderTreeNodeRef* ref)
+{
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+    return ref;
+#else
+    return *ref;
+#endif
 }
 
 /**
@@ -316,9 +350,36 @@ ZYAN_INLINE const ZydisDecoderTreeNode* ZydisDecoderTreeGetRootNode(void)
  *
  * @return  The specified child node.
  */
-ZYDIS_NO_EXPORT const ZydisDecoderTreeNode* ZydisDecoderTreeGetChildNode(
+ZYDIS_NO_EXPORT ZydisDecoderTreeNodeRef ZydisDecoderTreeGetChildNode(
     const ZydisDecoderTreeNode* parent, ZyanU16 index);
 
+#ifdef ZYDIS_PROFILE_DECODER_TABLES
+
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+#   error "ZYDIS_PROFILE_DECODER_TABLES requires the default decoder table representation"
+#endif
+
+/**
+ * The maximum number of rows per filter table that can be profiled.
+ */
+#define ZYDIS_DECODER_TREE_PROFILE_MAX_ROWS 0x1000
+
+/**
+ * Returns the number of times `ZydisDecoderTreeGetChildNode` accessed the given filter table row.
+ *
+ * @param   type    The filter node type, which selects the filter table.
+ * @param   value   The row index within the filter table.
+ *
+ * @return  The visit count of the row.
+ *
+ * The counters are updated without synchronization and are only meant for profiling runs that
+ * collect input for `assets/generate_decoder_tables.py`.
+ */
+ZYDIS_NO_EXPORT ZyanU32 ZydisDecoderTreeGetVisitCount(ZydisDecoderTreeNodeType type,
+    ZydisDecoderTreeNodeValue value);
+
+#endif
+
 /**
  * Returns information about optional instruction parts (like modrm, displacement or
  * immediates) for the instruction that is linked to the given `node`.
@@ -329,6 +390,31 @@ ZYDIS_NO_EXPORT const ZydisDecoderTreeNode* ZydisDecoderTreeGetChildNode(
 ZYDIS_NO_EXPORT void ZydisGetInstructionEncodingInfo(const ZydisDecoderTreeNode* node,
     const ZydisInstructionEncodingInfo** info);
 
+/* ---------------------------------------------------------------------------------------------- */
+/* Operands                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifndef ZYDIS_MINIMAL_MODE
+
+/**
+ * Decodes the visible operands of the given instruction for formatting.
+ *
+ * @param   decoder     A pointer to the `ZydisDecoder` instance.
+ * @param   context     A pointer to the `ZydisDecoderContext` struct.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands    The array that receives the visible operands of the instruction.
+ *
+ * @return  A zyan status code.
+ *
+ * Only the fields read by the formatter are filled in. The operand-actions and the element
+ * information are left zeroed. The caller has to reject decoders in `ZYDIS_DECODER_MODE_MINIMAL`.
+ */
+ZYDIS_NO_EXPORT ZyanStatus ZydisDecoderDecodeVisibleOperands(const ZydisDecoder* decoder,
+    const ZydisDecoderContext* context, const ZydisDecodedInstruction* instruction,
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT_VISIBLE]);
+
+#endif
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* ============================================================================================== */
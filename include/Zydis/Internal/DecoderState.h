@@ -0,0 +1,145 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * Defines the decoder state that is passed between the internal decoder functions.
+ */
+
+#ifndef ZYDIS_INTERNAL_DECODERSTATE_H
+#define ZYDIS_INTERNAL_DECODERSTATE_H
+
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisDecoderState` struct.
+ */
+typedef struct ZydisDecoderState_
+{
+    /**
+     * A pointer to the `ZydisDecoder` instance.
+     */
+    const ZydisDecoder* decoder;
+    /**
+     * A pointer to the `ZydisDecoderContext` struct.
+     */
+    ZydisDecoderContext* context;
+    /**
+     * The input buffer.
+     */
+    const ZyanU8* buffer;
+    /**
+     * The input buffer length.
+     */
+    ZyanUSize buffer_len;
+    /**
+     * Prefix information.
+     */
+    struct
+    {
+        /**
+         * Signals, if the instruction has a `LOCK` prefix (`F0`).
+         *
+         * This prefix originally belongs to group 1, but separating it from the other ones makes
+         * parsing easier for us later.
+         */
+        ZyanBool has_lock;
+        /**
+         * The effective prefix of group 1 (either `F2` or `F3`).
+         */
+        ZyanU8 group1;
+        /**
+         * The effective prefix of group 2 (`2E`, `36`, `3E`, `26`, `64` or `65`).
+         */
+        ZyanU8 group2;
+        /**
+         * The effective segment prefix.
+         */
+        ZyanU8 effective_segment;
+        /**
+         * The prefix that should be treated as the mandatory-prefix, if the
+         * current instruction needs one.
+         *
+         * The last `F3`/`F2` prefix has precedence over previous ones and
+         * `F3`/`F2` in general have precedence over `66`.
+         */
+        ZyanU8 mandatory_candidate;
+        /**
+         * The offset of the effective `LOCK` prefix.
+         */
+        ZyanU8 offset_lock;
+        /**
+         * The offset of the effective prefix in group 1.
+         */
+        ZyanU8 offset_group1;
+        /**
+         * The offset of the effective prefix in group 2.
+         */
+        ZyanU8 offset_group2;
+        /**
+         * The offset of the operand-size override prefix (`66`).
+         *
+         * This is the only prefix in group 3.
+         */
+        ZyanU8 offset_osz_override;
+        /**
+         * The offset of the address-size override prefix (`67`).
+         *
+         * This is the only prefix in group 4.
+         */
+        ZyanU8 offset_asz_override;
+        /**
+         * The offset of the effective segment prefix.
+         */
+        ZyanU8 offset_segment;
+        /**
+         * The offset of the mandatory-candidate prefix.
+         */
+        ZyanU8 offset_mandatory;
+        /**
+         * The offset of a possible `CET` `no-lock` prefix.
+         */
+        ZyanI8 offset_notrack;
+    } prefixes;
+} ZydisDecoderState;
+
+/* ============================================================================================== */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_INTERNAL_DECODERSTATE_H */
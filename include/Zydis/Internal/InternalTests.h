@@ -0,0 +1,194 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * Declares internal decoder and formatter stages for white-box testing.
+ *
+ * The functions below are `static` in regular builds. Configuring with
+ * `-DZYDIS_INTERNAL_TESTS=ON` gives them external linkage, so that the `ZydisMicroBench` tool can
+ * time them in isolation. `ZydisFormatterIntelFormatOperandMEM` already has external linkage and
+ * is declared in `Zydis/Internal/FormatterIntel.h`.
+ *
+ * This header is private to the library and its internal tools. It is not part of the API.
+ */
+
+#ifndef ZYDIS_INTERNAL_INTERNALTESTS_H
+#define ZYDIS_INTERNAL_INTERNALTESTS_H
+
+#include <Zycore/String.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Internal/DecoderState.h>
+#include <Zydis/Internal/SharedData.h>
+
+#ifndef ZYDIS_DISABLE_FORMATTER
+#   include <Zydis/FormatterBuffer.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * Storage class of internal functions that are exposed by `ZYDIS_INTERNAL_TESTS` builds.
+ */
+#ifdef ZYDIS_INTERNAL_TESTS
+#   define ZYDIS_INTERNAL_STATIC
+#else
+#   define ZYDIS_INTERNAL_STATIC static
+#endif
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+#ifdef ZYDIS_INTERNAL_TESTS
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Decoder                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifndef ZYDIS_DISABLE_DECODER
+
+/**
+ * Collects the optional prefixes of the instruction at `state->buffer` (see `Decoder.c`).
+ *
+ * @param   state       A pointer to the `ZydisDecoderState` struct.
+ * @param   instruction A pointer to the zero-initialized `ZydisDecodedInstruction` struct.
+ *
+ * @return  A zyan status code.
+ */
+ZyanStatus ZydisCollectOptionalPrefixes(ZydisDecoderState* state,
+    ZydisDecodedInstruction* instruction);
+
+/**
+ * Walks the decoder tree and decodes the remaining instruction bytes (see `Decoder.c`).
+ *
+ * @param   state       A pointer to the `ZydisDecoderState` struct, as left behind by
+ *                      `ZydisCollectOptionalPrefixes`.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  A zyan status code.
+ */
+ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
+    ZydisDecodedInstruction* instruction);
+
+#ifndef ZYDIS_MINIMAL_MODE
+
+/**
+ * Sets the attributes of the given instruction (see `Decoder.c`).
+ *
+ * @param   state       A pointer to the `ZydisDecoderState` struct.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   definition  A pointer to the `ZydisInstructionDefinition` struct.
+ */
+void ZydisSetAttributes(ZydisDecoderState* state, ZydisDecodedInstruction* instruction,
+    const ZydisInstructionDefinition* definition);
+
+/**
+ * Sets the AVX specific information of the given `XOP`/`VEX`/`EVEX`/`MVEX` instruction (see
+ * `Decoder.c`).
+ *
+ * @param   context     A pointer to the `ZydisDecoderContext` struct.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   definition  A pointer to the `ZydisInstructionDefinition` struct.
+ */
+void ZydisSetAVXInformation(ZydisDecoderContext* context, ZydisDecodedInstruction* instruction,
+    const ZydisInstructionDefinition* definition);
+
+/**
+ * Decodes the operands of the given instruction (see `Decoder.c`).
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance.
+ * @param   context         A pointer to the `ZydisDecoderContext` struct.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to the `ZydisDecodedOperand` array.
+ * @param   operand_count   The number of operands to decode.
+ * @param   format_only     `ZYAN_TRUE` to skip the operand-actions and element information.
+ *
+ * @return  A zyan status code.
+ */
+ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDecoderContext* context,
+    const ZydisDecodedInstruction* instruction, ZydisDecodedOperand* operands,
+    ZyanU8 operand_count, ZyanBool format_only);
+
+#endif
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+/* String                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Appends the hexadecimal representation of a 64-bit value (see `String.c`).
+ *
+ * @param   string                  A pointer to a `ZyanString` with a fixed capacity.
+ * @param   value                   The value.
+ * @param   padding_length          Pads the number with zeros, if needed.
+ * @param   force_leading_number    Forces a leading number, if the first digit is a letter.
+ * @param   uppercase               `ZYAN_TRUE` to print uppercase hex digits.
+ *
+ * @return  A zyan status code.
+ */
+ZyanStatus ZydisStringAppendHexU64(ZyanString* string, ZyanU64 value, ZyanU8 padding_length,
+    ZyanBool force_leading_number, ZyanBool uppercase);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Formatter                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifndef ZYDIS_DISABLE_FORMATTER
+
+/**
+ * Initializes a string based formatter buffer (see `Formatter.c`).
+ *
+ * @param   buffer      A pointer to the `ZydisFormatterBuffer` struct.
+ * @param   user_buffer A pointer to the character buffer.
+ * @param   length      The length of the character buffer.
+ */
+void ZydisFormatterBufferInit(ZydisFormatterBuffer* buffer, char* user_buffer,
+    ZyanUSize length);
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
+
+/* ============================================================================================== */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_INTERNAL_INTERNALTESTS_H */
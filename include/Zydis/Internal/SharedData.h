@@ -37,6 +37,37 @@
 extern "C" {
 #endif
 
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Table placement                                                                                */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The alignment of the table section (the size of a huge page).
+ */
+#define ZYDIS_TABLE_ALIGNMENT 0x200000
+
+#if defined(ZYDIS_HUGE_PAGE_TABLES) && (defined(ZYAN_GCC) || defined(ZYAN_CLANG)) && \
+    defined(__ELF__)
+/**
+ * Signals that the generated data tables are placed in the `zydis_tables` section. The section
+ * name is a valid C identifier, so the linker defines `__start_zydis_tables` and
+ * `__stop_zydis_tables`.
+ */
+#   define ZYDIS_HAS_TABLE_SECTION
+/**
+ * Places a generated data table in the table section.
+ */
+#   define ZYDIS_TABLE_SECTION __attribute__((section("zydis_tables")))
+#else
+#   define ZYDIS_TABLE_SECTION
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
 /* ============================================================================================== */
 /* Enums and types                                                                                */
 /* ============================================================================================== */
@@ -923,6 +954,26 @@ typedef struct ZydisDefinitionAccessedFlags_
 ZYDIS_NO_EXPORT void ZydisGetInstructionDefinition(ZydisInstructionEncoding encoding,
     ZyanU16 id, const ZydisInstructionDefinition** definition);
 
+/**
+ * Returns the number of instruction-definitions with the given `encoding`.
+ *
+ * @param   encoding    The instruction-encoding.
+ *
+ * @return  The number of instruction-definitions.
+ */
+ZYDIS_NO_EXPORT ZyanU16 ZydisGetInstructionDefinitionCount(ZydisInstructionEncoding encoding);
+
+/**
+ * Returns the id of the given instruction-definition.
+ *
+ * @param   encoding    The instruction-encoding.
+ * @param   definition  A pointer to the instruction-definition.
+ *
+ * @return  The definition-id.
+ */
+ZYDIS_NO_EXPORT ZyanU16 ZydisGetInstructionDefinitionId(ZydisInstructionEncoding encoding,
+    const ZydisInstructionDefinition* definition);
+
 /* ---------------------------------------------------------------------------------------------- */
 /* Operand definition                                                                             */
 /* ---------------------------------------------------------------------------------------------- */
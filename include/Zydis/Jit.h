@@ -0,0 +1,339 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Helper functions for common instruction sequences emitted by JIT compilers.
+ */
+
+#ifndef ZYDIS_JIT_H
+#define ZYDIS_JIT_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Encoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup jit JIT helpers
+ * Helper functions for common instruction sequences emitted by JIT compilers.
+ *
+ * All helpers target 64-bit mode. The emitted sequence is selected up front from the operand
+ * values alone, so the length of a sequence can be queried without encoding anything. Every
+ * instruction of the selected sequence is then encoded exactly once using
+ * `ZydisEncoderEncodeInstruction`.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisJitConstantKind` enum.
+ */
+typedef enum ZydisJitConstantKind_
+{
+    /**
+     * `xor r32, r32` (2 or 3 bytes). Only used for `0`, if the flags do not have to be preserved.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_XOR,
+    /**
+     * `mov r32, imm32` (5 or 6 bytes), zero-extended to 64 bits.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_MOV_IMM32,
+    /**
+     * `mov r64, simm32` (7 bytes), sign-extended to 64 bits.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_MOV_SIMM32,
+    /**
+     * `lea r64, [rip+disp32]` (7 bytes). Used for values within +/-2 GiB of the instruction.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_LEA,
+    /**
+     * `mov r64, imm64` (10 bytes).
+     */
+    ZYDIS_JIT_CONSTANT_KIND_MOV_IMM64,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_MAX_VALUE = ZYDIS_JIT_CONSTANT_KIND_MOV_IMM64,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_JIT_CONSTANT_KIND_REQUIRED_BITS =
+        ZYAN_BITS_TO_REPRESENT(ZYDIS_JIT_CONSTANT_KIND_MAX_VALUE)
+} ZydisJitConstantKind;
+
+/**
+ * Defines the `ZydisJitConstant` struct.
+ */
+typedef struct ZydisJitConstant_
+{
+    /**
+     * The destination register. This has to be a 64-bit general purpose register.
+     */
+    ZydisRegister reg;
+    /**
+     * The value to load.
+     */
+    ZyanU64 value;
+} ZydisJitConstant;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Branches                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisJitBranchKind` enum.
+ */
+typedef enum ZydisJitBranchKind_
+{
+    /**
+     * `call rel32` or `jmp rel32` (5 bytes).
+     */
+    ZYDIS_JIT_BRANCH_KIND_RELATIVE,
+    /**
+     * `call [rip+disp32]` or `jmp [rip+disp32]` (6 bytes), loading the target from a literal
+     * pool.
+     */
+    ZYDIS_JIT_BRANCH_KIND_POOL,
+    /**
+     * `call [rip+disp32]` or `jmp [rip+disp32]`, followed by the target itself (14 bytes for
+     * `jmp`, 16 bytes for `call`, which has to skip the target using an additional `jmp rel8`).
+     */
+    ZYDIS_JIT_BRANCH_KIND_INLINE,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_JIT_BRANCH_KIND_MAX_VALUE = ZYDIS_JIT_BRANCH_KIND_INLINE,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_JIT_BRANCH_KIND_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_JIT_BRANCH_KIND_MAX_VALUE)
+} ZydisJitBranchKind;
+
+/**
+ * Defines the `ZydisJitBranch` struct.
+ */
+typedef struct ZydisJitBranch_
+{
+    /**
+     * The branch mnemonic. This has to be `ZYDIS_MNEMONIC_CALL` or `ZYDIS_MNEMONIC_JMP`.
+     */
+    ZydisMnemonic mnemonic;
+    /**
+     * The absolute target address.
+     */
+    ZyanU64 target;
+} ZydisJitBranch;
+
+/**
+ * Defines the `ZydisJitLiteralPool` struct.
+ *
+ * A literal pool stores 64-bit branch targets that are out of range for `rel32` branches. Equal
+ * targets share the same entry.
+ */
+typedef struct ZydisJitLiteralPool_
+{
+    /**
+     * A writable pointer to the first entry.
+     */
+    ZyanU8* buffer;
+    /**
+     * The runtime address of the first entry.
+     */
+    ZyanU64 runtime_address;
+    /**
+     * The maximum number of entries.
+     */
+    ZyanUSize capacity;
+    /**
+     * The number of used entries.
+     */
+    ZyanUSize count;
+} ZydisJitLiteralPool;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Selects the shortest sequence for loading a constant into a register.
+ *
+ * @param   constant        A pointer to the `ZydisJitConstant` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   preserve_flags  `ZYAN_TRUE`, if the sequence must not modify the flags register.
+ * @param   kind            Receives the selected sequence. This parameter is optional.
+ * @param   length          Receives the length of the sequence in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitGetConstantLength(const ZydisJitConstant* constant,
+    ZyanU64 runtime_address, ZyanBool preserve_flags, ZydisJitConstantKind* kind,
+    ZyanU8* length);
+
+/**
+ * Emits the shortest sequence for loading a constant into a register.
+ *
+ * @param   constant        A pointer to the `ZydisJitConstant` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   preserve_flags  `ZYAN_TRUE`, if the sequence must not modify the flags register.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          sequence.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitEmitConstant(const ZydisJitConstant* constant,
+    ZyanU64 runtime_address, ZyanBool preserve_flags, void* buffer, ZyanUSize* length);
+
+/**
+ * Emits the shortest sequences for loading multiple constants.
+ *
+ * @param   constants       A pointer to an array of `ZydisJitConstant` structs.
+ * @param   count           The number of constants.
+ * @param   runtime_address The runtime address of the first sequence.
+ * @param   preserve_flags  `ZYAN_TRUE`, if the sequences must not modify the flags register.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the total length of all
+ *                          sequences.
+ *
+ * @return  A zyan status code.
+ *
+ * The sequences are emitted back to back in the given order.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitEmitConstants(const ZydisJitConstant* constants, ZyanUSize count,
+    ZyanU64 runtime_address, ZyanBool preserve_flags, void* buffer, ZyanUSize* length);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Literal pool                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisJitLiteralPool` instance.
+ *
+ * @param   pool            A pointer to the `ZydisJitLiteralPool` instance.
+ * @param   buffer          A writable pointer to the memory of the pool.
+ * @param   capacity        The size of the buffer in entries of 8 bytes.
+ * @param   runtime_address The runtime address of the pool. Should be aligned to 8 bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitLiteralPoolInit(ZydisJitLiteralPool* pool, void* buffer,
+    ZyanUSize capacity, ZyanU64 runtime_address);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Branches                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Selects the shortest sequence for branching to an absolute address.
+ *
+ * @param   branch          A pointer to the `ZydisJitBranch` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   pool            A pointer to the `ZydisJitLiteralPool` instance used for targets out of
+ *                          `rel32` range, or `ZYAN_NULL` to always place them inline.
+ * @param   kind            Receives the selected sequence. This parameter is optional.
+ * @param   length          Receives the length of the sequence in bytes.
+ *
+ * @return  A zyan status code.
+ *
+ * The literal pool is only used, if all of its entries are in `rel32` range of the sequence and
+ * it either already contains the target or has room for it.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitGetBranchLength(const ZydisJitBranch* branch,
+    ZyanU64 runtime_address, const ZydisJitLiteralPool* pool, ZydisJitBranchKind* kind,
+    ZyanU8* length);
+
+/**
+ * Emits the shortest sequence for branching to an absolute address.
+ *
+ * @param   branch          A pointer to the `ZydisJitBranch` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   pool            A pointer to the `ZydisJitLiteralPool` instance used for targets out of
+ *                          `rel32` range, or `ZYAN_NULL` to always place them inline.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          sequence.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitEmitBranch(const ZydisJitBranch* branch, ZyanU64 runtime_address,
+    ZydisJitLiteralPool* pool, void* buffer, ZyanUSize* length);
+
+/**
+ * Emits the shortest sequences for multiple branches, e.g. to build a jump table.
+ *
+ * @param   branches        A pointer to an array of `ZydisJitBranch` structs.
+ * @param   count           The number of branches.
+ * @param   runtime_address The runtime address of the first sequence.
+ * @param   pool            A pointer to the `ZydisJitLiteralPool` instance used for targets out of
+ *                          `rel32` range, or `ZYAN_NULL` to always place them inline.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the total length of all
+ *                          sequences.
+ *
+ * @return  A zyan status code.
+ *
+ * The sequences are emitted back to back in the given order.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisJitEmitBranches(const ZydisJitBranch* branches, ZyanUSize count,
+    ZyanU64 runtime_address, ZydisJitLiteralPool* pool, void* buffer, ZyanUSize* length);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_JIT_H */
@@ -0,0 +1,261 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for detecting micro-architectural performance hazards in machine code.
+ */
+
+#ifndef ZYDIS_LINTER_H
+#define ZYDIS_LINTER_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup linter Linter
+ * Functions for detecting micro-architectural performance hazards in machine code.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The default alignment of loop heads in bytes.
+ */
+#define ZYDIS_LINTER_DEFAULT_LOOP_ALIGNMENT 16
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Hazard                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisLinterHazardType` enum.
+ */
+typedef enum ZydisLinterHazardType_
+{
+    /**
+     * A jump or macro-fused jump crosses or ends on a 32-byte boundary.
+     *
+     * Affected CPUs with the microcode update for the Intel JCC erratum do not cache these
+     * instructions in the decoded ICache.
+     */
+    ZYDIS_LINTER_HAZARD_JCC_ERRATUM,
+    /**
+     * The operand-size prefix changes the length of the immediate (length-changing prefix).
+     *
+     * The legacy decoders stall for several cycles on these instructions.
+     */
+    ZYDIS_LINTER_HAZARD_LCP_STALL,
+    /**
+     * The target of a backward branch is not aligned to the configured loop alignment.
+     */
+    ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP,
+    /**
+     * A macro-fusible instruction pair is split across a 64-byte cache line boundary.
+     *
+     * The instructions are not macro-fused, if the second one starts at a new cache line.
+     */
+    ZYDIS_LINTER_HAZARD_SPLIT_FUSION,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_LINTER_HAZARD_MAX_VALUE = ZYDIS_LINTER_HAZARD_SPLIT_FUSION,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_LINTER_HAZARD_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_LINTER_HAZARD_MAX_VALUE)
+} ZydisLinterHazardType;
+
+/**
+ * Describes a single performance hazard.
+ */
+typedef struct ZydisLinterHazard_
+{
+    /**
+     * The hazard type.
+     */
+    ZydisLinterHazardType type;
+    /**
+     * The offset of the affected instruction, relative to the start of the buffer. For
+     * macro-fusible pairs, this is the offset of the first instruction.
+     */
+    ZyanUSize offset;
+    /**
+     * The runtime address of the affected instruction.
+     */
+    ZyanU64 address;
+    /**
+     * The length of the affected instruction or instruction pair.
+     */
+    ZyanU8 length;
+    /**
+     * The mnemonic of the affected instruction. For macro-fusible pairs, this is the mnemonic of
+     * the jump.
+     */
+    ZydisMnemonic mnemonic;
+    /**
+     * The runtime address of the loop head for `ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP` hazards or
+     * the runtime address of the affected instruction for all other hazards.
+     */
+    ZyanU64 target;
+    /**
+     * The suggested number of padding bytes to insert in front of `target`, or `0`, if the
+     * hazard can not be fixed by padding.
+     */
+    ZyanU32 padding;
+} ZydisLinterHazard;
+
+/**
+ * Defines the `ZydisLinterCallback` function prototype.
+ *
+ * @param   hazard      A pointer to the `ZydisLinterHazard` struct.
+ * @param   user_data   A pointer to user-defined data.
+ *
+ * @return  A zyan status code.
+ *
+ * Returning a status code other than `ZYAN_STATUS_SUCCESS` stops the linter and passes the status
+ * code to the caller.
+ */
+typedef ZyanStatus (*ZydisLinterCallback)(const ZydisLinterHazard* hazard, void* user_data);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Linter                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisLinter` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisLinter_
+{
+    /**
+     * The decoder used to find the instruction boundaries.
+     */
+    ZydisDecoder decoder;
+    /**
+     * One bit for each enabled hazard type.
+     */
+    ZyanU32 hazards;
+    /**
+     * The loop head alignment in bytes.
+     */
+    ZyanU32 loop_alignment;
+} ZydisLinter;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Initializes the given `ZydisLinter` instance.
+ *
+ * @param   linter          A pointer to the `ZydisLinter` instance.
+ * @param   machine_mode    The machine mode of the code.
+ * @param   stack_width     The stack width of the code.
+ *
+ * @return  A zyan status code.
+ *
+ * All hazard types are enabled by default and the loop alignment is set to
+ * `ZYDIS_LINTER_DEFAULT_LOOP_ALIGNMENT`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisLinterInit(ZydisLinter* linter, ZydisMachineMode machine_mode,
+    ZydisStackWidth stack_width);
+
+/**
+ * Enables or disables the given hazard type.
+ *
+ * @param   linter  A pointer to the `ZydisLinter` instance.
+ * @param   type    The hazard type.
+ * @param   enabled `ZYAN_TRUE` to enable the hazard type or `ZYAN_FALSE` to disable it.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisLinterEnableHazard(ZydisLinter* linter, ZydisLinterHazardType type,
+    ZyanBool enabled);
+
+/**
+ * Changes the loop head alignment.
+ *
+ * @param   linter      A pointer to the `ZydisLinter` instance.
+ * @param   alignment   The alignment in bytes. Must be a power of two.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisLinterSetLoopAlignment(ZydisLinter* linter, ZyanU32 alignment);
+
+/**
+ * Scans the given code for performance hazards.
+ *
+ * @param   linter          A pointer to the `ZydisLinter` instance.
+ * @param   buffer          A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the first byte.
+ * @param   callback        The callback that is invoked for every hazard.
+ * @param   user_data       A pointer to user-defined data passed to the callback.
+ *
+ * @return  A zyan status code.
+ *
+ * The code is decoded in a single linear pass. Bytes that can not be decoded are skipped one at
+ * a time. The linter does not modify any state, so multiple threads can share a single instance.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisLinterLint(const ZydisLinter* linter, const void* buffer,
+    ZyanUSize length, ZyanU64 runtime_address, ZydisLinterCallback callback, void* user_data);
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_LINTER_H */
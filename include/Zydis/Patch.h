@@ -0,0 +1,283 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for patching instructions in code that is concurrently executed by other threads.
+ */
+
+#ifndef ZYDIS_PATCH_H
+#define ZYDIS_PATCH_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/DecoderTypes.h>
+#include <Zydis/Encoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup patch Patch
+ * Functions for patching instructions in code that is concurrently executed by other threads.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The maximum number of breakpoint patches that can be in flight at the same time.
+ */
+#define ZYDIS_PATCH_MAX_ACTIVE_BREAKPOINTS 64
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defined, if patches can be applied to running code (`ZydisPatchApply`).
+ *
+ * Applying patches requires atomic memory accesses, a way to serialize all cores of the process
+ * and a `SIGTRAP` handler. These are currently only implemented for x86 Linux.
+ */
+#if defined(ZYAN_LINUX) && !defined(ZYAN_NO_LIBC) && (defined(ZYAN_X64) || defined(ZYAN_X86)) && \
+    (defined(ZYAN_GCC) || defined(ZYAN_CLANG))
+#   define ZYDIS_PATCH_RUNTIME
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisPatchStrategy` enum.
+ */
+typedef enum ZydisPatchStrategy_
+{
+    /**
+     * The patch does not change any bytes.
+     */
+    ZYDIS_PATCH_STRATEGY_NONE,
+    /**
+     * All changed bytes are contained in a naturally aligned 4-byte word, which is written with
+     * a single atomic store.
+     */
+    ZYDIS_PATCH_STRATEGY_ATOMIC_4,
+    /**
+     * All changed bytes are contained in a naturally aligned 8-byte word, which is written with
+     * a single atomic store.
+     */
+    ZYDIS_PATCH_STRATEGY_ATOMIC_8,
+    /**
+     * The changed bytes cross an 8-byte boundary. The first byte of the instruction is replaced
+     * by `int3` while the remaining bytes are rewritten.
+     */
+    ZYDIS_PATCH_STRATEGY_BREAKPOINT,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_PATCH_STRATEGY_MAX_VALUE = ZYDIS_PATCH_STRATEGY_BREAKPOINT,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_PATCH_STRATEGY_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_PATCH_STRATEGY_MAX_VALUE)
+} ZydisPatchStrategy;
+
+/**
+ * Defines the `ZydisPatch` struct.
+ *
+ * A patch always replaces a single instruction by new bytes of the same length, so the
+ * instruction boundaries in front of and behind it do not change.
+ */
+typedef struct ZydisPatch_
+{
+    /**
+     * The runtime address of the patched instruction.
+     */
+    ZyanU64 runtime_address;
+    /**
+     * The length of the patched instruction.
+     */
+    ZyanU8 length;
+    /**
+     * The new instruction bytes.
+     */
+    ZyanU8 bytes[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    /**
+     * The offset of the first changed byte, relative to the start of the instruction.
+     */
+    ZyanU8 changed_offset;
+    /**
+     * The number of changed bytes, starting at `changed_offset`.
+     */
+    ZyanU8 changed_length;
+    /**
+     * The strategy used to apply the patch.
+     */
+    ZydisPatchStrategy strategy;
+} ZydisPatch;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Analysis                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the patchable field of the given instruction.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   offset      Receives the offset of the field, relative to the start of the instruction.
+ * @param   size        Receives the size of the field in bytes.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_NOT_FOUND` is returned, if the instruction has neither
+ *          a relative immediate nor a `RIP`-relative displacement.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchGetField(const ZydisDecodedInstruction* instruction,
+    ZyanU8* offset, ZyanU8* size);
+
+/**
+ * Selects the strategy for writing the given byte range of running code.
+ *
+ * @param   address     The runtime address of the first byte.
+ * @param   size        The number of bytes.
+ * @param   strategy    Receives the strategy.
+ *
+ * @return  A zyan status code.
+ *
+ * Aligned stores are preferred, as instruction fetch on other cores observes either all or none of
+ * the bytes of a single naturally aligned store.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchSelectStrategy(ZyanU64 address, ZyanUSize size,
+    ZydisPatchStrategy* strategy);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Preparation                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Prepares a patch that changes the target of a relative branch or `RIP`-relative memory operand
+ * by rewriting its patchable field.
+ *
+ * @param   patch           A pointer to the `ZydisPatch` struct.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   code            A pointer to the current instruction bytes.
+ * @param   runtime_address The runtime address of the instruction.
+ * @param   target          The new absolute target address.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_OUT_OF_RANGE` is returned, if the new target can not
+ *          be reached with the existing field. Use `ZydisPatchPrepareReplace` in this case.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchPrepareRetarget(ZydisPatch* patch,
+    const ZydisDecodedInstruction* instruction, const void* code, ZyanU64 runtime_address,
+    ZyanU64 target);
+
+/**
+ * Prepares a patch that replaces an instruction by a newly encoded one.
+ *
+ * @param   patch           A pointer to the `ZydisPatch` struct.
+ * @param   code            A pointer to the current instruction bytes.
+ * @param   length          The length of the current instruction.
+ * @param   runtime_address The runtime address of the instruction.
+ * @param   request         A pointer to the `ZydisEncoderRequest` struct. Relative operands must be
+ *                          passed as absolute addresses, see
+ *                          `ZydisEncoderEncodeInstructionAbsolute`.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE` is returned, if the new
+ *          instruction is longer than the current one.
+ *
+ * If the new instruction is shorter than the current one, the remaining bytes are filled using
+ * `ZydisEncoderNopFill`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchPrepareReplace(ZydisPatch* patch, const void* code,
+    ZyanU8 length, ZyanU64 runtime_address, ZydisEncoderRequest* request);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Runtime                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+#if defined(ZYDIS_PATCH_RUNTIME)
+
+/**
+ * Prepares the process for applying breakpoint patches.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_BAD_SYSTEMCALL` is returned, if the kernel does not
+ *          support `MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE`.
+ *
+ * This function registers the process for core-serializing memory barriers and installs a
+ * `SIGTRAP` handler. Threads that hit the temporary `int3` of a breakpoint patch are sent back to
+ * the start of the instruction and retry until the patch is complete. All other `SIGTRAP` signals
+ * are forwarded to the previously installed handler.
+ *
+ * It is safe to call this function multiple times.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchInitRuntime(void);
+
+/**
+ * Applies the given patch to running code.
+ *
+ * @param   patch       A pointer to the `ZydisPatch` struct.
+ * @param   writable    A writable view of the instruction. This is either the instruction itself,
+ *                      or an alias mapping with the same alignment, e.g. `ZydisCodeSlot.writable`.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_INVALID_OPERATION` is returned for breakpoint patches,
+ *          if `ZydisPatchInitRuntime` has not been called successfully.
+ *
+ * Atomic patches are written with a single compare-and-swap of the containing word, so patches of
+ * neighbouring instructions sharing that word never overwrite each other. Breakpoint patches
+ * follow the `int3`, rewrite tail, rewrite first byte protocol, serializing all cores of the
+ * process after every step. Patches of the same instruction must not be applied concurrently.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisPatchApply(const ZydisPatch* patch, void* writable);
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_PATCH_H */
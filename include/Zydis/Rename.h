@@ -0,0 +1,224 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for renaming registers in decoded code.
+ */
+
+#ifndef ZYDIS_RENAME_H
+#define ZYDIS_RENAME_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/DecoderTypes.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup rename Register renaming
+ * Functions for renaming registers in decoded code.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The number of general purpose register ids.
+ */
+#define ZYDIS_RENAME_GPR_COUNT      16
+
+/**
+ * The number of vector register ids.
+ */
+#define ZYDIS_RENAME_VECTOR_COUNT   32
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisRenameMap` struct.
+ *
+ * The map is applied to register ids, so it renames all partial-register aliases of the same id
+ * at once (e.g. `AL`, `AX`, `EAX` and `RAX`, or `XMM0`, `YMM0` and `ZMM0`).
+ */
+typedef struct ZydisRenameMap_
+{
+    /**
+     * The new ids of the general purpose registers, indexed by the current id.
+     */
+    ZyanU8 gpr[ZYDIS_RENAME_GPR_COUNT];
+    /**
+     * The new ids of the `XMM`, `YMM` and `ZMM` registers, indexed by the current id.
+     */
+    ZyanU8 vector[ZYDIS_RENAME_VECTOR_COUNT];
+} ZydisRenameMap;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rename map                                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisRenameMap` instance with the identity mapping.
+ *
+ * @param   map A pointer to the `ZydisRenameMap` instance.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameMapInit(ZydisRenameMap* map);
+
+/**
+ * Sets the new name of a register.
+ *
+ * @param   map     A pointer to the `ZydisRenameMap` instance.
+ * @param   from    The register to rename.
+ * @param   to      The new register. This has to be a general purpose register, if `from` is a
+ *                  general purpose register, or a vector register, if `from` is a vector register.
+ *                  The width of the registers does not matter.
+ *
+ * @return  A zyan status code.
+ *
+ * `AH`, `CH`, `DH` and `BH` rename the whole register, just like `AL`, `CL`, `DL` and `BL`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameMapSet(ZydisRenameMap* map, ZydisRegister from,
+    ZydisRegister to);
+
+/**
+ * Applies the given map to a single register.
+ *
+ * @param   map     A pointer to the `ZydisRenameMap` instance.
+ * @param   reg     The register.
+ * @param   renamed Receives the renamed register of the same register class.
+ *
+ * @return  A zyan status code. `ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION` is returned, if a high-byte
+ *          register (`AH`, `CH`, `DH`, `BH`) is renamed to a register without a high byte.
+ *
+ * Registers that are neither general purpose nor vector registers are returned unchanged.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameMapRegister(const ZydisRenameMap* map, ZydisRegister reg,
+    ZydisRegister* renamed);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rewriting                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Renames the registers of a single instruction.
+ *
+ * @param   map             A pointer to the `ZydisRenameMap` instance.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to the operands of the instruction. All operands
+ *                          (`instruction->operand_count`) are required.
+ * @param   code            A pointer to the instruction bytes.
+ * @param   runtime_address The runtime address of the instruction.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          renamed instruction.
+ *
+ * @return  A zyan status code. `ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION` is returned, if a renamed
+ *          register is used implicitly by the instruction (e.g. `RDX` by `MUL`) or if the renamed
+ *          instruction can not be encoded.
+ *
+ * If the register fields can be rewritten without changing the length of the instruction, the
+ * bytes are patched in place. Otherwise the instruction is encoded again using
+ * `ZydisEncoderDecodedInstructionToEncoderRequest`. Relative operands keep their absolute targets
+ * in both cases.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameInstruction(const ZydisRenameMap* map,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    const void* code, ZyanU64 runtime_address, void* buffer, ZyanUSize* length);
+
+/**
+ * Returns the size of the workspace required by `ZydisRenameFunction`.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance.
+ * @param   code    A pointer to the code of the function.
+ * @param   length  The length of the code.
+ * @param   size    Receives the size of the workspace in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameGetWorkspaceSize(const ZydisDecoder* decoder,
+    const void* code, ZyanUSize length, ZyanUSize* size);
+
+/**
+ * Renames the registers of a whole function.
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance.
+ * @param   map             A pointer to the `ZydisRenameMap` instance.
+ * @param   code            A pointer to the code of the function.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the function.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   buffer_length   A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          renamed function.
+ * @param   workspace       A pointer to the workspace.
+ * @param   workspace_size  The size of the workspace, see `ZydisRenameGetWorkspaceSize`.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_NOT_FOUND` is returned, if a relative operand
+ *          targets the inside of an instruction of the function.
+ *
+ * The code is decoded using a linear sweep. The renamed function is placed at the same runtime
+ * address. If instructions change their length, relative operands are fixed up: targets inside of
+ * the function follow their instruction, targets outside of the function keep their address.
+ * Relative branches are widened to `rel32`, if their target moves out of range.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisRenameFunction(const ZydisDecoder* decoder,
+    const ZydisRenameMap* map, const void* code, ZyanUSize length, ZyanU64 runtime_address,
+    void* buffer, ZyanUSize* buffer_length, void* workspace, ZyanUSize workspace_size);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_RENAME_H */
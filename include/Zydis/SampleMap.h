@@ -0,0 +1,352 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for attributing instruction pointer samples to instructions and basic blocks.
+ */
+
+#ifndef ZYDIS_SAMPLEMAP_H
+#define ZYDIS_SAMPLEMAP_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup samplemap Sample map
+ * Functions for attributing instruction pointer samples to instructions and basic blocks.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The instruction index returned for samples outside of the mapped code.
+ */
+#define ZYDIS_SAMPLE_MAP_NO_INSTRUCTION 0xFFFFFFFF
+
+/**
+ * The base 2 logarithm of the number of code bytes covered by a single bucket of the lookup
+ * index.
+ */
+#define ZYDIS_SAMPLE_MAP_BUCKET_SHIFT 2
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Sweep info                                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The mask of the instruction length in a sweep info byte.
+ */
+#define ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK   0x0F
+/**
+ * The bytes could not be decoded. The entry covers a single byte.
+ */
+#define ZYDIS_SAMPLE_MAP_INFO_INVALID       0x10
+/**
+ * The instruction ends a basic block.
+ */
+#define ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK    0x20
+/**
+ * The instruction is a relative branch that starts a new basic block at its target.
+ */
+#define ZYDIS_SAMPLE_MAP_INFO_BRANCH        0x40
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Describes a single instruction of a `ZydisSampleMap`.
+ */
+typedef struct ZydisSampleMapInstruction_
+{
+    /**
+     * The runtime address of the instruction.
+     */
+    ZyanU64 address;
+    /**
+     * The offset of the instruction, relative to the start of the buffer.
+     */
+    ZyanU32 offset;
+    /**
+     * The index of the basic block that contains the instruction.
+     */
+    ZyanU32 block;
+    /**
+     * The length of the instruction.
+     */
+    ZyanU8 length;
+    /**
+     * Signals, if the instruction is the first one of its basic block.
+     */
+    ZyanBool is_block_start;
+    /**
+     * Signals, if the bytes could not be decoded.
+     */
+    ZyanBool is_invalid;
+} ZydisSampleMapInstruction;
+
+/**
+ * Defines the `ZydisSampleMap` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisSampleMap_
+{
+    /**
+     * The runtime address of the first byte.
+     */
+    ZyanU64 runtime_address;
+    /**
+     * The length of the mapped code.
+     */
+    ZyanU32 length;
+    /**
+     * The number of instructions.
+     */
+    ZyanU32 instruction_count;
+    /**
+     * The number of basic blocks.
+     */
+    ZyanU32 block_count;
+    /**
+     * The sorted start offsets of all instructions.
+     */
+    ZyanU32* offsets;
+    /**
+     * The basic block index of each instruction.
+     */
+    ZyanU32* blocks;
+    /**
+     * The index of the instruction containing the first byte of each bucket, or of the last
+     * instruction starting in front of it.
+     */
+    ZyanU32* buckets;
+    /**
+     * The sweep info byte of each instruction.
+     */
+    ZyanU8* info;
+} ZydisSampleMap;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Construction                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Decodes a part of the code and records the instruction boundaries.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance.
+ * @param   buffer  A pointer to the code.
+ * @param   length  The length of the code.
+ * @param   begin   The offset of the first instruction to decode.
+ * @param   end     The offset at which decoding stops. The last instruction may extend past it.
+ * @param   info    A pointer to an array with one sweep info byte per code byte. The array must
+ *                  be zero-initialized before the first sweep.
+ *
+ * @return  A zyan status code.
+ *
+ * The byte at the start offset of every instruction receives the instruction length and a
+ * combination of the `ZYDIS_SAMPLE_MAP_INFO_*` flags, all other bytes are left untouched. Only
+ * bytes in `[begin, end)` are written, so multiple threads can sweep disjoint ranges of the same
+ * code concurrently. Every range should start at a known instruction boundary, e.g. a function
+ * start.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapSweep(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanUSize begin, ZyanUSize end, ZyanU8* info);
+
+/**
+ * Returns the number of instructions recorded by the sweeps.
+ *
+ * @param   info    A pointer to the sweep info array.
+ * @param   length  The length of the code.
+ * @param   count   Receives the number of instructions.
+ *
+ * @return  A zyan status code.
+ *
+ * Instructions that start inside of a previous instruction (e.g. because a sweep started at an
+ * offset that is not an instruction boundary) are ignored.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapCountInstructions(const ZyanU8* info, ZyanUSize length,
+    ZyanUSize* count);
+
+/**
+ * Returns the size of the workspace required for a `ZydisSampleMap`.
+ *
+ * @param   length              The length of the code.
+ * @param   instruction_count   The number of instructions, as returned by
+ *                              `ZydisSampleMapCountInstructions`.
+ * @param   size                Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapGetWorkspaceSize(ZyanUSize length,
+    ZyanUSize instruction_count, ZyanUSize* size);
+
+/**
+ * Initializes the given `ZydisSampleMap` instance from the recorded instruction boundaries.
+ *
+ * @param   map             A pointer to the `ZydisSampleMap` instance.
+ * @param   decoder         A pointer to the `ZydisDecoder` instance used for the sweeps.
+ * @param   buffer          A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the first byte.
+ * @param   info            A pointer to the sweep info array. The array is not needed after this
+ *                          function returns.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 4
+ *                          bytes and must stay valid for the lifetime of the map.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisSampleMapGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ *
+ * A new basic block starts after every instruction that ends a block (jumps, returns, system
+ * calls, interrupts and undecodable bytes) and at the target of every relative branch. Calls do
+ * not end a basic block.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapInit(ZydisSampleMap* map, const ZydisDecoder* decoder,
+    const void* buffer, ZyanUSize length, ZyanU64 runtime_address, const ZyanU8* info,
+    void* workspace, ZyanUSize workspace_size);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Attribution                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Maps a batch of instruction pointer samples to instruction indices.
+ *
+ * @param   map     A pointer to the `ZydisSampleMap` instance.
+ * @param   samples A pointer to the sampled runtime addresses.
+ * @param   count   The number of samples.
+ * @param   indices A pointer to an array that receives the index of the instruction containing
+ *                  each sample, or `ZYDIS_SAMPLE_MAP_NO_INSTRUCTION`.
+ *
+ * @return  A zyan status code.
+ *
+ * Every lookup consists of a bucket index access followed by a branchless binary search over the
+ * few instructions that start in the bucket. The map is never modified, so multiple threads can
+ * share a single instance.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapLookup(const ZydisSampleMap* map, const ZyanU64* samples,
+    ZyanUSize count, ZyanU32* indices);
+
+/**
+ * Adds a batch of instruction pointer samples to the per-instruction sample counts.
+ *
+ * @param   map         A pointer to the `ZydisSampleMap` instance.
+ * @param   samples     A pointer to the sampled runtime addresses.
+ * @param   count       The number of samples.
+ * @param   hits        A pointer to an array with one counter per instruction.
+ * @param   unmatched   A pointer to a counter that is incremented for every sample outside of the
+ *                      mapped code. This argument is optional.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapAccumulate(const ZydisSampleMap* map,
+    const ZyanU64* samples, ZyanUSize count, ZyanU64* hits, ZyanU64* unmatched);
+
+/**
+ * Sums up the per-instruction sample counts of every basic block.
+ *
+ * @param   map         A pointer to the `ZydisSampleMap` instance.
+ * @param   hits        A pointer to an array with one counter per instruction.
+ * @param   block_hits  A pointer to an array with one counter per basic block that receives the
+ *                      sums.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapSumBlocks(const ZydisSampleMap* map, const ZyanU64* hits,
+    ZyanU64* block_hits);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Information                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of instructions in the given map.
+ *
+ * @param   map     A pointer to the `ZydisSampleMap` instance.
+ * @param   count   Receives the number of instructions.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapGetInstructionCount(const ZydisSampleMap* map,
+    ZyanUSize* count);
+
+/**
+ * Returns the number of basic blocks in the given map.
+ *
+ * @param   map     A pointer to the `ZydisSampleMap` instance.
+ * @param   count   Receives the number of basic blocks.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapGetBlockCount(const ZydisSampleMap* map, ZyanUSize* count);
+
+/**
+ * Returns information about the instruction at the given index.
+ *
+ * @param   map         A pointer to the `ZydisSampleMap` instance.
+ * @param   index       The instruction index.
+ * @param   instruction Receives information about the instruction.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSampleMapGetInstruction(const ZydisSampleMap* map, ZyanUSize index,
+    ZydisSampleMapInstruction* instruction);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_SAMPLEMAP_H */
@@ -0,0 +1,238 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for reordering the instructions of a basic block.
+ */
+
+#ifndef ZYDIS_SCHEDULER_H
+#define ZYDIS_SCHEDULER_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/DecoderTypes.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup scheduler Scheduler
+ * Functions for building the dependency graph of a basic block and reordering its instructions.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The maximum number of instructions in a single block.
+ *
+ * The dependency graph uses one bit for every pair of instructions, so the required workspace
+ * grows quadratically with the number of instructions.
+ */
+#define ZYDIS_SCHEDULER_MAX_INSTRUCTION_COUNT 65536
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisSchedulerInstruction` struct.
+ */
+typedef struct ZydisSchedulerInstruction_
+{
+    /**
+     * The fully decoded instruction.
+     */
+    ZydisDecodedInstruction instruction;
+    /**
+     * The decoded operands, including hidden operands.
+     */
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    /**
+     * The original runtime address of the instruction.
+     */
+    ZyanU64 runtime_address;
+} ZydisSchedulerInstruction;
+
+/**
+ * Defines the `ZydisScheduler` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisScheduler_
+{
+    /**
+     * The instructions of the block.
+     */
+    const ZydisSchedulerInstruction* instructions;
+    /**
+     * The number of instructions.
+     */
+    ZyanUSize count;
+    /**
+     * The number of 64-bit words in each row of the adjacency matrix.
+     */
+    ZyanUSize row_length;
+    /**
+     * The adjacency matrix. Row `i` contains one bit for every instruction that depends on
+     * instruction `i`.
+     */
+    ZyanU64* successors;
+    /**
+     * The number of direct predecessors of each instruction.
+     */
+    ZyanU32* predecessor_count;
+    /**
+     * The estimated latency of each instruction.
+     */
+    ZyanU32* latency;
+    /**
+     * The latency-weighted length of the longest path from each instruction to the end of the
+     * block.
+     */
+    ZyanU32* priority;
+    /**
+     * The priority queues used while scheduling.
+     */
+    ZyanU64* queue;
+    /**
+     * Temporary memory used while scheduling.
+     */
+    ZyanU32* scratch;
+} ZydisScheduler;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Returns the size of the workspace required for the given number of instructions.
+ *
+ * @param   count   The number of instructions.
+ * @param   size    Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSchedulerGetWorkspaceSize(ZyanUSize count, ZyanUSize* size);
+
+/**
+ * Initializes the given `ZydisScheduler` instance and builds the dependency graph of the block.
+ *
+ * @param   scheduler       A pointer to the `ZydisScheduler` instance.
+ * @param   instructions    A pointer to the instructions of the block. The array is not copied
+ *                          and must stay valid for the lifetime of the scheduler.
+ * @param   count           The number of instructions.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 8
+ *                          bytes and must stay valid for the lifetime of the scheduler.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisSchedulerGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ *
+ * The instructions must be decoded with all operands and without `ZYDIS_DECODER_MODE_MINIMAL`.
+ *
+ * An edge is added for every read-after-write, write-after-read and write-after-write dependency
+ * on registers (aliases are resolved to the largest enclosing register) and individual CPU/FPU
+ * flags. Memory accesses are never reordered with respect to each other. Control-flow, system,
+ * serializing, locked and privileged instructions act as barriers that no instruction is moved
+ * across.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSchedulerInit(ZydisScheduler* scheduler,
+    const ZydisSchedulerInstruction* instructions, ZyanUSize count, void* workspace,
+    ZyanUSize workspace_size);
+
+/**
+ * Checks if one instruction depends on another one.
+ *
+ * @param   scheduler   A pointer to the `ZydisScheduler` instance.
+ * @param   from        The index of the instruction that is depended on.
+ * @param   to          The index of the dependent instruction.
+ *
+ * @return  `ZYAN_STATUS_TRUE`, if there is a direct dependency, `ZYAN_STATUS_FALSE`, if not, or
+ *          another zyan status code, if an error occured.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSchedulerHasDependency(const ZydisScheduler* scheduler,
+    ZyanUSize from, ZyanUSize to);
+
+/**
+ * Computes a new instruction order using latency-weighted list scheduling.
+ *
+ * @param   scheduler   A pointer to the `ZydisScheduler` instance.
+ * @param   order       A pointer to an array with one entry per instruction that receives the
+ *                      instruction indices in the new order.
+ *
+ * @return  A zyan status code.
+ *
+ * The scheduler simulates a single-issue pipeline and always picks the ready instruction with the
+ * longest latency-weighted path to the end of the block. Ties are broken by the original order,
+ * which keeps the block unchanged if there is nothing to gain.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSchedulerSchedule(ZydisScheduler* scheduler, ZyanU32* order);
+
+/**
+ * Encodes the instructions of the block in the given order.
+ *
+ * @param   scheduler       A pointer to the `ZydisScheduler` instance.
+ * @param   order           A pointer to the instruction order, e.g. as returned by
+ *                          `ZydisSchedulerSchedule`.
+ * @param   runtime_address The runtime address of the emitted block.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          emitted code.
+ *
+ * @return  A zyan status code.
+ *
+ * Relative branch targets and `EIP`/`RIP`-relative memory operands are adjusted, so they keep
+ * referring to the same absolute addresses. Relative branches are re-encoded with the smallest
+ * displacement size that reaches the target.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSchedulerEmit(const ZydisScheduler* scheduler,
+    const ZyanU32* order, ZyanU64 runtime_address, void* buffer, ZyanUSize* length);
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_SCHEDULER_H */
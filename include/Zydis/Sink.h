@@ -0,0 +1,291 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Buffered output sinks for formatted instructions.
+ */
+
+#ifndef ZYDIS_SINK_H
+#define ZYDIS_SINK_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/DecoderTypes.h>
+#include <Zydis/Formatter.h>
+#include <Zydis/Status.h>
+
+#ifndef ZYAN_NO_LIBC
+#   include <Zycore/LibC.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup sink Sink
+ * Buffered output sinks for formatted instructions.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The number of bytes that are reserved in the sink buffer before formatting an instruction.
+ */
+#define ZYDIS_SINK_LINE_LENGTH  256
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+struct ZydisSink_;
+
+/**
+ * Defines the `ZydisSinkFlushFunc` function prototype.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   data    A pointer to the pending data.
+ * @param   length  The length of the pending data.
+ *
+ * @return  A zyan status code. The sink is only emptied, if the function succeeds.
+ *
+ * The function has to consume all of the given data.
+ */
+typedef ZyanStatus (*ZydisSinkFlushFunc)(struct ZydisSink_* sink, const char* data,
+    ZyanUSize length);
+
+/**
+ * Defines the `ZydisSink` struct.
+ *
+ * All fields are considered read-only, except for `threshold` and `user_data`.
+ */
+typedef struct ZydisSink_
+{
+    /**
+     * The buffer that receives the output.
+     */
+    char* data;
+    /**
+     * The number of pending bytes in the buffer.
+     */
+    ZyanUSize size;
+    /**
+     * The capacity of the buffer.
+     */
+    ZyanUSize capacity;
+    /**
+     * The buffer is flushed as soon as the number of pending bytes reaches this value.
+     */
+    ZyanUSize threshold;
+    /**
+     * The flush function or `ZYAN_NULL` for memory sinks, which grow their buffer instead.
+     */
+    ZydisSinkFlushFunc flush;
+    /**
+     * User-defined data passed to the flush function.
+     */
+    void* user_data;
+} ZydisSink;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Initialization                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisSink` instance with a custom flush function.
+ *
+ * @param   sink        A pointer to the `ZydisSink` instance.
+ * @param   buffer      A pointer to the buffer that receives the output.
+ * @param   capacity    The capacity of the buffer. Has to be at least `ZYDIS_SINK_LINE_LENGTH`.
+ * @param   threshold   The number of pending bytes that triggers a flush.
+ * @param   flush       The flush function.
+ * @param   user_data   User-defined data passed to the flush function. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkInit(ZydisSink* sink, char* buffer, ZyanUSize capacity,
+    ZyanUSize threshold, ZydisSinkFlushFunc flush, void* user_data);
+
+#ifndef ZYAN_NO_LIBC
+
+/**
+ * Initializes the given `ZydisSink` instance with a `FILE` stream.
+ *
+ * @param   sink        A pointer to the `ZydisSink` instance.
+ * @param   buffer      A pointer to the buffer that receives the output.
+ * @param   capacity    The capacity of the buffer. Has to be at least `ZYDIS_SINK_LINE_LENGTH`.
+ * @param   file        The output stream.
+ *
+ * @return  A zyan status code.
+ *
+ * The buffer is written with a single `fwrite` call once it is full.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkInitFile(ZydisSink* sink, char* buffer, ZyanUSize capacity,
+    ZYAN_FILE* file);
+
+/**
+ * Initializes the given `ZydisSink` instance with a growable memory region.
+ *
+ * @param   sink        A pointer to the `ZydisSink` instance.
+ * @param   capacity    The initial capacity of the memory region.
+ *
+ * @return  A zyan status code.
+ *
+ * The output accumulates in `sink->data` (`sink->size` bytes) until the sink is destroyed using
+ * `ZydisSinkDestroy`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkInitMemory(ZydisSink* sink, ZyanUSize capacity);
+
+#endif
+
+#if defined(ZYAN_POSIX) && !defined(ZYAN_NO_LIBC)
+
+/**
+ * Initializes the given `ZydisSink` instance with a file descriptor.
+ *
+ * @param   sink        A pointer to the `ZydisSink` instance.
+ * @param   buffer      A pointer to the buffer that receives the output.
+ * @param   capacity    The capacity of the buffer. Has to be at least `ZYDIS_SINK_LINE_LENGTH`.
+ * @param   fd          The file descriptor.
+ *
+ * @return  A zyan status code.
+ *
+ * The buffer is written using `write` once it is full. Partial writes and interrupted calls are
+ * retried.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkInitFd(ZydisSink* sink, char* buffer, ZyanUSize capacity,
+    int fd);
+
+#endif
+
+/**
+ * Flushes and finalizes the given `ZydisSink` instance.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ *
+ * @return  A zyan status code.
+ *
+ * This releases the memory region of memory sinks.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkDestroy(ZydisSink* sink);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Writes all pending bytes to the output.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkFlush(ZydisSink* sink);
+
+/**
+ * Returns a pointer to at least `length` free bytes at the end of the sink buffer.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   length  The number of bytes to reserve.
+ * @param   buffer  Receives a pointer to the reserved bytes.
+ *
+ * @return  A zyan status code.
+ *
+ * The bytes are not part of the output until they are committed using `ZydisSinkCommit`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkReserve(ZydisSink* sink, ZyanUSize length, char** buffer);
+
+/**
+ * Appends bytes previously written to the buffer returned by `ZydisSinkReserve` to the output.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   length  The number of bytes to commit.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkCommit(ZydisSink* sink, ZyanUSize length);
+
+/**
+ * Appends the given data to the output.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   data    A pointer to the data.
+ * @param   length  The length of the data.
+ *
+ * @return  A zyan status code.
+ *
+ * Data that does not fit into the buffer is passed directly to the flush function.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkWrite(ZydisSink* sink, const void* data, ZyanUSize length);
+
+/**
+ * Formats the given instruction directly into the sink buffer and terminates it with a newline.
+ *
+ * @param   sink            A pointer to the `ZydisSink` instance.
+ * @param   formatter       A pointer to the `ZydisFormatter` instance.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to the decoded operands array.
+ * @param   operand_count   The length of the `operands` array. Must be equal to or greater than
+ *                          the value of `instruction->operand_count_visible`.
+ * @param   runtime_address The runtime address of the instruction or `ZYDIS_RUNTIME_ADDRESS_NONE`
+ *                          to print relative addresses.
+ * @param   user_data       A pointer to user-defined data which can be used in custom formatter
+ *                          callbacks. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSinkFormatInstruction(ZydisSink* sink,
+    const ZydisFormatter* formatter, const ZydisDecodedInstruction* instruction,
+    const ZydisDecodedOperand* operands, ZyanU8 operand_count, ZyanU64 runtime_address,
+    void* user_data);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_SINK_H */
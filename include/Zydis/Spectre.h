@@ -0,0 +1,276 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for finding speculative execution (Spectre variant 1) gadgets in machine code.
+ */
+
+#ifndef ZYDIS_SPECTRE_H
+#define ZYDIS_SPECTRE_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup spectre Spectre
+ * Functions for finding speculative execution (Spectre variant 1) gadgets in machine code.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The default number of instructions that are analyzed on each path of a conditional branch.
+ */
+#define ZYDIS_SPECTRE_DEFAULT_WINDOW 32
+
+/**
+ * The number of entries in a `ZydisSpectreArena`. Must be a power of two.
+ */
+#define ZYDIS_SPECTRE_ARENA_ENTRY_COUNT 4096
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Gadget                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Describes a single gadget candidate.
+ */
+typedef struct ZydisSpectreGadget_
+{
+    /**
+     * The runtime address of the conditional branch.
+     */
+    ZyanU64 branch;
+    /**
+     * Signals, if the gadget is on the taken path of the branch.
+     */
+    ZyanBool is_taken;
+    /**
+     * The runtime address of the load that is indexed by a register checked by the branch.
+     */
+    ZyanU64 load;
+    /**
+     * The runtime address of the load that depends on the value returned by `load`.
+     */
+    ZyanU64 dependent_load;
+} ZydisSpectreGadget;
+
+/**
+ * Defines the `ZydisSpectreCallback` function prototype.
+ *
+ * @param   gadget      A pointer to the `ZydisSpectreGadget` struct.
+ * @param   user_data   A pointer to user-defined data.
+ *
+ * @return  A zyan status code.
+ *
+ * Returning a status code other than `ZYAN_STATUS_SUCCESS` stops the scan and passes the status
+ * code to the caller.
+ */
+typedef ZyanStatus (*ZydisSpectreCallback)(const ZydisSpectreGadget* gadget, void* user_data);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arena                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisSpectreArenaEntry` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisSpectreArenaEntry_
+{
+    /**
+     * The generation this entry was filled in.
+     */
+    ZyanU32 generation;
+    /**
+     * The offset of the instruction.
+     */
+    ZyanU32 offset;
+    /**
+     * The offset of the branch target or `ZYAN_UINT32_MAX`.
+     */
+    ZyanU32 target;
+    /**
+     * The general purpose registers read by the instruction (one bit per register id).
+     */
+    ZyanU16 read;
+    /**
+     * The general purpose registers written by the instruction.
+     */
+    ZyanU16 write;
+    /**
+     * The general purpose registers used to address memory that is read.
+     */
+    ZyanU16 address;
+    /**
+     * The length of the instruction or `0`, if the instruction is invalid.
+     */
+    ZyanU8 length;
+    /**
+     * Instruction properties.
+     */
+    ZyanU8 flags;
+} ZydisSpectreArenaEntry;
+
+/**
+ * Defines the `ZydisSpectreArena` struct.
+ *
+ * The arena caches a compact summary of every decoded instruction, so the instructions in the
+ * speculation window of neighbouring branches are only decoded once. An arena must not be used by
+ * multiple threads at the same time. Use one arena per thread instead.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisSpectreArena_
+{
+    /**
+     * The current generation. Incremented for every scan to invalidate all entries.
+     */
+    ZyanU32 generation;
+    /**
+     * The cache entries.
+     */
+    ZydisSpectreArenaEntry entries[ZYDIS_SPECTRE_ARENA_ENTRY_COUNT];
+} ZydisSpectreArena;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Scanner                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisSpectreScanner` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisSpectreScanner_
+{
+    /**
+     * The decoder.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The number of instructions that are analyzed on each path of a conditional branch.
+     */
+    ZyanU32 window;
+} ZydisSpectreScanner;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Initializes the given `ZydisSpectreScanner` instance.
+ *
+ * @param   scanner         A pointer to the `ZydisSpectreScanner` instance.
+ * @param   machine_mode    The machine mode of the code.
+ * @param   stack_width     The stack width of the code.
+ * @param   window          The number of instructions that are analyzed on each path of a
+ *                          conditional branch, e.g. `ZYDIS_SPECTRE_DEFAULT_WINDOW`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSpectreScannerInit(ZydisSpectreScanner* scanner,
+    ZydisMachineMode machine_mode, ZydisStackWidth stack_width, ZyanU32 window);
+
+/**
+ * Initializes the given `ZydisSpectreArena` instance.
+ *
+ * @param   arena   A pointer to the `ZydisSpectreArena` instance.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSpectreArenaInit(ZydisSpectreArena* arena);
+
+/**
+ * Scans the given code for Spectre variant 1 gadget candidates.
+ *
+ * @param   scanner         A pointer to the `ZydisSpectreScanner` instance.
+ * @param   arena           A pointer to the `ZydisSpectreArena` instance of the current thread.
+ * @param   buffer          A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the first byte.
+ * @param   begin           The offset of the first byte that is searched for conditional
+ *                          branches.
+ * @param   end             The offset of the last byte (exclusive) that is searched for
+ *                          conditional branches.
+ * @param   callback        The callback that is invoked for every gadget candidate.
+ * @param   user_data       A pointer to user-defined data passed to the callback.
+ *
+ * @return  A zyan status code.
+ *
+ * The range between `begin` and `end` is swept linearly. For every signed or unsigned relational
+ * conditional branch, the general purpose registers read by the preceding flag-modifying
+ * instruction are considered attacker-controlled. Both the fall-through and the taken path are
+ * then followed for up to `window` instructions while propagating taint through the register
+ * operands:
+ *
+ * - a load addressed by an attacker-controlled register taints its destination as secret
+ * - a load addressed by a secret register is reported as a gadget candidate
+ *
+ * Paths end at `lfence`, serializing instructions, calls, returns and indirect branches. Paths may
+ * leave the `begin`/`end` range, but never the buffer.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisSpectreScan(const ZydisSpectreScanner* scanner,
+    ZydisSpectreArena* arena, const void* buffer, ZyanUSize length, ZyanU64 runtime_address,
+    ZyanUSize begin, ZyanUSize end, ZydisSpectreCallback callback, void* user_data);
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_SPECTRE_H */
@@ -0,0 +1,582 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for compressing and decompressing traces of executed instructions.
+ */
+
+#ifndef ZYDIS_TRACE_H
+#define ZYDIS_TRACE_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/DecoderTypes.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup trace Trace compression
+ * Functions for compressing and decompressing traces of executed instructions.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Marks an unknown or absent dictionary entry.
+ */
+#define ZYDIS_TRACE_NO_ENTRY            0xFFFFFFFF
+
+/**
+ * The maximum number of instructions per trace segment.
+ */
+#define ZYDIS_TRACE_SEGMENT_LENGTH      0x10000
+
+/**
+ * The depth of the shadow call stack used to predict return addresses.
+ */
+#define ZYDIS_TRACE_STACK_DEPTH         64
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Dictionary                                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisTraceFlow` enum.
+ *
+ * Describes how the successor of an instruction is determined.
+ */
+typedef enum ZydisTraceFlow_
+{
+    /**
+     * The instruction is followed by the next instruction.
+     */
+    ZYDIS_TRACE_FLOW_SEQUENTIAL,
+    /**
+     * A relative conditional branch. The successor is encoded as a taken/not-taken bit.
+     */
+    ZYDIS_TRACE_FLOW_CONDITIONAL,
+    /**
+     * A relative jump.
+     */
+    ZYDIS_TRACE_FLOW_JUMP,
+    /**
+     * A relative call.
+     */
+    ZYDIS_TRACE_FLOW_CALL,
+    /**
+     * An indirect or far jump. The successor is encoded as an entry id.
+     */
+    ZYDIS_TRACE_FLOW_INDIRECT_JUMP,
+    /**
+     * An indirect or far call. The successor is encoded as an entry id.
+     */
+    ZYDIS_TRACE_FLOW_INDIRECT_CALL,
+    /**
+     * A return. The successor is encoded as a single bit, if it matches the return address
+     * predicted by the shadow call stack, or as an entry id.
+     */
+    ZYDIS_TRACE_FLOW_RETURN,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_TRACE_FLOW_MAX_VALUE = ZYDIS_TRACE_FLOW_RETURN,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_TRACE_FLOW_REQUIRED_BITS = ZYAN_BITS_TO_REPRESENT(ZYDIS_TRACE_FLOW_MAX_VALUE)
+} ZydisTraceFlow;
+
+/**
+ * Defines the `ZydisTraceEntry` struct.
+ *
+ * Every unique instruction (address and raw bytes) of a trace is stored once in the dictionary.
+ */
+typedef struct ZydisTraceEntry_
+{
+    /**
+     * The runtime address of the instruction.
+     */
+    ZyanU64 address;
+    /**
+     * The absolute target address of relative branches.
+     */
+    ZyanU64 target_address;
+    /**
+     * The entry that follows the instruction when it does not branch. For calls, this is the
+     * entry at the return address.
+     */
+    ZyanU32 next;
+    /**
+     * The entry at the target of relative branches.
+     */
+    ZyanU32 target;
+    /**
+     * The length of the instruction.
+     */
+    ZyanU8 length;
+    /**
+     * The `ZydisTraceFlow` of the instruction.
+     */
+    ZyanU8 flow;
+    /**
+     * Signals, if the instruction has an explicit memory operand, whose address is recorded.
+     */
+    ZyanBool has_memory;
+    /**
+     * The raw bytes of the instruction.
+     */
+    ZyanU8 bytes[ZYDIS_MAX_INSTRUCTION_LENGTH];
+} ZydisTraceEntry;
+
+/**
+ * Defines the `ZydisTraceState` struct.
+ *
+ * The control-flow state shared by the encoder and the reader.
+ */
+typedef struct ZydisTraceState_
+{
+    /**
+     * The entry of the previous instruction.
+     */
+    ZyanU32 previous;
+    /**
+     * The call entry popped by the previous instruction, if it was a return.
+     */
+    ZyanU32 call;
+    /**
+     * The number of valid elements of the shadow call stack.
+     */
+    ZyanU32 depth;
+    /**
+     * The index of the next free element of the shadow call stack (modulo the stack depth).
+     */
+    ZyanU32 top;
+    /**
+     * The shadow call stack.
+     */
+    ZyanU32 stack[ZYDIS_TRACE_STACK_DEPTH];
+} ZydisTraceState;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Encoder                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisTraceWriteFunc` function prototype.
+ *
+ * @param   user_data   User-defined data passed to `ZydisTraceEncoderInit`.
+ * @param   data        A pointer to the data.
+ * @param   length      The length of the data.
+ *
+ * @return  A zyan status code.
+ *
+ * The function has to write all of the given data.
+ */
+typedef ZyanStatus (*ZydisTraceWriteFunc)(void* user_data, const void* data, ZyanUSize length);
+
+/**
+ * Defines the `ZydisTraceEncoder` struct.
+ *
+ * All fields are considered private and should not be accessed directly.
+ */
+typedef struct ZydisTraceEncoder_
+{
+    /**
+     * The decoder used to add new instructions to the dictionary.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The write function.
+     */
+    ZydisTraceWriteFunc write;
+    /**
+     * User-defined data passed to the write function.
+     */
+    void* user_data;
+    /**
+     * The number of bytes written so far.
+     */
+    ZyanU64 position;
+    /**
+     * The number of encoded instructions.
+     */
+    ZyanU64 instruction_count;
+    /**
+     * The dictionary.
+     */
+    ZydisTraceEntry* entries;
+    /**
+     * The number of dictionary entries.
+     */
+    ZyanU32 entry_count;
+    /**
+     * The maximum number of dictionary entries.
+     */
+    ZyanU32 entry_capacity;
+    /**
+     * A hash table that maps addresses to the most recent entry for that address.
+     */
+    ZyanU32* table;
+    /**
+     * The number of hash table slots minus one.
+     */
+    ZyanU32 table_mask;
+    /**
+     * The last memory address of every entry.
+     */
+    ZyanU64* memory;
+    /**
+     * The stream buffers of the current segment.
+     */
+    ZyanU8* segment;
+    /**
+     * The number of instructions in the current segment.
+     */
+    ZyanU32 segment_length;
+    /**
+     * The index of the last event in the current segment.
+     */
+    ZyanU32 last_event;
+    /**
+     * The used bytes of the event stream.
+     */
+    ZyanUSize events_size;
+    /**
+     * The number of bits in the branch stream.
+     */
+    ZyanUSize bit_count;
+    /**
+     * The used bytes of the target stream.
+     */
+    ZyanUSize targets_size;
+    /**
+     * The used bytes of the memory stream.
+     */
+    ZyanUSize memory_size;
+    /**
+     * The control-flow state.
+     */
+    ZydisTraceState state;
+} ZydisTraceEncoder;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reader                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisTraceStep` struct.
+ *
+ * Describes a single executed instruction.
+ */
+typedef struct ZydisTraceStep_
+{
+    /**
+     * The runtime address of the instruction.
+     */
+    ZyanU64 address;
+    /**
+     * The address of the explicit memory operand or `0`.
+     */
+    ZyanU64 memory_address;
+    /**
+     * The dictionary entry of the instruction.
+     */
+    ZyanU32 entry;
+} ZydisTraceStep;
+
+/**
+ * Defines the `ZydisTraceReader` struct.
+ *
+ * All fields are considered private and should not be accessed directly.
+ */
+typedef struct ZydisTraceReader_
+{
+    /**
+     * The decoder used to rebuild instructions.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The next segment.
+     */
+    const ZyanU8* data;
+    /**
+     * The end of the last segment.
+     */
+    const ZyanU8* data_end;
+    /**
+     * The dictionary.
+     */
+    ZydisTraceEntry* entries;
+    /**
+     * The number of dictionary entries.
+     */
+    ZyanU32 entry_count;
+    /**
+     * The last memory address of every entry.
+     */
+    ZyanU64* memory;
+    /**
+     * The decoded instruction of every entry or `ZYAN_NULL`, if instructions are not cached.
+     */
+    ZydisDecodedInstruction* cache;
+    /**
+     * The total number of instructions.
+     */
+    ZyanU64 instruction_count;
+    /**
+     * The number of instructions read so far.
+     */
+    ZyanU64 instruction_index;
+    /**
+     * The number of remaining instructions in the current segment.
+     */
+    ZyanU32 segment_remaining;
+    /**
+     * The number of instructions until the next event.
+     */
+    ZyanU32 event_distance;
+    /**
+     * The event stream of the current segment.
+     */
+    const ZyanU8* events;
+    /**
+     * The end of the event stream.
+     */
+    const ZyanU8* events_end;
+    /**
+     * The branch stream of the current segment.
+     */
+    const ZyanU8* bits;
+    /**
+     * The number of bits in the branch stream.
+     */
+    ZyanUSize bit_count;
+    /**
+     * The index of the next bit.
+     */
+    ZyanUSize bit_index;
+    /**
+     * The target stream of the current segment.
+     */
+    const ZyanU8* targets;
+    /**
+     * The end of the target stream.
+     */
+    const ZyanU8* targets_end;
+    /**
+     * The memory stream of the current segment.
+     */
+    const ZyanU8* memory_stream;
+    /**
+     * The end of the memory stream.
+     */
+    const ZyanU8* memory_stream_end;
+    /**
+     * The control-flow state.
+     */
+    ZydisTraceState state;
+} ZydisTraceReader;
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Encoder                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the size of the workspace required for a `ZydisTraceEncoder`.
+ *
+ * @param   entry_capacity  The maximum number of unique instructions.
+ * @param   size            Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceEncoderGetWorkspaceSize(ZyanU32 entry_capacity,
+    ZyanUSize* size);
+
+/**
+ * Initializes the given `ZydisTraceEncoder` instance and writes the trace header.
+ *
+ * @param   encoder         A pointer to the `ZydisTraceEncoder` instance.
+ * @param   machine_mode    The machine mode of the traced code.
+ * @param   stack_width     The stack width of the traced code.
+ * @param   entry_capacity  The maximum number of unique instructions.
+ * @param   workspace       A pointer to the workspace memory. The memory must be aligned to 8
+ *                          bytes and must stay valid for the lifetime of the encoder.
+ * @param   workspace_size  The size of the workspace in bytes, as returned by
+ *                          `ZydisTraceEncoderGetWorkspaceSize`.
+ * @param   write           The write function.
+ * @param   user_data       User-defined data passed to the write function. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceEncoderInit(ZydisTraceEncoder* encoder,
+    ZydisMachineMode machine_mode, ZydisStackWidth stack_width, ZyanU32 entry_capacity,
+    void* workspace, ZyanUSize workspace_size, ZydisTraceWriteFunc write, void* user_data);
+
+/**
+ * Appends an executed instruction to the trace.
+ *
+ * @param   encoder         A pointer to the `ZydisTraceEncoder` instance.
+ * @param   address         The runtime address of the instruction.
+ * @param   buffer          A pointer to the raw bytes of the instruction.
+ * @param   length          The number of available bytes. Trailing bytes that do not belong to
+ *                          the instruction are ignored.
+ * @param   memory_address  The address of the explicit memory operand. Ignored for instructions
+ *                          without one.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE` is returned, if the
+ *          dictionary is full.
+ *
+ * Instructions that follow their predecessor as predicted by the dictionary (sequential flow,
+ * relative branches and returns to the predicted return address) are encoded with at most one
+ * bit. All other transitions are encoded as entry ids. Memory addresses are encoded as the
+ * difference to the previous address of the same instruction.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceEncoderAppend(ZydisTraceEncoder* encoder, ZyanU64 address,
+    const void* buffer, ZyanUSize length, ZyanU64 memory_address);
+
+/**
+ * Writes the pending segment, the dictionary and the trailer.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceEncoderFinish(ZydisTraceEncoder* encoder);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reader                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the size of the workspace required to read the given trace.
+ *
+ * @param   data                A pointer to the trace.
+ * @param   length              The length of the trace.
+ * @param   cache_instructions  Signals, if decoded instructions should be cached.
+ * @param   size                Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceReaderGetWorkspaceSize(const void* data, ZyanUSize length,
+    ZyanBool cache_instructions, ZyanUSize* size);
+
+/**
+ * Initializes the given `ZydisTraceReader` instance.
+ *
+ * @param   reader              A pointer to the `ZydisTraceReader` instance.
+ * @param   data                A pointer to the trace. The memory must stay valid for the
+ *                              lifetime of the reader.
+ * @param   length              The length of the trace.
+ * @param   cache_instructions  Signals, if decoded instructions should be cached.
+ * @param   workspace           A pointer to the workspace memory. The memory must be aligned to
+ *                              8 bytes and must stay valid for the lifetime of the reader.
+ * @param   workspace_size      The size of the workspace in bytes, as returned by
+ *                              `ZydisTraceReaderGetWorkspaceSize`.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceReaderInit(ZydisTraceReader* reader, const void* data,
+    ZyanUSize length, ZyanBool cache_instructions, void* workspace, ZyanUSize workspace_size);
+
+/**
+ * Reads the next executed instructions.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ * @param   steps   A pointer to the array that receives the instructions.
+ * @param   count   The length of the `steps` array.
+ * @param   read    Receives the number of read instructions.
+ *
+ * @return  A zyan status code. `ZYDIS_STATUS_NO_MORE_DATA` is returned, if the end of the trace
+ *          has been reached before any instruction was read.
+ *
+ * The instructions are not decoded, see `ZydisTraceReaderDecodeInstruction`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceReaderRead(ZydisTraceReader* reader, ZydisTraceStep* steps,
+    ZyanUSize count, ZyanUSize* read);
+
+/**
+ * Returns a dictionary entry.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ * @param   entry   The id of the entry.
+ *
+ * @return  A pointer to the `ZydisTraceEntry` struct or `ZYAN_NULL`, if the id is invalid.
+ */
+ZYDIS_EXPORT const ZydisTraceEntry* ZydisTraceReaderGetEntry(const ZydisTraceReader* reader,
+    ZyanU32 entry);
+
+/**
+ * Decodes the instruction of a dictionary entry.
+ *
+ * @param   reader      A pointer to the `ZydisTraceReader` instance.
+ * @param   entry       The id of the entry.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct that receives the
+ *                      instruction.
+ *
+ * @return  A zyan status code.
+ *
+ * Instructions are only decoded on demand. If caching is enabled, every entry is decoded at most
+ * once.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisTraceReaderDecodeInstruction(ZydisTraceReader* reader,
+    ZyanU32 entry, ZydisDecodedInstruction* instruction);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_TRACE_H */
@@ -0,0 +1,364 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Functions for validating untrusted machine code against a sandbox policy.
+ */
+
+#ifndef ZYDIS_VALIDATOR_H
+#define ZYDIS_VALIDATOR_H
+
+#include <Zycore/Defines.h>
+#include <Zycore/Types.h>
+#include <Zydis/Decoder.h>
+#include <Zydis/Status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup validator Validator
+ * Functions for validating untrusted machine code against a sandbox policy.
+ * @{
+ */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The default bundle size in bytes.
+ */
+#define ZYDIS_VALIDATOR_DEFAULT_BUNDLE_SIZE 32
+
+/**
+ * The maximum number of instruction definitions covered by the allow bits of a validator.
+ */
+#define ZYDIS_VALIDATOR_MAX_DEFINITIONS 10240
+
+/**
+ * The number of entries in the instruction cache of a validator. Must be a power of two.
+ */
+#define ZYDIS_VALIDATOR_CACHE_SIZE 4096
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Violation                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisValidatorViolationType` enum.
+ */
+typedef enum ZydisValidatorViolationType_
+{
+    /**
+     * The code does not violate the policy.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_NONE,
+    /**
+     * The bytes at the reported offset could not be decoded to a valid instruction.
+     *
+     * This includes instructions that are truncated by the end of the input buffer.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION,
+    /**
+     * The mnemonic of the instruction is not on the allowlist.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_MNEMONIC,
+    /**
+     * The ISA-set of the instruction is not on the allowlist.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_ISA_SET,
+    /**
+     * The instruction is privileged.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_PRIVILEGED,
+    /**
+     * The instruction transfers control to the operating system (e.g. `syscall`, `sysenter`,
+     * `int n`).
+     */
+    ZYDIS_VALIDATOR_VIOLATION_SYSTEM_CALL,
+    /**
+     * The instruction is a breakpoint or raises a trap on purpose (`int3`, `int1`, `into`,
+     * `bound`, `ud0`, `ud1`, `ud2`).
+     */
+    ZYDIS_VALIDATOR_VIOLATION_BREAKPOINT,
+    /**
+     * The instruction crosses a bundle boundary.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_MAX_VALUE = ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_VALIDATOR_VIOLATION_REQUIRED_BITS =
+        ZYAN_BITS_TO_REPRESENT(ZYDIS_VALIDATOR_VIOLATION_MAX_VALUE)
+} ZydisValidatorViolationType;
+
+/**
+ * Describes the first policy violation found by the validator.
+ */
+typedef struct ZydisValidatorViolation_
+{
+    /**
+     * The violation type.
+     */
+    ZydisValidatorViolationType type;
+    /**
+     * The offset of the offending instruction, relative to the start of the validated stream.
+     */
+    ZyanU64 offset;
+    /**
+     * The mnemonic of the offending instruction or `ZYDIS_MNEMONIC_INVALID`, if the instruction
+     * could not be decoded.
+     */
+    ZydisMnemonic mnemonic;
+    /**
+     * The length of the offending instruction or `0`, if the instruction could not be decoded.
+     */
+    ZyanU8 length;
+    /**
+     * The decoder status code for `ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION` violations.
+     */
+    ZyanStatus status;
+} ZydisValidatorViolation;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Policy                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisValidatorPolicy` struct.
+ *
+ * Use `ZydisValidatorPolicyInit` to initialize the policy and the `ZydisValidatorPolicy*`
+ * functions to modify the allowlists. The boolean fields can be changed directly.
+ */
+typedef struct ZydisValidatorPolicy_
+{
+    /**
+     * One allow bit for each mnemonic.
+     */
+    ZyanU64 mnemonics[(ZYDIS_MNEMONIC_MAX_VALUE + 64) / 64];
+    /**
+     * One allow bit for each ISA-set.
+     */
+    ZyanU64 isa_sets[(ZYDIS_ISA_SET_MAX_VALUE + 64) / 64];
+    /**
+     * Signals, if privileged instructions are allowed.
+     */
+    ZyanBool allow_privileged;
+    /**
+     * Signals, if instructions transferring control to the operating system are allowed.
+     */
+    ZyanBool allow_system_calls;
+    /**
+     * Signals, if breakpoint and trap instructions are allowed.
+     */
+    ZyanBool allow_breakpoints;
+    /**
+     * The bundle size in bytes or `0`, if bundle boundaries should not be enforced.
+     */
+    ZyanU32 bundle_size;
+} ZydisValidatorPolicy;
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Validator                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisValidator` struct.
+ *
+ * All fields in this struct should be considered as "private". Any changes may lead to unexpected
+ * behavior.
+ */
+typedef struct ZydisValidator_
+{
+    /**
+     * The decoder used to find the instruction boundaries.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The policy to enforce.
+     */
+    const ZydisValidatorPolicy* policy;
+    /**
+     * The stream offset of the next byte to validate.
+     */
+    ZyanU64 offset;
+    /**
+     * The index of the first allow bit of each instruction encoding.
+     */
+    ZyanU16 definition_base[ZYDIS_INSTRUCTION_ENCODING_MAX_VALUE + 1];
+    /**
+     * One allow bit for each instruction definition.
+     */
+    ZyanU64 definitions[ZYDIS_VALIDATOR_MAX_DEFINITIONS / 64];
+    /**
+     * Signals, if the instruction cache is used.
+     */
+    ZyanBool use_cache;
+    /**
+     * The instruction cache.
+     *
+     * Maps the prefix, `REX`, opcode and ModRM bytes of allowed legacy instructions to the
+     * layout of the remaining instruction bytes.
+     */
+    ZyanU32 cache[ZYDIS_VALIDATOR_CACHE_SIZE];
+} ZydisValidator;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Policy                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisValidatorPolicy` instance.
+ *
+ * @param   policy  A pointer to the `ZydisValidatorPolicy` instance.
+ *
+ * @return  A zyan status code.
+ *
+ * The policy is initialized to reject all mnemonics and ISA-sets as well as privileged, system
+ * call and breakpoint instructions. The bundle size is set to `ZYDIS_VALIDATOR_DEFAULT_BUNDLE_SIZE`.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorPolicyInit(ZydisValidatorPolicy* policy);
+
+/**
+ * Adds or removes the given mnemonic to/from the allowlist.
+ *
+ * @param   policy      A pointer to the `ZydisValidatorPolicy` instance.
+ * @param   mnemonic    The mnemonic.
+ * @param   allowed     `ZYAN_TRUE` to allow the mnemonic or `ZYAN_FALSE` to reject it.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorPolicyAllowMnemonic(ZydisValidatorPolicy* policy,
+    ZydisMnemonic mnemonic, ZyanBool allowed);
+
+/**
+ * Adds or removes the given ISA-set to/from the allowlist.
+ *
+ * @param   policy      A pointer to the `ZydisValidatorPolicy` instance.
+ * @param   isa_set     The ISA-set.
+ * @param   allowed     `ZYAN_TRUE` to allow the ISA-set or `ZYAN_FALSE` to reject it.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorPolicyAllowISASet(ZydisValidatorPolicy* policy,
+    ZydisISASet isa_set, ZyanBool allowed);
+
+/**
+ * Changes the bundle size.
+ *
+ * @param   policy      A pointer to the `ZydisValidatorPolicy` instance.
+ * @param   bundle_size The bundle size in bytes. Must be a power of two or `0` to disable bundle
+ *                      boundary checks.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorPolicySetBundleSize(ZydisValidatorPolicy* policy,
+    ZyanU32 bundle_size);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Validator                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisValidator` instance.
+ *
+ * @param   validator       A pointer to the `ZydisValidator` instance.
+ * @param   machine_mode    The machine mode of the validated code.
+ * @param   stack_width     The stack width of the validated code.
+ * @param   policy          A pointer to the `ZydisValidatorPolicy` instance. The policy is not
+ *                          copied and must stay valid for the lifetime of the validator.
+ *
+ * @return  A zyan status code.
+ *
+ * The policy is turned into one allow bit per instruction definition. Changes to the policy are
+ * not picked up before the validator is initialized again.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorInit(ZydisValidator* validator,
+    ZydisMachineMode machine_mode, ZydisStackWidth stack_width,
+    const ZydisValidatorPolicy* policy);
+
+/**
+ * Validates the next chunk of the code stream.
+ *
+ * @param   validator   A pointer to the `ZydisValidator` instance.
+ * @param   buffer      A pointer to the code chunk.
+ * @param   length      The length of the code chunk.
+ * @param   violation   A pointer to the `ZydisValidatorViolation` struct that receives the first
+ *                      policy violation.
+ *
+ * @return  `ZYAN_STATUS_TRUE`, if the chunk does not violate the policy, `ZYAN_STATUS_FALSE`, if
+ *          it does, or another zyan status code, if an error occured.
+ *
+ * The code is validated in a single linear pass. Allowed instructions are only decoded up to the
+ * point required to determine their length and definition, operands are never decoded. In 32-
+ * and 64-bit mode, the layout of allowed legacy instructions is cached by their prefix, `REX`,
+ * opcode and ModRM bytes, so that repeated instruction forms are measured without decoding them.
+ *
+ * The code stream can be validated in multiple chunks by calling this function repeatedly. Every
+ * chunk must end on an instruction boundary. If bundle boundaries are enforced, splitting the
+ * stream at bundle boundaries always satisfies this requirement for valid code. Offsets reported
+ * in `violation` are relative to the start of the whole stream.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisValidatorValidate(ZydisValidator* validator, const void* buffer,
+    ZyanUSize length, ZydisValidatorViolation* violation);
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ZYDIS_VALIDATOR_H */
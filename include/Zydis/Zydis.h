@@ -54,6 +54,31 @@
 
 #if !defined(ZYDIS_DISABLE_DECODER) && !defined(ZYDIS_DISABLE_FORMATTER)
 #   include <Zydis/Disassembler.h>
+#   include <Zydis/Sink.h>
+#endif
+
+#if !defined(ZYDIS_DISABLE_DECODER) && !defined(ZYDIS_MINIMAL_MODE)
+#   include <Zydis/Validator.h>
+#   include <Zydis/Linter.h>
+#   include <Zydis/AvxTransition.h>
+#   include <Zydis/Ibt.h>
+#   include <Zydis/Spectre.h>
+#   include <Zydis/SampleMap.h>
+#   include <Zydis/BoundaryBitmap.h>
+#   include <Zydis/Columnar.h>
+#   include <Zydis/Trace.h>
+#endif
+
+#if !defined(ZYDIS_DISABLE_DECODER) && !defined(ZYDIS_DISABLE_ENCODER) && \
+    !defined(ZYDIS_MINIMAL_MODE)
+#   include <Zydis/Scheduler.h>
+#   include <Zydis/Patch.h>
+#   include <Zydis/Jit.h>
+#   include <Zydis/Rename.h>
+#endif
+
+#if !defined(ZYDIS_DISABLE_ENCODER) && !defined(ZYAN_NO_LIBC) && defined(ZYAN_LINUX)
+#   include <Zydis/CodeBuffer.h>
 #endif
 
 #include <Zydis/MetaInfo.h>
@@ -137,11 +162,12 @@ typedef enum ZydisFeature_
     ZYDIS_FEATURE_AVX512,
     ZYDIS_FEATURE_KNC,
     ZYDIS_FEATURE_SEGMENT,
+    ZYDIS_FEATURE_HUGE_PAGE_TABLES,
 
     /**
      * Maximum value of this enum.
      */
-    ZYDIS_FEATURE_MAX_VALUE = ZYDIS_FEATURE_SEGMENT,
+    ZYDIS_FEATURE_MAX_VALUE = ZYDIS_FEATURE_HUGE_PAGE_TABLES,
     /**
      * The minimum number of bits required to represent all values of this enum.
      */
@@ -172,6 +198,22 @@ ZYDIS_EXPORT ZyanU64 ZydisGetVersion(void);
  */
 ZYDIS_EXPORT ZyanStatus ZydisIsFeatureEnabled(ZydisFeature feature);
 
+/**
+ * Backs the generated data tables with huge pages.
+ *
+ * @return  A zyan status code. `ZYAN_STATUS_INVALID_OPERATION` is returned, if the library was
+ *          not built with `ZYDIS_HUGE_PAGE_TABLES`, the platform is not Linux or the huge pages
+ *          covering the tables would also cover memory that is not read-only.
+ *
+ * The tables are placed in a dedicated section that is aligned to 2 MiB. This function copies
+ * every 2 MiB chunk of the section to an anonymous mapping that is advised to use transparent
+ * huge pages and atomically moves it over the original mapping. The contents and protection of
+ * the memory do not change, so it is safe to call this function while other threads use the
+ * library. Whether the kernel actually provides huge pages depends on the transparent huge page
+ * settings of the system.
+ */
+ZYDIS_EXPORT ZyanStatus ZydisMapTablesToHugePages(void);
+
 /* ============================================================================================== */
 
 /**
@@ -0,0 +1,401 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/AvxTransition.h>
+#include <Zydis/Utils.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The instruction at this offset is reachable with a clean upper state.
+ */
+#define ZYDIS_AVX_TRANSITION_STATE_CLEAN    0x01
+/**
+ * The instruction at this offset is reachable with a dirty upper state.
+ */
+#define ZYDIS_AVX_TRANSITION_STATE_DIRTY    0x02
+/**
+ * The offset is currently on the worklist.
+ */
+#define ZYDIS_AVX_TRANSITION_STATE_PENDING  0x04
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Instruction classification                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the effect of an instruction on the upper state.
+ */
+typedef struct ZydisAvxTransitionEffect_
+{
+    /**
+     * Signals, if the instruction is a legacy-encoded instruction that accesses `XMM` registers.
+     */
+    ZyanBool is_sse;
+    /**
+     * Signals, if the instruction leaves the upper state dirty.
+     */
+    ZyanBool makes_dirty;
+    /**
+     * Signals, if the instruction leaves the upper state clean.
+     */
+    ZyanBool makes_clean;
+} ZydisAvxTransitionEffect;
+
+/**
+ * Determines the effect of the given instruction on the upper state.
+ *
+ * @param   decoder     A pointer to the `ZydisDecoder` instance.
+ * @param   context     A pointer to the decoder context of the instruction.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   effect      Receives the effect of the instruction.
+ */
+static void ZydisAvxTransitionGetEffect(const ZydisDecoder* decoder,
+    const ZydisDecoderContext* context, const ZydisDecodedInstruction* instruction,
+    ZydisAvxTransitionEffect* effect)
+{
+    ZYAN_MEMSET(effect, 0, sizeof(*effect));
+
+    if ((instruction->mnemonic == ZYDIS_MNEMONIC_VZEROUPPER) ||
+        (instruction->mnemonic == ZYDIS_MNEMONIC_VZEROALL))
+    {
+        effect->makes_clean = ZYAN_TRUE;
+        return;
+    }
+
+    const ZyanBool is_legacy = (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_LEGACY);
+    if (is_legacy && (instruction->meta.isa_ext == ZYDIS_ISA_EXT_BASE))
+    {
+        // General purpose instructions never access vector registers, so we can skip the
+        // comparatively expensive operand decoding
+        return;
+    }
+    if ((instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_3DNOW) ||
+        (instruction->meta.isa_ext == ZYDIS_ISA_EXT_X87) ||
+        (instruction->meta.isa_ext == ZYDIS_ISA_EXT_MMX))
+    {
+        return;
+    }
+
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (!ZYAN_SUCCESS(ZydisDecoderDecodeOperands(decoder, context, instruction, operands,
+        instruction->operand_count)))
+    {
+        return;
+    }
+
+    for (ZyanU8 i = 0; i < instruction->operand_count; ++i)
+    {
+        if (operands[i].type != ZYDIS_OPERAND_TYPE_REGISTER)
+        {
+            continue;
+        }
+        switch (ZydisRegisterGetClass(operands[i].reg.value))
+        {
+        case ZYDIS_REGCLASS_XMM:
+            effect->is_sse |= is_legacy;
+            break;
+        case ZYDIS_REGCLASS_YMM:
+        case ZYDIS_REGCLASS_ZMM:
+            effect->makes_dirty |= !is_legacy &&
+                (operands[i].actions & ZYDIS_OPERAND_ACTION_MASK_WRITE);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * Checks if the given instruction terminates the control flow.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if execution never continues with the next instruction or `ZYAN_FALSE`,
+ *          if it might.
+ */
+static ZyanBool ZydisAvxTransitionIsTerminator(const ZydisDecodedInstruction* instruction)
+{
+    switch (instruction->meta.category)
+    {
+    case ZYDIS_CATEGORY_RET:
+    case ZYDIS_CATEGORY_UNCOND_BR:
+        return ZYAN_TRUE;
+    default:
+        break;
+    }
+
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_HLT:
+    case ZYDIS_MNEMONIC_INT3:
+    case ZYDIS_MNEMONIC_UD0:
+    case ZYDIS_MNEMONIC_UD1:
+    case ZYDIS_MNEMONIC_UD2:
+        return ZYAN_TRUE;
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Calculates the offset of the target of a relative branch.
+ *
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   runtime_address The runtime address of the function.
+ * @param   offset          The offset of the instruction.
+ * @param   length          The length of the function.
+ * @param   target          Receives the offset of the branch target.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction is a relative branch into the function or `ZYAN_FALSE`,
+ *          if not.
+ */
+static ZyanBool ZydisAvxTransitionGetTarget(const ZydisDecodedInstruction* instruction,
+    ZyanU64 runtime_address, ZyanUSize offset, ZyanUSize length, ZyanUSize* target)
+{
+    if (!instruction->raw.imm[0].is_relative)
+    {
+        return ZYAN_FALSE;
+    }
+
+    ZyanU64 address = runtime_address + offset + instruction->length +
+        instruction->raw.imm[0].value.s;
+    if (instruction->machine_mode != ZYDIS_MACHINE_MODE_LONG_64)
+    {
+        address &= (instruction->operand_width == 16) ? 0xFFFF : 0xFFFFFFFF;
+    }
+
+    if ((address < runtime_address) || (address - runtime_address >= length))
+    {
+        return ZYAN_FALSE;
+    }
+
+    *target = (ZyanUSize)(address - runtime_address);
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Worklist                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Merges the given state into the state of an instruction and queues the instruction, if its
+ * state changed.
+ *
+ * @param   states      A pointer to the per-byte state array.
+ * @param   worklist    A pointer to the worklist.
+ * @param   count       A pointer to the number of queued offsets.
+ * @param   offset      The offset of the instruction.
+ * @param   state       The incoming state.
+ */
+static void ZydisAvxTransitionMerge(ZyanU8* states, ZyanU32* worklist, ZyanUSize* count,
+    ZyanUSize offset, ZyanU8 state)
+{
+    if (!(state & ~states[offset]))
+    {
+        return;
+    }
+
+    states[offset] |= state;
+    if (!(states[offset] & ZYDIS_AVX_TRANSITION_STATE_PENDING))
+    {
+        // Every offset is queued at most once at a time, so the worklist never holds more than
+        // `length` entries
+        states[offset] |= ZYDIS_AVX_TRANSITION_STATE_PENDING;
+        worklist[(*count)++] = (ZyanU32)offset;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reporting                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Passes a hazard to the callback.
+ *
+ * @param   callback    The callback.
+ * @param   user_data   A pointer to user-defined data.
+ * @param   type        The hazard type.
+ * @param   offset      The offset of the affected instruction.
+ * @param   address     The runtime address of the affected instruction.
+ * @param   mnemonic    The mnemonic of the affected instruction.
+ *
+ * @return  The status code returned by the callback.
+ */
+static ZyanStatus ZydisAvxTransitionReport(ZydisAvxTransitionCallback callback, void* user_data,
+    ZydisAvxTransitionHazardType type, ZyanUSize offset, ZyanU64 address, ZydisMnemonic mnemonic)
+{
+    ZydisAvxTransitionHazard hazard;
+    hazard.type     = type;
+    hazard.offset   = offset;
+    hazard.address  = address;
+    hazard.mnemonic = mnemonic;
+
+    return callback(&hazard, user_data);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+ZyanStatus ZydisAvxTransitionGetWorkspaceSize(ZyanUSize length, ZyanUSize* size)
+{
+    if (!size || (length > ZYAN_UINT32_MAX))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *size = length * sizeof(ZyanU32) + length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisAvxTransitionAnalyze(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanU64 runtime_address, void* workspace, ZyanUSize workspace_size,
+    ZydisAvxTransitionCallback callback, void* user_data)
+{
+    if (!decoder || (!buffer && length) || (!workspace && length) || !callback ||
+        (decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize required_size;
+    ZYAN_CHECK(ZydisAvxTransitionGetWorkspaceSize(length, &required_size));
+    if (workspace_size < required_size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+    if (!length)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    ZyanU32* worklist = (ZyanU32*)workspace;
+    ZyanU8* states = (ZyanU8*)(worklist + length);
+    ZYAN_MEMSET(states, 0, length);
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZydisAvxTransitionEffect effect;
+
+    // Propagate the upper state along the control-flow graph until a fixpoint is reached
+    ZyanUSize count = 0;
+    ZydisAvxTransitionMerge(states, worklist, &count, 0, ZYDIS_AVX_TRANSITION_STATE_CLEAN);
+    while (count)
+    {
+        const ZyanUSize offset = worklist[--count];
+        states[offset] &= ~ZYDIS_AVX_TRANSITION_STATE_PENDING;
+
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+            length - offset, &instruction)))
+        {
+            continue;
+        }
+
+        ZydisAvxTransitionGetEffect(decoder, &context, &instruction, &effect);
+        ZyanU8 state = states[offset];
+        if (effect.makes_clean)
+        {
+            state = ZYDIS_AVX_TRANSITION_STATE_CLEAN;
+        }
+        else if (effect.makes_dirty)
+        {
+            state = ZYDIS_AVX_TRANSITION_STATE_DIRTY;
+        }
+
+        ZyanUSize target;
+        if (((instruction.meta.category == ZYDIS_CATEGORY_COND_BR) ||
+             (instruction.meta.category == ZYDIS_CATEGORY_UNCOND_BR)) &&
+            ZydisAvxTransitionGetTarget(&instruction, runtime_address, offset, length, &target))
+        {
+            ZydisAvxTransitionMerge(states, worklist, &count, target, state);
+        }
+        if (!ZydisAvxTransitionIsTerminator(&instruction) &&
+            (offset + instruction.length < length))
+        {
+            ZydisAvxTransitionMerge(states, worklist, &count, offset + instruction.length, state);
+        }
+    }
+
+    // Report the hazards in address order
+    for (ZyanUSize offset = 0; offset < length; ++offset)
+    {
+        if (!(states[offset] & ZYDIS_AVX_TRANSITION_STATE_DIRTY) ||
+            !ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+                length - offset, &instruction)))
+        {
+            continue;
+        }
+
+        const ZyanU64 address = runtime_address + offset;
+        ZydisAvxTransitionGetEffect(decoder, &context, &instruction, &effect);
+        if (effect.is_sse)
+        {
+            ZYAN_CHECK(ZydisAvxTransitionReport(callback, user_data,
+                ZYDIS_AVX_TRANSITION_HAZARD_SSE, offset, address, instruction.mnemonic));
+        }
+
+        ZyanUSize target;
+        switch (instruction.meta.category)
+        {
+        case ZYDIS_CATEGORY_CALL:
+            ZYAN_CHECK(ZydisAvxTransitionReport(callback, user_data,
+                ZYDIS_AVX_TRANSITION_HAZARD_CALL, offset, address, instruction.mnemonic));
+            break;
+        case ZYDIS_CATEGORY_UNCOND_BR:
+            // Direct jumps that leave the function are tail-calls
+            if (instruction.raw.imm[0].is_relative &&
+                !ZydisAvxTransitionGetTarget(&instruction, runtime_address, offset, length,
+                    &target))
+            {
+                ZYAN_CHECK(ZydisAvxTransitionReport(callback, user_data,
+                    ZYDIS_AVX_TRANSITION_HAZARD_CALL, offset, address, instruction.mnemonic));
+            }
+            break;
+        case ZYDIS_CATEGORY_RET:
+            ZYAN_CHECK(ZydisAvxTransitionReport(callback, user_data,
+                ZYDIS_AVX_TRANSITION_HAZARD_RETURN, offset, address, instruction.mnemonic));
+            break;
+        default:
+            break;
+        }
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,515 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/BoundaryBitmap.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The number of 64-bit words in a single superblock.
+ */
+#define ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS (ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_BITS / 64)
+
+/**
+ * The version of the serialized form.
+ */
+#define ZYDIS_BOUNDARY_BITMAP_VERSION 1
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Bit manipulation                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of set bits in the given value.
+ *
+ * @param   value   The value.
+ *
+ * @return  The number of set bits.
+ */
+ZYAN_INLINE ZyanU32 ZydisBoundaryBitmapPopcount(ZyanU64 value)
+{
+#if defined(ZYAN_GCC) || defined(ZYAN_CLANG)
+    return (ZyanU32)__builtin_popcountll(value);
+#else
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (ZyanU32)((value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * Returns the position of the set bit with the given rank.
+ *
+ * @param   value   The value.
+ * @param   rank    The zero-based rank of the set bit. Must be less than the number of set bits.
+ *
+ * @return  The bit position.
+ *
+ * The position is found by halving the search window six times, so the function takes the same
+ * time for every input.
+ */
+ZYAN_INLINE ZyanU32 ZydisBoundaryBitmapSelectInWord(ZyanU64 value, ZyanU32 rank)
+{
+    ZyanU32 position = 0;
+    for (ZyanU32 width = 32; width; width >>= 1)
+    {
+        const ZyanU32 count = ZydisBoundaryBitmapPopcount(value & ((1ULL << width) - 1));
+        const ZyanBool is_upper = (rank >= count);
+        rank -= is_upper ? count : 0;
+        value >>= is_upper ? width : 0;
+        position += is_upper ? width : 0;
+    }
+    return position;
+}
+
+/**
+ * Returns the number of set bits in front of the given word of a superblock.
+ *
+ * @param   relative    The packed relative counts of the superblock.
+ * @param   word        The index of the word in the superblock.
+ *
+ * @return  The number of set bits in front of the word.
+ */
+ZYAN_INLINE ZyanU32 ZydisBoundaryBitmapGetRelative(ZyanU64 relative, ZyanU32 word)
+{
+    return word ? (ZyanU32)((relative >> (9 * (word - 1))) & 0x1FF) : 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Construction                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of 64-bit words required for the bitmap of the given code length.
+ *
+ * @param   length  The length of the code.
+ *
+ * @return  The number of words.
+ */
+ZYAN_INLINE ZyanUSize ZydisBoundaryBitmapGetWordCount(ZyanUSize length)
+{
+    return (length + 63) / 64;
+}
+
+/**
+ * Returns the number of superblocks required for the bitmap of the given code length.
+ *
+ * @param   length  The length of the code.
+ *
+ * @return  The number of superblocks.
+ */
+ZYAN_INLINE ZyanUSize ZydisBoundaryBitmapGetSuperblockCount(ZyanUSize length)
+{
+    return (ZydisBoundaryBitmapGetWordCount(length) + ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS - 1) /
+        ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS;
+}
+
+/**
+ * Distributes the workspace memory and clears the bitmap.
+ *
+ * @param   bitmap          A pointer to the `ZydisBoundaryBitmap` instance.
+ * @param   length          The length of the code.
+ * @param   workspace       A pointer to the workspace memory.
+ * @param   workspace_size  The size of the workspace in bytes.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisBoundaryBitmapInit(ZydisBoundaryBitmap* bitmap, ZyanUSize length,
+    void* workspace, ZyanUSize workspace_size)
+{
+    if (!bitmap || !workspace || ((ZyanUPointer)workspace % sizeof(ZyanU64)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize size;
+    ZYAN_CHECK(ZydisBoundaryBitmapGetWorkspaceSize(length, &size));
+    if (workspace_size < size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    const ZyanUSize word_count = ZydisBoundaryBitmapGetWordCount(length);
+    const ZyanUSize superblock_count = ZydisBoundaryBitmapGetSuperblockCount(length);
+
+    ZYAN_MEMSET(bitmap, 0, sizeof(*bitmap));
+    bitmap->length = (ZyanU32)length;
+    bitmap->bits = (ZyanU64*)workspace;
+    bitmap->relative = bitmap->bits + word_count;
+    bitmap->absolute = (ZyanU32*)(bitmap->relative + superblock_count);
+    bitmap->samples = bitmap->absolute + superblock_count + 1;
+    ZYAN_MEMSET(bitmap->bits, 0, word_count * sizeof(ZyanU64));
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Builds the rank and select tables from the bitmap.
+ *
+ * @param   bitmap  A pointer to the `ZydisBoundaryBitmap` instance.
+ */
+static void ZydisBoundaryBitmapIndex(ZydisBoundaryBitmap* bitmap)
+{
+    const ZyanUSize word_count = ZydisBoundaryBitmapGetWordCount(bitmap->length);
+    const ZyanUSize superblock_count = ZydisBoundaryBitmapGetSuperblockCount(bitmap->length);
+
+    ZyanU32 count = 0;
+    ZyanU32 sample = 0;
+    for (ZyanUSize i = 0; i < superblock_count; ++i)
+    {
+        ZyanU64 relative = 0;
+        ZyanU32 total = 0;
+        for (ZyanU32 j = 0; j < ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS; ++j)
+        {
+            const ZyanUSize word = i * ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS + j;
+            if (j)
+            {
+                relative |= (ZyanU64)total << (9 * (j - 1));
+            }
+            total += (word < word_count) ?
+                ZydisBoundaryBitmapPopcount(bitmap->bits[word]) : 0;
+        }
+        bitmap->absolute[i] = count;
+        bitmap->relative[i] = relative;
+        count += total;
+
+        // Every sampled instruction start is located in the first superblock whose end lies
+        // behind it
+        while (((ZyanU64)sample << ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT) < count)
+        {
+            bitmap->samples[sample++] = (ZyanU32)i;
+        }
+    }
+    bitmap->absolute[superblock_count] = count;
+    bitmap->samples[sample] = (ZyanU32)superblock_count;
+    bitmap->count = count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Serialization                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Writes a little-endian value to the given buffer.
+ *
+ * @param   buffer  A pointer to the buffer.
+ * @param   value   The value.
+ * @param   size    The size of the value in bytes.
+ */
+static void ZydisBoundaryBitmapWriteLE(ZyanU8* buffer, ZyanU64 value, ZyanUSize size)
+{
+    for (ZyanUSize i = 0; i < size; ++i)
+    {
+        buffer[i] = (ZyanU8)(value >> (8 * i));
+    }
+}
+
+/**
+ * Reads a little-endian value from the given buffer.
+ *
+ * @param   buffer  A pointer to the buffer.
+ * @param   size    The size of the value in bytes.
+ *
+ * @return  The value.
+ */
+static ZyanU64 ZydisBoundaryBitmapReadLE(const ZyanU8* buffer, ZyanUSize size)
+{
+    ZyanU64 value = 0;
+    for (ZyanUSize i = size; i > 0; --i)
+    {
+        value = (value << 8) | buffer[i - 1];
+    }
+    return value;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Construction                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisBoundaryBitmapGetWorkspaceSize(ZyanUSize length, ZyanUSize* size)
+{
+    if (!size || (length > ZYAN_UINT32_MAX))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanUSize superblock_count = ZydisBoundaryBitmapGetSuperblockCount(length);
+    *size = ZydisBoundaryBitmapGetWordCount(length) * sizeof(ZyanU64) +
+        superblock_count * sizeof(ZyanU64) + (superblock_count + 1) * sizeof(ZyanU32) +
+        ((length >> ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT) + 2) * sizeof(ZyanU32);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapBuild(ZydisBoundaryBitmap* bitmap, const ZydisDecoder* decoder,
+    const void* buffer, ZyanUSize length, void* workspace, ZyanUSize workspace_size)
+{
+    if (!decoder || (!buffer && length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisBoundaryBitmapInit(bitmap, length, workspace, workspace_size));
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+            length - offset, &instruction)))
+        {
+            ++offset;
+            continue;
+        }
+        bitmap->bits[offset >> 6] |= 1ULL << (offset & 63);
+        offset += instruction.length;
+    }
+
+    ZydisBoundaryBitmapIndex(bitmap);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Queries                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisBoundaryBitmapGetCount(const ZydisBoundaryBitmap* bitmap, ZyanUSize* count)
+{
+    if (!bitmap || !count)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *count = bitmap->count;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapIsBoundary(const ZydisBoundaryBitmap* bitmap, ZyanUSize offset)
+{
+    if (!bitmap || (offset >= bitmap->length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ((bitmap->bits[offset >> 6] >> (offset & 63)) & 1) ? ZYAN_STATUS_TRUE :
+        ZYAN_STATUS_FALSE;
+}
+
+ZyanStatus ZydisBoundaryBitmapOffsetToIndex(const ZydisBoundaryBitmap* bitmap, ZyanUSize offset,
+    ZyanUSize* index)
+{
+    if (!bitmap || !index || (offset >= bitmap->length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanUSize word = offset >> 6;
+    const ZyanUSize superblock = word / ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS;
+    // Counts the set bits up to and including the given offset
+    const ZyanU64 mask = (2ULL << (offset & 63)) - 1;
+    const ZyanU32 rank = bitmap->absolute[superblock] +
+        ZydisBoundaryBitmapGetRelative(bitmap->relative[superblock],
+            (ZyanU32)(word % ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS)) +
+        ZydisBoundaryBitmapPopcount(bitmap->bits[word] & mask);
+    if (!rank)
+    {
+        return ZYAN_STATUS_NOT_FOUND;
+    }
+    *index = rank - 1;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapIndexToOffset(const ZydisBoundaryBitmap* bitmap, ZyanUSize index,
+    ZyanUSize* offset)
+{
+    if (!bitmap || !offset)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    if (index >= bitmap->count)
+    {
+        return ZYAN_STATUS_OUT_OF_RANGE;
+    }
+
+    // Find the last superblock that starts in front of the instruction
+    const ZyanU32 rank = (ZyanU32)index;
+    ZyanU32 lo = bitmap->samples[rank >> ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT];
+    ZyanU32 hi = bitmap->samples[(rank >> ZYDIS_BOUNDARY_BITMAP_SAMPLE_SHIFT) + 1];
+    while (lo < hi)
+    {
+        const ZyanU32 mid = lo + (hi - lo + 1) / 2;
+        if (bitmap->absolute[mid] <= rank)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    // Find the word inside of the superblock
+    const ZyanU64 relative = bitmap->relative[lo];
+    const ZyanU32 remaining = rank - bitmap->absolute[lo];
+    ZyanU32 word = 0;
+    for (ZyanU32 i = 1; i < ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS; ++i)
+    {
+        word += (ZydisBoundaryBitmapGetRelative(relative, i) <= remaining);
+    }
+
+    const ZyanUSize position = (ZyanUSize)lo * ZYDIS_BOUNDARY_BITMAP_SUPERBLOCK_WORDS + word;
+    *offset = position * 64 + ZydisBoundaryBitmapSelectInWord(bitmap->bits[position],
+        remaining - ZydisBoundaryBitmapGetRelative(relative, word));
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Serialization                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisBoundaryBitmapGetSerializedSize(const ZydisBoundaryBitmap* bitmap,
+    ZyanUSize* size)
+{
+    if (!bitmap || !size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *size = ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE +
+        ZydisBoundaryBitmapGetWordCount(bitmap->length) * sizeof(ZyanU64);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapSerialize(const ZydisBoundaryBitmap* bitmap, void* buffer,
+    ZyanUSize* length)
+{
+    if (!bitmap || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize size;
+    ZYAN_CHECK(ZydisBoundaryBitmapGetSerializedSize(bitmap, &size));
+    if (*length < size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZyanU8* data = (ZyanU8*)buffer;
+    ZYAN_MEMCPY(data, "ZBBM", 4);
+    ZydisBoundaryBitmapWriteLE(data + 4, ZYDIS_BOUNDARY_BITMAP_VERSION, 4);
+    ZydisBoundaryBitmapWriteLE(data + 8, bitmap->length, 8);
+    ZydisBoundaryBitmapWriteLE(data + 16, bitmap->count, 8);
+    data += ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE;
+
+    const ZyanUSize word_count = ZydisBoundaryBitmapGetWordCount(bitmap->length);
+    for (ZyanUSize i = 0; i < word_count; ++i)
+    {
+        ZydisBoundaryBitmapWriteLE(data + i * sizeof(ZyanU64), bitmap->bits[i], 8);
+    }
+    *length = size;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapGetSerializedCodeLength(const void* buffer, ZyanUSize length,
+    ZyanUSize* code_length)
+{
+    if (!buffer || !code_length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    if ((length < ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE) || ZYAN_MEMCMP(data, "ZBBM", 4) ||
+        (ZydisBoundaryBitmapReadLE(data + 4, 4) != ZYDIS_BOUNDARY_BITMAP_VERSION))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU64 value = ZydisBoundaryBitmapReadLE(data + 8, 8);
+    if ((value > ZYAN_UINT32_MAX) || (ZydisBoundaryBitmapGetWordCount((ZyanUSize)value) >
+        (length - ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE) / sizeof(ZyanU64)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    *code_length = (ZyanUSize)value;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisBoundaryBitmapDeserialize(ZydisBoundaryBitmap* bitmap, const void* buffer,
+    ZyanUSize length, void* workspace, ZyanUSize workspace_size)
+{
+    ZyanUSize code_length;
+    ZYAN_CHECK(ZydisBoundaryBitmapGetSerializedCodeLength(buffer, length, &code_length));
+    ZYAN_CHECK(ZydisBoundaryBitmapInit(bitmap, code_length, workspace, workspace_size));
+
+    const ZyanU8* data = (const ZyanU8*)buffer + ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE;
+    const ZyanUSize word_count = ZydisBoundaryBitmapGetWordCount(code_length);
+    for (ZyanUSize i = 0; i < word_count; ++i)
+    {
+        bitmap->bits[i] = ZydisBoundaryBitmapReadLE(data + i * sizeof(ZyanU64), 8);
+    }
+    if (code_length & 63)
+    {
+        // Bits behind the end of the code would break the rank and select queries
+        bitmap->bits[word_count - 1] &= (1ULL << (code_length & 63)) - 1;
+    }
+
+    ZydisBoundaryBitmapIndex(bitmap);
+    if (bitmap->count != ZydisBoundaryBitmapReadLE((const ZyanU8*)buffer + 16, 8))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
@@ -0,0 +1,379 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <Zycore/LibC.h>
+#include <Zydis/CodeBuffer.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+#ifndef MFD_CLOEXEC
+#   define MFD_CLOEXEC 0x0001U
+#endif
+
+/**
+ * The size of the smallest size class in bytes. All slots are aligned to this size.
+ */
+#define ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE ((ZyanUSize)1 << ZYDIS_CODE_BUFFER_MIN_SIZE_CLASS_SHIFT)
+
+/* ============================================================================================== */
+/* Internal types                                                                                 */
+/* ============================================================================================== */
+
+/**
+ * The header that is stored in the writable view of every free slot.
+ */
+typedef struct ZydisCodeBufferFreeSlot_
+{
+    /**
+     * The writable view of the next free slot of the same size class.
+     */
+    ZyanU8* next;
+    /**
+     * The executable view of this slot.
+     */
+    ZyanU8* executable;
+} ZydisCodeBufferFreeSlot;
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Returns the size class of the given slot size.
+ *
+ * @param   size    The slot size in bytes.
+ *
+ * @return  The index of the size class.
+ */
+static ZyanU8 ZydisCodeBufferGetSizeClass(ZyanUSize size)
+{
+    ZyanU8 shift = ZYDIS_CODE_BUFFER_MIN_SIZE_CLASS_SHIFT;
+    while (((ZyanUSize)1 << shift) < size)
+    {
+        ++shift;
+    }
+
+    return shift - ZYDIS_CODE_BUFFER_MIN_SIZE_CLASS_SHIFT;
+}
+
+/**
+ * Pushes a slot onto the free list of its size class.
+ *
+ * @param   buffer      A pointer to the `ZydisCodeBuffer` instance.
+ * @param   writable    The writable view of the slot.
+ * @param   executable  The executable view of the slot.
+ * @param   size_class  The index of the size class.
+ */
+static void ZydisCodeBufferPushFreeSlot(ZydisCodeBuffer* buffer, ZyanU8* writable,
+    ZyanU8* executable, ZyanU8 size_class)
+{
+    ZydisCodeBufferFreeSlot header;
+    header.next = buffer->free_lists[size_class];
+    header.executable = executable;
+    ZYAN_MEMCPY(writable, &header, sizeof(header));
+    buffer->free_lists[size_class] = writable;
+}
+
+/**
+ * Splits the unused tail of the current region into free slots.
+ *
+ * @param   buffer  A pointer to the `ZydisCodeBuffer` instance.
+ *
+ * The tail is a multiple of the smallest slot size, so it is carved into the largest fitting
+ * power-of-two slots until nothing is left.
+ */
+static void ZydisCodeBufferRetireRegion(ZydisCodeBuffer* buffer)
+{
+    ZydisCodeRegion* region = buffer->regions;
+    if (!region)
+    {
+        return;
+    }
+
+    while (region->size - region->used >= ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE)
+    {
+        ZyanU8 size_class = 0;
+        while ((size_class + 1 < ZYDIS_CODE_BUFFER_SIZE_CLASS_COUNT) &&
+               ((ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE << (size_class + 1)) <=
+                    region->size - region->used))
+        {
+            ++size_class;
+        }
+
+        ZydisCodeBufferPushFreeSlot(buffer, region->writable + region->used,
+            region->executable + region->used, size_class);
+        region->used += ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE << size_class;
+    }
+}
+
+/**
+ * Creates a new region and makes it the current region.
+ *
+ * @param   buffer  A pointer to the `ZydisCodeBuffer` instance.
+ * @param   size    The size of the region in bytes. Must be a multiple of the page size.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisCodeBufferCreateRegion(ZydisCodeBuffer* buffer, ZyanUSize size)
+{
+    ZydisCodeRegion* region = (ZydisCodeRegion*)ZYAN_MALLOC(sizeof(ZydisCodeRegion));
+    if (!region)
+    {
+        return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+    }
+
+    const int fd = (int)syscall(SYS_memfd_create, "zydis-code", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        ZYAN_FREE(region);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        close(fd);
+        ZYAN_FREE(region);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    void* const writable = mmap(ZYAN_NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* const executable = mmap(ZYAN_NULL, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+
+    // The mappings keep the file alive
+    close(fd);
+
+    if ((writable == MAP_FAILED) || (executable == MAP_FAILED))
+    {
+        if (writable != MAP_FAILED)
+        {
+            munmap(writable, size);
+        }
+        if (executable != MAP_FAILED)
+        {
+            munmap(executable, size);
+        }
+        ZYAN_FREE(region);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    ZydisCodeBufferRetireRegion(buffer);
+
+    region->next = buffer->regions;
+    region->writable = (ZyanU8*)writable;
+    region->executable = (ZyanU8*)executable;
+    region->size = size;
+    region->used = 0;
+    buffer->regions = region;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Rounds the given size up to a multiple of the page size.
+ *
+ * @param   size    The size in bytes.
+ *
+ * @return  The rounded size, or `0` on overflow.
+ */
+static ZyanUSize ZydisCodeBufferAlignToPage(ZyanUSize size)
+{
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const ZyanUSize mask = (page_size > 0 ? (ZyanUSize)page_size : 4096) - 1;
+    if (size > ~(ZyanUSize)0 - mask)
+    {
+        return 0;
+    }
+
+    return (size + mask) & ~mask;
+}
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Code buffer                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisCodeBufferInit(ZydisCodeBuffer* buffer, ZyanUSize region_size)
+{
+    if (!buffer)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!region_size)
+    {
+        region_size = ZYDIS_CODE_BUFFER_DEFAULT_REGION_SIZE;
+    }
+    region_size = ZydisCodeBufferAlignToPage(region_size);
+    if (!region_size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_MEMSET(buffer, 0, sizeof(*buffer));
+    buffer->region_size = region_size;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisCodeBufferDestroy(ZydisCodeBuffer* buffer)
+{
+    if (!buffer)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisCodeRegion* region = buffer->regions;
+    while (region)
+    {
+        ZydisCodeRegion* const next = region->next;
+        munmap(region->writable, region->size);
+        munmap(region->executable, region->size);
+        ZYAN_FREE(region);
+        region = next;
+    }
+
+    ZYAN_MEMSET(buffer->free_lists, 0, sizeof(buffer->free_lists));
+    buffer->regions = ZYAN_NULL;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisCodeBufferAllocate(ZydisCodeBuffer* buffer, ZyanUSize size, ZydisCodeSlot* slot)
+{
+    if (!buffer || !slot || !size ||
+        (size > (ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE << (ZYDIS_CODE_BUFFER_SIZE_CLASS_COUNT - 1))))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8 size_class = ZydisCodeBufferGetSizeClass(size);
+    const ZyanUSize slot_size = ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE << size_class;
+
+    if (buffer->free_lists[size_class])
+    {
+        ZydisCodeBufferFreeSlot header;
+        ZYAN_MEMCPY(&header, buffer->free_lists[size_class], sizeof(header));
+        slot->writable = buffer->free_lists[size_class];
+        slot->executable = header.executable;
+        buffer->free_lists[size_class] = header.next;
+    }
+    else
+    {
+        ZydisCodeRegion* region = buffer->regions;
+        if (!region || (region->size - region->used < slot_size))
+        {
+            const ZyanUSize region_size = ZydisCodeBufferAlignToPage(
+                ZYAN_MAX(buffer->region_size, slot_size));
+            if (!region_size)
+            {
+                return ZYAN_STATUS_INVALID_ARGUMENT;
+            }
+            ZYAN_CHECK(ZydisCodeBufferCreateRegion(buffer, region_size));
+            region = buffer->regions;
+        }
+
+        slot->writable = region->writable + region->used;
+        slot->executable = region->executable + region->used;
+        region->used += slot_size;
+    }
+
+    ZYAN_MEMSET(slot->writable, ZYDIS_CODE_BUFFER_FILL_BYTE, slot_size);
+    slot->size = slot_size;
+    slot->length = 0;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisCodeBufferFree(ZydisCodeBuffer* buffer, const ZydisCodeSlot* slot)
+{
+    if (!buffer || !slot || !slot->writable || (slot->size < ZYDIS_CODE_BUFFER_MIN_SLOT_SIZE) ||
+        (slot->size & (slot->size - 1)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8 size_class = ZydisCodeBufferGetSizeClass(slot->size);
+    if (size_class >= ZYDIS_CODE_BUFFER_SIZE_CLASS_COUNT)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_MEMSET(slot->writable, ZYDIS_CODE_BUFFER_FILL_BYTE, slot->size);
+    ZydisCodeBufferPushFreeSlot(buffer, slot->writable, (ZyanU8*)slot->executable, size_class);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Code slot                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisCodeSlotEmit(ZydisCodeSlot* slot, ZydisEncoderRequest* request)
+{
+    if (!slot || !request || (slot->length > slot->size))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize length = slot->size - slot->length;
+    ZYAN_CHECK(ZydisEncoderEncodeInstructionAbsolute(request, slot->writable + slot->length,
+        &length, (ZyanU64)(ZyanUPointer)(slot->executable + slot->length)));
+    slot->length += length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisCodeSlotGetRuntimeAddress(const ZydisCodeSlot* slot, ZyanUSize offset,
+    ZyanU64* address)
+{
+    if (!slot || !address)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    if (offset > slot->size)
+    {
+        return ZYAN_STATUS_OUT_OF_RANGE;
+    }
+
+    *address = (ZyanU64)(ZyanUPointer)(slot->executable + offset);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
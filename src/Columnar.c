@@ -0,0 +1,1216 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Columnar.h>
+#include <Zydis/Internal/DecoderData.h>
+#include <Zydis/MetaInfo.h>
+#include <Zydis/Mnemonic.h>
+#include <Zydis/Register.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The number of columns.
+ */
+#define ZYDIS_ARROW_COLUMN_COUNT        13
+
+/**
+ * The size of the buffer that receives the flatbuffer metadata of a single message.
+ */
+#define ZYDIS_ARROW_METADATA_SIZE       4096
+
+/**
+ * Marks the absence of a flatbuffer offset field that references a new object.
+ */
+#define ZYDIS_ARROW_NO_REFERENCE        (~(ZyanUSize)0)
+
+/**
+ * Marks columns that are not dictionary-encoded.
+ */
+#define ZYDIS_ARROW_NO_DICTIONARY       0xFF
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow format                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define ZYDIS_ARROW_METADATA_VERSION_V5     4
+
+#define ZYDIS_ARROW_HEADER_SCHEMA           1
+#define ZYDIS_ARROW_HEADER_DICTIONARY_BATCH 2
+#define ZYDIS_ARROW_HEADER_RECORD_BATCH     3
+
+#define ZYDIS_ARROW_TYPE_INT                2
+#define ZYDIS_ARROW_TYPE_UTF8               5
+#define ZYDIS_ARROW_TYPE_FIXED_SIZE_LIST    16
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisArrowDictionary` enum.
+ */
+typedef enum ZydisArrowDictionary_
+{
+    ZYDIS_ARROW_DICTIONARY_MNEMONIC,
+    ZYDIS_ARROW_DICTIONARY_CATEGORY,
+    ZYDIS_ARROW_DICTIONARY_ISA_SET,
+    ZYDIS_ARROW_DICTIONARY_OPERAND_TYPE,
+    ZYDIS_ARROW_DICTIONARY_REGISTER,
+
+    /**
+     * Maximum value of this enum.
+     */
+    ZYDIS_ARROW_DICTIONARY_MAX_VALUE = ZYDIS_ARROW_DICTIONARY_REGISTER,
+    /**
+     * The minimum number of bits required to represent all values of this enum.
+     */
+    ZYDIS_ARROW_DICTIONARY_REQUIRED_BITS =
+        ZYAN_BITS_TO_REPRESENT(ZYDIS_ARROW_DICTIONARY_MAX_VALUE)
+} ZydisArrowDictionary;
+
+/**
+ * Defines the `ZydisArrowColumn` struct.
+ */
+typedef struct ZydisArrowColumn_
+{
+    /**
+     * The name of the column.
+     */
+    const char* name;
+    /**
+     * The width of a single value in bytes.
+     */
+    ZyanU8 width;
+    /**
+     * Signals, if the values are signed.
+     */
+    ZyanBool is_signed;
+    /**
+     * The `ZydisArrowDictionary` of the column or `ZYDIS_ARROW_NO_DICTIONARY`.
+     */
+    ZyanU8 dictionary;
+    /**
+     * Signals, if the column stores `ZYDIS_COLUMNAR_OPERAND_COUNT` values per instruction.
+     */
+    ZyanBool is_list;
+} ZydisArrowColumn;
+
+/**
+ * Defines the `ZydisArrowField` struct.
+ *
+ * Describes a single field of a flatbuffer table.
+ */
+typedef struct ZydisArrowField_
+{
+    /**
+     * The size of the field in bytes or `0`, if the field is absent.
+     */
+    ZyanU8 size;
+    /**
+     * The value of the field. Offset fields are filled in later.
+     */
+    ZyanU64 value;
+} ZydisArrowField;
+
+/**
+ * Defines the `ZydisArrowBuilder` struct.
+ *
+ * Builds flatbuffers front to back. Objects are appended after the objects that reference them,
+ * which keeps all offsets positive.
+ */
+typedef struct ZydisArrowBuilder_
+{
+    /**
+     * The buffer.
+     */
+    ZyanU8* data;
+    /**
+     * The number of used bytes.
+     */
+    ZyanUSize size;
+    /**
+     * The capacity of the buffer.
+     */
+    ZyanUSize capacity;
+} ZydisArrowBuilder;
+
+/* ============================================================================================== */
+/* Internal constants                                                                             */
+/* ============================================================================================== */
+
+/**
+ * The columns of the Arrow schema. The values of the dictionary-encoded columns are the signed
+ * dictionary indices.
+ */
+static const ZydisArrowColumn ZYDIS_ARROW_COLUMNS[ZYDIS_ARROW_COLUMN_COUNT] =
+{
+    { "offset"             , 8, ZYAN_FALSE, ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE },
+    { "length"             , 1, ZYAN_FALSE, ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE },
+    { "mnemonic"           , 2, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_MNEMONIC    , ZYAN_FALSE },
+    { "category"           , 1, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_CATEGORY    , ZYAN_FALSE },
+    { "isa_set"            , 2, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_ISA_SET     , ZYAN_FALSE },
+    { "operand_count"      , 1, ZYAN_FALSE, ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE },
+    { "operand_type"       , 1, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_OPERAND_TYPE, ZYAN_TRUE  },
+    { "operand_register"   , 2, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_REGISTER    , ZYAN_TRUE  },
+    { "immediate"          , 8, ZYAN_TRUE , ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE },
+    { "memory_base"        , 2, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_REGISTER    , ZYAN_FALSE },
+    { "memory_index"       , 2, ZYAN_TRUE , ZYDIS_ARROW_DICTIONARY_REGISTER    , ZYAN_FALSE },
+    { "memory_scale"       , 1, ZYAN_FALSE, ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE },
+    { "memory_displacement", 8, ZYAN_TRUE , ZYDIS_ARROW_NO_DICTIONARY          , ZYAN_FALSE }
+};
+
+/**
+ * The strings of the `ZydisOperandType` dictionary.
+ */
+static const char* ZYDIS_ARROW_STR_OPERAND_TYPE[ZYDIS_OPERAND_TYPE_MAX_VALUE + 1] =
+{
+    "UNUSED",
+    "REGISTER",
+    "MEMORY",
+    "POINTER",
+    "IMMEDIATE"
+};
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Helper functions                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Stores a value in little-endian byte order.
+ *
+ * @param   data    A pointer to the destination.
+ * @param   value   The value.
+ * @param   size    The size of the value in bytes.
+ */
+static void ZydisArrowStore(ZyanU8* data, ZyanU64 value, ZyanU8 size)
+{
+    for (ZyanU8 i = 0; i < size; ++i)
+    {
+        data[i] = (ZyanU8)(value >> (i * 8));
+    }
+}
+
+/**
+ * Rounds the given size up to a multiple of 8.
+ *
+ * @param   size    The size.
+ *
+ * @return  The padded size.
+ */
+static ZyanU64 ZydisArrowPad(ZyanU64 size)
+{
+    return (size + 7) & ~(ZyanU64)7;
+}
+
+/**
+ * Returns the address of the values of a column.
+ *
+ * @param   batch   A pointer to the `ZydisColumnarBatch` instance.
+ * @param   column  The index of the column.
+ *
+ * @return  A pointer to the values of the first instruction.
+ */
+static const void* ZydisArrowGetColumnData(const ZydisColumnarBatch* batch, ZyanU8 column)
+{
+    switch (column)
+    {
+    case  0: return batch->offset;
+    case  1: return batch->length;
+    case  2: return batch->mnemonic;
+    case  3: return batch->category;
+    case  4: return batch->isa_set;
+    case  5: return batch->operand_count;
+    case  6: return batch->operand_type;
+    case  7: return batch->operand_register;
+    case  8: return batch->immediate;
+    case  9: return batch->memory_base;
+    case 10: return batch->memory_index;
+    case 11: return batch->memory_scale;
+    case 12: return batch->memory_displacement;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+}
+
+/**
+ * Returns the number of entries of a dictionary.
+ *
+ * @param   dictionary  The `ZydisArrowDictionary`.
+ *
+ * @return  The number of entries.
+ */
+static ZyanUSize ZydisArrowGetDictionarySize(ZydisArrowDictionary dictionary)
+{
+    switch (dictionary)
+    {
+    case ZYDIS_ARROW_DICTIONARY_MNEMONIC:
+        return ZYDIS_MNEMONIC_MAX_VALUE + 1;
+    case ZYDIS_ARROW_DICTIONARY_CATEGORY:
+        return ZYDIS_CATEGORY_MAX_VALUE + 1;
+    case ZYDIS_ARROW_DICTIONARY_ISA_SET:
+        return ZYDIS_ISA_SET_MAX_VALUE + 1;
+    case ZYDIS_ARROW_DICTIONARY_OPERAND_TYPE:
+        return ZYDIS_OPERAND_TYPE_MAX_VALUE + 1;
+    case ZYDIS_ARROW_DICTIONARY_REGISTER:
+        return ZYDIS_REGISTER_MAX_VALUE + 1;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+}
+
+/**
+ * Returns a dictionary entry.
+ *
+ * @param   dictionary  The `ZydisArrowDictionary`.
+ * @param   index       The index of the entry.
+ * @param   length      Receives the length of the string.
+ *
+ * @return  A pointer to the string.
+ */
+static const char* ZydisArrowGetDictionaryString(ZydisArrowDictionary dictionary,
+    ZyanUSize index, ZyanUSize* length)
+{
+    const char* string;
+    switch (dictionary)
+    {
+    case ZYDIS_ARROW_DICTIONARY_MNEMONIC:
+        string = ZydisMnemonicGetString((ZydisMnemonic)index);
+        break;
+    case ZYDIS_ARROW_DICTIONARY_CATEGORY:
+        string = ZydisCategoryGetString((ZydisInstructionCategory)index);
+        break;
+    case ZYDIS_ARROW_DICTIONARY_ISA_SET:
+        string = ZydisISASetGetString((ZydisISASet)index);
+        break;
+    case ZYDIS_ARROW_DICTIONARY_OPERAND_TYPE:
+        string = ZYDIS_ARROW_STR_OPERAND_TYPE[index];
+        break;
+    case ZYDIS_ARROW_DICTIONARY_REGISTER:
+        string = ZydisRegisterGetString((ZydisRegister)index);
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    if (!string)
+    {
+        string = "";
+    }
+    *length = 0;
+    while (string[*length])
+    {
+        ++*length;
+    }
+    return string;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Flatbuffer builder                                                                             */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Appends zero-initialized bytes to the builder.
+ *
+ * @param   builder A pointer to the `ZydisArrowBuilder` struct.
+ * @param   length  The number of bytes.
+ * @param   data    Receives a pointer to the appended bytes. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderAppend(ZydisArrowBuilder* builder, ZyanUSize length,
+    ZyanU8** data)
+{
+    if (builder->capacity - builder->size < length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZYAN_MEMSET(builder->data + builder->size, 0, length);
+    if (data)
+    {
+        *data = builder->data + builder->size;
+    }
+    builder->size += length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Pads the builder, so that the position `skip` bytes ahead is aligned.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   alignment   The alignment. Must be a power of two.
+ * @param   skip        The number of bytes in front of the aligned position.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderAlign(ZydisArrowBuilder* builder, ZyanUSize alignment,
+    ZyanUSize skip)
+{
+    return ZydisArrowBuilderAppend(builder, (alignment - ((builder->size + skip) &
+        (alignment - 1))) & (alignment - 1), ZYAN_NULL);
+}
+
+/**
+ * Points an offset field to the given object.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field or `ZYDIS_ARROW_NO_REFERENCE`.
+ * @param   target      The position of the object.
+ */
+static void ZydisArrowBuilderLink(ZydisArrowBuilder* builder, ZyanUSize reference,
+    ZyanUSize target)
+{
+    if (reference != ZYDIS_ARROW_NO_REFERENCE)
+    {
+        ZYAN_ASSERT(target > reference);
+        ZydisArrowStore(builder->data + reference, target - reference, 4);
+    }
+}
+
+/**
+ * Appends a table and its vtable.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the table or
+ *                      `ZYDIS_ARROW_NO_REFERENCE`.
+ * @param   fields      The fields, indexed by their flatbuffer field id.
+ * @param   count       The number of fields.
+ * @param   positions   Receives the position of every field. Can be `ZYAN_NULL`.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderTable(ZydisArrowBuilder* builder, ZyanUSize reference,
+    const ZydisArrowField* fields, ZyanU8 count, ZyanUSize* positions)
+{
+    ZYAN_ASSERT(count <= 8);
+
+    // Every field is aligned to its size relative to the 8-byte aligned table start
+    ZyanU16 offsets[8];
+    ZyanU16 table_size = 4;
+    for (ZyanU8 i = 0; i < count; ++i)
+    {
+        offsets[i] = 0;
+        if (fields[i].size)
+        {
+            table_size = (ZyanU16)((table_size + fields[i].size - 1) & ~(fields[i].size - 1));
+            offsets[i] = table_size;
+            table_size += fields[i].size;
+        }
+    }
+
+    ZyanU8* data;
+    ZYAN_CHECK(ZydisArrowBuilderAlign(builder, 2, 0));
+    const ZyanUSize vtable = builder->size;
+    ZYAN_CHECK(ZydisArrowBuilderAppend(builder, 4 + count * 2, &data));
+    ZydisArrowStore(data, 4 + count * 2, 2);
+    ZydisArrowStore(data + 2, table_size, 2);
+    for (ZyanU8 i = 0; i < count; ++i)
+    {
+        ZydisArrowStore(data + 4 + i * 2, offsets[i], 2);
+    }
+
+    ZYAN_CHECK(ZydisArrowBuilderAlign(builder, 8, 0));
+    const ZyanUSize table = builder->size;
+    ZYAN_CHECK(ZydisArrowBuilderAppend(builder, table_size, &data));
+    ZydisArrowStore(data, table - vtable, 4);
+    for (ZyanU8 i = 0; i < count; ++i)
+    {
+        if (fields[i].size)
+        {
+            ZydisArrowStore(data + offsets[i], fields[i].value, fields[i].size);
+        }
+        if (positions)
+        {
+            positions[i] = table + offsets[i];
+        }
+    }
+    ZydisArrowBuilderLink(builder, reference, table);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Appends the length prefix of a vector.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the vector.
+ * @param   alignment   The alignment of the vector elements.
+ * @param   count       The number of elements.
+ *
+ * @return  A zyan status code.
+ *
+ * The elements have to be appended directly after the prefix.
+ */
+static ZyanStatus ZydisArrowBuilderVectorPrefix(ZydisArrowBuilder* builder, ZyanUSize reference,
+    ZyanUSize alignment, ZyanUSize count)
+{
+    ZyanU8* data;
+    ZYAN_CHECK(ZydisArrowBuilderAlign(builder, alignment, 4));
+    ZydisArrowBuilderLink(builder, reference, builder->size);
+    ZYAN_CHECK(ZydisArrowBuilderAppend(builder, 4, &data));
+    ZydisArrowStore(data, count, 4);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Appends a zero-initialized vector.
+ *
+ * @param   builder         A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference       The position of the offset field that references the vector.
+ * @param   alignment       The alignment of the vector elements.
+ * @param   count           The number of elements.
+ * @param   element_size    The size of a single element.
+ * @param   elements        Receives the position of the first element.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderVector(ZydisArrowBuilder* builder, ZyanUSize reference,
+    ZyanUSize alignment, ZyanUSize count, ZyanUSize element_size, ZyanUSize* elements)
+{
+    ZYAN_CHECK(ZydisArrowBuilderVectorPrefix(builder, reference, alignment, count));
+    *elements = builder->size;
+
+    return ZydisArrowBuilderAppend(builder, count * element_size, ZYAN_NULL);
+}
+
+/**
+ * Appends a string.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the string.
+ * @param   string      The zero-terminated string.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderString(ZydisArrowBuilder* builder, ZyanUSize reference,
+    const char* string)
+{
+    ZyanUSize length = 0;
+    while (string[length])
+    {
+        ++length;
+    }
+
+    ZyanUSize elements;
+    ZYAN_CHECK(ZydisArrowBuilderVector(builder, reference, 4, length, 1, &elements));
+    ZYAN_MEMCPY(builder->data + elements, string, length);
+
+    // The terminating zero
+    return ZydisArrowBuilderAppend(builder, 1, ZYAN_NULL);
+}
+
+/**
+ * Appends a vector of `Block`, `Buffer` or `FieldNode` structs.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the vector.
+ * @param   values      The 64-bit fields of the structs.
+ * @param   count       The number of structs.
+ * @param   width       The number of 64-bit fields per struct.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuilderStructs(ZydisArrowBuilder* builder, ZyanUSize reference,
+    const ZyanU64* values, ZyanUSize count, ZyanU8 width)
+{
+    ZyanUSize elements;
+    ZYAN_CHECK(ZydisArrowBuilderVector(builder, reference, 8, count, width * 8, &elements));
+    for (ZyanUSize i = 0; i < count * width; ++i)
+    {
+        ZydisArrowStore(builder->data + elements + i * 8, values[i], 8);
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow metadata                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Appends an `Int` type table.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the table.
+ * @param   width       The width of the integer in bytes.
+ * @param   is_signed   Signals, if the integer is signed.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuildInt(ZydisArrowBuilder* builder, ZyanUSize reference,
+    ZyanU8 width, ZyanBool is_signed)
+{
+    const ZydisArrowField fields[2] =
+    {
+        { 4, width * 8 },   // bitWidth
+        { 1, is_signed }    // is_signed
+    };
+
+    return ZydisArrowBuilderTable(builder, reference, fields, 2, ZYAN_NULL);
+}
+
+/**
+ * Appends a `Field` table.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the table.
+ * @param   name        The name of the field.
+ * @param   column      A pointer to the `ZydisArrowColumn` struct.
+ * @param   is_item     Signals, if the field describes the items of a list column.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuildField(ZydisArrowBuilder* builder, ZyanUSize reference,
+    const char* name, const ZydisArrowColumn* column, ZyanBool is_item)
+{
+    const ZyanBool is_list = column->is_list && !is_item;
+    const ZyanBool is_dictionary =
+        !is_list && (column->dictionary != ZYDIS_ARROW_NO_DICTIONARY);
+
+    ZyanU8 type = ZYDIS_ARROW_TYPE_INT;
+    if (is_list)
+    {
+        type = ZYDIS_ARROW_TYPE_FIXED_SIZE_LIST;
+    }
+    else if (is_dictionary)
+    {
+        // Dictionary-encoded fields are declared with the type of the dictionary values
+        type = ZYDIS_ARROW_TYPE_UTF8;
+    }
+
+    const ZydisArrowField fields[6] =
+    {
+        { 4, 0 },                       // name
+        { 1, 0 },                       // nullable
+        { 1, type },                    // type_type
+        { 4, 0 },                       // type
+        { is_dictionary ? 4 : 0, 0 },   // dictionary
+        { is_list ? 4 : 0, 0 }          // children
+    };
+    ZyanUSize positions[6];
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, reference, fields, 6, positions));
+    ZYAN_CHECK(ZydisArrowBuilderString(builder, positions[0], name));
+
+    if (is_list)
+    {
+        const ZydisArrowField list[1] =
+        {
+            { 4, ZYDIS_COLUMNAR_OPERAND_COUNT } // listSize
+        };
+        ZYAN_CHECK(ZydisArrowBuilderTable(builder, positions[3], list, 1, ZYAN_NULL));
+
+        ZyanUSize item;
+        ZYAN_CHECK(ZydisArrowBuilderVector(builder, positions[5], 4, 1, 4, &item));
+        return ZydisArrowBuildField(builder, item, "item", column, ZYAN_TRUE);
+    }
+
+    if (!is_dictionary)
+    {
+        return ZydisArrowBuildInt(builder, positions[3], column->width, column->is_signed);
+    }
+
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, positions[3], ZYAN_NULL, 0, ZYAN_NULL));
+
+    const ZydisArrowField encoding[2] =
+    {
+        { 8, column->dictionary },  // id
+        { 4, 0 }                    // indexType
+    };
+    ZyanUSize index_type[2];
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, positions[4], encoding, 2, index_type));
+
+    return ZydisArrowBuildInt(builder, index_type[1], column->width, ZYAN_TRUE);
+}
+
+/**
+ * Appends the `Schema` table.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference   The position of the offset field that references the table.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuildSchema(ZydisArrowBuilder* builder, ZyanUSize reference)
+{
+    const ZydisArrowField fields[2] =
+    {
+        { 2, 0 },   // endianness (little-endian)
+        { 4, 0 }    // fields
+    };
+    ZyanUSize positions[2];
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, reference, fields, 2, positions));
+
+    ZyanUSize elements;
+    ZYAN_CHECK(ZydisArrowBuilderVector(builder, positions[1], 4, ZYDIS_ARROW_COLUMN_COUNT, 4,
+        &elements));
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_COLUMN_COUNT; ++i)
+    {
+        ZYAN_CHECK(ZydisArrowBuildField(builder, elements + i * 4, ZYDIS_ARROW_COLUMNS[i].name,
+            &ZYDIS_ARROW_COLUMNS[i], ZYAN_FALSE));
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Appends the root `Message` table.
+ *
+ * @param   builder     A pointer to the `ZydisArrowBuilder` struct.
+ * @param   header_type The type of the message header.
+ * @param   body_length The length of the message body.
+ * @param   header      Receives the position of the offset field that references the header.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuildMessage(ZydisArrowBuilder* builder, ZyanU8 header_type,
+    ZyanU64 body_length, ZyanUSize* header)
+{
+    const ZydisArrowField fields[4] =
+    {
+        { 2, ZYDIS_ARROW_METADATA_VERSION_V5 }, // version
+        { 1, header_type },                     // header_type
+        { 4, 0 },                               // header
+        { 8, body_length }                      // bodyLength
+    };
+    ZyanUSize positions[4];
+    ZYAN_CHECK(ZydisArrowBuilderAppend(builder, 4, ZYAN_NULL));
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, 0, fields, 4, positions));
+    *header = positions[2];
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Appends a `RecordBatch` table.
+ *
+ * @param   builder         A pointer to the `ZydisArrowBuilder` struct.
+ * @param   reference       The position of the offset field that references the table.
+ * @param   length          The number of rows.
+ * @param   nodes           The `length` and `null_count` of every field node.
+ * @param   node_count      The number of field nodes.
+ * @param   buffers         The `offset` and `length` of every buffer.
+ * @param   buffer_count    The number of buffers.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowBuildRecordBatch(ZydisArrowBuilder* builder, ZyanUSize reference,
+    ZyanU64 length, const ZyanU64* nodes, ZyanUSize node_count, const ZyanU64* buffers,
+    ZyanUSize buffer_count)
+{
+    const ZydisArrowField fields[3] =
+    {
+        { 8, length },  // length
+        { 4, 0 },       // nodes
+        { 4, 0 }        // buffers
+    };
+    ZyanUSize positions[3];
+    ZYAN_CHECK(ZydisArrowBuilderTable(builder, reference, fields, 3, positions));
+    ZYAN_CHECK(ZydisArrowBuilderStructs(builder, positions[1], nodes, node_count, 2));
+
+    return ZydisArrowBuilderStructs(builder, positions[2], buffers, buffer_count, 2);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Writes data to the output.
+ *
+ * @param   writer  A pointer to the `ZydisArrowWriter` instance.
+ * @param   data    A pointer to the data.
+ * @param   length  The length of the data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowWrite(ZydisArrowWriter* writer, const void* data, ZyanUSize length)
+{
+    if (length)
+    {
+        ZYAN_CHECK(writer->write(writer->user_data, data, length));
+        writer->position += length;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Pads the output to a multiple of 8 bytes.
+ *
+ * @param   writer  A pointer to the `ZydisArrowWriter` instance.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowWritePadding(ZydisArrowWriter* writer)
+{
+    static const ZyanU8 padding[8] = { 0 };
+
+    return ZydisArrowWrite(writer, padding,
+        (ZyanUSize)(ZydisArrowPad(writer->position) - writer->position));
+}
+
+/**
+ * Writes an encapsulated message.
+ *
+ * @param   writer  A pointer to the `ZydisArrowWriter` instance.
+ * @param   builder A pointer to the `ZydisArrowBuilder` struct that contains the metadata.
+ * @param   block   Receives the location of the message.
+ *
+ * @return  A zyan status code.
+ *
+ * The body has to be written directly afterwards.
+ */
+static ZyanStatus ZydisArrowWriteMessage(ZydisArrowWriter* writer, ZydisArrowBuilder* builder,
+    ZydisArrowBlock* block)
+{
+    ZYAN_CHECK(ZydisArrowBuilderAlign(builder, 8, 0));
+
+    ZyanU8 prefix[8];
+    ZydisArrowStore(prefix, 0xFFFFFFFF, 4);
+    ZydisArrowStore(prefix + 4, builder->size, 4);
+
+    block->offset = writer->position;
+    block->metadata_length = (ZyanU32)(sizeof(prefix) + builder->size);
+    ZYAN_CHECK(ZydisArrowWrite(writer, prefix, sizeof(prefix)));
+
+    return ZydisArrowWrite(writer, builder->data, builder->size);
+}
+
+/**
+ * Writes the dictionary batch of the given dictionary.
+ *
+ * @param   writer      A pointer to the `ZydisArrowWriter` instance.
+ * @param   dictionary  The `ZydisArrowDictionary`.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisArrowWriteDictionary(ZydisArrowWriter* writer,
+    ZydisArrowDictionary dictionary)
+{
+    const ZyanUSize count = ZydisArrowGetDictionarySize(dictionary);
+    ZyanUSize data_length = 0;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZyanUSize length;
+        ZydisArrowGetDictionaryString(dictionary, i, &length);
+        data_length += length;
+    }
+    const ZyanU64 offsets_length = (count + 1) * 4;
+    const ZyanU64 nodes[2] = { count, 0 };
+    const ZyanU64 buffers[6] =
+    {
+        0, 0,                                       // validity
+        0, offsets_length,                          // offsets
+        ZydisArrowPad(offsets_length), data_length  // data
+    };
+    const ZyanU64 body_length = ZydisArrowPad(offsets_length) + ZydisArrowPad(data_length);
+
+    ZyanU8 metadata[ZYDIS_ARROW_METADATA_SIZE];
+    ZydisArrowBuilder builder = { metadata, 0, sizeof(metadata) };
+    ZyanUSize header;
+    ZYAN_CHECK(ZydisArrowBuildMessage(&builder, ZYDIS_ARROW_HEADER_DICTIONARY_BATCH, body_length,
+        &header));
+    const ZydisArrowField fields[2] =
+    {
+        { 8, dictionary },  // id
+        { 4, 0 }            // data
+    };
+    ZyanUSize positions[2];
+    ZYAN_CHECK(ZydisArrowBuilderTable(&builder, header, fields, 2, positions));
+    ZYAN_CHECK(ZydisArrowBuildRecordBatch(&builder, positions[1], count, nodes, 1, buffers, 3));
+
+    ZydisArrowBlock* block = &writer->dictionaries[dictionary];
+    ZYAN_CHECK(ZydisArrowWriteMessage(writer, &builder, block));
+    block->body_length = body_length;
+
+    // The metadata buffer is reused to stage the offsets
+    ZyanUSize staged = 0;
+    ZyanUSize offset = 0;
+    for (ZyanUSize i = 0; i <= count; ++i)
+    {
+        ZydisArrowStore(metadata + staged, offset, 4);
+        staged += 4;
+        if ((staged == sizeof(metadata)) || (i == count))
+        {
+            ZYAN_CHECK(ZydisArrowWrite(writer, metadata, staged));
+            staged = 0;
+        }
+        if (i < count)
+        {
+            ZyanUSize length;
+            ZydisArrowGetDictionaryString(dictionary, i, &length);
+            offset += length;
+        }
+    }
+    ZYAN_CHECK(ZydisArrowWritePadding(writer));
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZyanUSize length;
+        const char* string = ZydisArrowGetDictionaryString(dictionary, i, &length);
+        ZYAN_CHECK(ZydisArrowWrite(writer, string, length));
+    }
+
+    return ZydisArrowWritePadding(writer);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Columnar batch                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisColumnarGetWorkspaceSize(ZyanUSize capacity, ZyanUSize* size)
+{
+    // 3 columns with 64-bit values, 4 + N with 16-bit values and 4 + N with 8-bit values
+    const ZyanUSize row_size = 3 * sizeof(ZyanU64) +
+        (4 + ZYDIS_COLUMNAR_OPERAND_COUNT) * (sizeof(ZyanU16) + sizeof(ZyanU8));
+
+    if (!size || (capacity > (~(ZyanUSize)0) / row_size))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *size = capacity * row_size;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisColumnarBatchInit(ZydisColumnarBatch* batch, ZyanUSize capacity,
+    void* workspace, ZyanUSize workspace_size)
+{
+    if (!batch || !workspace || ((ZyanUPointer)workspace % sizeof(ZyanU64)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize size;
+    ZYAN_CHECK(ZydisColumnarGetWorkspaceSize(capacity, &size));
+    if (workspace_size < size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    // The columns are ordered by decreasing alignment
+    const ZyanUSize n = capacity * ZYDIS_COLUMNAR_OPERAND_COUNT;
+    batch->capacity            = capacity;
+    batch->count               = 0;
+    batch->offset              = (ZyanU64*)workspace;
+    batch->immediate           = (ZyanI64*)(batch->offset + capacity);
+    batch->memory_displacement = batch->immediate + capacity;
+    batch->mnemonic            = (ZyanU16*)(batch->memory_displacement + capacity);
+    batch->isa_set             = batch->mnemonic + capacity;
+    batch->memory_base         = batch->isa_set + capacity;
+    batch->memory_index        = batch->memory_base + capacity;
+    batch->operand_register    = batch->memory_index + capacity;
+    batch->length              = (ZyanU8*)(batch->operand_register + n);
+    batch->category            = batch->length + capacity;
+    batch->operand_count       = batch->category + capacity;
+    batch->memory_scale        = batch->operand_count + capacity;
+    batch->operand_type        = batch->memory_scale + capacity;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisColumnarDecode(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanUSize begin, ZyanUSize end, ZydisColumnarBatch* batch,
+    ZyanUSize* next)
+{
+    if (!decoder || (decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)) ||
+        (!buffer && length) || !batch || (begin > length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    end = ZYAN_MIN(end, length);
+
+    ZyanUSize offset = begin;
+    ZyanUSize index = batch->count;
+    for (; (offset < end) && (index < batch->capacity); ++index)
+    {
+        ZyanU8* const types = &batch->operand_type[index * ZYDIS_COLUMNAR_OPERAND_COUNT];
+        ZyanU16* const registers = &batch->operand_register[index * ZYDIS_COLUMNAR_OPERAND_COUNT];
+        ZYAN_MEMSET(types, 0, ZYDIS_COLUMNAR_OPERAND_COUNT * sizeof(*types));
+        ZYAN_MEMSET(registers, 0, ZYDIS_COLUMNAR_OPERAND_COUNT * sizeof(*registers));
+        batch->offset[index] = offset;
+        batch->immediate[index] = 0;
+        batch->memory_base[index] = ZYDIS_REGISTER_NONE;
+        batch->memory_index[index] = ZYDIS_REGISTER_NONE;
+        batch->memory_scale[index] = 0;
+        batch->memory_displacement[index] = 0;
+
+        ZydisDecoderContext context;
+        ZydisDecodedInstruction instruction;
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+            length - offset, &instruction)))
+        {
+            batch->length[index] = 1;
+            batch->mnemonic[index] = ZYDIS_MNEMONIC_INVALID;
+            batch->category[index] = ZYDIS_CATEGORY_INVALID;
+            batch->isa_set[index] = ZYDIS_ISA_SET_INVALID;
+            batch->operand_count[index] = 0;
+            ++offset;
+            continue;
+        }
+
+        // The element information and operand actions are not exported
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT_VISIBLE];
+        ZYAN_CHECK(ZydisDecoderDecodeVisibleOperands(decoder, &context, &instruction,
+            operands));
+
+        batch->length[index] = instruction.length;
+        batch->mnemonic[index] = (ZyanU16)instruction.mnemonic;
+        batch->category[index] = (ZyanU8)instruction.meta.category;
+        batch->isa_set[index] = (ZyanU16)instruction.meta.isa_set;
+        batch->operand_count[index] = instruction.operand_count_visible;
+
+        ZyanBool has_immediate = ZYAN_FALSE;
+        ZyanBool has_memory = ZYAN_FALSE;
+        for (ZyanU8 i = 0; i < instruction.operand_count_visible; ++i)
+        {
+            const ZydisDecodedOperand* operand = &operands[i];
+            types[i] = (ZyanU8)operand->type;
+            switch (operand->type)
+            {
+            case ZYDIS_OPERAND_TYPE_REGISTER:
+                registers[i] = (ZyanU16)operand->reg.value;
+                break;
+            case ZYDIS_OPERAND_TYPE_MEMORY:
+                if (!has_memory)
+                {
+                    batch->memory_base[index] = (ZyanU16)operand->mem.base;
+                    batch->memory_index[index] = (ZyanU16)operand->mem.index;
+                    batch->memory_scale[index] = operand->mem.scale;
+                    batch->memory_displacement[index] = operand->mem.disp.value;
+                    has_memory = ZYAN_TRUE;
+                }
+                break;
+            case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                if (!has_immediate)
+                {
+                    batch->immediate[index] = operand->imm.value.s;
+                    has_immediate = ZYAN_TRUE;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        offset += instruction.length;
+    }
+    batch->count = index;
+
+    if (next)
+    {
+        *next = offset;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow writer                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisArrowWriterInit(ZydisArrowWriter* writer, ZydisArrowWriteFunc write,
+    void* user_data, ZydisArrowBlock* batches, ZyanUSize batch_capacity)
+{
+    if (!writer || !write || (!batches && batch_capacity))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_MEMSET(writer, 0, sizeof(*writer));
+    writer->write          = write;
+    writer->user_data      = user_data;
+    writer->batches        = batches;
+    writer->batch_capacity = batch_capacity;
+
+    static const char magic[8] = "ARROW1";
+    ZYAN_CHECK(ZydisArrowWrite(writer, magic, sizeof(magic)));
+
+    ZyanU8 metadata[ZYDIS_ARROW_METADATA_SIZE];
+    ZydisArrowBuilder builder = { metadata, 0, sizeof(metadata) };
+    ZyanUSize header;
+    ZydisArrowBlock block;
+    ZYAN_CHECK(ZydisArrowBuildMessage(&builder, ZYDIS_ARROW_HEADER_SCHEMA, 0, &header));
+    ZYAN_CHECK(ZydisArrowBuildSchema(&builder, header));
+    ZYAN_CHECK(ZydisArrowWriteMessage(writer, &builder, &block));
+
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_DICTIONARY_COUNT; ++i)
+    {
+        ZYAN_CHECK(ZydisArrowWriteDictionary(writer, (ZydisArrowDictionary)i));
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisArrowWriterWriteBatch(ZydisArrowWriter* writer,
+    const ZydisColumnarBatch* batch, ZyanUSize first, ZyanUSize count)
+{
+    if (!writer || !batch || (first > batch->count) || (count > batch->count - first))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    if (writer->batch_count == writer->batch_capacity)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    // List columns have an additional field node and validity buffer for the items
+    ZyanU64 nodes[2 * 2 * ZYDIS_ARROW_COLUMN_COUNT];
+    ZyanU64 buffers[3 * 2 * ZYDIS_ARROW_COLUMN_COUNT];
+    ZyanUSize node_count = 0;
+    ZyanUSize buffer_count = 0;
+    ZyanU64 body_length = 0;
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_COLUMN_COUNT; ++i)
+    {
+        ZyanU64 values = count;
+        if (ZYDIS_ARROW_COLUMNS[i].is_list)
+        {
+            nodes[node_count++] = count;
+            nodes[node_count++] = 0;
+            buffers[buffer_count++] = body_length;
+            buffers[buffer_count++] = 0;
+            values *= ZYDIS_COLUMNAR_OPERAND_COUNT;
+        }
+        const ZyanU64 length = values * ZYDIS_ARROW_COLUMNS[i].width;
+        nodes[node_count++] = values;
+        nodes[node_count++] = 0;
+        buffers[buffer_count++] = body_length;
+        buffers[buffer_count++] = 0;
+        buffers[buffer_count++] = body_length;
+        buffers[buffer_count++] = length;
+        body_length += ZydisArrowPad(length);
+    }
+
+    ZyanU8 metadata[ZYDIS_ARROW_METADATA_SIZE];
+    ZydisArrowBuilder builder = { metadata, 0, sizeof(metadata) };
+    ZyanUSize header;
+    ZYAN_CHECK(ZydisArrowBuildMessage(&builder, ZYDIS_ARROW_HEADER_RECORD_BATCH, body_length,
+        &header));
+    ZYAN_CHECK(ZydisArrowBuildRecordBatch(&builder, header, count, nodes, node_count / 2,
+        buffers, buffer_count / 2));
+
+    ZydisArrowBlock* block = &writer->batches[writer->batch_count];
+    ZYAN_CHECK(ZydisArrowWriteMessage(writer, &builder, block));
+    block->body_length = body_length;
+
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_COLUMN_COUNT; ++i)
+    {
+        const ZyanUSize stride = ZYDIS_ARROW_COLUMNS[i].width *
+            (ZYDIS_ARROW_COLUMNS[i].is_list ? ZYDIS_COLUMNAR_OPERAND_COUNT : 1);
+        const ZyanU8* data = (const ZyanU8*)ZydisArrowGetColumnData(batch, i);
+        ZYAN_CHECK(ZydisArrowWrite(writer, data + first * stride, count * stride));
+        ZYAN_CHECK(ZydisArrowWritePadding(writer));
+    }
+    ++writer->batch_count;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisArrowWriterFinish(ZydisArrowWriter* writer)
+{
+    if (!writer)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    static const ZyanU8 end_of_stream[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00 };
+    ZYAN_CHECK(ZydisArrowWrite(writer, end_of_stream, sizeof(end_of_stream)));
+    const ZyanU64 footer = writer->position;
+
+    ZyanU8 metadata[ZYDIS_ARROW_METADATA_SIZE];
+    ZydisArrowBuilder builder = { metadata, 0, sizeof(metadata) };
+    const ZydisArrowField fields[4] =
+    {
+        { 2, ZYDIS_ARROW_METADATA_VERSION_V5 }, // version
+        { 4, 0 },                               // schema
+        { 4, 0 },                               // dictionaries
+        { 4, 0 }                                // recordBatches
+    };
+    ZyanUSize positions[4];
+    ZYAN_CHECK(ZydisArrowBuilderAppend(&builder, 4, ZYAN_NULL));
+    ZYAN_CHECK(ZydisArrowBuilderTable(&builder, 0, fields, 4, positions));
+    ZYAN_CHECK(ZydisArrowBuildSchema(&builder, positions[1]));
+
+    ZyanU64 blocks[3 * ZYDIS_ARROW_DICTIONARY_COUNT];
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_DICTIONARY_COUNT; ++i)
+    {
+        blocks[i * 3 + 0] = writer->dictionaries[i].offset;
+        blocks[i * 3 + 1] = writer->dictionaries[i].metadata_length;
+        blocks[i * 3 + 2] = writer->dictionaries[i].body_length;
+    }
+    ZYAN_CHECK(ZydisArrowBuilderStructs(&builder, positions[2], blocks,
+        ZYDIS_ARROW_DICTIONARY_COUNT, 3));
+
+    // The record batch blocks are streamed, as their number is not bounded
+    ZYAN_CHECK(ZydisArrowBuilderVectorPrefix(&builder, positions[3], 8, writer->batch_count));
+    ZYAN_CHECK(ZydisArrowWrite(writer, builder.data, builder.size));
+    for (ZyanUSize i = 0; i < writer->batch_count; )
+    {
+        ZyanUSize staged = 0;
+        for (; (i < writer->batch_count) && (staged + 24 <= sizeof(metadata)); ++i)
+        {
+            ZydisArrowStore(metadata + staged + 0, writer->batches[i].offset, 8);
+            ZydisArrowStore(metadata + staged + 8, writer->batches[i].metadata_length, 8);
+            ZydisArrowStore(metadata + staged + 16, writer->batches[i].body_length, 8);
+            staged += 24;
+        }
+        ZYAN_CHECK(ZydisArrowWrite(writer, metadata, staged));
+    }
+
+    ZyanU8 trailer[10] = { 0, 0, 0, 0, 'A', 'R', 'R', 'O', 'W', '1' };
+    ZydisArrowStore(trailer, writer->position - footer, 4);
+
+    return ZydisArrowWrite(writer, trailer, sizeof(trailer));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
@@ -0,0 +1,140 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Compiles all generated data tables as a single translation unit, if `ZYDIS_HUGE_PAGE_TABLES`
+ * is enabled. The tables then form a single input section of the linker, which starts and ends
+ * at a huge page boundary. This keeps the tables in as few huge pages as possible and ensures
+ * that these pages contain nothing else.
+ */
+
+#include <Zydis/Internal/DecoderData.h>
+#include <Zydis/Internal/EncoderData.h>
+#include <Zydis/Internal/SharedData.h>
+
+/* ============================================================================================== */
+/* Table section                                                                                  */
+/* ============================================================================================== */
+
+#ifdef ZYDIS_HAS_TABLE_SECTION
+
+/**
+ * Marks the start of the tables. Together with `TABLE_SECTION_END`, this aligns the start and the
+ * size of the section to huge pages, regardless of the order in which the compiler emits the
+ * objects of this file.
+ */
+__extension__ ZYDIS_TABLE_SECTION __attribute__((aligned(ZYDIS_TABLE_ALIGNMENT), used))
+static const ZyanU8 TABLE_SECTION_BEGIN[0];
+
+/**
+ * The generated tables are emitted without any section attribute. GCC and Clang merge the
+ * attribute of a prior declaration into the definition, so the tables are declared here once
+ * more to place them in the table section. Tables with internal linkage are annotated at the
+ * place where they are included.
+ */
+
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinitionLEGACY ISTR_DEFINITIONS_LEGACY[];
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinition3DNOW ISTR_DEFINITIONS_3DNOW[];
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinitionXOP ISTR_DEFINITIONS_XOP[];
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinitionVEX ISTR_DEFINITIONS_VEX[];
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinitionEVEX ISTR_DEFINITIONS_EVEX[];
+ZYDIS_TABLE_SECTION extern const ZydisInstructionDefinitionMVEX ISTR_DEFINITIONS_MVEX[];
+
+#ifndef ZYDIS_MINIMAL_MODE
+ZYDIS_TABLE_SECTION extern const ZydisOperandDefinition OPERAND_DEFINITIONS[];
+#endif
+
+#if !defined(ZYDIS_DISABLE_DECODER) && !defined(ZYDIS_COMPACT_DECODER_TABLES)
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_XOP[][13];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_VEX[][17];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_EMVEX[][49];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_OPCODE[][256];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE[][3];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_COMPACT[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_PREFIX_GROUP1[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODRM_MOD[][4];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODRM_MOD_COMPACT[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODRM_REG[][8];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODRM_RM[][8];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MANDATORY_PREFIX[][5];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_OPERAND_SIZE[][3];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_ADDRESS_SIZE[][3];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_VECTOR_LENGTH[][3];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_REX_W[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_REX_B[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_EVEX_B[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MVEX_E[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_AMD[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_KNC[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_MPX[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_CET[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_LZCNT[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_TZCNT[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_WBNOINVD[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_CLDEMOTE[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_CENTAUR[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_IPREFETCH[][2];
+ZYDIS_TABLE_SECTION extern const ZydisDecoderTreeNode FILTERS_MODE_UD0_COMPAT[][2];
+#endif
+
+#ifndef ZYDIS_DISABLE_ENCODER
+ZYDIS_TABLE_SECTION extern const ZydisEncoderLookupEntry encoder_instruction_lookup[];
+ZYDIS_TABLE_SECTION extern const ZydisEncodableInstruction encoder_instructions[];
+#endif
+
+#endif
+
+/* ============================================================================================== */
+/* Tables                                                                                         */
+/* ============================================================================================== */
+
+#include "SharedData.c"
+
+#ifndef ZYDIS_DISABLE_DECODER
+#   include "DecoderData.c"
+#endif
+
+#ifndef ZYDIS_DISABLE_ENCODER
+#   include "EncoderData.c"
+#endif
+
+/* ============================================================================================== */
+/* Table section                                                                                  */
+/* ============================================================================================== */
+
+#ifdef ZYDIS_HAS_TABLE_SECTION
+
+/**
+ * Marks the end of the tables.
+ */
+__extension__ ZYDIS_TABLE_SECTION __attribute__((aligned(ZYDIS_TABLE_ALIGNMENT), used))
+static const ZyanU8 TABLE_SECTION_END[0];
+
+#endif
+
+/* ============================================================================================== */
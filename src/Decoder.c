@@ -34,7 +34,9 @@
 #include <Zycore/LibC.h>
 #include <Zydis/Decoder.h>
 #include <Zydis/Status.h>
+#include <Zydis/Internal/DecoderCache.h>
 #include <Zydis/Internal/DecoderData.h>
+#include <Zydis/Internal/InternalTests.h>
 #include <Zydis/Internal/SharedData.h>
 
 /* ============================================================================================== */
@@ -42,100 +44,32 @@
 /* ============================================================================================== */
 
 /* ---------------------------------------------------------------------------------------------- */
-/* Decoder context                                                                                */
+/* Packed types                                                                                   */
 /* ---------------------------------------------------------------------------------------------- */
 
-/**
- * Defines the `ZydisDecoderState` struct.
- */
-typedef struct ZydisDecoderState_
-{
-    /**
-     * A pointer to the `ZydisDecoder` instance.
-     */
-    const ZydisDecoder* decoder;
-    /**
-     * A pointer to the `ZydisDecoderContext` struct.
-     */
-    ZydisDecoderContext* context;
-    /**
-     * The input buffer.
-     */
-    const ZyanU8* buffer;
-    /**
-     * The input buffer length.
-     */
-    ZyanUSize buffer_len;
-    /**
-     * Prefix information.
-     */
-    struct
-    {
-        /**
-         * Signals, if the instruction has a `LOCK` prefix (`F0`).
-         *
-         * This prefix originally belongs to group 1, but separating it from the other ones makes
-         * parsing easier for us later.
-         */
-        ZyanBool has_lock;
-        /**
-         * The effective prefix of group 1 (either `F2` or `F3`).
-         */
-        ZyanU8 group1;
-        /**
-         * The effective prefix of group 2 (`2E`, `36`, `3E`, `26`, `64` or `65`).
-         */
-        ZyanU8 group2;
-        /**
-         * The effective segment prefix.
-         */
-        ZyanU8 effective_segment;
-        /**
-         * The prefix that should be treated as the mandatory-prefix, if the
-         * current instruction needs one.
-         *
-         * The last `F3`/`F2` prefix has precedence over previous ones and
-         * `F3`/`F2` in general have precedence over `66`.
-         */
-        ZyanU8 mandatory_candidate;
-        /**
-         * The offset of the effective `LOCK` prefix.
-         */
-        ZyanU8 offset_lock;
-        /**
-         * The offset of the effective prefix in group 1.
-         */
-        ZyanU8 offset_group1;
-        /**
-         * The offset of the effective prefix in group 2.
-         */
-        ZyanU8 offset_group2;
-        /**
-         * The offset of the operand-size override prefix (`66`).
-         *
-         * This is the only prefix in group 3.
-         */
-        ZyanU8 offset_osz_override;
-        /**
-         * The offset of the address-size override prefix (`67`).
-         *
-         * This is the only prefix in group 4.
-         */
-        ZyanU8 offset_asz_override;
-        /**
-         * The offset of the effective segment prefix.
-         */
-        ZyanU8 offset_segment;
-        /**
-         * The offset of the mandatory-candidate prefix.
-         */
-        ZyanU8 offset_mandatory;
-        /**
-         * The offset of a possible `CET` `no-lock` prefix.
-         */
-        ZyanI8 offset_notrack;
-    } prefixes;
-} ZydisDecoderState;
+// The storage types passed to `ZYDIS_ENUM_FIELD` must be able to represent every enum value,
+// regardless of whether `ZYDIS_PACKED_TYPES` is enabled for the current build
+ZYAN_STATIC_ASSERT(ZYDIS_MACHINE_MODE_REQUIRED_BITS         <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_MNEMONIC_REQUIRED_BITS             <= 16);
+ZYAN_STATIC_ASSERT(ZYDIS_REGISTER_REQUIRED_BITS             <= 16);
+ZYAN_STATIC_ASSERT(ZYDIS_INSTRUCTION_ENCODING_REQUIRED_BITS <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_OPCODE_MAP_REQUIRED_BITS           <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_OPERAND_TYPE_REQUIRED_BITS         <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_OPERAND_VISIBILITY_REQUIRED_BITS   <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_OPERAND_ENCODING_REQUIRED_BITS     <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_ELEMENT_TYPE_REQUIRED_BITS         <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_MEMOP_TYPE_REQUIRED_BITS           <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_MASK_MODE_REQUIRED_BITS            <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_BROADCAST_MODE_REQUIRED_BITS       <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_ROUNDING_MODE_REQUIRED_BITS        <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_SWIZZLE_MODE_REQUIRED_BITS         <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_CONVERSION_MODE_REQUIRED_BITS      <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_CATEGORY_REQUIRED_BITS             <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_ISA_SET_REQUIRED_BITS              <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_ISA_EXT_REQUIRED_BITS              <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_BRANCH_TYPE_REQUIRED_BITS          <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_EXCEPTION_CLASS_REQUIRED_BITS      <=  8);
+ZYAN_STATIC_ASSERT(ZYDIS_PREFIX_TYPE_REQUIRED_BITS          <=  8);
 
 /* ---------------------------------------------------------------------------------------------- */
 /* Register encoding                                                                              */
@@ -959,10 +893,12 @@ static ZyanU8 ZydisCalcRegisterId(const ZydisDecoderContext* context,
  * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
  * @param   operand         A pointer to the `ZydisDecodedOperand` struct.
  * @param   definition      A pointer to the `ZydisOperandDefinition` struct.
+ * @param   element_info    `ZYAN_TRUE` to set the element-type, -size and -count or `ZYAN_FALSE`
+ *                          to only set the operand-size.
  */
 static void ZydisSetOperandSizeAndElementInfo(const ZydisDecoderContext* context,
     const ZydisDecodedInstruction* instruction, ZydisDecodedOperand* operand,
-    const ZydisOperandDefinition* definition)
+    const ZydisOperandDefinition* definition, ZyanBool element_info)
 {
     ZYAN_ASSERT(context);
     ZYAN_ASSERT(instruction);
@@ -1180,11 +1116,21 @@ static void ZydisSetOperandSizeAndElementInfo(const ZydisDecoderContext* context
         ZYAN_UNREACHABLE;
     }
 
+    if (!element_info)
+    {
+        // Register, `AGEN` and `MVEX` operands set some element information while computing
+        // the operand size. Clear it, so callers never see partial element information.
+        operand->element_type = ZYDIS_ELEMENT_TYPE_INVALID;
+        operand->element_size = 0;
+        return;
+    }
+
     // Element-type and -size
     if (definition->element_type && (definition->element_type != ZYDIS_IELEMENT_TYPE_VARIABLE))
     {
-        ZydisGetElementInfo(definition->element_type, &operand->element_type,
-            &operand->element_size);
+        ZydisElementType element_type;
+        ZydisGetElementInfo(definition->element_type, &element_type, &operand->element_size);
+        operand->element_type = element_type;
         if (!operand->element_size)
         {
             // The element size is the same as the operand size. This is used for single element
@@ -1208,6 +1154,7 @@ static void ZydisSetOperandSizeAndElementInfo(const ZydisDecoderContext* context
 /**
  * Decodes an register-operand.
  *
+ * @param   decoder          A pointer to the `ZydisDecoder` instance.
  * @param   instruction      A pointer to the `ZydisDecodedInstruction` struct.
  * @param   operand          A pointer to the `ZydisDecodedOperand` struct.
  * @param   register_class   The register class.
@@ -1215,9 +1162,11 @@ static void ZydisSetOperandSizeAndElementInfo(const ZydisDecoderContext* context
  *
  * @return  A zyan status code.
  */
-static ZyanStatus ZydisDecodeOperandRegister(const ZydisDecodedInstruction* instruction,
-    ZydisDecodedOperand* operand, ZydisRegisterClass register_class, ZyanU8 register_id)
+static ZyanStatus ZydisDecodeOperandRegister(const ZydisDecoder* decoder,
+    const ZydisDecodedInstruction* instruction, ZydisDecodedOperand* operand,
+    ZydisRegisterClass register_class, ZyanU8 register_id)
 {
+    ZYAN_ASSERT(decoder);
     ZYAN_ASSERT(instruction);
     ZYAN_ASSERT(operand);
 
@@ -1235,7 +1184,10 @@ static ZyanStatus ZydisDecodeOperandRegister(const ZydisDecodedInstruction* inst
     } else
     {
         operand->reg.value = ZydisRegisterEncode(register_class, register_id);
-        ZYAN_ASSERT(operand->reg.value);
+        // Register ids are not validated in trusted-input mode
+        ZYAN_ASSERT(operand->reg.value ||
+            (decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_TRUSTED_INPUT)));
+        ZYAN_UNUSED(decoder);
         /*if (!operand->reg.value)
         {
             return ZYAN_STATUS_BAD_REGISTER;
@@ -1590,8 +1542,22 @@ static void ZydisDecodeOperandImplicitMemory(const ZydisDecoder* decoder,
 #endif
 
 #ifndef ZYDIS_MINIMAL_MODE
-static ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDecoderContext* context,
-    const ZydisDecodedInstruction* instruction, ZydisDecodedOperand* operands, ZyanU8 operand_count)
+/**
+ * Decodes the operands of the given instruction.
+ *
+ * @param   decoder         A pointer to the `ZydisDecoder` instance.
+ * @param   context         A pointer to the `ZydisDecoderContext` struct.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to the `ZydisDecodedOperand` array.
+ * @param   operand_count   The number of operands to decode.
+ * @param   format_only     `ZYAN_TRUE` to skip the operand-actions and element information, which
+ *                          are not used by the formatter.
+ *
+ * @return  A zyan status code.
+ */
+ZYDIS_INTERNAL_STATIC ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder,
+    const ZydisDecoderContext* context, const ZydisDecodedInstruction* instruction,
+    ZydisDecodedOperand* operands, ZyanU8 operand_count, ZyanBool format_only)
 {
     ZYAN_ASSERT(decoder);
     ZYAN_ASSERT(context);
@@ -1613,7 +1579,7 @@ static ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDe
 
         operands[i].id = i;
         operands[i].visibility = operand->visibility;
-        operands[i].actions = operand->actions;
+        operands[i].actions = format_only ? 0 : operand->actions;
         ZYAN_ASSERT(!(operand->actions &
             ZYDIS_OPERAND_ACTION_READ & ZYDIS_OPERAND_ACTION_CONDREAD) ||
             (operand->actions & ZYDIS_OPERAND_ACTION_READ) ^
@@ -1734,42 +1700,42 @@ static ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDe
             case ZYDIS_OPERAND_ENCODING_MODRM_REG:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_REG, register_class)));
                 break;
             case ZYDIS_OPERAND_ENCODING_MODRM_RM:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_RM, register_class)));
                 break;
             case ZYDIS_OPERAND_ENCODING_OPCODE:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_OPCODE, register_class)));
                 break;
             case ZYDIS_OPERAND_ENCODING_NDSNDD:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_NDSNDD, register_class)));
                 break;
             case ZYDIS_OPERAND_ENCODING_MASK:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_MASK, register_class)));
                 break;
             case ZYDIS_OPERAND_ENCODING_IS4:
                 ZYAN_CHECK(
                     ZydisDecodeOperandRegister(
-                        instruction, &operands[i], register_class,
+                        decoder, instruction, &operands[i], register_class,
                         ZydisCalcRegisterId(
                             context, instruction, ZYDIS_REG_ENCODING_IS4, register_class)));
                 break;
@@ -1950,13 +1916,14 @@ static ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDe
                                 }
         }
 
-        ZydisSetOperandSizeAndElementInfo(context, instruction, &operands[i], operand);
+        ZydisSetOperandSizeAndElementInfo(context, instruction, &operands[i], operand,
+            !format_only);
         ++operand;
     }
 
 #if !defined(ZYDIS_DISABLE_AVX512) || !defined(ZYDIS_DISABLE_KNC)
     // Fix operand-action for EVEX/MVEX instructions with merge-mask
-    if (instruction->avx.mask.mode == ZYDIS_MASK_MODE_MERGING)
+    if (!format_only && (instruction->avx.mask.mode == ZYDIS_MASK_MODE_MERGING))
     {
         ZYAN_ASSERT(operand_count >= 1);
         switch (operands[0].actions)
@@ -1994,8 +1961,8 @@ static ZyanStatus ZydisDecodeOperands(const ZydisDecoder* decoder, const ZydisDe
  * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
  * @param   definition  A pointer to the `ZydisInstructionDefinition` struct.
  */
-static void ZydisSetAttributes(ZydisDecoderState* state, ZydisDecodedInstruction* instruction,
-    const ZydisInstructionDefinition* definition)
+ZYDIS_INTERNAL_STATIC void ZydisSetAttributes(ZydisDecoderState* state,
+    ZydisDecodedInstruction* instruction, const ZydisInstructionDefinition* definition)
 {
     ZYAN_ASSERT(state);
     ZYAN_ASSERT(instruction);
@@ -2297,7 +2264,7 @@ static void ZydisSetAttributes(ZydisDecoderState* state, ZydisDecodedInstruction
  * - Eviction hint
  * - Compressed 8-bit displacement scale-factor
  */
-static void ZydisSetAVXInformation(ZydisDecoderContext* context,
+ZYDIS_INTERNAL_STATIC void ZydisSetAVXInformation(ZydisDecoderContext* context,
     ZydisDecodedInstruction* instruction, const ZydisInstructionDefinition* definition)
 {
     ZYAN_ASSERT(context);
@@ -3081,7 +3048,7 @@ static void ZydisSetAVXInformation(ZydisDecoderContext* context,
  * This function sets the corresponding flag for each prefix and automatically decodes the last
  * `REX`-prefix (if exists).
  */
-static ZyanStatus ZydisCollectOptionalPrefixes(ZydisDecoderState* state,
+ZYDIS_INTERNAL_STATIC ZyanStatus ZydisCollectOptionalPrefixes(ZydisDecoderState* state,
     ZydisDecodedInstruction* instruction)
 {
     ZYAN_ASSERT(state);
@@ -4143,6 +4110,7 @@ static ZyanStatus ZydisNodeHandlerMvexE(const ZydisDecodedInstruction* instructi
  * @param   def_reg     The type definition for the `.reg` encoded operand.
  * @param   def_rm      The type definition for the `.rm` encoded operand.
  * @param   def_ndsndd  The type definition for the `.vvvv` encoded operand.
+ * @param   validate    Signals, if the register constraints should be validated.
  *
  * @return  A zyan status code.
  *
@@ -4155,7 +4123,8 @@ static ZyanStatus ZydisNodeHandlerMvexE(const ZydisDecodedInstruction* instructi
  * - `def_rm`     -> `ZydisRegisterKind` (`.mod == 3`) or ZydisMemoryOperandType (`.mod != 3`)
  */
 static ZyanStatus ZydisPopulateRegisterIds(ZydisDecoderContext* context,
-    const ZydisDecodedInstruction* instruction, ZyanU8 def_reg, ZyanU8 def_rm, ZyanU8 def_ndsndd)
+    const ZydisDecodedInstruction* instruction, ZyanU8 def_reg, ZyanU8 def_rm, ZyanU8 def_ndsndd,
+    ZyanBool validate)
 {
     ZYAN_ASSERT(context);
     ZYAN_ASSERT(instruction);
@@ -4244,6 +4213,11 @@ static ZyanStatus ZydisPopulateRegisterIds(ZydisDecoderContext* context,
         //};
     }
 
+    if (!validate)
+    {
+        goto AssignToContext;
+    }
+
     // Validate
 
     // `.vvvv` is not allowed, if the instruction does not encode a NDS/NDD operand
@@ -4325,7 +4299,7 @@ static ZyanStatus ZydisPopulateRegisterIds(ZydisDecoderContext* context,
         }
     }
 
-    // Assign to context
+AssignToContext:
 
     context->reg_info.id_reg    = def_reg          ? id_reg    : -1;
     context->reg_info.id_rm     = def_rm && is_reg ? id_rm     : -1;
@@ -4336,6 +4310,83 @@ static ZyanStatus ZydisPopulateRegisterIds(ZydisDecoderContext* context,
     return ZYAN_STATUS_SUCCESS;
 }
 
+#ifndef ZYDIS_DISABLE_KNC
+/**
+ * Checks if the `MVEX.SSS` value of the given instruction is valid for the functionality of the
+ * given definition.
+ *
+ * @param   definition  A pointer to the `ZydisInstructionDefinitionMVEX` struct.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the `MVEX.SSS` value is valid or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisIsValidMVEXSSS(const ZydisInstructionDefinitionMVEX* definition,
+    const ZydisDecodedInstruction* instruction)
+{
+    ZYAN_ASSERT(definition);
+    ZYAN_ASSERT(instruction);
+
+    static const ZyanU8 lookup[26][8] =
+    {
+        // ZYDIS_MVEX_FUNC_IGNORED
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_INVALID
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_RC
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_SAE
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_F_32
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_I_32
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_F_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_I_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SWIZZLE_32
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_SWIZZLE_64
+        { 1, 1, 1, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_SF_32
+        { 1, 1, 1, 1, 1, 0, 1, 1 },
+        // ZYDIS_MVEX_FUNC_SF_32_BCST
+        { 1, 1, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SF_32_BCST_4TO16
+        { 1, 0, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SF_64
+        { 1, 1, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SI_32
+        { 1, 1, 1, 0, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_SI_32_BCST
+        { 1, 1, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SI_32_BCST_4TO16
+        { 1, 0, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_SI_64
+        { 1, 1, 1, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_UF_32
+        { 1, 0, 0, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_UF_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_UI_32
+        { 1, 0, 0, 0, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_UI_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_DF_32
+        { 1, 0, 0, 1, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_DF_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 },
+        // ZYDIS_MVEX_FUNC_DI_32
+        { 1, 0, 0, 0, 1, 1, 1, 1 },
+        // ZYDIS_MVEX_FUNC_DI_64
+        { 1, 0, 0, 0, 0, 0, 0, 0 }
+    };
+    ZYAN_ASSERT(definition->functionality < ZYAN_ARRAY_LENGTH(lookup));
+    ZYAN_ASSERT(instruction->raw.mvex.SSS < 8);
+    return lookup[definition->functionality][instruction->raw.mvex.SSS];
+}
+#endif
+
 /**
  * Checks for certain post-decode error-conditions.
  *
@@ -4440,64 +4491,7 @@ static ZyanStatus ZydisCheckErrorConditions(ZydisDecoderState* state,
         mask_policy = def->mask_policy;
 
         // Check for invalid MVEX.SSS values
-        static const ZyanU8 lookup[26][8] =
-        {
-            // ZYDIS_MVEX_FUNC_IGNORED
-            { 1, 1, 1, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_INVALID
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_RC
-            { 1, 1, 1, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_SAE
-            { 1, 1, 1, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_F_32
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_I_32
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_F_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_I_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SWIZZLE_32
-            { 1, 1, 1, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_SWIZZLE_64
-            { 1, 1, 1, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_SF_32
-            { 1, 1, 1, 1, 1, 0, 1, 1 },
-            // ZYDIS_MVEX_FUNC_SF_32_BCST
-            { 1, 1, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SF_32_BCST_4TO16
-            { 1, 0, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SF_64
-            { 1, 1, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SI_32
-            { 1, 1, 1, 0, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_SI_32_BCST
-            { 1, 1, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SI_32_BCST_4TO16
-            { 1, 0, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_SI_64
-            { 1, 1, 1, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_UF_32
-            { 1, 0, 0, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_UF_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_UI_32
-            { 1, 0, 0, 0, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_UI_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_DF_32
-            { 1, 0, 0, 1, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_DF_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 },
-            // ZYDIS_MVEX_FUNC_DI_32
-            { 1, 0, 0, 0, 1, 1, 1, 1 },
-            // ZYDIS_MVEX_FUNC_DI_64
-            { 1, 0, 0, 0, 0, 0, 0, 0 }
-        };
-        ZYAN_ASSERT(def->functionality < ZYAN_ARRAY_LENGTH(lookup));
-        ZYAN_ASSERT(instruction->raw.mvex.SSS < 8);
-        if (!lookup[def->functionality][instruction->raw.mvex.SSS])
+        if (!ZydisIsValidMVEXSSS(def, instruction))
         {
             return ZYDIS_STATUS_DECODING_ERROR;
         }
@@ -4548,7 +4542,8 @@ static ZyanStatus ZydisCheckErrorConditions(ZydisDecoderState* state,
     }
 
     // Populate- and validate register constraints
-    ZYAN_CHECK(ZydisPopulateRegisterIds(context, instruction, def_reg, def_rm, def_ndsndd));
+    ZYAN_CHECK(ZydisPopulateRegisterIds(context, instruction, def_reg, def_rm, def_ndsndd,
+        ZYAN_TRUE));
 
     // `ZYDIS_REGISTER_CS` is not allowed as `MOV` target
     if (is_sr_dest_reg && (context->reg_info.id_reg == 1))
@@ -4664,6 +4659,84 @@ static ZyanStatus ZydisCheckErrorConditions(ZydisDecoderState* state,
     return ZYAN_STATUS_SUCCESS;
 }
 
+/**
+ * Populates the register ids without checking for post-decode error-conditions.
+ *
+ * @param   state       A pointer to the `ZydisDecoderState` struct.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   definition  A pointer to the `ZydisInstructionDefinition` struct.
+ *
+ * @return  A zyan status code.
+ *
+ * This function replaces `ZydisCheckErrorConditions` in `ZYDIS_DECODER_MODE_TRUSTED_INPUT`. Only
+ * the checks required to keep the remaining decoding steps well-defined are performed.
+ */
+static ZyanStatus ZydisPopulateRegisterIdsTrusted(ZydisDecoderState* state,
+    const ZydisDecodedInstruction* instruction, const ZydisInstructionDefinition* definition)
+{
+    ZYAN_ASSERT(state);
+    ZYAN_ASSERT(instruction);
+    ZYAN_ASSERT(definition);
+
+    ZyanU8 def_reg    = definition->op_reg;
+    ZyanU8 def_rm     = definition->op_rm;
+    ZyanU8 def_ndsndd = ZYDIS_REGKIND_INVALID;
+
+    switch (instruction->encoding)
+    {
+    case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+    case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+        break;
+    case ZYDIS_INSTRUCTION_ENCODING_XOP:
+        def_ndsndd = ((const ZydisInstructionDefinitionXOP*)definition)->op_ndsndd;
+        break;
+    case ZYDIS_INSTRUCTION_ENCODING_VEX:
+        def_ndsndd = ((const ZydisInstructionDefinitionVEX*)definition)->op_ndsndd;
+        break;
+    case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+#ifndef ZYDIS_DISABLE_AVX512
+        def_ndsndd = ((const ZydisInstructionDefinitionEVEX*)definition)->op_ndsndd;
+#else
+        ZYAN_UNREACHABLE;
+#endif
+        break;
+    case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+    {
+#ifndef ZYDIS_DISABLE_KNC
+        const ZydisInstructionDefinitionMVEX* def =
+            (const ZydisInstructionDefinitionMVEX*)definition;
+        def_ndsndd = def->op_ndsndd;
+
+        // The `MVEX.SSS` value selects between mutually exclusive decoding paths later on, so
+        // this check can not be skipped
+        if (!ZydisIsValidMVEXSSS(def, instruction))
+        {
+            return ZYDIS_STATUS_DECODING_ERROR;
+        }
+#else
+        ZYAN_UNREACHABLE;
+#endif
+        break;
+    }
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    ZydisDecoderContext* context = state->context;
+    if (def_reg)
+    {
+        def_reg = ZYDIS_OPDEF_GET_REG(def_reg);
+    }
+    if (def_rm)
+    {
+        def_rm = context->reg_info.is_mod_reg
+            ? ZYDIS_OPDEF_GET_REG(def_rm)
+            : ZYDIS_OPDEF_GET_MEM(def_rm);
+    }
+
+    return ZydisPopulateRegisterIds(context, instruction, def_reg, def_rm, def_ndsndd, ZYAN_FALSE);
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /**
@@ -4674,28 +4747,30 @@ static ZyanStatus ZydisCheckErrorConditions(ZydisDecoderState* state,
  *
  * @return  A zyan status code.
  */
-static ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
+ZYDIS_INTERNAL_STATIC ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
     ZydisDecodedInstruction* instruction)
 {
     ZYAN_ASSERT(state);
     ZYAN_ASSERT(instruction);
 
     // Iterate through the decoder tree
-    const ZydisDecoderTreeNode* node = ZydisDecoderTreeGetRootNode();
-    const ZydisDecoderTreeNode* temp = ZYAN_NULL;
+    ZydisDecoderTreeNodeRef node = ZydisDecoderTreeGetRootNode();
+    ZydisDecoderTreeNodeRef temp = node;
+    ZyanBool has_temp = ZYAN_FALSE;
     ZydisDecoderTreeNodeType node_type;
     do
     {
-        node_type = node->type;
+        const ZydisDecoderTreeNode* current = ZydisDecoderTreeNodeGet(&node);
+        node_type = current->type;
         ZyanU16 index = 0;
         ZyanStatus status = 0;
         switch (node_type)
         {
         case ZYDIS_NODETYPE_INVALID:
-            if (temp)
+            if (has_temp)
             {
                 node = temp;
-                temp = ZYAN_NULL;
+                has_temp = ZYAN_FALSE;
                 node_type = ZYDIS_NODETYPE_FILTER_MANDATORY_PREFIX;
                 if (state->prefixes.mandatory_candidate != 0x00)
                 {
@@ -4750,7 +4825,8 @@ static ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
             break;
         case ZYDIS_NODETYPE_FILTER_MANDATORY_PREFIX:
             status = ZydisNodeHandlerMandatoryPrefix(state, instruction, &index);
-            temp = ZydisDecoderTreeGetChildNode(node, 0);
+            temp = ZydisDecoderTreeGetChildNode(current, 0);
+            has_temp = ZYAN_TRUE;
             // TODO: Return to this point, if index == 0 contains a value and the previous path
             // TODO: was not successful
             // TODO: Restore consumed prefix
@@ -4814,32 +4890,43 @@ static ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
             if (node_type & ZYDIS_NODETYPE_DEFINITION_MASK)
             {
                 const ZydisInstructionDefinition* definition;
-                ZydisGetInstructionDefinition(instruction->encoding, node->value, &definition);
+                ZydisGetInstructionDefinition(instruction->encoding, current->value, &definition);
                 ZydisSetEffectiveOperandWidth(state->context, instruction, definition);
                 ZydisSetEffectiveAddressWidth(state->context, instruction, definition);
 
                 const ZydisInstructionEncodingInfo* info;
-                ZydisGetInstructionEncodingInfo(node, &info);
+                ZydisGetInstructionEncodingInfo(current, &info);
                 ZYAN_CHECK(ZydisDecodeOptionalInstructionParts(state, instruction, info));
-                ZYAN_CHECK(ZydisCheckErrorConditions(state, instruction, definition));
+                if (state->decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_TRUSTED_INPUT))
+                {
+                    ZYAN_CHECK(ZydisPopulateRegisterIdsTrusted(state, instruction, definition));
+                }
+                else
+                {
+                    ZYAN_CHECK(ZydisCheckErrorConditions(state, instruction, definition));
+                }
 
                 if (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_3DNOW)
                 {
                     // Get actual 3DNOW opcode and definition
                     ZYAN_CHECK(ZydisInputNext(state, instruction, &instruction->opcode));
                     node = ZydisDecoderTreeGetRootNode();
-                    node = ZydisDecoderTreeGetChildNode(node, 0x0F);
-                    node = ZydisDecoderTreeGetChildNode(node, 0x0F);
-                    node = ZydisDecoderTreeGetChildNode(node, instruction->opcode);
-                    if (node->type == ZYDIS_NODETYPE_INVALID)
+                    node = ZydisDecoderTreeGetChildNode(ZydisDecoderTreeNodeGet(&node), 0x0F);
+                    node = ZydisDecoderTreeGetChildNode(ZydisDecoderTreeNodeGet(&node), 0x0F);
+                    node = ZydisDecoderTreeGetChildNode(ZydisDecoderTreeNodeGet(&node),
+                        instruction->opcode);
+                    current = ZydisDecoderTreeNodeGet(&node);
+                    if (current->type == ZYDIS_NODETYPE_INVALID)
                     {
                         return ZYDIS_STATUS_DECODING_ERROR;
                     }
-                    ZYAN_ASSERT(node->type == ZYDIS_NODETYPE_FILTER_MODRM_MOD_COMPACT);
+                    ZYAN_ASSERT(current->type == ZYDIS_NODETYPE_FILTER_MODRM_MOD_COMPACT);
                     node = ZydisDecoderTreeGetChildNode(
-                        node, (instruction->raw.modrm.mod == 0x3) ? 0 : 1);
-                    ZYAN_ASSERT(node->type & ZYDIS_NODETYPE_DEFINITION_MASK);
-                    ZydisGetInstructionDefinition(instruction->encoding, node->value, &definition);
+                        current, (instruction->raw.modrm.mod == 0x3) ? 0 : 1);
+                    current = ZydisDecoderTreeNodeGet(&node);
+                    ZYAN_ASSERT(current->type & ZYDIS_NODETYPE_DEFINITION_MASK);
+                    ZydisGetInstructionDefinition(instruction->encoding, current->value,
+                        &definition);
                 }
 
                 instruction->mnemonic = definition->mnemonic;
@@ -4892,11 +4979,113 @@ static ZyanStatus ZydisDecodeInstruction(ZydisDecoderState* state,
             ZYAN_UNREACHABLE;
         }
         ZYAN_CHECK(status);
-        node = ZydisDecoderTreeGetChildNode(node, index);
+        node = ZydisDecoderTreeGetChildNode(current, index);
     } while ((node_type != ZYDIS_NODETYPE_INVALID) && !(node_type & ZYDIS_NODETYPE_DEFINITION_MASK));
     return ZYAN_STATUS_SUCCESS;
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+/* Decoder cache                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Checks if the given instruction can be decoded from a cache entry.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction can be decoded from a cache entry or `ZYAN_FALSE`, if
+ *          not.
+ *
+ * Only instructions without prefixes, `ModRM` and displacement whose bytes following the opcode
+ * are exclusively immediate values are eligible.
+ */
+static ZyanBool ZydisIsCacheableInstruction(const ZydisDecodedInstruction* instruction)
+{
+    ZYAN_ASSERT(instruction);
+
+    return (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_LEGACY) &&
+        (instruction->opcode_map == ZYDIS_OPCODE_MAP_DEFAULT) &&
+        (instruction->raw.prefix_count == 0) &&
+        !(instruction->attributes & ZYDIS_ATTRIB_HAS_MODRM) &&
+        (instruction->raw.disp.size == 0) &&
+        (instruction->length ==
+            1 + (instruction->raw.imm[0].size + instruction->raw.imm[1].size) / 8);
+}
+
+/**
+ * Decodes an instruction from the given cache entry.
+ *
+ * @param   entry       A pointer to the `ZydisDecoderCacheEntry` struct.
+ * @param   buffer      A pointer to the input buffer. Must contain at least as many bytes as the
+ *                      length of the cached instruction.
+ * @param   context     A pointer to the `ZydisDecoderContext` struct or `ZYAN_NULL`.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ */
+static void ZydisDecodeCachedInstruction(const ZydisDecoderCacheEntry* entry,
+    const ZyanU8* buffer, ZydisDecoderContext* context, ZydisDecodedInstruction* instruction)
+{
+    ZYAN_ASSERT(entry);
+    ZYAN_ASSERT(buffer);
+    ZYAN_ASSERT(instruction);
+
+    ZYAN_MEMCPY(instruction, &entry->instruction, sizeof(*instruction));
+    if (context)
+    {
+        ZYAN_MEMCPY(context, &entry->context, sizeof(*context));
+    }
+
+    for (ZyanU8 i = 0; i < ZYAN_ARRAY_LENGTH(instruction->raw.imm); ++i)
+    {
+        struct ZydisDecodedInstructionRawImm_* imm = &instruction->raw.imm[i];
+        const ZyanU8* data = buffer + imm->offset;
+        switch (imm->size)
+        {
+        case 0:
+            break;
+        case 8:
+            if (imm->is_signed)
+            {
+                imm->value.s = (ZyanI8)data[0];
+            } else
+            {
+                imm->value.u = data[0];
+            }
+            break;
+        case 16:
+        {
+            ZyanU16 value;
+            ZYAN_MEMCPY(&value, data, sizeof(value));
+            if (imm->is_signed)
+            {
+                imm->value.s = (ZyanI16)value;
+            } else
+            {
+                imm->value.u = value;
+            }
+            break;
+        }
+        case 32:
+        {
+            ZyanU32 value;
+            ZYAN_MEMCPY(&value, data, sizeof(value));
+            if (imm->is_signed)
+            {
+                imm->value.s = (ZyanI32)value;
+            } else
+            {
+                imm->value.u = value;
+            }
+            break;
+        }
+        case 64:
+            ZYAN_MEMCPY(&imm->value.u, data, sizeof(imm->value.u));
+            break;
+        default:
+            ZYAN_UNREACHABLE;
+        }
+    }
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* ============================================================================================== */
@@ -4978,6 +5167,72 @@ ZyanStatus ZydisDecoderEnableMode(ZydisDecoder* decoder, ZydisDecoderMode mode,
     return ZYAN_STATUS_SUCCESS;
 }
 
+ZyanStatus ZydisDecoderGetCacheSize(ZyanUSize* size)
+{
+    if (!size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *size = sizeof(ZydisDecoderCache);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisDecoderInitCache(const ZydisDecoder* decoder, void* memory, ZyanUSize size,
+    ZydisDecoderCache** cache)
+{
+    if (!decoder || !memory || ((ZyanUPointer)memory & 7) || !cache)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    if (size < sizeof(ZydisDecoderCache))
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZydisDecoderCache* const result = (ZydisDecoderCache*)memory;
+    ZYAN_MEMSET(result, 0, sizeof(*result));
+    result->decoder = *decoder;
+
+    for (ZyanU16 opcode = 0; opcode < ZYAN_ARRAY_LENGTH(result->entries); ++opcode)
+    {
+        ZydisDecoderCacheEntry* entry = &result->entries[opcode];
+
+        ZyanU8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZYAN_MEMSET(buffer, 0x00, sizeof(buffer));
+        buffer[0] = (ZyanU8)opcode;
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &entry->context, buffer,
+            sizeof(buffer), &entry->instruction)) ||
+            !ZydisIsCacheableInstruction(&entry->instruction))
+        {
+            continue;
+        }
+
+        // Make sure the decoding result does not depend on the immediate values
+        ZydisDecoderCacheEntry expected;
+        ZydisDecoderCacheEntry actual;
+        ZYAN_MEMSET(&buffer[1], 0xFF, sizeof(buffer) - 1);
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &expected.context, buffer,
+            sizeof(buffer), &expected.instruction)))
+        {
+            continue;
+        }
+        ZydisDecodeCachedInstruction(entry, buffer, &actual.context, &actual.instruction);
+        if (ZYAN_MEMCMP(&expected.instruction, &actual.instruction, sizeof(actual.instruction)) ||
+            ZYAN_MEMCMP(&expected.context, &actual.context, sizeof(actual.context)))
+        {
+            continue;
+        }
+
+        result->mask[opcode >> 6] |= (1ULL << (opcode & 63));
+    }
+
+    *cache = result;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
 ZyanStatus ZydisDecoderDecodeFull(const ZydisDecoder* decoder,
     const void* buffer, ZyanUSize length, ZydisDecodedInstruction* instruction,
     ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT])
@@ -5046,6 +5301,32 @@ ZyanStatus ZydisDecoderDecodeInstruction(const ZydisDecoder* decoder, ZydisDecod
     return ZYAN_STATUS_SUCCESS;
 }
 
+ZyanStatus ZydisDecoderDecodeInstructionCached(const ZydisDecoderCache* cache,
+    ZydisDecoderContext* context, const void* buffer, ZyanUSize length,
+    ZydisDecodedInstruction* instruction)
+{
+    if (!cache || !instruction || !buffer)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (length)
+    {
+        const ZyanU8 opcode = *(const ZyanU8*)buffer;
+        if (cache->mask[opcode >> 6] & (1ULL << (opcode & 63)))
+        {
+            const ZydisDecoderCacheEntry* entry = &cache->entries[opcode];
+            if (length >= entry->instruction.length)
+            {
+                ZydisDecodeCachedInstruction(entry, (const ZyanU8*)buffer, context, instruction);
+                return ZYAN_STATUS_SUCCESS;
+            }
+        }
+    }
+
+    return ZydisDecoderDecodeInstruction(&cache->decoder, context, buffer, length, instruction);
+}
+
 ZyanStatus ZydisDecoderDecodeOperands(const ZydisDecoder* decoder,
     const ZydisDecoderContext* context, const ZydisDecodedInstruction* instruction,
     ZydisDecodedOperand* operands, ZyanU8 operand_count)
@@ -5079,9 +5360,34 @@ ZyanStatus ZydisDecoderDecodeOperands(const ZydisDecoder* decoder,
         return ZYAN_STATUS_SUCCESS;
     }
 
-    return ZydisDecodeOperands(decoder, context, instruction, operands, operand_count);
+    return ZydisDecodeOperands(decoder, context, instruction, operands, operand_count,
+        ZYAN_FALSE);
 
 #endif
 }
 
+#ifndef ZYDIS_MINIMAL_MODE
+
+ZyanStatus ZydisDecoderDecodeVisibleOperands(const ZydisDecoder* decoder,
+    const ZydisDecoderContext* context, const ZydisDecodedInstruction* instruction,
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT_VISIBLE])
+{
+    ZYAN_ASSERT(decoder);
+    ZYAN_ASSERT(!(decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)));
+    ZYAN_ASSERT(context);
+    ZYAN_ASSERT(context->definition);
+    ZYAN_ASSERT(instruction);
+    ZYAN_ASSERT(operands);
+
+    if (!instruction->operand_count_visible)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    return ZydisDecodeOperands(decoder, context, instruction, operands,
+        instruction->operand_count_visible, ZYAN_TRUE);
+}
+
+#endif
+
 /* ============================================================================================== */
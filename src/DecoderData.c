@@ -25,6 +25,7 @@
 ***************************************************************************************************/
 
 #include <Zydis/Internal/DecoderData.h>
+#include <Zydis/Internal/SharedData.h>
 
 /* ============================================================================================== */
 /* Data tables                                                                                    */
@@ -34,12 +35,22 @@
 /* Physical instruction encodings                                                                 */
 /* ---------------------------------------------------------------------------------------------- */
 
+// `INSTR_ENCODINGS` has internal linkage, so it can't be pre-declared in `DataTables.c`
+ZYDIS_TABLE_SECTION
 #include <Generated/InstructionEncodings.inc>
 
 /* ---------------------------------------------------------------------------------------------- */
 /* Decoder tree                                                                                   */
 /* ---------------------------------------------------------------------------------------------- */
 
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+
+// Each filter row is stored as a presence bitmap (preceded by rank bytes for filters with more
+// than 8 children) followed by the present child nodes. See `assets/compile_decoder_bytecode.py`
+#include <Generated/DecoderBytecode.inc>
+
+#else
+
 #define ZYDIS_INVALID \
     { ZYDIS_NODETYPE_INVALID, 0x00000000 }
 #define ZYDIS_FILTER(type, id) \
@@ -53,6 +64,22 @@
 #undef ZYDIS_FILTER
 #undef ZYDIS_DEFINITION
 
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Decoder tree profile                                                                           */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifdef ZYDIS_PROFILE_DECODER_TABLES
+
+/**
+ * Contains the number of visits for each row of each filter table.
+ */
+static ZyanU32 FILTER_VISITS[ZYDIS_NODETYPE_FILTER_MODE_UD0_COMPAT + 1]
+    [ZYDIS_DECODER_TREE_PROFILE_MAX_ROWS];
+
+#endif
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* ============================================================================================== */
@@ -65,9 +92,64 @@
 
 const ZydisDecoderTreeNode zydis_decoder_tree_root = { ZYDIS_NODETYPE_FILTER_OPCODE, 0x0000 };
 
+#ifdef ZYDIS_COMPACT_DECODER_TABLES
+
+/**
+ * Contains the number of set bits of every 4-bit value.
+ */
+static const ZyanU8 NIBBLE_BIT_COUNT[16] =
+{
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+ZydisDecoderTreeNode ZydisDecoderTreeGetChildNode(const ZydisDecoderTreeNode* parent,
+    ZyanU16 index)
+{
+    ZYAN_ASSERT(parent->type < ZYAN_ARRAY_LENGTH(FILTER_WIDTHS));
+    const ZyanU16 width = FILTER_WIDTHS[parent->type];
+    ZYAN_ASSERT(index < width);
+    ZYAN_ASSERT(parent->value < ZYAN_ARRAY_LENGTH(DECODER_BYTECODE));
+
+    const ZyanU8* row = &DECODER_BYTECODE[parent->value];
+    ZyanU8 bitmap;
+    ZyanU8 rank = 0;
+    if (width <= 8)
+    {
+        bitmap = row[0];
+        row += 1;
+    }
+    else
+    {
+        const ZyanU8 bitmap_size = (ZyanU8)((width + 7) / 8);
+        bitmap = row[index / 8];
+        rank = row[bitmap_size + index / 8];
+        row += 2 * bitmap_size;
+    }
+
+    ZydisDecoderTreeNode node = { ZYDIS_NODETYPE_INVALID, 0x0000 };
+    const ZyanU8 mask = (ZyanU8)(1 << (index % 8));
+    if (bitmap & mask)
+    {
+        const ZyanU8 preceding = bitmap & (mask - 1);
+        rank += NIBBLE_BIT_COUNT[preceding & 0x0F] + NIBBLE_BIT_COUNT[preceding >> 4];
+        row += rank * 3;
+        node.type = row[0];
+        node.value = (ZydisDecoderTreeNodeValue)(row[1] | (row[2] << 8));
+    }
+    return node;
+}
+
+#else
+
 const ZydisDecoderTreeNode* ZydisDecoderTreeGetChildNode(const ZydisDecoderTreeNode* parent,
     ZyanU16 index)
 {
+#ifdef ZYDIS_PROFILE_DECODER_TABLES
+    ZYAN_ASSERT(parent->type < ZYAN_ARRAY_LENGTH(FILTER_VISITS));
+    ZYAN_ASSERT(parent->value < ZYDIS_DECODER_TREE_PROFILE_MAX_ROWS);
+    ++FILTER_VISITS[parent->type][parent->value];
+#endif
+
     switch (parent->type)
     {
     case ZYDIS_NODETYPE_FILTER_XOP:
@@ -166,6 +248,23 @@ const ZydisDecoderTreeNode* ZydisDecoderTreeGetChildNode(const ZydisDecoderTreeN
     }
 }
 
+#endif
+
+#ifdef ZYDIS_PROFILE_DECODER_TABLES
+
+ZyanU32 ZydisDecoderTreeGetVisitCount(ZydisDecoderTreeNodeType type,
+    ZydisDecoderTreeNodeValue value)
+{
+    if ((type >= ZYAN_ARRAY_LENGTH(FILTER_VISITS)) ||
+        (value >= ZYDIS_DECODER_TREE_PROFILE_MAX_ROWS))
+    {
+        return 0;
+    }
+    return FILTER_VISITS[type][value];
+}
+
+#endif
+
 void ZydisGetInstructionEncodingInfo(const ZydisDecoderTreeNode* node,
     const ZydisInstructionEncodingInfo** info)
 {
@@ -25,6 +25,7 @@
 ***************************************************************************************************/
 
 #include <Zydis/Disassembler.h>
+#include <Zydis/Internal/DecoderData.h>
 #include <Zycore/LibC.h>
 
 /* ============================================================================================== */
@@ -102,4 +103,24 @@ ZyanStatus ZydisDisassembleATT(ZydisMachineMode machine_mode,
         ZYDIS_FORMATTER_STYLE_ATT);
 }
 
+ZyanStatus ZydisDisassembleFormat(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    ZyanU64 runtime_address, const void* buffer, ZyanUSize length,
+    ZydisDecodedInstruction* instruction, char* text, ZyanUSize text_length, void* user_data)
+{
+    if (!decoder || !formatter || !buffer || !instruction || !text || !text_length ||
+        (decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisDecoderContext context;
+    ZYAN_CHECK(ZydisDecoderDecodeInstruction(decoder, &context, buffer, length, instruction));
+
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT_VISIBLE];
+    ZYAN_CHECK(ZydisDecoderDecodeVisibleOperands(decoder, &context, instruction, operands));
+
+    return ZydisFormatterFormatInstruction(formatter, instruction, operands,
+        instruction->operand_count_visible, text, text_length, runtime_address, user_data);
+}
+
 /* ============================================================================================== */
@@ -52,6 +52,13 @@
                                                  ZYDIS_ATTRIB_HAS_SEGMENT_ES)
 #define ZYDIS_ENCODABLE_PREFIXES_NO_SEGMENTS    (ZYDIS_ENCODABLE_PREFIXES ^ \
                                                  ZYDIS_ATTRIB_HAS_SEGMENT)
+/**
+ * Size of the staging area used during instruction emission. The emission phase doesn't enforce
+ * the architectural length limit, so this covers the theoretical worst case: 12 legacy prefixes,
+ * 4-byte `EVEX` prefix, 2 escape bytes, opcode, `ModR/M`, `SIB`, 8-byte displacement and 8-byte
+ * immediate.
+ */
+#define ZYDIS_ENCODER_STAGING_SIZE              48
 
 /* ---------------------------------------------------------------------------------------------- */
 
@@ -141,18 +148,15 @@ typedef struct ZydisEncoderInstructionMatch_
 } ZydisEncoderInstructionMatch;
 
 /**
- * Encapsulates information about writable buffer.
+ * Local staging area receiving the emitted instruction. The whole instruction is assembled here
+ * first, so the output buffer only has to be checked and written once.
  */
 typedef struct ZydisEncoderBuffer_
 {
     /**
-     * A pointer to actual data buffer.
-     */
-    ZyanU8 *buffer;
-    /**
-     * Size of this buffer.
+     * The staged instruction bytes.
      */
-    ZyanUSize size;
+    ZyanU8 buffer[ZYDIS_ENCODER_STAGING_SIZE];
     /**
      * Current write offset.
      */
@@ -3139,45 +3143,17 @@ static ZyanStatus ZydisFindMatchingDefinition(const ZydisEncoderRequest *request
  * @param   data    Value to emit.
  * @param   size    Value size in bytes.
  * @param   buffer  A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitUInt(ZyanU64 data, ZyanU8 size, ZydisEncoderBuffer *buffer)
+static void ZydisEmitUInt(ZyanU64 data, ZyanU8 size, ZydisEncoderBuffer *buffer)
 {
     ZYAN_ASSERT(size == 1 || size == 2 || size == 4 || size == 8);
-
-    const ZyanUSize new_offset = buffer->offset + size;
-    if (new_offset > buffer->size)
-    {
-        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
-    }
+    ZYAN_ASSERT(buffer->offset + 8 <= ZYDIS_ENCODER_STAGING_SIZE);
 
     // TODO: fix for big-endian systems
-    // The size variable is not passed on purpose to allow the compiler
-    // to generate better code with a known size at compile time.
-    if (size == 1)
-    {
-        ZYAN_MEMCPY(buffer->buffer + buffer->offset, &data, 1);
-    }
-    else if (size == 2)
-    {
-        ZYAN_MEMCPY(buffer->buffer + buffer->offset, &data, 2);
-    }
-    else if (size == 4)
-    {
-        ZYAN_MEMCPY(buffer->buffer + buffer->offset, &data, 4);
-    }
-    else if (size == 8)
-    {
-        ZYAN_MEMCPY(buffer->buffer + buffer->offset, &data, 8);
-    }
-    else
-    {
-        ZYAN_UNREACHABLE;
-    }
-
-    buffer->offset = new_offset;
-    return ZYAN_STATUS_SUCCESS;
+    // The staging area always has room for a full 64-bit store, so the value is written with a
+    // single fixed-size copy and only the offset depends on `size`.
+    ZYAN_MEMCPY(buffer->buffer + buffer->offset, &data, 8);
+    buffer->offset += size;
 }
 
 /**
@@ -3185,12 +3161,11 @@ static ZyanStatus ZydisEmitUInt(ZyanU64 data, ZyanU8 size, ZydisEncoderBuffer *b
  *
  * @param   byte    Value to emit.
  * @param   buffer  A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitByte(ZyanU8 byte, ZydisEncoderBuffer *buffer)
+static void ZydisEmitByte(ZyanU8 byte, ZydisEncoderBuffer *buffer)
 {
-    return ZydisEmitUInt(byte, 1, buffer);
+    ZYAN_ASSERT(buffer->offset < ZYDIS_ENCODER_STAGING_SIZE);
+    buffer->buffer[buffer->offset++] = byte;
 }
 
 /**
@@ -3198,10 +3173,8 @@ static ZyanStatus ZydisEmitByte(ZyanU8 byte, ZydisEncoderBuffer *buffer)
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruction,
+static void ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruction,
     ZydisEncoderBuffer *buffer)
 {
     ZyanBool compressed_prefixes = ZYAN_FALSE;
@@ -3220,7 +3193,7 @@ static ZyanStatus ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruc
     // Group 1
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_LOCK)
     {
-        ZYAN_CHECK(ZydisEmitByte(0xF0, buffer));
+        ZydisEmitByte(0xF0, buffer);
     }
     if (!compressed_prefixes)
     {
@@ -3228,13 +3201,13 @@ static ZyanStatus ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruc
                                        ZYDIS_ATTRIB_HAS_BND |
                                        ZYDIS_ATTRIB_HAS_XACQUIRE))
         {
-            ZYAN_CHECK(ZydisEmitByte(0xF2, buffer));
+            ZydisEmitByte(0xF2, buffer);
         }
         if (instruction->attributes & (ZYDIS_ATTRIB_HAS_REP |
                                        ZYDIS_ATTRIB_HAS_REPE |
                                        ZYDIS_ATTRIB_HAS_XRELEASE))
         {
-            ZYAN_CHECK(ZydisEmitByte(0xF3, buffer));
+            ZydisEmitByte(0xF3, buffer);
         }
     }
 
@@ -3242,32 +3215,32 @@ static ZyanStatus ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruc
     if (instruction->attributes & (ZYDIS_ATTRIB_HAS_SEGMENT_CS |
                                    ZYDIS_ATTRIB_HAS_BRANCH_NOT_TAKEN))
     {
-        ZYAN_CHECK(ZydisEmitByte(0x2E, buffer));
+        ZydisEmitByte(0x2E, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_SEGMENT_SS)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x36, buffer));
+        ZydisEmitByte(0x36, buffer);
     }
     if (instruction->attributes & (ZYDIS_ATTRIB_HAS_SEGMENT_DS |
                                    ZYDIS_ATTRIB_HAS_BRANCH_TAKEN))
     {
-        ZYAN_CHECK(ZydisEmitByte(0x3E, buffer));
+        ZydisEmitByte(0x3E, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_SEGMENT_ES)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x26, buffer));
+        ZydisEmitByte(0x26, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_SEGMENT_FS)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x64, buffer));
+        ZydisEmitByte(0x64, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_SEGMENT_GS)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x65, buffer));
+        ZydisEmitByte(0x65, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_NOTRACK)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x3E, buffer));
+        ZydisEmitByte(0x3E, buffer);
     }
 
     // Group 3
@@ -3275,17 +3248,15 @@ static ZyanStatus ZydisEmitLegacyPrefixes(const ZydisEncoderInstruction *instruc
     {
         if (instruction->attributes & ZYDIS_ATTRIB_HAS_OPERANDSIZE)
         {
-            ZYAN_CHECK(ZydisEmitByte(0x66, buffer));
+            ZydisEmitByte(0x66, buffer);
         }
     }
 
     // Group 4
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_ADDRESSSIZE)
     {
-        ZYAN_CHECK(ZydisEmitByte(0x67, buffer));
+        ZydisEmitByte(0x67, buffer);
     }
-
-    return ZYAN_STATUS_SUCCESS;
 }
 
 /**
@@ -3365,19 +3336,14 @@ static ZyanU8 ZydisEncodeRexLowNibble(const ZydisEncoderInstruction *instruction
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitRex(const ZydisEncoderInstruction *instruction,
-    ZydisEncoderBuffer *buffer)
+static void ZydisEmitRex(const ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
     const ZyanU8 rex = ZydisEncodeRexLowNibble(instruction, ZYAN_NULL);
     if (rex || (instruction->attributes & ZYDIS_ATTRIB_HAS_REX))
     {
-        ZYAN_CHECK(ZydisEmitByte(0x40 | rex, buffer));
+        ZydisEmitByte(0x40 | rex, buffer);
     }
-
-    return ZYAN_STATUS_SUCCESS;
 }
 
 /**
@@ -3437,20 +3403,17 @@ static void ZydisEncodeVexCommons(ZydisEncoderInstruction *instruction, ZyanU8 *
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitXop(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
+static void ZydisEmitXop(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
     ZyanU8 mmmmm, pp, vvvv, rex;
     ZydisEncodeVexCommons(instruction, &mmmmm, &pp, &vvvv, &rex, ZYAN_NULL);
     ZYAN_ASSERT(instruction->vector_length <= 1);
     const ZyanU8 b1 = (((~rex) & 0x07) << 5) | mmmmm;
     const ZyanU8 b2 = ((rex & 0x08) << 4) | ((vvvv & 0xF) << 3) | (instruction->vector_length << 2) | pp;
-    ZYAN_CHECK(ZydisEmitByte(0x8F, buffer));
-    ZYAN_CHECK(ZydisEmitByte(b1, buffer));
-    ZYAN_CHECK(ZydisEmitByte(b2, buffer));
-    return ZYAN_STATUS_SUCCESS;
+    ZydisEmitByte(0x8F, buffer);
+    ZydisEmitByte(b1, buffer);
+    ZydisEmitByte(b2, buffer);
 }
 
 /**
@@ -3458,10 +3421,8 @@ static ZyanStatus ZydisEmitXop(ZydisEncoderInstruction *instruction, ZydisEncode
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitVex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
+static void ZydisEmitVex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
     ZyanU8 mmmmm, pp, vvvv, rex;
     ZydisEncodeVexCommons(instruction, &mmmmm, &pp, &vvvv, &rex, ZYAN_NULL);
@@ -3473,9 +3434,9 @@ static ZyanStatus ZydisEmitVex(ZydisEncoderInstruction *instruction, ZydisEncode
                           ((vvvv & 0xF) << 3) |
                           (instruction->vector_length << 2) |
                           pp;
-        ZYAN_CHECK(ZydisEmitByte(0xC4, buffer));
-        ZYAN_CHECK(ZydisEmitByte(b1, buffer));
-        ZYAN_CHECK(ZydisEmitByte(b2, buffer));
+        ZydisEmitByte(0xC4, buffer);
+        ZydisEmitByte(b1, buffer);
+        ZydisEmitByte(b2, buffer);
     }
     else
     {
@@ -3483,11 +3444,9 @@ static ZyanStatus ZydisEmitVex(ZydisEncoderInstruction *instruction, ZydisEncode
                           ((vvvv & 0xF) << 3) |
                           (instruction->vector_length << 2) |
                           pp;
-        ZYAN_CHECK(ZydisEmitByte(0xC5, buffer));
-        ZYAN_CHECK(ZydisEmitByte(b1, buffer));
+        ZydisEmitByte(0xC5, buffer);
+        ZydisEmitByte(b1, buffer);
     }
-
-    return ZYAN_STATUS_SUCCESS;
 }
 
 /**
@@ -3517,10 +3476,8 @@ static void ZydisEncodeEvexCommons(ZydisEncoderInstruction *instruction, ZyanU8
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitEvex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
+static void ZydisEmitEvex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
     ZyanU8 p0, p1, vvvvv;
     ZydisEncodeEvexCommons(instruction, &p0, &p1, &vvvvv);
@@ -3538,11 +3495,10 @@ static ZyanStatus ZydisEmitEvex(ZydisEncoderInstruction *instruction, ZydisEncod
         p2 &= 0xF7;
     }
 
-    ZYAN_CHECK(ZydisEmitByte(0x62, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p0, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p1, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p2, buffer));
-    return ZYAN_STATUS_SUCCESS;
+    ZydisEmitByte(0x62, buffer);
+    ZydisEmitByte(p0, buffer);
+    ZydisEmitByte(p1, buffer);
+    ZydisEmitByte(p2, buffer);
 }
 
 /**
@@ -3550,10 +3506,8 @@ static ZyanStatus ZydisEmitEvex(ZydisEncoderInstruction *instruction, ZydisEncod
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitMvex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
+static void ZydisEmitMvex(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
     ZyanU8 p0, p1, vvvvv;
     ZydisEncodeEvexCommons(instruction, &p0, &p1, &vvvvv);
@@ -3567,11 +3521,10 @@ static ZyanStatus ZydisEmitMvex(ZydisEncoderInstruction *instruction, ZydisEncod
         p2 &= 0xF7;
     }
 
-    ZYAN_CHECK(ZydisEmitByte(0x62, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p0, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p1 & 0xFB, buffer));
-    ZYAN_CHECK(ZydisEmitByte(p2, buffer));
-    return ZYAN_STATUS_SUCCESS;
+    ZydisEmitByte(0x62, buffer);
+    ZydisEmitByte(p0, buffer);
+    ZydisEmitByte(p1 & 0xFB, buffer);
+    ZydisEmitByte(p2, buffer);
 }
 
 /**
@@ -3579,31 +3532,28 @@ static ZyanStatus ZydisEmitMvex(ZydisEncoderInstruction *instruction, ZydisEncod
  *
  * @param   instruction     A pointer to `ZydisEncoderInstruction` struct.
  * @param   buffer          A pointer to `ZydisEncoderBuffer` struct.
- *
- * @return  A zyan status code.
  */
-static ZyanStatus ZydisEmitInstruction(ZydisEncoderInstruction *instruction,
-    ZydisEncoderBuffer *buffer)
+static void ZydisEmitInstruction(ZydisEncoderInstruction *instruction, ZydisEncoderBuffer *buffer)
 {
-    ZYAN_CHECK(ZydisEmitLegacyPrefixes(instruction, buffer));
+    ZydisEmitLegacyPrefixes(instruction, buffer);
 
     switch (instruction->encoding)
     {
     case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
     case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
-        ZYAN_CHECK(ZydisEmitRex(instruction, buffer));
+        ZydisEmitRex(instruction, buffer);
         break;
     case ZYDIS_INSTRUCTION_ENCODING_XOP:
-        ZYAN_CHECK(ZydisEmitXop(instruction, buffer));
+        ZydisEmitXop(instruction, buffer);
         break;
     case ZYDIS_INSTRUCTION_ENCODING_VEX:
-        ZYAN_CHECK(ZydisEmitVex(instruction, buffer));
+        ZydisEmitVex(instruction, buffer);
         break;
     case ZYDIS_INSTRUCTION_ENCODING_EVEX:
-        ZYAN_CHECK(ZydisEmitEvex(instruction, buffer));
+        ZydisEmitEvex(instruction, buffer);
         break;
     case ZYDIS_INSTRUCTION_ENCODING_MVEX:
-        ZYAN_CHECK(ZydisEmitMvex(instruction, buffer));
+        ZydisEmitMvex(instruction, buffer);
         break;
     default:
         ZYAN_UNREACHABLE;
@@ -3614,26 +3564,26 @@ static ZyanStatus ZydisEmitInstruction(ZydisEncoderInstruction *instruction,
     case ZYDIS_OPCODE_MAP_DEFAULT:
         break;
     case ZYDIS_OPCODE_MAP_0F:
-        ZYAN_CHECK(ZydisEmitByte(0x0F, buffer));
+        ZydisEmitByte(0x0F, buffer);
         break;
     case ZYDIS_OPCODE_MAP_0F38:
-        ZYAN_CHECK(ZydisEmitByte(0x0F, buffer));
-        ZYAN_CHECK(ZydisEmitByte(0x38, buffer));
+        ZydisEmitByte(0x0F, buffer);
+        ZydisEmitByte(0x38, buffer);
         break;
     case ZYDIS_OPCODE_MAP_0F3A:
-        ZYAN_CHECK(ZydisEmitByte(0x0F, buffer));
-        ZYAN_CHECK(ZydisEmitByte(0x3A, buffer));
+        ZydisEmitByte(0x0F, buffer);
+        ZydisEmitByte(0x3A, buffer);
         break;
     case ZYDIS_OPCODE_MAP_0F0F:
-        ZYAN_CHECK(ZydisEmitByte(0x0F, buffer));
-        ZYAN_CHECK(ZydisEmitByte(0x0F, buffer));
+        ZydisEmitByte(0x0F, buffer);
+        ZydisEmitByte(0x0F, buffer);
         break;
     default:
         ZYAN_UNREACHABLE;
     }
     if (instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_3DNOW)
     {
-        ZYAN_CHECK(ZydisEmitByte(instruction->opcode, buffer));
+        ZydisEmitByte(instruction->opcode, buffer);
     }
 
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_MODRM)
@@ -3641,29 +3591,27 @@ static ZyanStatus ZydisEmitInstruction(ZydisEncoderInstruction *instruction,
         const ZyanU8 modrm = (instruction->mod << 6) |
                              ((instruction->reg & 7) << 3) |
                              (instruction->rm & 7);
-        ZYAN_CHECK(ZydisEmitByte(modrm, buffer));
+        ZydisEmitByte(modrm, buffer);
     }
     if (instruction->attributes & ZYDIS_ATTRIB_HAS_SIB)
     {
         const ZyanU8 sib = (instruction->scale << 6) |
                            ((instruction->index & 7) << 3) |
                            (instruction->base & 7);
-        ZYAN_CHECK(ZydisEmitByte(sib, buffer));
+        ZydisEmitByte(sib, buffer);
     }
     if (instruction->disp_size)
     {
-        ZYAN_CHECK(ZydisEmitUInt(instruction->disp, instruction->disp_size / 8, buffer));
+        ZydisEmitUInt(instruction->disp, instruction->disp_size / 8, buffer);
     }
     if (instruction->imm_size)
     {
-        ZYAN_CHECK(ZydisEmitUInt(instruction->imm, instruction->imm_size / 8, buffer));
+        ZydisEmitUInt(instruction->imm, instruction->imm_size / 8, buffer);
     }
     if (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_3DNOW)
     {
-        ZYAN_CHECK(ZydisEmitByte(instruction->opcode, buffer));
+        ZydisEmitByte(instruction->opcode, buffer);
     }
-
-    return ZYAN_STATUS_SUCCESS;
 }
 
 /**
@@ -4313,12 +4261,15 @@ static ZyanStatus ZydisEncoderEncodeInstructionInternal(const ZydisEncoderReques
 {
     ZydisEncoderInstructionMatch match;
     ZYAN_CHECK(ZydisFindMatchingDefinition(request, &match));
+    ZYAN_CHECK(ZydisBuildInstruction(&match, instruction));
     ZydisEncoderBuffer output;
-    output.buffer = (ZyanU8 *)buffer;
-    output.size = *length;
     output.offset = 0;
-    ZYAN_CHECK(ZydisBuildInstruction(&match, instruction));
-    ZYAN_CHECK(ZydisEmitInstruction(instruction, &output));
+    ZydisEmitInstruction(instruction, &output);
+    if (output.offset > *length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+    ZYAN_MEMCPY(buffer, output.buffer, output.offset);
     *length = output.offset;
     return ZYAN_STATUS_SUCCESS;
 }
@@ -25,6 +25,7 @@
 ***************************************************************************************************/
 
 #include <Zydis/Internal/EncoderData.h>
+#include <Zydis/Internal/SharedData.h>
 
 #include <Generated/EncoderTables.inc>
 #include <Generated/GetRelInfo.inc>
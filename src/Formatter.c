@@ -28,6 +28,7 @@
 #include <Zydis/Formatter.h>
 #include <Zydis/Internal/FormatterATT.h>
 #include <Zydis/Internal/FormatterIntel.h>
+#include <Zydis/Internal/InternalTests.h>
 #include <Zydis/Internal/String.h>
 
 /* ============================================================================================== */
@@ -55,7 +56,7 @@ static const ZydisFormatter* const FORMATTER_PRESETS[ZYDIS_FORMATTER_STYLE_MAX_V
 /* Helper functions                                                                               */
 /* ---------------------------------------------------------------------------------------------- */
 
-static void ZydisFormatterBufferInit(ZydisFormatterBuffer* buffer, char* user_buffer,
+ZYDIS_INTERNAL_STATIC void ZydisFormatterBufferInit(ZydisFormatterBuffer* buffer, char* user_buffer,
     ZyanUSize length)
 {
     ZYAN_ASSERT(buffer);
@@ -0,0 +1,199 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Ibt.h>
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Checks if the given instruction has a `notrack` (`3E`) prefix.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction has a `notrack` prefix or `ZYAN_FALSE`, if not.
+ *
+ * A `3E` prefix only acts as `notrack` on instructions that accept it and only in `CET` mode. The
+ * decoder already resolves this (including the prefix group rules), so the attribute is used
+ * instead of the raw prefixes.
+ */
+static ZyanBool ZydisIbtHasNotrack(const ZydisDecodedInstruction* instruction)
+{
+    return (instruction->attributes & ZYDIS_ATTRIB_HAS_NOTRACK) ? ZYAN_TRUE : ZYAN_FALSE;
+}
+
+/**
+ * Passes a reference to the callback.
+ *
+ * @param   callback    The callback.
+ * @param   user_data   A pointer to user-defined data.
+ * @param   type        The reference type.
+ * @param   source      The runtime address of the referencing instruction.
+ * @param   target      The referenced runtime address.
+ * @param   is_notrack  Signals, if the instruction has a `notrack` prefix.
+ *
+ * @return  The status code returned by the callback.
+ */
+static ZyanStatus ZydisIbtReport(ZydisIbtReferenceCallback callback, void* user_data,
+    ZydisIbtReferenceType type, ZyanU64 source, ZyanU64 target, ZyanBool is_notrack)
+{
+    ZydisIbtReference reference;
+    reference.type       = type;
+    reference.source     = source;
+    reference.target     = target;
+    reference.is_notrack = is_notrack;
+
+    return callback(&reference, user_data);
+}
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+ZyanStatus ZydisIbtCollectReferences(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanU64 runtime_address, ZydisIbtReferenceCallback callback,
+    void* user_data)
+{
+    if (!decoder || (!buffer && length) || !callback ||
+        (decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    const ZyanBool is_64 = (decoder->machine_mode == ZYDIS_MACHINE_MODE_LONG_64);
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+            length - offset, &instruction)))
+        {
+            ++offset;
+            continue;
+        }
+
+        const ZyanU64 address = runtime_address + offset;
+        const ZyanU64 next = address + instruction.length;
+        offset += instruction.length;
+
+        switch (instruction.meta.category)
+        {
+        case ZYDIS_CATEGORY_CALL:
+        case ZYDIS_CATEGORY_COND_BR:
+        case ZYDIS_CATEGORY_UNCOND_BR:
+            if (instruction.raw.imm[0].is_relative)
+            {
+                ZyanU64 target = next + instruction.raw.imm[0].value.s;
+                if (!is_64)
+                {
+                    target &= (instruction.operand_width == 16) ? 0xFFFF : 0xFFFFFFFF;
+                }
+                ZYAN_CHECK(ZydisIbtReport(callback, user_data,
+                    (instruction.meta.category == ZYDIS_CATEGORY_CALL) ?
+                        ZYDIS_IBT_REFERENCE_CALL : ZYDIS_IBT_REFERENCE_JUMP,
+                    address, target, ZYAN_FALSE));
+                break;
+            }
+            if ((instruction.meta.category == ZYDIS_CATEGORY_UNCOND_BR) &&
+                (instruction.attributes & ZYDIS_ATTRIB_HAS_MODRM))
+            {
+                // `jmp [table + index * scale]`
+                ZyanU64 table = 0;
+                if ((instruction.raw.modrm.mod == 0) && (instruction.raw.modrm.rm == 4) &&
+                    (instruction.raw.sib.base == 5))
+                {
+                    table = (ZyanU64)instruction.raw.disp.value &
+                        ((instruction.address_width == 64) ? ZYAN_UINT64_MAX : 0xFFFFFFFF);
+                }
+                ZYAN_CHECK(ZydisIbtReport(callback, user_data, ZYDIS_IBT_REFERENCE_INDIRECT_JUMP,
+                    address, table, ZydisIbtHasNotrack(&instruction)));
+            }
+            break;
+        default:
+            break;
+        }
+
+        if ((instruction.mnemonic == ZYDIS_MNEMONIC_LEA) &&
+            (instruction.raw.modrm.mod == 0) && (instruction.raw.modrm.rm == 5))
+        {
+            const ZyanU64 mask = (instruction.address_width == 64) ? ZYAN_UINT64_MAX :
+                (instruction.address_width == 32) ? 0xFFFFFFFF : 0xFFFF;
+            if (is_64)
+            {
+                ZYAN_CHECK(ZydisIbtReport(callback, user_data,
+                    ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS, address,
+                    (next + instruction.raw.disp.value) & mask, ZYAN_FALSE));
+            }
+            else
+            {
+                ZYAN_CHECK(ZydisIbtReport(callback, user_data,
+                    ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS, address,
+                    (ZyanU64)instruction.raw.disp.value & mask, ZYAN_FALSE));
+            }
+            continue;
+        }
+
+        if (((instruction.mnemonic == ZYDIS_MNEMONIC_MOV) ||
+             (instruction.mnemonic == ZYDIS_MNEMONIC_PUSH)) &&
+            (instruction.raw.imm[0].size >= 32) && !instruction.raw.imm[0].is_relative)
+        {
+            const ZyanU64 target = (instruction.raw.imm[0].size == 64) ?
+                instruction.raw.imm[0].value.u : (ZyanU32)instruction.raw.imm[0].value.u;
+            ZYAN_CHECK(ZydisIbtReport(callback, user_data, ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS,
+                address, target, ZYAN_FALSE));
+        }
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisIbtIsLandingPad(const ZydisDecoder* decoder, const void* buffer, ZyanUSize length)
+{
+    if (!decoder || (!buffer && length) ||
+        !(decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_CET)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, buffer, length,
+        &instruction)))
+    {
+        return ZYAN_STATUS_FALSE;
+    }
+
+    const ZydisMnemonic expected = (decoder->machine_mode == ZYDIS_MACHINE_MODE_LONG_64) ?
+        ZYDIS_MNEMONIC_ENDBR64 : ZYDIS_MNEMONIC_ENDBR32;
+    return (instruction.mnemonic == expected) ? ZYAN_STATUS_TRUE : ZYAN_STATUS_FALSE;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,535 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Jit.h>
+#include <Zydis/Register.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The size of a literal pool entry in bytes.
+ */
+#define ZYDIS_JIT_LITERAL_SIZE 8
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* General                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Checks, if the given target can be reached by a 32-bit displacement.
+ *
+ * @param   next_address    The runtime address of the next instruction.
+ * @param   target          The target address.
+ *
+ * @return  `ZYAN_TRUE`, if the target can be reached or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisJitIsInRel32Range(ZyanU64 next_address, ZyanU64 target)
+{
+    const ZyanI64 displacement = (ZyanI64)(target - next_address);
+    return displacement == (ZyanI32)displacement;
+}
+
+/**
+ * Initializes an encoder request for 64-bit mode.
+ *
+ * @param   request     A pointer to the `ZydisEncoderRequest` struct.
+ * @param   mnemonic    The instruction mnemonic.
+ * @param   operands    The number of operands.
+ */
+static void ZydisJitInitRequest(ZydisEncoderRequest* request, ZydisMnemonic mnemonic,
+    ZyanU8 operands)
+{
+    ZYAN_MEMSET(request, 0, sizeof(*request));
+    request->machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    request->mnemonic = mnemonic;
+    request->operand_count = operands;
+}
+
+/**
+ * Encodes an instruction of known length.
+ *
+ * @param   request A pointer to the `ZydisEncoderRequest` struct.
+ * @param   buffer  A pointer to the output buffer, which must have room for `length` bytes.
+ * @param   length  The length selected for this instruction.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisJitEncode(const ZydisEncoderRequest* request, ZyanU8* buffer,
+    ZyanU8 length)
+{
+    ZyanUSize encoded_length = length;
+    ZYAN_CHECK(ZydisEncoderEncodeInstruction(request, buffer, &encoded_length));
+    ZYAN_ASSERT(encoded_length == length);
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Writes a 64-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the output buffer.
+ * @param   value   The value.
+ */
+static void ZydisJitWriteLiteral(ZyanU8* buffer, ZyanU64 value)
+{
+    for (ZyanU8 i = 0; i < ZYDIS_JIT_LITERAL_SIZE; ++i)
+    {
+        buffer[i] = (ZyanU8)(value >> (i * 8));
+    }
+}
+
+/**
+ * Reads a 64-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the input buffer.
+ *
+ * @return  The value.
+ */
+static ZyanU64 ZydisJitReadLiteral(const ZyanU8* buffer)
+{
+    ZyanU64 value = 0;
+    for (ZyanU8 i = 0; i < ZYDIS_JIT_LITERAL_SIZE; ++i)
+    {
+        value |= (ZyanU64)buffer[i] << (i * 8);
+    }
+    return value;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Selects the shortest sequence for loading a constant into a register.
+ *
+ * @param   constant        A pointer to the `ZydisJitConstant` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   preserve_flags  `ZYAN_TRUE`, if the sequence must not modify the flags register.
+ * @param   kind            Receives the selected sequence.
+ * @param   length          Receives the length of the sequence in bytes.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisJitSelectConstant(const ZydisJitConstant* constant,
+    ZyanU64 runtime_address, ZyanBool preserve_flags, ZydisJitConstantKind* kind,
+    ZyanU8* length)
+{
+    if (ZydisRegisterGetClass(constant->reg) != ZYDIS_REGCLASS_GPR64)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    // The 32-bit forms only need a `REX` prefix for `r8d` to `r15d`
+    const ZyanU8 rex = (ZydisRegisterGetId(constant->reg) >= 8) ? 1 : 0;
+    const ZyanU64 value = constant->value;
+
+    if (!value && !preserve_flags)
+    {
+        *kind = ZYDIS_JIT_CONSTANT_KIND_XOR;
+        *length = 2 + rex;
+    }
+    else if (value <= 0xFFFFFFFF)
+    {
+        *kind = ZYDIS_JIT_CONSTANT_KIND_MOV_IMM32;
+        *length = 5 + rex;
+    }
+    else if (value >= 0xFFFFFFFF80000000)
+    {
+        *kind = ZYDIS_JIT_CONSTANT_KIND_MOV_SIMM32;
+        *length = 7;
+    }
+    else if (ZydisJitIsInRel32Range(runtime_address + 7, value))
+    {
+        *kind = ZYDIS_JIT_CONSTANT_KIND_LEA;
+        *length = 7;
+    }
+    else
+    {
+        *kind = ZYDIS_JIT_CONSTANT_KIND_MOV_IMM64;
+        *length = 10;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Branches                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Searches the literal pool for the given value.
+ *
+ * @param   pool    A pointer to the `ZydisJitLiteralPool` instance.
+ * @param   value   The value.
+ *
+ * @return  The index of the entry containing the value, or `pool->count`, if there is no such
+ *          entry.
+ */
+static ZyanUSize ZydisJitLiteralPoolFind(const ZydisJitLiteralPool* pool, ZyanU64 value)
+{
+    ZyanUSize index = 0;
+    for (; index < pool->count; ++index)
+    {
+        if (ZydisJitReadLiteral(pool->buffer + index * ZYDIS_JIT_LITERAL_SIZE) == value)
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+/**
+ * Selects the shortest sequence for branching to an absolute address.
+ *
+ * @param   branch          A pointer to the `ZydisJitBranch` struct.
+ * @param   runtime_address The runtime address of the sequence.
+ * @param   pool            A pointer to the `ZydisJitLiteralPool` instance or `ZYAN_NULL`.
+ * @param   kind            Receives the selected sequence.
+ * @param   length          Receives the length of the sequence in bytes.
+ * @param   index           Receives the index of the literal pool entry, if the literal pool is
+ *                          used.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisJitSelectBranch(const ZydisJitBranch* branch, ZyanU64 runtime_address,
+    const ZydisJitLiteralPool* pool, ZydisJitBranchKind* kind, ZyanU8* length, ZyanUSize* index)
+{
+    if ((branch->mnemonic != ZYDIS_MNEMONIC_CALL) && (branch->mnemonic != ZYDIS_MNEMONIC_JMP))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (ZydisJitIsInRel32Range(runtime_address + 5, branch->target))
+    {
+        *kind = ZYDIS_JIT_BRANCH_KIND_RELATIVE;
+        *length = 5;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    // The whole pool has to be in range, so the selection does not depend on the entry that is
+    // eventually used
+    if (pool && pool->capacity &&
+        ZydisJitIsInRel32Range(runtime_address + 6, pool->runtime_address) &&
+        ZydisJitIsInRel32Range(runtime_address + 6,
+            pool->runtime_address + (pool->capacity - 1) * ZYDIS_JIT_LITERAL_SIZE))
+    {
+        *index = ZydisJitLiteralPoolFind(pool, branch->target);
+        if (*index < pool->capacity)
+        {
+            *kind = ZYDIS_JIT_BRANCH_KIND_POOL;
+            *length = 6;
+            return ZYAN_STATUS_SUCCESS;
+        }
+    }
+
+    *kind = ZYDIS_JIT_BRANCH_KIND_INLINE;
+    *length = (branch->mnemonic == ZYDIS_MNEMONIC_JMP) ? 14 : 16;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Initializes an encoder request for an indirect branch through a `RIP`-relative memory operand.
+ *
+ * @param   request         A pointer to the `ZydisEncoderRequest` struct.
+ * @param   mnemonic        The branch mnemonic.
+ * @param   displacement    The displacement relative to the next instruction.
+ */
+static void ZydisJitInitIndirectBranch(ZydisEncoderRequest* request, ZydisMnemonic mnemonic,
+    ZyanI64 displacement)
+{
+    ZydisJitInitRequest(request, mnemonic, 1);
+    request->operands[0].type = ZYDIS_OPERAND_TYPE_MEMORY;
+    request->operands[0].mem.base = ZYDIS_REGISTER_RIP;
+    request->operands[0].mem.displacement = displacement;
+    request->operands[0].mem.size = ZYDIS_JIT_LITERAL_SIZE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisJitGetConstantLength(const ZydisJitConstant* constant, ZyanU64 runtime_address,
+    ZyanBool preserve_flags, ZydisJitConstantKind* kind, ZyanU8* length)
+{
+    if (!constant || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisJitConstantKind selected_kind;
+    ZYAN_CHECK(ZydisJitSelectConstant(constant, runtime_address, preserve_flags, &selected_kind,
+        length));
+    if (kind)
+    {
+        *kind = selected_kind;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisJitEmitConstant(const ZydisJitConstant* constant, ZyanU64 runtime_address,
+    ZyanBool preserve_flags, void* buffer, ZyanUSize* length)
+{
+    if (!constant || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisJitConstantKind kind;
+    ZyanU8 selected_length;
+    ZYAN_CHECK(ZydisJitSelectConstant(constant, runtime_address, preserve_flags, &kind,
+        &selected_length));
+    if (*length < selected_length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    const ZydisRegister reg32 =
+        ZydisRegisterEncode(ZYDIS_REGCLASS_GPR32, (ZyanU8)ZydisRegisterGetId(constant->reg));
+
+    ZydisEncoderRequest request;
+    switch (kind)
+    {
+    case ZYDIS_JIT_CONSTANT_KIND_XOR:
+        ZydisJitInitRequest(&request, ZYDIS_MNEMONIC_XOR, 2);
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = reg32;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[1].reg.value = reg32;
+        break;
+    case ZYDIS_JIT_CONSTANT_KIND_MOV_IMM32:
+        ZydisJitInitRequest(&request, ZYDIS_MNEMONIC_MOV, 2);
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = reg32;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        // The encoder expects 32-bit immediates in sign-extended form
+        request.operands[1].imm.s = (ZyanI32)(ZyanU32)constant->value;
+        break;
+    case ZYDIS_JIT_CONSTANT_KIND_MOV_SIMM32:
+    case ZYDIS_JIT_CONSTANT_KIND_MOV_IMM64:
+        // The encoder picks the sign-extended form for values that allow it
+        ZydisJitInitRequest(&request, ZYDIS_MNEMONIC_MOV, 2);
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = constant->reg;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        request.operands[1].imm.u = constant->value;
+        break;
+    case ZYDIS_JIT_CONSTANT_KIND_LEA:
+        ZydisJitInitRequest(&request, ZYDIS_MNEMONIC_LEA, 2);
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = constant->reg;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_MEMORY;
+        request.operands[1].mem.base = ZYDIS_REGISTER_RIP;
+        request.operands[1].mem.displacement =
+            (ZyanI64)(constant->value - (runtime_address + selected_length));
+        request.operands[1].mem.size = 8;
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    ZYAN_CHECK(ZydisJitEncode(&request, (ZyanU8*)buffer, selected_length));
+    *length = selected_length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisJitEmitConstants(const ZydisJitConstant* constants, ZyanUSize count,
+    ZyanU64 runtime_address, ZyanBool preserve_flags, void* buffer, ZyanUSize* length)
+{
+    if ((!constants && count) || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU8* const output = (ZyanU8*)buffer;
+    ZyanUSize offset = 0;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZyanUSize instruction_length = *length - offset;
+        ZYAN_CHECK(ZydisJitEmitConstant(&constants[i], runtime_address + offset, preserve_flags,
+            output + offset, &instruction_length));
+        offset += instruction_length;
+    }
+    *length = offset;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Literal pool                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisJitLiteralPoolInit(ZydisJitLiteralPool* pool, void* buffer, ZyanUSize capacity,
+    ZyanU64 runtime_address)
+{
+    if (!pool || (!buffer && capacity))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    pool->buffer = (ZyanU8*)buffer;
+    pool->runtime_address = runtime_address;
+    pool->capacity = capacity;
+    pool->count = 0;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Branches                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisJitGetBranchLength(const ZydisJitBranch* branch, ZyanU64 runtime_address,
+    const ZydisJitLiteralPool* pool, ZydisJitBranchKind* kind, ZyanU8* length)
+{
+    if (!branch || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisJitBranchKind selected_kind;
+    ZyanUSize index;
+    ZYAN_CHECK(ZydisJitSelectBranch(branch, runtime_address, pool, &selected_kind, length,
+        &index));
+    if (kind)
+    {
+        *kind = selected_kind;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisJitEmitBranch(const ZydisJitBranch* branch, ZyanU64 runtime_address,
+    ZydisJitLiteralPool* pool, void* buffer, ZyanUSize* length)
+{
+    if (!branch || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisJitBranchKind kind;
+    ZyanU8 selected_length;
+    ZyanUSize index = 0;
+    ZYAN_CHECK(ZydisJitSelectBranch(branch, runtime_address, pool, &kind, &selected_length,
+        &index));
+    if (*length < selected_length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZyanU8* const output = (ZyanU8*)buffer;
+    ZydisEncoderRequest request;
+    switch (kind)
+    {
+    case ZYDIS_JIT_BRANCH_KIND_RELATIVE:
+        ZydisJitInitRequest(&request, branch->mnemonic, 1);
+        request.branch_type = ZYDIS_BRANCH_TYPE_NEAR;
+        request.branch_width = ZYDIS_BRANCH_WIDTH_32;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        request.operands[0].imm.s = (ZyanI64)(branch->target - (runtime_address + 5));
+        ZYAN_CHECK(ZydisJitEncode(&request, output, 5));
+        break;
+    case ZYDIS_JIT_BRANCH_KIND_POOL:
+    {
+        const ZyanU64 entry = pool->runtime_address + index * ZYDIS_JIT_LITERAL_SIZE;
+        ZydisJitInitIndirectBranch(&request, branch->mnemonic,
+            (ZyanI64)(entry - (runtime_address + 6)));
+        ZYAN_CHECK(ZydisJitEncode(&request, output, 6));
+        if (index == pool->count)
+        {
+            ZydisJitWriteLiteral(pool->buffer + index * ZYDIS_JIT_LITERAL_SIZE, branch->target);
+            ++pool->count;
+        }
+        break;
+    }
+    case ZYDIS_JIT_BRANCH_KIND_INLINE:
+        if (branch->mnemonic == ZYDIS_MNEMONIC_JMP)
+        {
+            // jmp qword ptr [rip]; dq target
+            ZydisJitInitIndirectBranch(&request, ZYDIS_MNEMONIC_JMP, 0);
+            ZYAN_CHECK(ZydisJitEncode(&request, output, 6));
+            ZydisJitWriteLiteral(output + 6, branch->target);
+        }
+        else
+        {
+            // call qword ptr [rip+2]; jmp short +8; dq target
+            ZydisJitInitIndirectBranch(&request, ZYDIS_MNEMONIC_CALL, 2);
+            ZYAN_CHECK(ZydisJitEncode(&request, output, 6));
+            ZydisJitInitRequest(&request, ZYDIS_MNEMONIC_JMP, 1);
+            request.branch_type = ZYDIS_BRANCH_TYPE_SHORT;
+            request.branch_width = ZYDIS_BRANCH_WIDTH_8;
+            request.operands[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+            request.operands[0].imm.s = ZYDIS_JIT_LITERAL_SIZE;
+            ZYAN_CHECK(ZydisJitEncode(&request, output + 6, 2));
+            ZydisJitWriteLiteral(output + 8, branch->target);
+        }
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+    *length = selected_length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisJitEmitBranches(const ZydisJitBranch* branches, ZyanUSize count,
+    ZyanU64 runtime_address, ZydisJitLiteralPool* pool, void* buffer, ZyanUSize* length)
+{
+    if ((!branches && count) || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU8* const output = (ZyanU8*)buffer;
+    ZyanUSize offset = 0;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZyanUSize sequence_length = *length - offset;
+        ZYAN_CHECK(ZydisJitEmitBranch(&branches[i], runtime_address + offset, pool,
+            output + offset, &sequence_length));
+        offset += sequence_length;
+    }
+    *length = offset;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
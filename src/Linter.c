@@ -0,0 +1,348 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Linter.h>
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Instruction classification                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Checks if the given instruction is affected by the JCC erratum.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction is a jump, call or return or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisLinterIsJump(const ZydisDecodedInstruction* instruction)
+{
+    switch (instruction->meta.category)
+    {
+    case ZYDIS_CATEGORY_COND_BR:
+    case ZYDIS_CATEGORY_UNCOND_BR:
+    case ZYDIS_CATEGORY_CALL:
+    case ZYDIS_CATEGORY_RET:
+        return ZYAN_TRUE;
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Checks if the given instruction is a conditional jump that can be macro-fused.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction can be the second part of a macro-fused pair or
+ *          `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisLinterIsFusibleJcc(const ZydisDecodedInstruction* instruction)
+{
+    if (instruction->meta.category != ZYDIS_CATEGORY_COND_BR)
+    {
+        return ZYAN_FALSE;
+    }
+
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_JCXZ:
+    case ZYDIS_MNEMONIC_JECXZ:
+    case ZYDIS_MNEMONIC_JRCXZ:
+    case ZYDIS_MNEMONIC_LOOP:
+    case ZYDIS_MNEMONIC_LOOPE:
+    case ZYDIS_MNEMONIC_LOOPNE:
+        return ZYAN_FALSE;
+    default:
+        return ZYAN_TRUE;
+    }
+}
+
+/**
+ * Checks if the given instruction can be macro-fused with a following conditional jump.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction can be the first part of a macro-fused pair or
+ *          `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisLinterIsFusibleFirst(const ZydisDecodedInstruction* instruction)
+{
+    if (instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_LEGACY)
+    {
+        return ZYAN_FALSE;
+    }
+
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_CMP:
+    case ZYDIS_MNEMONIC_TEST:
+    case ZYDIS_MNEMONIC_ADD:
+    case ZYDIS_MNEMONIC_SUB:
+    case ZYDIS_MNEMONIC_AND:
+    case ZYDIS_MNEMONIC_INC:
+    case ZYDIS_MNEMONIC_DEC:
+        break;
+    default:
+        return ZYAN_FALSE;
+    }
+
+    // Instructions with a memory and an immediate operand are never fused
+    const ZyanBool has_memory = (instruction->attributes & ZYDIS_ATTRIB_HAS_MODRM) &&
+        (instruction->raw.modrm.mod != 3);
+    return !has_memory || !instruction->raw.imm[0].size;
+}
+
+/**
+ * Checks if the given instruction has a length-changing operand-size prefix.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction stalls the legacy decoders or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisLinterHasLengthChangingPrefix(const ZydisDecodedInstruction* instruction)
+{
+    if ((instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_LEGACY) ||
+        !(instruction->attributes & ZYDIS_ATTRIB_HAS_OPERANDSIZE) ||
+        ((instruction->raw.imm[0].size != 16) && (instruction->raw.imm[0].size != 32)) ||
+        instruction->raw.imm[0].is_relative)
+    {
+        return ZYAN_FALSE;
+    }
+
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_ENTER:
+    case ZYDIS_MNEMONIC_RET:
+        // The immediate size does not depend on the operand size
+        return ZYAN_FALSE;
+    case ZYDIS_MNEMONIC_MOV:
+        // `MOV r, imm` is handled specially by the legacy decoders
+        return (instruction->opcode_map != ZYDIS_OPCODE_MAP_DEFAULT) ||
+            ((instruction->opcode & 0xF8) != 0xB8);
+    default:
+        return ZYAN_TRUE;
+    }
+}
+
+/**
+ * Calculates the target address of a relative branch.
+ *
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   runtime_address The runtime address of the instruction.
+ *
+ * @return  The target address.
+ */
+static ZyanU64 ZydisLinterGetBranchTarget(const ZydisDecodedInstruction* instruction,
+    ZyanU64 runtime_address)
+{
+    ZyanU64 target = runtime_address + instruction->length + instruction->raw.imm[0].value.s;
+    if (instruction->machine_mode != ZYDIS_MACHINE_MODE_LONG_64)
+    {
+        target &= (instruction->operand_width == 16) ? 0xFFFF : 0xFFFFFFFF;
+    }
+    return target;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reporting                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Passes a hazard to the callback.
+ *
+ * @param   callback    The callback.
+ * @param   user_data   A pointer to user-defined data.
+ * @param   type        The hazard type.
+ * @param   offset      The offset of the affected instruction.
+ * @param   address     The runtime address of the affected instruction.
+ * @param   length      The length of the affected instruction or instruction pair.
+ * @param   mnemonic    The mnemonic of the affected instruction.
+ * @param   target      The runtime address padding is suggested for.
+ * @param   padding     The suggested number of padding bytes.
+ *
+ * @return  The status code returned by the callback.
+ */
+static ZyanStatus ZydisLinterReport(ZydisLinterCallback callback, void* user_data,
+    ZydisLinterHazardType type, ZyanUSize offset, ZyanU64 address, ZyanU8 length,
+    ZydisMnemonic mnemonic, ZyanU64 target, ZyanU32 padding)
+{
+    ZydisLinterHazard hazard;
+    hazard.type     = type;
+    hazard.offset   = offset;
+    hazard.address  = address;
+    hazard.length   = length;
+    hazard.mnemonic = mnemonic;
+    hazard.target   = target;
+    hazard.padding  = padding;
+
+    return callback(&hazard, user_data);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+ZyanStatus ZydisLinterInit(ZydisLinter* linter, ZydisMachineMode machine_mode,
+    ZydisStackWidth stack_width)
+{
+    if (!linter)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisDecoderInit(&linter->decoder, machine_mode, stack_width));
+    // Only the raw instruction bytes and the instruction category are required
+    ZYAN_CHECK(ZydisDecoderEnableMode(&linter->decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE));
+
+    linter->hazards = (1 << (ZYDIS_LINTER_HAZARD_MAX_VALUE + 1)) - 1;
+    linter->loop_alignment = ZYDIS_LINTER_DEFAULT_LOOP_ALIGNMENT;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisLinterEnableHazard(ZydisLinter* linter, ZydisLinterHazardType type,
+    ZyanBool enabled)
+{
+    if (!linter || ((ZyanUSize)type > ZYDIS_LINTER_HAZARD_MAX_VALUE))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (enabled)
+    {
+        linter->hazards |= (1 << type);
+    }
+    else
+    {
+        linter->hazards &= ~(1 << type);
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisLinterSetLoopAlignment(ZydisLinter* linter, ZyanU32 alignment)
+{
+    if (!linter || !alignment || (alignment & (alignment - 1)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    linter->loop_alignment = alignment;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisLinterLint(const ZydisLinter* linter, const void* buffer, ZyanUSize length,
+    ZyanU64 runtime_address, ZydisLinterCallback callback, void* user_data)
+{
+    if (!linter || (!buffer && length) || !callback)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    const ZyanU64 loop_mask = linter->loop_alignment - 1;
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZyanBool previous_fusible = ZYAN_FALSE;
+    ZyanUSize previous_offset = 0;
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&linter->decoder, &context,
+            data + offset, length - offset, &instruction)))
+        {
+            previous_fusible = ZYAN_FALSE;
+            ++offset;
+            continue;
+        }
+
+        const ZyanU64 address = runtime_address + offset;
+        const ZyanBool fused = previous_fusible && ZydisLinterIsFusibleJcc(&instruction);
+
+        if ((linter->hazards & (1 << ZYDIS_LINTER_HAZARD_JCC_ERRATUM)) &&
+            ZydisLinterIsJump(&instruction))
+        {
+            // Macro-fused pairs are treated as a single jump
+            const ZyanUSize start_offset = fused ? previous_offset : offset;
+            const ZyanU64 start = runtime_address + start_offset;
+            const ZyanU64 end = address + instruction.length;
+            if (((start ^ (end - 1)) >> 5) || !(end & 31))
+            {
+                ZYAN_CHECK(ZydisLinterReport(callback, user_data,
+                    ZYDIS_LINTER_HAZARD_JCC_ERRATUM, start_offset, start, (ZyanU8)(end - start),
+                    instruction.mnemonic, start, (ZyanU32)(32 - (start & 31))));
+            }
+        }
+
+        if ((linter->hazards & (1 << ZYDIS_LINTER_HAZARD_SPLIT_FUSION)) && fused &&
+            !(address & 63))
+        {
+            const ZyanU64 start = runtime_address + previous_offset;
+            ZYAN_CHECK(ZydisLinterReport(callback, user_data, ZYDIS_LINTER_HAZARD_SPLIT_FUSION,
+                previous_offset, start, (ZyanU8)(address + instruction.length - start),
+                instruction.mnemonic, start, (ZyanU32)(64 - (start & 63))));
+        }
+
+        if ((linter->hazards & (1 << ZYDIS_LINTER_HAZARD_LCP_STALL)) &&
+            ZydisLinterHasLengthChangingPrefix(&instruction))
+        {
+            ZYAN_CHECK(ZydisLinterReport(callback, user_data, ZYDIS_LINTER_HAZARD_LCP_STALL,
+                offset, address, instruction.length, instruction.mnemonic, address, 0));
+        }
+
+        if ((linter->hazards & (1 << ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP)) &&
+            instruction.raw.imm[0].is_relative &&
+            ((instruction.meta.category == ZYDIS_CATEGORY_COND_BR) ||
+             (instruction.meta.category == ZYDIS_CATEGORY_UNCOND_BR)))
+        {
+            const ZyanU64 target = ZydisLinterGetBranchTarget(&instruction, address);
+            if ((target <= address) && (target & loop_mask))
+            {
+                ZYAN_CHECK(ZydisLinterReport(callback, user_data,
+                    ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP, offset, address, instruction.length,
+                    instruction.mnemonic, target,
+                    (ZyanU32)(linter->loop_alignment - (target & loop_mask))));
+            }
+        }
+
+        previous_fusible = ZydisLinterIsFusibleFirst(&instruction);
+        previous_offset = offset;
+        offset += instruction.length;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ============================================================================================== */
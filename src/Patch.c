@@ -0,0 +1,540 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <Zycore/LibC.h>
+#include <Zydis/Patch.h>
+
+#if defined(ZYDIS_PATCH_RUNTIME)
+#   include <sched.h>
+#   include <signal.h>
+#   include <ucontext.h>
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#endif
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The `int3` opcode.
+ */
+#define ZYDIS_PATCH_BREAKPOINT_OPCODE 0xCC
+
+#if defined(ZYDIS_PATCH_RUNTIME)
+
+/*
+ * Not every libc ships `linux/membarrier.h`, so the command values are defined here.
+ */
+#define ZYDIS_MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE            (1 << 5)
+#define ZYDIS_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE   (1 << 6)
+
+#if defined(ZYAN_X64)
+#   define ZYDIS_PATCH_REG_IP REG_RIP
+#else
+#   define ZYDIS_PATCH_REG_IP REG_EIP
+#endif
+
+#endif
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Determines the changed byte range of the given patch and selects its strategy.
+ *
+ * @param   patch   A pointer to the `ZydisPatch` struct. The `runtime_address`, `length` and
+ *                  `bytes` fields must already be initialized.
+ * @param   code    A pointer to the current instruction bytes.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisPatchFinalize(ZydisPatch* patch, const ZyanU8* code)
+{
+    ZyanU8 first = patch->length;
+    ZyanU8 last = 0;
+    for (ZyanU8 i = 0; i < patch->length; ++i)
+    {
+        if (patch->bytes[i] != code[i])
+        {
+            if (first == patch->length)
+            {
+                first = i;
+            }
+            last = i;
+        }
+    }
+
+    if (first == patch->length)
+    {
+        patch->changed_offset = 0;
+        patch->changed_length = 0;
+        patch->strategy = ZYDIS_PATCH_STRATEGY_NONE;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    patch->changed_offset = first;
+    patch->changed_length = last - first + 1;
+    return ZydisPatchSelectStrategy(patch->runtime_address + first, patch->changed_length,
+        &patch->strategy);
+}
+
+#if defined(ZYDIS_PATCH_RUNTIME)
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Runtime                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ZydisPatchRuntimeState` enum.
+ */
+typedef enum ZydisPatchRuntimeState_
+{
+    ZYDIS_PATCH_RUNTIME_STATE_UNINITIALIZED,
+    ZYDIS_PATCH_RUNTIME_STATE_INITIALIZING,
+    ZYDIS_PATCH_RUNTIME_STATE_READY
+} ZydisPatchRuntimeState;
+
+/**
+ * The current `ZydisPatchRuntimeState`.
+ */
+static ZyanU32 runtime_state = ZYDIS_PATCH_RUNTIME_STATE_UNINITIALIZED;
+
+/**
+ * The runtime addresses of all breakpoint patches that are currently in flight. Unused entries
+ * are `0`.
+ */
+static ZyanUPointer active_breakpoints[ZYDIS_PATCH_MAX_ACTIVE_BREAKPOINTS];
+
+/**
+ * The `SIGTRAP` action that was installed before `ZydisPatchInitRuntime` was called.
+ */
+static struct sigaction previous_action;
+
+/**
+ * Serializes all cores that currently run threads of this process.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisPatchSyncCores(void)
+{
+    if (syscall(SYS_membarrier, ZYDIS_MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE, 0) != 0)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Checks, if a thread that hit an `int3` at the given address has to retry the instruction.
+ *
+ * @param   address The runtime address of the `int3`.
+ *
+ * @return  `ZYAN_TRUE`, if the `int3` belongs to a breakpoint patch or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisPatchIsPatchBreakpoint(ZyanUPointer address)
+{
+    for (ZyanUSize i = 0; i < ZYDIS_PATCH_MAX_ACTIVE_BREAKPOINTS; ++i)
+    {
+        if (__atomic_load_n(&active_breakpoints[i], __ATOMIC_ACQUIRE) == address)
+        {
+            return ZYAN_TRUE;
+        }
+    }
+
+    // The patch might have completed and released its entry after the trap. In this case, the
+    // `int3` is already gone.
+    return *(volatile const ZyanU8*)address != ZYDIS_PATCH_BREAKPOINT_OPCODE;
+}
+
+/**
+ * The `SIGTRAP` handler.
+ *
+ * @param   signal  The signal number.
+ * @param   info    A pointer to the `siginfo_t` struct.
+ * @param   context A pointer to the `ucontext_t` struct of the interrupted thread.
+ */
+static void ZydisPatchTrapHandler(int signal, siginfo_t* info, void* context)
+{
+    ucontext_t* const ucontext = (ucontext_t*)context;
+
+    // `int3` is reported with `SI_KERNEL` and the instruction pointer pointing behind it
+    if (info->si_code == SI_KERNEL)
+    {
+        const ZyanUPointer address =
+            (ZyanUPointer)ucontext->uc_mcontext.gregs[ZYDIS_PATCH_REG_IP] - 1;
+        if (ZydisPatchIsPatchBreakpoint(address))
+        {
+            ucontext->uc_mcontext.gregs[ZYDIS_PATCH_REG_IP] = (greg_t)address;
+            return;
+        }
+    }
+
+    if (previous_action.sa_flags & SA_SIGINFO)
+    {
+        previous_action.sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous_action.sa_handler == SIG_IGN)
+    {
+        return;
+    }
+    if (previous_action.sa_handler != SIG_DFL)
+    {
+        previous_action.sa_handler(signal);
+        return;
+    }
+
+    // Restore the default action. The signal is blocked while the handler runs, so it is
+    // delivered again after returning and terminates the process as usual.
+    struct sigaction action;
+    ZYAN_MEMSET(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signal, &action, ZYAN_NULL);
+    raise(signal);
+}
+
+/**
+ * Atomically replaces bytes inside of a naturally aligned 4-byte word.
+ *
+ * @param   destination A pointer to the first byte to replace.
+ * @param   source      A pointer to the new bytes.
+ * @param   length      The number of bytes to replace.
+ */
+static void ZydisPatchWriteAtomic4(ZyanU8* destination, const ZyanU8* source, ZyanU8 length)
+{
+    ZyanU32* const word = (ZyanU32*)((ZyanUPointer)destination & ~(ZyanUPointer)3);
+    const ZyanUSize shift = (ZyanUPointer)destination & 3;
+    ZYAN_ASSERT(shift + length <= 4);
+
+    ZyanU32 expected = __atomic_load_n(word, __ATOMIC_RELAXED);
+    ZyanU32 desired;
+    do
+    {
+        desired = expected;
+        ZYAN_MEMCPY((ZyanU8*)&desired + shift, source, length);
+    } while (!__atomic_compare_exchange_n(word, &expected, desired, ZYAN_FALSE, __ATOMIC_SEQ_CST,
+        __ATOMIC_RELAXED));
+}
+
+/**
+ * Atomically replaces bytes inside of a naturally aligned 8-byte word.
+ *
+ * @param   destination A pointer to the first byte to replace.
+ * @param   source      A pointer to the new bytes.
+ * @param   length      The number of bytes to replace.
+ */
+static void ZydisPatchWriteAtomic8(ZyanU8* destination, const ZyanU8* source, ZyanU8 length)
+{
+    ZyanU64* const word = (ZyanU64*)((ZyanUPointer)destination & ~(ZyanUPointer)7);
+    const ZyanUSize shift = (ZyanUPointer)destination & 7;
+    ZYAN_ASSERT(shift + length <= 8);
+
+    ZyanU64 expected = __atomic_load_n(word, __ATOMIC_RELAXED);
+    ZyanU64 desired;
+    do
+    {
+        desired = expected;
+        ZYAN_MEMCPY((ZyanU8*)&desired + shift, source, length);
+    } while (!__atomic_compare_exchange_n(word, &expected, desired, ZYAN_FALSE, __ATOMIC_SEQ_CST,
+        __ATOMIC_RELAXED));
+}
+
+/**
+ * Applies the given patch using the breakpoint protocol.
+ *
+ * @param   patch       A pointer to the `ZydisPatch` struct.
+ * @param   writable    A writable view of the instruction.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisPatchApplyBreakpoint(const ZydisPatch* patch, ZyanU8* writable)
+{
+    if (__atomic_load_n(&runtime_state, __ATOMIC_ACQUIRE) != ZYDIS_PATCH_RUNTIME_STATE_READY)
+    {
+        return ZYAN_STATUS_INVALID_OPERATION;
+    }
+
+    const ZyanUPointer address = (ZyanUPointer)patch->runtime_address;
+    ZyanUSize index = 0;
+    for (; index < ZYDIS_PATCH_MAX_ACTIVE_BREAKPOINTS; ++index)
+    {
+        ZyanUPointer expected = 0;
+        if (__atomic_compare_exchange_n(&active_breakpoints[index], &expected, address,
+            ZYAN_FALSE, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+    if (index == ZYDIS_PATCH_MAX_ACTIVE_BREAKPOINTS)
+    {
+        return ZYAN_STATUS_OUT_OF_RESOURCES;
+    }
+
+    // The membarrier command can only fail, if the process was not registered. The protocol is
+    // completed anyways, as aborting would leave the `int3` in place.
+    ZyanStatus status = ZYAN_STATUS_SUCCESS;
+    ZyanStatus sync_status;
+
+    // 1. Make every thread that enters the instruction trap and retry
+    __atomic_store_n(&writable[0], ZYDIS_PATCH_BREAKPOINT_OPCODE, __ATOMIC_SEQ_CST);
+    sync_status = ZydisPatchSyncCores();
+    status = ZYAN_SUCCESS(status) ? sync_status : status;
+
+    // 2. Rewrite all changed bytes behind the first one
+    const ZyanU8 begin = patch->changed_offset ? patch->changed_offset : 1;
+    const ZyanU8 end = patch->changed_offset + patch->changed_length;
+    for (ZyanU8 i = begin; i < end; ++i)
+    {
+        __atomic_store_n(&writable[i], patch->bytes[i], __ATOMIC_RELAXED);
+    }
+    sync_status = ZydisPatchSyncCores();
+    status = ZYAN_SUCCESS(status) ? sync_status : status;
+
+    // 3. Publish the new instruction by replacing the `int3`
+    __atomic_store_n(&writable[0], patch->bytes[0], __ATOMIC_SEQ_CST);
+    sync_status = ZydisPatchSyncCores();
+    status = ZYAN_SUCCESS(status) ? sync_status : status;
+
+    __atomic_store_n(&active_breakpoints[index], 0, __ATOMIC_RELEASE);
+    return status;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Analysis                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisPatchGetField(const ZydisDecodedInstruction* instruction, ZyanU8* offset,
+    ZyanU8* size)
+{
+    if (!instruction || !offset || !size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    for (ZyanU8 i = 0; i < ZYAN_ARRAY_LENGTH(instruction->raw.imm); ++i)
+    {
+        if (instruction->raw.imm[i].is_relative && instruction->raw.imm[i].size)
+        {
+            *offset = instruction->raw.imm[i].offset;
+            *size = instruction->raw.imm[i].size / 8;
+            return ZYAN_STATUS_SUCCESS;
+        }
+    }
+
+    // The decoder only sets this attribute for `RIP`-relative memory operands, if there is no
+    // relative immediate
+    if ((instruction->attributes & ZYDIS_ATTRIB_IS_RELATIVE) && instruction->raw.disp.size)
+    {
+        *offset = instruction->raw.disp.offset;
+        *size = instruction->raw.disp.size / 8;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    return ZYAN_STATUS_NOT_FOUND;
+}
+
+ZyanStatus ZydisPatchSelectStrategy(ZyanU64 address, ZyanUSize size, ZydisPatchStrategy* strategy)
+{
+    if (!strategy)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (size == 0)
+    {
+        *strategy = ZYDIS_PATCH_STRATEGY_NONE;
+    }
+    else if ((address & 3) + size <= 4)
+    {
+        *strategy = ZYDIS_PATCH_STRATEGY_ATOMIC_4;
+    }
+    else if ((address & 7) + size <= 8)
+    {
+        *strategy = ZYDIS_PATCH_STRATEGY_ATOMIC_8;
+    }
+    else
+    {
+        *strategy = ZYDIS_PATCH_STRATEGY_BREAKPOINT;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Preparation                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisPatchPrepareRetarget(ZydisPatch* patch,
+    const ZydisDecodedInstruction* instruction, const void* code, ZyanU64 runtime_address,
+    ZyanU64 target)
+{
+    if (!patch || !instruction || !code)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU8 offset;
+    ZyanU8 size;
+    ZYAN_CHECK(ZydisPatchGetField(instruction, &offset, &size));
+    ZYAN_ASSERT((size >= 1) && (size <= 4));
+
+    const ZyanI64 value = (ZyanI64)(target - (runtime_address + instruction->length));
+    const ZyanI64 limit = (ZyanI64)1 << (size * 8 - 1);
+    if ((value < -limit) || (value >= limit))
+    {
+        return ZYAN_STATUS_OUT_OF_RANGE;
+    }
+
+    patch->runtime_address = runtime_address;
+    patch->length = instruction->length;
+    ZYAN_MEMCPY(patch->bytes, code, instruction->length);
+    for (ZyanU8 i = 0; i < size; ++i)
+    {
+        patch->bytes[offset + i] = (ZyanU8)((ZyanU64)value >> (i * 8));
+    }
+
+    return ZydisPatchFinalize(patch, (const ZyanU8*)code);
+}
+
+ZyanStatus ZydisPatchPrepareReplace(ZydisPatch* patch, const void* code, ZyanU8 length,
+    ZyanU64 runtime_address, ZydisEncoderRequest* request)
+{
+    if (!patch || !code || !request || !length || (length > ZYDIS_MAX_INSTRUCTION_LENGTH))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize new_length = length;
+    ZYAN_CHECK(ZydisEncoderEncodeInstructionAbsolute(request, patch->bytes, &new_length,
+        runtime_address));
+    if (new_length < length)
+    {
+        ZYAN_CHECK(ZydisEncoderNopFill(patch->bytes + new_length, length - new_length));
+    }
+
+    patch->runtime_address = runtime_address;
+    patch->length = length;
+
+    return ZydisPatchFinalize(patch, (const ZyanU8*)code);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Runtime                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+#if defined(ZYDIS_PATCH_RUNTIME)
+
+ZyanStatus ZydisPatchInitRuntime(void)
+{
+    for (;;)
+    {
+        ZyanU32 state = __atomic_load_n(&runtime_state, __ATOMIC_ACQUIRE);
+        if (state == ZYDIS_PATCH_RUNTIME_STATE_READY)
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        if ((state == ZYDIS_PATCH_RUNTIME_STATE_UNINITIALIZED) &&
+            __atomic_compare_exchange_n(&runtime_state, &state,
+                ZYDIS_PATCH_RUNTIME_STATE_INITIALIZING, ZYAN_FALSE, __ATOMIC_ACQUIRE,
+                __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        sched_yield();
+    }
+
+    if (syscall(SYS_membarrier, ZYDIS_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE, 0) != 0)
+    {
+        __atomic_store_n(&runtime_state, ZYDIS_PATCH_RUNTIME_STATE_UNINITIALIZED,
+            __ATOMIC_RELEASE);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    struct sigaction action;
+    ZYAN_MEMSET(&action, 0, sizeof(action));
+    action.sa_sigaction = &ZydisPatchTrapHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGTRAP, &action, &previous_action) != 0)
+    {
+        __atomic_store_n(&runtime_state, ZYDIS_PATCH_RUNTIME_STATE_UNINITIALIZED,
+            __ATOMIC_RELEASE);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    __atomic_store_n(&runtime_state, ZYDIS_PATCH_RUNTIME_STATE_READY, __ATOMIC_RELEASE);
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisPatchApply(const ZydisPatch* patch, void* writable)
+{
+    if (!patch || !writable || (patch->length > ZYDIS_MAX_INSTRUCTION_LENGTH) ||
+        (patch->changed_offset + patch->changed_length > patch->length) ||
+        (((ZyanUPointer)writable ^ (ZyanUPointer)patch->runtime_address) & 7))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU8* const destination = (ZyanU8*)writable;
+    switch (patch->strategy)
+    {
+    case ZYDIS_PATCH_STRATEGY_NONE:
+        return ZYAN_STATUS_SUCCESS;
+    case ZYDIS_PATCH_STRATEGY_ATOMIC_4:
+        ZydisPatchWriteAtomic4(destination + patch->changed_offset,
+            patch->bytes + patch->changed_offset, patch->changed_length);
+        return ZYAN_STATUS_SUCCESS;
+    case ZYDIS_PATCH_STRATEGY_ATOMIC_8:
+        ZydisPatchWriteAtomic8(destination + patch->changed_offset,
+            patch->bytes + patch->changed_offset, patch->changed_length);
+        return ZYAN_STATUS_SUCCESS;
+    case ZYDIS_PATCH_STRATEGY_BREAKPOINT:
+        return ZydisPatchApplyBreakpoint(patch, destination);
+    default:
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
@@ -0,0 +1,999 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Encoder.h>
+#include <Zydis/Patch.h>
+#include <Zydis/Register.h>
+#include <Zydis/Rename.h>
+#include <Zydis/Utils.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The instruction has a relative operand.
+ */
+#define ZYDIS_RENAME_ENTRY_FLAG_HAS_TARGET  0x01
+
+/**
+ * The target of the relative operand is inside of the function.
+ */
+#define ZYDIS_RENAME_ENTRY_FLAG_INTERNAL    0x02
+
+/* ============================================================================================== */
+/* Internal types                                                                                 */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisRenameField` enum.
+ */
+typedef enum ZydisRenameField_
+{
+    ZYDIS_RENAME_FIELD_MODRM_REG,
+    ZYDIS_RENAME_FIELD_MODRM_RM,
+    ZYDIS_RENAME_FIELD_SIB_BASE,
+    ZYDIS_RENAME_FIELD_SIB_INDEX,
+    ZYDIS_RENAME_FIELD_OPCODE,
+    ZYDIS_RENAME_FIELD_VVVV,
+    ZYDIS_RENAME_FIELD_IS4
+} ZydisRenameField;
+
+/**
+ * Defines the `ZydisRenameEntry` struct, which describes a single instruction of a function.
+ */
+typedef struct ZydisRenameEntry_
+{
+    /**
+     * The offset of the instruction in the original function.
+     */
+    ZyanUSize old_offset;
+    /**
+     * The offset of the instruction in the renamed function.
+     */
+    ZyanUSize new_offset;
+    /**
+     * The absolute target of the relative operand in the original function.
+     */
+    ZyanU64 target;
+    /**
+     * The length of the renamed instruction.
+     */
+    ZyanU8 length;
+    /**
+     * The size of the relative branch immediate in bytes, or `0`, if there is none.
+     */
+    ZyanU8 branch_size;
+    /**
+     * A combination of `ZYDIS_RENAME_ENTRY_FLAG_*` flags.
+     */
+    ZyanU8 flags;
+} ZydisRenameEntry;
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Registers                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number used to encode the given register in the instruction.
+ *
+ * @param   reg The register.
+ *
+ * @return  The register number.
+ */
+static ZyanU8 ZydisRenameGetNumber(ZydisRegister reg)
+{
+    const ZyanI8 id = ZydisRegisterGetId(reg);
+
+    // `SPL` to `R15B` follow `AH` to `BH` in the `GPR8` class, but share their numbers with them
+    if ((ZydisRegisterGetClass(reg) == ZYDIS_REGCLASS_GPR8) && (id >= 8))
+    {
+        return (ZyanU8)(id - 4);
+    }
+    return (ZyanU8)id;
+}
+
+/**
+ * Checks, if the value fits into a signed field of the given size.
+ *
+ * @param   value   The value.
+ * @param   size    The size of the field in bytes.
+ *
+ * @return  `ZYAN_TRUE`, if the value fits or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisRenameFitsSigned(ZyanI64 value, ZyanU8 size)
+{
+    if (size >= 8)
+    {
+        return ZYAN_TRUE;
+    }
+    const ZyanI64 limit = (ZyanI64)1 << (size * 8 - 1);
+    return (value >= -limit) && (value < limit);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* In-place patching                                                                              */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Sets a single bit of a byte.
+ *
+ * @param   byte    A pointer to the byte.
+ * @param   bit     The index of the bit.
+ * @param   value   The new value of the bit.
+ */
+static void ZydisRenameSetBit(ZyanU8* byte, ZyanU8 bit, ZyanU8 value)
+{
+    *byte = (ZyanU8)((*byte & ~(1u << bit)) | ((value & 1u) << bit));
+}
+
+/**
+ * Writes the extension bits of a register number to the `REX`, `VEX`, `XOP` or `EVEX` prefix.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   bytes       A pointer to the instruction bytes.
+ * @param   field       The field that contains the lower bits of the register number.
+ * @param   number      The register number.
+ *
+ * @return  `ZYAN_TRUE`, if the bits could be written or `ZYAN_FALSE`, if the instruction has to
+ *          be encoded again.
+ */
+static ZyanBool ZydisRenameWriteExtension(const ZydisDecodedInstruction* instruction,
+    ZyanU8* bytes, ZydisRenameField field, ZyanU8 number)
+{
+    const ZyanU8 bit3 = (number >> 3) & 1;
+    const ZyanU8 bit4 = (number >> 4) & 1;
+
+    // The bit positions of `R`, `X` and `B` are the same in `REX` (not inverted) and in the first
+    // payload byte of 3-byte `VEX`, `XOP` and `EVEX` (inverted)
+    ZyanU8 bit;
+    switch (field)
+    {
+    case ZYDIS_RENAME_FIELD_MODRM_REG:
+        bit = 2;
+        break;
+    case ZYDIS_RENAME_FIELD_SIB_INDEX:
+        bit = 1;
+        break;
+    default:
+        bit = 0;
+        break;
+    }
+
+    switch (instruction->encoding)
+    {
+    case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+    case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+        if (bit4 || (field == ZYDIS_RENAME_FIELD_VVVV))
+        {
+            return ZYAN_FALSE;
+        }
+        if (!(instruction->attributes & ZYDIS_ATTRIB_HAS_REX))
+        {
+            return !bit3;
+        }
+        ZydisRenameSetBit(&bytes[instruction->raw.rex.offset], bit, bit3);
+        return ZYAN_TRUE;
+    case ZYDIS_INSTRUCTION_ENCODING_VEX:
+    case ZYDIS_INSTRUCTION_ENCODING_XOP:
+    {
+        if (bit4)
+        {
+            return ZYAN_FALSE;
+        }
+        const ZyanU8 offset = (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_VEX) ?
+            instruction->raw.vex.offset : instruction->raw.xop.offset;
+        const ZyanBool is_short = (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_VEX) &&
+            (instruction->raw.vex.size == 2);
+        if (field == ZYDIS_RENAME_FIELD_VVVV)
+        {
+            ZyanU8* const byte = &bytes[offset + (is_short ? 1 : 2)];
+            *byte = (ZyanU8)((*byte & 0x87) | ((~number & 0x0F) << 3));
+            return ZYAN_TRUE;
+        }
+        if (is_short && (field != ZYDIS_RENAME_FIELD_MODRM_REG))
+        {
+            // The 2-byte form implies `X` and `B`
+            return !bit3;
+        }
+        ZydisRenameSetBit(&bytes[offset + 1], 5 + bit, !bit3);
+        return ZYAN_TRUE;
+    }
+    case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+    {
+        const ZyanU8 offset = instruction->raw.evex.offset;
+        switch (field)
+        {
+        case ZYDIS_RENAME_FIELD_MODRM_REG:
+            ZydisRenameSetBit(&bytes[offset + 1], 4, !bit4);
+            break;
+        case ZYDIS_RENAME_FIELD_MODRM_RM:
+            if (instruction->raw.modrm.mod == 3)
+            {
+                ZydisRenameSetBit(&bytes[offset + 1], 6, !bit4);
+            }
+            else if (bit4)
+            {
+                return ZYAN_FALSE;
+            }
+            break;
+        case ZYDIS_RENAME_FIELD_SIB_INDEX:
+            ZydisRenameSetBit(&bytes[offset + 3], 3, !bit4);
+            break;
+        case ZYDIS_RENAME_FIELD_VVVV:
+        {
+            ZyanU8* const byte = &bytes[offset + 2];
+            *byte = (ZyanU8)((*byte & 0x87) | ((~number & 0x0F) << 3));
+            ZydisRenameSetBit(&bytes[offset + 3], 3, !bit4);
+            return ZYAN_TRUE;
+        }
+        default:
+            if (bit4)
+            {
+                return ZYAN_FALSE;
+            }
+            break;
+        }
+        ZydisRenameSetBit(&bytes[offset + 1], 5 + bit, !bit3);
+        return ZYAN_TRUE;
+    }
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Writes a register number to the given field of an instruction.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   bytes       A pointer to the instruction bytes.
+ * @param   field       The field.
+ * @param   number      The register number.
+ *
+ * @return  `ZYAN_TRUE`, if the number could be written or `ZYAN_FALSE`, if the instruction has to
+ *          be encoded again.
+ */
+static ZyanBool ZydisRenameWriteField(const ZydisDecodedInstruction* instruction, ZyanU8* bytes,
+    ZydisRenameField field, ZyanU8 number)
+{
+    const ZyanU8 low = number & 0x07;
+    switch (field)
+    {
+    case ZYDIS_RENAME_FIELD_MODRM_REG:
+    {
+        ZyanU8* const byte = &bytes[instruction->raw.modrm.offset];
+        *byte = (ZyanU8)((*byte & 0xC7) | (low << 3));
+        break;
+    }
+    case ZYDIS_RENAME_FIELD_MODRM_RM:
+    {
+        ZyanU8* const byte = &bytes[instruction->raw.modrm.offset];
+        *byte = (ZyanU8)((*byte & 0xF8) | low);
+        break;
+    }
+    case ZYDIS_RENAME_FIELD_SIB_BASE:
+    {
+        ZyanU8* const byte = &bytes[instruction->raw.sib.offset];
+        *byte = (ZyanU8)((*byte & 0xF8) | low);
+        break;
+    }
+    case ZYDIS_RENAME_FIELD_SIB_INDEX:
+    {
+        ZyanU8* const byte = &bytes[instruction->raw.sib.offset];
+        *byte = (ZyanU8)((*byte & 0xC7) | (low << 3));
+        break;
+    }
+    case ZYDIS_RENAME_FIELD_OPCODE:
+    {
+        // Register-in-opcode instructions have no `ModRM` byte, so the opcode is directly followed
+        // by the immediates
+        if (instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_LEGACY)
+        {
+            return ZYAN_FALSE;
+        }
+        ZyanU8 offset = instruction->length - 1;
+        for (ZyanU8 i = 0; i < ZYAN_ARRAY_LENGTH(instruction->raw.imm); ++i)
+        {
+            offset -= instruction->raw.imm[i].size / 8;
+        }
+        bytes[offset] = (ZyanU8)((bytes[offset] & 0xF8) | low);
+        break;
+    }
+    case ZYDIS_RENAME_FIELD_VVVV:
+        break;
+    case ZYDIS_RENAME_FIELD_IS4:
+    {
+        if (number >= 16)
+        {
+            return ZYAN_FALSE;
+        }
+        ZyanU8* const byte = &bytes[instruction->raw.imm[0].offset];
+        *byte = (ZyanU8)((*byte & 0x0F) | (number << 4));
+        return ZYAN_TRUE;
+    }
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    return ZydisRenameWriteExtension(instruction, bytes, field, number);
+}
+
+/**
+ * Renames the registers of an instruction by rewriting its register fields.
+ *
+ * @param   map         A pointer to the `ZydisRenameMap` instance.
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands    A pointer to all operands of the instruction.
+ * @param   bytes       A pointer to a copy of the instruction bytes, which is patched in place.
+ * @param   patched     Receives `ZYAN_TRUE`, if all registers could be renamed without changing
+ *                      the length of the instruction.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisRenamePatch(const ZydisRenameMap* map,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    ZyanU8* bytes, ZyanBool* patched)
+{
+    *patched = (instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_MVEX) &&
+        (instruction->address_width != 16);
+
+    // `AH` to `BH` can only be encoded without a `REX` prefix, `SPL` to `DIL` only with one
+    ZyanBool has_high_byte = ZYAN_FALSE;
+    ZyanBool needs_rex = ZYAN_FALSE;
+
+    for (ZyanU8 i = 0; i < instruction->operand_count; ++i)
+    {
+        const ZydisDecodedOperand* const operand = &operands[i];
+        switch (operand->type)
+        {
+        case ZYDIS_OPERAND_TYPE_REGISTER:
+        {
+            ZydisRegister renamed;
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->reg.value, &renamed));
+            has_high_byte |= (renamed >= ZYDIS_REGISTER_AH) && (renamed <= ZYDIS_REGISTER_BH);
+            needs_rex |= (renamed >= ZYDIS_REGISTER_SPL) && (renamed <= ZYDIS_REGISTER_DIL);
+            if (renamed == operand->reg.value)
+            {
+                break;
+            }
+            if (operand->visibility == ZYDIS_OPERAND_VISIBILITY_HIDDEN)
+            {
+                return ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION;
+            }
+            if (!*patched || (operand->visibility != ZYDIS_OPERAND_VISIBILITY_EXPLICIT))
+            {
+                *patched = ZYAN_FALSE;
+                break;
+            }
+
+            ZydisRenameField field;
+            switch (operand->encoding)
+            {
+            case ZYDIS_OPERAND_ENCODING_MODRM_REG:
+                field = ZYDIS_RENAME_FIELD_MODRM_REG;
+                break;
+            case ZYDIS_OPERAND_ENCODING_MODRM_RM:
+                field = ZYDIS_RENAME_FIELD_MODRM_RM;
+                break;
+            case ZYDIS_OPERAND_ENCODING_OPCODE:
+                field = ZYDIS_RENAME_FIELD_OPCODE;
+                break;
+            case ZYDIS_OPERAND_ENCODING_NDSNDD:
+                field = ZYDIS_RENAME_FIELD_VVVV;
+                break;
+            case ZYDIS_OPERAND_ENCODING_IS4:
+                field = ZYDIS_RENAME_FIELD_IS4;
+                break;
+            default:
+                *patched = ZYAN_FALSE;
+                continue;
+            }
+            *patched = ZydisRenameWriteField(instruction, bytes, field,
+                ZydisRenameGetNumber(renamed));
+            break;
+        }
+        case ZYDIS_OPERAND_TYPE_MEMORY:
+        {
+            ZydisRegister base;
+            ZydisRegister index;
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->mem.base, &base));
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->mem.index, &index));
+            if ((base == operand->mem.base) && (index == operand->mem.index))
+            {
+                break;
+            }
+            if (operand->visibility == ZYDIS_OPERAND_VISIBILITY_HIDDEN)
+            {
+                return ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION;
+            }
+            if (!*patched || (operand->visibility != ZYDIS_OPERAND_VISIBILITY_EXPLICIT) ||
+                !(instruction->attributes & ZYDIS_ATTRIB_HAS_MODRM))
+            {
+                *patched = ZYAN_FALSE;
+                break;
+            }
+
+            const ZyanBool has_sib = (instruction->attributes & ZYDIS_ATTRIB_HAS_SIB) != 0;
+            const ZyanU8 mod = instruction->raw.modrm.mod;
+            if (base != operand->mem.base)
+            {
+                // Some base numbers select a different addressing form: `100` requires a `SIB`
+                // byte and `101` without displacement means `RIP` or no base at all
+                const ZyanU8 number = ZydisRenameGetNumber(base);
+                if ((!has_sib && ((number & 0x07) == 4)) || ((mod == 0) && ((number & 0x07) == 5)))
+                {
+                    *patched = ZYAN_FALSE;
+                    break;
+                }
+                *patched = ZydisRenameWriteField(instruction, bytes,
+                    has_sib ? ZYDIS_RENAME_FIELD_SIB_BASE : ZYDIS_RENAME_FIELD_MODRM_RM, number);
+            }
+            if (*patched && (index != operand->mem.index))
+            {
+                // An index number of `100` means no index for general purpose registers
+                const ZyanU8 number = ZydisRenameGetNumber(index);
+                const ZydisRegisterClass index_class = ZydisRegisterGetClass(index);
+                const ZyanBool is_vsib = (index_class == ZYDIS_REGCLASS_XMM) ||
+                    (index_class == ZYDIS_REGCLASS_YMM) || (index_class == ZYDIS_REGCLASS_ZMM);
+                if (!has_sib || (!is_vsib && (number == 4)))
+                {
+                    *patched = ZYAN_FALSE;
+                    break;
+                }
+                *patched = ZydisRenameWriteField(instruction, bytes, ZYDIS_RENAME_FIELD_SIB_INDEX,
+                    number);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (*patched && ((instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_LEGACY) ||
+        (instruction->encoding == ZYDIS_INSTRUCTION_ENCODING_3DNOW)))
+    {
+        const ZyanBool has_rex = (instruction->attributes & ZYDIS_ATTRIB_HAS_REX) != 0;
+        if ((has_high_byte && has_rex) || (needs_rex && !has_rex))
+        {
+            *patched = ZYAN_FALSE;
+        }
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rewriting                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the absolute target of the relative operand of an instruction.
+ *
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to all operands of the instruction.
+ * @param   runtime_address The runtime address of the instruction.
+ * @param   target          Receives the absolute target.
+ * @param   branch_size     Receives the size of the relative branch immediate in bytes, or `0`
+ *                          for `RIP`-relative memory operands.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction has a relative operand or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisRenameGetTarget(const ZydisDecodedInstruction* instruction,
+    const ZydisDecodedOperand* operands, ZyanU64 runtime_address, ZyanU64* target,
+    ZyanU8* branch_size)
+{
+    for (ZyanU8 i = 0; i < instruction->operand_count_visible; ++i)
+    {
+        const ZydisDecodedOperand* const operand = &operands[i];
+        const ZyanBool is_branch =
+            (operand->type == ZYDIS_OPERAND_TYPE_IMMEDIATE) && operand->imm.is_relative;
+        const ZyanBool is_memory = (operand->type == ZYDIS_OPERAND_TYPE_MEMORY) &&
+            ((operand->mem.base == ZYDIS_REGISTER_RIP) ||
+             (operand->mem.base == ZYDIS_REGISTER_EIP));
+        if ((!is_branch && !is_memory) ||
+            !ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(instruction, operand, runtime_address, target)))
+        {
+            continue;
+        }
+
+        *branch_size = 0;
+        for (ZyanU8 j = 0; is_branch && (j < ZYAN_ARRAY_LENGTH(instruction->raw.imm)); ++j)
+        {
+            if (instruction->raw.imm[j].is_relative)
+            {
+                *branch_size = instruction->raw.imm[j].size / 8;
+            }
+        }
+        return ZYAN_TRUE;
+    }
+    return ZYAN_FALSE;
+}
+
+/**
+ * Renames the registers of an instruction and places it at the given address.
+ *
+ * @param   map             A pointer to the `ZydisRenameMap` instance.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to all operands of the instruction.
+ * @param   code            A pointer to the instruction bytes.
+ * @param   runtime_address The new runtime address of the instruction.
+ * @param   target          The new absolute target of the relative operand, if any.
+ * @param   branch_size     The size of the relative branch immediate in bytes, or `0` to keep
+ *                          the current size.
+ * @param   buffer          A pointer to the output buffer.
+ * @param   length          A pointer to the variable containing the length of the output buffer.
+ *                          Upon successful return this variable receives the length of the
+ *                          renamed instruction.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisRenameEmit(const ZydisRenameMap* map,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    const ZyanU8* code, ZyanU64 runtime_address, ZyanU64 target, ZyanU8 branch_size,
+    ZyanU8* buffer, ZyanUSize* length)
+{
+    ZyanU8 bytes[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    ZYAN_MEMCPY(bytes, code, instruction->length);
+
+    ZyanBool patched;
+    ZYAN_CHECK(ZydisRenamePatch(map, instruction, operands, bytes, &patched));
+
+    ZyanU8 field_offset;
+    ZyanU8 field_size;
+    if (patched && ZYAN_SUCCESS(ZydisPatchGetField(instruction, &field_offset, &field_size)))
+    {
+        const ZyanI64 value = (ZyanI64)(target - (runtime_address + instruction->length));
+        if ((branch_size && (branch_size != field_size)) ||
+            !ZydisRenameFitsSigned(value, field_size))
+        {
+            patched = ZYAN_FALSE;
+        }
+        for (ZyanU8 i = 0; patched && (i < field_size); ++i)
+        {
+            bytes[field_offset + i] = (ZyanU8)((ZyanU64)value >> (i * 8));
+        }
+    }
+
+    if (patched)
+    {
+        if (*length < instruction->length)
+        {
+            return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+        }
+        ZYAN_MEMCPY(buffer, bytes, instruction->length);
+        *length = instruction->length;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    ZydisEncoderRequest request;
+    ZYAN_CHECK(ZydisEncoderDecodedInstructionToEncoderRequest(instruction, operands,
+        instruction->operand_count_visible, &request));
+
+    for (ZyanU8 i = 0; i < request.operand_count; ++i)
+    {
+        ZydisEncoderOperand* const operand = &request.operands[i];
+        switch (operand->type)
+        {
+        case ZYDIS_OPERAND_TYPE_REGISTER:
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->reg.value, &operand->reg.value));
+            break;
+        case ZYDIS_OPERAND_TYPE_MEMORY:
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->mem.base, &operand->mem.base));
+            ZYAN_CHECK(ZydisRenameMapRegister(map, operand->mem.index, &operand->mem.index));
+            if ((operand->mem.base == ZYDIS_REGISTER_RIP) ||
+                (operand->mem.base == ZYDIS_REGISTER_EIP))
+            {
+                operand->mem.displacement = (ZyanI64)target;
+            }
+            break;
+        case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+            if (!operands[i].imm.is_relative)
+            {
+                break;
+            }
+            operand->imm.u = target;
+            switch (branch_size)
+            {
+            case 0:
+                break;
+            case 1:
+                request.branch_width = ZYDIS_BRANCH_WIDTH_8;
+                break;
+            case 2:
+                request.branch_type = ZYDIS_BRANCH_TYPE_NEAR;
+                request.branch_width = ZYDIS_BRANCH_WIDTH_16;
+                break;
+            default:
+                request.branch_type = ZYDIS_BRANCH_TYPE_NEAR;
+                request.branch_width = ZYDIS_BRANCH_WIDTH_32;
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    const ZyanStatus status = ZydisEncoderEncodeInstructionAbsolute(&request, buffer, length,
+        runtime_address);
+    if ((status != ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION) ||
+        (instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_VEX) || !request.operand_count ||
+        (request.operand_count == ZYDIS_ENCODER_MAX_OPERANDS))
+    {
+        return status;
+    }
+
+    // Registers `16` to `31` require `EVEX`, where the destination is followed by a mask register
+    ZYAN_MEMMOVE(&request.operands[2], &request.operands[1],
+        (request.operand_count - 1) * sizeof(request.operands[0]));
+    ZYAN_MEMSET(&request.operands[1], 0, sizeof(request.operands[1]));
+    request.operands[1].type = ZYDIS_OPERAND_TYPE_REGISTER;
+    request.operands[1].reg.value = ZYDIS_REGISTER_K0;
+    ++request.operand_count;
+    request.allowed_encodings = ZYDIS_ENCODABLE_ENCODING_EVEX;
+
+    return ZydisEncoderEncodeInstructionAbsolute(&request, buffer, length, runtime_address);
+}
+
+/**
+ * Returns the new absolute target of the relative operand of a function instruction.
+ *
+ * @param   entries         A pointer to the entries of the function.
+ * @param   count           The number of entries.
+ * @param   runtime_address The runtime address of the function.
+ * @param   length          The original length of the function.
+ * @param   new_length      The new length of the function.
+ * @param   entry           A pointer to the entry of the instruction.
+ * @param   target          Receives the new absolute target.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisRenameMapTarget(const ZydisRenameEntry* entries, ZyanUSize count,
+    ZyanU64 runtime_address, ZyanUSize length, ZyanUSize new_length,
+    const ZydisRenameEntry* entry, ZyanU64* target)
+{
+    if (!(entry->flags & ZYDIS_RENAME_ENTRY_FLAG_INTERNAL))
+    {
+        *target = entry->target;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    const ZyanUSize offset = (ZyanUSize)(entry->target - runtime_address);
+    if (offset == length)
+    {
+        *target = runtime_address + new_length;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    ZyanUSize low = 0;
+    ZyanUSize high = count;
+    while (low < high)
+    {
+        const ZyanUSize middle = low + (high - low) / 2;
+        if (entries[middle].old_offset < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if ((low == count) || (entries[low].old_offset != offset))
+    {
+        return ZYAN_STATUS_NOT_FOUND;
+    }
+
+    *target = runtime_address + entries[low].new_offset;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rename map                                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisRenameMapInit(ZydisRenameMap* map)
+{
+    if (!map)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    for (ZyanU8 i = 0; i < ZYDIS_RENAME_GPR_COUNT; ++i)
+    {
+        map->gpr[i] = i;
+    }
+    for (ZyanU8 i = 0; i < ZYDIS_RENAME_VECTOR_COUNT; ++i)
+    {
+        map->vector[i] = i;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisRenameMapSet(ZydisRenameMap* map, ZydisRegister from, ZydisRegister to)
+{
+    if (!map)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZydisRegister from64 = ZydisRegisterGetLargestEnclosing(ZYDIS_MACHINE_MODE_LONG_64, from);
+    const ZydisRegister to64 = ZydisRegisterGetLargestEnclosing(ZYDIS_MACHINE_MODE_LONG_64, to);
+    const ZydisRegisterClass from_class = ZydisRegisterGetClass(from64);
+    const ZydisRegisterClass to_class = ZydisRegisterGetClass(to64);
+
+    if ((from_class == ZYDIS_REGCLASS_GPR64) && (to_class == ZYDIS_REGCLASS_GPR64))
+    {
+        map->gpr[ZydisRegisterGetId(from64)] = (ZyanU8)ZydisRegisterGetId(to64);
+        return ZYAN_STATUS_SUCCESS;
+    }
+    if ((from_class == ZYDIS_REGCLASS_ZMM) && (to_class == ZYDIS_REGCLASS_ZMM))
+    {
+        map->vector[ZydisRegisterGetId(from64)] = (ZyanU8)ZydisRegisterGetId(to64);
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    return ZYAN_STATUS_INVALID_ARGUMENT;
+}
+
+ZyanStatus ZydisRenameMapRegister(const ZydisRenameMap* map, ZydisRegister reg,
+    ZydisRegister* renamed)
+{
+    if (!map || !renamed)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZydisRegisterClass register_class = ZydisRegisterGetClass(reg);
+    const ZyanI8 id = ZydisRegisterGetId(reg);
+    switch (register_class)
+    {
+    case ZYDIS_REGCLASS_GPR8:
+    {
+        // `AL` to `BL`, `AH` to `BH`, `SPL` to `DIL`, `R8B` to `R15B`
+        if ((id >= 4) && (id < 8))
+        {
+            const ZyanU8 family = map->gpr[id - 4];
+            if (family >= 4)
+            {
+                return ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION;
+            }
+            *renamed = ZydisRegisterEncode(register_class, family + 4);
+            break;
+        }
+        const ZyanU8 family = map->gpr[(id < 4) ? id : id - 4];
+        *renamed = ZydisRegisterEncode(register_class, (family < 4) ? family : family + 4);
+        break;
+    }
+    case ZYDIS_REGCLASS_GPR16:
+    case ZYDIS_REGCLASS_GPR32:
+    case ZYDIS_REGCLASS_GPR64:
+        *renamed = ZydisRegisterEncode(register_class, map->gpr[id]);
+        break;
+    case ZYDIS_REGCLASS_XMM:
+    case ZYDIS_REGCLASS_YMM:
+    case ZYDIS_REGCLASS_ZMM:
+        *renamed = ZydisRegisterEncode(register_class, map->vector[id]);
+        break;
+    default:
+        *renamed = reg;
+        break;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rewriting                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisRenameInstruction(const ZydisRenameMap* map,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    const void* code, ZyanU64 runtime_address, void* buffer, ZyanUSize* length)
+{
+    if (!map || !instruction || (instruction->operand_count && !operands) || !code || !buffer ||
+        !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU64 target = 0;
+    ZyanU8 branch_size = 0;
+    ZydisRenameGetTarget(instruction, operands, runtime_address, &target, &branch_size);
+
+    return ZydisRenameEmit(map, instruction, operands, (const ZyanU8*)code, runtime_address,
+        target, 0, (ZyanU8*)buffer, length);
+}
+
+ZyanStatus ZydisRenameGetWorkspaceSize(const ZydisDecoder* decoder, const void* code,
+    ZyanUSize length, ZyanUSize* size)
+{
+    if (!decoder || (!code && length) || !size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisDecodedInstruction instruction;
+    ZyanUSize count = 0;
+    for (ZyanUSize offset = 0; offset < length; offset += instruction.length)
+    {
+        ZYAN_CHECK(ZydisDecoderDecodeInstruction(decoder, ZYAN_NULL,
+            (const ZyanU8*)code + offset, length - offset, &instruction));
+        ++count;
+    }
+    *size = count * sizeof(ZydisRenameEntry);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisRenameFunction(const ZydisDecoder* decoder, const ZydisRenameMap* map,
+    const void* code, ZyanUSize length, ZyanU64 runtime_address, void* buffer,
+    ZyanUSize* buffer_length, void* workspace, ZyanUSize workspace_size)
+{
+    if (!decoder || !map || (!code && length) || !buffer || !buffer_length ||
+        (!workspace && workspace_size))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* const input = (const ZyanU8*)code;
+    ZyanU8* const output = (ZyanU8*)buffer;
+    ZydisRenameEntry* const entries = (ZydisRenameEntry*)workspace;
+    const ZyanUSize capacity = workspace_size / sizeof(ZydisRenameEntry);
+
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    ZyanU8 scratch[ZYDIS_MAX_INSTRUCTION_LENGTH];
+
+    // Rename every instruction at its original address to find its new length
+    ZyanUSize count = 0;
+    for (ZyanUSize offset = 0; offset < length; offset += instruction.length)
+    {
+        if (count == capacity)
+        {
+            return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+        }
+        ZYAN_CHECK(ZydisDecoderDecodeFull(decoder, input + offset, length - offset, &instruction,
+            operands));
+
+        ZydisRenameEntry* const entry = &entries[count++];
+        entry->old_offset = offset;
+        entry->new_offset = offset;
+        entry->target = 0;
+        entry->branch_size = 0;
+        entry->flags = 0;
+        if (ZydisRenameGetTarget(&instruction, operands, runtime_address + offset, &entry->target,
+            &entry->branch_size))
+        {
+            entry->flags |= ZYDIS_RENAME_ENTRY_FLAG_HAS_TARGET;
+            if ((entry->target >= runtime_address) && (entry->target - runtime_address <= length))
+            {
+                entry->flags |= ZYDIS_RENAME_ENTRY_FLAG_INTERNAL;
+            }
+        }
+
+        ZyanUSize instruction_length = sizeof(scratch);
+        ZYAN_CHECK(ZydisRenameEmit(map, &instruction, operands, input + offset,
+            runtime_address + offset, entry->target, entry->branch_size, scratch,
+            &instruction_length));
+        entry->length = (ZyanU8)instruction_length;
+    }
+
+    // Lay out the function and widen branches that went out of range. Branches only grow, so this
+    // terminates.
+    ZyanUSize new_length;
+    for (;;)
+    {
+        new_length = 0;
+        for (ZyanUSize i = 0; i < count; ++i)
+        {
+            entries[i].new_offset = new_length;
+            new_length += entries[i].length;
+        }
+
+        ZyanBool changed = ZYAN_FALSE;
+        for (ZyanUSize i = 0; i < count; ++i)
+        {
+            ZydisRenameEntry* const entry = &entries[i];
+            if (!entry->branch_size)
+            {
+                continue;
+            }
+
+            ZyanU64 target;
+            ZYAN_CHECK(ZydisRenameMapTarget(entries, count, runtime_address, length, new_length,
+                entry, &target));
+            const ZyanU64 address = runtime_address + entry->new_offset;
+            if (ZydisRenameFitsSigned((ZyanI64)(target - (address + entry->length)),
+                entry->branch_size))
+            {
+                continue;
+            }
+            if (entry->branch_size >= 4)
+            {
+                return ZYAN_STATUS_OUT_OF_RANGE;
+            }
+
+            ZYAN_CHECK(ZydisDecoderDecodeFull(decoder, input + entry->old_offset,
+                length - entry->old_offset, &instruction, operands));
+            ZyanUSize instruction_length = sizeof(scratch);
+            ZYAN_CHECK(ZydisRenameEmit(map, &instruction, operands, input + entry->old_offset,
+                address, target, 4, scratch, &instruction_length));
+            entry->branch_size = 4;
+            entry->length = (ZyanU8)instruction_length;
+            changed = ZYAN_TRUE;
+        }
+        if (!changed)
+        {
+            break;
+        }
+    }
+
+    if (*buffer_length < new_length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const ZydisRenameEntry* const entry = &entries[i];
+        ZYAN_CHECK(ZydisDecoderDecodeFull(decoder, input + entry->old_offset,
+            length - entry->old_offset, &instruction, operands));
+
+        ZyanU64 target = 0;
+        if (entry->flags & ZYDIS_RENAME_ENTRY_FLAG_HAS_TARGET)
+        {
+            ZYAN_CHECK(ZydisRenameMapTarget(entries, count, runtime_address, length, new_length,
+                entry, &target));
+        }
+
+        ZyanUSize instruction_length = entry->length;
+        ZYAN_CHECK(ZydisRenameEmit(map, &instruction, operands, input + entry->old_offset,
+            runtime_address + entry->new_offset, target, entry->branch_size,
+            output + entry->new_offset, &instruction_length));
+        ZYAN_ASSERT(instruction_length == entry->length);
+    }
+    *buffer_length = new_length;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
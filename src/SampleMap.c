@@ -0,0 +1,450 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/SampleMap.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Marks the first instruction of a basic block. Only used in the compacted info array of the map.
+ */
+#define ZYDIS_SAMPLE_MAP_INFO_BLOCK_START 0x80
+
+/**
+ * The number of samples looked up at once by `ZydisSampleMapAccumulate`.
+ */
+#define ZYDIS_SAMPLE_MAP_BATCH_SIZE 256
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/**
+ * Returns the sweep info flags of the given instruction.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  A combination of `ZYDIS_SAMPLE_MAP_INFO_*` flags.
+ */
+static ZyanU8 ZydisSampleMapGetFlags(const ZydisDecodedInstruction* instruction)
+{
+    ZyanU8 flags = 0;
+    switch (instruction->meta.category)
+    {
+    case ZYDIS_CATEGORY_COND_BR:
+    case ZYDIS_CATEGORY_UNCOND_BR:
+        flags |= ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK;
+        ZYAN_FALLTHROUGH;
+    case ZYDIS_CATEGORY_CALL:
+        if (instruction->raw.imm[0].is_relative)
+        {
+            flags |= ZYDIS_SAMPLE_MAP_INFO_BRANCH;
+        }
+        break;
+    case ZYDIS_CATEGORY_RET:
+    case ZYDIS_CATEGORY_SYSCALL:
+    case ZYDIS_CATEGORY_SYSRET:
+    case ZYDIS_CATEGORY_INTERRUPT:
+        flags |= ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK;
+        break;
+    default:
+        switch (instruction->mnemonic)
+        {
+        case ZYDIS_MNEMONIC_HLT:
+        case ZYDIS_MNEMONIC_UD0:
+        case ZYDIS_MNEMONIC_UD1:
+        case ZYDIS_MNEMONIC_UD2:
+            flags |= ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK;
+            break;
+        default:
+            break;
+        }
+        break;
+    }
+    return flags;
+}
+
+/**
+ * Returns the index of the last instruction that starts at or in front of the given offset.
+ *
+ * @param   map     A pointer to the `ZydisSampleMap` instance.
+ * @param   offset  The offset. Must be less than the length of the map.
+ *
+ * @return  The instruction index.
+ *
+ * At most `2^ZYDIS_SAMPLE_MAP_BUCKET_SHIFT + 1` instructions are candidates for every bucket, so
+ * the binary search always takes `ZYDIS_SAMPLE_MAP_BUCKET_SHIFT + 1` steps. The search does not
+ * contain any data-dependent branches and the compiler emits conditional moves instead.
+ */
+ZYAN_INLINE ZyanU32 ZydisSampleMapFind(const ZydisSampleMap* map, ZyanU32 offset)
+{
+    const ZyanU32 bucket = offset >> ZYDIS_SAMPLE_MAP_BUCKET_SHIFT;
+    const ZyanU32 last = map->buckets[bucket + 1];
+    ZyanU32 base = map->buckets[bucket];
+    for (ZyanU32 step = 1 << ZYDIS_SAMPLE_MAP_BUCKET_SHIFT; step; step >>= 1)
+    {
+        const ZyanU32 candidate = ZYAN_MIN(base + step, last);
+        base = (map->offsets[candidate] <= offset) ? candidate : base;
+    }
+    return base;
+}
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Construction                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisSampleMapSweep(const ZydisDecoder* decoder, const void* buffer,
+    ZyanUSize length, ZyanUSize begin, ZyanUSize end, ZyanU8* info)
+{
+    if (!decoder || (!buffer && length) || !info || (begin > end) || (end > length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZyanUSize offset = begin;
+    while (offset < end)
+    {
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + offset,
+            length - offset, &instruction)))
+        {
+            info[offset++] = 1 | ZYDIS_SAMPLE_MAP_INFO_INVALID | ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK;
+            continue;
+        }
+
+        info[offset] = instruction.length | ZydisSampleMapGetFlags(&instruction);
+        offset += instruction.length;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapCountInstructions(const ZyanU8* info, ZyanUSize length,
+    ZyanUSize* count)
+{
+    if ((!info && length) || !count)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize result = 0;
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        const ZyanU8 size = info[offset] & ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK;
+        result += (size != 0);
+        offset += size ? size : 1;
+    }
+    *count = result;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapGetWorkspaceSize(ZyanUSize length, ZyanUSize instruction_count,
+    ZyanUSize* size)
+{
+    if (!size || (length > ZYAN_UINT32_MAX) || (instruction_count > length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    // Offsets, blocks and buckets are 32-bit values, the info bytes go last to keep the alignment
+    *size = instruction_count * (2 * sizeof(ZyanU32) + sizeof(ZyanU8)) +
+        ((length >> ZYDIS_SAMPLE_MAP_BUCKET_SHIFT) + 2) * sizeof(ZyanU32);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapInit(ZydisSampleMap* map, const ZydisDecoder* decoder,
+    const void* buffer, ZyanUSize length, ZyanU64 runtime_address, const ZyanU8* info,
+    void* workspace, ZyanUSize workspace_size)
+{
+    if (!map || !decoder || (!buffer && length) || (!info && length) || !workspace ||
+        ((ZyanUPointer)workspace % sizeof(ZyanU32)) || (length > ZYAN_UINT32_MAX))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize count;
+    ZYAN_CHECK(ZydisSampleMapCountInstructions(info, length, &count));
+    ZyanUSize size;
+    ZYAN_CHECK(ZydisSampleMapGetWorkspaceSize(length, count, &size));
+    if (workspace_size < size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZYAN_MEMSET(map, 0, sizeof(*map));
+    map->runtime_address = runtime_address;
+    map->length = (ZyanU32)length;
+    map->instruction_count = (ZyanU32)count;
+    map->offsets = (ZyanU32*)workspace;
+    map->blocks = map->offsets + count;
+    map->buckets = map->blocks + count;
+    map->info = (ZyanU8*)(map->buckets + (length >> ZYDIS_SAMPLE_MAP_BUCKET_SHIFT) + 2);
+
+    // Compact the instruction boundaries
+    ZyanU32 index = 0;
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        const ZyanU8 value = info[offset];
+        const ZyanU8 size = value & ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK;
+        if (!size)
+        {
+            ++offset;
+            continue;
+        }
+        map->offsets[index] = (ZyanU32)offset;
+        map->info[index] = value;
+        ++index;
+        offset += size;
+    }
+
+    // The lookup index is needed to resolve branch targets, so it is built first
+    const ZyanU32 bucket_count = (ZyanU32)(length >> ZYDIS_SAMPLE_MAP_BUCKET_SHIFT) + 2;
+    index = 0;
+    for (ZyanU32 i = 0; i < bucket_count; ++i)
+    {
+        const ZyanU64 position = (ZyanU64)i << ZYDIS_SAMPLE_MAP_BUCKET_SHIFT;
+        while ((index + 1 < count) && (map->offsets[index + 1] <= position))
+        {
+            ++index;
+        }
+        map->buckets[i] = index;
+    }
+    if (!count)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    // Mark the targets of relative branches
+    const ZyanU64 address_mask = (decoder->machine_mode == ZYDIS_MACHINE_MODE_LONG_64) ?
+        ZYAN_UINT64_MAX : 0xFFFFFFFF;
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    for (ZyanU32 i = 0; i < count; ++i)
+    {
+        if (!(map->info[i] & ZYDIS_SAMPLE_MAP_INFO_BRANCH))
+        {
+            continue;
+        }
+        const ZyanU32 source = map->offsets[i];
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, data + source,
+            length - source, &instruction)))
+        {
+            continue;
+        }
+        const ZyanU64 target = ((runtime_address + source + instruction.length +
+            (ZyanU64)instruction.raw.imm[0].value.s) & address_mask) - runtime_address;
+        if (target >= length)
+        {
+            continue;
+        }
+        const ZyanU32 leader = ZydisSampleMapFind(map, (ZyanU32)target);
+        if (map->offsets[leader] == target)
+        {
+            map->info[leader] |= ZYDIS_SAMPLE_MAP_INFO_BLOCK_START;
+        }
+    }
+
+    // Assign the basic blocks
+    ZyanU32 block = 0;
+    map->info[0] |= ZYDIS_SAMPLE_MAP_INFO_BLOCK_START;
+    map->blocks[0] = 0;
+    for (ZyanU32 i = 1; i < count; ++i)
+    {
+        const ZyanU8 previous = map->info[i - 1];
+        if ((previous & ZYDIS_SAMPLE_MAP_INFO_ENDS_BLOCK) || (map->offsets[i] !=
+            map->offsets[i - 1] + (previous & ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK)))
+        {
+            map->info[i] |= ZYDIS_SAMPLE_MAP_INFO_BLOCK_START;
+        }
+        block += (map->info[i] & ZYDIS_SAMPLE_MAP_INFO_BLOCK_START) ? 1 : 0;
+        map->blocks[i] = block;
+    }
+    map->block_count = block + 1;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Attribution                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisSampleMapLookup(const ZydisSampleMap* map, const ZyanU64* samples,
+    ZyanUSize count, ZyanU32* indices)
+{
+    if (!map || ((!samples || !indices) && count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!map->instruction_count)
+    {
+        for (ZyanUSize i = 0; i < count; ++i)
+        {
+            indices[i] = ZYDIS_SAMPLE_MAP_NO_INSTRUCTION;
+        }
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const ZyanU64 position = samples[i] - map->runtime_address;
+        const ZyanBool is_inside = (position < map->length);
+        const ZyanU32 offset = is_inside ? (ZyanU32)position : 0;
+        const ZyanU32 index = ZydisSampleMapFind(map, offset);
+        // Gaps between swept ranges do not belong to any instruction
+        const ZyanBool is_hit = is_inside & (offset - map->offsets[index] <
+            (ZyanU32)(map->info[index] & ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK));
+        indices[i] = is_hit ? index : ZYDIS_SAMPLE_MAP_NO_INSTRUCTION;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapAccumulate(const ZydisSampleMap* map,
+    const ZyanU64* samples, ZyanUSize count, ZyanU64* hits, ZyanU64* unmatched)
+{
+    if (!map || ((!samples || !hits) && count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!map->instruction_count)
+    {
+        if (unmatched)
+        {
+            *unmatched += count;
+        }
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    ZyanU32 indices[ZYDIS_SAMPLE_MAP_BATCH_SIZE];
+    ZyanU64 misses = 0;
+    for (ZyanUSize i = 0; i < count; i += ZYDIS_SAMPLE_MAP_BATCH_SIZE)
+    {
+        const ZyanUSize batch = ZYAN_MIN(count - i, ZYDIS_SAMPLE_MAP_BATCH_SIZE);
+        ZYAN_CHECK(ZydisSampleMapLookup(map, samples + i, batch, indices));
+        for (ZyanUSize j = 0; j < batch; ++j)
+        {
+            // Misses are added to the first counter with a weight of zero to avoid a branch
+            const ZyanBool is_hit = (indices[j] != ZYDIS_SAMPLE_MAP_NO_INSTRUCTION);
+            hits[is_hit ? indices[j] : 0] += is_hit;
+            misses += !is_hit;
+        }
+    }
+    if (unmatched)
+    {
+        *unmatched += misses;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapSumBlocks(const ZydisSampleMap* map, const ZyanU64* hits,
+    ZyanU64* block_hits)
+{
+    if (!map || ((!hits || !block_hits) && map->instruction_count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    for (ZyanU32 i = 0; i < map->block_count; ++i)
+    {
+        block_hits[i] = 0;
+    }
+    for (ZyanU32 i = 0; i < map->instruction_count; ++i)
+    {
+        block_hits[map->blocks[i]] += hits[i];
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Information                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisSampleMapGetInstructionCount(const ZydisSampleMap* map, ZyanUSize* count)
+{
+    if (!map || !count)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *count = map->instruction_count;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapGetBlockCount(const ZydisSampleMap* map, ZyanUSize* count)
+{
+    if (!map || !count)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *count = map->block_count;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSampleMapGetInstruction(const ZydisSampleMap* map, ZyanUSize index,
+    ZydisSampleMapInstruction* instruction)
+{
+    if (!map || !instruction || (index >= map->instruction_count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8 info = map->info[index];
+    instruction->address = map->runtime_address + map->offsets[index];
+    instruction->offset = map->offsets[index];
+    instruction->block = map->blocks[index];
+    instruction->length = info & ZYDIS_SAMPLE_MAP_INFO_LENGTH_MASK;
+    instruction->is_block_start = (info & ZYDIS_SAMPLE_MAP_INFO_BLOCK_START) ? ZYAN_TRUE :
+        ZYAN_FALSE;
+    instruction->is_invalid = (info & ZYDIS_SAMPLE_MAP_INFO_INVALID) ? ZYAN_TRUE : ZYAN_FALSE;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
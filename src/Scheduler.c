@@ -0,0 +1,824 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Scheduler.h>
+#include <Zydis/Encoder.h>
+#include <Zydis/Register.h>
+#include <Zydis/Utils.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Marks an unused `last_writer` slot.
+ */
+#define ZYDIS_SCHEDULER_NONE 0xFFFFFFFF
+
+/**
+ * The first resource index used for the CPU flags. Resources below this index are registers.
+ */
+#define ZYDIS_SCHEDULER_RESOURCE_CPUFLAGS (ZYDIS_REGISTER_MAX_VALUE + 1)
+
+/**
+ * The resource index used for memory.
+ */
+#define ZYDIS_SCHEDULER_RESOURCE_MEMORY (ZYDIS_SCHEDULER_RESOURCE_CPUFLAGS + 32)
+
+/**
+ * The total number of tracked resources.
+ */
+#define ZYDIS_SCHEDULER_RESOURCE_COUNT (ZYDIS_SCHEDULER_RESOURCE_MEMORY + 1)
+
+/**
+ * The maximum number of resources accessed by a single instruction.
+ */
+#define ZYDIS_SCHEDULER_MAX_ACCESSES 96
+
+/* ============================================================================================== */
+/* Internal types                                                                                 */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ZydisSchedulerAccesses` struct.
+ */
+typedef struct ZydisSchedulerAccesses_
+{
+    /**
+     * The number of read resources.
+     */
+    ZyanUSize read_count;
+    /**
+     * The number of written resources.
+     */
+    ZyanUSize write_count;
+    /**
+     * The read resources.
+     */
+    ZyanU16 reads[ZYDIS_SCHEDULER_MAX_ACCESSES];
+    /**
+     * The written resources.
+     */
+    ZyanU16 writes[ZYDIS_SCHEDULER_MAX_ACCESSES];
+} ZydisSchedulerAccesses;
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Helper functions                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of the lowest set bit.
+ *
+ * @param   value   The value. Must not be `0`.
+ *
+ * @return  The number of the lowest set bit.
+ */
+ZYAN_INLINE ZyanU32 ZydisSchedulerFindLowestBit(ZyanU64 value)
+{
+    ZYAN_ASSERT(value);
+
+#if defined(ZYAN_GCC) || defined(ZYAN_CLANG)
+    return (ZyanU32)__builtin_ctzll(value);
+#else
+    ZyanU32 index = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+/**
+ * Adds an edge to the dependency graph.
+ *
+ * @param   scheduler   A pointer to the `ZydisScheduler` instance.
+ * @param   from        The index of the instruction that is depended on.
+ * @param   to          The index of the dependent instruction.
+ */
+ZYAN_INLINE void ZydisSchedulerAddEdge(ZydisScheduler* scheduler, ZyanUSize from, ZyanUSize to)
+{
+    ZYAN_ASSERT(from < to);
+
+    ZyanU64* word = &scheduler->successors[from * scheduler->row_length + (to >> 6)];
+    const ZyanU64 mask = 1ULL << (to & 63);
+    if (!(*word & mask))
+    {
+        *word |= mask;
+        ++scheduler->predecessor_count[to];
+    }
+}
+
+/**
+ * Maps a register to its resource index.
+ *
+ * @param   machine_mode    The machine mode.
+ * @param   reg             The register.
+ *
+ * @return  The resource index or `ZYDIS_REGISTER_NONE`, if the register is not tracked.
+ */
+static ZyanU16 ZydisSchedulerGetRegisterResource(ZydisMachineMode machine_mode, ZydisRegister reg)
+{
+    switch (ZydisRegisterGetClass(reg))
+    {
+    case ZYDIS_REGCLASS_INVALID:
+    case ZYDIS_REGCLASS_IP:
+    case ZYDIS_REGCLASS_FLAGS:
+        // The instruction pointer is only written by barriers and flags are tracked individually
+        return ZYDIS_REGISTER_NONE;
+    case ZYDIS_REGCLASS_X87:
+    case ZYDIS_REGCLASS_MMX:
+        // `ST(i)` is relative to the current top of stack and the `MMX` registers alias the
+        // physical x87 registers, so all of them are tracked as a single resource
+        return ZYDIS_REGISTER_X87STATUS;
+    default:
+        break;
+    }
+
+    const ZydisRegister enclosing = ZydisRegisterGetLargestEnclosing(machine_mode, reg);
+    return (ZyanU16)((enclosing != ZYDIS_REGISTER_NONE) ? enclosing : reg);
+}
+
+/**
+ * Adds a resource access to the given list.
+ *
+ * @param   list        A pointer to the resource list.
+ * @param   count       A pointer to the number of entries in the list.
+ * @param   resource    The resource index.
+ */
+ZYAN_INLINE void ZydisSchedulerAddAccess(ZyanU16* list, ZyanUSize* count, ZyanU16 resource)
+{
+    if ((resource != ZYDIS_REGISTER_NONE) && (*count < ZYDIS_SCHEDULER_MAX_ACCESSES))
+    {
+        list[(*count)++] = resource;
+    }
+}
+
+/**
+ * Collects all resources accessed by the given instruction.
+ *
+ * @param   item        A pointer to the `ZydisSchedulerInstruction` struct.
+ * @param   accesses    A pointer to the `ZydisSchedulerAccesses` struct.
+ */
+static void ZydisSchedulerCollectAccesses(const ZydisSchedulerInstruction* item,
+    ZydisSchedulerAccesses* accesses)
+{
+    const ZydisDecodedInstruction* instruction = &item->instruction;
+    const ZydisMachineMode machine_mode = instruction->machine_mode;
+
+    accesses->read_count = 0;
+    accesses->write_count = 0;
+
+    for (ZyanU8 i = 0; i < instruction->operand_count; ++i)
+    {
+        const ZydisDecodedOperand* operand = &item->operands[i];
+        switch (operand->type)
+        {
+        case ZYDIS_OPERAND_TYPE_REGISTER:
+        {
+            const ZyanU16 resource =
+                ZydisSchedulerGetRegisterResource(machine_mode, operand->reg.value);
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_READ)
+            {
+                ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count, resource);
+            }
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_WRITE)
+            {
+                ZydisSchedulerAddAccess(accesses->writes, &accesses->write_count, resource);
+            }
+            break;
+        }
+        case ZYDIS_OPERAND_TYPE_MEMORY:
+            ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count,
+                ZydisSchedulerGetRegisterResource(machine_mode, operand->mem.segment));
+            ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count,
+                ZydisSchedulerGetRegisterResource(machine_mode, operand->mem.base));
+            ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count,
+                ZydisSchedulerGetRegisterResource(machine_mode, operand->mem.index));
+            if (operand->mem.type != ZYDIS_MEMOP_TYPE_AGEN)
+            {
+                // Memory accesses are kept in their original order, so all of them are treated
+                // as writes
+                ZydisSchedulerAddAccess(accesses->writes, &accesses->write_count,
+                    ZYDIS_SCHEDULER_RESOURCE_MEMORY);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    const ZydisAccessedFlagsMask tested = instruction->cpu_flags->tested;
+    const ZydisAccessedFlagsMask written = instruction->cpu_flags->modified |
+        instruction->cpu_flags->set_0 | instruction->cpu_flags->set_1 |
+        instruction->cpu_flags->undefined;
+    for (ZyanU16 i = 0; i < 32; ++i)
+    {
+        if (tested & (1ul << i))
+        {
+            ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count,
+                ZYDIS_SCHEDULER_RESOURCE_CPUFLAGS + i);
+        }
+        if (written & (1ul << i))
+        {
+            ZydisSchedulerAddAccess(accesses->writes, &accesses->write_count,
+                ZYDIS_SCHEDULER_RESOURCE_CPUFLAGS + i);
+        }
+    }
+
+    // The FPU flags are part of the x87 status word
+    if (instruction->fpu_flags->tested)
+    {
+        ZydisSchedulerAddAccess(accesses->reads, &accesses->read_count,
+            ZYDIS_REGISTER_X87STATUS);
+    }
+    if ((instruction->meta.isa_ext == ZYDIS_ISA_EXT_X87) || instruction->fpu_flags->modified ||
+        instruction->fpu_flags->set_0 || instruction->fpu_flags->set_1 ||
+        instruction->fpu_flags->undefined)
+    {
+        ZydisSchedulerAddAccess(accesses->writes, &accesses->write_count,
+            ZYDIS_REGISTER_X87STATUS);
+    }
+}
+
+/**
+ * Checks if the given instruction must not be reordered with any other instruction.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction is a barrier or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisSchedulerIsBarrier(const ZydisDecodedInstruction* instruction)
+{
+    if (instruction->attributes & (ZYDIS_ATTRIB_IS_PRIVILEGED | ZYDIS_ATTRIB_HAS_LOCK))
+    {
+        return ZYAN_TRUE;
+    }
+
+    // `ZYDIS_CATEGORY_MISC` mixes fences and serializing instructions with plain ones like `lea`,
+    // `leave` or `xlat`, so its barriers are listed by mnemonic
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_CLFLUSH:
+    case ZYDIS_MNEMONIC_CPUID:
+    case ZYDIS_MNEMONIC_INVPCID:
+    case ZYDIS_MNEMONIC_LFENCE:
+    case ZYDIS_MNEMONIC_MCOMMIT:
+    case ZYDIS_MNEMONIC_MFENCE:
+    case ZYDIS_MNEMONIC_MONITOR:
+    case ZYDIS_MNEMONIC_MONITORX:
+    case ZYDIS_MNEMONIC_MWAIT:
+    case ZYDIS_MNEMONIC_MWAITX:
+    case ZYDIS_MNEMONIC_PAUSE:
+    case ZYDIS_MNEMONIC_SFENCE:
+    case ZYDIS_MNEMONIC_UD0:
+    case ZYDIS_MNEMONIC_UD1:
+    case ZYDIS_MNEMONIC_UD2:
+        return ZYAN_TRUE;
+    default:
+        break;
+    }
+
+    switch (instruction->meta.category)
+    {
+    case ZYDIS_CATEGORY_CALL:
+    case ZYDIS_CATEGORY_CET:
+    case ZYDIS_CATEGORY_CLDEMOTE:
+    case ZYDIS_CATEGORY_CLFLUSHOPT:
+    case ZYDIS_CATEGORY_CLWB:
+    case ZYDIS_CATEGORY_COND_BR:
+    case ZYDIS_CATEGORY_ENQCMD:
+    case ZYDIS_CATEGORY_FRED:
+    case ZYDIS_CATEGORY_HRESET:
+    case ZYDIS_CATEGORY_INTERRUPT:
+    case ZYDIS_CATEGORY_IO:
+    case ZYDIS_CATEGORY_IOSTRINGOP:
+    case ZYDIS_CATEGORY_KEYLOCKER:
+    case ZYDIS_CATEGORY_KEYLOCKER_WIDE:
+    case ZYDIS_CATEGORY_LKGS:
+    case ZYDIS_CATEGORY_MOVDIR:
+    case ZYDIS_CATEGORY_MSRLIST:
+    case ZYDIS_CATEGORY_PCOMMIT:
+    case ZYDIS_CATEGORY_PCONFIG:
+    case ZYDIS_CATEGORY_PT:
+    case ZYDIS_CATEGORY_RET:
+    case ZYDIS_CATEGORY_SEGOP:
+    case ZYDIS_CATEGORY_SEMAPHORE:
+    case ZYDIS_CATEGORY_SERIALIZE:
+    case ZYDIS_CATEGORY_SGX:
+    case ZYDIS_CATEGORY_SYSCALL:
+    case ZYDIS_CATEGORY_SYSRET:
+    case ZYDIS_CATEGORY_SYSTEM:
+    case ZYDIS_CATEGORY_TSX_LDTRK:
+    case ZYDIS_CATEGORY_UINTR:
+    case ZYDIS_CATEGORY_UNCOND_BR:
+    case ZYDIS_CATEGORY_VTX:
+    case ZYDIS_CATEGORY_WAITPKG:
+    case ZYDIS_CATEGORY_WRMSRNS:
+    case ZYDIS_CATEGORY_XSAVE:
+    case ZYDIS_CATEGORY_XSAVEOPT:
+        return ZYAN_TRUE;
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Estimates the latency of the given instruction.
+ *
+ * @param   item    A pointer to the `ZydisSchedulerInstruction` struct.
+ *
+ * @return  The estimated latency in cycles.
+ */
+static ZyanU32 ZydisSchedulerGetLatency(const ZydisSchedulerInstruction* item)
+{
+    const ZydisDecodedInstruction* instruction = &item->instruction;
+
+    ZyanU32 latency;
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_DIV:
+    case ZYDIS_MNEMONIC_IDIV:
+        latency = 20;
+        break;
+    case ZYDIS_MNEMONIC_MUL:
+    case ZYDIS_MNEMONIC_IMUL:
+    case ZYDIS_MNEMONIC_MULX:
+        latency = 3;
+        break;
+    default:
+        switch (instruction->encoding)
+        {
+        case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+            latency = (instruction->meta.isa_ext == ZYDIS_ISA_EXT_BASE) ? 1 : 3;
+            break;
+        default:
+            latency = 3;
+            break;
+        }
+        break;
+    }
+
+    for (ZyanU8 i = 0; i < instruction->operand_count; ++i)
+    {
+        const ZydisDecodedOperand* operand = &item->operands[i];
+        if ((operand->type == ZYDIS_OPERAND_TYPE_MEMORY) &&
+            (operand->mem.type != ZYDIS_MEMOP_TYPE_AGEN) &&
+            (operand->actions & ZYDIS_OPERAND_ACTION_MASK_READ))
+        {
+            // Load-to-use latency of the first level cache
+            latency += 4;
+            break;
+        }
+    }
+
+    return latency;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Priority queue                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Inserts a value into the given max-heap.
+ *
+ * @param   heap    A pointer to the heap.
+ * @param   size    A pointer to the number of values in the heap.
+ * @param   value   The value to insert.
+ */
+static void ZydisSchedulerHeapPush(ZyanU64* heap, ZyanUSize* size, ZyanU64 value)
+{
+    ZyanUSize i = (*size)++;
+    while (i)
+    {
+        const ZyanUSize parent = (i - 1) / 2;
+        if (heap[parent] >= value)
+        {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = value;
+}
+
+/**
+ * Removes the largest value from the given max-heap.
+ *
+ * @param   heap    A pointer to the heap.
+ * @param   size    A pointer to the number of values in the heap. Must not be `0`.
+ *
+ * @return  The largest value.
+ */
+static ZyanU64 ZydisSchedulerHeapPop(ZyanU64* heap, ZyanUSize* size)
+{
+    ZYAN_ASSERT(*size);
+
+    const ZyanU64 result = heap[0];
+    const ZyanU64 value = heap[--(*size)];
+    ZyanUSize i = 0;
+    for (;;)
+    {
+        ZyanUSize child = 2 * i + 1;
+        if (child >= *size)
+        {
+            break;
+        }
+        if ((child + 1 < *size) && (heap[child + 1] > heap[child]))
+        {
+            ++child;
+        }
+        if (value >= heap[child])
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = value;
+
+    return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+ZyanStatus ZydisSchedulerGetWorkspaceSize(ZyanUSize count, ZyanUSize* size)
+{
+    if (!size || (count > ZYDIS_SCHEDULER_MAX_INSTRUCTION_COUNT))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanUSize row_length = (count + 63) / 64;
+    *size =
+        (count + ZYDIS_SCHEDULER_RESOURCE_COUNT) * row_length * sizeof(ZyanU64) + // Matrices
+        2 * count * sizeof(ZyanU64) +                                           // Queues
+        5 * count * sizeof(ZyanU32) +                                           // Node data
+        2 * ZYDIS_SCHEDULER_RESOURCE_COUNT * sizeof(ZyanU32);                   // Resource data
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSchedulerInit(ZydisScheduler* scheduler,
+    const ZydisSchedulerInstruction* instructions, ZyanUSize count, void* workspace,
+    ZyanUSize workspace_size)
+{
+    if (!scheduler || (!instructions && count) || !workspace || ((ZyanUPointer)workspace & 7))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanUSize required_size;
+    ZYAN_CHECK(ZydisSchedulerGetWorkspaceSize(count, &required_size));
+    if (workspace_size < required_size)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    const ZyanUSize row_length = (count + 63) / 64;
+    ZYAN_MEMSET(workspace, 0, required_size);
+
+    ZyanU64* readers;
+    ZyanU32* last_writer;
+    ZyanU32* first_reader;
+    scheduler->instructions       = instructions;
+    scheduler->count              = count;
+    scheduler->row_length         = row_length;
+    scheduler->successors         = (ZyanU64*)workspace;
+    readers                       = scheduler->successors + count * row_length;
+    scheduler->queue              = readers + ZYDIS_SCHEDULER_RESOURCE_COUNT * row_length;
+    scheduler->predecessor_count  = (ZyanU32*)(scheduler->queue + 2 * count);
+    scheduler->latency            = scheduler->predecessor_count + count;
+    scheduler->priority           = scheduler->latency + count;
+    scheduler->scratch            = scheduler->priority + count;
+    last_writer                   = scheduler->scratch + 2 * count;
+    first_reader                  = last_writer + ZYDIS_SCHEDULER_RESOURCE_COUNT;
+
+    for (ZyanUSize i = 0; i < ZYDIS_SCHEDULER_RESOURCE_COUNT; ++i)
+    {
+        last_writer[i] = ZYDIS_SCHEDULER_NONE;
+        first_reader[i] = ZYDIS_SCHEDULER_NONE;
+    }
+
+    ZydisSchedulerAccesses accesses;
+    ZyanUSize last_barrier = ZYDIS_SCHEDULER_NONE;
+    for (ZyanUSize j = 0; j < count; ++j)
+    {
+        const ZydisSchedulerInstruction* item = &instructions[j];
+        if ((item->instruction.operand_count > ZYDIS_MAX_OPERAND_COUNT) ||
+            !item->instruction.cpu_flags || !item->instruction.fpu_flags)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+
+        scheduler->latency[j] = ZydisSchedulerGetLatency(item);
+
+        if (ZydisSchedulerIsBarrier(&item->instruction))
+        {
+            const ZyanUSize first = (last_barrier == ZYDIS_SCHEDULER_NONE) ? 0 : last_barrier;
+            for (ZyanUSize i = first; i < j; ++i)
+            {
+                ZydisSchedulerAddEdge(scheduler, i, j);
+            }
+            last_barrier = j;
+            // The resources accessed by the barrier itself don't need to be tracked, as all
+            // following instructions depend on it anyways
+            continue;
+        }
+        if (last_barrier != ZYDIS_SCHEDULER_NONE)
+        {
+            ZydisSchedulerAddEdge(scheduler, last_barrier, j);
+        }
+
+        ZydisSchedulerCollectAccesses(item, &accesses);
+
+        // Read after write
+        for (ZyanUSize k = 0; k < accesses.read_count; ++k)
+        {
+            const ZyanU32 writer = last_writer[accesses.reads[k]];
+            if ((writer != ZYDIS_SCHEDULER_NONE) &&
+                ((last_barrier == ZYDIS_SCHEDULER_NONE) || (writer > last_barrier)))
+            {
+                ZydisSchedulerAddEdge(scheduler, writer, j);
+            }
+        }
+
+        // Write after write and write after read
+        for (ZyanUSize k = 0; k < accesses.write_count; ++k)
+        {
+            const ZyanU16 resource = accesses.writes[k];
+            const ZyanU32 writer = last_writer[resource];
+            if ((writer != ZYDIS_SCHEDULER_NONE) && (writer != j) &&
+                ((last_barrier == ZYDIS_SCHEDULER_NONE) || (writer > last_barrier)))
+            {
+                ZydisSchedulerAddEdge(scheduler, writer, j);
+            }
+            last_writer[resource] = (ZyanU32)j;
+
+            if (first_reader[resource] == ZYDIS_SCHEDULER_NONE)
+            {
+                continue;
+            }
+            // Readers are added in ascending order, so only the words between the first reader
+            // and the current instruction have to be visited
+            ZyanU64* row = &readers[resource * row_length];
+            for (ZyanUSize w = first_reader[resource] >> 6; w <= (j >> 6); ++w)
+            {
+                ZyanU64 bits = row[w];
+                row[w] = 0;
+                while (bits)
+                {
+                    const ZyanUSize i = w * 64 + ZydisSchedulerFindLowestBit(bits);
+                    bits &= bits - 1;
+                    if ((i != j) && ((last_barrier == ZYDIS_SCHEDULER_NONE) || (i > last_barrier)))
+                    {
+                        ZydisSchedulerAddEdge(scheduler, i, j);
+                    }
+                }
+            }
+            first_reader[resource] = ZYDIS_SCHEDULER_NONE;
+        }
+
+        for (ZyanUSize k = 0; k < accesses.read_count; ++k)
+        {
+            const ZyanU16 resource = accesses.reads[k];
+            if (last_writer[resource] != j)
+            {
+                readers[resource * row_length + (j >> 6)] |= 1ULL << (j & 63);
+                if (first_reader[resource] == ZYDIS_SCHEDULER_NONE)
+                {
+                    first_reader[resource] = (ZyanU32)j;
+                }
+            }
+        }
+    }
+
+    // Latency-weighted length of the longest path to the end of the block. All edges point
+    // forward, so a single backwards pass is sufficient.
+    for (ZyanUSize i = count; i-- > 0; )
+    {
+        const ZyanU64* row = &scheduler->successors[i * row_length];
+        ZyanU32 longest = 0;
+        for (ZyanUSize w = (i + 1) >> 6; w < row_length; ++w)
+        {
+            ZyanU64 bits = row[w];
+            while (bits)
+            {
+                const ZyanUSize j = w * 64 + ZydisSchedulerFindLowestBit(bits);
+                bits &= bits - 1;
+                if (scheduler->priority[j] > longest)
+                {
+                    longest = scheduler->priority[j];
+                }
+            }
+        }
+        scheduler->priority[i] = scheduler->latency[i] + longest;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSchedulerHasDependency(const ZydisScheduler* scheduler, ZyanUSize from,
+    ZyanUSize to)
+{
+    if (!scheduler || (from >= scheduler->count) || (to >= scheduler->count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU64 word = scheduler->successors[from * scheduler->row_length + (to >> 6)];
+    return ((word >> (to & 63)) & 1) ? ZYAN_STATUS_TRUE : ZYAN_STATUS_FALSE;
+}
+
+ZyanStatus ZydisSchedulerSchedule(ZydisScheduler* scheduler, ZyanU32* order)
+{
+    if (!scheduler || (!order && scheduler->count))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanUSize count = scheduler->count;
+    ZyanU32* remaining = scheduler->scratch;
+    ZyanU32* ready_time = scheduler->scratch + count;
+    // Instructions whose operands are available, ordered by priority and original position
+    ZyanU64* available = scheduler->queue;
+    ZyanUSize available_size = 0;
+    // Instructions without unscheduled predecessors, ordered by the cycle their operands become
+    // available
+    ZyanU64* pending = scheduler->queue + count;
+    ZyanUSize pending_size = 0;
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        remaining[i] = scheduler->predecessor_count[i];
+        ready_time[i] = 0;
+        if (!remaining[i])
+        {
+            ZydisSchedulerHeapPush(available, &available_size,
+                ((ZyanU64)scheduler->priority[i] << 32) | (ZyanU32)~i);
+        }
+    }
+
+    ZyanU32 cycle = 0;
+    for (ZyanUSize k = 0; k < count; ++k)
+    {
+        if (!available_size || (pending_size && ((ZyanU32)~(pending[0] >> 32) <= cycle)))
+        {
+            if (!available_size && ((ZyanU32)~(pending[0] >> 32) > cycle))
+            {
+                // Stall until the next instruction becomes ready
+                cycle = (ZyanU32)~(pending[0] >> 32);
+            }
+            while (pending_size && ((ZyanU32)~(pending[0] >> 32) <= cycle))
+            {
+                const ZyanU32 i = ~(ZyanU32)ZydisSchedulerHeapPop(pending, &pending_size);
+                ZydisSchedulerHeapPush(available, &available_size,
+                    ((ZyanU64)scheduler->priority[i] << 32) | (ZyanU32)~i);
+            }
+        }
+
+        ZYAN_ASSERT(available_size);
+        const ZyanU32 i = ~(ZyanU32)ZydisSchedulerHeapPop(available, &available_size);
+        order[k] = i;
+
+        const ZyanU32 finish = cycle + scheduler->latency[i];
+        const ZyanU64* row = &scheduler->successors[i * scheduler->row_length];
+        for (ZyanUSize w = (i + 1) >> 6; w < scheduler->row_length; ++w)
+        {
+            ZyanU64 bits = row[w];
+            while (bits)
+            {
+                const ZyanU32 j = (ZyanU32)(w * 64 + ZydisSchedulerFindLowestBit(bits));
+                bits &= bits - 1;
+                if (ready_time[j] < finish)
+                {
+                    ready_time[j] = finish;
+                }
+                if (!--remaining[j])
+                {
+                    ZydisSchedulerHeapPush(pending, &pending_size,
+                        ((ZyanU64)(ZyanU32)~ready_time[j] << 32) | (ZyanU32)~j);
+                }
+            }
+        }
+
+        ++cycle;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSchedulerEmit(const ZydisScheduler* scheduler, const ZyanU32* order,
+    ZyanU64 runtime_address, void* buffer, ZyanUSize* length)
+{
+    if (!scheduler || (!order && scheduler->count) || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU8* output = (ZyanU8*)buffer;
+    ZyanUSize offset = 0;
+    for (ZyanUSize k = 0; k < scheduler->count; ++k)
+    {
+        if (order[k] >= scheduler->count)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+
+        const ZydisSchedulerInstruction* item = &scheduler->instructions[order[k]];
+        const ZydisDecodedInstruction* instruction = &item->instruction;
+
+        ZydisEncoderRequest request;
+        ZYAN_CHECK(ZydisEncoderDecodedInstructionToEncoderRequest(instruction, item->operands,
+            instruction->operand_count_visible, &request));
+
+        ZyanUSize instruction_length = *length - offset;
+        if (instruction->attributes & ZYDIS_ATTRIB_IS_RELATIVE)
+        {
+            // The absolute encoder expects absolute addresses in place of relative operands
+            for (ZyanU8 i = 0; i < instruction->operand_count_visible; ++i)
+            {
+                const ZydisDecodedOperand* operand = &item->operands[i];
+                ZyanU64 address;
+                switch (operand->type)
+                {
+                case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                    if (!operand->imm.is_relative)
+                    {
+                        break;
+                    }
+                    ZYAN_CHECK(ZydisCalcAbsoluteAddress(instruction, operand,
+                        item->runtime_address, &address));
+                    request.operands[i].imm.u = address;
+                    if (request.branch_type != ZYDIS_BRANCH_TYPE_FAR)
+                    {
+                        // Let the encoder pick the smallest branch width that reaches the target
+                        request.branch_type = ZYDIS_BRANCH_TYPE_NONE;
+                        request.branch_width = ZYDIS_BRANCH_WIDTH_NONE;
+                    }
+                    break;
+                case ZYDIS_OPERAND_TYPE_MEMORY:
+                    if ((operand->mem.base != ZYDIS_REGISTER_EIP) &&
+                        (operand->mem.base != ZYDIS_REGISTER_RIP))
+                    {
+                        break;
+                    }
+                    ZYAN_CHECK(ZydisCalcAbsoluteAddress(instruction, operand,
+                        item->runtime_address, &address));
+                    request.operands[i].mem.displacement = (ZyanI64)address;
+                    break;
+                default:
+                    break;
+                }
+            }
+            ZYAN_CHECK(ZydisEncoderEncodeInstructionAbsolute(&request, output + offset,
+                &instruction_length, runtime_address + offset));
+        }
+        else
+        {
+            ZYAN_CHECK(ZydisEncoderEncodeInstruction(&request, output + offset,
+                &instruction_length));
+        }
+
+        offset += instruction_length;
+    }
+
+    *length = offset;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ============================================================================================== */
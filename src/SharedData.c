@@ -59,6 +59,10 @@
 /* Accessed CPU flags                                                                             */
 /* ---------------------------------------------------------------------------------------------- */
 
+#ifndef ZYDIS_MINIMAL_MODE
+// `ACCESSED_FLAGS` has internal linkage, so it can't be pre-declared in `DataTables.c`
+ZYDIS_TABLE_SECTION
+#endif
 #include <Generated/AccessedFlags.inc>
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -103,6 +107,63 @@ void ZydisGetInstructionDefinition(ZydisInstructionEncoding encoding, ZyanU16 id
     }
 }
 
+ZyanU16 ZydisGetInstructionDefinitionCount(ZydisInstructionEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_LEGACY);
+    case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_3DNOW);
+    case ZYDIS_INSTRUCTION_ENCODING_XOP:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_XOP);
+    case ZYDIS_INSTRUCTION_ENCODING_VEX:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_VEX);
+#ifndef ZYDIS_DISABLE_AVX512
+    case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_EVEX);
+#endif
+#ifndef ZYDIS_DISABLE_KNC
+    case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+        return ZYAN_ARRAY_LENGTH(ISTR_DEFINITIONS_MVEX);
+#endif
+    default:
+        return 0;
+    }
+}
+
+ZyanU16 ZydisGetInstructionDefinitionId(ZydisInstructionEncoding encoding,
+    const ZydisInstructionDefinition* definition)
+{
+    switch (encoding)
+    {
+    case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+        return (ZyanU16)((const ZydisInstructionDefinitionLEGACY*)definition -
+            ISTR_DEFINITIONS_LEGACY);
+    case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+        return (ZyanU16)((const ZydisInstructionDefinition3DNOW*)definition -
+            ISTR_DEFINITIONS_3DNOW);
+    case ZYDIS_INSTRUCTION_ENCODING_XOP:
+        return (ZyanU16)((const ZydisInstructionDefinitionXOP*)definition -
+            ISTR_DEFINITIONS_XOP);
+    case ZYDIS_INSTRUCTION_ENCODING_VEX:
+        return (ZyanU16)((const ZydisInstructionDefinitionVEX*)definition -
+            ISTR_DEFINITIONS_VEX);
+#ifndef ZYDIS_DISABLE_AVX512
+    case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+        return (ZyanU16)((const ZydisInstructionDefinitionEVEX*)definition -
+            ISTR_DEFINITIONS_EVEX);
+#endif
+#ifndef ZYDIS_DISABLE_KNC
+    case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+        return (ZyanU16)((const ZydisInstructionDefinitionMVEX*)definition -
+            ISTR_DEFINITIONS_MVEX);
+#endif
+    default:
+        ZYAN_UNREACHABLE;
+    }
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 /* Operand definition                                                                             */
 /* ---------------------------------------------------------------------------------------------- */
@@ -0,0 +1,325 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Sink.h>
+
+#if defined(ZYAN_POSIX) && !defined(ZYAN_NO_LIBC)
+#   include <errno.h>
+#   include <unistd.h>
+#endif
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Flush functions                                                                                */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifndef ZYAN_NO_LIBC
+
+/**
+ * Writes the pending data of a `FILE` sink.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   data    A pointer to the pending data.
+ * @param   length  The length of the pending data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisSinkFlushFile(ZydisSink* sink, const char* data, ZyanUSize length)
+{
+    ZYAN_ASSERT(sink);
+    ZYAN_ASSERT(sink->user_data);
+
+    if (ZYAN_FWRITE(data, 1, length, (ZYAN_FILE*)sink->user_data) != length)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+#endif
+
+#if defined(ZYAN_POSIX) && !defined(ZYAN_NO_LIBC)
+
+/**
+ * Writes the pending data of a file descriptor sink.
+ *
+ * @param   sink    A pointer to the `ZydisSink` instance.
+ * @param   data    A pointer to the pending data.
+ * @param   length  The length of the pending data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisSinkFlushFd(ZydisSink* sink, const char* data, ZyanUSize length)
+{
+    ZYAN_ASSERT(sink);
+
+    const int fd = (int)(ZyanIPointer)sink->user_data;
+    while (length)
+    {
+        const ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return ZYAN_STATUS_BAD_SYSTEMCALL;
+        }
+        data += written;
+        length -= (ZyanUSize)written;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Initialization                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisSinkInit(ZydisSink* sink, char* buffer, ZyanUSize capacity,
+    ZyanUSize threshold, ZydisSinkFlushFunc flush, void* user_data)
+{
+    if (!sink || !buffer || (capacity < ZYDIS_SINK_LINE_LENGTH) || !flush)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    sink->data      = buffer;
+    sink->size      = 0;
+    sink->capacity  = capacity;
+    sink->threshold = threshold;
+    sink->flush     = flush;
+    sink->user_data = user_data;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+#ifndef ZYAN_NO_LIBC
+
+ZyanStatus ZydisSinkInitFile(ZydisSink* sink, char* buffer, ZyanUSize capacity,
+    ZYAN_FILE* file)
+{
+    if (!file)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ZydisSinkInit(sink, buffer, capacity, capacity, &ZydisSinkFlushFile, file);
+}
+
+ZyanStatus ZydisSinkInitMemory(ZydisSink* sink, ZyanUSize capacity)
+{
+    if (!sink)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    capacity = ZYAN_MAX(capacity, ZYDIS_SINK_LINE_LENGTH);
+    sink->data = (char*)ZYAN_MALLOC(capacity);
+    if (!sink->data)
+    {
+        return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+    }
+    sink->size      = 0;
+    sink->capacity  = capacity;
+    sink->threshold = 0;
+    sink->flush     = ZYAN_NULL;
+    sink->user_data = ZYAN_NULL;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+#endif
+
+#if defined(ZYAN_POSIX) && !defined(ZYAN_NO_LIBC)
+
+ZyanStatus ZydisSinkInitFd(ZydisSink* sink, char* buffer, ZyanUSize capacity, int fd)
+{
+    if (fd < 0)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ZydisSinkInit(sink, buffer, capacity, capacity, &ZydisSinkFlushFd,
+        (void*)(ZyanIPointer)fd);
+}
+
+#endif
+
+ZyanStatus ZydisSinkDestroy(ZydisSink* sink)
+{
+    if (!sink)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (!sink->flush)
+    {
+#ifndef ZYAN_NO_LIBC
+        ZYAN_FREE(sink->data);
+#endif
+        sink->data = ZYAN_NULL;
+        sink->size = 0;
+        sink->capacity = 0;
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    return ZydisSinkFlush(sink);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisSinkFlush(ZydisSink* sink)
+{
+    if (!sink)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (sink->flush && sink->size)
+    {
+        ZYAN_CHECK(sink->flush(sink, sink->data, sink->size));
+        sink->size = 0;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSinkReserve(ZydisSink* sink, ZyanUSize length, char** buffer)
+{
+    if (!sink || !buffer)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (sink->capacity - sink->size < length)
+    {
+        if (sink->flush)
+        {
+            ZYAN_CHECK(ZydisSinkFlush(sink));
+            if (sink->capacity < length)
+            {
+                return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+            }
+        }
+        else
+        {
+#ifdef ZYAN_NO_LIBC
+            return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+#else
+            const ZyanUSize capacity = ZYAN_MAX(sink->capacity * 2, sink->size + length);
+            char* const data = (char*)ZYAN_REALLOC(sink->data, capacity);
+            if (!data)
+            {
+                return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+            }
+            sink->data = data;
+            sink->capacity = capacity;
+#endif
+        }
+    }
+
+    *buffer = sink->data + sink->size;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSinkCommit(ZydisSink* sink, ZyanUSize length)
+{
+    if (!sink || (sink->capacity - sink->size < length))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    sink->size += length;
+    if (sink->flush && (sink->size >= sink->threshold))
+    {
+        return ZydisSinkFlush(sink);
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSinkWrite(ZydisSink* sink, const void* data, ZyanUSize length)
+{
+    if (!sink || (length && !data))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if (sink->flush && (length > sink->capacity))
+    {
+        // Bypass the buffer for large writes
+        ZYAN_CHECK(ZydisSinkFlush(sink));
+        return sink->flush(sink, (const char*)data, length);
+    }
+
+    char* buffer;
+    ZYAN_CHECK(ZydisSinkReserve(sink, length, &buffer));
+    ZYAN_MEMCPY(buffer, data, length);
+
+    return ZydisSinkCommit(sink, length);
+}
+
+ZyanStatus ZydisSinkFormatInstruction(ZydisSink* sink, const ZydisFormatter* formatter,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    ZyanU8 operand_count, ZyanU64 runtime_address, void* user_data)
+{
+    if (!sink)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    // Format into all remaining space, but keep one byte for the newline that replaces the
+    // terminating zero
+    char* buffer;
+    ZYAN_CHECK(ZydisSinkReserve(sink, ZYDIS_SINK_LINE_LENGTH, &buffer));
+    ZYAN_CHECK(ZydisFormatterFormatInstruction(formatter, instruction, operands, operand_count,
+        buffer, sink->capacity - sink->size - 1, runtime_address, user_data));
+
+    const ZyanUSize length = ZYAN_STRLEN(buffer);
+    buffer[length] = '\n';
+
+    return ZydisSinkCommit(sink, length + 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
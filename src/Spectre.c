@@ -0,0 +1,507 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Spectre.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The instruction reads memory.
+ */
+#define ZYDIS_SPECTRE_FLAG_LOAD             0x01
+/**
+ * The instruction modifies the CPU flags.
+ */
+#define ZYDIS_SPECTRE_FLAG_WRITES_FLAGS     0x02
+/**
+ * The instruction ends speculative execution along the current path.
+ */
+#define ZYDIS_SPECTRE_FLAG_STOP             0x04
+/**
+ * The instruction is a relative jump into the buffer.
+ */
+#define ZYDIS_SPECTRE_FLAG_JUMP             0x08
+/**
+ * The instruction is a relational conditional branch, as used by bounds checks.
+ */
+#define ZYDIS_SPECTRE_FLAG_BOUNDS_CHECK     0x10
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Instruction summary                                                                            */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the id of the general purpose register that encloses the given register.
+ *
+ * @param   machine_mode    The machine mode.
+ * @param   reg             The register.
+ *
+ * @return  The register id or `-1`, if the register is not a general purpose register.
+ */
+static ZyanI8 ZydisSpectreGetRegisterId(ZydisMachineMode machine_mode, ZydisRegister reg)
+{
+    if (reg == ZYDIS_REGISTER_NONE)
+    {
+        return -1;
+    }
+
+    const ZydisRegister enclosing = ZydisRegisterGetLargestEnclosing(machine_mode, reg);
+    switch (ZydisRegisterGetClass(enclosing))
+    {
+    case ZYDIS_REGCLASS_GPR16:
+    case ZYDIS_REGCLASS_GPR32:
+    case ZYDIS_REGCLASS_GPR64:
+        return ZydisRegisterGetId(enclosing);
+    default:
+        return -1;
+    }
+}
+
+/**
+ * Returns the register mask bit of the given register.
+ *
+ * @param   machine_mode    The machine mode.
+ * @param   reg             The register.
+ *
+ * @return  The register mask bit or `0`, if the register is not a general purpose register.
+ */
+static ZyanU16 ZydisSpectreGetRegisterBit(ZydisMachineMode machine_mode, ZydisRegister reg)
+{
+    const ZyanI8 id = ZydisSpectreGetRegisterId(machine_mode, reg);
+    return (id >= 0) ? (ZyanU16)(1 << id) : 0;
+}
+
+/**
+ * Checks if the given conditional branch is a signed or unsigned relational comparison.
+ *
+ * @param   mnemonic    The mnemonic of the branch.
+ *
+ * @return  `ZYAN_TRUE`, if the branch can implement a bounds check or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisSpectreIsBoundsCheck(ZydisMnemonic mnemonic)
+{
+    switch (mnemonic)
+    {
+    case ZYDIS_MNEMONIC_JB:
+    case ZYDIS_MNEMONIC_JBE:
+    case ZYDIS_MNEMONIC_JL:
+    case ZYDIS_MNEMONIC_JLE:
+    case ZYDIS_MNEMONIC_JNB:
+    case ZYDIS_MNEMONIC_JNBE:
+    case ZYDIS_MNEMONIC_JNL:
+    case ZYDIS_MNEMONIC_JNLE:
+        return ZYAN_TRUE;
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Checks if the given instruction ends speculative execution along the current path.
+ *
+ * @param   instruction A pointer to the `ZydisDecodedInstruction` struct.
+ *
+ * @return  `ZYAN_TRUE`, if the path ends or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisSpectreIsStop(const ZydisDecodedInstruction* instruction)
+{
+    switch (instruction->meta.category)
+    {
+    case ZYDIS_CATEGORY_CALL:
+    case ZYDIS_CATEGORY_RET:
+    case ZYDIS_CATEGORY_SYSCALL:
+    case ZYDIS_CATEGORY_SYSRET:
+    case ZYDIS_CATEGORY_INTERRUPT:
+        return ZYAN_TRUE;
+    default:
+        break;
+    }
+
+    switch (instruction->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_LFENCE:
+    case ZYDIS_MNEMONIC_CPUID:
+    case ZYDIS_MNEMONIC_SERIALIZE:
+    case ZYDIS_MNEMONIC_HLT:
+    case ZYDIS_MNEMONIC_UD0:
+    case ZYDIS_MNEMONIC_UD1:
+    case ZYDIS_MNEMONIC_UD2:
+        return ZYAN_TRUE;
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/**
+ * Decodes the instruction at the given offset and summarizes its register and memory accesses.
+ *
+ * @param   scanner         A pointer to the `ZydisSpectreScanner` instance.
+ * @param   data            A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the code.
+ * @param   offset          The offset of the instruction.
+ * @param   entry           Receives the summary.
+ */
+static void ZydisSpectreSummarize(const ZydisSpectreScanner* scanner, const ZyanU8* data,
+    ZyanUSize length, ZyanU64 runtime_address, ZyanUSize offset, ZydisSpectreArenaEntry* entry)
+{
+    entry->offset = (ZyanU32)offset;
+    entry->target = ZYAN_UINT32_MAX;
+    entry->read = 0;
+    entry->write = 0;
+    entry->address = 0;
+    entry->length = 0;
+    entry->flags = ZYDIS_SPECTRE_FLAG_STOP;
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&scanner->decoder, &context, data + offset,
+            length - offset, &instruction)) ||
+        !ZYAN_SUCCESS(ZydisDecoderDecodeOperands(&scanner->decoder, &context, &instruction,
+            operands, instruction.operand_count)))
+    {
+        return;
+    }
+
+    entry->length = instruction.length;
+    entry->flags = 0;
+
+    const ZydisMachineMode machine_mode = instruction.machine_mode;
+    for (ZyanU8 i = 0; i < instruction.operand_count; ++i)
+    {
+        const ZydisDecodedOperand* operand = &operands[i];
+        switch (operand->type)
+        {
+        case ZYDIS_OPERAND_TYPE_REGISTER:
+        {
+            const ZyanU16 bit = ZydisSpectreGetRegisterBit(machine_mode, operand->reg.value);
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_READ)
+            {
+                entry->read |= bit;
+            }
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_WRITE)
+            {
+                entry->write |= bit;
+                // Partial writes merge with the previous register value
+                if ((operand->size < 32) || (operand->actions & ZYDIS_OPERAND_ACTION_CONDWRITE))
+                {
+                    entry->read |= bit;
+                }
+            }
+            break;
+        }
+        case ZYDIS_OPERAND_TYPE_MEMORY:
+        {
+            const ZyanU16 bits =
+                ZydisSpectreGetRegisterBit(machine_mode, operand->mem.base) |
+                ZydisSpectreGetRegisterBit(machine_mode, operand->mem.index);
+            if (operand->mem.type == ZYDIS_MEMOP_TYPE_AGEN)
+            {
+                entry->read |= bits;
+            }
+            else if ((operand->mem.type == ZYDIS_MEMOP_TYPE_MEM) &&
+                (operand->actions & ZYDIS_OPERAND_ACTION_MASK_READ))
+            {
+                entry->flags |= ZYDIS_SPECTRE_FLAG_LOAD;
+                entry->address |= bits;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (instruction.cpu_flags && (instruction.cpu_flags->modified |
+        instruction.cpu_flags->set_0 | instruction.cpu_flags->set_1))
+    {
+        entry->flags |= ZYDIS_SPECTRE_FLAG_WRITES_FLAGS;
+    }
+
+    if (ZydisSpectreIsStop(&instruction))
+    {
+        entry->flags |= ZYDIS_SPECTRE_FLAG_STOP;
+        return;
+    }
+
+    if ((instruction.meta.category == ZYDIS_CATEGORY_COND_BR) ||
+        (instruction.meta.category == ZYDIS_CATEGORY_UNCOND_BR))
+    {
+        ZyanU64 target = ZYAN_UINT64_MAX;
+        if (instruction.raw.imm[0].is_relative)
+        {
+            target = runtime_address + offset + instruction.length +
+                instruction.raw.imm[0].value.s;
+            if (machine_mode != ZYDIS_MACHINE_MODE_LONG_64)
+            {
+                target &= (instruction.operand_width == 16) ? 0xFFFF : 0xFFFFFFFF;
+            }
+            target -= runtime_address;
+        }
+        const ZyanBool is_inside = (target < length);
+        if (is_inside)
+        {
+            entry->target = (ZyanU32)target;
+        }
+
+        if (instruction.meta.category == ZYDIS_CATEGORY_UNCOND_BR)
+        {
+            entry->flags |= is_inside ? ZYDIS_SPECTRE_FLAG_JUMP : ZYDIS_SPECTRE_FLAG_STOP;
+        }
+        else if (ZydisSpectreIsBoundsCheck(instruction.mnemonic))
+        {
+            entry->flags |= ZYDIS_SPECTRE_FLAG_BOUNDS_CHECK;
+        }
+    }
+}
+
+/**
+ * Returns the summary of the instruction at the given offset, decoding it if required.
+ *
+ * @param   scanner         A pointer to the `ZydisSpectreScanner` instance.
+ * @param   arena           A pointer to the `ZydisSpectreArena` instance.
+ * @param   data            A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the code.
+ * @param   offset          The offset of the instruction.
+ *
+ * @return  A pointer to the summary.
+ */
+static const ZydisSpectreArenaEntry* ZydisSpectreLookup(const ZydisSpectreScanner* scanner,
+    ZydisSpectreArena* arena, const ZyanU8* data, ZyanUSize length, ZyanU64 runtime_address,
+    ZyanUSize offset)
+{
+    ZydisSpectreArenaEntry* entry =
+        &arena->entries[offset & (ZYDIS_SPECTRE_ARENA_ENTRY_COUNT - 1)];
+    if ((entry->generation != arena->generation) || (entry->offset != offset))
+    {
+        ZydisSpectreSummarize(scanner, data, length, runtime_address, offset, entry);
+        entry->generation = arena->generation;
+    }
+    return entry;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Taint tracking                                                                                 */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Follows a single path of a conditional branch.
+ *
+ * @param   scanner         A pointer to the `ZydisSpectreScanner` instance.
+ * @param   arena           A pointer to the `ZydisSpectreArena` instance.
+ * @param   data            A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the code.
+ * @param   gadget          A pointer to the `ZydisSpectreGadget` struct with the `branch` and
+ *                          `is_taken` fields set.
+ * @param   offset          The offset of the first instruction on the path.
+ * @param   controlled      The attacker-controlled registers.
+ * @param   callback        The callback.
+ * @param   user_data       A pointer to user-defined data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisSpectreFollowPath(const ZydisSpectreScanner* scanner,
+    ZydisSpectreArena* arena, const ZyanU8* data, ZyanUSize length, ZyanU64 runtime_address,
+    ZydisSpectreGadget* gadget, ZyanUSize offset, ZyanU16 controlled,
+    ZydisSpectreCallback callback, void* user_data)
+{
+    ZyanU16 secret = 0;
+    ZyanU64 origin[16];
+
+    for (ZyanU32 i = 0; (i < scanner->window) && (offset < length); ++i)
+    {
+        const ZydisSpectreArenaEntry* entry =
+            ZydisSpectreLookup(scanner, arena, data, length, runtime_address, offset);
+        if (entry->flags & ZYDIS_SPECTRE_FLAG_STOP)
+        {
+            break;
+        }
+
+        const ZyanU64 address = runtime_address + offset;
+        const ZyanBool is_load = (entry->flags & ZYDIS_SPECTRE_FLAG_LOAD) ? ZYAN_TRUE : ZYAN_FALSE;
+        if (is_load && (entry->address & secret))
+        {
+            ZyanU8 id = 0;
+            while (!((entry->address & secret) & (1 << id)))
+            {
+                ++id;
+            }
+            gadget->load = origin[id];
+            gadget->dependent_load = address;
+            return callback(gadget, user_data);
+        }
+
+        const ZyanU16 secret_inputs = entry->read & secret;
+        if (secret_inputs || (is_load && (entry->address & controlled)))
+        {
+            ZyanU64 source = address;
+            if (secret_inputs)
+            {
+                ZyanU8 id = 0;
+                while (!(secret_inputs & (1 << id)))
+                {
+                    ++id;
+                }
+                source = origin[id];
+            }
+            for (ZyanU8 id = 0; id < 16; ++id)
+            {
+                if (entry->write & (1 << id))
+                {
+                    origin[id] = source;
+                }
+            }
+            secret |= entry->write;
+            controlled &= ~entry->write;
+        }
+        else if (entry->read & controlled)
+        {
+            controlled |= entry->write;
+            secret &= ~entry->write;
+        }
+        else
+        {
+            controlled &= ~entry->write;
+            secret &= ~entry->write;
+        }
+
+        if (!controlled && !secret)
+        {
+            break;
+        }
+
+        offset = (entry->flags & ZYDIS_SPECTRE_FLAG_JUMP) ? entry->target : offset + entry->length;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+ZyanStatus ZydisSpectreScannerInit(ZydisSpectreScanner* scanner, ZydisMachineMode machine_mode,
+    ZydisStackWidth stack_width, ZyanU32 window)
+{
+    if (!scanner || !window)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisDecoderInit(&scanner->decoder, machine_mode, stack_width));
+    scanner->window = window;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSpectreArenaInit(ZydisSpectreArena* arena)
+{
+    if (!arena)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_MEMSET(arena, 0, sizeof(*arena));
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisSpectreScan(const ZydisSpectreScanner* scanner, ZydisSpectreArena* arena,
+    const void* buffer, ZyanUSize length, ZyanU64 runtime_address, ZyanUSize begin,
+    ZyanUSize end, ZydisSpectreCallback callback, void* user_data)
+{
+    if (!scanner || !arena || (!buffer && length) || (begin > end) || (end > length) ||
+        (length > ZYAN_UINT32_MAX) || !callback)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    // Invalidate all entries of the previous scan
+    if (!++arena->generation)
+    {
+        ZYAN_MEMSET(arena->entries, 0, sizeof(arena->entries));
+        arena->generation = 1;
+    }
+
+    const ZyanU8* data = (const ZyanU8*)buffer;
+    ZyanU16 checked = 0;
+    ZyanUSize offset = begin;
+    while (offset < end)
+    {
+        const ZydisSpectreArenaEntry* entry =
+            ZydisSpectreLookup(scanner, arena, data, length, runtime_address, offset);
+        if (!entry->length)
+        {
+            checked = 0;
+            ++offset;
+            continue;
+        }
+
+        if ((entry->flags & ZYDIS_SPECTRE_FLAG_BOUNDS_CHECK) && checked)
+        {
+            // Copy the summary, as following the paths may evict the entry
+            const ZyanUSize next = offset + entry->length;
+            const ZyanU32 target = entry->target;
+
+            ZydisSpectreGadget gadget;
+            gadget.branch = runtime_address + offset;
+            gadget.is_taken = ZYAN_FALSE;
+            ZYAN_CHECK(ZydisSpectreFollowPath(scanner, arena, data, length, runtime_address,
+                &gadget, next, checked, callback, user_data));
+            if (target != ZYAN_UINT32_MAX)
+            {
+                gadget.is_taken = ZYAN_TRUE;
+                ZYAN_CHECK(ZydisSpectreFollowPath(scanner, arena, data, length,
+                    runtime_address, &gadget, target, checked, callback, user_data));
+            }
+
+            offset = next;
+            continue;
+        }
+
+        if (entry->flags & ZYDIS_SPECTRE_FLAG_WRITES_FLAGS)
+        {
+            checked = entry->read;
+        }
+        offset += entry->length;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ============================================================================================== */
@@ -24,6 +24,7 @@
 
 ***************************************************************************************************/
 
+#include <Zydis/Internal/InternalTests.h>
 #include <Zydis/Internal/String.h>
 
 /* ============================================================================================== */
@@ -231,8 +232,8 @@ static ZyanStatus ZydisStringAppendHexU32(ZyanString* string, ZyanU32 value, Zya
 }
 #endif
 
-static ZyanStatus ZydisStringAppendHexU64(ZyanString* string, ZyanU64 value, ZyanU8 padding_length,
-    ZyanBool force_leading_number, ZyanBool uppercase)
+ZYDIS_INTERNAL_STATIC ZyanStatus ZydisStringAppendHexU64(ZyanString* string, ZyanU64 value,
+    ZyanU8 padding_length, ZyanBool force_leading_number, ZyanBool uppercase)
 {
     ZYAN_ASSERT(string);
     ZYAN_ASSERT(!string->vector.allocator);
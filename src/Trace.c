@@ -0,0 +1,1200 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Trace.h>
+#include <Zydis/Utils.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Constants                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The format version.
+ */
+#define ZYDIS_TRACE_VERSION             1
+
+/**
+ * The size of the file header.
+ */
+#define ZYDIS_TRACE_HEADER_SIZE         8
+
+/**
+ * The size of the file trailer.
+ */
+#define ZYDIS_TRACE_TRAILER_SIZE        24
+
+/**
+ * The size of a segment header.
+ */
+#define ZYDIS_TRACE_SEGMENT_HEADER_SIZE 20
+
+/**
+ * The size of a serialized dictionary entry without the instruction bytes.
+ */
+#define ZYDIS_TRACE_ENTRY_SIZE          27
+
+/**
+ * The capacity of the event stream of a segment.
+ */
+#define ZYDIS_TRACE_EVENTS_SIZE         0x8000
+
+/**
+ * The capacity of the branch stream of a segment. Every instruction consumes at most one bit.
+ */
+#define ZYDIS_TRACE_BITS_SIZE           (ZYDIS_TRACE_SEGMENT_LENGTH / 8)
+
+/**
+ * The capacity of the target stream of a segment.
+ */
+#define ZYDIS_TRACE_TARGETS_SIZE        0x10000
+
+/**
+ * The capacity of the memory stream of a segment.
+ */
+#define ZYDIS_TRACE_MEMORY_SIZE         0x40000
+
+/**
+ * The maximum length of an encoded event (index delta and entry id).
+ */
+#define ZYDIS_TRACE_MAX_EVENT_LENGTH    8
+
+/**
+ * The maximum length of an encoded entry id.
+ */
+#define ZYDIS_TRACE_MAX_TARGET_LENGTH   5
+
+/**
+ * The maximum length of an encoded memory delta.
+ */
+#define ZYDIS_TRACE_MAX_MEMORY_LENGTH   10
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Serialization                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Stores a 32-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the buffer.
+ * @param   value   The value.
+ */
+static void ZydisTraceStoreU32(ZyanU8* buffer, ZyanU32 value)
+{
+    for (ZyanUSize i = 0; i < 4; ++i)
+    {
+        buffer[i] = (ZyanU8)(value >> (i * 8));
+    }
+}
+
+/**
+ * Stores a 64-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the buffer.
+ * @param   value   The value.
+ */
+static void ZydisTraceStoreU64(ZyanU8* buffer, ZyanU64 value)
+{
+    for (ZyanUSize i = 0; i < 8; ++i)
+    {
+        buffer[i] = (ZyanU8)(value >> (i * 8));
+    }
+}
+
+/**
+ * Loads a 32-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the buffer.
+ *
+ * @return  The value.
+ */
+static ZyanU32 ZydisTraceLoadU32(const ZyanU8* buffer)
+{
+    ZyanU32 value = 0;
+    for (ZyanUSize i = 0; i < 4; ++i)
+    {
+        value |= (ZyanU32)buffer[i] << (i * 8);
+    }
+    return value;
+}
+
+/**
+ * Loads a 64-bit value in little-endian byte order.
+ *
+ * @param   buffer  A pointer to the buffer.
+ *
+ * @return  The value.
+ */
+static ZyanU64 ZydisTraceLoadU64(const ZyanU8* buffer)
+{
+    ZyanU64 value = 0;
+    for (ZyanUSize i = 0; i < 8; ++i)
+    {
+        value |= (ZyanU64)buffer[i] << (i * 8);
+    }
+    return value;
+}
+
+/**
+ * Stores a variable-length integer (LEB128).
+ *
+ * @param   buffer  A pointer to the buffer.
+ * @param   value   The value.
+ *
+ * @return  The number of written bytes.
+ */
+static ZyanUSize ZydisTraceStoreVarint(ZyanU8* buffer, ZyanU64 value)
+{
+    ZyanUSize length = 0;
+    while (value >= 0x80)
+    {
+        buffer[length++] = (ZyanU8)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (ZyanU8)value;
+    return length;
+}
+
+/**
+ * Loads a variable-length integer (LEB128).
+ *
+ * @param   data    A pointer to the read position, which is advanced past the value.
+ * @param   end     The end of the stream.
+ * @param   value   Receives the value.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceLoadVarint(const ZyanU8** data, const ZyanU8* end, ZyanU64* value)
+{
+    const ZyanU8* position = *data;
+    ZyanU64 result = 0;
+    for (ZyanU8 shift = 0; shift < 64; shift += 7)
+    {
+        if (position == end)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+        const ZyanU8 byte = *position++;
+        result |= (ZyanU64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            *data = position;
+            *value = result;
+            return ZYAN_STATUS_SUCCESS;
+        }
+    }
+    return ZYAN_STATUS_INVALID_ARGUMENT;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Control-flow state                                                                             */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Initializes the given `ZydisTraceState` struct.
+ *
+ * @param   state   A pointer to the `ZydisTraceState` struct.
+ */
+static void ZydisTraceStateInit(ZydisTraceState* state)
+{
+    state->previous = ZYDIS_TRACE_NO_ENTRY;
+    state->call     = ZYDIS_TRACE_NO_ENTRY;
+    state->depth    = 0;
+    state->top      = 0;
+}
+
+/**
+ * Updates the control-flow state after an instruction.
+ *
+ * @param   state   A pointer to the `ZydisTraceState` struct.
+ * @param   entry   The entry of the instruction.
+ * @param   flow    The `ZydisTraceFlow` of the instruction.
+ */
+static void ZydisTraceStateUpdate(ZydisTraceState* state, ZyanU32 entry, ZyanU8 flow)
+{
+    state->call = ZYDIS_TRACE_NO_ENTRY;
+    switch (flow)
+    {
+    case ZYDIS_TRACE_FLOW_CALL:
+    case ZYDIS_TRACE_FLOW_INDIRECT_CALL:
+        // The oldest return address is dropped, if the stack is full
+        state->stack[state->top] = entry;
+        state->top = (state->top + 1) % ZYDIS_TRACE_STACK_DEPTH;
+        state->depth = ZYAN_MIN(state->depth + 1, ZYDIS_TRACE_STACK_DEPTH);
+        break;
+    case ZYDIS_TRACE_FLOW_RETURN:
+        if (state->depth)
+        {
+            state->top = (state->top + ZYDIS_TRACE_STACK_DEPTH - 1) % ZYDIS_TRACE_STACK_DEPTH;
+            --state->depth;
+            state->call = state->stack[state->top];
+        }
+        break;
+    default:
+        break;
+    }
+    state->previous = entry;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Encoder                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Returns the number of hash table slots for the given entry capacity.
+ *
+ * @param   entry_capacity  The maximum number of dictionary entries.
+ *
+ * @return  The number of hash table slots.
+ */
+static ZyanUSize ZydisTraceGetTableSize(ZyanU32 entry_capacity)
+{
+    ZyanUSize size = 16;
+    while (size < (ZyanUSize)entry_capacity * 2)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ * Writes data to the output of the encoder.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ * @param   data    A pointer to the data.
+ * @param   length  The length of the data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceEncoderWrite(ZydisTraceEncoder* encoder, const void* data,
+    ZyanUSize length)
+{
+    if (!length)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+    ZYAN_CHECK(encoder->write(encoder->user_data, data, length));
+    encoder->position += length;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Writes the current segment and starts a new one.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceEncoderFlushSegment(ZydisTraceEncoder* encoder)
+{
+    if (!encoder->segment_length)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    ZyanU8* const events  = encoder->segment;
+    ZyanU8* const bits    = events + ZYDIS_TRACE_EVENTS_SIZE;
+    ZyanU8* const targets = bits + ZYDIS_TRACE_BITS_SIZE;
+    ZyanU8* const memory  = targets + ZYDIS_TRACE_TARGETS_SIZE;
+    const ZyanUSize bits_size = (encoder->bit_count + 7) / 8;
+
+    ZyanU8 header[ZYDIS_TRACE_SEGMENT_HEADER_SIZE];
+    ZydisTraceStoreU32(&header[ 0], encoder->segment_length);
+    ZydisTraceStoreU32(&header[ 4], (ZyanU32)encoder->events_size);
+    ZydisTraceStoreU32(&header[ 8], (ZyanU32)encoder->bit_count);
+    ZydisTraceStoreU32(&header[12], (ZyanU32)encoder->targets_size);
+    ZydisTraceStoreU32(&header[16], (ZyanU32)encoder->memory_size);
+    ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, header, sizeof(header)));
+    ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, events, encoder->events_size));
+    ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, bits, bits_size));
+    ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, targets, encoder->targets_size));
+    ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, memory, encoder->memory_size));
+
+    ZYAN_MEMSET(bits, 0, bits_size);
+    encoder->segment_length = 0;
+    encoder->last_event     = 0;
+    encoder->events_size    = 0;
+    encoder->bit_count      = 0;
+    encoder->targets_size   = 0;
+    encoder->memory_size    = 0;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Appends a bit to the branch stream.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ * @param   bit     The bit.
+ */
+static void ZydisTraceEncoderPutBit(ZydisTraceEncoder* encoder, ZyanBool bit)
+{
+    ZyanU8* const bits = encoder->segment + ZYDIS_TRACE_EVENTS_SIZE;
+    bits[encoder->bit_count / 8] |= (ZyanU8)((bit ? 1 : 0) << (encoder->bit_count % 8));
+    ++encoder->bit_count;
+}
+
+/**
+ * Appends an entry id to the target stream.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ * @param   entry   The entry id.
+ */
+static void ZydisTraceEncoderPutTarget(ZydisTraceEncoder* encoder, ZyanU32 entry)
+{
+    ZyanU8* const targets = encoder->segment + ZYDIS_TRACE_EVENTS_SIZE + ZYDIS_TRACE_BITS_SIZE;
+    encoder->targets_size += ZydisTraceStoreVarint(targets + encoder->targets_size, entry);
+}
+
+/**
+ * Checks, if the given entry matches the given instruction bytes.
+ *
+ * @param   entry   A pointer to the `ZydisTraceEntry` struct.
+ * @param   buffer  A pointer to the instruction bytes.
+ * @param   length  The number of available bytes.
+ *
+ * @return  `ZYAN_TRUE`, if the entry matches or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisTraceEntryMatches(const ZydisTraceEntry* entry, const ZyanU8* buffer,
+    ZyanUSize length)
+{
+    return (length >= entry->length) && !ZYAN_MEMCMP(entry->bytes, buffer, entry->length);
+}
+
+/**
+ * Adds a new dictionary entry.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ * @param   address The runtime address of the instruction.
+ * @param   buffer  A pointer to the instruction bytes.
+ * @param   length  The number of available bytes.
+ * @param   entry   Receives the id of the new entry.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceEncoderAddEntry(ZydisTraceEncoder* encoder, ZyanU64 address,
+    const ZyanU8* buffer, ZyanUSize length, ZyanU32* entry)
+{
+    if (encoder->entry_count == encoder->entry_capacity)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    ZYAN_CHECK(ZydisDecoderDecodeFull(&encoder->decoder, buffer, length, &instruction,
+        operands));
+
+    ZydisTraceEntry* const result = &encoder->entries[encoder->entry_count];
+    result->address        = address;
+    result->target_address = 0;
+    result->next           = ZYDIS_TRACE_NO_ENTRY;
+    result->target         = ZYDIS_TRACE_NO_ENTRY;
+    result->length         = instruction.length;
+    result->flow           = ZYDIS_TRACE_FLOW_SEQUENTIAL;
+    result->has_memory     = ZYAN_FALSE;
+    ZYAN_MEMCPY(result->bytes, buffer, instruction.length);
+
+    const ZyanBool is_relative = (instruction.operand_count_visible > 0) &&
+        (operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE) && operands[0].imm.is_relative;
+    switch (instruction.meta.category)
+    {
+    case ZYDIS_CATEGORY_COND_BR:
+        result->flow = is_relative ? ZYDIS_TRACE_FLOW_CONDITIONAL : ZYDIS_TRACE_FLOW_INDIRECT_JUMP;
+        break;
+    case ZYDIS_CATEGORY_UNCOND_BR:
+        result->flow = is_relative ? ZYDIS_TRACE_FLOW_JUMP : ZYDIS_TRACE_FLOW_INDIRECT_JUMP;
+        break;
+    case ZYDIS_CATEGORY_CALL:
+        result->flow = is_relative ? ZYDIS_TRACE_FLOW_CALL : ZYDIS_TRACE_FLOW_INDIRECT_CALL;
+        break;
+    case ZYDIS_CATEGORY_RET:
+        result->flow = ZYDIS_TRACE_FLOW_RETURN;
+        break;
+    default:
+        break;
+    }
+    if (is_relative && (result->flow != ZYDIS_TRACE_FLOW_INDIRECT_JUMP))
+    {
+        ZYAN_CHECK(ZydisCalcAbsoluteAddress(&instruction, &operands[0], address,
+            &result->target_address));
+    }
+
+    for (ZyanU8 i = 0; i < instruction.operand_count_visible; ++i)
+    {
+        if ((operands[i].type == ZYDIS_OPERAND_TYPE_MEMORY) &&
+            ((operands[i].mem.type == ZYDIS_MEMOP_TYPE_MEM) ||
+             (operands[i].mem.type == ZYDIS_MEMOP_TYPE_VSIB)))
+        {
+            result->has_memory = ZYAN_TRUE;
+            break;
+        }
+    }
+
+    encoder->memory[encoder->entry_count] = 0;
+    *entry = encoder->entry_count++;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Returns the dictionary entry for the given instruction and adds it, if required.
+ *
+ * @param   encoder A pointer to the `ZydisTraceEncoder` instance.
+ * @param   address The runtime address of the instruction.
+ * @param   buffer  A pointer to the instruction bytes.
+ * @param   length  The number of available bytes.
+ * @param   entry   Receives the id of the entry.
+ *
+ * @return  A zyan status code.
+ *
+ * Instructions are identified by their address and bytes. If the bytes at an address change
+ * (e.g. because of self-modifying code), a new entry replaces the old one in the hash table.
+ */
+static ZyanStatus ZydisTraceEncoderLookup(ZydisTraceEncoder* encoder, ZyanU64 address,
+    const ZyanU8* buffer, ZyanUSize length, ZyanU32* entry)
+{
+    ZyanU32 slot = (ZyanU32)((address * 0x9E3779B97F4A7C15ULL) >> 32) & encoder->table_mask;
+    while (encoder->table[slot] != ZYDIS_TRACE_NO_ENTRY)
+    {
+        const ZyanU32 candidate = encoder->table[slot];
+        if (encoder->entries[candidate].address == address)
+        {
+            if (ZydisTraceEntryMatches(&encoder->entries[candidate], buffer, length))
+            {
+                *entry = candidate;
+                return ZYAN_STATUS_SUCCESS;
+            }
+            break;
+        }
+        slot = (slot + 1) & encoder->table_mask;
+    }
+
+    ZYAN_CHECK(ZydisTraceEncoderAddEntry(encoder, address, buffer, length, entry));
+    encoder->table[slot] = *entry;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Follows a predicted link of the dictionary.
+ *
+ * @param   encoder     A pointer to the `ZydisTraceEncoder` instance.
+ * @param   link        A pointer to the link.
+ * @param   expected    The address predicted by the link.
+ * @param   address     The runtime address of the instruction.
+ * @param   buffer      A pointer to the instruction bytes.
+ * @param   length      The number of available bytes.
+ * @param   entry       Receives the id of the linked entry or `ZYDIS_TRACE_NO_ENTRY`, if the
+ *                      instruction does not match the prediction.
+ *
+ * @return  A zyan status code.
+ *
+ * Unresolved links are resolved on first use.
+ */
+static ZyanStatus ZydisTraceEncoderFollow(ZydisTraceEncoder* encoder, ZyanU32* link,
+    ZyanU64 expected, ZyanU64 address, const ZyanU8* buffer, ZyanUSize length, ZyanU32* entry)
+{
+    *entry = ZYDIS_TRACE_NO_ENTRY;
+    if (address != expected)
+    {
+        return ZYAN_STATUS_SUCCESS;
+    }
+
+    if (*link == ZYDIS_TRACE_NO_ENTRY)
+    {
+        ZYAN_CHECK(ZydisTraceEncoderLookup(encoder, address, buffer, length, link));
+    }
+    if (ZydisTraceEntryMatches(&encoder->entries[*link], buffer, length))
+    {
+        *entry = *link;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reader                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Parses the trailer of a trace.
+ *
+ * @param   data                A pointer to the trace.
+ * @param   length              The length of the trace.
+ * @param   instruction_count   Receives the number of instructions.
+ * @param   dictionary_offset   Receives the offset of the dictionary.
+ * @param   entry_count         Receives the number of dictionary entries.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceParseTrailer(const ZyanU8* data, ZyanUSize length,
+    ZyanU64* instruction_count, ZyanU64* dictionary_offset, ZyanU32* entry_count)
+{
+    if ((length < ZYDIS_TRACE_HEADER_SIZE + ZYDIS_TRACE_TRAILER_SIZE) ||
+        ZYAN_MEMCMP(data, "ZYTR", 4) || (data[4] != ZYDIS_TRACE_VERSION))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* const trailer = data + length - ZYDIS_TRACE_TRAILER_SIZE;
+    if (ZYAN_MEMCMP(trailer + 20, "ZYTR", 4))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    *instruction_count = ZydisTraceLoadU64(trailer);
+    *dictionary_offset = ZydisTraceLoadU64(trailer + 8);
+    *entry_count       = ZydisTraceLoadU32(trailer + 16);
+    if ((*dictionary_offset < ZYDIS_TRACE_HEADER_SIZE) ||
+        (*dictionary_offset > length - ZYDIS_TRACE_TRAILER_SIZE) ||
+        (*entry_count == ZYDIS_TRACE_NO_ENTRY))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Returns the size of the workspace required for the given number of dictionary entries.
+ *
+ * @param   entry_count         The number of dictionary entries.
+ * @param   cache_instructions  Signals, if decoded instructions are cached.
+ * @param   size                Receives the workspace size in bytes.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceReaderGetSize(ZyanU32 entry_count, ZyanBool cache_instructions,
+    ZyanUSize* size)
+{
+    const ZyanUSize entry_size = sizeof(ZyanU64) + sizeof(ZydisTraceEntry) +
+        (cache_instructions ? sizeof(ZydisDecodedInstruction) : 0);
+    if (entry_count > (~(ZyanUSize)0) / entry_size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    *size = entry_count * entry_size;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Starts reading the next segment.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceReaderNextSegment(ZydisTraceReader* reader)
+{
+    const ZyanU8* data = reader->data;
+    if ((ZyanUSize)(reader->data_end - data) < ZYDIS_TRACE_SEGMENT_HEADER_SIZE)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU32 segment_length = ZydisTraceLoadU32(data);
+    const ZyanU32 events_size    = ZydisTraceLoadU32(data +  4);
+    const ZyanU32 bit_count      = ZydisTraceLoadU32(data +  8);
+    const ZyanU32 targets_size   = ZydisTraceLoadU32(data + 12);
+    const ZyanU32 memory_size    = ZydisTraceLoadU32(data + 16);
+    const ZyanU32 bits_size      = (bit_count + 7) / 8;
+    data += ZYDIS_TRACE_SEGMENT_HEADER_SIZE;
+
+    if (!segment_length || (segment_length > ZYDIS_TRACE_SEGMENT_LENGTH) ||
+        (events_size > ZYDIS_TRACE_EVENTS_SIZE) || (bit_count > ZYDIS_TRACE_SEGMENT_LENGTH) ||
+        (targets_size > ZYDIS_TRACE_TARGETS_SIZE) || (memory_size > ZYDIS_TRACE_MEMORY_SIZE) ||
+        ((ZyanUSize)(reader->data_end - data) <
+            (ZyanUSize)events_size + bits_size + targets_size + memory_size))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    reader->events            = data;
+    reader->events_end        = data + events_size;
+    reader->bits              = reader->events_end;
+    reader->bit_count         = bit_count;
+    reader->bit_index         = 0;
+    reader->targets           = reader->bits + bits_size;
+    reader->targets_end       = reader->targets + targets_size;
+    reader->memory_stream     = reader->targets_end;
+    reader->memory_stream_end = reader->memory_stream + memory_size;
+    reader->data              = reader->memory_stream_end;
+    reader->segment_remaining = segment_length;
+    reader->event_distance    = ZYDIS_TRACE_NO_ENTRY;
+
+    if (reader->events != reader->events_end)
+    {
+        ZyanU64 distance;
+        ZYAN_CHECK(ZydisTraceLoadVarint(&reader->events, reader->events_end, &distance));
+        if (distance >= segment_length)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+        reader->event_distance = (ZyanU32)distance;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Reads a bit from the branch stream.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ * @param   bit     Receives the bit.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceReaderGetBit(ZydisTraceReader* reader, ZyanBool* bit)
+{
+    if (reader->bit_index == reader->bit_count)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    *bit = (reader->bits[reader->bit_index / 8] >> (reader->bit_index % 8)) & 1;
+    ++reader->bit_index;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Reads an entry id from the target stream.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ * @param   entry   Receives the entry id.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceReaderGetTarget(ZydisTraceReader* reader, ZyanU32* entry)
+{
+    ZyanU64 value;
+    ZYAN_CHECK(ZydisTraceLoadVarint(&reader->targets, reader->targets_end, &value));
+    *entry = (value < reader->entry_count) ? (ZyanU32)value : ZYDIS_TRACE_NO_ENTRY;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Determines the entry of the next instruction.
+ *
+ * @param   reader  A pointer to the `ZydisTraceReader` instance.
+ * @param   entry   Receives the entry id.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisTraceReaderGetEntryId(ZydisTraceReader* reader, ZyanU32* entry)
+{
+    if (!reader->event_distance)
+    {
+        ZyanU64 value;
+        ZYAN_CHECK(ZydisTraceLoadVarint(&reader->events, reader->events_end, &value));
+        *entry = (value < reader->entry_count) ? (ZyanU32)value : ZYDIS_TRACE_NO_ENTRY;
+
+        reader->event_distance = ZYDIS_TRACE_NO_ENTRY;
+        if (reader->events != reader->events_end)
+        {
+            ZYAN_CHECK(ZydisTraceLoadVarint(&reader->events, reader->events_end, &value));
+            if (!value || (value > reader->segment_remaining - 1))
+            {
+                return ZYAN_STATUS_INVALID_ARGUMENT;
+            }
+            reader->event_distance = (ZyanU32)value - 1;
+        }
+        return ZYAN_STATUS_SUCCESS;
+    }
+    --reader->event_distance;
+
+    if (reader->state.previous == ZYDIS_TRACE_NO_ENTRY)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+    const ZydisTraceEntry* const previous = &reader->entries[reader->state.previous];
+
+    ZyanBool bit;
+    switch (previous->flow)
+    {
+    case ZYDIS_TRACE_FLOW_SEQUENTIAL:
+        *entry = previous->next;
+        break;
+    case ZYDIS_TRACE_FLOW_CONDITIONAL:
+        ZYAN_CHECK(ZydisTraceReaderGetBit(reader, &bit));
+        *entry = bit ? previous->target : previous->next;
+        break;
+    case ZYDIS_TRACE_FLOW_JUMP:
+    case ZYDIS_TRACE_FLOW_CALL:
+        *entry = previous->target;
+        break;
+    case ZYDIS_TRACE_FLOW_INDIRECT_JUMP:
+    case ZYDIS_TRACE_FLOW_INDIRECT_CALL:
+        ZYAN_CHECK(ZydisTraceReaderGetTarget(reader, entry));
+        break;
+    case ZYDIS_TRACE_FLOW_RETURN:
+        if (reader->state.call != ZYDIS_TRACE_NO_ENTRY)
+        {
+            ZYAN_CHECK(ZydisTraceReaderGetBit(reader, &bit));
+            if (bit)
+            {
+                *entry = reader->entries[reader->state.call].next;
+                break;
+            }
+        }
+        ZYAN_CHECK(ZydisTraceReaderGetTarget(reader, entry));
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Encoder                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisTraceEncoderGetWorkspaceSize(ZyanU32 entry_capacity, ZyanUSize* size)
+{
+    if (!entry_capacity || (entry_capacity > 0x10000000) || !size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *size = (ZyanUSize)entry_capacity * (sizeof(ZyanU64) + sizeof(ZydisTraceEntry)) +
+        ZydisTraceGetTableSize(entry_capacity) * sizeof(ZyanU32) +
+        ZYDIS_TRACE_EVENTS_SIZE + ZYDIS_TRACE_BITS_SIZE + ZYDIS_TRACE_TARGETS_SIZE +
+        ZYDIS_TRACE_MEMORY_SIZE;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisTraceEncoderInit(ZydisTraceEncoder* encoder, ZydisMachineMode machine_mode,
+    ZydisStackWidth stack_width, ZyanU32 entry_capacity, void* workspace,
+    ZyanUSize workspace_size, ZydisTraceWriteFunc write, void* user_data)
+{
+    ZyanUSize size;
+    if (!encoder || !workspace || ((ZyanUPointer)workspace % 8) || !write ||
+        !ZYAN_SUCCESS(ZydisTraceEncoderGetWorkspaceSize(entry_capacity, &size)) ||
+        (workspace_size < size))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisDecoderInit(&encoder->decoder, machine_mode, stack_width));
+
+    const ZyanUSize table_size = ZydisTraceGetTableSize(entry_capacity);
+    encoder->write             = write;
+    encoder->user_data         = user_data;
+    encoder->position          = 0;
+    encoder->instruction_count = 0;
+    encoder->memory            = (ZyanU64*)workspace;
+    encoder->entries           = (ZydisTraceEntry*)(encoder->memory + entry_capacity);
+    encoder->entry_count       = 0;
+    encoder->entry_capacity    = entry_capacity;
+    encoder->table             = (ZyanU32*)(encoder->entries + entry_capacity);
+    encoder->table_mask        = (ZyanU32)(table_size - 1);
+    encoder->segment           = (ZyanU8*)(encoder->table + table_size);
+    encoder->segment_length    = 0;
+    encoder->last_event        = 0;
+    encoder->events_size       = 0;
+    encoder->bit_count         = 0;
+    encoder->targets_size      = 0;
+    encoder->memory_size       = 0;
+    ZydisTraceStateInit(&encoder->state);
+
+    ZYAN_MEMSET(encoder->table, 0xFF, table_size * sizeof(ZyanU32));
+    ZYAN_MEMSET(encoder->segment + ZYDIS_TRACE_EVENTS_SIZE, 0, ZYDIS_TRACE_BITS_SIZE);
+
+    const ZyanU8 header[ZYDIS_TRACE_HEADER_SIZE] =
+    {
+        'Z', 'Y', 'T', 'R', ZYDIS_TRACE_VERSION, (ZyanU8)machine_mode, (ZyanU8)stack_width, 0
+    };
+    return ZydisTraceEncoderWrite(encoder, header, sizeof(header));
+}
+
+ZyanStatus ZydisTraceEncoderAppend(ZydisTraceEncoder* encoder, ZyanU64 address,
+    const void* buffer, ZyanUSize length, ZyanU64 memory_address)
+{
+    if (!encoder || !buffer || !length)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    if ((encoder->segment_length == ZYDIS_TRACE_SEGMENT_LENGTH) ||
+        (encoder->events_size > ZYDIS_TRACE_EVENTS_SIZE - ZYDIS_TRACE_MAX_EVENT_LENGTH) ||
+        (encoder->targets_size > ZYDIS_TRACE_TARGETS_SIZE - ZYDIS_TRACE_MAX_TARGET_LENGTH) ||
+        (encoder->memory_size > ZYDIS_TRACE_MEMORY_SIZE - ZYDIS_TRACE_MAX_MEMORY_LENGTH))
+    {
+        ZYAN_CHECK(ZydisTraceEncoderFlushSegment(encoder));
+    }
+
+    const ZyanU8* const bytes = (const ZyanU8*)buffer;
+    ZyanU32 entry = ZYDIS_TRACE_NO_ENTRY;
+    if (encoder->state.previous != ZYDIS_TRACE_NO_ENTRY)
+    {
+        ZydisTraceEntry* const previous = &encoder->entries[encoder->state.previous];
+        const ZyanU64 fallthrough = previous->address + previous->length;
+
+        switch (previous->flow)
+        {
+        case ZYDIS_TRACE_FLOW_SEQUENTIAL:
+            ZYAN_CHECK(ZydisTraceEncoderFollow(encoder, &previous->next, fallthrough, address,
+                bytes, length, &entry));
+            break;
+        case ZYDIS_TRACE_FLOW_CONDITIONAL:
+            if (address == previous->target_address)
+            {
+                ZYAN_CHECK(ZydisTraceEncoderFollow(encoder, &previous->target,
+                    previous->target_address, address, bytes, length, &entry));
+                if (entry != ZYDIS_TRACE_NO_ENTRY)
+                {
+                    ZydisTraceEncoderPutBit(encoder, ZYAN_TRUE);
+                }
+            }
+            else
+            {
+                ZYAN_CHECK(ZydisTraceEncoderFollow(encoder, &previous->next, fallthrough,
+                    address, bytes, length, &entry));
+                if (entry != ZYDIS_TRACE_NO_ENTRY)
+                {
+                    ZydisTraceEncoderPutBit(encoder, ZYAN_FALSE);
+                }
+            }
+            break;
+        case ZYDIS_TRACE_FLOW_JUMP:
+        case ZYDIS_TRACE_FLOW_CALL:
+            ZYAN_CHECK(ZydisTraceEncoderFollow(encoder, &previous->target,
+                previous->target_address, address, bytes, length, &entry));
+            break;
+        case ZYDIS_TRACE_FLOW_INDIRECT_JUMP:
+        case ZYDIS_TRACE_FLOW_INDIRECT_CALL:
+            ZYAN_CHECK(ZydisTraceEncoderLookup(encoder, address, bytes, length, &entry));
+            ZydisTraceEncoderPutTarget(encoder, entry);
+            break;
+        case ZYDIS_TRACE_FLOW_RETURN:
+            if (encoder->state.call != ZYDIS_TRACE_NO_ENTRY)
+            {
+                ZydisTraceEntry* const call = &encoder->entries[encoder->state.call];
+                ZYAN_CHECK(ZydisTraceEncoderFollow(encoder, &call->next,
+                    call->address + call->length, address, bytes, length, &entry));
+                ZydisTraceEncoderPutBit(encoder, entry != ZYDIS_TRACE_NO_ENTRY);
+                if (entry != ZYDIS_TRACE_NO_ENTRY)
+                {
+                    break;
+                }
+            }
+            ZYAN_CHECK(ZydisTraceEncoderLookup(encoder, address, bytes, length, &entry));
+            ZydisTraceEncoderPutTarget(encoder, entry);
+            break;
+        default:
+            ZYAN_UNREACHABLE;
+        }
+    }
+
+    if (entry == ZYDIS_TRACE_NO_ENTRY)
+    {
+        // The instruction does not follow its predecessor as predicted (first instruction,
+        // interrupt, exception or modified code)
+        ZYAN_CHECK(ZydisTraceEncoderLookup(encoder, address, bytes, length, &entry));
+        ZyanU8* const events = encoder->segment + encoder->events_size;
+        ZyanUSize size = ZydisTraceStoreVarint(events,
+            encoder->segment_length - encoder->last_event);
+        size += ZydisTraceStoreVarint(events + size, entry);
+        encoder->events_size += size;
+        encoder->last_event = encoder->segment_length;
+    }
+
+    const ZydisTraceEntry* const current = &encoder->entries[entry];
+    if (current->has_memory)
+    {
+        const ZyanU64 delta = memory_address - encoder->memory[entry];
+        ZyanU8* const memory = encoder->segment + ZYDIS_TRACE_EVENTS_SIZE +
+            ZYDIS_TRACE_BITS_SIZE + ZYDIS_TRACE_TARGETS_SIZE;
+        encoder->memory_size += ZydisTraceStoreVarint(memory + encoder->memory_size,
+            (delta << 1) ^ (ZyanU64)((ZyanI64)delta >> 63));
+        encoder->memory[entry] = memory_address;
+    }
+
+    ZydisTraceStateUpdate(&encoder->state, entry, current->flow);
+    ++encoder->segment_length;
+    ++encoder->instruction_count;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisTraceEncoderFinish(ZydisTraceEncoder* encoder)
+{
+    if (!encoder)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisTraceEncoderFlushSegment(encoder));
+
+    const ZyanU64 dictionary_offset = encoder->position;
+    for (ZyanU32 i = 0; i < encoder->entry_count; ++i)
+    {
+        const ZydisTraceEntry* const entry = &encoder->entries[i];
+        ZyanU8 data[ZYDIS_TRACE_ENTRY_SIZE + ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZydisTraceStoreU64(&data[ 0], entry->address);
+        ZydisTraceStoreU64(&data[ 8], entry->target_address);
+        ZydisTraceStoreU32(&data[16], entry->next);
+        ZydisTraceStoreU32(&data[20], entry->target);
+        data[24] = entry->length;
+        data[25] = entry->flow;
+        data[26] = entry->has_memory;
+        ZYAN_MEMCPY(&data[ZYDIS_TRACE_ENTRY_SIZE], entry->bytes, entry->length);
+        ZYAN_CHECK(ZydisTraceEncoderWrite(encoder, data,
+            ZYDIS_TRACE_ENTRY_SIZE + entry->length));
+    }
+
+    ZyanU8 trailer[ZYDIS_TRACE_TRAILER_SIZE];
+    ZydisTraceStoreU64(&trailer[ 0], encoder->instruction_count);
+    ZydisTraceStoreU64(&trailer[ 8], dictionary_offset);
+    ZydisTraceStoreU32(&trailer[16], encoder->entry_count);
+    ZYAN_MEMCPY(&trailer[20], "ZYTR", 4);
+
+    return ZydisTraceEncoderWrite(encoder, trailer, sizeof(trailer));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Reader                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisTraceReaderGetWorkspaceSize(const void* data, ZyanUSize length,
+    ZyanBool cache_instructions, ZyanUSize* size)
+{
+    if (!data || !size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZyanU64 instruction_count;
+    ZyanU64 dictionary_offset;
+    ZyanU32 entry_count;
+    ZYAN_CHECK(ZydisTraceParseTrailer((const ZyanU8*)data, length, &instruction_count,
+        &dictionary_offset, &entry_count));
+
+    return ZydisTraceReaderGetSize(entry_count, cache_instructions, size);
+}
+
+ZyanStatus ZydisTraceReaderInit(ZydisTraceReader* reader, const void* data, ZyanUSize length,
+    ZyanBool cache_instructions, void* workspace, ZyanUSize workspace_size)
+{
+    if (!reader || !data || (!workspace && workspace_size) || ((ZyanUPointer)workspace % 8))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZyanU8* const bytes = (const ZyanU8*)data;
+    ZyanU64 instruction_count;
+    ZyanU64 dictionary_offset;
+    ZyanU32 entry_count;
+    ZyanUSize size;
+    ZYAN_CHECK(ZydisTraceParseTrailer(bytes, length, &instruction_count, &dictionary_offset,
+        &entry_count));
+    ZYAN_CHECK(ZydisTraceReaderGetSize(entry_count, cache_instructions, &size));
+    if (workspace_size < size)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisDecoderInit(&reader->decoder, (ZydisMachineMode)bytes[5],
+        (ZydisStackWidth)bytes[6]));
+
+    reader->data              = bytes + ZYDIS_TRACE_HEADER_SIZE;
+    reader->data_end          = bytes + dictionary_offset;
+    reader->memory            = (ZyanU64*)workspace;
+    reader->entries           = (ZydisTraceEntry*)(reader->memory + entry_count);
+    reader->entry_count       = entry_count;
+    reader->cache             = cache_instructions
+        ? (ZydisDecodedInstruction*)(reader->entries + entry_count)
+        : ZYAN_NULL;
+    reader->instruction_count = instruction_count;
+    reader->instruction_index = 0;
+    reader->segment_remaining = 0;
+    reader->event_distance    = ZYDIS_TRACE_NO_ENTRY;
+    reader->events            = ZYAN_NULL;
+    reader->events_end        = ZYAN_NULL;
+    reader->bits              = ZYAN_NULL;
+    reader->bit_count         = 0;
+    reader->bit_index         = 0;
+    reader->targets           = ZYAN_NULL;
+    reader->targets_end       = ZYAN_NULL;
+    reader->memory_stream     = ZYAN_NULL;
+    reader->memory_stream_end = ZYAN_NULL;
+    ZydisTraceStateInit(&reader->state);
+
+    const ZyanU8* position = reader->data_end;
+    const ZyanU8* const end = bytes + length - ZYDIS_TRACE_TRAILER_SIZE;
+    for (ZyanU32 i = 0; i < entry_count; ++i)
+    {
+        if ((ZyanUSize)(end - position) < ZYDIS_TRACE_ENTRY_SIZE)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+        ZydisTraceEntry* const entry = &reader->entries[i];
+        entry->address        = ZydisTraceLoadU64(position);
+        entry->target_address = ZydisTraceLoadU64(position +  8);
+        entry->next           = ZydisTraceLoadU32(position + 16);
+        entry->target         = ZydisTraceLoadU32(position + 20);
+        entry->length         = position[24];
+        entry->flow           = position[25];
+        entry->has_memory     = position[26] ? ZYAN_TRUE : ZYAN_FALSE;
+        position += ZYDIS_TRACE_ENTRY_SIZE;
+
+        if (!entry->length || (entry->length > ZYDIS_MAX_INSTRUCTION_LENGTH) ||
+            (entry->flow > ZYDIS_TRACE_FLOW_MAX_VALUE) ||
+            ((ZyanUSize)(end - position) < entry->length) ||
+            ((entry->next >= entry_count) && (entry->next != ZYDIS_TRACE_NO_ENTRY)) ||
+            ((entry->target >= entry_count) && (entry->target != ZYDIS_TRACE_NO_ENTRY)))
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+        ZYAN_MEMCPY(entry->bytes, position, entry->length);
+        position += entry->length;
+
+        reader->memory[i] = 0;
+        if (reader->cache)
+        {
+            reader->cache[i].length = 0;
+        }
+    }
+    if (position != end)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisTraceReaderRead(ZydisTraceReader* reader, ZydisTraceStep* steps,
+    ZyanUSize count, ZyanUSize* read)
+{
+    if (!reader || (!steps && count) || !read)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    *read = 0;
+    if (reader->instruction_index == reader->instruction_count)
+    {
+        return count ? ZYDIS_STATUS_NO_MORE_DATA : ZYAN_STATUS_SUCCESS;
+    }
+
+    ZyanUSize i = 0;
+    while ((i < count) && (reader->instruction_index < reader->instruction_count))
+    {
+        if (!reader->segment_remaining)
+        {
+            ZYAN_CHECK(ZydisTraceReaderNextSegment(reader));
+        }
+
+        ZyanU32 id;
+        ZYAN_CHECK(ZydisTraceReaderGetEntryId(reader, &id));
+        if (id >= reader->entry_count)
+        {
+            return ZYAN_STATUS_INVALID_ARGUMENT;
+        }
+
+        const ZydisTraceEntry* const entry = &reader->entries[id];
+        ZydisTraceStep* const step = &steps[i];
+        step->address        = entry->address;
+        step->memory_address = 0;
+        step->entry          = id;
+        if (entry->has_memory)
+        {
+            ZyanU64 value;
+            ZYAN_CHECK(ZydisTraceLoadVarint(&reader->memory_stream, reader->memory_stream_end,
+                &value));
+            reader->memory[id] += (value >> 1) ^ (~(value & 1) + 1);
+            step->memory_address = reader->memory[id];
+        }
+
+        ZydisTraceStateUpdate(&reader->state, id, entry->flow);
+        --reader->segment_remaining;
+        ++reader->instruction_index;
+        ++i;
+    }
+    *read = i;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+const ZydisTraceEntry* ZydisTraceReaderGetEntry(const ZydisTraceReader* reader, ZyanU32 entry)
+{
+    if (!reader || (entry >= reader->entry_count))
+    {
+        return ZYAN_NULL;
+    }
+
+    return &reader->entries[entry];
+}
+
+ZyanStatus ZydisTraceReaderDecodeInstruction(ZydisTraceReader* reader, ZyanU32 entry,
+    ZydisDecodedInstruction* instruction)
+{
+    if (!reader || (entry >= reader->entry_count) || !instruction)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZydisTraceEntry* const source = &reader->entries[entry];
+    ZydisDecoderContext context;
+    if (!reader->cache)
+    {
+        return ZydisDecoderDecodeInstruction(&reader->decoder, &context, source->bytes,
+            source->length, instruction);
+    }
+
+    ZydisDecodedInstruction* const cached = &reader->cache[entry];
+    if (!cached->length)
+    {
+        ZYAN_CHECK(ZydisDecoderDecodeInstruction(&reader->decoder, &context, source->bytes,
+            source->length, cached));
+    }
+    *instruction = *cached;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
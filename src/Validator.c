@@ -0,0 +1,654 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+#include <Zycore/LibC.h>
+#include <Zydis/Validator.h>
+#include <Zydis/Internal/SharedData.h>
+
+/* ============================================================================================== */
+/* Internal macros                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The cache entry is valid.
+ */
+#define ZYDIS_VALIDATOR_CACHE_VALID 0x01
+
+/**
+ * The instruction has a ModRM byte that directly follows the opcode.
+ */
+#define ZYDIS_VALIDATOR_CACHE_MODRM 0x02
+
+/**
+ * Marks the key value of an instruction with ModRM byte.
+ */
+#define ZYDIS_VALIDATOR_CACHE_KEY_MODRM 0x100
+
+/**
+ * The number of bits below the key of a cache entry. Bits 2 to 5 hold the total size of the
+ * immediates in bytes.
+ */
+#define ZYDIS_VALIDATOR_CACHE_KEY_SHIFT 6
+
+/* ============================================================================================== */
+/* Internal types                                                                                 */
+/* ============================================================================================== */
+
+/**
+ * Describes the cache key of an instruction.
+ */
+typedef struct ZydisValidatorCacheKey_
+{
+    /**
+     * The key value of instructions without ModRM byte, composed of the mandatory prefix class,
+     * the `REX` prefix, the opcode map and the opcode. The key value of instructions with ModRM
+     * byte additionally includes `ZYDIS_VALIDATOR_CACHE_KEY_MODRM` and the ModRM byte.
+     */
+    ZyanU32 value;
+    /**
+     * The number of bytes up to and including the opcode.
+     */
+    ZyanU8 length;
+    /**
+     * The number of prefix bytes.
+     */
+    ZyanU8 prefix_count;
+    /**
+     * The opcode map.
+     */
+    ZydisOpcodeMap opcode_map;
+} ZydisValidatorCacheKey;
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Helper functions                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Checks if the given bit is set in the given bitmap.
+ *
+ * @param   bitmap  A pointer to the bitmap.
+ * @param   index   The index of the bit.
+ *
+ * @return  `ZYAN_TRUE`, if the bit is set or `ZYAN_FALSE`, if not.
+ */
+ZYAN_INLINE ZyanBool ZydisValidatorTestBit(const ZyanU64* bitmap, ZyanUSize index)
+{
+    return (bitmap[index >> 6] >> (index & 63)) & 1;
+}
+
+/**
+ * Sets or clears the given bit in the given bitmap.
+ *
+ * @param   bitmap  A pointer to the bitmap.
+ * @param   index   The index of the bit.
+ * @param   value   The new value of the bit.
+ */
+ZYAN_INLINE void ZydisValidatorSetBit(ZyanU64* bitmap, ZyanUSize index, ZyanBool value)
+{
+    if (value)
+    {
+        bitmap[index >> 6] |= (1ULL << (index & 63));
+    }
+    else
+    {
+        bitmap[index >> 6] &= ~(1ULL << (index & 63));
+    }
+}
+
+/**
+ * Checks if the given instruction definition is privileged.
+ *
+ * @param   encoding    The instruction encoding.
+ * @param   definition  A pointer to the instruction definition.
+ *
+ * @return  `ZYAN_TRUE`, if the instruction is privileged or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ZydisValidatorIsPrivileged(ZydisInstructionEncoding encoding,
+    const ZydisInstructionDefinition* definition)
+{
+    switch (encoding)
+    {
+    case ZYDIS_INSTRUCTION_ENCODING_LEGACY:
+        return ((const ZydisInstructionDefinitionLEGACY*)definition)->is_privileged;
+    case ZYDIS_INSTRUCTION_ENCODING_3DNOW:
+    case ZYDIS_INSTRUCTION_ENCODING_XOP:
+    case ZYDIS_INSTRUCTION_ENCODING_VEX:
+    case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+    case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+        // The definitions of these encodings have no privilege flag, as none of them describes a
+        // privileged instruction
+        return ZYAN_FALSE;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+}
+
+/**
+ * Checks a single instruction definition against the given policy.
+ *
+ * @param   policy      A pointer to the `ZydisValidatorPolicy` instance.
+ * @param   encoding    The instruction encoding.
+ * @param   definition  A pointer to the instruction definition.
+ *
+ * @return  The violation type or `ZYDIS_VALIDATOR_VIOLATION_NONE`, if the instruction conforms
+ *          to the policy.
+ */
+static ZydisValidatorViolationType ZydisValidatorCheckDefinition(
+    const ZydisValidatorPolicy* policy, ZydisInstructionEncoding encoding,
+    const ZydisInstructionDefinition* definition)
+{
+    ZYAN_ASSERT(policy);
+    ZYAN_ASSERT(definition);
+
+    if (!ZydisValidatorTestBit(policy->mnemonics, definition->mnemonic))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_MNEMONIC;
+    }
+    if (!ZydisValidatorTestBit(policy->isa_sets, definition->isa_set))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_ISA_SET;
+    }
+    if (!policy->allow_privileged && ZydisValidatorIsPrivileged(encoding, definition))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_PRIVILEGED;
+    }
+
+    switch (definition->mnemonic)
+    {
+    case ZYDIS_MNEMONIC_BOUND:
+    case ZYDIS_MNEMONIC_INT1:
+    case ZYDIS_MNEMONIC_INT3:
+    case ZYDIS_MNEMONIC_INTO:
+    case ZYDIS_MNEMONIC_UD0:
+    case ZYDIS_MNEMONIC_UD1:
+    case ZYDIS_MNEMONIC_UD2:
+        return policy->allow_breakpoints ?
+            ZYDIS_VALIDATOR_VIOLATION_NONE : ZYDIS_VALIDATOR_VIOLATION_BREAKPOINT;
+    default:
+        break;
+    }
+
+    switch (definition->category)
+    {
+    case ZYDIS_CATEGORY_SYSCALL:
+    case ZYDIS_CATEGORY_SYSRET:
+    case ZYDIS_CATEGORY_INTERRUPT:
+        return policy->allow_system_calls ?
+            ZYDIS_VALIDATOR_VIOLATION_NONE : ZYDIS_VALIDATOR_VIOLATION_SYSTEM_CALL;
+    default:
+        break;
+    }
+
+    return ZYDIS_VALIDATOR_VIOLATION_NONE;
+}
+
+/**
+ * Checks a single decoded instruction against the allow bits of the given validator.
+ *
+ * @param   validator   A pointer to the `ZydisValidator` instance.
+ * @param   context     A pointer to the decoder context of the instruction.
+ * @param   instruction A pointer to the decoded instruction.
+ *
+ * @return  The violation type or `ZYDIS_VALIDATOR_VIOLATION_NONE`, if the instruction conforms
+ *          to the policy.
+ */
+static ZydisValidatorViolationType ZydisValidatorCheckInstruction(
+    const ZydisValidator* validator, const ZydisDecoderContext* context,
+    const ZydisDecodedInstruction* instruction)
+{
+    ZYAN_ASSERT(validator);
+    ZYAN_ASSERT(context);
+    ZYAN_ASSERT(instruction);
+
+    const ZydisInstructionDefinition* definition =
+        (const ZydisInstructionDefinition*)context->definition;
+    const ZyanUSize index = validator->definition_base[instruction->encoding] +
+        ZydisGetInstructionDefinitionId(instruction->encoding, definition);
+    if (ZydisValidatorTestBit(validator->definitions, index))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_NONE;
+    }
+
+    // Only rejected instructions pay for finding the reason
+    return ZydisValidatorCheckDefinition(validator->policy, instruction->encoding, definition);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Instruction cache                                                                              */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Reads the cache key of an instruction.
+ *
+ * @param   validator   A pointer to the `ZydisValidator` instance.
+ * @param   data        A pointer to the instruction bytes. At least `ZYDIS_MAX_INSTRUCTION_LENGTH`
+ *                      bytes must be readable.
+ * @param   key         A pointer to the `ZydisValidatorCacheKey` struct.
+ *
+ * Only a single `66`, `F3` or `F2` prefix followed by an optional `REX` prefix is supported.
+ * Other prefixes end up as the opcode of the key and are never cached.
+ */
+ZYAN_INLINE void ZydisValidatorReadKey(const ZydisValidator* validator, const ZyanU8* data,
+    ZydisValidatorCacheKey* key)
+{
+    ZyanU8 offset = 0;
+    ZyanU32 value;
+    switch (data[0])
+    {
+    case 0x66:
+        value = 1;
+        break;
+    case 0xF3:
+        value = 2;
+        break;
+    case 0xF2:
+        value = 3;
+        break;
+    default:
+        value = 0;
+        break;
+    }
+    offset += (value != 0);
+
+    value <<= 5;
+    if ((validator->decoder.machine_mode == ZYDIS_MACHINE_MODE_LONG_64) &&
+        ((data[offset] & 0xF0) == 0x40))
+    {
+        value |= 0x10 | (data[offset++] & 0x0F);
+    }
+    key->prefix_count = offset;
+
+    ZydisOpcodeMap opcode_map = ZYDIS_OPCODE_MAP_DEFAULT;
+    if (data[offset] == 0x0F)
+    {
+        opcode_map = ZYDIS_OPCODE_MAP_0F;
+        switch (data[++offset])
+        {
+        case 0x38:
+            opcode_map = ZYDIS_OPCODE_MAP_0F38;
+            ++offset;
+            break;
+        case 0x3A:
+            opcode_map = ZYDIS_OPCODE_MAP_0F3A;
+            ++offset;
+            break;
+        default:
+            break;
+        }
+    }
+    key->opcode_map = opcode_map;
+
+    value = (value << 2) | opcode_map;
+    value = (value << 8) | data[offset++];
+    key->value = value << 9;
+    key->length = offset;
+}
+
+/**
+ * Returns the cache slot of the given key.
+ *
+ * @param   value   The key value.
+ *
+ * @return  The index of the cache slot.
+ */
+ZYAN_INLINE ZyanUSize ZydisValidatorGetCacheSlot(ZyanU32 value)
+{
+    return ((value * 0x9E3779B1U) >> 16) & (ZYDIS_VALIDATOR_CACHE_SIZE - 1);
+}
+
+/**
+ * Calculates the length of an instruction from its cache entry.
+ *
+ * @param   entry   The cache entry.
+ * @param   data    A pointer to the instruction bytes.
+ * @param   offset  The offset of the byte that follows the opcode.
+ *
+ * @return  The length of the instruction.
+ *
+ * The displacement size follows the 32- and 64-bit addressing rules, as the `67` prefix is never
+ * cached.
+ */
+ZYAN_INLINE ZyanU8 ZydisValidatorGetCachedLength(ZyanU32 entry, const ZyanU8* data,
+    ZyanU8 offset)
+{
+    ZyanU8 length = offset + ((entry >> 2) & 0x0F);
+    if (entry & ZYDIS_VALIDATOR_CACHE_MODRM)
+    {
+        const ZyanU8 modrm = data[offset];
+        const ZyanU8 mod = modrm >> 6;
+        const ZyanU8 rm = modrm & 0x07;
+        ++length;
+        switch (mod)
+        {
+        case 0:
+            if (rm == 4)
+            {
+                length += ((data[offset + 1] & 0x07) == 5) ? 5 : 1;
+            } else if (rm == 5)
+            {
+                length += 4;
+            }
+            break;
+        case 1:
+            length += (rm == 4) ? 2 : 1;
+            break;
+        case 2:
+            length += (rm == 4) ? 5 : 4;
+            break;
+        default:
+            break;
+        }
+    }
+    return length;
+}
+
+/**
+ * Looks up the length of an instruction in the cache.
+ *
+ * @param   validator   A pointer to the `ZydisValidator` instance.
+ * @param   key         A pointer to the `ZydisValidatorCacheKey` of the instruction.
+ * @param   data        A pointer to the instruction bytes.
+ *
+ * @return  The length of the instruction or `0`, if the instruction is not cached.
+ */
+ZYAN_INLINE ZyanU8 ZydisValidatorLookup(const ZydisValidator* validator,
+    const ZydisValidatorCacheKey* key, const ZyanU8* data)
+{
+    ZyanU32 value = key->value;
+    ZyanU32 entry = validator->cache[ZydisValidatorGetCacheSlot(value)];
+    if (!(entry & ZYDIS_VALIDATOR_CACHE_VALID) ||
+        ((entry >> ZYDIS_VALIDATOR_CACHE_KEY_SHIFT) != value))
+    {
+        value |= ZYDIS_VALIDATOR_CACHE_KEY_MODRM | data[key->length];
+        entry = validator->cache[ZydisValidatorGetCacheSlot(value)];
+        if (!(entry & ZYDIS_VALIDATOR_CACHE_VALID) ||
+            ((entry >> ZYDIS_VALIDATOR_CACHE_KEY_SHIFT) != value))
+        {
+            return 0;
+        }
+    }
+
+    return ZydisValidatorGetCachedLength(entry, data, key->length);
+}
+
+/**
+ * Adds an allowed instruction to the cache.
+ *
+ * @param   validator   A pointer to the `ZydisValidator` instance.
+ * @param   key         A pointer to the `ZydisValidatorCacheKey` of the instruction.
+ * @param   data        A pointer to the instruction bytes.
+ * @param   instruction A pointer to the decoded instruction.
+ *
+ * The instruction is only cached, if the decoder agrees with the prefixes and the opcode of the
+ * key and if the cached length matches the decoded one. All instructions with the same key share
+ * the same definition, so they are allowed as well.
+ */
+static void ZydisValidatorCacheInstruction(ZydisValidator* validator,
+    const ZydisValidatorCacheKey* key, const ZyanU8* data,
+    const ZydisDecodedInstruction* instruction)
+{
+    ZYAN_ASSERT(validator);
+    ZYAN_ASSERT(key);
+    ZYAN_ASSERT(data);
+    ZYAN_ASSERT(instruction);
+
+    if ((instruction->encoding != ZYDIS_INSTRUCTION_ENCODING_LEGACY) ||
+        (instruction->raw.prefix_count != key->prefix_count) ||
+        (instruction->opcode_map != key->opcode_map) ||
+        (instruction->opcode != data[key->length - 1]))
+    {
+        return;
+    }
+
+    const ZyanU8 immediate_size =
+        (instruction->raw.imm[0].size + instruction->raw.imm[1].size) / 8;
+    ZyanU32 value = key->value;
+    ZyanU32 entry = (immediate_size << 2) | ZYDIS_VALIDATOR_CACHE_VALID;
+    if (instruction->attributes & ZYDIS_ATTRIB_HAS_MODRM)
+    {
+        if (instruction->raw.modrm.offset != key->length)
+        {
+            return;
+        }
+        value |= ZYDIS_VALIDATOR_CACHE_KEY_MODRM | data[key->length];
+        entry |= ZYDIS_VALIDATOR_CACHE_MODRM;
+    }
+    if (ZydisValidatorGetCachedLength(entry, data, key->length) != instruction->length)
+    {
+        return;
+    }
+
+    validator->cache[ZydisValidatorGetCacheSlot(value)] =
+        (value << ZYDIS_VALIDATOR_CACHE_KEY_SHIFT) | entry;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Exported functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Policy                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisValidatorPolicyInit(ZydisValidatorPolicy* policy)
+{
+    if (!policy)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_MEMSET(policy, 0, sizeof(*policy));
+    policy->bundle_size = ZYDIS_VALIDATOR_DEFAULT_BUNDLE_SIZE;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisValidatorPolicyAllowMnemonic(ZydisValidatorPolicy* policy,
+    ZydisMnemonic mnemonic, ZyanBool allowed)
+{
+    if (!policy || ((ZyanUSize)mnemonic > ZYDIS_MNEMONIC_MAX_VALUE))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisValidatorSetBit(policy->mnemonics, mnemonic, allowed);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisValidatorPolicyAllowISASet(ZydisValidatorPolicy* policy,
+    ZydisISASet isa_set, ZyanBool allowed)
+{
+    if (!policy || ((ZyanUSize)isa_set > ZYDIS_ISA_SET_MAX_VALUE))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZydisValidatorSetBit(policy->isa_sets, isa_set, allowed);
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisValidatorPolicySetBundleSize(ZydisValidatorPolicy* policy, ZyanU32 bundle_size)
+{
+    if (!policy || (bundle_size & (bundle_size - 1)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    policy->bundle_size = bundle_size;
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Validator                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanStatus ZydisValidatorInit(ZydisValidator* validator, ZydisMachineMode machine_mode,
+    ZydisStackWidth stack_width, const ZydisValidatorPolicy* policy)
+{
+    if (!validator || !policy || (policy->bundle_size & (policy->bundle_size - 1)))
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    ZYAN_CHECK(ZydisDecoderInit(&validator->decoder, machine_mode, stack_width));
+    // Instruction attributes and AVX information are not required by any of the checks
+    ZYAN_CHECK(ZydisDecoderEnableMode(&validator->decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE));
+
+    validator->policy = policy;
+    validator->offset = 0;
+
+    ZYAN_MEMSET(validator->definitions, 0, sizeof(validator->definitions));
+    ZyanUSize base = 0;
+    for (ZyanUSize i = 0; i <= ZYDIS_INSTRUCTION_ENCODING_MAX_VALUE; ++i)
+    {
+        const ZydisInstructionEncoding encoding = (ZydisInstructionEncoding)i;
+        const ZyanU16 count = ZydisGetInstructionDefinitionCount(encoding);
+        if (base + count > ZYDIS_VALIDATOR_MAX_DEFINITIONS)
+        {
+            return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+        }
+        validator->definition_base[i] = (ZyanU16)base;
+        for (ZyanU16 id = 0; id < count; ++id)
+        {
+            const ZydisInstructionDefinition* definition;
+            ZydisGetInstructionDefinition(encoding, id, &definition);
+            if (ZydisValidatorCheckDefinition(policy, encoding, definition) ==
+                ZYDIS_VALIDATOR_VIOLATION_NONE)
+            {
+                ZydisValidatorSetBit(validator->definitions, base + id, ZYAN_TRUE);
+            }
+        }
+        base += count;
+    }
+
+    // The cached lengths follow the 32- and 64-bit addressing rules
+    switch (machine_mode)
+    {
+    case ZYDIS_MACHINE_MODE_LONG_64:
+    case ZYDIS_MACHINE_MODE_LONG_COMPAT_32:
+    case ZYDIS_MACHINE_MODE_LEGACY_32:
+        validator->use_cache = ZYAN_TRUE;
+        break;
+    default:
+        validator->use_cache = ZYAN_FALSE;
+        break;
+    }
+    ZYAN_MEMSET(validator->cache, 0, sizeof(validator->cache));
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus ZydisValidatorValidate(ZydisValidator* validator, const void* buffer,
+    ZyanUSize length, ZydisValidatorViolation* violation)
+{
+    if (!validator || (!buffer && length) || !violation)
+    {
+        return ZYAN_STATUS_INVALID_ARGUMENT;
+    }
+
+    const ZydisValidatorPolicy* policy = validator->policy;
+    const ZyanU64 bundle_mask = policy->bundle_size ? (policy->bundle_size - 1) : ~0ULL;
+    const ZyanU8* data = (const ZyanU8*)buffer;
+
+    ZYAN_MEMSET(violation, 0, sizeof(*violation));
+
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZydisValidatorCacheKey key = { 0 };
+    ZyanUSize offset = 0;
+    while (offset < length)
+    {
+        const ZyanU64 stream_offset = validator->offset + offset;
+
+        const ZyanBool use_cache = validator->use_cache &&
+            (length - offset >= ZYDIS_MAX_INSTRUCTION_LENGTH);
+        if (use_cache)
+        {
+            ZydisValidatorReadKey(validator, data + offset, &key);
+            const ZyanU8 instruction_length = ZydisValidatorLookup(validator, &key, data + offset);
+            // Bundle crossings are reported by the decoding path below
+            if (instruction_length && (!policy->bundle_size ||
+                ((stream_offset & bundle_mask) + instruction_length <= policy->bundle_size)))
+            {
+                offset += instruction_length;
+                continue;
+            }
+        }
+
+        const ZyanStatus status = ZydisDecoderDecodeInstruction(&validator->decoder, &context,
+            data + offset, length - offset, &instruction);
+        if (!ZYAN_SUCCESS(status))
+        {
+            violation->type = ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION;
+            violation->offset = stream_offset;
+            violation->status = status;
+            validator->offset = stream_offset;
+            return ZYAN_STATUS_FALSE;
+        }
+
+        ZydisValidatorViolationType type =
+            ZydisValidatorCheckInstruction(validator, &context, &instruction);
+        if ((type == ZYDIS_VALIDATOR_VIOLATION_NONE) && policy->bundle_size &&
+            ((stream_offset & bundle_mask) + instruction.length > policy->bundle_size))
+        {
+            type = ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING;
+        }
+        if (type != ZYDIS_VALIDATOR_VIOLATION_NONE)
+        {
+            violation->type = type;
+            violation->offset = stream_offset;
+            violation->mnemonic = instruction.mnemonic;
+            violation->length = instruction.length;
+            violation->status = ZYAN_STATUS_SUCCESS;
+            validator->offset = stream_offset;
+            return ZYAN_STATUS_FALSE;
+        }
+
+        if (use_cache)
+        {
+            ZydisValidatorCacheInstruction(validator, &key, data + offset, &instruction);
+        }
+
+        offset += instruction.length;
+    }
+
+    validator->offset += length;
+
+    return ZYAN_STATUS_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
@@ -24,7 +24,180 @@
 
 ***************************************************************************************************/
 
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
 #include <Zydis/Zydis.h>
+#include <Zydis/Internal/SharedData.h>
+
+#if defined(ZYDIS_HAS_TABLE_SECTION) && defined(ZYAN_LINUX) && !defined(ZYAN_NO_LIBC)
+#   define ZYDIS_HAS_HUGE_PAGE_REMAPPING
+#   include <errno.h>
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   include <Zycore/LibC.h>
+#endif
+
+#ifdef ZYDIS_HAS_HUGE_PAGE_REMAPPING
+
+/* ============================================================================================== */
+/* Internal functions                                                                             */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Huge pages                                                                                     */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The first byte of the table section (defined by the linker).
+ */
+extern const ZyanU8 __start_zydis_tables[];
+
+/**
+ * The end of the table section (defined by the linker).
+ */
+extern const ZyanU8 __stop_zydis_tables[];
+
+/**
+ * Checks, if the given memory range is completely covered by read-only mappings.
+ *
+ * @param   begin   The start address.
+ * @param   end     The end address.
+ *
+ * @return  A zyan status code.
+ *
+ * Executable or writable memory must not be moved to a read-only huge page.
+ */
+static ZyanStatus ZydisCheckReadOnly(ZyanUPointer begin, ZyanUPointer end)
+{
+    const int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    // Mappings are listed in ascending order, one per line:
+    // `begin-end perms offset dev inode path`
+    char buffer[8192];
+    ZyanUSize size = 0;
+    ZyanUPointer covered = begin;
+    ZyanStatus status = ZYAN_STATUS_INVALID_OPERATION;
+    for (;;)
+    {
+        const ssize_t length = read(fd, buffer + size, sizeof(buffer) - size);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            status = ZYAN_STATUS_BAD_SYSTEMCALL;
+            break;
+        }
+        size += (ZyanUSize)length;
+
+        ZyanUSize line = 0;
+        for (ZyanUSize i = 0; i < size; ++i)
+        {
+            if (buffer[i] != '\n')
+            {
+                continue;
+            }
+
+            ZyanUPointer values[2] = { 0, 0 };
+            ZyanUSize j = line;
+            for (ZyanUSize k = 0; k < 2; ++k, ++j)
+            {
+                for (; j < i; ++j)
+                {
+                    const char c = buffer[j];
+                    const ZyanU8 digit = (c >= '0' && c <= '9') ? (ZyanU8)(c - '0') :
+                        (c >= 'a' && c <= 'f') ? (ZyanU8)(c - 'a' + 10) : 0xFF;
+                    if (digit == 0xFF)
+                    {
+                        break;
+                    }
+                    values[k] = (values[k] << 4) | digit;
+                }
+            }
+            line = i + 1;
+
+            if ((values[1] <= covered) || (values[0] >= end))
+            {
+                continue;
+            }
+            if ((values[0] > covered) || (j + 3 > i) || (buffer[j] != 'r') ||
+                (buffer[j + 1] != '-') || (buffer[j + 2] != '-'))
+            {
+                goto done;
+            }
+            covered = values[1];
+            if (covered >= end)
+            {
+                status = ZYAN_STATUS_SUCCESS;
+                goto done;
+            }
+        }
+
+        if (!length || (!line && (size == sizeof(buffer))))
+        {
+            break;
+        }
+        ZYAN_MEMMOVE(buffer, buffer + line, size - line);
+        size -= line;
+    }
+
+done:
+    close(fd);
+    return status;
+}
+
+/**
+ * Moves a huge page-sized chunk of memory to a huge page.
+ *
+ * @param   chunk   The address of the chunk. Must be aligned to `ZYDIS_TABLE_ALIGNMENT`.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus ZydisRemapChunk(ZyanU8* chunk)
+{
+    const ZyanUSize size = ZYDIS_TABLE_ALIGNMENT;
+
+    // Reserve twice the size to obtain an aligned range and release the rest
+    ZyanU8* const reservation = (ZyanU8*)mmap(ZYAN_NULL, size * 2, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reservation == MAP_FAILED)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    ZyanU8* const copy = (ZyanU8*)(((ZyanUPointer)reservation + size - 1) & ~(size - 1));
+    if (copy != reservation)
+    {
+        munmap(reservation, (ZyanUSize)(copy - reservation));
+    }
+    munmap(copy + size, (ZyanUSize)(reservation + size * 2 - (copy + size)));
+
+    if (madvise(copy, size, MADV_HUGEPAGE))
+    {
+        munmap(copy, size);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    ZYAN_MEMCPY(copy, chunk, size);
+    if (mprotect(copy, size, PROT_READ) ||
+        (mremap(copy, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, chunk) == MAP_FAILED))
+    {
+        munmap(copy, size);
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#endif
 
 /* ============================================================================================== */
 /* Exported functions                                                                             */
@@ -78,9 +251,39 @@ ZyanStatus ZydisIsFeatureEnabled(ZydisFeature feature)
         return ZYAN_STATUS_FALSE;
 #endif
 
+    case ZYDIS_FEATURE_HUGE_PAGE_TABLES:
+#ifdef ZYDIS_HAS_TABLE_SECTION
+        return ZYAN_STATUS_TRUE;
+#else
+        return ZYAN_STATUS_FALSE;
+#endif
+
     default:
         return ZYAN_STATUS_INVALID_ARGUMENT;
     }
 }
 
+ZyanStatus ZydisMapTablesToHugePages(void)
+{
+#ifdef ZYDIS_HAS_HUGE_PAGE_REMAPPING
+    const ZyanUPointer begin = (ZyanUPointer)__start_zydis_tables;
+    const ZyanUPointer end = ((ZyanUPointer)__stop_zydis_tables + ZYDIS_TABLE_ALIGNMENT - 1) &
+        ~(ZyanUPointer)(ZYDIS_TABLE_ALIGNMENT - 1);
+    if (begin % ZYDIS_TABLE_ALIGNMENT)
+    {
+        return ZYAN_STATUS_INVALID_OPERATION;
+    }
+
+    ZYAN_CHECK(ZydisCheckReadOnly(begin, end));
+    for (ZyanUPointer chunk = begin; chunk < end; chunk += ZYDIS_TABLE_ALIGNMENT)
+    {
+        ZYAN_CHECK(ZydisRemapChunk((ZyanU8*)chunk));
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+#else
+    return ZYAN_STATUS_INVALID_OPERATION;
+#endif
+}
+
 /* ============================================================================================== */
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+import os
+import re
+import sys
+import random
+import argparse
+import difflib
+
+from subprocess import Popen, PIPE
+
+# Large enough to cross the 1 KiB input chunks and several flushes of the 64 KiB output buffer
+INPUT_SIZE = 256 * 1024
+
+ESCAPE_SEQUENCE = re.compile(rb'\x1B\[[0-9;]*m')
+
+def run_disasm(path, mode, payload, force_color):
+    """
+    Disassembles the payload with stdout redirected to a pipe and returns the exitcode and stdout.
+    """
+    env = dict(os.environ)
+    env.pop('NO_COLOR', None)
+    env.pop('FORCE_COLOR', None)
+    if force_color:
+        env['FORCE_COLOR'] = '1'
+
+    proc = Popen([path, mode], stdin=PIPE, stdout=PIPE, stderr=PIPE, env=env)
+    out, err = proc.communicate(payload)
+
+    return proc.returncode, out
+
+parser = argparse.ArgumentParser(description="ZydisDisasm output regression testing.")
+parser.add_argument(dest="zydis_disasm_path", type=str)
+args = parser.parse_args()
+
+# Redirected output is formatted into a sink, colored output is printed token by token. Without
+# the escape sequences both have to be the same.
+generator = random.Random(0x5A796469)
+payload = bytes(generator.getrandbits(8) for _ in range(INPUT_SIZE))
+
+has_failed = False
+
+for mode in ['-16', '-32', '-64']:
+    exitcode, out = run_disasm(args.zydis_disasm_path, mode, payload, False)
+    color_exitcode, color_out = run_disasm(args.zydis_disasm_path, mode, payload, True)
+    color_out = ESCAPE_SEQUENCE.sub(b'', color_out)
+
+    if exitcode != 0 or color_exitcode != 0:
+        print(f"FAILED: {mode}: exitcode {exitcode}, colored exitcode {color_exitcode}")
+        has_failed = True
+        continue
+
+    if ESCAPE_SEQUENCE.search(out) or out != color_out:
+        print(f"FAILED: {mode}")
+        print('\n'.join(difflib.unified_diff(
+            color_out.decode().split('\n'),
+            out.decode().split('\n'),
+            fromfile='colored',
+            tofile='redirected',
+            lineterm='',
+            n=2)))
+        has_failed = True
+        continue
+
+    lines = out.count(b'\n')
+    print(f"PASSED: {mode} ({lines} lines, {len(out)} bytes)")
+
+if has_failed:
+    print("SOME TESTS FAILED")
+    sys.exit(1)
+
+print("ALL TESTS PASSED")
+sys.exit(0)
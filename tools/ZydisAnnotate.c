@@ -0,0 +1,988 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Attributes instruction pointer samples (e.g. from `perf script -F ip`) to the instructions and
+ * basic blocks of a raw code file or the executable sections of an ELF file and prints an
+ * annotated listing of the hot blocks.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_ADDRESS   ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_HOT       ZYAN_VT100SGR_FG_BRIGHT_YELLOW
+#define COLOR_SYMBOL    ZYAN_VT100SGR_FG_CYAN
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The minimum number of bytes swept by a single work item.
+ */
+#define CHUNK_SIZE 0x10000
+
+/**
+ * The number of samples passed to the sample maps at once.
+ */
+#define SAMPLE_BATCH_SIZE 0x1000
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `Phase` enum.
+ */
+typedef enum Phase_
+{
+    /**
+     * The workers record the instruction boundaries of their chunks.
+     */
+    PHASE_SWEEP,
+    /**
+     * The workers attribute their part of the samples.
+     */
+    PHASE_ATTRIBUTE
+} Phase;
+
+/**
+ * Defines the `Section` struct.
+ */
+typedef struct Section_
+{
+    /**
+     * The runtime address of the section.
+     */
+    ZyanU64 address;
+    /**
+     * The file offset of the section.
+     */
+    ZyanU64 offset;
+    /**
+     * The size of the section.
+     */
+    ZyanU64 size;
+    /**
+     * The sweep info array.
+     */
+    ZyanU8* info;
+    /**
+     * The workspace of the sample map.
+     */
+    void* workspace;
+    /**
+     * The sample map.
+     */
+    ZydisSampleMap map;
+    /**
+     * The index of the first instruction of this section in the combined sample counters.
+     */
+    size_t first_instruction;
+} Section;
+
+/**
+ * Defines the `Function` struct.
+ */
+typedef struct Function_
+{
+    /**
+     * The runtime address of the function.
+     */
+    ZyanU64 address;
+    /**
+     * The size of the function.
+     */
+    ZyanU64 size;
+    /**
+     * The name of the function or `ZYAN_NULL`.
+     */
+    const char* name;
+} Function;
+
+/**
+ * Defines the `Chunk` struct.
+ */
+typedef struct Chunk_
+{
+    /**
+     * The index of the section.
+     */
+    size_t section;
+    /**
+     * The offset of the first byte of this chunk, relative to the section.
+     */
+    ZyanU64 begin;
+    /**
+     * The offset of the last byte (exclusive) of this chunk, relative to the section.
+     */
+    ZyanU64 end;
+} Chunk;
+
+/**
+ * Defines the `Image` struct.
+ */
+typedef struct Image_
+{
+    /**
+     * The file data.
+     */
+    ZyanU8* data;
+    /**
+     * The file size.
+     */
+    size_t size;
+    /**
+     * The decoder used for the sweep.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The code sections (`Section`).
+     */
+    Vector sections;
+    /**
+     * The functions (`Function`), sorted by address.
+     */
+    Vector functions;
+    /**
+     * The work items of the sweep (`Chunk`).
+     */
+    Vector chunks;
+    /**
+     * The samples.
+     */
+    ZyanU64* samples;
+    /**
+     * The number of samples.
+     */
+    size_t sample_count;
+    /**
+     * The total number of instructions in all sections.
+     */
+    size_t instruction_count;
+    /**
+     * One array of per-instruction sample counters for every worker.
+     */
+    ZyanU64** hits;
+    /**
+     * The current phase.
+     */
+    Phase phase;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} Image;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Lookup                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Finds the function with the greatest start address less than or equal to the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  A pointer to the function or `ZYAN_NULL`, if not found.
+ */
+static Function* FindFunction(const Image* image, ZyanU64 address)
+{
+    size_t lo = 0;
+    size_t hi = image->functions.count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (VECTOR_AT(&image->functions, Function, mid).address <= address)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo ? &VECTOR_AT(&image->functions, Function, lo - 1) : ZYAN_NULL;
+}
+
+/**
+ * Finds the function that contains the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  A pointer to the function or `ZYAN_NULL`, if not found.
+ */
+static Function* FindContainingFunction(const Image* image, ZyanU64 address)
+{
+    Function* function = FindFunction(image, address);
+    if (function && (address - function->address < function->size))
+    {
+        return function;
+    }
+    return ZYAN_NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Sorting                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+static int CompareFunctions(const void* a, const void* b)
+{
+    const Function* lhs = (const Function*)a;
+    const Function* rhs = (const Function*)b;
+    if (lhs->address != rhs->address)
+    {
+        return (lhs->address < rhs->address) ? -1 : 1;
+    }
+    // Prefer named symbols over anonymous ones
+    return (lhs->name ? 0 : 1) - (rhs->name ? 0 : 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Parses a sample file.
+ *
+ * @param   image       A pointer to the `Image` struct.
+ * @param   data        A pointer to the file data. Text files are modified in place.
+ * @param   size        The file size.
+ * @param   is_binary   `ZYAN_TRUE` for arrays of little-endian 64-bit addresses, `ZYAN_FALSE`
+ *                      for text files with one hexadecimal address at the start of every line.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool ParseSamples(Image* image, char* data, size_t size, ZyanBool is_binary)
+{
+    if (is_binary)
+    {
+        image->sample_count = size / sizeof(ZyanU64);
+        image->samples = malloc(image->sample_count ? image->sample_count * sizeof(ZyanU64) : 1);
+        if (!image->samples)
+        {
+            return ZYAN_FALSE;
+        }
+        for (size_t i = 0; i < image->sample_count; ++i)
+        {
+            image->samples[i] = ReadLE((const ZyanU8*)data + i * sizeof(ZyanU64),
+                sizeof(ZyanU64));
+        }
+        return ZYAN_TRUE;
+    }
+
+    // Every sample takes at least two bytes (one digit and the line break)
+    image->samples = malloc((size / 2 + 1) * sizeof(ZyanU64));
+    if (!image->samples)
+    {
+        return ZYAN_FALSE;
+    }
+    size_t count = 0;
+    size_t position = 0;
+    while (position < size)
+    {
+        while ((position < size) && ((data[position] == ' ') || (data[position] == '\t')))
+        {
+            ++position;
+        }
+        if ((position + 1 < size) && (data[position] == '0') &&
+            ((data[position + 1] == 'x') || (data[position + 1] == 'X')))
+        {
+            position += 2;
+        }
+
+        ZyanU64 value = 0;
+        size_t digits = 0;
+        for (; position < size; ++position, ++digits)
+        {
+            const char c = data[position];
+            ZyanU8 digit;
+            if ((c >= '0') && (c <= '9'))
+            {
+                digit = (ZyanU8)(c - '0');
+            }
+            else if ((c >= 'a') && (c <= 'f'))
+            {
+                digit = (ZyanU8)(c - 'a' + 10);
+            }
+            else if ((c >= 'A') && (c <= 'F'))
+            {
+                digit = (ZyanU8)(c - 'A' + 10);
+            }
+            else
+            {
+                break;
+            }
+            value = (value << 4) | digit;
+        }
+        if (digits)
+        {
+            image->samples[count++] = value;
+        }
+
+        // Skip the rest of the line
+        const char* end = ZYAN_MEMCHR(data + position, '\n', size - position);
+        position = end ? (size_t)(end - data) + 1 : size;
+    }
+    image->sample_count = count;
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Adds a code section.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address of the section.
+ * @param   offset  The file offset of the section.
+ * @param   size    The size of the section.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool AddSection(Image* image, ZyanU64 address, ZyanU64 offset, ZyanU64 size)
+{
+    Section section;
+    ZYAN_MEMSET(&section, 0, sizeof(section));
+    section.address = address;
+    section.offset = offset;
+    section.size = size;
+    section.info = calloc((size_t)size, 1);
+    if (!section.info)
+    {
+        return ZYAN_FALSE;
+    }
+    if (!VectorPush(&image->sections, &section))
+    {
+        free(section.info);
+        return ZYAN_FALSE;
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Loads the executable sections and function symbols of a little-endian ELF file.
+ *
+ * @param   image               A pointer to the `Image` struct.
+ * @param   has_machine_mode    Signals, if the machine mode was given on the command line.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ *
+ * Files that are not ELF files are loaded as a single code section at address `0`.
+ */
+static ZyanBool LoadImage(Image* image, ZyanBool has_machine_mode)
+{
+    const ZyanU8* data = image->data;
+    const size_t size = image->size;
+    if ((size < 0x40) || ZYAN_MEMCMP(data, "\x7F" "ELF", 4) || (data[5] != 1) ||
+        ((data[4] != 1) && (data[4] != 2)))
+    {
+        return (size > ZYAN_UINT32_MAX) || AddSection(image, 0, 0, size);
+    }
+
+    const ZyanBool is_64 = (data[4] == 2);
+    if (!has_machine_mode)
+    {
+        ZydisDecoderInit(&image->decoder,
+            is_64 ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
+            is_64 ? ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32);
+        ZydisDecoderEnableMode(&image->decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE);
+    }
+
+    ElfSectionTable sections;
+    if (!ReadSectionTable(data, size, is_64, &sections))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sMalformed section header table%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return ZYAN_TRUE;
+    }
+
+    ElfSection header;
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ReadSection(&sections, i, &header);
+        // Skip `SHT_NOBITS` and sections without `SHF_EXECINSTR`
+        if ((header.type == 8) || !(header.flags & 0x4) || !header.size ||
+            (header.offset > size) || (header.size > size - header.offset) ||
+            (header.size > ZYAN_UINT32_MAX))
+        {
+            continue;
+        }
+        if (!AddSection(image, header.address, header.offset, header.size))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ElfSection table;
+        ReadSection(&sections, i, &table);
+        // `SHT_SYMTAB` and `SHT_DYNSYM`
+        if (((table.type != 2) && (table.type != 11)) ||
+            (table.entry_size < (is_64 ? 24u : 16u)) || (table.link >= sections.count) ||
+            (table.offset > size) || (table.size > size - table.offset))
+        {
+            continue;
+        }
+
+        ElfSection strings;
+        ReadSection(&sections, table.link, &strings);
+        if ((strings.offset > size) || (strings.size > size - strings.offset))
+        {
+            continue;
+        }
+        const char* string_data = (const char*)data + strings.offset;
+
+        for (ZyanU64 j = 0; j + table.entry_size <= table.size; j += table.entry_size)
+        {
+            const ZyanU8* symbol = data + table.offset + j;
+            const ZyanU32 name   = (ZyanU32)ReadLE(symbol, 4);
+            const ZyanU8  info   = is_64 ? symbol[0x04] : symbol[0x0C];
+            const ZyanU16 shndx  = (ZyanU16)ReadLE(symbol + (is_64 ? 0x06 : 0x0E), 2);
+            const ZyanU64 value  = is_64 ? ReadLE(symbol + 0x08, 8) : ReadLE(symbol + 0x04, 4);
+            const ZyanU64 length = is_64 ? ReadLE(symbol + 0x10, 8) : ReadLE(symbol + 0x08, 4);
+
+            // `STT_FUNC` and `STT_GNU_IFUNC` symbols defined in a regular section
+            if ((((info & 0xF) != 2) && ((info & 0xF) != 10)) || !shndx || (shndx >= 0xFF00))
+            {
+                continue;
+            }
+
+            Function function;
+            function.address = value;
+            function.size = length;
+            function.name = ZYAN_NULL;
+            if ((name < strings.size) &&
+                ZYAN_MEMCHR(string_data + name, '\0', (size_t)(strings.size - name)))
+            {
+                function.name = string_data + name;
+            }
+            if (!VectorPush(&image->functions, &function))
+            {
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    // Aliases are merged into a single entry per address
+    qsort(image->functions.data, image->functions.count, sizeof(Function), &CompareFunctions);
+    size_t count = 0;
+    for (size_t i = 0; i < image->functions.count; ++i)
+    {
+        const Function* function = &VECTOR_AT(&image->functions, Function, i);
+        if (count && (VECTOR_AT(&image->functions, Function, count - 1).address ==
+            function->address))
+        {
+            Function* previous = &VECTOR_AT(&image->functions, Function, count - 1);
+            previous->size = ZYAN_MAX(previous->size, function->size);
+            continue;
+        }
+        VECTOR_AT(&image->functions, Function, count++) = *function;
+    }
+    image->functions.count = count;
+
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Sweep                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Splits the code sections into work items. Chunks start at function boundaries, if function
+ * symbols are available, so every sweep starts at a valid instruction boundary.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool CreateChunks(Image* image)
+{
+    for (size_t i = 0; i < image->sections.count; ++i)
+    {
+        const Section* section = &VECTOR_AT(&image->sections, Section, i);
+
+        ZyanU64 begin = 0;
+        while (begin < section->size)
+        {
+            // Without symbols, the whole section is swept at once
+            ZyanU64 end = section->size;
+            if (image->functions.count)
+            {
+                // Extend the chunk to the next function start
+                const Function* function =
+                    FindFunction(image, section->address + ZYAN_MIN(begin + CHUNK_SIZE, end));
+                const Function* last = &VECTOR_AT(&image->functions, Function,
+                    image->functions.count - 1);
+                if (function && (function != last) &&
+                    ((function + 1)->address - section->address < section->size))
+                {
+                    end = (function + 1)->address - section->address;
+                }
+            }
+
+            Chunk chunk;
+            chunk.section = i;
+            chunk.begin = begin;
+            chunk.end = end;
+            if (!VectorPush(&image->chunks, &chunk))
+            {
+                return ZYAN_FALSE;
+            }
+            begin = end;
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Builds the sample maps of all code sections from the recorded instruction boundaries.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool BuildMaps(Image* image)
+{
+    for (size_t i = 0; i < image->sections.count; ++i)
+    {
+        Section* section = &VECTOR_AT(&image->sections, Section, i);
+
+        ZyanUSize count;
+        ZyanUSize size;
+        if (!ZYAN_SUCCESS(ZydisSampleMapCountInstructions(section->info,
+                (ZyanUSize)section->size, &count)) ||
+            !ZYAN_SUCCESS(ZydisSampleMapGetWorkspaceSize((ZyanUSize)section->size, count,
+                &size)))
+        {
+            return ZYAN_FALSE;
+        }
+        section->workspace = malloc(size);
+        if (!section->workspace ||
+            !ZYAN_SUCCESS(ZydisSampleMapInit(&section->map, &image->decoder,
+                image->data + section->offset, (ZyanUSize)section->size, section->address,
+                section->info, section->workspace, size)))
+        {
+            return ZYAN_FALSE;
+        }
+        free(section->info);
+        section->info = ZYAN_NULL;
+
+        section->first_instruction = image->instruction_count;
+        image->instruction_count += count;
+    }
+
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Runs the current phase for the worker with the given index.
+ *
+ * @param   user_data   A pointer to the `Image` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ *
+ * The sweep is split into every `count`-th chunk, the attribution into contiguous ranges of
+ * samples with one set of counters per worker.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const Image* image = (const Image*)user_data;
+
+    if (image->phase == PHASE_SWEEP)
+    {
+        for (size_t i = index; i < image->chunks.count; i += count)
+        {
+            const Chunk* chunk = &VECTOR_AT(&image->chunks, Chunk, i);
+            const Section* section = &VECTOR_AT(&image->sections, Section, chunk->section);
+            ZydisSampleMapSweep(&image->decoder, image->data + section->offset,
+                (ZyanUSize)section->size, (ZyanUSize)chunk->begin, (ZyanUSize)chunk->end,
+                section->info);
+        }
+        return;
+    }
+
+    ZyanU64* hits = image->hits[index];
+    const size_t begin = image->sample_count / count * index;
+    const size_t end = (index + 1 == count) ? image->sample_count :
+        begin + image->sample_count / count;
+    for (size_t i = begin; i < end; i += SAMPLE_BATCH_SIZE)
+    {
+        const size_t batch_size = ZYAN_MIN(end - i, SAMPLE_BATCH_SIZE);
+        for (size_t j = 0; j < image->sections.count; ++j)
+        {
+            const Section* section = &VECTOR_AT(&image->sections, Section, j);
+            ZydisSampleMapAccumulate(&section->map, image->samples + i, batch_size,
+                hits + section->first_instruction, ZYAN_NULL);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Prints the symbolic location of the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ */
+static void PrintLocation(const Image* image, ZyanU64 address)
+{
+    ZYAN_PRINTF("%s%016" PRIX64 "%s", CVT100_OUT(COLOR_ADDRESS), address,
+        CVT100_OUT(ZYAN_VT100SGR_RESET));
+    const Function* function = FindContainingFunction(image, address);
+    if (function && function->name)
+    {
+        ZYAN_PRINTF(" <%s%s", CVT100_OUT(COLOR_SYMBOL), function->name);
+        if (address != function->address)
+        {
+            ZYAN_PRINTF("+0x%" PRIX64, address - function->address);
+        }
+        ZYAN_PRINTF("%s>", CVT100_OUT(ZYAN_VT100SGR_RESET));
+    }
+}
+
+/**
+ * Prints the annotated listing of all basic blocks that received at least the given share of the
+ * samples.
+ *
+ * @param   image       A pointer to the `Image` struct.
+ * @param   section     A pointer to the `Section` struct.
+ * @param   decoder     A pointer to a decoder in full mode.
+ * @param   formatter   A pointer to the formatter.
+ * @param   threshold   The minimum number of samples of a block.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool PrintSection(const Image* image, const Section* section,
+    const ZydisDecoder* decoder, const ZydisFormatter* formatter, ZyanU64 threshold)
+{
+    ZyanUSize instruction_count;
+    ZyanUSize block_count;
+    ZydisSampleMapGetInstructionCount(&section->map, &instruction_count);
+    ZydisSampleMapGetBlockCount(&section->map, &block_count);
+
+    ZyanU64* block_hits = malloc(block_count ? block_count * sizeof(ZyanU64) : 1);
+    if (!block_hits)
+    {
+        return ZYAN_FALSE;
+    }
+    const ZyanU64* hits = image->hits[0] + section->first_instruction;
+    ZydisSampleMapSumBlocks(&section->map, hits, block_hits);
+
+    const double total = (double)image->sample_count;
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    char buffer[256];
+    for (ZyanUSize i = 0; i < instruction_count; ++i)
+    {
+        ZydisSampleMapInstruction info;
+        ZydisSampleMapGetInstruction(&section->map, i, &info);
+        const ZyanU64 count = block_hits[info.block];
+        if (!count || (count < threshold))
+        {
+            continue;
+        }
+
+        if (info.is_block_start)
+        {
+            ZYAN_PRINTF("\n");
+            PrintLocation(image, info.address);
+            ZYAN_PRINTF(": block %u, %s%" PRIu64 " sample(s) (%.2f%%)%s\n", info.block,
+                CVT100_OUT(COLOR_HOT), count, 100.0 * (double)count / total,
+                CVT100_OUT(ZYAN_VT100SGR_RESET));
+        }
+
+        if (info.is_invalid || !ZYAN_SUCCESS(ZydisDecoderDecodeFull(decoder,
+            image->data + section->offset + info.offset, info.length, &instruction, operands)) ||
+            !ZYAN_SUCCESS(ZydisFormatterFormatInstruction(formatter, &instruction, operands,
+            instruction.operand_count_visible, buffer, sizeof(buffer), info.address,
+            ZYAN_NULL)))
+        {
+            ZYAN_SNPRINTF(buffer, sizeof(buffer), "db 0x%02X",
+                image->data[section->offset + info.offset]);
+        }
+
+        const ZyanU64 instruction_hits = hits[i];
+        ZYAN_PRINTF("%s%7.2f%%%s  %s%016" PRIX64 "%s  %s\n",
+            instruction_hits ? CVT100_OUT(COLOR_HOT) : "",
+            100.0 * (double)instruction_hits / total,
+            instruction_hits ? CVT100_OUT(ZYAN_VT100SGR_RESET) : "",
+            CVT100_OUT(COLOR_ADDRESS), info.address, CVT100_OUT(ZYAN_VT100SGR_RESET), buffer);
+    }
+
+    free(block_hits);
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] [-jobs N] [-binary] " \
+        "[-threshold PERCENT] <input file> <sample file>%s\n", CVT100_ERR(COLOR_ERROR),
+        (argc > 0 ? argv[0] : "ZydisAnnotate"), CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static Image image;
+    VectorInit(&image.sections, sizeof(Section));
+    VectorInit(&image.functions, sizeof(Function));
+    VectorInit(&image.chunks, sizeof(Chunk));
+    image.thread_count = GetProcessorCount();
+    ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+    ZyanBool has_machine_mode = ZYAN_FALSE;
+    ZyanBool is_binary = ZYAN_FALSE;
+    double threshold = 1.0;
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+            stack_width = ZYDIS_STACK_WIDTH_64;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-jobs") && (i + 1 < argc))
+        {
+            image.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!image.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!ZYAN_STRCMP(arg, "-binary"))
+        {
+            is_binary = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-threshold") && (i + 1 < argc))
+        {
+            threshold = strtod(argv[++i], ZYAN_NULL);
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+    if (i + 2 != argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    image.data = ReadFile(argv[i], &image.size);
+    if (!image.data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: can not read file%s\n", CVT100_ERR(COLOR_ERROR),
+            argv[i], CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+    size_t sample_size;
+    char* sample_data = (char*)ReadFile(argv[i + 1], &sample_size);
+    if (!sample_data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: can not read file%s\n", CVT100_ERR(COLOR_ERROR),
+            argv[i + 1], CVT100_ERR(ZYAN_VT100SGR_RESET));
+        free(image.data);
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_FAILURE;
+    const ZyanBool has_samples = ParseSamples(&image, sample_data, sample_size, is_binary);
+    free(sample_data);
+    if (!has_samples)
+    {
+        goto out_of_memory;
+    }
+
+    ZydisDecoderInit(&image.decoder, machine_mode, stack_width);
+    ZydisDecoderEnableMode(&image.decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE);
+    if (!LoadImage(&image, has_machine_mode) || !CreateChunks(&image))
+    {
+        goto out_of_memory;
+    }
+
+    // Phase 1: Record the instruction boundaries in parallel and build the lookup tables
+    const size_t thread_count = image.thread_count;
+    image.phase = PHASE_SWEEP;
+    image.thread_count = ZYAN_MAX(ZYAN_MIN(thread_count, image.chunks.count), 1);
+    if (!RunWorkers(image.thread_count, &RunWorker, &image))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+    if (!BuildMaps(&image))
+    {
+        goto out_of_memory;
+    }
+
+    // Phase 2: Attribute the samples with one set of counters per worker
+    image.phase = PHASE_ATTRIBUTE;
+    image.thread_count =
+        ZYAN_MAX(ZYAN_MIN(thread_count, image.sample_count / SAMPLE_BATCH_SIZE), 1);
+    image.hits = calloc(image.thread_count, sizeof(ZyanU64*));
+    if (!image.hits)
+    {
+        goto out_of_memory;
+    }
+    for (size_t j = 0; j < image.thread_count; ++j)
+    {
+        image.hits[j] = calloc(image.instruction_count ? image.instruction_count : 1,
+            sizeof(ZyanU64));
+        if (!image.hits[j])
+        {
+            goto out_of_memory;
+        }
+    }
+    if (!RunWorkers(image.thread_count, &RunWorker, &image))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+    ZyanU64 attributed = 0;
+    for (size_t j = 0; j < image.instruction_count; ++j)
+    {
+        for (size_t k = 1; k < image.thread_count; ++k)
+        {
+            image.hits[0][j] += image.hits[k][j];
+        }
+        attributed += image.hits[0][j];
+    }
+
+    // Phase 3: Print the hot blocks
+    ZydisDecoder decoder = image.decoder;
+    ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_FALSE);
+    ZydisFormatter formatter;
+    ZydisFormatterInit(&formatter, ZYDIS_FORMATTER_STYLE_INTEL);
+    const double minimum = threshold * (double)image.sample_count / 100.0;
+    const ZyanU64 block_threshold = (minimum > 1.0) ? (ZyanU64)minimum : 1;
+    for (size_t j = 0; j < image.sections.count; ++j)
+    {
+        if (!PrintSection(&image, &VECTOR_AT(&image.sections, Section, j), &decoder,
+            &formatter, block_threshold))
+        {
+            goto out_of_memory;
+        }
+    }
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%zu sample(s), %" PRIu64 " attributed, %zu instruction(s)\n",
+        image.sample_count, attributed, image.instruction_count);
+    result = EXIT_SUCCESS;
+    goto cleanup;
+
+out_of_memory:
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sOut of memory%s\n", CVT100_ERR(COLOR_ERROR),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+
+cleanup:
+    for (size_t j = 0; image.hits && (j < image.thread_count); ++j)
+    {
+        free(image.hits[j]);
+    }
+    free(image.hits);
+    for (size_t j = 0; j < image.sections.count; ++j)
+    {
+        free(VECTOR_AT(&image.sections, Section, j).info);
+        free(VECTOR_AT(&image.sections, Section, j).workspace);
+    }
+    VectorDestroy(&image.chunks);
+    VectorDestroy(&image.functions);
+    VectorDestroy(&image.sections);
+    free(image.samples);
+    free(image.data);
+
+    return result;
+}
+
+/* ============================================================================================== */
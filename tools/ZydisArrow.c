@@ -0,0 +1,403 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Decodes a raw code file using a linear sweep and exports the instructions as an Apache Arrow
+ * IPC file. The file is split into chunks, which are decoded in parallel and written as one
+ * record batch each.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `ChunkJob` struct.
+ */
+typedef struct ChunkJob_
+{
+    /**
+     * The offset of the chunk.
+     */
+    size_t begin;
+    /**
+     * The end offset of the chunk.
+     */
+    size_t end;
+    /**
+     * The offset following the last decoded instruction.
+     */
+    size_t next;
+    /**
+     * The decoded instructions.
+     */
+    ZydisColumnarBatch batch;
+    /**
+     * The status of the decoding.
+     */
+    ZyanStatus status;
+} ChunkJob;
+
+/**
+ * Defines the `ExportContext` struct.
+ */
+typedef struct ExportContext_
+{
+    /**
+     * The decoder.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The code.
+     */
+    const ZyanU8* data;
+    /**
+     * The length of the code.
+     */
+    size_t size;
+    /**
+     * The jobs of the current round.
+     */
+    ChunkJob* jobs;
+    /**
+     * The number of jobs of the current round.
+     */
+    size_t job_count;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} ExportContext;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input and output                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Writes Arrow data to a `FILE` stream.
+ *
+ * @param   user_data   The `FILE` stream.
+ * @param   data        A pointer to the data.
+ * @param   length      The length of the data.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus WriteFile(void* user_data, const void* data, ZyanUSize length)
+{
+    if (fwrite(data, 1, length, (FILE*)user_data) != length)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Decodes every `count`-th chunk of the current round, starting at the index of the worker.
+ *
+ * @param   user_data   A pointer to the `ExportContext` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const ExportContext* context = (const ExportContext*)user_data;
+    for (size_t i = index; i < context->job_count; i += count)
+    {
+        ChunkJob* job = &context->jobs[i];
+        job->batch.count = 0;
+        job->status = ZydisColumnarDecode(&context->decoder, context->data, context->size,
+            job->begin, job->end, &job->batch, &job->next);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Export                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Writes the chunks of the current round in order.
+ *
+ * @param   context     A pointer to the `ExportContext` struct.
+ * @param   writer      A pointer to the `ZydisArrowWriter` instance.
+ * @param   expected    A pointer to the offset at which the next chunk has to continue the
+ *                      linear sweep.
+ * @param   count       Receives the number of written instructions.
+ *
+ * @return  A zyan status code.
+ *
+ * A chunk usually starts inside of the last instruction of the previous chunk, but decoding
+ * resynchronizes within a few instructions. The leading instructions are skipped up to the
+ * first instruction boundary of the sweep. If the chunk does not resynchronize, it is decoded
+ * again from the expected offset.
+ */
+static ZyanStatus WriteChunks(const ExportContext* context, ZydisArrowWriter* writer,
+    size_t* expected, ZyanU64* count)
+{
+    for (size_t i = 0; i < context->job_count; ++i)
+    {
+        ChunkJob* job = &context->jobs[i];
+        ZYAN_CHECK(job->status);
+
+        size_t first = 0;
+        if (*expected != job->begin)
+        {
+            while ((first < job->batch.count) && (job->batch.offset[first] < *expected))
+            {
+                ++first;
+            }
+            if ((first == job->batch.count) || (job->batch.offset[first] != *expected))
+            {
+                first = 0;
+                job->batch.count = 0;
+                ZYAN_CHECK(ZydisColumnarDecode(&context->decoder, context->data, context->size,
+                    *expected, job->end, &job->batch, &job->next));
+            }
+        }
+
+        ZYAN_CHECK(ZydisArrowWriterWriteBatch(writer, &job->batch, first,
+            job->batch.count - first));
+        *count += job->batch.count - first;
+        *expected = job->next;
+    }
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] [-jobs N] [-chunk N] " \
+        "<input file> <output file>%s\n", CVT100_ERR(COLOR_ERROR),
+        (argc > 0 ? argv[0] : "ZydisArrow"), CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static ExportContext context;
+    ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+    size_t chunk_size = 64 * 1024;
+    context.thread_count = GetProcessorCount();
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+            stack_width = ZYDIS_STACK_WIDTH_64;
+        }
+        else if (!ZYAN_STRCMP(arg, "-jobs") && (i + 1 < argc))
+        {
+            context.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!context.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!ZYAN_STRCMP(arg, "-chunk") && (i + 1 < argc))
+        {
+            // Chunks must be longer than any instruction to resynchronize
+            chunk_size = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (chunk_size < ZYDIS_MAX_INSTRUCTION_LENGTH + 1)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (i + 2 != argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&context.decoder, machine_mode, stack_width)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    ZyanU8* data = ReadFile(argv[i], &size);
+    if (!data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not read input file \"%s\"%s\n",
+            CVT100_ERR(COLOR_ERROR), argv[i], CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+    context.data = data;
+    context.size = size;
+
+    FILE* output = fopen(argv[i + 1], "wb");
+    if (!output)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not open output file \"%s\"%s\n",
+            CVT100_ERR(COLOR_ERROR), argv[i + 1], CVT100_ERR(ZYAN_VT100SGR_RESET));
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    // Every byte may start an instruction, so a batch holds as many instructions as the chunk
+    // has bytes
+    const size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+    ZyanUSize workspace_size;
+    ZyanStatus status = ZydisColumnarGetWorkspaceSize(chunk_size, &workspace_size);
+    ChunkJob* jobs = calloc(context.thread_count, sizeof(ChunkJob));
+    ZyanU64** workspaces = calloc(context.thread_count, sizeof(ZyanU64*));
+    ZydisArrowBlock* blocks = calloc(chunk_count ? chunk_count : 1, sizeof(ZydisArrowBlock));
+    if (jobs && workspaces && blocks)
+    {
+        for (size_t j = 0; ZYAN_SUCCESS(status) && (j < context.thread_count); ++j)
+        {
+            workspaces[j] = malloc(workspace_size);
+            status = workspaces[j]
+                ? ZydisColumnarBatchInit(&jobs[j].batch, chunk_size, workspaces[j],
+                    workspace_size)
+                : ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+        }
+    }
+    else
+    {
+        status = ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+    }
+
+    ZydisArrowWriter writer;
+    if (ZYAN_SUCCESS(status))
+    {
+        status = ZydisArrowWriterInit(&writer, &WriteFile, output, blocks, chunk_count);
+    }
+
+    // The chunks are decoded in rounds of one chunk per thread to bound the memory usage
+    size_t expected = 0;
+    ZyanU64 instruction_count = 0;
+    ZyanBool all_started = ZYAN_TRUE;
+    context.jobs = jobs;
+    for (size_t chunk = 0; ZYAN_SUCCESS(status) && (chunk < chunk_count);
+        chunk += context.thread_count)
+    {
+        context.job_count = ZYAN_MIN(context.thread_count, chunk_count - chunk);
+        for (size_t j = 0; j < context.job_count; ++j)
+        {
+            jobs[j].begin = (chunk + j) * chunk_size;
+            jobs[j].end = ZYAN_MIN(jobs[j].begin + chunk_size, size);
+        }
+        all_started &= RunWorkers(context.thread_count, &RunWorker, &context);
+        status = WriteChunks(&context, &writer, &expected, &instruction_count);
+    }
+    if (ZYAN_SUCCESS(status))
+    {
+        status = ZydisArrowWriterFinish(&writer);
+    }
+
+    if (fclose(output) && ZYAN_SUCCESS(status))
+    {
+        status = ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    for (size_t j = 0; workspaces && (j < context.thread_count); ++j)
+    {
+        free(workspaces[j]);
+    }
+    free(workspaces);
+    free(jobs);
+    free(blocks);
+    free(data);
+
+    if (!all_started)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+    if (!ZYAN_SUCCESS(status))
+    {
+        PrintStatusError(status, "Failed to export instructions");
+        return EXIT_FAILURE;
+    }
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%" PRIu64 " instruction(s) in %zu record batch(es)\n",
+        instruction_count, chunk_count);
+
+    return EXIT_SUCCESS;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,683 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Scans the functions of raw code files or ELF files for AVX/SSE transition penalties. The
+ * functions are analyzed in parallel.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_FILE      ZYAN_VT100SGR_FG_BRIGHT_WHITE
+#define COLOR_ADDRESS   ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_HAZARD    ZYAN_VT100SGR_FG_BRIGHT_YELLOW
+#define COLOR_SYMBOL    ZYAN_VT100SGR_FG_CYAN
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `OutputBuffer` struct.
+ */
+typedef struct OutputBuffer_
+{
+    /**
+     * The buffer data.
+     */
+    char* data;
+    /**
+     * The number of used bytes.
+     */
+    size_t size;
+    /**
+     * The number of allocated bytes.
+     */
+    size_t capacity;
+} OutputBuffer;
+
+/**
+ * Defines the `InputFile` struct.
+ */
+typedef struct InputFile_
+{
+    /**
+     * The path of the file.
+     */
+    const char* path;
+    /**
+     * The file data.
+     */
+    ZyanU8* data;
+    /**
+     * The file size.
+     */
+    size_t size;
+    /**
+     * The decoder used for all functions of this file.
+     */
+    ZydisDecoder decoder;
+    /**
+     * Signals, if the file could not be processed completely.
+     */
+    ZyanBool failed;
+} InputFile;
+
+/**
+ * Defines the `FunctionJob` struct.
+ */
+typedef struct FunctionJob_
+{
+    /**
+     * The file that contains the function.
+     */
+    const InputFile* file;
+    /**
+     * The name of the function or `ZYAN_NULL`, if unknown.
+     */
+    const char* name;
+    /**
+     * The file offset of the function.
+     */
+    size_t offset;
+    /**
+     * The length of the function.
+     */
+    size_t length;
+    /**
+     * The runtime address of the function.
+     */
+    ZyanU64 address;
+    /**
+     * The buffered report.
+     */
+    OutputBuffer output;
+    /**
+     * The number of hazards found for each hazard type.
+     */
+    ZyanU64 counts[ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE + 1];
+} FunctionJob;
+
+/**
+ * Defines the `CheckContext` struct.
+ */
+typedef struct CheckContext_
+{
+    /**
+     * The input files.
+     */
+    InputFile* files;
+    /**
+     * The number of input files.
+     */
+    size_t file_count;
+    /**
+     * The functions.
+     */
+    FunctionJob* jobs;
+    /**
+     * The number of functions.
+     */
+    size_t job_count;
+    /**
+     * The number of allocated function entries.
+     */
+    size_t job_capacity;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} CheckContext;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Appends formatted text to the given output buffer.
+ *
+ * @param   buffer  A pointer to the `OutputBuffer` struct.
+ * @param   format  The format string.
+ */
+static void Append(OutputBuffer* buffer, const char* format, ...)
+{
+    va_list args;
+    for (;;)
+    {
+        const size_t available = buffer->capacity - buffer->size;
+        va_start(args, format);
+        const int written = vsnprintf(buffer->data + buffer->size, available, format, args);
+        va_end(args);
+        if (written < 0)
+        {
+            return;
+        }
+        if ((size_t)written < available)
+        {
+            buffer->size += (size_t)written;
+            return;
+        }
+
+        const size_t capacity = (buffer->capacity + written + 1) * 2;
+        char* data = realloc(buffer->data, capacity);
+        if (!data)
+        {
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+/**
+ * Returns a short name for the given hazard type.
+ *
+ * @param   type    The hazard type.
+ *
+ * @return  The hazard name.
+ */
+static const char* GetHazardName(ZydisAvxTransitionHazardType type)
+{
+    static const char* names[] =
+    {
+        "sse-while-dirty",
+        "call-while-dirty",
+        "return-while-dirty"
+    };
+    ZYAN_STATIC_ASSERT(ZYAN_ARRAY_LENGTH(names) == ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE + 1);
+
+    return names[type];
+}
+
+/**
+ * Formats a single hazard into the output buffer of the current function.
+ *
+ * @param   hazard      A pointer to the `ZydisAvxTransitionHazard` struct.
+ * @param   user_data   A pointer to the `FunctionJob` struct.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus OnHazard(const ZydisAvxTransitionHazard* hazard, void* user_data)
+{
+    FunctionJob* job = (FunctionJob*)user_data;
+
+    ++job->counts[hazard->type];
+
+    Append(&job->output, "%s%s%s:%s%016" PRIX64 "%s: %s%s%s: ",
+        CVT100_OUT(COLOR_FILE), job->file->path, CVT100_OUT(ZYAN_VT100SGR_RESET),
+        CVT100_OUT(COLOR_ADDRESS), hazard->address, CVT100_OUT(ZYAN_VT100SGR_RESET),
+        CVT100_OUT(COLOR_HAZARD), GetHazardName(hazard->type), CVT100_OUT(ZYAN_VT100SGR_RESET));
+    if (job->name)
+    {
+        Append(&job->output, "%s%s+0x%zX%s: ", CVT100_OUT(COLOR_SYMBOL), job->name,
+            (size_t)hazard->offset, CVT100_OUT(ZYAN_VT100SGR_RESET));
+    }
+    Append(&job->output, "%s\n", ZydisMnemonicGetString(hazard->mnemonic));
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Adds a function to the job list.
+ *
+ * @param   context A pointer to the `CheckContext` struct.
+ * @param   file    A pointer to the `InputFile` struct.
+ * @param   name    The name of the function or `ZYAN_NULL`.
+ * @param   offset  The file offset of the function.
+ * @param   length  The length of the function.
+ * @param   address The runtime address of the function.
+ *
+ * @return  `ZYAN_TRUE`, if the function was added or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool AddFunction(CheckContext* context, const InputFile* file, const char* name,
+    size_t offset, size_t length, ZyanU64 address)
+{
+    if (context->job_count == context->job_capacity)
+    {
+        const size_t capacity = context->job_capacity ? context->job_capacity * 2 : 256;
+        FunctionJob* jobs = realloc(context->jobs, capacity * sizeof(FunctionJob));
+        if (!jobs)
+        {
+            return ZYAN_FALSE;
+        }
+        context->jobs = jobs;
+        context->job_capacity = capacity;
+    }
+
+    FunctionJob* job = &context->jobs[context->job_count++];
+    ZYAN_MEMSET(job, 0, sizeof(*job));
+    job->file = file;
+    job->name = name;
+    job->offset = offset;
+    job->length = length;
+    job->address = address;
+    return ZYAN_TRUE;
+}
+
+/**
+ * Collects the functions of a little-endian ELF file from its symbol tables. If the file has no
+ * function symbols, every executable section is treated as a single function.
+ *
+ * @param   context A pointer to the `CheckContext` struct.
+ * @param   file    A pointer to the `InputFile` struct.
+ * @param   mode    The machine mode to use or `ZYDIS_MACHINE_MODE_MAX_VALUE` to derive it from
+ *                  the ELF class.
+ *
+ * @return  `ZYAN_TRUE`, if the file is a supported ELF file or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool CollectELF(CheckContext* context, InputFile* file, ZydisMachineMode mode)
+{
+    const ZyanU8* data = file->data;
+    const size_t size = file->size;
+    if ((size < 0x34) || ZYAN_MEMCMP(data, "\x7F" "ELF", 4) || (data[5] != 1))
+    {
+        return ZYAN_FALSE;
+    }
+
+    const ZyanBool is_64 = (data[4] == 2);
+    if ((!is_64 && (data[4] != 1)) || (is_64 && (size < 0x40)))
+    {
+        return ZYAN_FALSE;
+    }
+
+    if (mode == ZYDIS_MACHINE_MODE_MAX_VALUE)
+    {
+        ZydisDecoderInit(&file->decoder,
+            is_64 ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
+            is_64 ? ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32);
+    }
+
+    ElfSectionTable sections;
+    if (!ReadSectionTable(data, size, is_64, &sections))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: malformed section header table%s\n",
+            CVT100_ERR(COLOR_ERROR), file->path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        file->failed = ZYAN_TRUE;
+        return ZYAN_TRUE;
+    }
+
+    const size_t first_job = context->job_count;
+    ElfSection table;
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ReadSection(&sections, i, &table);
+        // `SHT_SYMTAB` and `SHT_DYNSYM`
+        if (((table.type != 2) && (table.type != 11)) ||
+            (table.entry_size < (is_64 ? 24u : 16u)) || (table.link >= sections.count) ||
+            (table.offset > size) || (table.size > size - table.offset))
+        {
+            continue;
+        }
+
+        ElfSection strings;
+        ReadSection(&sections, table.link, &strings);
+        if ((strings.offset > size) || (strings.size > size - strings.offset))
+        {
+            continue;
+        }
+        const char* string_data = (const char*)data + strings.offset;
+
+        for (ZyanU64 j = 0; j + table.entry_size <= table.size; j += table.entry_size)
+        {
+            const ZyanU8* symbol = data + table.offset + j;
+            const ZyanU32 name   = (ZyanU32)ReadLE(symbol, 4);
+            const ZyanU8  info   = is_64 ? symbol[0x04] : symbol[0x0C];
+            const ZyanU16 shndx  = (ZyanU16)ReadLE(symbol + (is_64 ? 0x06 : 0x0E), 2);
+            const ZyanU64 value  = is_64 ? ReadLE(symbol + 0x08, 8) : ReadLE(symbol + 0x04, 4);
+            const ZyanU64 length = is_64 ? ReadLE(symbol + 0x10, 8) : ReadLE(symbol + 0x08, 4);
+
+            // `STT_FUNC` symbols defined in a regular section
+            if (((info & 0xF) != 2) || !shndx || (shndx >= sections.count) || !length)
+            {
+                continue;
+            }
+
+            ElfSection section;
+            ReadSection(&sections, shndx, &section);
+            if ((section.type == 8) || !(section.flags & 0x4) || (value < section.address) ||
+                (value - section.address >= section.size) || (section.offset > size) ||
+                (section.size > size - section.offset))
+            {
+                continue;
+            }
+
+            const ZyanU64 offset = value - section.address;
+            const char* symbol_name = ZYAN_NULL;
+            if ((name < strings.size) &&
+                ZYAN_MEMCHR(string_data + name, '\0', (size_t)(strings.size - name)))
+            {
+                symbol_name = string_data + name;
+            }
+            if (!AddFunction(context, file, symbol_name, (size_t)(section.offset + offset),
+                (size_t)ZYAN_MIN(length, section.size - offset), value))
+            {
+                file->failed = ZYAN_TRUE;
+                return ZYAN_TRUE;
+            }
+        }
+    }
+
+    if (context->job_count == first_job)
+    {
+        // Stripped binary
+        ElfSection section;
+        for (ZyanU64 i = 0; i < sections.count; ++i)
+        {
+            ReadSection(&sections, i, &section);
+            if ((section.type == 8) || !(section.flags & 0x4) || !section.size ||
+                (section.offset > size) || (section.size > size - section.offset))
+            {
+                continue;
+            }
+            if (!AddFunction(context, file, ZYAN_NULL, (size_t)section.offset,
+                (size_t)section.size, section.address))
+            {
+                file->failed = ZYAN_TRUE;
+                return ZYAN_TRUE;
+            }
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Orders functions by file and address.
+ *
+ * @param   a   A pointer to the first `FunctionJob` struct.
+ * @param   b   A pointer to the second `FunctionJob` struct.
+ *
+ * @return  The comparison result.
+ */
+static int CompareFunctions(const void* a, const void* b)
+{
+    const FunctionJob* lhs = (const FunctionJob*)a;
+    const FunctionJob* rhs = (const FunctionJob*)b;
+    if (lhs->file != rhs->file)
+    {
+        return (lhs->file < rhs->file) ? -1 : 1;
+    }
+    if (lhs->address != rhs->address)
+    {
+        return (lhs->address < rhs->address) ? -1 : 1;
+    }
+    // Prefer named symbols over anonymous ones
+    return (lhs->name ? 0 : 1) - (rhs->name ? 0 : 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Analyzes every `count`-th function, starting at the index of the worker.
+ *
+ * @param   user_data   A pointer to the `CheckContext` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const CheckContext* context = (const CheckContext*)user_data;
+
+    void* workspace = ZYAN_NULL;
+    size_t workspace_capacity = 0;
+    for (size_t i = index; i < context->job_count; i += count)
+    {
+        FunctionJob* job = &context->jobs[i];
+
+        ZyanUSize workspace_size;
+        if (!ZYAN_SUCCESS(ZydisAvxTransitionGetWorkspaceSize(job->length, &workspace_size)))
+        {
+            Append(&job->output, "%s: function at %016" PRIX64 " is too large\n",
+                job->file->path, job->address);
+            continue;
+        }
+        if (workspace_size > workspace_capacity)
+        {
+            free(workspace);
+            workspace = malloc(workspace_size);
+            workspace_capacity = workspace ? workspace_size : 0;
+            if (!workspace)
+            {
+                Append(&job->output, "%s: out of memory\n", job->file->path);
+                continue;
+            }
+        }
+
+        ZydisAvxTransitionAnalyze(&job->file->decoder, job->file->data + job->offset,
+            job->length, job->address, workspace, workspace_size, &OnHazard, job);
+    }
+
+    free(workspace);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] [-jobs N] <input file>...%s\n",
+        CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "ZydisAvxCheck"),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static CheckContext context;
+    context.thread_count = GetProcessorCount();
+    ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_MAX_VALUE;
+    ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+            stack_width = ZYDIS_STACK_WIDTH_64;
+        }
+        else if (!ZYAN_STRCMP(arg, "-jobs") && (i + 1 < argc))
+        {
+            context.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!context.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (i >= argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    context.file_count = (size_t)(argc - i);
+    context.files = calloc(context.file_count, sizeof(InputFile));
+    if (!context.files)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sOut of memory%s\n", CVT100_ERR(COLOR_ERROR),
+            CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    ZyanBool failed = ZYAN_FALSE;
+    for (size_t j = 0; j < context.file_count; ++j)
+    {
+        InputFile* file = &context.files[j];
+        file->path = argv[i + j];
+        file->data = ReadFile(file->path, &file->size);
+        if (!file->data)
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: can not read file%s\n", CVT100_ERR(COLOR_ERROR),
+                file->path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+            failed = ZYAN_TRUE;
+            continue;
+        }
+
+        if (machine_mode != ZYDIS_MACHINE_MODE_MAX_VALUE)
+        {
+            ZydisDecoderInit(&file->decoder, machine_mode, stack_width);
+        }
+        if (!CollectELF(&context, file, machine_mode))
+        {
+            if (machine_mode == ZYDIS_MACHINE_MODE_MAX_VALUE)
+            {
+                ZydisDecoderInit(&file->decoder, ZYDIS_MACHINE_MODE_LONG_64,
+                    ZYDIS_STACK_WIDTH_64);
+            }
+            if (!AddFunction(&context, file, ZYAN_NULL, 0, file->size, 0))
+            {
+                file->failed = ZYAN_TRUE;
+            }
+        }
+        failed |= file->failed;
+    }
+
+    // Symbol tables frequently contain aliases, so only keep one entry per address
+    if (context.job_count)
+    {
+        qsort(context.jobs, context.job_count, sizeof(FunctionJob), &CompareFunctions);
+        size_t count = 1;
+        for (size_t j = 1; j < context.job_count; ++j)
+        {
+            if ((context.jobs[j].file != context.jobs[count - 1].file) ||
+                (context.jobs[j].address != context.jobs[count - 1].address))
+            {
+                context.jobs[count++] = context.jobs[j];
+            }
+        }
+        context.job_count = count;
+    }
+    if (context.thread_count > context.job_count)
+    {
+        context.thread_count = context.job_count ? context.job_count : 1;
+    }
+
+    if (!RunWorkers(context.thread_count, &RunWorker, &context))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+
+    ZyanU64 totals[ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE + 1] = { 0 };
+    for (size_t j = 0; j < context.job_count; ++j)
+    {
+        FunctionJob* job = &context.jobs[j];
+        if (job->output.size)
+        {
+            fwrite(job->output.data, 1, job->output.size, ZYAN_STDOUT);
+        }
+        for (int k = 0; k <= ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE; ++k)
+        {
+            totals[k] += job->counts[k];
+        }
+        free(job->output.data);
+    }
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%zu file(s), %zu function(s):", context.file_count,
+        context.job_count);
+    for (int k = 0; k <= ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE; ++k)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, " %s %" PRIu64 "%s",
+            GetHazardName((ZydisAvxTransitionHazardType)k), totals[k],
+            (k < ZYDIS_AVX_TRANSITION_HAZARD_MAX_VALUE) ? "," : "\n");
+    }
+
+    for (size_t j = 0; j < context.file_count; ++j)
+    {
+        free(context.files[j].data);
+    }
+    free(context.files);
+    free(context.jobs);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* ============================================================================================== */
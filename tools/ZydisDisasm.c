@@ -100,6 +100,47 @@ static void PrintDisassembly(const ZydisFormatter* formatter,
     PrintTokenizedInstruction(token);
 }
 
+/**
+ * Writes the instruction runtime address to the output sink.
+ *
+ * @param   sink            A pointer to the `ZydisSink` instance.
+ * @param   runtime_address The runtime address of the instruction.
+ */
+static void WriteRuntimeAddress(ZydisSink* sink, ZyanU64 runtime_address)
+{
+    char* buffer;
+    ZyanStatus status;
+    if (!ZYAN_SUCCESS(status = ZydisSinkReserve(sink, 32, &buffer)) ||
+        !ZYAN_SUCCESS(status = ZydisSinkCommit(sink,
+            (ZyanUSize)snprintf(buffer, 32, "%016" PRIX64 " ", runtime_address))))
+    {
+        PrintStatusError(status, "Failed to write output");
+        exit(status);
+    }
+}
+
+/**
+ * Writes the formatted instruction disassembly to the output sink.
+ *
+ * @param   sink            A pointer to the `ZydisSink` instance.
+ * @param   formatter       A pointer to the `ZydisFormatter` instance.
+ * @param   instruction     A pointer to the `ZydisDecodedInstruction` struct.
+ * @param   operands        A pointer to the first `ZydisDecodedOperand` struct of the instruction.
+ * @param   runtime_address The runtime address of the instruction.
+ */
+static void WriteDisassembly(ZydisSink* sink, const ZydisFormatter* formatter,
+    const ZydisDecodedInstruction* instruction, const ZydisDecodedOperand* operands,
+    ZyanU64 runtime_address)
+{
+    ZyanStatus status;
+    if (!ZYAN_SUCCESS(status = ZydisSinkFormatInstruction(sink, formatter, instruction, operands,
+        instruction->operand_count_visible, runtime_address, ZYAN_NULL)))
+    {
+        PrintStatusError(status, "Failed to format instruction");
+        exit(status);
+    }
+}
+
 /* ============================================================================================== */
 /* Entry point                                                                                    */
 /* ============================================================================================== */
@@ -180,6 +221,18 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    // Without colors, the output is formatted directly into a large buffer that is written in
+    // big chunks instead of printing it token by token
+    static char output[64 * 1024];
+    ZydisSink sink;
+    if (!g_vt100_stdout &&
+        !ZYAN_SUCCESS(ZydisSinkInitFile(&sink, output, sizeof(output), ZYAN_STDOUT)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize output sink%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
     ZyanU8 buffer[1024];
     ZyanUSize buffer_size;
     ZyanUSize buffer_remaining = 0;
@@ -208,6 +261,26 @@ int main(int argc, char** argv)
         {
             const ZyanU64 runtime_address = read_offset_base + read_offset;
 
+            if (!g_vt100_stdout)
+            {
+                WriteRuntimeAddress(&sink, runtime_address);
+                if (!ZYAN_SUCCESS(status))
+                {
+                    char line[16];
+                    const int length = snprintf(line, sizeof(line), "db %02X\n",
+                        buffer[read_offset++]);
+                    if (!ZYAN_SUCCESS(status = ZydisSinkWrite(&sink, line, (ZyanUSize)length)))
+                    {
+                        PrintStatusError(status, "Failed to write output");
+                        return status;
+                    }
+                    continue;
+                }
+                WriteDisassembly(&sink, &formatter, &instruction, operands, runtime_address);
+                read_offset += instruction.length;
+                continue;
+            }
+
             PrintRuntimeAddress(runtime_address);
 
             if (!ZYAN_SUCCESS(status))
@@ -232,6 +305,13 @@ int main(int argc, char** argv)
         read_offset_base += read_offset;
     } while (buffer_size == sizeof(buffer));
 
+    ZyanStatus status;
+    if (!g_vt100_stdout && !ZYAN_SUCCESS(status = ZydisSinkDestroy(&sink)))
+    {
+        PrintStatusError(status, "Failed to write output");
+        return status;
+    }
+
     return EXIT_SUCCESS;
 }
 
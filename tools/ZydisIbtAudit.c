@@ -0,0 +1,1182 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Audits the indirect branch tracking (`CET` `IBT`) landing pads of an ELF file. Reports indirect
+ * branch targets that do not start with `endbr` and `endbr` instructions at the start of
+ * functions that are only ever called directly.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_ADDRESS   ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_HAZARD    ZYAN_VT100SGR_FG_BRIGHT_YELLOW
+#define COLOR_SYMBOL    ZYAN_VT100SGR_FG_CYAN
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The minimum number of bytes swept by a single work item.
+ */
+#define CHUNK_SIZE 0x10000
+
+/**
+ * The maximum number of entries of a single jump table.
+ */
+#define MAX_JUMP_TABLE_ENTRIES 0x10000
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `TargetReason` enum.
+ */
+typedef enum TargetReason_
+{
+    TARGET_REASON_LEA           = 0x01,
+    TARGET_REASON_IMMEDIATE     = 0x02,
+    TARGET_REASON_RELOCATION    = 0x04,
+    TARGET_REASON_EXPORT        = 0x08,
+    TARGET_REASON_ENTRY         = 0x10,
+    TARGET_REASON_JUMP_TABLE    = 0x20,
+    TARGET_REASON_DATA          = 0x40
+} TargetReason;
+
+/**
+ * Defines the `Section` struct.
+ */
+typedef struct Section_
+{
+    /**
+     * The runtime address of the section.
+     */
+    ZyanU64 address;
+    /**
+     * The file offset of the section.
+     */
+    ZyanU64 offset;
+    /**
+     * The size of the section.
+     */
+    ZyanU64 size;
+    /**
+     * Signals, if the section contains code.
+     */
+    ZyanBool is_executable;
+} Section;
+
+/**
+ * Defines the `Function` struct.
+ */
+typedef struct Function_
+{
+    /**
+     * The runtime address of the function.
+     */
+    ZyanU64 address;
+    /**
+     * The size of the function.
+     */
+    ZyanU64 size;
+    /**
+     * The name of the function or `ZYAN_NULL`.
+     */
+    const char* name;
+    /**
+     * Signals, if the function is exported and thus might be address-taken by other modules.
+     */
+    ZyanBool is_exported;
+    /**
+     * Signals, if the function is the target of a direct call or jump.
+     */
+    ZyanBool is_direct_target;
+    /**
+     * Signals, if the function contains an indirect jump without `notrack` prefix.
+     */
+    ZyanBool has_tracked_jump;
+} Function;
+
+/**
+ * Defines the `Target` struct.
+ */
+typedef struct Target_
+{
+    /**
+     * The runtime address of the target.
+     */
+    ZyanU64 address;
+    /**
+     * A combination of `TargetReason` values.
+     */
+    ZyanU32 reasons;
+} Target;
+
+/**
+ * Defines the `Chunk` struct.
+ */
+typedef struct Chunk_
+{
+    /**
+     * The runtime address of the chunk.
+     */
+    ZyanU64 address;
+    /**
+     * The file offset of the chunk.
+     */
+    ZyanU64 offset;
+    /**
+     * The size of the chunk.
+     */
+    ZyanU64 size;
+    /**
+     * The references found in this chunk.
+     */
+    Vector references;
+    /**
+     * Signals, if the sweep ran out of memory.
+     */
+    ZyanBool failed;
+} Chunk;
+
+/**
+ * Defines the `Image` struct.
+ */
+typedef struct Image_
+{
+    /**
+     * The path of the file.
+     */
+    const char* path;
+    /**
+     * The file data.
+     */
+    ZyanU8* data;
+    /**
+     * The file size.
+     */
+    size_t size;
+    /**
+     * Signals, if the file is an ELF64 file.
+     */
+    ZyanBool is_64;
+    /**
+     * Signals, if the image is position-dependent (`ET_EXEC`).
+     */
+    ZyanBool is_position_dependent;
+    /**
+     * The decoder.
+     */
+    ZydisDecoder decoder;
+    /**
+     * The allocated sections with file contents (`Section`), sorted by address.
+     */
+    Vector sections;
+    /**
+     * The functions (`Function`), sorted by address.
+     */
+    Vector functions;
+    /**
+     * The indirect branch targets (`Target`).
+     */
+    Vector targets;
+    /**
+     * The work items (`Chunk`).
+     */
+    Vector chunks;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} Image;
+
+/**
+ * Defines the `SweepContext` struct.
+ */
+typedef struct SweepContext_
+{
+    /**
+     * A pointer to the image.
+     */
+    const Image* image;
+    /**
+     * A pointer to the current chunk.
+     */
+    Chunk* chunk;
+} SweepContext;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Lookup                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Finds the section that contains the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  A pointer to the section or `ZYAN_NULL`, if not found.
+ */
+static const Section* FindSection(const Image* image, ZyanU64 address)
+{
+    size_t lo = 0;
+    size_t hi = image->sections.count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        const Section* section = &VECTOR_AT(&image->sections, const Section, mid);
+        if (address < section->address)
+        {
+            hi = mid;
+        }
+        else if (address - section->address >= section->size)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return section;
+        }
+    }
+    return ZYAN_NULL;
+}
+
+/**
+ * Finds the function with the greatest start address less than or equal to the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  A pointer to the function or `ZYAN_NULL`, if not found.
+ */
+static Function* FindFunction(const Image* image, ZyanU64 address)
+{
+    size_t lo = 0;
+    size_t hi = image->functions.count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (VECTOR_AT(&image->functions, Function, mid).address <= address)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo ? &VECTOR_AT(&image->functions, Function, lo - 1) : ZYAN_NULL;
+}
+
+/**
+ * Finds the function that contains the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  A pointer to the function or `ZYAN_NULL`, if not found.
+ */
+static Function* FindContainingFunction(const Image* image, ZyanU64 address)
+{
+    Function* function = FindFunction(image, address);
+    if (function && (address - function->address < function->size))
+    {
+        return function;
+    }
+    return ZYAN_NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Sorting                                                                                        */
+/* ---------------------------------------------------------------------------------------------- */
+
+static int CompareSections(const void* a, const void* b)
+{
+    const ZyanU64 lhs = ((const Section*)a)->address;
+    const ZyanU64 rhs = ((const Section*)b)->address;
+    return (lhs < rhs) ? -1 : (lhs > rhs);
+}
+
+static int CompareFunctions(const void* a, const void* b)
+{
+    const Function* lhs = (const Function*)a;
+    const Function* rhs = (const Function*)b;
+    if (lhs->address != rhs->address)
+    {
+        return (lhs->address < rhs->address) ? -1 : 1;
+    }
+    // Prefer named symbols over anonymous ones
+    return (lhs->name ? 0 : 1) - (rhs->name ? 0 : 1);
+}
+
+static int CompareTargets(const void* a, const void* b)
+{
+    const ZyanU64 lhs = ((const Target*)a)->address;
+    const ZyanU64 rhs = ((const Target*)b)->address;
+    return (lhs < rhs) ? -1 : (lhs > rhs);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Image loading                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Adds an indirect branch target, if it points into an executable section.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address of the target.
+ * @param   reason  The `TargetReason`.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool AddTarget(Image* image, ZyanU64 address, TargetReason reason)
+{
+    const Section* section = FindSection(image, address);
+    if (!section || !section->is_executable)
+    {
+        return ZYAN_TRUE;
+    }
+
+    Target target;
+    target.address = address;
+    target.reasons = reason;
+    return VectorPush(&image->targets, &target);
+}
+
+/**
+ * Reads a pointer-sized value at the given runtime address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ * @param   size    The size of the value.
+ * @param   value   Receives the value.
+ *
+ * @return  `ZYAN_TRUE`, if the address is backed by file contents or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool ReadAt(const Image* image, ZyanU64 address, size_t size, ZyanU64* value)
+{
+    const Section* section = FindSection(image, address);
+    if (!section || (section->size - (address - section->address) < size))
+    {
+        return ZYAN_FALSE;
+    }
+    *value = ReadLE(image->data + section->offset + (address - section->address), size);
+    return ZYAN_TRUE;
+}
+
+/**
+ * Parses the section headers, symbol tables and relocations of the given ELF file.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool LoadImage(Image* image)
+{
+    const ZyanU8* data = image->data;
+    const size_t size = image->size;
+    if ((size < 0x34) || ZYAN_MEMCMP(data, "\x7F" "ELF", 4) || (data[5] != 1) ||
+        ((data[4] != 1) && (data[4] != 2)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: not a little-endian ELF file%s\n",
+            CVT100_ERR(COLOR_ERROR), image->path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return ZYAN_FALSE;
+    }
+
+    const ZyanBool is_64 = (data[4] == 2);
+    if (is_64 && (size < 0x40))
+    {
+        return ZYAN_FALSE;
+    }
+    image->is_64 = is_64;
+    image->is_position_dependent = (ReadLE(data + 0x10, 2) == 2);
+
+    const ZyanU64 entry = is_64 ? ReadLE(data + 0x18, 8) : ReadLE(data + 0x18, 4);
+    ElfSectionTable sections;
+    if (!ReadSectionTable(data, size, is_64, &sections))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: malformed section header table%s\n",
+            CVT100_ERR(COLOR_ERROR), image->path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return ZYAN_FALSE;
+    }
+
+    // Sections
+    ElfSection header;
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ReadSection(&sections, i, &header);
+        // `SHF_ALLOC` sections except `SHT_NOBITS`
+        if (!(header.flags & 0x2) || (header.type == 8) || !header.size ||
+            (header.offset > size) || (header.size > size - header.offset))
+        {
+            continue;
+        }
+
+        Section section;
+        section.address = header.address;
+        section.offset = header.offset;
+        section.size = header.size;
+        section.is_executable = (header.flags & 0x4) ? ZYAN_TRUE : ZYAN_FALSE;
+        if (!VectorPush(&image->sections, &section))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+    qsort(image->sections.data, image->sections.count, sizeof(Section), &CompareSections);
+
+    // Functions
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ElfSection table;
+        ReadSection(&sections, i, &table);
+        // `SHT_SYMTAB` and `SHT_DYNSYM`
+        if (((table.type != 2) && (table.type != 11)) ||
+            (table.entry_size < (is_64 ? 24u : 16u)) || (table.link >= sections.count) ||
+            (table.offset > size) || (table.size > size - table.offset))
+        {
+            continue;
+        }
+
+        ElfSection strings;
+        ReadSection(&sections, table.link, &strings);
+        if ((strings.offset > size) || (strings.size > size - strings.offset))
+        {
+            continue;
+        }
+        const char* string_data = (const char*)data + strings.offset;
+
+        for (ZyanU64 j = 0; j + table.entry_size <= table.size; j += table.entry_size)
+        {
+            const ZyanU8* symbol = data + table.offset + j;
+            const ZyanU32 name   = (ZyanU32)ReadLE(symbol, 4);
+            const ZyanU8  info   = is_64 ? symbol[0x04] : symbol[0x0C];
+            const ZyanU8  other  = is_64 ? symbol[0x05] : symbol[0x0D];
+            const ZyanU16 shndx  = (ZyanU16)ReadLE(symbol + (is_64 ? 0x06 : 0x0E), 2);
+            const ZyanU64 value  = is_64 ? ReadLE(symbol + 0x08, 8) : ReadLE(symbol + 0x04, 4);
+            const ZyanU64 length = is_64 ? ReadLE(symbol + 0x10, 8) : ReadLE(symbol + 0x08, 4);
+
+            // `STT_FUNC` and `STT_GNU_IFUNC` symbols defined in a regular section
+            if ((((info & 0xF) != 2) && ((info & 0xF) != 10)) || !shndx || (shndx >= 0xFF00))
+            {
+                continue;
+            }
+            const Section* section = FindSection(image, value);
+            if (!section || !section->is_executable)
+            {
+                continue;
+            }
+
+            Function function;
+            ZYAN_MEMSET(&function, 0, sizeof(function));
+            function.address = value;
+            function.size = ZYAN_MIN(length, section->size - (value - section->address));
+            if ((name < strings.size) &&
+                ZYAN_MEMCHR(string_data + name, '\0', (size_t)(strings.size - name)))
+            {
+                function.name = string_data + name;
+            }
+            // Global or weak symbols with default visibility in the dynamic symbol table
+            function.is_exported = (table.type == 11) && (((info >> 4) == 1) ||
+                ((info >> 4) == 2)) && !(other & 0x3);
+            if (!VectorPush(&image->functions, &function))
+            {
+                return ZYAN_FALSE;
+            }
+            if (function.is_exported && !AddTarget(image, value, TARGET_REASON_EXPORT))
+            {
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    // Aliases are merged into a single entry per address
+    qsort(image->functions.data, image->functions.count, sizeof(Function), &CompareFunctions);
+    size_t count = 0;
+    for (size_t i = 0; i < image->functions.count; ++i)
+    {
+        const Function* function = &VECTOR_AT(&image->functions, Function, i);
+        if (count && (VECTOR_AT(&image->functions, Function, count - 1).address ==
+            function->address))
+        {
+            Function* previous = &VECTOR_AT(&image->functions, Function, count - 1);
+            previous->size = ZYAN_MAX(previous->size, function->size);
+            previous->is_exported |= function->is_exported;
+            continue;
+        }
+        VECTOR_AT(&image->functions, Function, count++) = *function;
+    }
+    image->functions.count = count;
+
+    // Relocations
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ElfSection table;
+        ReadSection(&sections, i, &table);
+        // `SHT_RELA` and `SHT_REL`
+        const ZyanBool has_addend = (table.type == 4);
+        if ((!has_addend && (table.type != 9)) ||
+            (table.entry_size < (is_64 ? 16u : 8u) + (has_addend ? (is_64 ? 8u : 4u) : 0u)) ||
+            (table.offset > size) || (table.size > size - table.offset))
+        {
+            continue;
+        }
+
+        ElfSection symbols;
+        ZYAN_MEMSET(&symbols, 0, sizeof(symbols));
+        if (table.link && (table.link < sections.count))
+        {
+            ReadSection(&sections, table.link, &symbols);
+            if ((symbols.offset > size) || (symbols.size > size - symbols.offset) ||
+                (symbols.entry_size < (is_64 ? 24u : 16u)))
+            {
+                ZYAN_MEMSET(&symbols, 0, sizeof(symbols));
+            }
+        }
+
+        const size_t word = is_64 ? 8 : 4;
+        for (ZyanU64 j = 0; j + table.entry_size <= table.size; j += table.entry_size)
+        {
+            const ZyanU8* relocation = data + table.offset + j;
+            const ZyanU64 offset = ReadLE(relocation, word);
+            const ZyanU64 info = ReadLE(relocation + word, word);
+            const ZyanU32 type = (ZyanU32)(is_64 ? (info & 0xFFFFFFFF) : (info & 0xFF));
+            const ZyanU64 index = is_64 ? (info >> 32) : (info >> 8);
+
+            ZyanU64 addend = 0;
+            if (has_addend)
+            {
+                addend = ReadLE(relocation + 2 * word, word);
+            }
+            else if (!ReadAt(image, offset, word, &addend))
+            {
+                continue;
+            }
+
+            ZyanU64 target;
+            switch (type)
+            {
+            case 8:
+                // `R_X86_64_RELATIVE` and `R_386_RELATIVE`
+                target = addend;
+                break;
+            case 1:
+            case 6:
+            {
+                // `R_X86_64_64`/`R_386_32` and `R_X86_64_GLOB_DAT`/`R_386_GLOB_DAT`
+                if (!symbols.entry_size || (index * symbols.entry_size >= symbols.size))
+                {
+                    continue;
+                }
+                const ZyanU8* symbol = data + symbols.offset + index * symbols.entry_size;
+                const ZyanU16 shndx = (ZyanU16)ReadLE(symbol + (is_64 ? 0x06 : 0x0E), 2);
+                if (!shndx)
+                {
+                    continue;
+                }
+                target = (is_64 ? ReadLE(symbol + 0x08, 8) : ReadLE(symbol + 0x04, 4)) +
+                    ((type == 1) ? addend : 0);
+                break;
+            }
+            default:
+                continue;
+            }
+            if (!is_64)
+            {
+                target &= 0xFFFFFFFF;
+            }
+            if (!AddTarget(image, target, TARGET_REASON_RELOCATION))
+            {
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    if (entry && !AddTarget(image, entry, TARGET_REASON_ENTRY))
+    {
+        return ZYAN_FALSE;
+    }
+
+    // Position-dependent images store function pointers in data sections without relocations
+    if (image->is_position_dependent)
+    {
+        const size_t word = is_64 ? 8 : 4;
+        for (size_t i = 0; i < image->sections.count; ++i)
+        {
+            const Section* section = &VECTOR_AT(&image->sections, Section, i);
+            if (section->is_executable)
+            {
+                continue;
+            }
+            for (ZyanU64 offset = (word - (section->address % word)) % word;
+                offset + word <= section->size; offset += word)
+            {
+                const ZyanU64 value = ReadLE(data + section->offset + offset, word);
+                const Function* function = FindFunction(image, value);
+                if (function && (function->address == value) &&
+                    !AddTarget(image, value, TARGET_REASON_DATA))
+                {
+                    return ZYAN_FALSE;
+                }
+            }
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Splits the executable sections into work items. Chunks start at function boundaries, if
+ * function symbols are available.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool CreateChunks(Image* image)
+{
+    for (size_t i = 0; i < image->sections.count; ++i)
+    {
+        const Section* section = &VECTOR_AT(&image->sections, Section, i);
+        if (!section->is_executable)
+        {
+            continue;
+        }
+
+        ZyanU64 start = 0;
+        while (start < section->size)
+        {
+            ZyanU64 end = ZYAN_MIN(start + CHUNK_SIZE, section->size);
+            if (image->functions.count && (end < section->size))
+            {
+                // Extend the chunk to the next function start
+                const Function* function = FindFunction(image, section->address + end);
+                const Function* last = &VECTOR_AT(&image->functions, Function,
+                    image->functions.count - 1);
+                end = section->size;
+                if (function && (function != last))
+                {
+                    const ZyanU64 next = (function + 1)->address - section->address;
+                    if (next < section->size)
+                    {
+                        end = next;
+                    }
+                }
+            }
+
+            Chunk chunk;
+            ZYAN_MEMSET(&chunk, 0, sizeof(chunk));
+            chunk.address = section->address + start;
+            chunk.offset = section->offset + start;
+            chunk.size = end - start;
+            VectorInit(&chunk.references, sizeof(ZydisIbtReference));
+            if (!VectorPush(&image->chunks, &chunk))
+            {
+                return ZYAN_FALSE;
+            }
+            start = end;
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Sweep                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Stores all references that are relevant for the audit.
+ *
+ * @param   reference   A pointer to the `ZydisIbtReference` struct.
+ * @param   user_data   A pointer to the `SweepContext` struct.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus OnReference(const ZydisIbtReference* reference, void* user_data)
+{
+    SweepContext* context = (SweepContext*)user_data;
+    const Image* image = context->image;
+    Chunk* chunk = context->chunk;
+
+    switch (reference->type)
+    {
+    case ZYDIS_IBT_REFERENCE_JUMP:
+        // Jumps inside the chunk are never tail-calls
+        if (reference->target - chunk->address < chunk->size)
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        ZYAN_FALLTHROUGH;
+    case ZYDIS_IBT_REFERENCE_CALL:
+    {
+        const Function* function = FindFunction(image, reference->target);
+        if (!function || (function->address != reference->target))
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        break;
+    }
+    case ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS:
+        if (!image->is_position_dependent)
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        ZYAN_FALLTHROUGH;
+    case ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS:
+        if (!FindSection(image, reference->target))
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        break;
+    case ZYDIS_IBT_REFERENCE_INDIRECT_JUMP:
+        if (reference->is_notrack)
+        {
+            return ZYAN_STATUS_SUCCESS;
+        }
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    if (!VectorPush(&chunk->references, reference))
+    {
+        chunk->failed = ZYAN_TRUE;
+        return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+    }
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Sweeps every `count`-th chunk, starting at the index of the worker.
+ *
+ * @param   user_data   A pointer to the `Image` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const Image* image = (const Image*)user_data;
+    SweepContext context;
+    context.image = image;
+    for (size_t i = index; i < image->chunks.count; i += count)
+    {
+        context.chunk = &VECTOR_AT(&image->chunks, Chunk, i);
+        ZydisIbtCollectReferences(&image->decoder, image->data + context.chunk->offset,
+            (ZyanUSize)context.chunk->size, context.chunk->address, &OnReference, &context);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Analysis                                                                                       */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Adds the entries of a potential jump table.
+ *
+ * @param   image       A pointer to the `Image` struct.
+ * @param   table       The runtime address of the table.
+ * @param   source      The runtime address of the instruction that references the table.
+ * @param   is_relative `ZYAN_TRUE` for tables of 32-bit offsets relative to the table address,
+ *                      `ZYAN_FALSE` for tables of absolute pointers.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ *
+ * Entries are accepted as long as they point into the function that references the table.
+ */
+static ZyanBool AddJumpTable(Image* image, ZyanU64 table, ZyanU64 source, ZyanBool is_relative)
+{
+    const Function* function = FindContainingFunction(image, source);
+    if (!function || !function->has_tracked_jump)
+    {
+        // Tables dispatched by `notrack` jumps do not require landing pads
+        return ZYAN_TRUE;
+    }
+
+    const size_t entry_size = is_relative ? 4 : (image->is_64 ? 8 : 4);
+    for (ZyanU64 i = 0; i < MAX_JUMP_TABLE_ENTRIES; ++i)
+    {
+        ZyanU64 entry;
+        if (!ReadAt(image, table + i * entry_size, entry_size, &entry))
+        {
+            break;
+        }
+
+        ZyanU64 target = is_relative ? table + (ZyanU64)(ZyanI64)(ZyanI32)(ZyanU32)entry : entry;
+        if (!image->is_64)
+        {
+            target &= 0xFFFFFFFF;
+        }
+        if (target - function->address >= function->size)
+        {
+            break;
+        }
+        if (!AddTarget(image, target, TARGET_REASON_JUMP_TABLE))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Merges the references of all chunks into the function and target lists.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool MergeReferences(Image* image)
+{
+    // Indirect jumps and direct calls first, as the jump table heuristic depends on them
+    for (size_t i = 0; i < image->chunks.count; ++i)
+    {
+        const Chunk* chunk = &VECTOR_AT(&image->chunks, Chunk, i);
+        if (chunk->failed)
+        {
+            return ZYAN_FALSE;
+        }
+        for (size_t j = 0; j < chunk->references.count; ++j)
+        {
+            const ZydisIbtReference* reference =
+                &VECTOR_AT(&chunk->references, ZydisIbtReference, j);
+            Function* function;
+            switch (reference->type)
+            {
+            case ZYDIS_IBT_REFERENCE_CALL:
+            case ZYDIS_IBT_REFERENCE_JUMP:
+                FindFunction(image, reference->target)->is_direct_target = ZYAN_TRUE;
+                break;
+            case ZYDIS_IBT_REFERENCE_INDIRECT_JUMP:
+                function = FindContainingFunction(image, reference->source);
+                if (function)
+                {
+                    function->has_tracked_jump = ZYAN_TRUE;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < image->chunks.count; ++i)
+    {
+        const Chunk* chunk = &VECTOR_AT(&image->chunks, Chunk, i);
+        for (size_t j = 0; j < chunk->references.count; ++j)
+        {
+            const ZydisIbtReference* reference =
+                &VECTOR_AT(&chunk->references, ZydisIbtReference, j);
+            const Section* section;
+            switch (reference->type)
+            {
+            case ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS:
+            case ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS:
+                section = FindSection(image, reference->target);
+                if (section->is_executable)
+                {
+                    if (!AddTarget(image, reference->target,
+                        (reference->type == ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS) ?
+                            TARGET_REASON_LEA : TARGET_REASON_IMMEDIATE))
+                    {
+                        return ZYAN_FALSE;
+                    }
+                }
+                else if (!AddJumpTable(image, reference->target, reference->source,
+                    (reference->type == ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS)))
+                {
+                    return ZYAN_FALSE;
+                }
+                break;
+            case ZYDIS_IBT_REFERENCE_INDIRECT_JUMP:
+                if (reference->target && image->is_position_dependent &&
+                    !AddJumpTable(image, reference->target, reference->source, ZYAN_FALSE))
+                {
+                    return ZYAN_FALSE;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // Merge duplicate targets
+    qsort(image->targets.data, image->targets.count, sizeof(Target), &CompareTargets);
+    size_t count = 0;
+    for (size_t i = 0; i < image->targets.count; ++i)
+    {
+        const Target* target = &VECTOR_AT(&image->targets, Target, i);
+        if (count && (VECTOR_AT(&image->targets, Target, count - 1).address == target->address))
+        {
+            VECTOR_AT(&image->targets, Target, count - 1).reasons |= target->reasons;
+            continue;
+        }
+        VECTOR_AT(&image->targets, Target, count++) = *target;
+    }
+    image->targets.count = count;
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Checks if the code at the given address starts with a landing pad.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ *
+ * @return  `ZYAN_TRUE`, if the code starts with a landing pad or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool HasLandingPad(const Image* image, ZyanU64 address)
+{
+    const Section* section = FindSection(image, address);
+    const ZyanU64 offset = address - section->address;
+    return ZydisIbtIsLandingPad(&image->decoder, image->data + section->offset + offset,
+        (ZyanUSize)(section->size - offset)) == ZYAN_STATUS_TRUE;
+}
+
+/**
+ * Prints the symbolic location of the given address.
+ *
+ * @param   image   A pointer to the `Image` struct.
+ * @param   address The runtime address.
+ */
+static void PrintLocation(const Image* image, ZyanU64 address)
+{
+    ZYAN_PRINTF("%s%016" PRIX64 "%s", CVT100_OUT(COLOR_ADDRESS), address,
+        CVT100_OUT(ZYAN_VT100SGR_RESET));
+    const Function* function = FindContainingFunction(image, address);
+    if (function && function->name)
+    {
+        ZYAN_PRINTF(" <%s%s", CVT100_OUT(COLOR_SYMBOL), function->name);
+        if (address != function->address)
+        {
+            ZYAN_PRINTF("+0x%" PRIX64, address - function->address);
+        }
+        ZYAN_PRINTF("%s>", CVT100_OUT(ZYAN_VT100SGR_RESET));
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-jobs N] [-no-superfluous] <input file>%s\n",
+        CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "ZydisIbtAudit"),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static Image image;
+    VectorInit(&image.sections, sizeof(Section));
+    VectorInit(&image.functions, sizeof(Function));
+    VectorInit(&image.targets, sizeof(Target));
+    VectorInit(&image.chunks, sizeof(Chunk));
+    image.thread_count = GetProcessorCount();
+    ZyanBool report_superfluous = ZYAN_TRUE;
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        if (!ZYAN_STRCMP(argv[i], "-jobs") && (i + 1 < argc))
+        {
+            image.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!image.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!ZYAN_STRCMP(argv[i], "-no-superfluous"))
+        {
+            report_superfluous = ZYAN_FALSE;
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+    if (i + 1 != argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    image.path = argv[i];
+    image.data = ReadFile(image.path, &image.size);
+    if (!image.data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%s%s: can not read file%s\n", CVT100_ERR(COLOR_ERROR),
+            image.path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_FAILURE;
+    if (!LoadImage(&image))
+    {
+        goto cleanup;
+    }
+
+    ZydisDecoderInit(&image.decoder,
+        image.is_64 ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
+        image.is_64 ? ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32);
+    ZydisDecoderEnableMode(&image.decoder, ZYDIS_DECODER_MODE_CET, ZYAN_TRUE);
+
+    if (!CreateChunks(&image))
+    {
+        goto out_of_memory;
+    }
+    if (image.thread_count > image.chunks.count)
+    {
+        image.thread_count = image.chunks.count ? image.chunks.count : 1;
+    }
+    if (!RunWorkers(image.thread_count, &RunWorker, &image))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+    if (!MergeReferences(&image))
+    {
+        goto out_of_memory;
+    }
+
+    static const char* reason_names[] =
+    {
+        "lea", "immediate", "relocation", "export", "entry", "jump-table", "data"
+    };
+
+    size_t missing = 0;
+    for (size_t j = 0; j < image.targets.count; ++j)
+    {
+        const Target* target = &VECTOR_AT(&image.targets, Target, j);
+        if (HasLandingPad(&image, target->address))
+        {
+            continue;
+        }
+
+        ++missing;
+        PrintLocation(&image, target->address);
+        ZYAN_PRINTF(": %smissing-endbr%s (", CVT100_OUT(COLOR_HAZARD),
+            CVT100_OUT(ZYAN_VT100SGR_RESET));
+        const char* separator = "";
+        for (size_t k = 0; k < ZYAN_ARRAY_LENGTH(reason_names); ++k)
+        {
+            if (target->reasons & (1 << k))
+            {
+                ZYAN_PRINTF("%s%s", separator, reason_names[k]);
+                separator = ", ";
+            }
+        }
+        ZYAN_PRINTF(")\n");
+    }
+
+    size_t superfluous = 0;
+    for (size_t j = 0; report_superfluous && (j < image.functions.count); ++j)
+    {
+        const Function* function = &VECTOR_AT(&image.functions, Function, j);
+        if (!function->is_direct_target || !HasLandingPad(&image, function->address))
+        {
+            continue;
+        }
+
+        Target key;
+        key.address = function->address;
+        if (bsearch(&key, image.targets.data, image.targets.count, sizeof(Target),
+            &CompareTargets))
+        {
+            continue;
+        }
+
+        ++superfluous;
+        PrintLocation(&image, function->address);
+        ZYAN_PRINTF(": %ssuperfluous-endbr%s (direct calls only)\n", CVT100_OUT(COLOR_HAZARD),
+            CVT100_OUT(ZYAN_VT100SGR_RESET));
+    }
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%zu function(s), %zu indirect branch target(s): %zu missing, "
+        "%zu superfluous\n", image.functions.count, image.targets.count, missing, superfluous);
+    result = EXIT_SUCCESS;
+    goto cleanup;
+
+out_of_memory:
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sOut of memory%s\n", CVT100_ERR(COLOR_ERROR),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+
+cleanup:
+    for (size_t j = 0; j < image.chunks.count; ++j)
+    {
+        VectorDestroy(&VECTOR_AT(&image.chunks, Chunk, j).references);
+    }
+    VectorDestroy(&image.chunks);
+    VectorDestroy(&image.targets);
+    VectorDestroy(&image.functions);
+    VectorDestroy(&image.sections);
+    free(image.data);
+
+    return result;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,531 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Scans raw code files or the executable sections of ELF files for micro-architectural
+ * performance hazards. Multiple files are processed in parallel.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_FILE      ZYAN_VT100SGR_FG_BRIGHT_WHITE
+#define COLOR_ADDRESS   ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_HAZARD    ZYAN_VT100SGR_FG_BRIGHT_YELLOW
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `OutputBuffer` struct.
+ */
+typedef struct OutputBuffer_
+{
+    /**
+     * The buffer data.
+     */
+    char* data;
+    /**
+     * The number of used bytes.
+     */
+    size_t size;
+    /**
+     * The number of allocated bytes.
+     */
+    size_t capacity;
+} OutputBuffer;
+
+/**
+ * Defines the `FileJob` struct.
+ */
+typedef struct FileJob_
+{
+    /**
+     * The path of the input file.
+     */
+    const char* path;
+    /**
+     * The buffered report.
+     */
+    OutputBuffer output;
+    /**
+     * The number of hazards found for each hazard type.
+     */
+    ZyanU64 counts[ZYDIS_LINTER_HAZARD_MAX_VALUE + 1];
+    /**
+     * Signals, if the file could not be processed.
+     */
+    ZyanBool failed;
+} FileJob;
+
+/**
+ * Defines the `LintContext` struct.
+ */
+typedef struct LintContext_
+{
+    /**
+     * The linter used for raw files and as a template for ELF files.
+     */
+    ZydisLinter linter;
+    /**
+     * Signals, if the machine mode was given on the command line.
+     */
+    ZyanBool has_machine_mode;
+    /**
+     * The jobs.
+     */
+    FileJob* jobs;
+    /**
+     * The number of jobs.
+     */
+    size_t job_count;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} LintContext;
+
+/**
+ * Defines the `HazardContext` struct.
+ */
+typedef struct HazardContext_
+{
+    /**
+     * The current job.
+     */
+    FileJob* job;
+} HazardContext;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Output                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Appends formatted text to the given output buffer.
+ *
+ * @param   buffer  A pointer to the `OutputBuffer` struct.
+ * @param   format  The format string.
+ */
+static void Append(OutputBuffer* buffer, const char* format, ...)
+{
+    va_list args;
+    for (;;)
+    {
+        const size_t available = buffer->capacity - buffer->size;
+        va_start(args, format);
+        const int written = vsnprintf(buffer->data + buffer->size, available, format, args);
+        va_end(args);
+        if (written < 0)
+        {
+            return;
+        }
+        if ((size_t)written < available)
+        {
+            buffer->size += (size_t)written;
+            return;
+        }
+
+        const size_t capacity = (buffer->capacity + written + 1) * 2;
+        char* data = realloc(buffer->data, capacity);
+        if (!data)
+        {
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+/**
+ * Returns a short name for the given hazard type.
+ *
+ * @param   type    The hazard type.
+ *
+ * @return  The hazard name.
+ */
+static const char* GetHazardName(ZydisLinterHazardType type)
+{
+    static const char* names[] =
+    {
+        "jcc-erratum",
+        "lcp-stall",
+        "unaligned-loop",
+        "split-fusion"
+    };
+    ZYAN_STATIC_ASSERT(ZYAN_ARRAY_LENGTH(names) == ZYDIS_LINTER_HAZARD_MAX_VALUE + 1);
+
+    return names[type];
+}
+
+/**
+ * Formats a single hazard into the output buffer of the current job.
+ *
+ * @param   hazard      A pointer to the `ZydisLinterHazard` struct.
+ * @param   user_data   A pointer to the `HazardContext` struct.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus OnHazard(const ZydisLinterHazard* hazard, void* user_data)
+{
+    HazardContext* context = (HazardContext*)user_data;
+    FileJob* job = context->job;
+
+    ++job->counts[hazard->type];
+
+    Append(&job->output, "%s%s%s:%s%016" PRIX64 "%s: %s%s%s: %s (%u bytes)",
+        CVT100_OUT(COLOR_FILE), job->path, CVT100_OUT(ZYAN_VT100SGR_RESET),
+        CVT100_OUT(COLOR_ADDRESS), hazard->address, CVT100_OUT(ZYAN_VT100SGR_RESET),
+        CVT100_OUT(COLOR_HAZARD), GetHazardName(hazard->type), CVT100_OUT(ZYAN_VT100SGR_RESET),
+        ZydisMnemonicGetString(hazard->mnemonic), hazard->length);
+    if (hazard->padding)
+    {
+        Append(&job->output, ", pad %u bytes before %016" PRIX64, hazard->padding,
+            hazard->target);
+    }
+    else
+    {
+        Append(&job->output, ", avoid the operand-size prefix");
+    }
+    Append(&job->output, "\n");
+
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Lints all executable sections of a little-endian ELF file.
+ *
+ * @param   context     A pointer to the `LintContext` struct.
+ * @param   job         A pointer to the `FileJob` struct.
+ * @param   data        A pointer to the file data.
+ * @param   size        The file size.
+ *
+ * @return  `ZYAN_TRUE`, if the file is a supported ELF file or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool LintELF(const LintContext* context, FileJob* job, const ZyanU8* data, size_t size)
+{
+    if ((size < 0x34) || ZYAN_MEMCMP(data, "\x7F" "ELF", 4) || (data[5] != 1))
+    {
+        return ZYAN_FALSE;
+    }
+
+    const ZyanBool is_64 = (data[4] == 2);
+    if (!is_64 && (data[4] != 1))
+    {
+        return ZYAN_FALSE;
+    }
+    if (is_64 && (size < 0x40))
+    {
+        return ZYAN_FALSE;
+    }
+
+    ZydisLinter linter = context->linter;
+    if (!context->has_machine_mode)
+    {
+        ZydisLinterInit(&linter,
+            is_64 ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
+            is_64 ? ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32);
+        linter.hazards = context->linter.hazards;
+        linter.loop_alignment = context->linter.loop_alignment;
+    }
+
+    ElfSectionTable sections;
+    if (!ReadSectionTable(data, size, is_64, &sections))
+    {
+        Append(&job->output, "%s: malformed section header table\n", job->path);
+        job->failed = ZYAN_TRUE;
+        return ZYAN_TRUE;
+    }
+
+    HazardContext hazard_context;
+    hazard_context.job = job;
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ElfSection section;
+        ReadSection(&sections, i, &section);
+
+        // Skip `SHT_NOBITS` and sections without `SHF_EXECINSTR`
+        if ((section.type == 8) || !(section.flags & 0x4) || !section.size)
+        {
+            continue;
+        }
+        if ((section.offset > size) || (section.size > size - section.offset))
+        {
+            Append(&job->output, "%s: section %" PRIu64 " exceeds the file\n", job->path, i);
+            job->failed = ZYAN_TRUE;
+            continue;
+        }
+
+        ZydisLinterLint(&linter, data + section.offset, (ZyanUSize)section.size,
+            section.address, &OnHazard, &hazard_context);
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Processes a single file.
+ *
+ * @param   context A pointer to the `LintContext` struct.
+ * @param   job     A pointer to the `FileJob` struct.
+ */
+static void ProcessFile(const LintContext* context, FileJob* job)
+{
+    size_t size;
+    ZyanU8* data = ReadFile(job->path, &size);
+    if (!data)
+    {
+        Append(&job->output, "%s: can not read file\n", job->path);
+        job->failed = ZYAN_TRUE;
+        return;
+    }
+
+    if (!LintELF(context, job, data, size))
+    {
+        HazardContext hazard_context;
+        hazard_context.job = job;
+        ZydisLinterLint(&context->linter, data, size, 0, &OnHazard, &hazard_context);
+    }
+
+    free(data);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Processes every `count`-th file, starting at the index of the worker.
+ *
+ * @param   user_data   A pointer to the `LintContext` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const LintContext* context = (const LintContext*)user_data;
+    for (size_t i = index; i < context->job_count; i += count)
+    {
+        ProcessFile(context, &context->jobs[i]);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] [-jobs N] [-loop-align N] " \
+        "[-no-jcc] [-no-lcp] [-no-loop] [-no-fusion] <input file>...%s\n",
+        CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "ZydisLint"),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static LintContext context;
+    ZydisLinterInit(&context.linter, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+    context.thread_count = GetProcessorCount();
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_MAX_VALUE;
+        ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+        }
+        else if (!ZYAN_STRCMP(arg, "-jobs") && (i + 1 < argc))
+        {
+            context.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!context.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+        else if (!ZYAN_STRCMP(arg, "-loop-align") && (i + 1 < argc))
+        {
+            if (!ZYAN_SUCCESS(ZydisLinterSetLoopAlignment(&context.linter,
+                (ZyanU32)strtoul(argv[++i], ZYAN_NULL, 10))))
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+        else if (!ZYAN_STRCMP(arg, "-no-jcc"))
+        {
+            ZydisLinterEnableHazard(&context.linter, ZYDIS_LINTER_HAZARD_JCC_ERRATUM, ZYAN_FALSE);
+            continue;
+        }
+        else if (!ZYAN_STRCMP(arg, "-no-lcp"))
+        {
+            ZydisLinterEnableHazard(&context.linter, ZYDIS_LINTER_HAZARD_LCP_STALL, ZYAN_FALSE);
+            continue;
+        }
+        else if (!ZYAN_STRCMP(arg, "-no-loop"))
+        {
+            ZydisLinterEnableHazard(&context.linter, ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP,
+                ZYAN_FALSE);
+            continue;
+        }
+        else if (!ZYAN_STRCMP(arg, "-no-fusion"))
+        {
+            ZydisLinterEnableHazard(&context.linter, ZYDIS_LINTER_HAZARD_SPLIT_FUSION,
+                ZYAN_FALSE);
+            continue;
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+
+        // Re-initialize the decoder without losing the hazard configuration
+        const ZyanU32 hazards = context.linter.hazards;
+        const ZyanU32 loop_alignment = context.linter.loop_alignment;
+        ZydisLinterInit(&context.linter, machine_mode, stack_width);
+        context.linter.hazards = hazards;
+        context.linter.loop_alignment = loop_alignment;
+        context.has_machine_mode = ZYAN_TRUE;
+    }
+
+    if (i >= argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    context.job_count = (size_t)(argc - i);
+    context.jobs = calloc(context.job_count, sizeof(FileJob));
+    if (!context.jobs)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sOut of memory%s\n", CVT100_ERR(COLOR_ERROR),
+            CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+    for (size_t j = 0; j < context.job_count; ++j)
+    {
+        context.jobs[j].path = argv[i + j];
+    }
+    if (context.thread_count > context.job_count)
+    {
+        context.thread_count = context.job_count;
+    }
+
+    if (!RunWorkers(context.thread_count, &RunWorker, &context))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+
+    ZyanU64 totals[ZYDIS_LINTER_HAZARD_MAX_VALUE + 1] = { 0 };
+    ZyanBool failed = ZYAN_FALSE;
+    for (size_t j = 0; j < context.job_count; ++j)
+    {
+        FileJob* job = &context.jobs[j];
+        if (job->output.size)
+        {
+            fwrite(job->output.data, 1, job->output.size, job->failed ? ZYAN_STDERR : ZYAN_STDOUT);
+        }
+        for (int k = 0; k <= ZYDIS_LINTER_HAZARD_MAX_VALUE; ++k)
+        {
+            totals[k] += job->counts[k];
+        }
+        failed |= job->failed;
+        free(job->output.data);
+    }
+    free(context.jobs);
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%zu file(s):", context.job_count);
+    for (int k = 0; k <= ZYDIS_LINTER_HAZARD_MAX_VALUE; ++k)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, " %s %" PRIu64 "%s", GetHazardName((ZydisLinterHazardType)k),
+            totals[k], (k < ZYDIS_LINTER_HAZARD_MAX_VALUE) ? "," : "\n");
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,780 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+
+/**
+ * @file
+ * White-box micro-benchmarks for individual decoder and formatter stages.
+ *
+ * The inputs of every stage are captured once from a linear sweep over the given raw 64-bit code
+ * files (or a small built-in sample). Each stage is then run over its inputs for a number of
+ * rounds. The time of an identical round that only restores the inputs is subtracted, so the
+ * results are the net cost of a single call. On x86 hosts the time is read from the `TSC`, which
+ * counts reference cycles at a constant rate (and not core clock cycles).
+ *
+ * Before timing, the stages are checked against the public API: decoding an instruction stage by
+ * stage must give the same result as `ZydisDecoderDecodeInstruction`, and so on.
+ *
+ * This tool requires a library that was built with `ZYDIS_INTERNAL_TESTS`.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+#include <Zydis/Internal/FormatterIntel.h>
+#include <Zydis/Internal/InternalTests.h>
+
+#if defined(ZYAN_X86) || defined(ZYAN_X64)
+#   if defined(ZYAN_MSVC)
+#       include <intrin.h>
+#   else
+#       include <x86intrin.h>
+#   endif
+#endif
+
+/* ============================================================================================== */
+/* Constants                                                                                      */
+/* ============================================================================================== */
+
+/**
+ * The maximum number of instructions captured from the input files.
+ */
+#define MAX_SAMPLES 16384
+
+/**
+ * The default number of timed rounds per stage.
+ */
+#define DEFAULT_ROUNDS 31
+
+/**
+ * The runtime address of the first input byte.
+ */
+#define RUNTIME_ADDRESS 0x00400000
+
+/**
+ * A mix of legacy, `VEX` and `EVEX` compiler output, used if no input files are given.
+ */
+static const ZyanU8 SAMPLE_CODE[] =
+{
+    0x55, 0x48, 0x89, 0xE5, 0x48, 0x83, 0xEC, 0x40, 0x48, 0x89, 0x7D, 0xE8,
+    0x8B, 0x05, 0x34, 0x12, 0x00, 0x00, 0x48, 0x8D, 0x4C, 0x90, 0x10, 0x0F,
+    0xB6, 0x14, 0x0E, 0x48, 0x05, 0xFF, 0xFF, 0xFF, 0x7F, 0x45, 0x6B, 0xC1,
+    0x1C, 0x64, 0x80, 0x3C, 0x25, 0x28, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x0F,
+    0xC1, 0x07, 0xF3, 0xA4, 0x31, 0xC0, 0x48, 0x85, 0xFF, 0x75, 0x05, 0xE8,
+    0x00, 0x00, 0x00, 0x00, 0x66, 0xC7, 0x43, 0x02, 0x34, 0x12, 0x48, 0xB8,
+    0xF0, 0xDE, 0xBC, 0x9A, 0x78, 0x56, 0x34, 0x12, 0x49, 0xC1, 0xE2, 0x03,
+    0x48, 0x0F, 0x4F, 0x44, 0x24, 0x08, 0xF3, 0x0F, 0x6F, 0x07, 0x66, 0x0F,
+    0x38, 0x00, 0xCA, 0xF2, 0x0F, 0x58, 0x05, 0xC0, 0xFF, 0xFF, 0xFF, 0xF2,
+    0x48, 0x0F, 0x2A, 0xC8, 0xC5, 0xF4, 0x58, 0x40, 0x20, 0xC4, 0xE2, 0xE5,
+    0xB8, 0xD4, 0xC4, 0xE2, 0x7D, 0x58, 0xEE, 0xC5, 0xFE, 0x7F, 0xBC, 0x24,
+    0x00, 0x01, 0x00, 0x00, 0x62, 0xF1, 0x74, 0xD9, 0x58, 0x40, 0x10, 0x62,
+    0xF3, 0x65, 0x48, 0x25, 0xD4, 0x96, 0x62, 0x61, 0xFE, 0x48, 0x7F, 0x74,
+    0xCF, 0xFE, 0x62, 0xF2, 0x7D, 0x4A, 0x92, 0x0C, 0x90, 0xC5, 0xF8, 0x92,
+    0xC8, 0x62, 0xF1, 0x7E, 0x48, 0x5B, 0xCA, 0xC5, 0xF8, 0x77, 0x0F, 0x1F,
+    0x04, 0x00, 0xC3
+};
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * The captured inputs of the decoder stages for a single instruction.
+ */
+typedef struct DecoderSample_
+{
+    /**
+     * The state, instruction and context after `ZydisCollectOptionalPrefixes`.
+     */
+    ZydisDecoderState prefixes_state;
+    ZydisDecodedInstruction prefixes_instruction;
+    ZydisDecoderContext prefixes_context;
+    /**
+     * The state, instruction and context after `ZydisDecodeInstruction`.
+     */
+    ZydisDecoderState state;
+    ZydisDecodedInstruction instruction;
+    ZydisDecoderContext context;
+    /**
+     * The decoded operands.
+     */
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    /**
+     * The input bytes.
+     */
+    const ZyanU8* data;
+    /**
+     * The number of input bytes left at `data`.
+     */
+    ZyanUSize length;
+    /**
+     * The runtime address of the instruction.
+     */
+    ZyanU64 runtime_address;
+} DecoderSample;
+
+/**
+ * The benchmark inputs and the scratch space the stages work on.
+ */
+typedef struct Bench_
+{
+    ZydisDecoder decoder;
+    ZydisFormatter formatter;
+    DecoderSample* samples;
+    ZyanU32 sample_count;
+    /**
+     * The inputs of `ZydisStringAppendHexU64` (immediates and displacements).
+     */
+    ZyanU64* values;
+    ZyanU32 value_count;
+    /**
+     * The inputs of `ZydisFormatterIntelFormatOperandMEM` (`sample << 8 | operand`).
+     */
+    ZyanU32* memory_operands;
+    ZyanU32 memory_operand_count;
+
+    ZydisDecoderState state;
+    ZydisDecodedInstruction instruction;
+    ZydisDecoderContext context;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    ZydisFormatterBuffer buffer;
+    ZydisFormatterContext formatter_context;
+    char text[256];
+} Bench;
+
+/**
+ * Defines the `StageFunc` function prototype.
+ *
+ * @param   bench   A pointer to the `Bench` struct.
+ * @param   input   The index of the input.
+ */
+typedef void (*StageFunc)(Bench* bench, ZyanU32 input);
+
+/**
+ * Describes a single benchmarked stage.
+ */
+typedef struct Stage_
+{
+    const char* name;
+    /**
+     * Restores the input of the stage. This is timed separately and subtracted.
+     */
+    StageFunc setup;
+    /**
+     * Calls the stage.
+     */
+    StageFunc run;
+    ZyanU32* inputs;
+    ZyanU32 input_count;
+} Stage;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Time measurement                                                                               */
+/* ---------------------------------------------------------------------------------------------- */
+
+#if defined(ZYAN_X86) || defined(ZYAN_X64)
+
+#define TIMER_UNIT "cycles"
+
+static ZyanU64 ReadTimer(void)
+{
+    _mm_lfence();
+    const ZyanU64 value = __rdtsc();
+    _mm_lfence();
+    return value;
+}
+
+#else
+
+#define TIMER_UNIT "nsec"
+
+static ZyanU64 ReadTimer(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (ZyanU64)ts.tv_sec * 1000000000 + (ZyanU64)ts.tv_nsec;
+}
+
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Prepares the decoder state for the instruction at the given input position, the same way
+ * `ZydisDecoderDecodeInstruction` does.
+ *
+ * @param   bench       A pointer to the `Bench` struct.
+ * @param   data        A pointer to the input bytes.
+ * @param   length      The number of input bytes.
+ */
+static void InitDecoderState(Bench* bench, const ZyanU8* data, ZyanUSize length)
+{
+    ZYAN_MEMSET(&bench->state, 0, sizeof(bench->state));
+    bench->state.decoder = &bench->decoder;
+    bench->state.context = &bench->context;
+    bench->state.buffer = data;
+    bench->state.buffer_len = length;
+    bench->state.prefixes.offset_notrack = -1;
+
+    ZYAN_MEMSET(&bench->context, 0, sizeof(bench->context));
+    ZYAN_MEMSET(&bench->instruction, 0, sizeof(bench->instruction));
+    bench->instruction.machine_mode = bench->decoder.machine_mode;
+    bench->instruction.stack_width = 16 << bench->decoder.stack_width;
+}
+
+/**
+ * Prepares the formatter buffer and context for the given memory operand, the same way
+ * `ZydisFormatterFormatOperand` does.
+ *
+ * @param   bench   A pointer to the `Bench` struct.
+ * @param   input   The memory operand (`sample << 8 | operand`).
+ */
+static void SetupFormatOperandMEM(Bench* bench, ZyanU32 input)
+{
+    const DecoderSample* sample = &bench->samples[input >> 8];
+    ZydisFormatterBufferInit(&bench->buffer, bench->text, sizeof(bench->text));
+    bench->formatter_context.instruction = &sample->instruction;
+    bench->formatter_context.operands = ZYAN_NULL;
+    bench->formatter_context.operand = &sample->operands[input & 0xFF];
+    bench->formatter_context.runtime_address = sample->runtime_address;
+    bench->formatter_context.user_data = ZYAN_NULL;
+}
+
+/**
+ * Prints a mismatch between a stage and the public API.
+ *
+ * @param   stage   The name of the stage.
+ * @param   sample  A pointer to the `DecoderSample` struct.
+ */
+static void PrintMismatch(const char* stage, const DecoderSample* sample)
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%s%s does not match the public API at 0x%" PRIX64 ":",
+        CVT100_ERR(COLOR_ERROR), stage, sample->runtime_address);
+    for (ZyanUSize i = 0; i < ZYAN_MIN(sample->length, ZYDIS_MAX_INSTRUCTION_LENGTH); ++i)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, " %02X", sample->data[i]);
+    }
+    ZYAN_FPRINTF(ZYAN_STDERR, "%s\n", CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+/**
+ * Decodes the given buffer stage by stage, checks each stage against the public API and captures
+ * the inputs of all stages. Undecodable bytes are skipped one at a time.
+ *
+ * @param   bench           A pointer to the `Bench` struct.
+ * @param   data            A pointer to the code.
+ * @param   length          The length of the code.
+ * @param   runtime_address The runtime address of the first byte.
+ *
+ * @return  `ZYAN_TRUE`, if all stages matched the public API or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool CaptureSamples(Bench* bench, const ZyanU8* data, ZyanUSize length,
+    ZyanU64 runtime_address)
+{
+    ZyanBool result = ZYAN_TRUE;
+    for (ZyanUSize offset = 0; (offset < length) && (bench->sample_count < MAX_SAMPLES); )
+    {
+        DecoderSample* sample = &bench->samples[bench->sample_count];
+        sample->data = data + offset;
+        sample->length = length - offset;
+        sample->runtime_address = runtime_address + offset;
+
+        ZydisDecoderContext context;
+        ZydisDecodedInstruction instruction;
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&bench->decoder, &context, sample->data,
+            sample->length, &instruction)))
+        {
+            ++offset;
+            continue;
+        }
+        offset += instruction.length;
+        ++bench->sample_count;
+
+        // Decoder stages
+        InitDecoderState(bench, sample->data, sample->length);
+        if (!ZYAN_SUCCESS(ZydisCollectOptionalPrefixes(&bench->state, &bench->instruction)))
+        {
+            PrintMismatch("ZydisCollectOptionalPrefixes", sample);
+            result = ZYAN_FALSE;
+            continue;
+        }
+        sample->prefixes_state = bench->state;
+        sample->prefixes_instruction = bench->instruction;
+        sample->prefixes_context = bench->context;
+        if (!ZYAN_SUCCESS(ZydisDecodeInstruction(&bench->state, &bench->instruction)))
+        {
+            PrintMismatch("ZydisDecodeInstruction", sample);
+            result = ZYAN_FALSE;
+            continue;
+        }
+        bench->instruction.raw.encoding2 = bench->instruction.encoding;
+        sample->state = bench->state;
+        sample->instruction = bench->instruction;
+        sample->context = bench->context;
+        if (ZYAN_MEMCMP(&instruction, &sample->instruction, sizeof(instruction)) ||
+            ZYAN_MEMCMP(&context, &sample->context, sizeof(context)))
+        {
+            PrintMismatch("ZydisDecodeInstruction", sample);
+            result = ZYAN_FALSE;
+            continue;
+        }
+
+        // The attribute stages are replayed on the decoded instruction, which must not change it
+        const ZydisInstructionDefinition* definition = context.definition;
+        ZydisSetAttributes(&bench->state, &bench->instruction, definition);
+        switch (instruction.encoding)
+        {
+        case ZYDIS_INSTRUCTION_ENCODING_XOP:
+        case ZYDIS_INSTRUCTION_ENCODING_VEX:
+        case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+        case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+            ZYAN_MEMSET(&bench->instruction.avx, 0, sizeof(bench->instruction.avx));
+            ZydisSetAVXInformation(&bench->context, &bench->instruction, definition);
+            break;
+        default:
+            break;
+        }
+        if (ZYAN_MEMCMP(&instruction, &bench->instruction, sizeof(instruction)) ||
+            ZYAN_MEMCMP(&context, &bench->context, sizeof(context)))
+        {
+            PrintMismatch("ZydisSetAttributes", sample);
+            result = ZYAN_FALSE;
+            continue;
+        }
+
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        ZYAN_MEMSET(operands, 0, sizeof(operands));
+        ZYAN_MEMSET(sample->operands, 0, sizeof(sample->operands));
+        if (instruction.operand_count &&
+            (!ZYAN_SUCCESS(ZydisDecoderDecodeOperands(&bench->decoder, &context, &instruction,
+                operands, instruction.operand_count)) ||
+             !ZYAN_SUCCESS(ZydisDecodeOperands(&bench->decoder, &sample->context,
+                &sample->instruction, sample->operands, instruction.operand_count, ZYAN_FALSE)) ||
+             ZYAN_MEMCMP(operands, sample->operands, sizeof(operands))))
+        {
+            PrintMismatch("ZydisDecodeOperands", sample);
+            result = ZYAN_FALSE;
+            continue;
+        }
+
+        // String and formatter stages
+        if (instruction.raw.disp.size)
+        {
+            bench->values[bench->value_count++] = (ZyanU64)instruction.raw.disp.value;
+        }
+        for (ZyanU8 i = 0; i < 2; ++i)
+        {
+            if (instruction.raw.imm[i].size)
+            {
+                bench->values[bench->value_count++] = instruction.raw.imm[i].value.u;
+            }
+        }
+        for (ZyanU8 i = 0; i < instruction.operand_count_visible; ++i)
+        {
+            const ZydisDecodedOperand* operand = &sample->operands[i];
+            if (operand->type != ZYDIS_OPERAND_TYPE_MEMORY)
+            {
+                continue;
+            }
+
+            const ZyanU32 input = ((bench->sample_count - 1) << 8) | i;
+            char expected[sizeof(bench->text)];
+            SetupFormatOperandMEM(bench, input);
+            if (!ZYAN_SUCCESS(ZydisFormatterFormatOperand(&bench->formatter, &instruction,
+                    operand, expected, sizeof(expected), sample->runtime_address, ZYAN_NULL)) ||
+                !ZYAN_SUCCESS(ZydisFormatterIntelFormatOperandMEM(&bench->formatter,
+                    &bench->buffer, &bench->formatter_context)) ||
+                ZYAN_STRCMP(expected, bench->text))
+            {
+                PrintMismatch("ZydisFormatterIntelFormatOperandMEM", sample);
+                result = ZYAN_FALSE;
+                continue;
+            }
+            bench->memory_operands[bench->memory_operand_count++] = input;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Checks `ZydisStringAppendHexU64` against `printf`.
+ *
+ * @param   bench   A pointer to the `Bench` struct.
+ *
+ * @return  `ZYAN_TRUE`, if all values matched or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool CheckHexValues(Bench* bench)
+{
+    for (ZyanU32 i = 0; i < bench->value_count; ++i)
+    {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%" PRIX64, bench->values[i]);
+        ZydisFormatterBufferInit(&bench->buffer, bench->text, sizeof(bench->text));
+        if (!ZYAN_SUCCESS(ZydisStringAppendHexU64(&bench->buffer.string, bench->values[i], 0,
+            ZYAN_FALSE, ZYAN_TRUE)) || ZYAN_STRCMP(expected, bench->text))
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sZydisStringAppendHexU64 does not match printf for " \
+                "0x%" PRIX64 "%s\n", CVT100_ERR(COLOR_ERROR), bench->values[i],
+                CVT100_ERR(ZYAN_VT100SGR_RESET));
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Stages                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+static void SetupNone(Bench* bench, ZyanU32 input)
+{
+    ZYAN_UNUSED(bench);
+    ZYAN_UNUSED(input);
+}
+
+static void SetupCollectOptionalPrefixes(Bench* bench, ZyanU32 input)
+{
+    const DecoderSample* sample = &bench->samples[input];
+    InitDecoderState(bench, sample->data, sample->length);
+}
+
+static void RunCollectOptionalPrefixes(Bench* bench, ZyanU32 input)
+{
+    ZYAN_UNUSED(input);
+    (void)ZydisCollectOptionalPrefixes(&bench->state, &bench->instruction);
+}
+
+static void SetupDecodeInstruction(Bench* bench, ZyanU32 input)
+{
+    const DecoderSample* sample = &bench->samples[input];
+    bench->state = sample->prefixes_state;
+    bench->state.context = &bench->context;
+    bench->instruction = sample->prefixes_instruction;
+    bench->context = sample->prefixes_context;
+}
+
+static void RunDecodeInstruction(Bench* bench, ZyanU32 input)
+{
+    ZYAN_UNUSED(input);
+    (void)ZydisDecodeInstruction(&bench->state, &bench->instruction);
+}
+
+static void SetupDecoded(Bench* bench, ZyanU32 input)
+{
+    const DecoderSample* sample = &bench->samples[input];
+    bench->state = sample->state;
+    bench->state.context = &bench->context;
+    bench->instruction = sample->instruction;
+    bench->context = sample->context;
+}
+
+static void SetupSetAVXInformation(Bench* bench, ZyanU32 input)
+{
+    // `ZydisSetAVXInformation` asserts that the AVX info it writes is still zeroed
+    SetupDecoded(bench, input);
+    ZYAN_MEMSET(&bench->instruction.avx, 0, sizeof(bench->instruction.avx));
+}
+
+static void RunSetAttributes(Bench* bench, ZyanU32 input)
+{
+    ZydisSetAttributes(&bench->state, &bench->instruction,
+        (const ZydisInstructionDefinition*)bench->samples[input].context.definition);
+}
+
+static void RunSetAVXInformation(Bench* bench, ZyanU32 input)
+{
+    ZydisSetAVXInformation(&bench->context, &bench->instruction,
+        (const ZydisInstructionDefinition*)bench->samples[input].context.definition);
+}
+
+static void RunDecodeOperands(Bench* bench, ZyanU32 input)
+{
+    const DecoderSample* sample = &bench->samples[input];
+    (void)ZydisDecodeOperands(&bench->decoder, &sample->context, &sample->instruction,
+        bench->operands, sample->instruction.operand_count, ZYAN_FALSE);
+}
+
+static void SetupStringAppendHexU64(Bench* bench, ZyanU32 input)
+{
+    ZYAN_UNUSED(input);
+    ZydisFormatterBufferInit(&bench->buffer, bench->text, sizeof(bench->text));
+}
+
+static void RunStringAppendHexU64(Bench* bench, ZyanU32 input)
+{
+    (void)ZydisStringAppendHexU64(&bench->buffer.string, bench->values[input], 0, ZYAN_FALSE,
+        ZYAN_TRUE);
+}
+
+static void RunFormatOperandMEM(Bench* bench, ZyanU32 input)
+{
+    ZYAN_UNUSED(input);
+    (void)ZydisFormatterIntelFormatOperandMEM(&bench->formatter, &bench->buffer,
+        &bench->formatter_context);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Measurement                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+static ZyanU64 TimeRound(Bench* bench, const Stage* stage, StageFunc run)
+{
+    const ZyanU64 start = ReadTimer();
+    for (ZyanU32 i = 0; i < stage->input_count; ++i)
+    {
+        stage->setup(bench, stage->inputs[i]);
+        run(bench, stage->inputs[i]);
+    }
+    return ReadTimer() - start;
+}
+
+static int CompareI64(const void* a, const void* b)
+{
+    const ZyanI64 x = *(const ZyanI64*)a;
+    const ZyanI64 y = *(const ZyanI64*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Times the given stage and prints the net minimum and median time per call.
+ *
+ * @param   bench   A pointer to the `Bench` struct.
+ * @param   stage   A pointer to the `Stage` struct.
+ * @param   rounds  The number of timed rounds.
+ * @param   times   A buffer for `rounds` values.
+ */
+static void TimeStage(Bench* bench, const Stage* stage, ZyanU32 rounds, ZyanI64* times)
+{
+    if (!stage->input_count)
+    {
+        ZYAN_PRINTF("%-36s %8u %12s %12s\n", stage->name, 0, "-", "-");
+        return;
+    }
+
+    // Warmup
+    TimeRound(bench, stage, stage->run);
+    TimeRound(bench, stage, &SetupNone);
+
+    // Each stage round is paired with the adjacent baseline round, so the net time of a pair
+    // cancels the noise both have in common
+    for (ZyanU32 i = 0; i < rounds; ++i)
+    {
+        const ZyanU64 stage_time = TimeRound(bench, stage, stage->run);
+        const ZyanU64 baseline_time = TimeRound(bench, stage, &SetupNone);
+        times[i] = (ZyanI64)stage_time - (ZyanI64)baseline_time;
+    }
+    qsort(times, rounds, sizeof(ZyanI64), &CompareI64);
+
+    const double min = (double)times[0] / stage->input_count;
+    const double median = (double)times[rounds / 2] / stage->input_count;
+    ZYAN_PRINTF("%-36s %8" PRIu32 " %s%12.1f%s %s%12.1f%s\n", stage->name, stage->input_count,
+        CVT100_OUT(ZYAN_VT100SGR_FG_BRIGHT_GREEN), ZYAN_MAX(min, 0.0), CVT100_OUT(COLOR_DEFAULT),
+        CVT100_OUT(ZYAN_VT100SGR_FG_CYAN), ZYAN_MAX(median, 0.0), CVT100_OUT(COLOR_DEFAULT));
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-check] [-rounds <n>] [input file]...%s\n",
+        CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "ZydisMicroBench"),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    ZyanBool check_only = ZYAN_FALSE;
+    ZyanU32 rounds = DEFAULT_ROUNDS;
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        if (!ZYAN_STRCMP(argv[i], "-check"))
+        {
+            check_only = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(argv[i], "-rounds") && (i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+        {
+            rounds = (ZyanU32)atoi(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    static Bench bench;
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&bench.decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) ||
+        !ZYAN_SUCCESS(ZydisFormatterInit(&bench.formatter, ZYDIS_FORMATTER_STYLE_INTEL)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder or formatter%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    bench.samples = malloc(MAX_SAMPLES * sizeof(DecoderSample));
+    bench.values = malloc(MAX_SAMPLES * 3 * sizeof(ZyanU64));
+    bench.memory_operands = malloc(MAX_SAMPLES * ZYDIS_MAX_OPERAND_COUNT * sizeof(ZyanU32));
+    ZyanU32* inputs = malloc(MAX_SAMPLES * 4 * sizeof(ZyanU32));
+    ZyanI64* times = malloc(rounds * sizeof(ZyanI64));
+    ZyanU8** files = calloc((size_t)(argc - i) + 1, sizeof(ZyanU8*));
+    int result = EXIT_FAILURE;
+    if (!bench.samples || !bench.values || !bench.memory_operands || !inputs || !times || !files)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to allocate memory%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        goto cleanup;
+    }
+
+    // The input files stay in memory, as the captured decoder states point into them
+    ZyanBool valid = ZYAN_TRUE;
+    if (i == argc)
+    {
+        valid = CaptureSamples(&bench, SAMPLE_CODE, sizeof(SAMPLE_CODE), RUNTIME_ADDRESS);
+    }
+    for (int j = 0; i < argc; ++i, ++j)
+    {
+        size_t size;
+        files[j] = ReadFile(argv[i], &size);
+        if (!files[j])
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not read input file \"%s\"%s\n",
+                CVT100_ERR(COLOR_ERROR), argv[i], CVT100_ERR(ZYAN_VT100SGR_RESET));
+            goto cleanup;
+        }
+        valid &= CaptureSamples(&bench, files[j], size, RUNTIME_ADDRESS);
+    }
+    valid &= CheckHexValues(&bench);
+    if (!valid)
+    {
+        goto cleanup;
+    }
+
+    ZYAN_PRINTF("Captured %" PRIu32 " instructions, %" PRIu32 " values and %" PRIu32
+        " memory operands\n", bench.sample_count, bench.value_count, bench.memory_operand_count);
+    result = EXIT_SUCCESS;
+    if (check_only)
+    {
+        goto cleanup;
+    }
+
+    // Input lists of the decoder stages
+    ZyanU32* all = inputs;
+    ZyanU32* avx = all + MAX_SAMPLES;
+    ZyanU32* with_operands = avx + MAX_SAMPLES;
+    ZyanU32* values = with_operands + MAX_SAMPLES;
+    ZyanU32 avx_count = 0;
+    ZyanU32 with_operands_count = 0;
+    for (ZyanU32 j = 0; j < bench.sample_count; ++j)
+    {
+        all[j] = j;
+        switch (bench.samples[j].instruction.encoding)
+        {
+        case ZYDIS_INSTRUCTION_ENCODING_XOP:
+        case ZYDIS_INSTRUCTION_ENCODING_VEX:
+        case ZYDIS_INSTRUCTION_ENCODING_EVEX:
+        case ZYDIS_INSTRUCTION_ENCODING_MVEX:
+            avx[avx_count++] = j;
+            break;
+        default:
+            break;
+        }
+        if (bench.samples[j].instruction.operand_count)
+        {
+            with_operands[with_operands_count++] = j;
+        }
+    }
+    for (ZyanU32 j = 0; j < bench.value_count; ++j)
+    {
+        values[j] = j;
+    }
+
+    const Stage stages[] =
+    {
+        { "ZydisCollectOptionalPrefixes", &SetupCollectOptionalPrefixes,
+            &RunCollectOptionalPrefixes, all, bench.sample_count },
+        { "ZydisDecodeInstruction", &SetupDecodeInstruction, &RunDecodeInstruction, all,
+            bench.sample_count },
+        { "ZydisSetAttributes", &SetupDecoded, &RunSetAttributes, all, bench.sample_count },
+        { "ZydisSetAVXInformation", &SetupSetAVXInformation, &RunSetAVXInformation, avx,
+            avx_count },
+        { "ZydisDecodeOperands", &SetupNone, &RunDecodeOperands, with_operands,
+            with_operands_count },
+        { "ZydisStringAppendHexU64", &SetupStringAppendHexU64, &RunStringAppendHexU64, values,
+            bench.value_count },
+        { "ZydisFormatterIntelFormatOperandMEM", &SetupFormatOperandMEM, &RunFormatOperandMEM,
+            bench.memory_operands, bench.memory_operand_count }
+    };
+
+    ZYAN_PRINTF("\n%-36s %8s %12s %12s\n", "Stage (" TIMER_UNIT " per call)", "Inputs", "Min",
+        "Median");
+    for (ZyanUSize j = 0; j < ZYAN_ARRAY_LENGTH(stages); ++j)
+    {
+        TimeStage(&bench, &stages[j], rounds, times);
+    }
+
+cleanup:
+    for (ZyanUSize j = 0; files && files[j]; ++j)
+    {
+        free(files[j]);
+    }
+    free(files);
+    free(times);
+    free(inputs);
+    free(bench.memory_operands);
+    free(bench.values);
+    free(bench.samples);
+
+    return result;
+}
+
+/* ============================================================================================== */
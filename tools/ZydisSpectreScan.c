@@ -0,0 +1,435 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Scans raw code files or the executable sections of ELF files for Spectre variant 1 gadget
+ * candidates. The code is split into chunks that are scanned in parallel.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Colors                                                                                         */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Configuration                                                                                  */
+/* ---------------------------------------------------------------------------------------------- */
+
+#define COLOR_ADDRESS   ZYAN_VT100SGR_FG_BRIGHT_GREEN
+#define COLOR_HAZARD    ZYAN_VT100SGR_FG_BRIGHT_YELLOW
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of bytes searched for conditional branches by a single work item.
+ */
+#define CHUNK_SIZE 0x10000
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `Chunk` struct.
+ */
+typedef struct Chunk_
+{
+    /**
+     * A pointer to the code of the whole section.
+     */
+    const ZyanU8* data;
+    /**
+     * The size of the section.
+     */
+    ZyanU64 size;
+    /**
+     * The runtime address of the section.
+     */
+    ZyanU64 address;
+    /**
+     * The offset of the first byte of this chunk, relative to the section.
+     */
+    ZyanU64 begin;
+    /**
+     * The offset of the last byte (exclusive) of this chunk, relative to the section.
+     */
+    ZyanU64 end;
+    /**
+     * The gadgets found in this chunk (`ZydisSpectreGadget`).
+     */
+    Vector gadgets;
+    /**
+     * Signals, if the scan ran out of memory.
+     */
+    ZyanBool failed;
+} Chunk;
+
+/**
+ * Defines the `ScanContext` struct.
+ */
+typedef struct ScanContext_
+{
+    /**
+     * The scanner.
+     */
+    ZydisSpectreScanner scanner;
+    /**
+     * The work items (`Chunk`).
+     */
+    Vector chunks;
+    /**
+     * The number of worker threads.
+     */
+    size_t thread_count;
+} ScanContext;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Splits a code region into chunks.
+ *
+ * @param   context A pointer to the `ScanContext` struct.
+ * @param   data    A pointer to the code.
+ * @param   size    The size of the code.
+ * @param   address The runtime address of the code.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if out of memory.
+ */
+static ZyanBool AddRegion(ScanContext* context, const ZyanU8* data, ZyanU64 size,
+    ZyanU64 address)
+{
+    for (ZyanU64 begin = 0; begin < size; begin += CHUNK_SIZE)
+    {
+        Chunk chunk;
+        ZYAN_MEMSET(&chunk, 0, sizeof(chunk));
+        chunk.data = data;
+        chunk.size = size;
+        chunk.address = address;
+        chunk.begin = begin;
+        chunk.end = ZYAN_MIN(begin + CHUNK_SIZE, size);
+        VectorInit(&chunk.gadgets, sizeof(ZydisSpectreGadget));
+        if (!VectorPush(&context->chunks, &chunk))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Adds the executable sections of a little-endian ELF file.
+ *
+ * @param   context         A pointer to the `ScanContext` struct.
+ * @param   data            A pointer to the file data.
+ * @param   size            The file size.
+ * @param   has_machine_mode Signals, if the machine mode was given on the command line.
+ *
+ * @return  `ZYAN_TRUE`, if the file is a supported ELF file or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool AddELF(ScanContext* context, const ZyanU8* data, size_t size,
+    ZyanBool has_machine_mode)
+{
+    if ((size < 0x34) || ZYAN_MEMCMP(data, "\x7F" "ELF", 4) || (data[5] != 1))
+    {
+        return ZYAN_FALSE;
+    }
+
+    const ZyanBool is_64 = (data[4] == 2);
+    if ((!is_64 && (data[4] != 1)) || (is_64 && (size < 0x40)))
+    {
+        return ZYAN_FALSE;
+    }
+
+    if (!has_machine_mode)
+    {
+        ZydisSpectreScannerInit(&context->scanner,
+            is_64 ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
+            is_64 ? ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32, context->scanner.window);
+    }
+
+    ElfSectionTable sections;
+    if (!ReadSectionTable(data, size, is_64, &sections))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sMalformed section header table%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return ZYAN_TRUE;
+    }
+
+    ElfSection section;
+    for (ZyanU64 i = 0; i < sections.count; ++i)
+    {
+        ReadSection(&sections, i, &section);
+        // Skip `SHT_NOBITS` and sections without `SHF_EXECINSTR`
+        if ((section.type == 8) || !(section.flags & 0x4) || !section.size ||
+            (section.offset > size) || (section.size > size - section.offset) ||
+            (section.size > ZYAN_UINT32_MAX))
+        {
+            continue;
+        }
+        if (!AddRegion(context, data + section.offset, section.size, section.address))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Stores a gadget in the current chunk.
+ *
+ * @param   gadget      A pointer to the `ZydisSpectreGadget` struct.
+ * @param   user_data   A pointer to the `Chunk` struct.
+ *
+ * @return  A zyan status code.
+ */
+static ZyanStatus OnGadget(const ZydisSpectreGadget* gadget, void* user_data)
+{
+    Chunk* chunk = (Chunk*)user_data;
+    if (!VectorPush(&chunk->gadgets, gadget))
+    {
+        chunk->failed = ZYAN_TRUE;
+        return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+    }
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Scans every `count`-th chunk, starting at the index of the worker.
+ *
+ * @param   user_data   A pointer to the `ScanContext` struct.
+ * @param   index       The index of the worker.
+ * @param   count       The number of workers.
+ */
+static void RunWorker(void* user_data, size_t index, size_t count)
+{
+    const ScanContext* context = (const ScanContext*)user_data;
+
+    // Every thread uses its own arena, so no synchronization is required
+    ZydisSpectreArena* arena = malloc(sizeof(ZydisSpectreArena));
+    if (!arena)
+    {
+        for (size_t i = index; i < context->chunks.count; i += count)
+        {
+            VECTOR_AT(&context->chunks, Chunk, i).failed = ZYAN_TRUE;
+        }
+        return;
+    }
+    ZydisSpectreArenaInit(arena);
+
+    for (size_t i = index; i < context->chunks.count; i += count)
+    {
+        Chunk* chunk = &VECTOR_AT(&context->chunks, Chunk, i);
+        ZydisSpectreScan(&context->scanner, arena, chunk->data, (ZyanUSize)chunk->size,
+            chunk->address, (ZyanUSize)chunk->begin, (ZyanUSize)chunk->end, &OnGadget, chunk);
+    }
+
+    free(arena);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] [-jobs N] [-window N] " \
+        "<input file>%s\n", CVT100_ERR(COLOR_ERROR), (argc > 0 ? argv[0] : "ZydisSpectreScan"),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    static ScanContext context;
+    VectorInit(&context.chunks, sizeof(Chunk));
+    context.thread_count = GetProcessorCount();
+    ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+    ZyanBool has_machine_mode = ZYAN_FALSE;
+    ZyanU32 window = ZYDIS_SPECTRE_DEFAULT_WINDOW;
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+            stack_width = ZYDIS_STACK_WIDTH_64;
+            has_machine_mode = ZYAN_TRUE;
+        }
+        else if (!ZYAN_STRCMP(arg, "-jobs") && (i + 1 < argc))
+        {
+            context.thread_count = (size_t)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!context.thread_count)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (!ZYAN_STRCMP(arg, "-window") && (i + 1 < argc))
+        {
+            window = (ZyanU32)strtoul(argv[++i], ZYAN_NULL, 10);
+            if (!window)
+            {
+                PrintUsage(argc, argv);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+    if (i + 1 != argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    ZyanU8* data = ReadFile(argv[i], &size);
+    if (!data)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not read file%s\n", CVT100_ERR(COLOR_ERROR),
+            CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_FAILURE;
+    ZydisSpectreScannerInit(&context.scanner, machine_mode, stack_width, window);
+    const ZyanBool is_elf = AddELF(&context, data, size, has_machine_mode);
+    if ((!is_elf && (size > ZYAN_UINT32_MAX)) ||
+        (!is_elf && !AddRegion(&context, data, size, 0)))
+    {
+        goto out_of_memory;
+    }
+
+    if (context.thread_count > context.chunks.count)
+    {
+        context.thread_count = context.chunks.count ? context.chunks.count : 1;
+    }
+    if (!RunWorkers(context.thread_count, &RunWorker, &context))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to start all worker threads%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+    }
+
+    size_t count = 0;
+    for (size_t j = 0; j < context.chunks.count; ++j)
+    {
+        const Chunk* chunk = &VECTOR_AT(&context.chunks, Chunk, j);
+        if (chunk->failed)
+        {
+            goto out_of_memory;
+        }
+        for (size_t k = 0; k < chunk->gadgets.count; ++k)
+        {
+            const ZydisSpectreGadget* gadget = &VECTOR_AT(&chunk->gadgets, ZydisSpectreGadget, k);
+            ZYAN_PRINTF("%s%016" PRIX64 "%s: %sgadget%s (%s): load %016" PRIX64
+                ", dependent load %016" PRIX64 "\n",
+                CVT100_OUT(COLOR_ADDRESS), gadget->branch, CVT100_OUT(ZYAN_VT100SGR_RESET),
+                CVT100_OUT(COLOR_HAZARD), CVT100_OUT(ZYAN_VT100SGR_RESET),
+                gadget->is_taken ? "taken" : "fall-through", gadget->load,
+                gadget->dependent_load);
+        }
+        count += chunk->gadgets.count;
+    }
+
+    ZYAN_FPRINTF(ZYAN_STDERR, "%zu gadget candidate(s)\n", count);
+    result = EXIT_SUCCESS;
+    goto cleanup;
+
+out_of_memory:
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sOut of memory%s\n", CVT100_ERR(COLOR_ERROR),
+        CVT100_ERR(ZYAN_VT100SGR_RESET));
+
+cleanup:
+    for (size_t j = 0; j < context.chunks.count; ++j)
+    {
+        VectorDestroy(&VECTOR_AT(&context.chunks, Chunk, j).gadgets);
+    }
+    VectorDestroy(&context.chunks);
+    free(data);
+
+    return result;
+}
+
+/* ============================================================================================== */
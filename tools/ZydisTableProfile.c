@@ -0,0 +1,203 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ * Decodes one or more raw code files using a linear sweep and writes the number of visits of
+ * every decoder filter table row to a profile file. The profile is the input of
+ * `assets/generate_decoder_tables.py --import-profile`.
+ *
+ * This tool requires a library that was built with `ZYDIS_PROFILE_DECODER_TABLES`.
+ */
+
+#include "ZydisToolsShared.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Zycore/API/Terminal.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+#include <Zydis/Internal/DecoderData.h>
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/**
+ * Decodes the given buffer using a linear sweep. Undecodable bytes are skipped one at a time.
+ *
+ * @param   decoder A pointer to the `ZydisDecoder` instance.
+ * @param   data    A pointer to the code.
+ * @param   size    The length of the code.
+ *
+ * @return  The number of decoded instructions.
+ */
+static ZyanU64 DecodeBuffer(const ZydisDecoder* decoder, const ZyanU8* data, size_t size)
+{
+    ZyanU64 count = 0;
+    ZydisDecodedInstruction instruction;
+    for (size_t offset = 0; offset < size; )
+    {
+        if (ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, ZYAN_NULL, data + offset,
+            size - offset, &instruction)))
+        {
+            offset += instruction.length;
+            ++count;
+        }
+        else
+        {
+            ++offset;
+        }
+    }
+    return count;
+}
+
+/**
+ * Writes the visit counts of all filter table rows that were visited at least once.
+ *
+ * @param   file    The output stream.
+ */
+static void WriteProfile(FILE* file)
+{
+    fprintf(file, "# Zydis decoder table profile: <node type> <row> <visits>\n");
+    for (ZyanU8 type = ZYDIS_NODETYPE_FILTER_XOP; type <= ZYDIS_NODETYPE_FILTER_MODE_UD0_COMPAT;
+        ++type)
+    {
+        for (ZyanU16 row = 0; row < ZYDIS_DECODER_TREE_PROFILE_MAX_ROWS; ++row)
+        {
+            const ZyanU32 visits = ZydisDecoderTreeGetVisitCount(type, row);
+            if (visits)
+            {
+                fprintf(file, "0x%02X 0x%04X %" PRIu32 "\n", type, row, visits);
+            }
+        }
+    }
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+void PrintUsage(int argc, char* argv[])
+{
+    ZYAN_FPRINTF(ZYAN_STDERR, "%sUsage: %s [-real|-16|-32|-64] <profile file> " \
+        "<input file>...%s\n", CVT100_ERR(COLOR_ERROR),
+        (argc > 0 ? argv[0] : "ZydisTableProfile"), CVT100_ERR(ZYAN_VT100SGR_RESET));
+}
+
+int main(int argc, char** argv)
+{
+    InitVT100();
+
+    if (ZydisGetVersion() != ZYDIS_VERSION)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sInvalid zydis version%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    ZydisMachineMode machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    ZydisStackWidth stack_width = ZYDIS_STACK_WIDTH_64;
+
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i)
+    {
+        const char* arg = argv[i];
+        if (!ZYAN_STRCMP(arg, "-real"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_REAL_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-16"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_16;
+            stack_width = ZYDIS_STACK_WIDTH_16;
+        }
+        else if (!ZYAN_STRCMP(arg, "-32"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_COMPAT_32;
+            stack_width = ZYDIS_STACK_WIDTH_32;
+        }
+        else if (!ZYAN_STRCMP(arg, "-64"))
+        {
+            machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+            stack_width = ZYDIS_STACK_WIDTH_64;
+        }
+        else
+        {
+            PrintUsage(argc, argv);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (i + 2 > argc)
+    {
+        PrintUsage(argc, argv);
+        return EXIT_FAILURE;
+    }
+
+    ZydisDecoder decoder;
+    if (!ZYAN_SUCCESS(ZydisDecoderInit(&decoder, machine_mode, stack_width)))
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sFailed to initialize decoder%s\n",
+            CVT100_ERR(COLOR_ERROR), CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+
+    const char* profile_path = argv[i++];
+    ZyanU64 instruction_count = 0;
+    for (; i < argc; ++i)
+    {
+        size_t size;
+        ZyanU8* data = ReadFile(argv[i], &size);
+        if (!data)
+        {
+            ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not read input file \"%s\"%s\n",
+                CVT100_ERR(COLOR_ERROR), argv[i], CVT100_ERR(ZYAN_VT100SGR_RESET));
+            return EXIT_FAILURE;
+        }
+        instruction_count += DecodeBuffer(&decoder, data, size);
+        free(data);
+    }
+
+    FILE* output = fopen(profile_path, "w");
+    if (!output)
+    {
+        ZYAN_FPRINTF(ZYAN_STDERR, "%sCan not open output file \"%s\"%s\n",
+            CVT100_ERR(COLOR_ERROR), profile_path, CVT100_ERR(ZYAN_VT100SGR_RESET));
+        return EXIT_FAILURE;
+    }
+    WriteProfile(output);
+    fclose(output);
+
+    ZYAN_PRINTF("Profiled %" PRIu64 " instructions\n", instruction_count);
+
+    return EXIT_SUCCESS;
+}
+
+/* ============================================================================================== */
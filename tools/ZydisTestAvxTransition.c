@@ -0,0 +1,297 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the AVX-SSE transition analysis (`ZydisAvxTransitionAnalyze`) with hand-assembled
+ * functions.
+ *
+ * Every case lists the exact hazards that have to be reported, covering SSE instructions, calls,
+ * tail-jumps and returns reached with dirty upper halves as well as the instructions that leave
+ * the upper state untouched.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+#include "ZydisToolsShared.h"
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The runtime address of every test function.
+ */
+#define RUNTIME_ADDRESS 0x1000
+
+/**
+ * The size of the workspace used by the tests.
+ */
+#define WORKSPACE_SIZE 1024
+
+#define SSE     ZYDIS_AVX_TRANSITION_HAZARD_SSE
+#define CALL    ZYDIS_AVX_TRANSITION_HAZARD_CALL
+#define RETURN  ZYDIS_AVX_TRANSITION_HAZARD_RETURN
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct ExpectedHazard_
+{
+    ZydisAvxTransitionHazardType type;
+    ZyanU8 offset;
+    ZydisMnemonic mnemonic;
+} ExpectedHazard;
+
+typedef struct TestCase_
+{
+    const char* name;
+    ZyanU8 length;
+    ZyanU8 code[24];
+    ZyanU8 hazard_count;
+    ExpectedHazard hazards[4];
+} TestCase;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const TestCase TEST_CASES[] =
+{
+    // vaddps xmm0, xmm0, xmm0; addps xmm0, xmm0; ret
+    { "VEX.128 write keeps the upper state clean", 8,
+        { 0xC5, 0xF8, 0x58, 0xC0, 0x0F, 0x58, 0xC0, 0xC3 },
+        0, { { 0 } } },
+    // vaddps ymm0, ymm0, ymm0; addps xmm0, xmm0; vzeroupper; ret
+    { "YMM write followed by SSE", 11,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0x0F, 0x58, 0xC0, 0xC5, 0xF8, 0x77, 0xC3 },
+        1, { { SSE, 4, ZYDIS_MNEMONIC_ADDPS } } },
+    // vaddps ymm0, ymm0, ymm0; movd xmm0, eax; ret
+    { "YMM write followed by SSE with a GPR operand", 9,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0x66, 0x0F, 0x6E, 0xC0, 0xC3 },
+        2, { { SSE, 4, ZYDIS_MNEMONIC_MOVD }, { RETURN, 8, ZYDIS_MNEMONIC_RET } } },
+    // vaddps zmm0, zmm0, zmm0; ret
+    { "ZMM write followed by ret", 7,
+        { 0x62, 0xF1, 0x7C, 0x48, 0x58, 0xC0, 0xC3 },
+        1, { { RETURN, 6, ZYDIS_MNEMONIC_RET } } },
+    // vaddps ymm0, ymm0, ymm0; ret
+    { "YMM write followed by ret", 5,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xC3 },
+        1, { { RETURN, 4, ZYDIS_MNEMONIC_RET } } },
+    // vaddps ymm0, ymm0, ymm0; call $+5; vzeroupper; ret
+    { "YMM write followed by call", 13,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xE8, 0x00, 0x00, 0x00, 0x00, 0xC5, 0xF8, 0x77, 0xC3 },
+        1, { { CALL, 4, ZYDIS_MNEMONIC_CALL } } },
+    // vaddps ymm0, ymm0, ymm0; call rax; vzeroupper; ret
+    { "YMM write followed by indirect call", 10,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xFF, 0xD0, 0xC5, 0xF8, 0x77, 0xC3 },
+        1, { { CALL, 4, ZYDIS_MNEMONIC_CALL } } },
+    // vaddps ymm0, ymm0, ymm0; jmp $+18
+    { "YMM write followed by tail-jump", 6,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xEB, 0x10 },
+        1, { { CALL, 4, ZYDIS_MNEMONIC_JMP } } },
+    // vaddps ymm0, ymm0, ymm0; jmp $+2; vzeroupper; ret
+    { "jump into the function is no tail-jump", 10,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xEB, 0x00, 0xC5, 0xF8, 0x77, 0xC3 },
+        0, { { 0 } } },
+    // vaddps ymm0, ymm0, ymm0; vzeroupper; addps xmm0, xmm0; ret
+    { "vzeroupper cleans the upper state", 11,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xC5, 0xF8, 0x77, 0x0F, 0x58, 0xC0, 0xC3 },
+        0, { { 0 } } },
+    // vaddps ymm0, ymm0, ymm0; vzeroall; addps xmm0, xmm0; ret
+    { "vzeroall cleans the upper state", 11,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xC5, 0xFC, 0x77, 0x0F, 0x58, 0xC0, 0xC3 },
+        0, { { 0 } } },
+    // vmovdqa [rax], ymm0; addps xmm0, xmm0; ret
+    { "YMM read keeps the upper state clean", 8,
+        { 0xC5, 0xFD, 0x7F, 0x00, 0x0F, 0x58, 0xC0, 0xC3 },
+        0, { { 0 } } },
+    // vaddps ymm0, ymm0, ymm0; paddb mm0, mm0; fld st0; vzeroupper; ret
+    { "MMX and x87 are no SSE", 13,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0x0F, 0xFC, 0xC0, 0xD9, 0xC0, 0xC5, 0xF8, 0x77, 0xC3 },
+        0, { { 0 } } },
+    // jz $+6; vaddps ymm0, ymm0, ymm0; addps xmm0, xmm0; ret
+    { "YMM write on one path only", 10,
+        { 0x74, 0x04, 0xC5, 0xFC, 0x58, 0xC0, 0x0F, 0x58, 0xC0, 0xC3 },
+        2, { { SSE, 6, ZYDIS_MNEMONIC_ADDPS }, { RETURN, 9, ZYDIS_MNEMONIC_RET } } },
+    // addps xmm0, xmm0; vaddps ymm0, ymm0, ymm0; jnz $-7; vzeroupper; ret
+    { "YMM write reaches SSE through a back-edge", 13,
+        { 0x0F, 0x58, 0xC0, 0xC5, 0xFC, 0x58, 0xC0, 0x75, 0xF7, 0xC5, 0xF8, 0x77, 0xC3 },
+        1, { { SSE, 0, ZYDIS_MNEMONIC_ADDPS } } },
+    // vaddps ymm0, ymm0, ymm0; ret; addps xmm0, xmm0; ret
+    { "unreachable code is ignored", 9,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0xC3, 0x0F, 0x58, 0xC0, 0xC3 },
+        1, { { RETURN, 4, ZYDIS_MNEMONIC_RET } } },
+    // vaddps ymm0, ymm0, ymm0; ud2; addps xmm0, xmm0; ret
+    { "ud2 terminates the control flow", 10,
+        { 0xC5, 0xFC, 0x58, 0xC0, 0x0F, 0x0B, 0x0F, 0x58, 0xC0, 0xC3 },
+        0, { { 0 } } }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanStatus CollectHazard(const ZydisAvxTransitionHazard* hazard, void* user_data)
+{
+    return ResultListPush((ResultList*)user_data, hazard);
+}
+
+static void GetCaseInfo(const void* test_case, const char** name, size_t* expected_count)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    *name = test->name;
+    *expected_count = test->hazard_count;
+}
+
+static ZyanStatus RunCase(void* context, const void* test_case, ResultList* list)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    ZyanU8 workspace[WORKSPACE_SIZE];
+    return ZydisAvxTransitionAnalyze((const ZydisDecoder*)context, test->code, test->length,
+        RUNTIME_ADDRESS, workspace, sizeof(workspace), &CollectHazard, list);
+}
+
+static ZyanBool CompareHazard(const void* test_case, const void* result, size_t index)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    const ZydisAvxTransitionHazard* hazard = (const ZydisAvxTransitionHazard*)result;
+    const ExpectedHazard* expected = &test->hazards[index];
+    if ((hazard->type == expected->type) && (hazard->offset == expected->offset) &&
+        (hazard->address == (ZyanU64)RUNTIME_ADDRESS + expected->offset) &&
+        (hazard->mnemonic == expected->mnemonic))
+    {
+        return ZYAN_TRUE;
+    }
+
+    ZYAN_PRINTF("FAILED: %s: expected hazard %d at +%u (%s), got %d at +%u (%s, 0x%" PRIX64
+        ")\n", test->name, expected->type, expected->offset,
+        ZydisMnemonicGetString(expected->mnemonic), hazard->type, (unsigned)hazard->offset,
+        ZydisMnemonicGetString(hazard->mnemonic), hazard->address);
+    return ZYAN_FALSE;
+}
+
+static void PrintHazard(const void* result)
+{
+    const ZydisAvxTransitionHazard* hazard = (const ZydisAvxTransitionHazard*)result;
+    ZYAN_PRINTF("  hazard %d at +%u (%s)\n", hazard->type, (unsigned)hazard->offset,
+        ZydisMnemonicGetString(hazard->mnemonic));
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestCases(ZydisDecoder* decoder)
+{
+    const TestTable table =
+    {
+        "hand-assembled functions", TEST_CASES, sizeof(TestCase), ZYAN_ARRAY_LENGTH(TEST_CASES),
+        sizeof(ZydisAvxTransitionHazard), decoder, &GetCaseInfo, &RunCase,
+        &CompareHazard, &PrintHazard
+    };
+    return RunTestTable(&table);
+}
+
+static ZyanBool TestCallbackStatus(const ZydisDecoder* decoder)
+{
+    // The first status code other than `ZYAN_STATUS_SUCCESS` has to stop the analysis
+    const TestCase* test = &TEST_CASES[2];
+    ZyanU8 workspace[WORKSPACE_SIZE];
+    ResultList list;
+    ResultListInit(&list, sizeof(ZydisAvxTransitionHazard), 1);
+    const ZyanBool passed =
+        (ZydisAvxTransitionAnalyze(decoder, test->code, test->length, RUNTIME_ADDRESS,
+            workspace, sizeof(workspace), &CollectHazard, &list) == ZYAN_STATUS_FAILED) &&
+        (list.results.count == 1);
+    ResultListDestroy(&list);
+
+    ZYAN_PRINTF("%s: callback status\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(const ZydisDecoder* decoder)
+{
+    const TestCase* test = &TEST_CASES[1];
+    ZyanU8 workspace[WORKSPACE_SIZE];
+    ResultList list;
+    ResultListInit(&list, sizeof(ZydisAvxTransitionHazard), 8);
+
+    ZyanUSize size;
+    ZydisDecoder minimal = *decoder;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisAvxTransitionGetWorkspaceSize(test->length, &size)) &&
+        (size == test->length * (sizeof(ZyanU32) + 1)) &&
+        (ZydisAvxTransitionAnalyze(decoder, test->code, test->length, RUNTIME_ADDRESS,
+            workspace, size - 1, &CollectHazard, &list) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+        (ZydisAvxTransitionAnalyze(decoder, test->code, test->length, RUNTIME_ADDRESS,
+            workspace, sizeof(workspace), ZYAN_NULL, &list) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisAvxTransitionAnalyze(decoder, ZYAN_NULL, 0, RUNTIME_ADDRESS,
+            ZYAN_NULL, 0, &CollectHazard, &list)) &&
+        ZYAN_SUCCESS(ZydisDecoderEnableMode(&minimal, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)) &&
+        (ZydisAvxTransitionAnalyze(&minimal, test->code, test->length, RUNTIME_ADDRESS,
+            workspace, sizeof(workspace), &CollectHazard, &list) == ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= (list.results.count == 0);
+    ResultListDestroy(&list);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+        ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestCases(&decoder);
+    all_passed &= TestCallbackStatus(&decoder);
+    all_passed &= TestArguments(&decoder);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
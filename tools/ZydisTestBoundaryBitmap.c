@@ -0,0 +1,447 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the boundary bitmap (`ZydisBoundaryBitmapBuild`) against the known instruction starts of
+ * synthetic code.
+ *
+ * The code mixes a fixed set of instructions with runs of undecodable bytes, so the bitmap
+ * contains dense words, empty words and empty superblocks. Every rank and select query is
+ * compared to a linear sweep over the known starts, before and after a serialization round-trip.
+ * Truncated and corrupted serialized forms have to be rejected.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The maximum size of the synthetic code.
+ */
+#define CODE_SIZE 0x40000
+
+/**
+ * A byte that can not be decoded in 64-bit mode and is thus never an instruction start.
+ */
+#define INVALID_BYTE 0x06
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef enum CodeKind_
+{
+    /**
+     * Random instructions with occasional runs of undecodable bytes.
+     */
+    CODE_KIND_MIXED,
+    /**
+     * Single-byte instructions only, every bit of the bitmap is set.
+     */
+    CODE_KIND_DENSE,
+    /**
+     * Undecodable bytes only, no bit of the bitmap is set.
+     */
+    CODE_KIND_EMPTY
+} CodeKind;
+
+typedef struct TestCase_
+{
+    const char* name;
+    CodeKind kind;
+    ZyanU32 length;
+} TestCase;
+
+typedef struct Code_
+{
+    ZyanU8* data;
+    ZyanU32 length;
+    ZyanU32* starts;
+    ZyanU32 start_count;
+} Code;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const TestCase TEST_CASES[] =
+{
+    { "empty code",                     CODE_KIND_MIXED,          0 },
+    { "single byte",                    CODE_KIND_DENSE,          1 },
+    { "one word minus one byte",        CODE_KIND_MIXED,         63 },
+    { "one word",                       CODE_KIND_MIXED,         64 },
+    { "one word plus one byte",         CODE_KIND_MIXED,         65 },
+    { "one superblock minus one byte",  CODE_KIND_MIXED,        511 },
+    { "one superblock",                 CODE_KIND_DENSE,        512 },
+    { "one superblock plus one byte",   CODE_KIND_MIXED,        513 },
+    { "dense superblocks",              CODE_KIND_DENSE,       5000 },
+    { "no instructions",                CODE_KIND_EMPTY,       3000 },
+    { "mixed code",                     CODE_KIND_MIXED,       1000 },
+    { "multiple select samples",        CODE_KIND_MIXED, CODE_SIZE - 13 }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU32 Random(ZyanU64* state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (ZyanU32)(*state >> 33);
+}
+
+static void GenerateCode(Code* code, CodeKind kind, ZyanU32 length, ZyanU64* state)
+{
+    static const struct
+    {
+        ZyanU8 length;
+        ZyanU8 bytes[10];
+    } instructions[] =
+    {
+        {  1, { 0x90 } },                                           // nop
+        {  3, { 0x48, 0x89, 0xC8 } },                               // mov rax, rcx
+        {  5, { 0xB8, 0x78, 0x56, 0x34, 0x12 } },                   // mov eax, 0x12345678
+        { 10, { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 } },             // mov rax, imm64
+        {  2, { 0x74, 0x10 } },                                     // jz
+        {  1, { 0xC3 } },                                           // ret
+        {  6, { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 } },             // nop word ptr [rax+rax]
+        { 15, { 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84 } }
+    };
+
+    code->length = length;
+    code->start_count = 0;
+    ZyanU32 offset = 0;
+    while (offset < length)
+    {
+        if ((kind == CODE_KIND_EMPTY) || ((kind == CODE_KIND_MIXED) && !(Random(state) % 32)))
+        {
+            // Long enough to span whole superblocks
+            const ZyanU32 run = ZYAN_MIN(1 + Random(state) % 1500, length - offset);
+            ZYAN_MEMSET(code->data + offset, INVALID_BYTE, run);
+            offset += run;
+            continue;
+        }
+
+        const ZyanUSize i = (kind == CODE_KIND_DENSE) ?
+            0 : Random(state) % ZYAN_ARRAY_LENGTH(instructions);
+        if (offset + instructions[i].length > length)
+        {
+            code->data[offset] = 0x90;
+            code->starts[code->start_count++] = offset++;
+            continue;
+        }
+        ZYAN_MEMSET(code->data + offset, 0, instructions[i].length);
+        ZYAN_MEMCPY(code->data + offset, instructions[i].bytes,
+            ZYAN_MIN(instructions[i].length, sizeof(instructions[i].bytes)));
+        code->starts[code->start_count++] = offset;
+        offset += instructions[i].length;
+    }
+}
+
+static void* AllocateWorkspace(ZyanUSize length, ZyanUSize* size)
+{
+    if (ZYAN_FAILED(ZydisBoundaryBitmapGetWorkspaceSize(length, size)))
+    {
+        return ZYAN_NULL;
+    }
+    // `malloc` returns memory suitably aligned for any type
+    return malloc(*size);
+}
+
+static ZyanBool CheckBitmap(const char* name, const char* stage,
+    const ZydisBoundaryBitmap* bitmap, const Code* code)
+{
+    ZyanUSize count;
+    if (ZYAN_FAILED(ZydisBoundaryBitmapGetCount(bitmap, &count)) ||
+        (count != code->start_count))
+    {
+        ZYAN_PRINTF("FAILED: %s (%s): expected %u instructions\n", name, stage,
+            code->start_count);
+        return ZYAN_FALSE;
+    }
+
+    // Rank: linear sweep over the known starts
+    ZyanU32 next = 0;
+    for (ZyanU32 offset = 0; offset < code->length; ++offset)
+    {
+        const ZyanBool is_start = (next < code->start_count) && (code->starts[next] == offset);
+        next += is_start ? 1 : 0;
+
+        ZyanUSize index = 0;
+        const ZyanStatus status = ZydisBoundaryBitmapOffsetToIndex(bitmap, offset, &index);
+        const ZyanBool is_correct = next ?
+            ((status == ZYAN_STATUS_SUCCESS) && (index == next - 1)) :
+            (status == ZYAN_STATUS_NOT_FOUND);
+        if (!is_correct || (ZydisBoundaryBitmapIsBoundary(bitmap, offset) !=
+            (is_start ? ZYAN_STATUS_TRUE : ZYAN_STATUS_FALSE)))
+        {
+            ZYAN_PRINTF("FAILED: %s (%s): offset %u, expected index %d, got %u (status 0x%08X)\n",
+                name, stage, offset, (int)next - 1, (unsigned)index, status);
+            return ZYAN_FALSE;
+        }
+    }
+
+    // Select
+    for (ZyanU32 i = 0; i < code->start_count; ++i)
+    {
+        ZyanUSize offset;
+        if (ZYAN_FAILED(ZydisBoundaryBitmapIndexToOffset(bitmap, i, &offset)) ||
+            (offset != code->starts[i]))
+        {
+            ZYAN_PRINTF("FAILED: %s (%s): index %u, expected offset %u\n", name, stage, i,
+                code->starts[i]);
+            return ZYAN_FALSE;
+        }
+    }
+
+    ZyanUSize value;
+    if ((ZydisBoundaryBitmapIndexToOffset(bitmap, code->start_count, &value) !=
+            ZYAN_STATUS_OUT_OF_RANGE) ||
+        (ZydisBoundaryBitmapOffsetToIndex(bitmap, code->length, &value) !=
+            ZYAN_STATUS_INVALID_ARGUMENT) ||
+        (ZydisBoundaryBitmapIsBoundary(bitmap, code->length) != ZYAN_STATUS_INVALID_ARGUMENT))
+    {
+        ZYAN_PRINTF("FAILED: %s (%s): queries out of range\n", name, stage);
+        return ZYAN_FALSE;
+    }
+
+    return ZYAN_TRUE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool RunTestCase(const ZydisDecoder* decoder, const TestCase* test, Code* code,
+    ZyanU64* state)
+{
+    GenerateCode(code, test->kind, test->length, state);
+
+    ZyanBool passed = ZYAN_FALSE;
+    ZyanU8* serialized = ZYAN_NULL;
+    void* restored_workspace = ZYAN_NULL;
+    ZyanUSize size;
+    void* workspace = AllocateWorkspace(code->length, &size);
+    if (!workspace)
+    {
+        ZYAN_PRINTF("FAILED: %s: out of memory\n", test->name);
+        goto cleanup;
+    }
+
+    ZydisBoundaryBitmap bitmap;
+    if (ZYAN_FAILED(ZydisBoundaryBitmapBuild(&bitmap, decoder, code->data, code->length,
+        workspace, size)))
+    {
+        ZYAN_PRINTF("FAILED: %s: ZydisBoundaryBitmapBuild\n", test->name);
+        goto cleanup;
+    }
+    if (!CheckBitmap(test->name, "built", &bitmap, code))
+    {
+        goto cleanup;
+    }
+
+    ZyanUSize serialized_size;
+    ZyanUSize code_length;
+    if (ZYAN_FAILED(ZydisBoundaryBitmapGetSerializedSize(&bitmap, &serialized_size)) ||
+        (serialized_size != ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE + (code->length + 63) / 64 * 8) ||
+        !(serialized = malloc(serialized_size)))
+    {
+        ZYAN_PRINTF("FAILED: %s: ZydisBoundaryBitmapGetSerializedSize\n", test->name);
+        goto cleanup;
+    }
+    ZyanUSize short_length = serialized_size - 1;
+    ZyanUSize length = serialized_size;
+    if ((ZydisBoundaryBitmapSerialize(&bitmap, serialized, &short_length) !=
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) ||
+        ZYAN_FAILED(ZydisBoundaryBitmapSerialize(&bitmap, serialized, &length)) ||
+        (length != serialized_size) ||
+        ZYAN_FAILED(ZydisBoundaryBitmapGetSerializedCodeLength(serialized, length,
+            &code_length)) ||
+        (code_length != code->length))
+    {
+        ZYAN_PRINTF("FAILED: %s: ZydisBoundaryBitmapSerialize\n", test->name);
+        goto cleanup;
+    }
+
+    ZydisBoundaryBitmap restored;
+    if (!(restored_workspace = AllocateWorkspace(code_length, &size)) ||
+        ZYAN_FAILED(ZydisBoundaryBitmapDeserialize(&restored, serialized, length,
+            restored_workspace, size)))
+    {
+        ZYAN_PRINTF("FAILED: %s: ZydisBoundaryBitmapDeserialize\n", test->name);
+        goto cleanup;
+    }
+    passed = CheckBitmap(test->name, "deserialized", &restored, code);
+
+cleanup:
+    free(restored_workspace);
+    free(serialized);
+    free(workspace);
+    return passed;
+}
+
+static ZyanBool TestCases(const ZydisDecoder* decoder, Code* code)
+{
+    ZyanU64 state = 0x5A5A5A5A;
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(TEST_CASES); ++i)
+    {
+        passed &= RunTestCase(decoder, &TEST_CASES[i], code, &state);
+    }
+    ZYAN_PRINTF("%s: rank and select of %u code layouts\n", passed ? "PASSED" : "FAILED",
+        (unsigned)ZYAN_ARRAY_LENGTH(TEST_CASES));
+    return passed;
+}
+
+static ZyanBool TestCorruption(const ZydisDecoder* decoder, Code* code)
+{
+    // The code length is not divisible by 64, so the last word has unused bits
+    ZyanU64 state = 0xC0DE;
+    GenerateCode(code, CODE_KIND_MIXED, 1000, &state);
+
+    ZyanU8 serialized[ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE + 16 * 8];
+    ZyanU8 corrupted[sizeof(serialized)];
+    ZydisBoundaryBitmap bitmap;
+    ZyanUSize length = sizeof(serialized);
+    ZyanUSize size;
+    void* workspace = AllocateWorkspace(code->length, &size);
+    if (!workspace ||
+        ZYAN_FAILED(ZydisBoundaryBitmapBuild(&bitmap, decoder, code->data, code->length,
+            workspace, size)) ||
+        ZYAN_FAILED(ZydisBoundaryBitmapSerialize(&bitmap, serialized, &length)) ||
+        (length != sizeof(serialized)))
+    {
+        ZYAN_PRINTF("FAILED: corrupted serialized forms: setup\n");
+        free(workspace);
+        return ZYAN_FALSE;
+    }
+
+    // Every mutation is applied to a fresh copy of the serialized form
+    static const struct
+    {
+        const char* name;
+        ZyanUSize length;
+        ZyanUSize offset;
+        ZyanU8 value;
+    } mutations[] =
+    {
+        { "truncated header",           ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE - 1,  0, 'Z'  },
+        { "header only",                ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE,      0, 'Z'  },
+        { "truncated bitmap",           sizeof(serialized) - 1,                 0, 'Z'  },
+        { "wrong magic",                sizeof(serialized),                     3, 'X'  },
+        { "wrong version",              sizeof(serialized),                     4, 2    },
+        { "code length too large",      sizeof(serialized),                     9, 0x04 },
+        { "code length above 32 bits",  sizeof(serialized),                    12, 1    },
+        { "wrong instruction count",    sizeof(serialized),                    16, 0    },
+        { "flipped bitmap bit",         sizeof(serialized),
+            ZYDIS_BOUNDARY_BITMAP_HEADER_SIZE,                                     0xFE }
+    };
+
+    ZyanBool passed = ZYAN_TRUE;
+    ZydisBoundaryBitmap restored;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(mutations); ++i)
+    {
+        ZYAN_MEMCPY(corrupted, serialized, sizeof(serialized));
+        corrupted[mutations[i].offset] = mutations[i].value;
+        const ZyanStatus status = ZydisBoundaryBitmapDeserialize(&restored, corrupted,
+            mutations[i].length, workspace, size);
+        if (status != ZYAN_STATUS_INVALID_ARGUMENT)
+        {
+            ZYAN_PRINTF("FAILED: corrupted serialized forms: %s, got status 0x%08X\n",
+                mutations[i].name, status);
+            passed = ZYAN_FALSE;
+        }
+    }
+
+    // Bits behind the end of the code are ignored
+    ZYAN_MEMCPY(corrupted, serialized, sizeof(serialized));
+    corrupted[sizeof(corrupted) - 1] |= 0x80;
+    passed &= ZYAN_SUCCESS(ZydisBoundaryBitmapDeserialize(&restored, corrupted,
+        sizeof(corrupted), workspace, size)) &&
+        CheckBitmap("corrupted serialized forms", "unused bits", &restored, code);
+
+    // Workspace requirements
+    passed &=
+        (ZydisBoundaryBitmapDeserialize(&restored, serialized, sizeof(serialized), workspace,
+            size - 1) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+        (ZydisBoundaryBitmapDeserialize(&restored, serialized, sizeof(serialized),
+            (ZyanU8*)workspace + 4, size - 4) == ZYAN_STATUS_INVALID_ARGUMENT);
+
+    free(workspace);
+    ZYAN_PRINTF("%s: corrupted serialized forms\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) ||
+        ZYAN_FAILED(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    Code code;
+    code.data = malloc(CODE_SIZE);
+    code.starts = malloc(CODE_SIZE * sizeof(ZyanU32));
+    if (!code.data || !code.starts)
+    {
+        ZYAN_PRINTF("Out of memory\n");
+        free(code.starts);
+        free(code.data);
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestCases(&decoder, &code);
+    all_passed &= TestCorruption(&decoder, &code);
+    free(code.starts);
+    free(code.data);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
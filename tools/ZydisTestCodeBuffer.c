@@ -0,0 +1,293 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the code buffer (`ZydisCodeBufferAllocate`) by emitting small functions into the writable
+ * view and calling them through the executable view.
+ */
+
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of functions generated by the region test.
+ */
+#define FUNCTION_COUNT 256
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+typedef ZyanU32 (*TestFunction)(void);
+
+static ZyanBool EmitMovEaxImm(ZydisCodeSlot* slot, ZyanU32 value)
+{
+    ZydisEncoderRequest request;
+    ZYAN_MEMSET(&request, 0, sizeof(request));
+    request.mnemonic = ZYDIS_MNEMONIC_MOV;
+    request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    request.operand_count = 2;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+    request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+    request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[1].imm.u = value;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitAddEaxImm(ZydisCodeSlot* slot, ZyanU32 value)
+{
+    ZydisEncoderRequest request;
+    ZYAN_MEMSET(&request, 0, sizeof(request));
+    request.mnemonic = ZYDIS_MNEMONIC_ADD;
+    request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    request.operand_count = 2;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+    request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+    request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[1].imm.u = value;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitBranch(ZydisCodeSlot* slot, ZydisMnemonic mnemonic, ZyanU64 target)
+{
+    ZydisEncoderRequest request;
+    ZYAN_MEMSET(&request, 0, sizeof(request));
+    request.mnemonic = mnemonic;
+    request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    request.operand_count = 1;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[0].imm.u = target;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitRet(ZydisCodeSlot* slot)
+{
+    ZydisEncoderRequest request;
+    ZYAN_MEMSET(&request, 0, sizeof(request));
+    request.mnemonic = ZYDIS_MNEMONIC_RET;
+    request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanU32 Call(const ZydisCodeSlot* slot)
+{
+    // Converting between object and function pointers is not allowed in ISO C
+    TestFunction function;
+    ZYAN_MEMCPY(&function, &slot->executable, sizeof(function));
+    return function();
+}
+
+static ZyanBool IsFilled(const ZydisCodeSlot* slot, ZyanUSize offset)
+{
+    for (ZyanUSize i = offset; i < slot->size; ++i)
+    {
+        if (slot->writable[i] != ZYDIS_CODE_BUFFER_FILL_BYTE)
+        {
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestExecute(void)
+{
+    ZydisCodeBuffer buffer;
+    ZydisCodeSlot slot;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 0)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 16, &slot)) &&
+        (slot.size == 64) && ((const ZyanU8*)slot.writable != slot.executable) &&
+        IsFilled(&slot, 0) &&
+        EmitMovEaxImm(&slot, 0x1337) && EmitRet(&slot) &&
+        (slot.length == 6) && IsFilled(&slot, slot.length) &&
+        (Call(&slot) == 0x1337);
+
+    // Code emitted after the first call must become visible through the executable view
+    if (passed)
+    {
+        slot.length = 0;
+        passed = EmitMovEaxImm(&slot, 0xC0DE) && EmitRet(&slot) && (Call(&slot) == 0xC0DE);
+    }
+
+    ZydisCodeBufferDestroy(&buffer);
+    ZYAN_PRINTF("%s: execute\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestBranches(void)
+{
+    ZydisCodeBuffer buffer;
+    ZydisCodeSlot callee;
+    ZydisCodeSlot caller;
+    ZydisCodeSlot tail;
+    ZyanU64 callee_address = 0;
+    ZyanU64 tail_address = 0;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 0)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 64, &callee)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 64, &caller)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 256, &tail)) &&
+        ZYAN_SUCCESS(ZydisCodeSlotGetRuntimeAddress(&callee, 0, &callee_address)) &&
+        ZYAN_SUCCESS(ZydisCodeSlotGetRuntimeAddress(&tail, 0, &tail_address)) &&
+        EmitMovEaxImm(&callee, 42) && EmitRet(&callee) &&
+        EmitAddEaxImm(&tail, 100) && EmitRet(&tail) &&
+        EmitBranch(&caller, ZYDIS_MNEMONIC_CALL, callee_address) &&
+        EmitAddEaxImm(&caller, 1) &&
+        EmitBranch(&caller, ZYDIS_MNEMONIC_JMP, tail_address) &&
+        (Call(&caller) == 143);
+
+    ZydisCodeBufferDestroy(&buffer);
+    ZYAN_PRINTF("%s: branches\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestReuse(void)
+{
+    ZydisCodeBuffer buffer;
+    ZydisCodeSlot first;
+    ZydisCodeSlot second;
+    ZydisCodeSlot reused;
+    ZydisCodeSlot larger;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 0)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 100, &first)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 100, &second)) &&
+        (first.size == 128) && (second.writable == first.writable + 128) &&
+        EmitMovEaxImm(&first, 1) && EmitRet(&first) &&
+        ZYAN_SUCCESS(ZydisCodeBufferFree(&buffer, &first)) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 200, &larger)) &&
+        (larger.writable != first.writable) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 65, &reused)) &&
+        (reused.writable == first.writable) && (reused.executable == first.executable) &&
+        (reused.length == 0) && IsFilled(&reused, 0);
+
+    ZydisCodeBufferDestroy(&buffer);
+    ZYAN_PRINTF("%s: size-class reuse\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestRegions(void)
+{
+    static ZydisCodeSlot slots[FUNCTION_COUNT];
+
+    // Use the smallest possible regions, so the functions are spread over many of them
+    ZydisCodeBuffer buffer;
+    ZyanBool passed = ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 1));
+    for (ZyanU32 i = 0; passed && (i < FUNCTION_COUNT); ++i)
+    {
+        passed = ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 64 + (i % 4) * 300, &slots[i])) &&
+            EmitMovEaxImm(&slots[i], i) && EmitRet(&slots[i]);
+    }
+    for (ZyanU32 i = 0; passed && (i < FUNCTION_COUNT); ++i)
+    {
+        passed = (Call(&slots[i]) == i);
+    }
+
+    // Slots larger than a region get a dedicated region
+    ZydisCodeSlot huge;
+    passed = passed &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 256 * 1024, &huge)) &&
+        (huge.size == 256 * 1024) && IsFilled(&huge, 0) &&
+        EmitMovEaxImm(&huge, 7) && EmitRet(&huge) && (Call(&huge) == 7);
+
+    ZydisCodeBufferDestroy(&buffer);
+    ZYAN_PRINTF("%s: regions\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestErrors(void)
+{
+    ZydisCodeBuffer buffer;
+    ZydisCodeSlot slot;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 0)) &&
+        (ZydisCodeBufferAllocate(&buffer, 0, &slot) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 64, &slot));
+
+    // Fill the slot until the next instruction does not fit anymore
+    while (passed && (slot.length + 5 <= slot.size))
+    {
+        passed = EmitMovEaxImm(&slot, 0);
+    }
+    if (passed)
+    {
+        const ZyanUSize length = slot.length;
+        ZydisEncoderRequest request;
+        ZYAN_MEMSET(&request, 0, sizeof(request));
+        request.mnemonic = ZYDIS_MNEMONIC_MOV;
+        request.machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+        request.operand_count = 2;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        passed = (ZydisCodeSlotEmit(&slot, &request) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+            (slot.length == length) && IsFilled(&slot, length);
+    }
+
+    ZyanU64 address;
+    passed = passed &&
+        (ZydisCodeSlotGetRuntimeAddress(&slot, slot.size + 1, &address) ==
+            ZYAN_STATUS_OUT_OF_RANGE);
+
+    ZydisCodeBufferDestroy(&buffer);
+    ZYAN_PRINTF("%s: errors\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestExecute();
+    all_passed &= TestBranches();
+    all_passed &= TestReuse();
+    all_passed &= TestRegions();
+    all_passed &= TestErrors();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,1072 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the columnar batches (`ZydisColumnarDecode`) and the Arrow writer (`ZydisArrowWriter`).
+ *
+ * Pseudo-random code is decoded in chunks into batches of various capacities, so instructions
+ * straddle the chunk ends and batches fill up in the middle of a chunk. The concatenated rows
+ * are compared to a linear sweep with `ZydisDecoderDecodeFull`. The rows are then written to an
+ * Arrow file, which is parsed again: the magic, the message framing, the footer and its blocks
+ * are checked byte by byte and the record batches have to round-trip to the same rows.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The length of the pseudo-random code.
+ */
+#define CODE_SIZE (16 * 1024)
+
+/**
+ * The capacity of the Arrow output.
+ */
+#define OUTPUT_CAPACITY (4 * 1024 * 1024)
+
+/**
+ * The maximum number of record batches in the Arrow output.
+ */
+#define MAX_BATCH_COUNT 1024
+
+/**
+ * The number of columns of the Arrow schema.
+ */
+#define COLUMN_COUNT 13
+
+/**
+ * Marks columns that are not dictionary-encoded.
+ */
+#define NO_DICTIONARY 0xFF
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * A single row of a columnar batch.
+ */
+typedef struct Row_
+{
+    ZyanU64 offset;
+    ZyanU8 length;
+    ZyanU16 mnemonic;
+    ZyanU8 category;
+    ZyanU16 isa_set;
+    ZyanU8 operand_count;
+    ZyanU8 operand_type[ZYDIS_COLUMNAR_OPERAND_COUNT];
+    ZyanU16 operand_register[ZYDIS_COLUMNAR_OPERAND_COUNT];
+    ZyanI64 immediate;
+    ZyanU16 memory_base;
+    ZyanU16 memory_index;
+    ZyanU8 memory_scale;
+    ZyanI64 memory_displacement;
+} Row;
+
+/**
+ * Describes a column of the Arrow schema.
+ */
+typedef struct Column_
+{
+    const char* name;
+    ZyanU8 width;
+    ZyanU8 dictionary;
+    ZyanBool is_list;
+} Column;
+
+/**
+ * Collects the output of the Arrow writer.
+ */
+typedef struct Output_
+{
+    ZyanU8* data;
+    ZyanUSize size;
+} Output;
+
+/**
+ * A range of the Arrow output that contains a flatbuffer.
+ */
+typedef struct Span_
+{
+    const ZyanU8* data;
+    ZyanUSize size;
+} Span;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const Column COLUMNS[COLUMN_COUNT] =
+{
+    { "offset"             , 8, NO_DICTIONARY, ZYAN_FALSE },
+    { "length"             , 1, NO_DICTIONARY, ZYAN_FALSE },
+    { "mnemonic"           , 2, 0            , ZYAN_FALSE },
+    { "category"           , 1, 1            , ZYAN_FALSE },
+    { "isa_set"            , 2, 2            , ZYAN_FALSE },
+    { "operand_count"      , 1, NO_DICTIONARY, ZYAN_FALSE },
+    { "operand_type"       , 1, 3            , ZYAN_TRUE  },
+    { "operand_register"   , 2, 4            , ZYAN_TRUE  },
+    { "immediate"          , 8, NO_DICTIONARY, ZYAN_FALSE },
+    { "memory_base"        , 2, 4            , ZYAN_FALSE },
+    { "memory_index"       , 2, 4            , ZYAN_FALSE },
+    { "memory_scale"       , 1, NO_DICTIONARY, ZYAN_FALSE },
+    { "memory_displacement", 8, NO_DICTIONARY, ZYAN_FALSE }
+};
+
+/**
+ * The batch capacities and chunk sizes of the sweeps.
+ */
+static const ZyanUSize CAPACITIES[] = { 1, 7, 1000 };
+static const ZyanUSize CHUNK_SIZES[] = { 1, 13, 4096, CODE_SIZE };
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Rows                                                                                           */
+/* ---------------------------------------------------------------------------------------------- */
+
+static ZyanU64 NextRandom(ZyanU64* state)
+{
+    ZyanU64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Decodes the instruction at the given offset into the expected row.
+ */
+static void ExpectRow(const ZydisDecoder* decoder, const ZyanU8* code, ZyanUSize offset,
+    Row* row)
+{
+    ZYAN_MEMSET(row, 0, sizeof(*row));
+    row->offset = offset;
+    row->length = 1;
+    row->mnemonic = ZYDIS_MNEMONIC_INVALID;
+
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, code + offset, CODE_SIZE - offset,
+        &instruction, operands)))
+    {
+        return;
+    }
+
+    row->length = instruction.length;
+    row->mnemonic = (ZyanU16)instruction.mnemonic;
+    row->category = (ZyanU8)instruction.meta.category;
+    row->isa_set = (ZyanU16)instruction.meta.isa_set;
+    row->operand_count = instruction.operand_count_visible;
+
+    const ZydisDecodedOperand* memory = ZYAN_NULL;
+    const ZydisDecodedOperand* immediate = ZYAN_NULL;
+    for (ZyanU8 i = 0; i < instruction.operand_count_visible; ++i)
+    {
+        row->operand_type[i] = (ZyanU8)operands[i].type;
+        if (operands[i].type == ZYDIS_OPERAND_TYPE_REGISTER)
+        {
+            row->operand_register[i] = (ZyanU16)operands[i].reg.value;
+        }
+        if ((operands[i].type == ZYDIS_OPERAND_TYPE_MEMORY) && !memory)
+        {
+            memory = &operands[i];
+        }
+        if ((operands[i].type == ZYDIS_OPERAND_TYPE_IMMEDIATE) && !immediate)
+        {
+            immediate = &operands[i];
+        }
+    }
+    if (immediate)
+    {
+        row->immediate = immediate->imm.value.s;
+    }
+    if (memory)
+    {
+        row->memory_base = (ZyanU16)memory->mem.base;
+        row->memory_index = (ZyanU16)memory->mem.index;
+        row->memory_scale = memory->mem.scale;
+        row->memory_displacement = memory->mem.disp.value;
+    }
+}
+
+/**
+ * Copies a row of the given batch.
+ */
+static void GetBatchRow(const ZydisColumnarBatch* batch, ZyanUSize index, Row* row)
+{
+    ZYAN_MEMSET(row, 0, sizeof(*row));
+    row->offset = batch->offset[index];
+    row->length = batch->length[index];
+    row->mnemonic = batch->mnemonic[index];
+    row->category = batch->category[index];
+    row->isa_set = batch->isa_set[index];
+    row->operand_count = batch->operand_count[index];
+    for (ZyanU8 i = 0; i < ZYDIS_COLUMNAR_OPERAND_COUNT; ++i)
+    {
+        row->operand_type[i] = batch->operand_type[index * ZYDIS_COLUMNAR_OPERAND_COUNT + i];
+        row->operand_register[i] =
+            batch->operand_register[index * ZYDIS_COLUMNAR_OPERAND_COUNT + i];
+    }
+    row->immediate = batch->immediate[index];
+    row->memory_base = batch->memory_base[index];
+    row->memory_index = batch->memory_index[index];
+    row->memory_scale = batch->memory_scale[index];
+    row->memory_displacement = batch->memory_displacement[index];
+}
+
+/**
+ * Stores a single value of an Arrow column in the given row.
+ */
+static void SetColumnValue(Row* row, ZyanU8 column, ZyanU8 item, ZyanU64 value)
+{
+    switch (column)
+    {
+    case  0: row->offset = value; break;
+    case  1: row->length = (ZyanU8)value; break;
+    case  2: row->mnemonic = (ZyanU16)value; break;
+    case  3: row->category = (ZyanU8)value; break;
+    case  4: row->isa_set = (ZyanU16)value; break;
+    case  5: row->operand_count = (ZyanU8)value; break;
+    case  6: row->operand_type[item] = (ZyanU8)value; break;
+    case  7: row->operand_register[item] = (ZyanU16)value; break;
+    case  8: row->immediate = (ZyanI64)value; break;
+    case  9: row->memory_base = (ZyanU16)value; break;
+    case 10: row->memory_index = (ZyanU16)value; break;
+    case 11: row->memory_scale = (ZyanU8)value; break;
+    case 12: row->memory_displacement = (ZyanI64)value; break;
+    default: break;
+    }
+}
+
+/**
+ * Compares rows and prints the first mismatch.
+ */
+static ZyanBool CompareRows(const char* name, const Row* actual, const Row* expected,
+    ZyanUSize count)
+{
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        if (ZYAN_MEMCMP(&actual[i], &expected[i], sizeof(Row)))
+        {
+            ZYAN_PRINTF("FAILED: %s: row at offset 0x%04" PRIX64 " (expected 0x%04" PRIX64
+                ", %s)\n", name, actual[i].offset, expected[i].offset,
+                ZydisMnemonicGetString((ZydisMnemonic)expected[i].mnemonic));
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Compares the rows appended to the batch to the expected rows.
+ */
+static ZyanBool CompareBatch(const char* name, const ZydisColumnarBatch* batch, ZyanUSize first,
+    const Row* expected)
+{
+    for (ZyanUSize i = first; i < batch->count; ++i)
+    {
+        Row row;
+        GetBatchRow(batch, i, &row);
+        if (!CompareRows(name, &row, &expected[i - first], 1))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Arrow output                                                                                   */
+/* ---------------------------------------------------------------------------------------------- */
+
+static ZyanStatus WriteOutput(void* user_data, const void* data, ZyanUSize length)
+{
+    Output* const output = (Output*)user_data;
+    if (OUTPUT_CAPACITY - output->size < length)
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    ZYAN_MEMCPY(output->data + output->size, data, length);
+    output->size += length;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+static ZyanU64 Load(const ZyanU8* data, ZyanU8 size)
+{
+    ZyanU64 value = 0;
+    for (ZyanU8 i = size; i > 0; --i)
+    {
+        value = (value << 8) | data[i - 1];
+    }
+    return value;
+}
+
+static ZyanBool IsInSpan(const Span* span, const ZyanU8* data, ZyanU64 length)
+{
+    return data && (data >= span->data) && ((ZyanU64)(data - span->data) <= span->size) &&
+        (length <= span->size - (ZyanU64)(data - span->data));
+}
+
+/**
+ * Follows the flatbuffer offset at the given position to a table, vector or string.
+ */
+static const ZyanU8* Follow(const Span* span, const ZyanU8* data)
+{
+    if (!IsInSpan(span, data, 4))
+    {
+        return ZYAN_NULL;
+    }
+    const ZyanU64 offset = Load(data, 4);
+    if ((ZyanU64)(data - span->data) + offset + 4 > span->size)
+    {
+        return ZYAN_NULL;
+    }
+    return data + offset;
+}
+
+/**
+ * Returns a pointer to a field of a flatbuffer table or `ZYAN_NULL`, if the field is absent.
+ */
+static const ZyanU8* GetField(const Span* span, const ZyanU8* table, ZyanU8 id, ZyanU8 size)
+{
+    if (!IsInSpan(span, table, 4))
+    {
+        return ZYAN_NULL;
+    }
+    const ZyanI64 vtable = (ZyanI64)(table - span->data) - (ZyanI32)(ZyanU32)Load(table, 4);
+    if ((vtable < 0) || ((ZyanU64)vtable + 4 > span->size))
+    {
+        return ZYAN_NULL;
+    }
+    const ZyanU8* const entries = span->data + vtable;
+    const ZyanU64 vtable_size = Load(entries, 2);
+    if (((ZyanU64)4 + id * 2 + 2 > vtable_size) || !IsInSpan(span, entries, vtable_size))
+    {
+        return ZYAN_NULL;
+    }
+    const ZyanU64 offset = Load(entries + 4 + id * 2, 2);
+    if (!offset || !IsInSpan(span, table + offset, size))
+    {
+        return ZYAN_NULL;
+    }
+    return table + offset;
+}
+
+/**
+ * Reads a scalar field of a flatbuffer table. Absent fields are read as `~0`.
+ */
+static ZyanU64 GetScalar(const Span* span, const ZyanU8* table, ZyanU8 id, ZyanU8 size)
+{
+    const ZyanU8* const field = GetField(span, table, id, size);
+    return field ? Load(field, size) : ~(ZyanU64)0;
+}
+
+/**
+ * Returns a pointer to the elements of a vector field of a flatbuffer table.
+ */
+static const ZyanU8* GetVector(const Span* span, const ZyanU8* table, ZyanU8 id,
+    ZyanUSize element_size, ZyanU32* count)
+{
+    const ZyanU8* const vector = Follow(span, GetField(span, table, id, 4));
+    if (!vector)
+    {
+        return ZYAN_NULL;
+    }
+    *count = (ZyanU32)Load(vector, 4);
+    return IsInSpan(span, vector + 4, (ZyanU64)*count * element_size) ? vector + 4 : ZYAN_NULL;
+}
+
+/**
+ * Checks the framing of the message at the given position and returns its root `Message` table.
+ */
+static const ZyanU8* GetMessage(const Output* output, ZyanU64 position,
+    const ZydisArrowBlock* block, Span* metadata)
+{
+    if ((block->offset != position) || (position % 8) || (position + 8 > output->size) ||
+        (Load(output->data + position, 4) != 0xFFFFFFFF))
+    {
+        return ZYAN_NULL;
+    }
+    const ZyanU64 length = Load(output->data + position + 4, 4);
+    if ((length % 8) || (block->metadata_length != 8 + length) ||
+        (position + 8 + length + block->body_length > output->size))
+    {
+        return ZYAN_NULL;
+    }
+
+    metadata->data = output->data + position + 8;
+    metadata->size = (ZyanUSize)length;
+    return Follow(metadata, metadata->data);
+}
+
+/**
+ * Checks the `Schema` table against `COLUMNS`.
+ */
+static ZyanBool CheckSchema(const Span* span, const ZyanU8* schema)
+{
+    ZyanU32 count;
+    const ZyanU8* const fields = GetVector(span, schema, 1, 4, &count);
+    if ((GetScalar(span, schema, 0, 2) != 0) || !fields || (count != COLUMN_COUNT))
+    {
+        return ZYAN_FALSE;
+    }
+
+    for (ZyanU8 i = 0; i < COLUMN_COUNT; ++i)
+    {
+        const Column* const column = &COLUMNS[i];
+        const ZyanU8* const field = Follow(span, fields + i * 4);
+        const ZyanU8* const name = Follow(span, GetField(span, field, 0, 4));
+        const ZyanUSize length = ZYAN_STRLEN(column->name);
+        if (!name || (Load(name, 4) != length) || !IsInSpan(span, name + 4, length) ||
+            ZYAN_MEMCMP(name + 4, column->name, length))
+        {
+            return ZYAN_FALSE;
+        }
+
+        const ZyanU64 type = column->is_list ? 16 : (column->dictionary != NO_DICTIONARY) ? 5 : 2;
+        if (GetScalar(span, field, 2, 1) != type)
+        {
+            return ZYAN_FALSE;
+        }
+
+        // List items carry the dictionary encoding
+        const ZyanU8* item = field;
+        if (column->is_list)
+        {
+            ZyanU32 children;
+            const ZyanU8* const vector = GetVector(span, field, 5, 4, &children);
+            item = vector ? Follow(span, vector) : ZYAN_NULL;
+            if (!item || (children != 1))
+            {
+                return ZYAN_FALSE;
+            }
+        }
+        if (column->dictionary != NO_DICTIONARY)
+        {
+            const ZyanU8* const encoding = Follow(span, GetField(span, item, 4, 4));
+            if (GetScalar(span, encoding, 0, 8) != column->dictionary)
+            {
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Checks a flatbuffer vector of `Block` structs against the blocks of the writer.
+ */
+static ZyanBool CheckBlocks(const Span* span, const ZyanU8* footer, ZyanU8 id,
+    const ZydisArrowBlock* blocks, ZyanUSize count)
+{
+    ZyanU32 vector_count;
+    const ZyanU8* const vector = GetVector(span, footer, id, 24, &vector_count);
+    if (!vector || (vector_count != count) || ((vector - span->data) % 8))
+    {
+        return ZYAN_FALSE;
+    }
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const ZyanU8* const block = vector + i * 24;
+        if ((Load(block, 8) != blocks[i].offset) ||
+            (Load(block + 8, 8) != blocks[i].metadata_length) ||
+            (Load(block + 16, 8) != blocks[i].body_length))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Returns the expected string of a dictionary entry or `ZYAN_NULL`, if there is no public
+ * function that returns it.
+ */
+static const char* GetDictionaryString(ZyanU8 dictionary, ZyanUSize index)
+{
+    const char* string = ZYAN_NULL;
+    switch (dictionary)
+    {
+    case 0:
+        string = ZydisMnemonicGetString((ZydisMnemonic)index);
+        break;
+    case 1:
+        string = ZydisCategoryGetString((ZydisInstructionCategory)index);
+        break;
+    case 2:
+        string = ZydisISASetGetString((ZydisISASet)index);
+        break;
+    case 4:
+        string = ZydisRegisterGetString((ZydisRegister)index);
+        break;
+    default:
+        return ZYAN_NULL;
+    }
+    return string ? string : "";
+}
+
+/**
+ * Checks a dictionary batch message and its UTF-8 values.
+ */
+static ZyanBool CheckDictionary(const Output* output, const Span* span, const ZyanU8* message,
+    ZyanU8 dictionary, const ZydisArrowBlock* block)
+{
+    static const ZyanUSize COUNTS[ZYDIS_ARROW_DICTIONARY_COUNT] =
+    {
+        ZYDIS_MNEMONIC_MAX_VALUE + 1,
+        ZYDIS_CATEGORY_MAX_VALUE + 1,
+        ZYDIS_ISA_SET_MAX_VALUE + 1,
+        ZYDIS_OPERAND_TYPE_MAX_VALUE + 1,
+        ZYDIS_REGISTER_MAX_VALUE + 1
+    };
+
+    const ZyanU8* const batch = Follow(span, GetField(span, message, 2, 4));
+    const ZyanU8* const data = Follow(span, GetField(span, batch, 1, 4));
+    ZyanU32 buffer_count;
+    const ZyanU8* const buffers = GetVector(span, data, 2, 16, &buffer_count);
+    if ((GetScalar(span, message, 1, 1) != 2) ||
+        (GetScalar(span, message, 3, 8) != block->body_length) ||
+        (GetScalar(span, batch, 0, 8) != dictionary) ||
+        (GetScalar(span, data, 0, 8) != COUNTS[dictionary]) || !buffers || (buffer_count != 3))
+    {
+        return ZYAN_FALSE;
+    }
+
+    const ZyanU8* const body = output->data + block->offset + block->metadata_length;
+    const ZyanU64 offsets_offset = Load(buffers + 16, 8);
+    const ZyanU64 offsets_length = Load(buffers + 24, 8);
+    const ZyanU64 values_offset = Load(buffers + 32, 8);
+    const ZyanU64 values_length = Load(buffers + 40, 8);
+    if ((offsets_length != (COUNTS[dictionary] + 1) * 4) ||
+        (offsets_offset + offsets_length > block->body_length) ||
+        (values_offset + values_length > block->body_length) ||
+        (Load(body + offsets_offset + offsets_length - 4, 4) != values_length))
+    {
+        return ZYAN_FALSE;
+    }
+
+    for (ZyanUSize i = 0; i < COUNTS[dictionary]; ++i)
+    {
+        const char* const expected = GetDictionaryString(dictionary, i);
+        const ZyanU64 begin = Load(body + offsets_offset + i * 4, 4);
+        const ZyanU64 end = Load(body + offsets_offset + i * 4 + 4, 4);
+        if ((begin > end) || (end > values_length) ||
+            (expected && ((ZYAN_STRLEN(expected) != end - begin) ||
+                ZYAN_MEMCMP(body + values_offset + begin, expected, (ZyanUSize)(end - begin)))))
+        {
+            return ZYAN_FALSE;
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Reads the rows of a record batch message.
+ */
+static ZyanBool ReadRecordBatch(const Output* output, const Span* span, const ZyanU8* message,
+    const ZydisArrowBlock* block, Row* rows, ZyanUSize capacity, ZyanUSize* count)
+{
+    const ZyanU8* const batch = Follow(span, GetField(span, message, 2, 4));
+    ZyanU32 node_count;
+    ZyanU32 buffer_count;
+    const ZyanU8* const nodes = GetVector(span, batch, 1, 16, &node_count);
+    const ZyanU8* const buffers = GetVector(span, batch, 2, 16, &buffer_count);
+    const ZyanU64 length = GetScalar(span, batch, 0, 8);
+    if ((GetScalar(span, message, 1, 1) != 3) ||
+        (GetScalar(span, message, 3, 8) != block->body_length) || (length > capacity) ||
+        !nodes || (node_count != COLUMN_COUNT + 2) ||
+        !buffers || (buffer_count != 2 * COLUMN_COUNT + 2))
+    {
+        return ZYAN_FALSE;
+    }
+
+    const ZyanU8* const body = output->data + block->offset + block->metadata_length;
+    ZyanUSize node = 0;
+    ZyanUSize buffer = 0;
+    for (ZyanU8 i = 0; i < COLUMN_COUNT; ++i)
+    {
+        const Column* const column = &COLUMNS[i];
+        ZyanU64 values = length;
+        if (column->is_list)
+        {
+            if (Load(nodes + 16 * node++, 8) != length)
+            {
+                return ZYAN_FALSE;
+            }
+            ++buffer;
+            values *= ZYDIS_COLUMNAR_OPERAND_COUNT;
+        }
+        ++buffer;
+        const ZyanU64 data_offset = Load(buffers + 16 * buffer, 8);
+        const ZyanU64 data_length = Load(buffers + 16 * buffer + 8, 8);
+        if ((Load(nodes + 16 * node++, 8) != values) || (data_offset % 8) ||
+            (data_length != values * column->width) ||
+            (data_offset + data_length > block->body_length))
+        {
+            return ZYAN_FALSE;
+        }
+        ++buffer;
+
+        for (ZyanU64 j = 0; j < values; ++j)
+        {
+            const ZyanU64 value = Load(body + data_offset + j * column->width, column->width);
+            const ZyanU64 row = column->is_list ? j / ZYDIS_COLUMNAR_OPERAND_COUNT : j;
+            const ZyanU8 item = (ZyanU8)(column->is_list ? j % ZYDIS_COLUMNAR_OPERAND_COUNT : 0);
+            SetColumnValue(&rows[row], i, item, value);
+        }
+    }
+
+    *count = (ZyanUSize)length;
+    return ZYAN_TRUE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+/**
+ * Decodes the code in chunks, continuing every chunk at the end of the previous instruction.
+ *
+ * Full batches are written to the Arrow writer in two parts, if one is given.
+ */
+static ZyanBool Sweep(const char* name, const ZydisDecoder* decoder, const ZyanU8* code,
+    const Row* reference, ZyanUSize reference_count, ZydisColumnarBatch* batch,
+    ZyanUSize chunk_size, ZydisArrowWriter* writer)
+{
+    ZyanUSize expected = 0;
+    ZyanUSize row = 0;
+    batch->count = 0;
+    for (ZyanUSize begin = 0; begin < CODE_SIZE; begin += chunk_size)
+    {
+        const ZyanUSize end = ZYAN_MIN(begin + chunk_size, CODE_SIZE);
+        while (expected < end)
+        {
+            const ZyanUSize first = batch->count;
+            ZyanUSize next;
+            if (ZYAN_FAILED(ZydisColumnarDecode(decoder, code, CODE_SIZE, expected, end, batch,
+                &next)))
+            {
+                ZYAN_PRINTF("FAILED: %s: ZydisColumnarDecode at 0x%04zX\n", name, expected);
+                return ZYAN_FALSE;
+            }
+
+            const ZyanUSize count = batch->count - first;
+            if ((count > reference_count - row) ||
+                !CompareBatch(name, batch, first, &reference[row]))
+            {
+                if (count > reference_count - row)
+                {
+                    ZYAN_PRINTF("FAILED: %s: too many rows\n", name);
+                }
+                return ZYAN_FALSE;
+            }
+            row += count;
+
+            const ZyanUSize boundary = (row < reference_count) ?
+                (ZyanUSize)reference[row].offset : CODE_SIZE;
+            const ZyanBool is_full = (batch->count == batch->capacity);
+            if ((next != boundary) || (!is_full && (next < end)) || (next >= end + 15))
+            {
+                ZYAN_PRINTF("FAILED: %s: chunk [0x%04zX, 0x%04zX) ended at 0x%04zX (next "
+                    "boundary 0x%04zX)\n", name, begin, end, next, boundary);
+                return ZYAN_FALSE;
+            }
+            expected = next;
+
+            if (is_full)
+            {
+                if (writer && (ZYAN_FAILED(ZydisArrowWriterWriteBatch(writer, batch, 0,
+                        batch->count / 2)) ||
+                    ZYAN_FAILED(ZydisArrowWriterWriteBatch(writer, batch, batch->count / 2,
+                        batch->count - batch->count / 2))))
+                {
+                    ZYAN_PRINTF("FAILED: %s: ZydisArrowWriterWriteBatch\n", name);
+                    return ZYAN_FALSE;
+                }
+                batch->count = 0;
+            }
+        }
+    }
+
+    if (writer && ZYAN_FAILED(ZydisArrowWriterWriteBatch(writer, batch, 0, batch->count)))
+    {
+        ZYAN_PRINTF("FAILED: %s: ZydisArrowWriterWriteBatch\n", name);
+        return ZYAN_FALSE;
+    }
+    if ((row != reference_count) || (expected != CODE_SIZE))
+    {
+        ZYAN_PRINTF("FAILED: %s: %zu of %zu rows\n", name, row, reference_count);
+        return ZYAN_FALSE;
+    }
+
+    return ZYAN_TRUE;
+}
+
+static ZyanBool TestSweeps(const ZydisDecoder* decoder, const ZyanU8* code,
+    const Row* reference, ZyanUSize reference_count, ZydisColumnarBatch* batches)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(CAPACITIES); ++i)
+    {
+        for (ZyanUSize j = 0; j < ZYAN_ARRAY_LENGTH(CHUNK_SIZES); ++j)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "sweep (capacity %zu, chunk size %zu)",
+                CAPACITIES[i], CHUNK_SIZES[j]);
+            const ZyanBool passed = Sweep(name, decoder, code, reference, reference_count,
+                &batches[i], CHUNK_SIZES[j], ZYAN_NULL);
+            if (passed)
+            {
+                ZYAN_PRINTF("PASSED: %s\n", name);
+            }
+            all_passed &= passed;
+        }
+    }
+    return all_passed;
+}
+
+/**
+ * Decodes every chunk independently from its fixed start, as done by parallel workers. A chunk
+ * usually starts in the middle of an instruction, but every row has to match the instruction at
+ * its own offset.
+ */
+static ZyanBool TestChunks(const ZydisDecoder* decoder, const ZyanU8* code,
+    ZydisColumnarBatch* batch)
+{
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 1; (i < ZYAN_ARRAY_LENGTH(CHUNK_SIZES)) && passed; ++i)
+    {
+        const ZyanUSize chunk_size = ZYAN_MIN(CHUNK_SIZES[i], batch->capacity);
+        for (ZyanUSize begin = 0; (begin < CODE_SIZE) && passed; begin += chunk_size)
+        {
+            const ZyanUSize end = ZYAN_MIN(begin + chunk_size, CODE_SIZE);
+            ZyanUSize next;
+            batch->count = 0;
+            if (ZYAN_FAILED(ZydisColumnarDecode(decoder, code, CODE_SIZE, begin, end, batch,
+                &next)) || !batch->count)
+            {
+                passed = ZYAN_FALSE;
+                break;
+            }
+
+            ZyanUSize offset = begin;
+            for (ZyanUSize j = 0; (j < batch->count) && passed; ++j)
+            {
+                Row expected;
+                Row actual;
+                ExpectRow(decoder, code, offset, &expected);
+                GetBatchRow(batch, j, &actual);
+                passed = CompareRows("independent chunks", &actual, &expected, 1);
+                offset += expected.length;
+            }
+            if (passed && ((next != offset) || (next < end) ||
+                (batch->offset[batch->count - 1] >= end)))
+            {
+                ZYAN_PRINTF("FAILED: independent chunks: chunk [0x%04zX, 0x%04zX) ended at "
+                    "0x%04zX\n", begin, end, next);
+                passed = ZYAN_FALSE;
+            }
+        }
+    }
+
+    if (passed)
+    {
+        ZYAN_PRINTF("PASSED: independent chunks\n");
+    }
+    return passed;
+}
+
+/**
+ * Writes the rows to an Arrow file and parses it again.
+ */
+static ZyanBool TestArrow(const ZydisDecoder* decoder, const ZyanU8* code, const Row* reference,
+    ZyanUSize reference_count, ZydisColumnarBatch* batch, Output* output, Row* rows)
+{
+    static const ZyanU8 MAGIC[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+    static const ZyanU8 END_OF_STREAM[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+
+    static ZydisArrowBlock blocks[MAX_BATCH_COUNT];
+    ZydisArrowWriter writer;
+    output->size = 0;
+    if (ZYAN_FAILED(ZydisArrowWriterInit(&writer, &WriteOutput, output, blocks,
+            MAX_BATCH_COUNT)) ||
+        ZYAN_FAILED(ZydisArrowWriterWriteBatch(&writer, batch, 0, 0)) ||
+        !Sweep("arrow", decoder, code, reference, reference_count, batch, 1000, &writer) ||
+        ZYAN_FAILED(ZydisArrowWriterFinish(&writer)))
+    {
+        ZYAN_PRINTF("FAILED: arrow: writer\n");
+        return ZYAN_FALSE;
+    }
+    if (writer.position != output->size)
+    {
+        ZYAN_PRINTF("FAILED: arrow: position\n");
+        return ZYAN_FALSE;
+    }
+
+    // File header and trailer
+    const ZyanUSize size = output->size;
+    const ZyanU8* const data = output->data;
+    if ((size < 8 + 8 + 10) || ZYAN_MEMCMP(data, MAGIC, sizeof(MAGIC)) ||
+        ZYAN_MEMCMP(data + size - 6, "ARROW1", 6))
+    {
+        ZYAN_PRINTF("FAILED: arrow: magic\n");
+        return ZYAN_FALSE;
+    }
+    const ZyanU64 footer_length = Load(data + size - 10, 4);
+    if (footer_length > size - 10 - 16)
+    {
+        ZYAN_PRINTF("FAILED: arrow: footer length\n");
+        return ZYAN_FALSE;
+    }
+    const ZyanUSize footer = size - 10 - (ZyanUSize)footer_length;
+    if ((footer % 8) || ZYAN_MEMCMP(data + footer - 8, END_OF_STREAM, sizeof(END_OF_STREAM)))
+    {
+        ZYAN_PRINTF("FAILED: arrow: end of stream\n");
+        return ZYAN_FALSE;
+    }
+
+    // Schema message
+    Span span;
+    ZydisArrowBlock schema_block = { 8, 0, 0 };
+    schema_block.metadata_length = (ZyanU32)(8 + Load(data + 12, 4));
+    const ZyanU8* message = GetMessage(output, 8, &schema_block, &span);
+    if (!message || (GetScalar(&span, message, 0, 2) != 4) ||
+        (GetScalar(&span, message, 1, 1) != 1) || (GetScalar(&span, message, 3, 8) != 0) ||
+        !CheckSchema(&span, Follow(&span, GetField(&span, message, 2, 4))))
+    {
+        ZYAN_PRINTF("FAILED: arrow: schema\n");
+        return ZYAN_FALSE;
+    }
+    ZyanU64 position = 8 + schema_block.metadata_length;
+
+    // Dictionary messages
+    for (ZyanU8 i = 0; i < ZYDIS_ARROW_DICTIONARY_COUNT; ++i)
+    {
+        const ZydisArrowBlock* const block = &writer.dictionaries[i];
+        message = GetMessage(output, position, block, &span);
+        if (!message || (GetScalar(&span, message, 0, 2) != 4) ||
+            !CheckDictionary(output, &span, message, i, block))
+        {
+            ZYAN_PRINTF("FAILED: arrow: dictionary %u\n", i);
+            return ZYAN_FALSE;
+        }
+        position += block->metadata_length + block->body_length;
+    }
+
+    // Record batch messages
+    ZyanUSize row = 0;
+    for (ZyanUSize i = 0; i < writer.batch_count; ++i)
+    {
+        ZyanUSize count;
+        message = GetMessage(output, position, &blocks[i], &span);
+        if (!message || (GetScalar(&span, message, 0, 2) != 4) ||
+            !ReadRecordBatch(output, &span, message, &blocks[i], &rows[row],
+                reference_count - row, &count))
+        {
+            ZYAN_PRINTF("FAILED: arrow: record batch %zu\n", i);
+            return ZYAN_FALSE;
+        }
+        row += count;
+        position += blocks[i].metadata_length + blocks[i].body_length;
+    }
+    if ((position != footer - 8) || (row != reference_count) ||
+        !CompareRows("arrow", rows, reference, reference_count))
+    {
+        ZYAN_PRINTF("FAILED: arrow: %zu of %zu rows\n", row, reference_count);
+        return ZYAN_FALSE;
+    }
+
+    // Footer
+    span.data = data + footer;
+    span.size = (ZyanUSize)footer_length;
+    const ZyanU8* const table = Follow(&span, span.data);
+    if (!table || (GetScalar(&span, table, 0, 2) != 4) ||
+        !CheckSchema(&span, Follow(&span, GetField(&span, table, 1, 4))) ||
+        !CheckBlocks(&span, table, 2, writer.dictionaries, ZYDIS_ARROW_DICTIONARY_COUNT) ||
+        !CheckBlocks(&span, table, 3, blocks, writer.batch_count))
+    {
+        ZYAN_PRINTF("FAILED: arrow: footer\n");
+        return ZYAN_FALSE;
+    }
+
+    ZYAN_PRINTF("PASSED: arrow (%zu record batches, %zu bytes)\n", writer.batch_count, size);
+    return ZYAN_TRUE;
+}
+
+static ZyanBool TestArguments(const ZydisDecoder* decoder, const ZyanU8* code,
+    ZydisColumnarBatch* batch, Output* output)
+{
+    ZyanU64 workspace[64];
+    ZyanUSize size;
+    ZydisColumnarBatch small;
+    ZyanBool passed =
+        (ZydisColumnarGetWorkspaceSize(1, ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisColumnarGetWorkspaceSize(~(ZyanUSize)0, &size) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisColumnarGetWorkspaceSize(2, &size)) &&
+        (ZydisColumnarBatchInit(&small, 2, (ZyanU8*)workspace + 1, sizeof(workspace) - 1) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisColumnarBatchInit(&small, 2, workspace, size - 1) ==
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+        ZYAN_SUCCESS(ZydisColumnarBatchInit(&small, 2, workspace, size));
+
+    // An empty range and a full batch decode nothing
+    ZyanUSize next = 0;
+    passed &= ZYAN_SUCCESS(ZydisColumnarDecode(decoder, code, CODE_SIZE, CODE_SIZE,
+        CODE_SIZE + 16, &small, &next)) && (small.count == 0) && (next == CODE_SIZE);
+    passed &= ZYAN_SUCCESS(ZydisColumnarDecode(decoder, code, CODE_SIZE, 0, CODE_SIZE,
+        &small, &next)) && (small.count == 2) && (next == small.length[0] + small.length[1]);
+    passed &= ZYAN_SUCCESS(ZydisColumnarDecode(decoder, code, CODE_SIZE, 100, CODE_SIZE,
+        &small, &next)) && (small.count == 2) && (next == 100);
+    passed &= (ZydisColumnarDecode(decoder, code, CODE_SIZE, CODE_SIZE + 1, CODE_SIZE + 2,
+        batch, &next) == ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= (ZydisColumnarDecode(ZYAN_NULL, code, CODE_SIZE, 0, CODE_SIZE, batch,
+        &next) == ZYAN_STATUS_INVALID_ARGUMENT);
+    ZydisDecoder minimal = *decoder;
+    passed &= ZYAN_SUCCESS(ZydisDecoderEnableMode(&minimal, ZYDIS_DECODER_MODE_MINIMAL,
+        ZYAN_TRUE)) && (ZydisColumnarDecode(&minimal, code, CODE_SIZE, 0, CODE_SIZE, batch,
+        &next) == ZYAN_STATUS_INVALID_ARGUMENT);
+
+    ZydisArrowWriter writer;
+    ZydisArrowBlock blocks[1];
+    output->size = 0;
+    passed &= (ZydisArrowWriterInit(&writer, ZYAN_NULL, output, blocks, 1) ==
+        ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= (ZydisArrowWriterInit(&writer, &WriteOutput, output, ZYAN_NULL, 1) ==
+        ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= ZYAN_SUCCESS(ZydisArrowWriterInit(&writer, &WriteOutput, output, blocks, 1));
+    passed &= (ZydisArrowWriterWriteBatch(&writer, &small, 3, 0) ==
+        ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= (ZydisArrowWriterWriteBatch(&writer, &small, 1, 2) ==
+        ZYAN_STATUS_INVALID_ARGUMENT);
+    passed &= ZYAN_SUCCESS(ZydisArrowWriterWriteBatch(&writer, &small, 0, 2));
+    passed &= (ZydisArrowWriterWriteBatch(&writer, &small, 0, 2) ==
+        ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+    passed &= ZYAN_SUCCESS(ZydisArrowWriterFinish(&writer)) &&
+        (writer.position == output->size);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+        ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    int result = 1;
+    ZyanU8* const code = (ZyanU8*)malloc(CODE_SIZE);
+    Row* const reference = (Row*)malloc(CODE_SIZE * sizeof(Row));
+    Row* const rows = (Row*)calloc(CODE_SIZE, sizeof(Row));
+    ZyanU8* const output_data = (ZyanU8*)malloc(OUTPUT_CAPACITY);
+    void* workspaces[ZYAN_ARRAY_LENGTH(CAPACITIES)] = { ZYAN_NULL };
+    ZydisColumnarBatch batches[ZYAN_ARRAY_LENGTH(CAPACITIES)];
+    ZyanBool is_allocated = code && reference && rows && output_data;
+    for (ZyanUSize i = 0; (i < ZYAN_ARRAY_LENGTH(CAPACITIES)) && is_allocated; ++i)
+    {
+        ZyanUSize size;
+        is_allocated = ZYAN_SUCCESS(ZydisColumnarGetWorkspaceSize(CAPACITIES[i], &size)) &&
+            ((workspaces[i] = malloc(size)) != ZYAN_NULL) &&
+            ZYAN_SUCCESS(ZydisColumnarBatchInit(&batches[i], CAPACITIES[i], workspaces[i],
+                size));
+    }
+    if (!is_allocated)
+    {
+        ZYAN_PRINTF("Failed to allocate memory\n");
+        goto cleanup;
+    }
+
+    // The code ends with `nop`s and a truncated `mov rax, imm64`, so the last two rows are
+    // undecodable bytes
+    ZyanU64 state = 0x9E3779B97F4A7C15ULL;
+    for (ZyanUSize i = 0; i < CODE_SIZE; ++i)
+    {
+        code[i] = (ZyanU8)NextRandom(&state);
+    }
+    ZYAN_MEMSET(code + CODE_SIZE - ZYDIS_MAX_INSTRUCTION_LENGTH - 1, 0x90,
+        ZYDIS_MAX_INSTRUCTION_LENGTH - 1);
+    code[CODE_SIZE - 2] = 0x48;
+    code[CODE_SIZE - 1] = 0xB8;
+
+    ZyanUSize reference_count = 0;
+    for (ZyanUSize offset = 0; offset < CODE_SIZE; offset += reference[reference_count++].length)
+    {
+        ExpectRow(&decoder, code, offset, &reference[reference_count]);
+    }
+
+    Output output = { output_data, 0 };
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestSweeps(&decoder, code, reference, reference_count, batches);
+    all_passed &= TestChunks(&decoder, code, &batches[2]);
+    all_passed &= TestArrow(&decoder, code, reference, reference_count, &batches[2], &output,
+        rows);
+    all_passed &= TestArguments(&decoder, code, &batches[0], &output);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        goto cleanup;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    result = 0;
+
+cleanup:
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(CAPACITIES); ++i)
+    {
+        free(workspaces[i]);
+    }
+    free(output_data);
+    free(rows);
+    free(reference);
+    free(code);
+    return result;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,258 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Differential test for the decoder cache (`ZydisDecoderInitCache`).
+ *
+ * Every first opcode byte is decoded in every machine mode with and without the decoder cache and
+ * the results are required to be bit-identical. The internal cache layout is only read to report
+ * the number of cached opcodes.
+ */
+
+#include <stdlib.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+#include <Zydis/Internal/DecoderCache.h>
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct DecodeResult_
+{
+    ZyanStatus status;
+    ZydisDecoderContext context;
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+} DecodeResult;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/**
+ * Decodes the given buffer with the decoder cache or with the decoder, if `cache` is `ZYAN_NULL`.
+ */
+static void Decode(const ZydisDecoder* decoder, const ZydisDecoderCache* cache,
+    const ZyanU8* buffer, ZyanUSize length, DecodeResult* result)
+{
+    // Fill with garbage to make sure both paths overwrite everything
+    ZYAN_MEMSET(result, 0xCC, sizeof(*result));
+    result->status = cache ?
+        ZydisDecoderDecodeInstructionCached(cache, &result->context, buffer, length,
+            &result->instruction) :
+        ZydisDecoderDecodeInstruction(decoder, &result->context, buffer, length,
+            &result->instruction);
+    if (!ZYAN_SUCCESS(result->status))
+    {
+        ZYAN_MEMSET(result, 0, sizeof(*result));
+        result->status = ZYAN_STATUS_FAILED;
+        return;
+    }
+    ZYAN_MEMSET(result->operands, 0, sizeof(result->operands));
+    if (!(decoder->decoder_mode & (1 << ZYDIS_DECODER_MODE_MINIMAL)))
+    {
+        result->status = ZydisDecoderDecodeOperands(decoder, &result->context,
+            &result->instruction, result->operands, result->instruction.operand_count);
+    }
+}
+
+static void PrintBytes(const ZyanU8* bytes, ZyanUSize count)
+{
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        ZYAN_PRINTF("%02X ", bytes[i]);
+    }
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool RunTest(ZydisMachineMode machine_mode, ZydisStackWidth stack_width,
+    ZydisDecoderMode decoder_mode, ZyanBool enable_mode, void* memory, ZyanUSize size)
+{
+    ZydisDecoder reference;
+    if (ZYAN_FAILED(ZydisDecoderInit(&reference, machine_mode, stack_width)) ||
+        ZYAN_FAILED(ZydisDecoderEnableMode(&reference, decoder_mode, enable_mode)))
+    {
+        ZYAN_PRINTF("FAILED: Could not initialize decoder\n");
+        return ZYAN_FALSE;
+    }
+    ZydisDecoderCache* cache;
+    if (ZYAN_FAILED(ZydisDecoderInitCache(&reference, memory, size, &cache)))
+    {
+        ZYAN_PRINTF("FAILED: Could not initialize decoder cache\n");
+        return ZYAN_FALSE;
+    }
+
+    // Zero bytes, all-ones bytes and two arbitrary patterns for the bytes following the opcode
+    static const ZyanU8 patterns[4] = { 0x00, 0xFF, 0x80, 0x7F };
+
+    ZyanU32 cached_count = 0;
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanU16 opcode = 0; opcode < 256; ++opcode)
+    {
+        cached_count += (cache->mask[opcode >> 6] >> (opcode & 63)) & 1;
+        for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(patterns); ++i)
+        {
+            ZyanU8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+            ZYAN_MEMSET(buffer, patterns[i], sizeof(buffer));
+            buffer[0] = (ZyanU8)opcode;
+            buffer[2] ^= 0x5A;
+
+            // Include all truncated inputs to check the length handling
+            for (ZyanUSize length = 1; length <= sizeof(buffer); ++length)
+            {
+                static DecodeResult expected;
+                static DecodeResult actual;
+                Decode(&reference, ZYAN_NULL, buffer, length, &expected);
+                Decode(&reference, cache, buffer, length, &actual);
+                if (ZYAN_MEMCMP(&expected, &actual, sizeof(expected)))
+                {
+                    ZYAN_PRINTF("FAILED: mode %d, stack width %d, decoder mode %d = %d, bytes ",
+                        machine_mode, stack_width, decoder_mode, enable_mode);
+                    PrintBytes(buffer, length);
+                    ZYAN_PRINTF("\n");
+                    passed = ZYAN_FALSE;
+                }
+            }
+        }
+    }
+
+    ZYAN_PRINTF("%s: mode %d, stack width %d, decoder mode %d = %d (%u cached opcodes)\n",
+        passed ? "PASSED" : "FAILED", machine_mode, stack_width, decoder_mode, enable_mode,
+        cached_count);
+
+    return passed;
+}
+
+static ZyanBool TestArguments(void* memory, ZyanUSize size)
+{
+    ZydisDecoder decoder;
+    ZydisDecoderCache* cache;
+    ZydisDecodedInstruction instruction;
+    static const ZyanU8 NOP = 0x90;
+    const ZyanBool passed =
+        (ZydisDecoderGetCacheSize(ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) &&
+        (ZydisDecoderInitCache(ZYAN_NULL, memory, size, &cache) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDecoderInitCache(&decoder, ZYAN_NULL, size, &cache) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDecoderInitCache(&decoder, (ZyanU8*)memory + 4, size - 8, &cache) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDecoderInitCache(&decoder, memory, size - 1, &cache) ==
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+        (ZydisDecoderInitCache(&decoder, memory, size, ZYAN_NULL) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisDecoderInitCache(&decoder, memory, size, &cache)) &&
+        (ZydisDecoderDecodeInstructionCached(ZYAN_NULL, ZYAN_NULL, &NOP, 1, &instruction) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDecoderDecodeInstructionCached(cache, ZYAN_NULL, ZYAN_NULL, 1, &instruction) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDecoderDecodeInstructionCached(cache, ZYAN_NULL, &NOP, 0, &instruction) ==
+            ZYDIS_STATUS_NO_MORE_DATA) &&
+        ZYAN_SUCCESS(ZydisDecoderDecodeInstructionCached(cache, ZYAN_NULL, &NOP, 1,
+            &instruction)) &&
+        (instruction.mnemonic == ZYDIS_MNEMONIC_NOP);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    static const struct
+    {
+        ZydisMachineMode machine_mode;
+        ZydisStackWidth stack_width;
+    } modes[] =
+    {
+        { ZYDIS_MACHINE_MODE_LONG_64,        ZYDIS_STACK_WIDTH_64 },
+        { ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYDIS_STACK_WIDTH_32 },
+        { ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYDIS_STACK_WIDTH_16 },
+        { ZYDIS_MACHINE_MODE_LONG_COMPAT_16, ZYDIS_STACK_WIDTH_16 },
+        { ZYDIS_MACHINE_MODE_LONG_COMPAT_16, ZYDIS_STACK_WIDTH_32 },
+        { ZYDIS_MACHINE_MODE_LEGACY_32,      ZYDIS_STACK_WIDTH_32 },
+        { ZYDIS_MACHINE_MODE_LEGACY_32,      ZYDIS_STACK_WIDTH_16 },
+        { ZYDIS_MACHINE_MODE_LEGACY_16,      ZYDIS_STACK_WIDTH_16 },
+        { ZYDIS_MACHINE_MODE_LEGACY_16,      ZYDIS_STACK_WIDTH_32 },
+        { ZYDIS_MACHINE_MODE_REAL_16,        ZYDIS_STACK_WIDTH_16 },
+        { ZYDIS_MACHINE_MODE_REAL_16,        ZYDIS_STACK_WIDTH_32 }
+    };
+
+    static const struct
+    {
+        ZydisDecoderMode mode;
+        ZyanBool enabled;
+    } decoder_modes[] =
+    {
+        { ZYDIS_DECODER_MODE_MINIMAL,       ZYAN_FALSE },
+        { ZYDIS_DECODER_MODE_MINIMAL,       ZYAN_TRUE  },
+        { ZYDIS_DECODER_MODE_AMD_BRANCHES,  ZYAN_TRUE  },
+        { ZYDIS_DECODER_MODE_KNC,           ZYAN_TRUE  },
+        { ZYDIS_DECODER_MODE_TRUSTED_INPUT, ZYAN_TRUE  }
+    };
+
+    ZyanUSize size;
+    void* memory = ZYAN_NULL;
+    if (ZYAN_FAILED(ZydisDecoderGetCacheSize(&size)) || !(memory = malloc(size)))
+    {
+        ZYAN_PRINTF("Failed to allocate memory\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(modes); ++i)
+    {
+        for (ZyanUSize j = 0; j < ZYAN_ARRAY_LENGTH(decoder_modes); ++j)
+        {
+            all_passed &= RunTest(modes[i].machine_mode, modes[i].stack_width,
+                decoder_modes[j].mode, decoder_modes[j].enabled, memory, size);
+        }
+    }
+    all_passed &= TestArguments(memory, size);
+    free(memory);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
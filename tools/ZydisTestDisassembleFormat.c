@@ -0,0 +1,349 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Compares `ZydisDisassembleFormat` to `ZydisDecoderDecodeFull` followed by
+ * `ZydisFormatterFormatInstruction`.
+ *
+ * Pseudo-random instructions are formatted in Intel and AT&T style in 16-, 32- and 64-bit mode,
+ * with and without runtime address. The text and the decoded instruction have to be the same for
+ * both paths. Formatter hooks have to see the same visible operands, except for the operand
+ * actions and element information, which the fused path leaves zeroed.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of pseudo-random instructions per machine mode, style and address variant.
+ */
+#define ITERATION_COUNT 40000
+
+#define RUNTIME_ADDRESS 0x00007FF612340000ULL
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct Mode_
+{
+    const char* name;
+    ZydisMachineMode machine_mode;
+    ZydisStackWidth stack_width;
+    ZyanBool knc;
+} Mode;
+
+/**
+ * Receives the operands seen by the `ZYDIS_FORMATTER_FUNC_PRE_INSTRUCTION` hook.
+ */
+typedef struct HookData_
+{
+    ZyanBool called;
+    ZyanU8 operand_count;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT_VISIBLE];
+} HookData;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const Mode MODES[] =
+{
+    { "16-bit",     ZYDIS_MACHINE_MODE_LEGACY_16,       ZYDIS_STACK_WIDTH_16, ZYAN_FALSE },
+    { "32-bit",     ZYDIS_MACHINE_MODE_LONG_COMPAT_32,  ZYDIS_STACK_WIDTH_32, ZYAN_FALSE },
+    { "64-bit",     ZYDIS_MACHINE_MODE_LONG_64,         ZYDIS_STACK_WIDTH_64, ZYAN_FALSE },
+    { "64-bit KNC", ZYDIS_MACHINE_MODE_LONG_64,         ZYDIS_STACK_WIDTH_64, ZYAN_TRUE }
+};
+
+static const ZydisFormatterStyle STYLES[] =
+{
+    ZYDIS_FORMATTER_STYLE_INTEL,
+    ZYDIS_FORMATTER_STYLE_ATT
+};
+
+/**
+ * Leading bytes that select the escape maps and encodings, which uniformly random bytes rarely
+ * reach.
+ */
+static const ZyanU8 LEADING_BYTES[] =
+{
+    0x0F, 0x66, 0x67, 0xF2, 0xF3, 0x26, 0x64, 0x48, 0x4C, 0xC4, 0xC5, 0x62, 0x8F, 0xF0
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU64 NextRandom(ZyanU64* state)
+{
+    ZyanU64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void GenerateInstruction(ZyanU64* state, ZyanU8* buffer)
+{
+    for (ZyanU8 i = 0; i < ZYDIS_MAX_INSTRUCTION_LENGTH; ++i)
+    {
+        buffer[i] = (ZyanU8)NextRandom(state);
+    }
+
+    const ZyanU64 selector = NextRandom(state);
+    if (selector & 1)
+    {
+        buffer[0] = LEADING_BYTES[(selector >> 8) % ZYAN_ARRAY_LENGTH(LEADING_BYTES)];
+    }
+    if ((selector & 6) == 6)
+    {
+        buffer[1] = 0x0F;
+    }
+}
+
+static ZyanStatus HookPreInstruction(const ZydisFormatter* formatter,
+    ZydisFormatterBuffer* buffer, ZydisFormatterContext* context)
+{
+    ZYAN_UNUSED(formatter);
+    ZYAN_UNUSED(buffer);
+
+    HookData* const data = (HookData*)context->user_data;
+    data->called = ZYAN_TRUE;
+    data->operand_count = context->instruction->operand_count_visible;
+    ZYAN_MEMCPY(data->operands, context->operands,
+        data->operand_count * sizeof(context->operands[0]));
+    return ZYAN_STATUS_SUCCESS;
+}
+
+static ZyanStatus InitDecoder(ZydisDecoder* decoder, const Mode* mode)
+{
+    ZYAN_CHECK(ZydisDecoderInit(decoder, mode->machine_mode, mode->stack_width));
+    return ZydisDecoderEnableMode(decoder, ZYDIS_DECODER_MODE_KNC, mode->knc);
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+/**
+ * Formats pseudo-random instructions using both paths and compares the results.
+ */
+static ZyanBool TestOutput(const Mode* mode, ZydisFormatterStyle style, ZyanU64 runtime_address)
+{
+    ZydisDecoder decoder;
+    ZydisFormatter formatter;
+    if (ZYAN_FAILED(InitDecoder(&decoder, mode)) ||
+        ZYAN_FAILED(ZydisFormatterInit(&formatter, style)))
+    {
+        ZYAN_PRINTF("FAILED: initialization\n");
+        return ZYAN_FALSE;
+    }
+
+    const char* const style_name = (style == ZYDIS_FORMATTER_STYLE_INTEL) ? "Intel" : "AT&T";
+    const char* const address_name =
+        (runtime_address == ZYDIS_RUNTIME_ADDRESS_NONE) ? "relative" : "absolute";
+
+    ZyanU64 state = 0x9E3779B97F4A7C15ULL ^ (ZyanU64)(mode - MODES);
+    ZyanUSize decoded = 0;
+    for (ZyanUSize i = 0; i < ITERATION_COUNT; ++i)
+    {
+        ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        GenerateInstruction(&state, code);
+
+        ZydisDecodedInstruction expected_instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        char expected_text[256];
+        ZyanStatus expected_status = ZydisDecoderDecodeFull(&decoder, code, sizeof(code),
+            &expected_instruction, operands);
+        if (ZYAN_SUCCESS(expected_status))
+        {
+            expected_status = ZydisFormatterFormatInstruction(&formatter, &expected_instruction,
+                operands, expected_instruction.operand_count_visible, expected_text,
+                sizeof(expected_text), runtime_address, ZYAN_NULL);
+        }
+
+        ZydisDecodedInstruction instruction;
+        char text[256];
+        const ZyanStatus status = ZydisDisassembleFormat(&decoder, &formatter, runtime_address,
+            code, sizeof(code), &instruction, text, sizeof(text), ZYAN_NULL);
+
+        if (status != expected_status)
+        {
+            ZYAN_PRINTF("FAILED: %s %s %s: instruction %u: status %08" PRIX32 ", expected %08"
+                PRIX32 "\n", mode->name, style_name, address_name, (unsigned)i, status,
+                expected_status);
+            return ZYAN_FALSE;
+        }
+        if (ZYAN_FAILED(status))
+        {
+            continue;
+        }
+        ++decoded;
+        if (ZYAN_MEMCMP(&instruction, &expected_instruction, sizeof(instruction)) ||
+            ZYAN_STRCMP(text, expected_text))
+        {
+            ZYAN_PRINTF("FAILED: %s %s %s: instruction %u: \"%s\", expected \"%s\"\n",
+                mode->name, style_name, address_name, (unsigned)i, text, expected_text);
+            return ZYAN_FALSE;
+        }
+    }
+
+    ZYAN_PRINTF("PASSED: %s %s %s (%u instructions)\n", mode->name, style_name, address_name,
+        (unsigned)decoded);
+    return ZYAN_TRUE;
+}
+
+/**
+ * Checks the operands seen by formatter hooks.
+ */
+static ZyanBool TestHooks(const Mode* mode)
+{
+    ZydisDecoder decoder;
+    ZydisFormatter formatter;
+    const void* callback = (const void*)&HookPreInstruction;
+    if (ZYAN_FAILED(InitDecoder(&decoder, mode)) ||
+        ZYAN_FAILED(ZydisFormatterInit(&formatter, ZYDIS_FORMATTER_STYLE_INTEL)) ||
+        ZYAN_FAILED(ZydisFormatterSetHook(&formatter, ZYDIS_FORMATTER_FUNC_PRE_INSTRUCTION,
+            &callback)))
+    {
+        ZYAN_PRINTF("FAILED: initialization\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanU64 state = 0xD1B54A32D192ED03ULL ^ (ZyanU64)(mode - MODES);
+    for (ZyanUSize i = 0; i < ITERATION_COUNT; ++i)
+    {
+        ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        GenerateInstruction(&state, code);
+
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(&decoder, code, sizeof(code), &instruction,
+            operands)))
+        {
+            continue;
+        }
+
+        HookData data;
+        char text[256];
+        data.called = ZYAN_FALSE;
+        if (ZYAN_FAILED(ZydisDisassembleFormat(&decoder, &formatter, RUNTIME_ADDRESS, code,
+                sizeof(code), &instruction, text, sizeof(text), &data)) ||
+            !data.called || (data.operand_count != instruction.operand_count_visible))
+        {
+            ZYAN_PRINTF("FAILED: %s hooks: instruction %u was not formatted\n", mode->name,
+                (unsigned)i);
+            return ZYAN_FALSE;
+        }
+
+        // Apart from the documented fields, the operands have to be exactly the same
+        for (ZyanU8 j = 0; j < data.operand_count; ++j)
+        {
+            ZydisDecodedOperand expected = operands[j];
+            expected.actions = 0;
+            expected.element_type = ZYDIS_ELEMENT_TYPE_INVALID;
+            expected.element_size = 0;
+            expected.element_count = 0;
+            if (ZYAN_MEMCMP(&data.operands[j], &expected, sizeof(expected)))
+            {
+                ZYAN_PRINTF("FAILED: %s hooks: instruction %u (%s): operand %u differs\n",
+                    mode->name, (unsigned)i, text, j);
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    ZYAN_PRINTF("PASSED: %s hooks\n", mode->name);
+    return ZYAN_TRUE;
+}
+
+static ZyanBool TestArguments(void)
+{
+    ZydisDecoder decoder;
+    ZydisFormatter formatter;
+    ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+    ZydisFormatterInit(&formatter, ZYDIS_FORMATTER_STYLE_INTEL);
+
+    static const ZyanU8 code[] = { 0x48, 0x89, 0xD8 };
+    ZydisDecodedInstruction instruction;
+    char text[64];
+    ZyanBool passed =
+        (ZydisDisassembleFormat(&decoder, &formatter, RUNTIME_ADDRESS, code, sizeof(code),
+            &instruction, text, 0, ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDisassembleFormat(&decoder, ZYAN_NULL, RUNTIME_ADDRESS, code, sizeof(code),
+            &instruction, text, sizeof(text), ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisDisassembleFormat(&decoder, &formatter, RUNTIME_ADDRESS, code, 2,
+            &instruction, text, sizeof(text), ZYAN_NULL) == ZYDIS_STATUS_NO_MORE_DATA) &&
+        (ZydisDisassembleFormat(&decoder, &formatter, RUNTIME_ADDRESS, code, sizeof(code),
+            &instruction, text, 4, ZYAN_NULL) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+
+    // Minimal mode does not decode operands
+    passed &= ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL,
+        ZYAN_TRUE)) &&
+        (ZydisDisassembleFormat(&decoder, &formatter, RUNTIME_ADDRESS, code, sizeof(code),
+            &instruction, text, sizeof(text), ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(MODES); ++i)
+    {
+        for (ZyanUSize j = 0; j < ZYAN_ARRAY_LENGTH(STYLES); ++j)
+        {
+            all_passed &= TestOutput(&MODES[i], STYLES[j], RUNTIME_ADDRESS);
+            all_passed &= TestOutput(&MODES[i], STYLES[j], ZYDIS_RUNTIME_ADDRESS_NONE);
+        }
+        all_passed &= TestHooks(&MODES[i]);
+    }
+    all_passed &= TestArguments();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,294 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the indirect branch tracking helpers (`ZydisIbtCollectReferences` and
+ * `ZydisIbtIsLandingPad`) with hand-assembled code.
+ *
+ * Every case lists the exact references that have to be reported, including the `notrack`
+ * prefix rules, jump tables and the address truncation outside of 64-bit mode.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+#include "ZydisToolsShared.h"
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The runtime address of every test case.
+ */
+#define RUNTIME_ADDRESS 0x401000
+
+#define CALL        ZYDIS_IBT_REFERENCE_CALL
+#define JUMP        ZYDIS_IBT_REFERENCE_JUMP
+#define RELATIVE    ZYDIS_IBT_REFERENCE_RELATIVE_ADDRESS
+#define ABSOLUTE    ZYDIS_IBT_REFERENCE_ABSOLUTE_ADDRESS
+#define INDIRECT    ZYDIS_IBT_REFERENCE_INDIRECT_JUMP
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Describes an expected reference. The source is relative to the start of the code.
+ */
+typedef struct ExpectedReference_
+{
+    ZydisIbtReferenceType type;
+    ZyanU8 source;
+    ZyanU64 target;
+    ZyanBool is_notrack;
+} ExpectedReference;
+
+typedef struct TestCase_
+{
+    const char* name;
+    ZydisMachineMode machine_mode;
+    ZyanBool cet;
+    ZyanU8 length;
+    ZyanU8 code[32];
+    ZyanU8 reference_count;
+    ExpectedReference references[4];
+} TestCase;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const TestCase TEST_CASES[] =
+{
+    // call $+0x15; jmp $; jz $-7; jnz $+0x106
+    { "direct calls and jumps", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 15,
+        { 0xE8, 0x10, 0x00, 0x00, 0x00, 0xEB, 0xFE, 0x74, 0xF7, 0x0F, 0x85, 0x00, 0x01, 0x00,
+          0x00 },
+        4, { { CALL,  0, 0x401015, ZYAN_FALSE }, { JUMP,  5, 0x401005, ZYAN_FALSE },
+             { JUMP,  7, 0x401000, ZYAN_FALSE }, { JUMP,  9, 0x40110F, ZYAN_FALSE } } },
+    // jmp [rax*8+0x402000]; notrack jmp [rax*8+0x403000]; notrack jmp rax; jmp [rip]
+    { "indirect jumps", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 24,
+        { 0xFF, 0x24, 0xC5, 0x00, 0x20, 0x40, 0x00, 0x3E, 0xFF, 0x24, 0xC5, 0x00, 0x30, 0x40,
+          0x00, 0x3E, 0xFF, 0xE0, 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 },
+        4, { { INDIRECT,  0, 0x402000, ZYAN_FALSE }, { INDIRECT,  7, 0x403000, ZYAN_TRUE  },
+             { INDIRECT, 15,        0, ZYAN_TRUE  }, { INDIRECT, 18,        0, ZYAN_FALSE } } },
+    // ds jmp rax; ds jmp [rax*8+0x402000]
+    { "3E is no notrack without CET", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_FALSE, 11,
+        { 0x3E, 0xFF, 0xE0, 0x3E, 0xFF, 0x24, 0xC5, 0x00, 0x20, 0x40, 0x00 },
+        2, { { INDIRECT,  0,        0, ZYAN_FALSE }, { INDIRECT,  3, 0x402000, ZYAN_FALSE } } },
+    // ds fs jmp rax; fs ds jmp rax
+    { "3E is no notrack with an FS override", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 8,
+        { 0x3E, 0x64, 0xFF, 0xE0, 0x64, 0x3E, 0xFF, 0xE0 },
+        2, { { INDIRECT,  0,        0, ZYAN_FALSE }, { INDIRECT,  4,        0, ZYAN_FALSE } } },
+    // ds mov eax, [rax]; jmp rax
+    { "3E on other instructions", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 5,
+        { 0x3E, 0x8B, 0x00, 0xFF, 0xE0 },
+        1, { { INDIRECT,  3,        0, ZYAN_FALSE } } },
+    // lea rax, [rip+0x10]; mov eax, 0x12345678; push 0x80000000; movabs rax, 0x401000;
+    // mov al, 1
+    { "materialized addresses", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 29,
+        { 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00, 0xB8, 0x78, 0x56, 0x34, 0x12, 0x68, 0x00,
+          0x00, 0x00, 0x80, 0x48, 0xB8, 0x00, 0x10, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0xB0,
+          0x01 },
+        4, { { RELATIVE,  0, 0x401017, ZYAN_FALSE }, { ABSOLUTE,  7, 0x12345678, ZYAN_FALSE },
+             { ABSOLUTE, 12, 0x80000000, ZYAN_FALSE }, { ABSOLUTE, 17, 0x401000, ZYAN_FALSE } } },
+    // (invalid) push es; call $+5
+    { "undecodable bytes are skipped", ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE, 6,
+        { 0x06, 0xE8, 0x00, 0x00, 0x00, 0x00 },
+        1, { { CALL,  1, 0x401006, ZYAN_FALSE } } },
+    // lea eax, [0x402000]; mov eax, 0x403000; call $-0x401000; jmp [eax*4+0x404000]
+    { "32-bit mode", ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYAN_TRUE, 23,
+        { 0x8D, 0x05, 0x00, 0x20, 0x40, 0x00, 0xB8, 0x00, 0x30, 0x40, 0x00, 0xE8, 0xF0, 0xEF,
+          0xBF, 0xFF, 0xFF, 0x24, 0x85, 0x00, 0x40, 0x40, 0x00 },
+        4, { { ABSOLUTE,  0, 0x402000, ZYAN_FALSE }, { ABSOLUTE,  6, 0x403000, ZYAN_FALSE },
+             { CALL, 11, 0x00000000, ZYAN_FALSE }, { INDIRECT, 16, 0x404000, ZYAN_FALSE } } },
+    // notrack jmp eax; jmp $+0x1004 (16-bit operand size)
+    { "32-bit mode notrack and 16-bit truncation", ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYAN_TRUE,
+        7, { 0x3E, 0xFF, 0xE0, 0x66, 0xE9, 0x00, 0x10 },
+        2, { { INDIRECT,  0,        0, ZYAN_TRUE  }, { JUMP,  3, 0x2007, ZYAN_FALSE } } }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanStatus CollectReference(const ZydisIbtReference* reference, void* user_data)
+{
+    return ResultListPush((ResultList*)user_data, reference);
+}
+
+static ZyanStatus InitDecoder(ZydisDecoder* decoder, ZydisMachineMode machine_mode,
+    ZyanBool cet)
+{
+    ZYAN_CHECK(ZydisDecoderInit(decoder, machine_mode,
+        (machine_mode == ZYDIS_MACHINE_MODE_LONG_64) ?
+            ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32));
+    return ZydisDecoderEnableMode(decoder, ZYDIS_DECODER_MODE_CET, cet);
+}
+
+static void GetCaseInfo(const void* test_case, const char** name, size_t* expected_count)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    *name = test->name;
+    *expected_count = test->reference_count;
+}
+
+static ZyanStatus RunCase(void* context, const void* test_case, ResultList* list)
+{
+    ZYAN_UNUSED(context);
+    const TestCase* test = (const TestCase*)test_case;
+
+    ZydisDecoder decoder;
+    ZYAN_CHECK(InitDecoder(&decoder, test->machine_mode, test->cet));
+    return ZydisIbtCollectReferences(&decoder, test->code, test->length, RUNTIME_ADDRESS,
+        &CollectReference, list);
+}
+
+static ZyanBool CompareReference(const void* test_case, const void* result, size_t index)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    const ZydisIbtReference* reference = (const ZydisIbtReference*)result;
+    const ExpectedReference* expected = &test->references[index];
+    if ((reference->type == expected->type) &&
+        (reference->source == (ZyanU64)RUNTIME_ADDRESS + expected->source) &&
+        (reference->target == expected->target) &&
+        (reference->is_notrack == expected->is_notrack))
+    {
+        return ZYAN_TRUE;
+    }
+
+    ZYAN_PRINTF("FAILED: %s: expected reference %d at +%u (target 0x%" PRIX64 ", notrack %d), " \
+        "got %d at 0x%" PRIX64 " (target 0x%" PRIX64 ", notrack %d)\n", test->name,
+        expected->type, expected->source, expected->target, expected->is_notrack,
+        reference->type, reference->source, reference->target, reference->is_notrack);
+    return ZYAN_FALSE;
+}
+
+static void PrintReference(const void* result)
+{
+    const ZydisIbtReference* reference = (const ZydisIbtReference*)result;
+    ZYAN_PRINTF("  reference %d at 0x%" PRIX64 " (target 0x%" PRIX64 ")\n", reference->type,
+        reference->source, reference->target);
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestCases(void)
+{
+    const TestTable table =
+    {
+        "hand-assembled cases", TEST_CASES, sizeof(TestCase), ZYAN_ARRAY_LENGTH(TEST_CASES),
+        sizeof(ZydisIbtReference), ZYAN_NULL, &GetCaseInfo, &RunCase, &CompareReference,
+        &PrintReference
+    };
+    return RunTestTable(&table);
+}
+
+static ZyanBool TestCollectArguments(void)
+{
+    const TestCase* test = &TEST_CASES[0];
+    ZydisDecoder decoder;
+    ResultList list;
+    ResultListInit(&list, sizeof(ZydisIbtReference), 1);
+
+    // The first status code other than `ZYAN_STATUS_SUCCESS` has to stop the sweep
+    ZyanBool passed =
+        ZYAN_SUCCESS(InitDecoder(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE)) &&
+        (ZydisIbtCollectReferences(&decoder, test->code, test->length, RUNTIME_ADDRESS,
+            &CollectReference, &list) == ZYAN_STATUS_FAILED) &&
+        (list.results.count == 1) &&
+        (ZydisIbtCollectReferences(&decoder, test->code, test->length, RUNTIME_ADDRESS,
+            ZYAN_NULL, &list) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisIbtCollectReferences(&decoder, ZYAN_NULL, 0, RUNTIME_ADDRESS,
+            &CollectReference, &list));
+
+    // `notrack` prefixes can not be detected without the instruction attributes
+    passed &=
+        ZYAN_SUCCESS(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)) &&
+        (ZydisIbtCollectReferences(&decoder, test->code, test->length, RUNTIME_ADDRESS,
+            &CollectReference, &list) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (list.results.count == 1);
+    ResultListDestroy(&list);
+
+    ZYAN_PRINTF("%s: callback status and invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestLandingPad(void)
+{
+    static const ZyanU8 endbr64[] = { 0xF3, 0x0F, 0x1E, 0xFA };
+    static const ZyanU8 endbr32[] = { 0xF3, 0x0F, 0x1E, 0xFB };
+    static const ZyanU8 nop[] = { 0x90 };
+
+    ZydisDecoder decoder64;
+    ZydisDecoder decoder32;
+    ZydisDecoder decoder_no_cet;
+    ZyanBool passed =
+        ZYAN_SUCCESS(InitDecoder(&decoder64, ZYDIS_MACHINE_MODE_LONG_64, ZYAN_TRUE)) &&
+        ZYAN_SUCCESS(InitDecoder(&decoder32, ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYAN_TRUE)) &&
+        ZYAN_SUCCESS(InitDecoder(&decoder_no_cet, ZYDIS_MACHINE_MODE_LONG_64, ZYAN_FALSE));
+    passed &=
+        (ZydisIbtIsLandingPad(&decoder64, endbr64, sizeof(endbr64)) == ZYAN_STATUS_TRUE) &&
+        (ZydisIbtIsLandingPad(&decoder64, endbr32, sizeof(endbr32)) == ZYAN_STATUS_FALSE) &&
+        (ZydisIbtIsLandingPad(&decoder32, endbr32, sizeof(endbr32)) == ZYAN_STATUS_TRUE) &&
+        (ZydisIbtIsLandingPad(&decoder32, endbr64, sizeof(endbr64)) == ZYAN_STATUS_FALSE) &&
+        (ZydisIbtIsLandingPad(&decoder64, nop, sizeof(nop)) == ZYAN_STATUS_FALSE) &&
+        (ZydisIbtIsLandingPad(&decoder64, endbr64, 3) == ZYAN_STATUS_FALSE) &&
+        (ZydisIbtIsLandingPad(&decoder_no_cet, endbr64, sizeof(endbr64)) ==
+            ZYAN_STATUS_INVALID_ARGUMENT);
+
+    ZYAN_PRINTF("%s: landing pads\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestCases();
+    all_passed &= TestCollectArguments();
+    all_passed &= TestLandingPad();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
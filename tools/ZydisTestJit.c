@@ -0,0 +1,544 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the sequence selection of the JIT helpers (`ZydisJitEmitConstant` and
+ * `ZydisJitEmitBranch`).
+ *
+ * Every emitted sequence is decoded again. The decoded length has to match the selected length
+ * and the decoded instructions have to load the requested constant or reach the requested target.
+ * The selection only asserts the encoded length in debug builds, so these checks are the only
+ * guard against a selection that disagrees with the encoder in release builds.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * A runtime address far away from the low 4 GiB, so 32-bit constants are out of `lea` range.
+ */
+#define RUNTIME_ADDRESS 0x7F0000000000ULL
+
+/**
+ * The runtime address of the literal pool used by the tests.
+ */
+#define POOL_ADDRESS (RUNTIME_ADDRESS + 0x1000)
+
+/**
+ * The maximum length of an emitted sequence.
+ */
+#define MAX_SEQUENCE_LENGTH 16
+
+#define XOR         ZYDIS_JIT_CONSTANT_KIND_XOR
+#define IMM32       ZYDIS_JIT_CONSTANT_KIND_MOV_IMM32
+#define SIMM32      ZYDIS_JIT_CONSTANT_KIND_MOV_SIMM32
+#define LEA         ZYDIS_JIT_CONSTANT_KIND_LEA
+#define IMM64       ZYDIS_JIT_CONSTANT_KIND_MOV_IMM64
+
+#define RELATIVE    ZYDIS_JIT_BRANCH_KIND_RELATIVE
+#define POOL        ZYDIS_JIT_BRANCH_KIND_POOL
+#define INLINE      ZYDIS_JIT_BRANCH_KIND_INLINE
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct ConstantCase_
+{
+    const char* name;
+    ZydisRegister reg;
+    ZyanU64 value;
+    ZyanU64 runtime_address;
+    ZyanBool preserve_flags;
+    ZydisJitConstantKind kind;
+    ZyanU8 length;
+} ConstantCase;
+
+/**
+ * Describes a branch that is emitted using the shared literal pool. The cases are emitted in
+ * order, as the pool contents depend on the previous cases.
+ */
+typedef struct BranchCase_
+{
+    const char* name;
+    ZydisMnemonic mnemonic;
+    ZyanU64 target;
+    ZyanU64 runtime_address;
+    ZyanBool use_pool;
+    ZydisJitBranchKind kind;
+    ZyanU8 length;
+    ZyanUSize pool_count;
+} BranchCase;
+
+/**
+ * Maps runtime addresses to the emitted code and the literal pool.
+ */
+typedef struct Memory_
+{
+    const ZyanU8* code;
+    ZyanU64 code_address;
+    ZyanUSize code_length;
+    const ZydisJitLiteralPool* pool;
+} Memory;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const ConstantCase CONSTANT_CASES[] =
+{
+    { "zero",                       ZYDIS_REGISTER_RAX, 0, RUNTIME_ADDRESS, ZYAN_FALSE, XOR, 2 },
+    { "zero into r8",               ZYDIS_REGISTER_R8,  0, RUNTIME_ADDRESS, ZYAN_FALSE, XOR, 3 },
+    { "zero preserving flags",      ZYDIS_REGISTER_RAX, 0, RUNTIME_ADDRESS, ZYAN_TRUE, IMM32, 5 },
+    { "zero into r15 preserving flags",
+                                    ZYDIS_REGISTER_R15, 0, RUNTIME_ADDRESS, ZYAN_TRUE, IMM32, 6 },
+    { "one",                        ZYDIS_REGISTER_RSP, 1, RUNTIME_ADDRESS, ZYAN_FALSE, IMM32, 5 },
+    { "largest imm32",              ZYDIS_REGISTER_RAX, 0xFFFFFFFF, RUNTIME_ADDRESS, ZYAN_FALSE,
+                                    IMM32, 5 },
+    { "largest imm32 into r15",     ZYDIS_REGISTER_R15, 0xFFFFFFFF, RUNTIME_ADDRESS, ZYAN_FALSE,
+                                    IMM32, 6 },
+    { "smallest imm64",             ZYDIS_REGISTER_RAX, 0x100000000, RUNTIME_ADDRESS,
+                                    ZYAN_FALSE, IMM64, 10 },
+    { "smallest simm32",            ZYDIS_REGISTER_RAX, 0xFFFFFFFF80000000, RUNTIME_ADDRESS,
+                                    ZYAN_FALSE, SIMM32, 7 },
+    { "minus one",                  ZYDIS_REGISTER_R9,  0xFFFFFFFFFFFFFFFF, RUNTIME_ADDRESS,
+                                    ZYAN_FALSE, SIMM32, 7 },
+    { "largest value below simm32", ZYDIS_REGISTER_RAX, 0xFFFFFFFF7FFFFFFF, RUNTIME_ADDRESS,
+                                    ZYAN_FALSE, IMM64, 10 },
+    { "largest lea displacement",   ZYDIS_REGISTER_RAX, RUNTIME_ADDRESS + 7 + 0x7FFFFFFF,
+                                    RUNTIME_ADDRESS, ZYAN_FALSE, LEA, 7 },
+    { "lea displacement overflow",  ZYDIS_REGISTER_RAX, RUNTIME_ADDRESS + 7 + 0x80000000,
+                                    RUNTIME_ADDRESS, ZYAN_FALSE, IMM64, 10 },
+    { "smallest lea displacement",  ZYDIS_REGISTER_R12, RUNTIME_ADDRESS + 7 - 0x80000000,
+                                    RUNTIME_ADDRESS, ZYAN_FALSE, LEA, 7 },
+    { "lea displacement underflow", ZYDIS_REGISTER_RAX, RUNTIME_ADDRESS + 7 - 0x80000001,
+                                    RUNTIME_ADDRESS, ZYAN_FALSE, IMM64, 10 },
+    { "lea preserving flags",       ZYDIS_REGISTER_RAX, RUNTIME_ADDRESS, RUNTIME_ADDRESS,
+                                    ZYAN_TRUE, LEA, 7 },
+    { "imm64 above 4 GiB code",     ZYDIS_REGISTER_RAX, 0x100000000, 0x100000000 - 0x1000,
+                                    ZYAN_FALSE, LEA, 7 }
+};
+
+static const BranchCase BRANCH_CASES[] =
+{
+    { "largest rel32 displacement", ZYDIS_MNEMONIC_JMP, RUNTIME_ADDRESS + 5 + 0x7FFFFFFF,
+        RUNTIME_ADDRESS, ZYAN_TRUE, RELATIVE, 5, 0 },
+    { "smallest rel32 displacement", ZYDIS_MNEMONIC_CALL, RUNTIME_ADDRESS + 5 - 0x80000000,
+        RUNTIME_ADDRESS, ZYAN_TRUE, RELATIVE, 5, 0 },
+    { "jmp without pool", ZYDIS_MNEMONIC_JMP, RUNTIME_ADDRESS + 5 + 0x80000000,
+        RUNTIME_ADDRESS, ZYAN_FALSE, INLINE, 14, 0 },
+    { "call without pool", ZYDIS_MNEMONIC_CALL, RUNTIME_ADDRESS + 5 - 0x80000001,
+        RUNTIME_ADDRESS, ZYAN_FALSE, INLINE, 16, 0 },
+    { "first pool entry", ZYDIS_MNEMONIC_JMP, 0x1000, RUNTIME_ADDRESS, ZYAN_TRUE, POOL, 6, 1 },
+    { "shared pool entry", ZYDIS_MNEMONIC_CALL, 0x1000, RUNTIME_ADDRESS + 0x100, ZYAN_TRUE,
+        POOL, 6, 1 },
+    { "second pool entry", ZYDIS_MNEMONIC_CALL, 0x2000, RUNTIME_ADDRESS, ZYAN_TRUE, POOL, 6, 2 },
+    { "jmp with full pool", ZYDIS_MNEMONIC_JMP, 0x3000, RUNTIME_ADDRESS, ZYAN_TRUE, INLINE, 14,
+        2 },
+    { "call with full pool", ZYDIS_MNEMONIC_CALL, 0x3000, RUNTIME_ADDRESS, ZYAN_TRUE, INLINE, 16,
+        2 },
+    { "existing entry of full pool", ZYDIS_MNEMONIC_JMP, 0x2000, RUNTIME_ADDRESS + 0x200,
+        ZYAN_TRUE, POOL, 6, 2 },
+    { "rel32 target with full pool", ZYDIS_MNEMONIC_JMP, RUNTIME_ADDRESS, RUNTIME_ADDRESS,
+        ZYAN_TRUE, RELATIVE, 5, 2 },
+    { "pool out of range", ZYDIS_MNEMONIC_JMP, 0x1000, POOL_ADDRESS + 0x80000000,
+        ZYAN_TRUE, INLINE, 14, 2 },
+    { "first pool entry out of range", ZYDIS_MNEMONIC_CALL, 0x1000,
+        POOL_ADDRESS - 6 + 0x80000001, ZYAN_TRUE, INLINE, 16, 2 },
+    { "first pool entry in range", ZYDIS_MNEMONIC_CALL, 0x1000,
+        POOL_ADDRESS - 6 + 0x80000000, ZYAN_TRUE, POOL, 6, 2 },
+    { "last pool entry out of range", ZYDIS_MNEMONIC_JMP, 0x2000,
+        POOL_ADDRESS + 8 - 6 - 0x80000000, ZYAN_TRUE, INLINE, 14, 2 },
+    { "last pool entry in range", ZYDIS_MNEMONIC_JMP, 0x2000,
+        POOL_ADDRESS + 8 - 6 - 0x7FFFFFFF, ZYAN_TRUE, POOL, 6, 2 }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanBool ReadLiteral(const Memory* memory, ZyanU64 address, ZyanU64* value)
+{
+    const ZyanU8* data = ZYAN_NULL;
+    if ((address >= memory->code_address) &&
+        (address + 8 <= memory->code_address + memory->code_length))
+    {
+        data = memory->code + (address - memory->code_address);
+    }
+    else if (memory->pool && (address >= memory->pool->runtime_address) &&
+        (address + 8 <= memory->pool->runtime_address + memory->pool->count * 8))
+    {
+        data = memory->pool->buffer + (address - memory->pool->runtime_address);
+    }
+    if (!data)
+    {
+        return ZYAN_FALSE;
+    }
+
+    *value = 0;
+    for (ZyanU8 i = 0; i < 8; ++i)
+    {
+        *value |= (ZyanU64)data[i] << (i * 8);
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Decodes the constant sequence and checks that it loads the requested value.
+ */
+static ZyanBool VerifyConstant(const ZydisDecoder* decoder, const ZydisJitConstant* constant,
+    const ZyanU8* buffer, ZyanUSize length, ZyanU64 runtime_address)
+{
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, buffer, length, &instruction, operands)) ||
+        (instruction.length != length) ||
+        (operands[0].type != ZYDIS_OPERAND_TYPE_REGISTER) ||
+        (ZydisRegisterGetLargestEnclosing(ZYDIS_MACHINE_MODE_LONG_64, operands[0].reg.value) !=
+            constant->reg))
+    {
+        return ZYAN_FALSE;
+    }
+
+    ZyanU64 value;
+    switch (instruction.mnemonic)
+    {
+    case ZYDIS_MNEMONIC_XOR:
+        if ((operands[1].type != ZYDIS_OPERAND_TYPE_REGISTER) ||
+            (operands[1].reg.value != operands[0].reg.value))
+        {
+            return ZYAN_FALSE;
+        }
+        value = 0;
+        break;
+    case ZYDIS_MNEMONIC_MOV:
+        // Writes to 32-bit registers are zero-extended
+        value = operands[1].imm.value.u;
+        if (operands[0].size == 32)
+        {
+            value &= 0xFFFFFFFF;
+        }
+        break;
+    case ZYDIS_MNEMONIC_LEA:
+        if (ZYAN_FAILED(ZydisCalcAbsoluteAddress(&instruction, &operands[1], runtime_address,
+            &value)))
+        {
+            return ZYAN_FALSE;
+        }
+        break;
+    default:
+        return ZYAN_FALSE;
+    }
+
+    return (value == constant->value);
+}
+
+/**
+ * Decodes the branch sequence and checks that it reaches the requested target.
+ */
+static ZyanBool VerifyBranch(const ZydisDecoder* decoder, const ZydisJitBranch* branch,
+    ZydisJitBranchKind kind, const Memory* memory)
+{
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, memory->code, memory->code_length,
+            &instruction, operands)) ||
+        (instruction.mnemonic != branch->mnemonic))
+    {
+        return ZYAN_FALSE;
+    }
+
+    ZyanU64 target;
+    switch (kind)
+    {
+    case ZYDIS_JIT_BRANCH_KIND_RELATIVE:
+        return (instruction.length == memory->code_length) &&
+            (operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE) &&
+            ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&instruction, &operands[0],
+                memory->code_address, &target)) &&
+            (target == branch->target);
+    case ZYDIS_JIT_BRANCH_KIND_POOL:
+    case ZYDIS_JIT_BRANCH_KIND_INLINE:
+    {
+        ZyanU64 address;
+        if ((operands[0].type != ZYDIS_OPERAND_TYPE_MEMORY) ||
+            (operands[0].mem.base != ZYDIS_REGISTER_RIP) ||
+            ZYAN_FAILED(ZydisCalcAbsoluteAddress(&instruction, &operands[0],
+                memory->code_address, &address)) ||
+            !ReadLiteral(memory, address, &target) || (target != branch->target))
+        {
+            return ZYAN_FALSE;
+        }
+        if (kind == ZYDIS_JIT_BRANCH_KIND_POOL)
+        {
+            return (instruction.length == memory->code_length) &&
+                (address >= memory->pool->runtime_address);
+        }
+
+        // The target is stored at the end of the sequence
+        if (address != memory->code_address + memory->code_length - 8)
+        {
+            return ZYAN_FALSE;
+        }
+        if (branch->mnemonic == ZYDIS_MNEMONIC_JMP)
+        {
+            return ((ZyanUSize)instruction.length + 8 == memory->code_length);
+        }
+
+        // `call` returns to a `jmp` that skips the target
+        const ZyanU8 call_length = instruction.length;
+        return ZYAN_SUCCESS(ZydisDecoderDecodeFull(decoder, memory->code + call_length,
+                memory->code_length - call_length, &instruction, operands)) &&
+            (instruction.mnemonic == ZYDIS_MNEMONIC_JMP) &&
+            ((ZyanUSize)call_length + instruction.length + 8 == memory->code_length) &&
+            ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&instruction, &operands[0],
+                memory->code_address + call_length, &target)) &&
+            (target == memory->code_address + memory->code_length);
+    }
+    default:
+        return ZYAN_FALSE;
+    }
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestConstants(const ZydisDecoder* decoder)
+{
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(CONSTANT_CASES); ++i)
+    {
+        const ConstantCase* test = &CONSTANT_CASES[i];
+        ZydisJitConstant constant;
+        constant.reg = test->reg;
+        constant.value = test->value;
+
+        ZydisJitConstantKind kind;
+        ZyanU8 selected_length;
+        ZyanU8 buffer[MAX_SEQUENCE_LENGTH];
+        ZyanUSize length = sizeof(buffer);
+        ZyanUSize short_length = test->length - 1;
+        if (ZYAN_FAILED(ZydisJitGetConstantLength(&constant, test->runtime_address,
+                test->preserve_flags, &kind, &selected_length)) ||
+            (kind != test->kind) || (selected_length != test->length) ||
+            (ZydisJitEmitConstant(&constant, test->runtime_address, test->preserve_flags, buffer,
+                &short_length) != ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) ||
+            ZYAN_FAILED(ZydisJitEmitConstant(&constant, test->runtime_address,
+                test->preserve_flags, buffer, &length)) ||
+            (length != test->length) ||
+            !VerifyConstant(decoder, &constant, buffer, length, test->runtime_address))
+        {
+            ZYAN_PRINTF("FAILED: constant %s: expected kind %d (%u bytes), selected kind %d " \
+                "(%u bytes), emitted %u bytes\n", test->name, test->kind, test->length, kind,
+                selected_length, (unsigned)length);
+            passed = ZYAN_FALSE;
+        }
+    }
+
+    ZYAN_PRINTF("%s: %u constants\n", passed ? "PASSED" : "FAILED",
+        (unsigned)ZYAN_ARRAY_LENGTH(CONSTANT_CASES));
+    return passed;
+}
+
+static ZyanBool TestBranches(const ZydisDecoder* decoder)
+{
+    ZyanU8 pool_buffer[2 * 8];
+    ZydisJitLiteralPool pool;
+    if (ZYAN_FAILED(ZydisJitLiteralPoolInit(&pool, pool_buffer, 2, POOL_ADDRESS)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisJitLiteralPoolInit\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(BRANCH_CASES); ++i)
+    {
+        const BranchCase* test = &BRANCH_CASES[i];
+        ZydisJitLiteralPool* const used_pool = test->use_pool ? &pool : ZYAN_NULL;
+        ZydisJitBranch branch;
+        branch.mnemonic = test->mnemonic;
+        branch.target = test->target;
+
+        ZydisJitBranchKind kind;
+        ZyanU8 selected_length;
+        ZyanU8 buffer[MAX_SEQUENCE_LENGTH];
+        ZyanUSize length = sizeof(buffer);
+        ZyanUSize short_length = test->length - 1;
+        Memory memory;
+        memory.code = buffer;
+        memory.code_address = test->runtime_address;
+        memory.pool = used_pool;
+        if (ZYAN_FAILED(ZydisJitGetBranchLength(&branch, test->runtime_address, used_pool, &kind,
+                &selected_length)) ||
+            (kind != test->kind) || (selected_length != test->length) ||
+            (ZydisJitEmitBranch(&branch, test->runtime_address, used_pool, buffer,
+                &short_length) != ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) ||
+            ZYAN_FAILED(ZydisJitEmitBranch(&branch, test->runtime_address, used_pool, buffer,
+                &length)) ||
+            (length != test->length) || (pool.count != test->pool_count) ||
+            ((memory.code_length = length), !VerifyBranch(decoder, &branch, kind, &memory)))
+        {
+            ZYAN_PRINTF("FAILED: branch %s: expected kind %d (%u bytes), selected kind %d " \
+                "(%u bytes), emitted %u bytes, %u pool entries\n", test->name, test->kind,
+                test->length, kind, selected_length, (unsigned)length, (unsigned)pool.count);
+            passed = ZYAN_FALSE;
+        }
+    }
+
+    // Empty pools are never used
+    ZydisJitBranch branch;
+    branch.mnemonic = ZYDIS_MNEMONIC_JMP;
+    branch.target = 0x1000;
+    ZydisJitBranchKind kind;
+    ZyanU8 length;
+    passed &= ZYAN_SUCCESS(ZydisJitLiteralPoolInit(&pool, ZYAN_NULL, 0, POOL_ADDRESS)) &&
+        ZYAN_SUCCESS(ZydisJitGetBranchLength(&branch, RUNTIME_ADDRESS, &pool, &kind, &length)) &&
+        (kind == ZYDIS_JIT_BRANCH_KIND_INLINE) && (length == 14);
+
+    ZYAN_PRINTF("%s: %u branches\n", passed ? "PASSED" : "FAILED",
+        (unsigned)ZYAN_ARRAY_LENGTH(BRANCH_CASES) + 1);
+    return passed;
+}
+
+static ZyanBool TestSequences(const ZydisDecoder* decoder)
+{
+    // Every sequence starts at the address following the previous one, which moves the last
+    // constant out of `lea` range and the last target out of `rel32` range
+    static const ZydisJitConstant constants[] =
+    {
+        { ZYDIS_REGISTER_RAX, 0 },
+        { ZYDIS_REGISTER_R8,  0xFFFFFFFF },
+        { ZYDIS_REGISTER_RCX, 0xFFFFFFFFFFFFFFFE },
+        { ZYDIS_REGISTER_RDX, RUNTIME_ADDRESS + 7 - 0x80000000 }
+    };
+    static const ZydisJitBranch branches[] =
+    {
+        { ZYDIS_MNEMONIC_JMP,  RUNTIME_ADDRESS },
+        { ZYDIS_MNEMONIC_CALL, 0x1000 },
+        { ZYDIS_MNEMONIC_JMP,  0x1000 },
+        { ZYDIS_MNEMONIC_CALL, RUNTIME_ADDRESS + 5 - 0x80000000 }
+    };
+
+    ZyanU8 buffer[4 * MAX_SEQUENCE_LENGTH];
+    ZyanUSize length = sizeof(buffer);
+    ZyanBool passed = ZYAN_SUCCESS(ZydisJitEmitConstants(constants,
+        ZYAN_ARRAY_LENGTH(constants), RUNTIME_ADDRESS, ZYAN_FALSE, buffer, &length));
+    ZyanUSize offset = 0;
+    for (ZyanUSize i = 0; passed && (i < ZYAN_ARRAY_LENGTH(constants)); ++i)
+    {
+        ZyanU8 sequence_length;
+        passed = ZYAN_SUCCESS(ZydisJitGetConstantLength(&constants[i], RUNTIME_ADDRESS + offset,
+                ZYAN_FALSE, ZYAN_NULL, &sequence_length)) &&
+            VerifyConstant(decoder, &constants[i], buffer + offset, sequence_length,
+                RUNTIME_ADDRESS + offset);
+        offset += sequence_length;
+    }
+    passed &= (offset == length) && (length == 2 + 6 + 7 + 10);
+
+    Memory memory;
+    memory.code_address = RUNTIME_ADDRESS;
+    memory.pool = ZYAN_NULL;
+    length = sizeof(buffer);
+    passed &= ZYAN_SUCCESS(ZydisJitEmitBranches(branches, ZYAN_ARRAY_LENGTH(branches),
+        RUNTIME_ADDRESS, ZYAN_NULL, buffer, &length));
+    offset = 0;
+    for (ZyanUSize i = 0; passed && (i < ZYAN_ARRAY_LENGTH(branches)); ++i)
+    {
+        ZydisJitBranchKind kind;
+        ZyanU8 sequence_length;
+        passed = ZYAN_SUCCESS(ZydisJitGetBranchLength(&branches[i], RUNTIME_ADDRESS + offset,
+            ZYAN_NULL, &kind, &sequence_length));
+        memory.code = buffer + offset;
+        memory.code_address = RUNTIME_ADDRESS + offset;
+        memory.code_length = sequence_length;
+        passed &= VerifyBranch(decoder, &branches[i], kind, &memory);
+        offset += sequence_length;
+    }
+    passed &= (offset == length) && (length == 5 + 16 + 14 + 16);
+
+    ZYAN_PRINTF("%s: back to back sequences\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(void)
+{
+    ZydisJitConstant constant;
+    constant.reg = ZYDIS_REGISTER_EAX;
+    constant.value = 0;
+    ZydisJitBranch branch;
+    branch.mnemonic = ZYDIS_MNEMONIC_RET;
+    branch.target = 0;
+
+    ZyanU8 length;
+    const ZyanBool passed =
+        (ZydisJitGetConstantLength(&constant, RUNTIME_ADDRESS, ZYAN_FALSE, ZYAN_NULL,
+            &length) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisJitGetBranchLength(&branch, RUNTIME_ADDRESS, ZYAN_NULL, ZYAN_NULL,
+            &length) == ZYAN_STATUS_INVALID_ARGUMENT);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+        ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestConstants(&decoder);
+    all_passed &= TestBranches(&decoder);
+    all_passed &= TestSequences(&decoder);
+    all_passed &= TestArguments();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,343 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the linter (`ZydisLinterLint`) with hand-assembled code.
+ *
+ * Every case places a few instructions at fixed offsets of a `nop`-filled buffer and lists the
+ * exact hazards that have to be reported, including the 32- and 64-byte boundary edge cases.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+#include "ZydisToolsShared.h"
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The size of the code buffer of every test case.
+ */
+#define CODE_SIZE 128
+
+/**
+ * The default runtime address of the code buffer.
+ */
+#define RUNTIME_ADDRESS 0x1000
+
+#define JCC     ZYDIS_LINTER_HAZARD_JCC_ERRATUM
+#define LCP     ZYDIS_LINTER_HAZARD_LCP_STALL
+#define LOOP    ZYDIS_LINTER_HAZARD_UNALIGNED_LOOP
+#define FUSION  ZYDIS_LINTER_HAZARD_SPLIT_FUSION
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Places an instruction at an offset of the code buffer. A zero length ends the list.
+ */
+typedef struct Placement_
+{
+    ZyanU8 offset;
+    ZyanU8 length;
+    ZyanU8 bytes[8];
+} Placement;
+
+/**
+ * Describes an expected hazard. Offsets are relative to the start of the code buffer. A zero
+ * length ends the list.
+ */
+typedef struct ExpectedHazard_
+{
+    ZydisLinterHazardType type;
+    ZyanU8 offset;
+    ZyanU8 length;
+    ZyanU8 target;
+    ZyanU32 padding;
+} ExpectedHazard;
+
+typedef struct TestCase_
+{
+    const char* name;
+    ZyanU64 runtime_address;
+    ZyanU32 loop_alignment;
+    ZyanU32 disabled_hazards;
+    Placement code[4];
+    ExpectedHazard hazards[4];
+} TestCase;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const TestCase TEST_CASES[] =
+{
+    // JCC erratum: jumps, calls and returns that cross or end on a 32-byte boundary
+    { "jmp ending at a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 30, 2, { 0xEB, 0x10 } } },
+        { { JCC, 30, 2, 30, 2 } } },
+    { "jmp ending before a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 29, 2, { 0xEB, 0x10 } } },
+        { { 0 } } },
+    { "jmp crossing a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 31, 2, { 0xEB, 0x10 } } },
+        { { JCC, 31, 2, 31, 1 } } },
+    { "jmp starting at a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 32, 2, { 0xEB, 0x10 } } },
+        { { 0 } } },
+    { "call ending at a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 27, 5, { 0xE8, 0x00, 0x00, 0x00, 0x00 } } },
+        { { JCC, 27, 5, 27, 5 } } },
+    { "ret ending at a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 31, 1, { 0xC3 } } },
+        { { JCC, 31, 1, 31, 1 } } },
+    { "boundary depends on the runtime address", RUNTIME_ADDRESS + 2, 16, 0,
+        { { 28, 2, { 0xEB, 0x10 } } },
+        { { JCC, 28, 2, 28, 2 } } },
+    { "JCC erratum disabled", RUNTIME_ADDRESS, 16, 1 << JCC,
+        { { 30, 2, { 0xEB, 0x10 } } },
+        { { 0 } } },
+
+    // JCC erratum: macro-fused pairs are treated as a single jump
+    { "cmp/jz ending at a 32-byte boundary", RUNTIME_ADDRESS, 16, 0,
+        { { 28, 2, { 0x39, 0xC8 } }, { 30, 2, { 0x74, 0x10 } } },
+        { { JCC, 28, 4, 28, 4 } } },
+    { "cmp/jz crossing a 32-byte boundary in the jump", RUNTIME_ADDRESS, 16, 0,
+        { { 29, 2, { 0x39, 0xC8 } }, { 31, 2, { 0x74, 0x10 } } },
+        { { JCC, 29, 4, 29, 3 } } },
+    { "cmp/jz crossing a 32-byte boundary between the instructions", RUNTIME_ADDRESS, 16, 0,
+        { { 30, 2, { 0x39, 0xC8 } }, { 32, 2, { 0x74, 0x10 } } },
+        { { JCC, 30, 4, 30, 2 } } },
+    { "mov/jz is not fused", RUNTIME_ADDRESS, 16, 0,
+        { { 30, 2, { 0x89, 0xC8 } }, { 32, 2, { 0x74, 0x10 } } },
+        { { 0 } } },
+
+    // Macro-fusible pairs split across a 64-byte cache line
+    { "cmp/jz split at a cache line", RUNTIME_ADDRESS, 16, 0,
+        { { 62, 2, { 0x39, 0xC8 } }, { 64, 2, { 0x74, 0x10 } } },
+        { { JCC, 62, 4, 62, 2 }, { FUSION, 62, 4, 62, 2 } } },
+    { "dec/jnz split at a cache line", RUNTIME_ADDRESS, 16, 0,
+        { { 62, 2, { 0xFF, 0xC9 } }, { 64, 2, { 0x75, 0x10 } } },
+        { { JCC, 62, 4, 62, 2 }, { FUSION, 62, 4, 62, 2 } } },
+    { "cmp/jz split at a cache line, JCC erratum disabled", RUNTIME_ADDRESS, 16, 1 << JCC,
+        { { 62, 2, { 0x39, 0xC8 } }, { 64, 2, { 0x74, 0x10 } } },
+        { { FUSION, 62, 4, 62, 2 } } },
+    { "cmp/jz with the jump crossing a cache line", RUNTIME_ADDRESS, 16, 0,
+        { { 61, 2, { 0x39, 0xC8 } }, { 63, 2, { 0x74, 0x10 } } },
+        { { JCC, 61, 4, 61, 3 } } },
+    { "cmp mem, imm/jz is not fused", RUNTIME_ADDRESS, 16, 0,
+        { { 61, 3, { 0x83, 0x38, 0x01 } }, { 64, 2, { 0x74, 0x10 } } },
+        { { 0 } } },
+    { "cmp/jrcxz is not fused", RUNTIME_ADDRESS, 16, 0,
+        { { 62, 2, { 0x39, 0xC8 } }, { 64, 2, { 0xE3, 0x10 } } },
+        { { 0 } } },
+
+    // Length-changing prefixes
+    { "add ax, imm16", RUNTIME_ADDRESS, 16, 0,
+        { { 0, 4, { 0x66, 0x05, 0x34, 0x12 } } },
+        { { LCP, 0, 4, 0, 0 } } },
+    { "add ax, imm16 (modrm)", RUNTIME_ADDRESS, 16, 0,
+        { { 0, 5, { 0x66, 0x81, 0xC0, 0x34, 0x12 } } },
+        { { LCP, 0, 5, 0, 0 } } },
+    { "mov word ptr [rax], imm16", RUNTIME_ADDRESS, 16, 0,
+        { { 0, 5, { 0x66, 0xC7, 0x00, 0x34, 0x12 } } },
+        { { LCP, 0, 5, 0, 0 } } },
+    { "push imm16", RUNTIME_ADDRESS, 16, 0,
+        { { 8, 4, { 0x66, 0x68, 0x34, 0x12 } } },
+        { { LCP, 8, 4, 8, 0 } } },
+    { "no length-changing prefix", RUNTIME_ADDRESS, 16, 0,
+        { { 0, 4, { 0x66, 0xB8, 0x34, 0x12 } }, { 8, 4, { 0x66, 0x83, 0xC0, 0x01 } },
+          { 16, 5, { 0x05, 0x34, 0x12, 0x00, 0x00 } }, { 40, 4, { 0x66, 0xC2, 0x08, 0x00 } } },
+        { { 0 } } },
+
+    // Unaligned loop heads
+    { "unaligned loop head", RUNTIME_ADDRESS, 16, 0,
+        { { 3, 2, { 0xFF, 0xC9 } }, { 5, 2, { 0x75, 0xFC } } },
+        { { LOOP, 5, 2, 3, 13 } } },
+    { "aligned loop head", RUNTIME_ADDRESS, 16, 0,
+        { { 16, 2, { 0xFF, 0xC9 } }, { 18, 2, { 0x75, 0xFC } } },
+        { { 0 } } },
+    { "loop head unaligned to 32 bytes", RUNTIME_ADDRESS, 32, 0,
+        { { 16, 2, { 0xFF, 0xC9 } }, { 18, 2, { 0x75, 0xFC } } },
+        { { LOOP, 18, 2, 16, 16 } } },
+    { "backward jmp rel32", RUNTIME_ADDRESS, 16, 0,
+        { { 40, 5, { 0xE9, 0xD8, 0xFF, 0xFF, 0xFF } } },
+        { { LOOP, 40, 5, 5, 11 } } },
+    { "forward branch", RUNTIME_ADDRESS, 16, 0,
+        { { 3, 2, { 0x75, 0x10 } } },
+        { { 0 } } }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanStatus CollectHazard(const ZydisLinterHazard* hazard, void* user_data)
+{
+    return ResultListPush((ResultList*)user_data, hazard);
+}
+
+static void BuildCode(const Placement* code, ZyanU8* buffer)
+{
+    ZYAN_MEMSET(buffer, 0x90, CODE_SIZE);
+    for (const Placement* placement = code; placement->length; ++placement)
+    {
+        ZYAN_MEMCPY(buffer + placement->offset, placement->bytes, placement->length);
+    }
+}
+
+static void GetCaseInfo(const void* test_case, const char** name, size_t* expected_count)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    *name = test->name;
+    *expected_count = 0;
+    while (test->hazards[*expected_count].length)
+    {
+        ++*expected_count;
+    }
+}
+
+static ZyanStatus RunCase(void* context, const void* test_case, ResultList* list)
+{
+    ZYAN_UNUSED(context);
+    const TestCase* test = (const TestCase*)test_case;
+
+    ZydisLinter linter;
+    ZYAN_CHECK(ZydisLinterInit(&linter, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64));
+    ZYAN_CHECK(ZydisLinterSetLoopAlignment(&linter, test->loop_alignment));
+    for (int type = 0; type <= ZYDIS_LINTER_HAZARD_MAX_VALUE; ++type)
+    {
+        if (test->disabled_hazards & (1 << type))
+        {
+            ZYAN_CHECK(ZydisLinterEnableHazard(&linter, (ZydisLinterHazardType)type, ZYAN_FALSE));
+        }
+    }
+
+    ZyanU8 buffer[CODE_SIZE];
+    BuildCode(test->code, buffer);
+    return ZydisLinterLint(&linter, buffer, sizeof(buffer), test->runtime_address,
+        &CollectHazard, list);
+}
+
+static ZyanBool CompareHazard(const void* test_case, const void* result, size_t index)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    const ZydisLinterHazard* hazard = (const ZydisLinterHazard*)result;
+    const ExpectedHazard* expected = &test->hazards[index];
+    const ZyanU64 address = test->runtime_address + expected->offset;
+    if ((hazard->type == expected->type) && (hazard->offset == expected->offset) &&
+        (hazard->address == address) && (hazard->length == expected->length) &&
+        (hazard->target == test->runtime_address + expected->target) &&
+        (hazard->padding == expected->padding))
+    {
+        return ZYAN_TRUE;
+    }
+
+    ZYAN_PRINTF("FAILED: %s: expected hazard %d at +%u (length %u, target +%u, padding %u), " \
+        "got %d at +%u (length %u, target 0x%" PRIX64 ", padding %u)\n", test->name,
+        expected->type, expected->offset, expected->length, expected->target, expected->padding,
+        hazard->type, (unsigned)hazard->offset, hazard->length, hazard->target, hazard->padding);
+    return ZYAN_FALSE;
+}
+
+static void PrintHazard(const void* result)
+{
+    const ZydisLinterHazard* hazard = (const ZydisLinterHazard*)result;
+    ZYAN_PRINTF("  hazard %d at +%u (length %u)\n", hazard->type, (unsigned)hazard->offset,
+        hazard->length);
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestCases(void)
+{
+    const TestTable table =
+    {
+        "hand-assembled cases", TEST_CASES, sizeof(TestCase), ZYAN_ARRAY_LENGTH(TEST_CASES),
+        sizeof(ZydisLinterHazard), ZYAN_NULL, &GetCaseInfo, &RunCase, &CompareHazard,
+        &PrintHazard
+    };
+    return RunTestTable(&table);
+}
+
+static ZyanBool TestCallbackStatus(void)
+{
+    // Both hazards of the split pair are reported for the same instruction, the first status
+    // code other than `ZYAN_STATUS_SUCCESS` has to stop the linter
+    static const Placement code[] =
+    {
+        { 62, 2, { 0x39, 0xC8 } }, { 64, 2, { 0x74, 0x10 } }, { 0 }
+    };
+
+    ZydisLinter linter;
+    ZyanU8 buffer[CODE_SIZE];
+    BuildCode(code, buffer);
+    ResultList list;
+    ResultListInit(&list, sizeof(ZydisLinterHazard), 1);
+    const ZyanBool passed =
+        ZYAN_SUCCESS(ZydisLinterInit(&linter, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64)) &&
+        (ZydisLinterLint(&linter, buffer, sizeof(buffer), RUNTIME_ADDRESS, &CollectHazard,
+            &list) == ZYAN_STATUS_FAILED) &&
+        (list.results.count == 1) &&
+        (ZydisLinterSetLoopAlignment(&linter, 24) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisLinterEnableHazard(&linter,
+            (ZydisLinterHazardType)(ZYDIS_LINTER_HAZARD_MAX_VALUE + 1), ZYAN_TRUE) ==
+            ZYAN_STATUS_INVALID_ARGUMENT);
+    ResultListDestroy(&list);
+
+    ZYAN_PRINTF("%s: callback status and invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestCases();
+    all_passed &= TestCallbackStatus();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,500 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Stress tests live patching (`ZydisPatchApply`) by repeatedly rewriting instructions while other
+ * threads keep executing them.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of threads executing the patched code.
+ */
+#define EXECUTOR_COUNT 3
+
+/**
+ * The duration of every stress test in milliseconds.
+ */
+#define STRESS_DURATION_MS 250
+
+/**
+ * The size of the code slot used by the stress tests.
+ */
+#define SLOT_SIZE 0x40000
+
+/**
+ * The offsets of the two branch targets. They are far enough apart to change more than one byte
+ * of the branch displacement.
+ */
+#define TARGET_A_OFFSET 0x00000
+#define TARGET_B_OFFSET 0x20100
+
+/**
+ * The offset of the first patched instruction.
+ */
+#define PATCH_SITE_OFFSET 0x10000
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+typedef ZyanU32 (*TestFunction)(void);
+
+static void InitRequest(ZydisEncoderRequest* request, ZydisMnemonic mnemonic)
+{
+    ZYAN_MEMSET(request, 0, sizeof(*request));
+    request->mnemonic = mnemonic;
+    request->machine_mode = ZYDIS_MACHINE_MODE_LONG_64;
+}
+
+static ZyanBool EmitMovEaxImm(ZydisCodeSlot* slot, ZyanU32 value)
+{
+    ZydisEncoderRequest request;
+    InitRequest(&request, ZYDIS_MNEMONIC_MOV);
+    request.operand_count = 2;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+    request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+    request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[1].imm.u = value;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitRet(ZydisCodeSlot* slot)
+{
+    ZydisEncoderRequest request;
+    InitRequest(&request, ZYDIS_MNEMONIC_RET);
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitInt3(ZydisCodeSlot* slot)
+{
+    ZydisEncoderRequest request;
+    InitRequest(&request, ZYDIS_MNEMONIC_INT3);
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitJmpRel32(ZydisCodeSlot* slot, ZyanU64 target)
+{
+    ZydisEncoderRequest request;
+    InitRequest(&request, ZYDIS_MNEMONIC_JMP);
+    request.branch_type = ZYDIS_BRANCH_TYPE_NEAR;
+    request.branch_width = ZYDIS_BRANCH_WIDTH_32;
+    request.operand_count = 1;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[0].imm.u = target;
+    return ZYAN_SUCCESS(ZydisCodeSlotEmit(slot, &request));
+}
+
+static ZyanBool EmitAt(ZydisCodeSlot* slot, ZyanUSize offset)
+{
+    // Moves the emit position of the slot. The gap keeps the fill byte.
+    if (offset < slot->length)
+    {
+        return ZYAN_FALSE;
+    }
+    slot->length = offset;
+    return ZYAN_TRUE;
+}
+
+static ZyanU64 GetAddress(const ZydisCodeSlot* slot, ZyanUSize offset)
+{
+    ZyanU64 address = 0;
+    ZydisCodeSlotGetRuntimeAddress(slot, offset, &address);
+    return address;
+}
+
+static TestFunction GetFunction(const ZydisCodeSlot* slot, ZyanUSize offset)
+{
+    // Converting between object and function pointers is not allowed in ISO C
+    const ZyanU8* code = slot->executable + offset;
+    TestFunction function;
+    ZYAN_MEMCPY(&function, &code, sizeof(function));
+    return function;
+}
+
+static ZyanBool DecodeAt(const ZydisCodeSlot* slot, ZyanUSize offset,
+    ZydisDecodedInstruction* instruction)
+{
+    ZydisDecoder decoder;
+    ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+    return ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL,
+        slot->writable + offset, slot->size - offset, instruction));
+}
+
+static ZyanU64 GetTimeMs(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (ZyanU64)time.tv_sec * 1000 + (ZyanU64)time.tv_nsec / 1000000;
+}
+
+/* ============================================================================================== */
+/* Executors                                                                                      */
+/* ============================================================================================== */
+
+typedef struct Executor_
+{
+    pthread_t thread;
+    TestFunction function;
+    ZyanU32 expected[2];
+    ZyanU32* stop;
+    ZyanU64 calls;
+    ZyanU64 failures;
+} Executor;
+
+static void* ExecutorMain(void* argument)
+{
+    Executor* const executor = (Executor*)argument;
+    while (!__atomic_load_n(executor->stop, __ATOMIC_ACQUIRE))
+    {
+        const ZyanU32 value = executor->function();
+        if ((value != executor->expected[0]) && (value != executor->expected[1]))
+        {
+            ++executor->failures;
+        }
+        ++executor->calls;
+    }
+    return ZYAN_NULL;
+}
+
+/**
+ * Runs the given patches alternately while `EXECUTOR_COUNT` threads call `function`.
+ */
+static ZyanBool RunStress(const char* name, const ZydisCodeSlot* slot, ZyanUSize site_offset,
+    TestFunction function, const ZydisPatch* patches, ZydisPatchStrategy strategy,
+    const ZyanU32 expected[2])
+{
+    ZyanBool passed = (patches[0].strategy == strategy) && (patches[1].strategy == strategy);
+
+    ZyanU32 stop = 0;
+    Executor executors[EXECUTOR_COUNT];
+    ZyanUSize started = 0;
+    for (; passed && (started < EXECUTOR_COUNT); ++started)
+    {
+        Executor* const executor = &executors[started];
+        executor->function = function;
+        executor->expected[0] = expected[0];
+        executor->expected[1] = expected[1];
+        executor->stop = &stop;
+        executor->calls = 0;
+        executor->failures = 0;
+        if (pthread_create(&executor->thread, ZYAN_NULL, &ExecutorMain, executor) != 0)
+        {
+            passed = ZYAN_FALSE;
+            break;
+        }
+    }
+
+    ZyanU64 applied = 0;
+    const ZyanU64 end = GetTimeMs() + STRESS_DURATION_MS;
+    while (passed && (GetTimeMs() < end))
+    {
+        const ZydisPatch* const patch = &patches[applied & 1];
+        passed = ZYAN_SUCCESS(ZydisPatchApply(patch, slot->writable + site_offset));
+        ++applied;
+    }
+
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    ZyanU64 calls = 0;
+    for (ZyanUSize i = 0; i < started; ++i)
+    {
+        pthread_join(executors[i].thread, ZYAN_NULL);
+        calls += executors[i].calls;
+        passed &= (executors[i].failures == 0);
+    }
+    passed &= (calls > 0) && (applied > 1);
+
+    ZYAN_PRINTF("%s: %s (%llu patches, %llu calls)\n", passed ? "PASSED" : "FAILED", name,
+        (unsigned long long)applied, (unsigned long long)calls);
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestStrategy(void)
+{
+    static const struct
+    {
+        ZyanU64 address;
+        ZyanUSize size;
+        ZydisPatchStrategy strategy;
+    } cases[] =
+    {
+        { 0x1000, 0, ZYDIS_PATCH_STRATEGY_NONE       },
+        { 0x1000, 4, ZYDIS_PATCH_STRATEGY_ATOMIC_4   },
+        { 0x1001, 3, ZYDIS_PATCH_STRATEGY_ATOMIC_4   },
+        { 0x1001, 4, ZYDIS_PATCH_STRATEGY_ATOMIC_8   },
+        { 0x1004, 4, ZYDIS_PATCH_STRATEGY_ATOMIC_4   },
+        { 0x1000, 8, ZYDIS_PATCH_STRATEGY_ATOMIC_8   },
+        { 0x1006, 4, ZYDIS_PATCH_STRATEGY_BREAKPOINT },
+        { 0x1000, 9, ZYDIS_PATCH_STRATEGY_BREAKPOINT },
+    };
+
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(cases); ++i)
+    {
+        ZydisPatchStrategy strategy;
+        passed &= ZYAN_SUCCESS(ZydisPatchSelectStrategy(cases[i].address, cases[i].size,
+            &strategy)) && (strategy == cases[i].strategy);
+    }
+
+    ZYAN_PRINTF("%s: strategy\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestPrepare(void)
+{
+    ZydisDecoder decoder;
+    ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+    // jmp short +0x10
+    static const ZyanU8 jmp_short[] = { 0xEB, 0x10 };
+    // mov rax, qword ptr [rip+0x1000]
+    static const ZyanU8 mov_rip[] = { 0x48, 0x8B, 0x05, 0x00, 0x10, 0x00, 0x00 };
+    // add eax, ebx
+    static const ZyanU8 add[] = { 0x01, 0xD8 };
+
+    ZydisDecodedInstruction instruction;
+    ZydisPatch patch;
+    ZyanU8 offset = 0;
+    ZyanU8 size = 0;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL, jmp_short,
+            sizeof(jmp_short), &instruction)) &&
+        ZYAN_SUCCESS(ZydisPatchGetField(&instruction, &offset, &size)) &&
+        (offset == 1) && (size == 1) &&
+        ZYAN_SUCCESS(ZydisPatchPrepareRetarget(&patch, &instruction, jmp_short, 0x1000,
+            0x1000 + 2 - 128)) &&
+        (patch.bytes[1] == 0x80) && (patch.changed_offset == 1) && (patch.changed_length == 1) &&
+        (ZydisPatchPrepareRetarget(&patch, &instruction, jmp_short, 0x1000, 0x1000 + 2 + 128) ==
+            ZYAN_STATUS_OUT_OF_RANGE) &&
+        ZYAN_SUCCESS(ZydisPatchPrepareRetarget(&patch, &instruction, jmp_short, 0x1000,
+            0x1000 + 2 + 0x10)) &&
+        (patch.strategy == ZYDIS_PATCH_STRATEGY_NONE) &&
+
+        ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL, mov_rip,
+            sizeof(mov_rip), &instruction)) &&
+        ZYAN_SUCCESS(ZydisPatchGetField(&instruction, &offset, &size)) &&
+        (offset == 3) && (size == 4) &&
+        ZYAN_SUCCESS(ZydisPatchPrepareRetarget(&patch, &instruction, mov_rip, 0x1000,
+            0x1000 + 7 + 0x2000)) &&
+        (patch.bytes[4] == 0x20) && (patch.changed_offset == 4) && (patch.changed_length == 1) &&
+        (patch.strategy == ZYDIS_PATCH_STRATEGY_ATOMIC_4) &&
+
+        ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL, add, sizeof(add),
+            &instruction)) &&
+        (ZydisPatchGetField(&instruction, &offset, &size) == ZYAN_STATUS_NOT_FOUND);
+
+    // Replacing `mov rax, [rip+0x1000]` by `ret` pads with a 6-byte nop
+    ZydisEncoderRequest request;
+    InitRequest(&request, ZYDIS_MNEMONIC_RET);
+    passed = passed &&
+        ZYAN_SUCCESS(ZydisPatchPrepareReplace(&patch, mov_rip, sizeof(mov_rip), 0x1000,
+            &request)) &&
+        (patch.length == 7) && (patch.bytes[0] == 0xC3) && (patch.changed_offset == 0) &&
+        ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL, patch.bytes + 1, 6,
+            &instruction)) &&
+        (instruction.mnemonic == ZYDIS_MNEMONIC_NOP) && (instruction.length == 6);
+
+    // A replacement must not be longer than the original instruction
+    InitRequest(&request, ZYDIS_MNEMONIC_MOV);
+    request.operand_count = 2;
+    request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+    request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+    request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+    request.operands[1].imm.u = 1;
+    passed = passed &&
+        (ZydisPatchPrepareReplace(&patch, add, sizeof(add), 0x1000, &request) ==
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+
+    ZYAN_PRINTF("%s: prepare\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static volatile sig_atomic_t foreign_traps = 0;
+
+static void ForeignTrapHandler(int signal)
+{
+    (void)signal;
+    ++foreign_traps;
+}
+
+static ZyanBool TestForeignTrap(ZydisCodeSlot* slot)
+{
+    // Breakpoints that do not belong to a patch must reach the previously installed handler
+    slot->length = 0;
+    ZyanBool passed =
+        EmitInt3(slot) && EmitMovEaxImm(slot, 5) && EmitRet(slot) &&
+        (GetFunction(slot, 0)() == 5) && (foreign_traps == 1);
+
+    ZYAN_PRINTF("%s: foreign trap\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestRetarget(const char* name, ZydisCodeSlot* slot, ZyanUSize misalignment,
+    ZydisPatchStrategy strategy)
+{
+    // jmp rel32 to one of two functions returning 1 and 2
+    const ZyanUSize site = PATCH_SITE_OFFSET + misalignment;
+    const ZyanU64 target_a = GetAddress(slot, TARGET_A_OFFSET);
+    const ZyanU64 target_b = GetAddress(slot, TARGET_B_OFFSET);
+
+    ZydisDecodedInstruction instruction;
+    ZydisPatch patches[2];
+    ZyanBool passed =
+        EmitAt(slot, site) && EmitJmpRel32(slot, target_a) &&
+        (slot->length == site + 5) &&
+        DecodeAt(slot, site, &instruction) &&
+        ZYAN_SUCCESS(ZydisPatchPrepareRetarget(&patches[0], &instruction, slot->writable + site,
+            GetAddress(slot, site), target_b)) &&
+        ZYAN_SUCCESS(ZydisPatchPrepareRetarget(&patches[1], &instruction, patches[0].bytes,
+            GetAddress(slot, site), target_a));
+    if (!passed)
+    {
+        ZYAN_PRINTF("FAILED: %s\n", name);
+        return ZYAN_FALSE;
+    }
+
+    static const ZyanU32 expected[2] = { 1, 2 };
+    passed = RunStress(name, slot, site, GetFunction(slot, site), patches, strategy, expected);
+    slot->length = site + 5;
+    return passed;
+}
+
+static ZyanBool TestReplace(ZydisCodeSlot* slot)
+{
+    // `mov eax, 7` alternating with `xor eax, eax` and a 3-byte nop, crossing an 8-byte boundary
+    const ZyanUSize site = PATCH_SITE_OFFSET + 0x100 + 6;
+    const ZyanU64 address = GetAddress(slot, site);
+
+    ZydisEncoderRequest request;
+    ZydisPatch patches[2];
+    ZyanBool passed =
+        EmitAt(slot, site) && EmitMovEaxImm(slot, 7) && EmitRet(slot) &&
+        (slot->length == site + 6);
+    if (passed)
+    {
+        InitRequest(&request, ZYDIS_MNEMONIC_XOR);
+        request.operand_count = 2;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[1].reg.value = ZYDIS_REGISTER_EAX;
+        passed = ZYAN_SUCCESS(ZydisPatchPrepareReplace(&patches[0], slot->writable + site, 5,
+            address, &request));
+    }
+    if (passed)
+    {
+        InitRequest(&request, ZYDIS_MNEMONIC_MOV);
+        request.operand_count = 2;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_REGISTER;
+        request.operands[0].reg.value = ZYDIS_REGISTER_EAX;
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        request.operands[1].imm.u = 7;
+        passed = ZYAN_SUCCESS(ZydisPatchPrepareReplace(&patches[1], patches[0].bytes, 5,
+            address, &request));
+    }
+    if (!passed)
+    {
+        ZYAN_PRINTF("FAILED: replace\n");
+        return ZYAN_FALSE;
+    }
+
+    static const ZyanU32 expected[2] = { 0, 7 };
+    return RunStress("replace", slot, site, GetFunction(slot, site), patches,
+        ZYDIS_PATCH_STRATEGY_BREAKPOINT, expected);
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestStrategy();
+    all_passed &= TestPrepare();
+
+    signal(SIGTRAP, &ForeignTrapHandler);
+    if (!ZYAN_SUCCESS(ZydisPatchInitRuntime()))
+    {
+        ZYAN_PRINTF("SKIPPED: runtime (membarrier is not supported)\n");
+        return all_passed ? 0 : 1;
+    }
+
+    ZydisCodeBuffer buffer;
+    ZydisCodeSlot slot;
+    ZydisCodeSlot scratch;
+    if (!ZYAN_SUCCESS(ZydisCodeBufferInit(&buffer, 0)) ||
+        !ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, SLOT_SIZE, &slot)) ||
+        !ZYAN_SUCCESS(ZydisCodeBufferAllocate(&buffer, 64, &scratch)) ||
+        !EmitAt(&slot, TARGET_A_OFFSET) || !EmitMovEaxImm(&slot, 1) || !EmitRet(&slot))
+    {
+        ZYAN_PRINTF("FAILED: setup\n");
+        return 1;
+    }
+
+    all_passed &= TestForeignTrap(&scratch);
+
+    // Both targets must exist before any branch is emitted, so the sites are placed in between
+    ZydisCodeSlot target_b = slot;
+    target_b.length = TARGET_B_OFFSET;
+    all_passed &= EmitMovEaxImm(&target_b, 2) && EmitRet(&target_b);
+
+    all_passed &= TestRetarget("retarget (atomic 4)", &slot, 3, ZYDIS_PATCH_STRATEGY_ATOMIC_4);
+    all_passed &= TestRetarget("retarget (atomic 8)", &slot, 0x40 + 1,
+        ZYDIS_PATCH_STRATEGY_ATOMIC_8);
+    all_passed &= TestRetarget("retarget (breakpoint)", &slot, 0x80 + 5,
+        ZYDIS_PATCH_STRATEGY_BREAKPOINT);
+    all_passed &= TestReplace(&slot);
+
+    ZydisCodeBufferDestroy(&buffer);
+
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
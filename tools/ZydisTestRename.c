@@ -0,0 +1,601 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests `ZydisRenameInstruction` and `ZydisRenameFunction`.
+ *
+ * The renamed code is decoded again and compared to the original code instruction by
+ * instruction: registers have to be renamed, all other operands have to be unchanged and relative
+ * operands have to follow their targets.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+#define RUNTIME_ADDRESS 0x140001000ULL
+
+/**
+ * The maximum number of instructions of a test function.
+ */
+#define MAX_INSTRUCTIONS 256
+
+/**
+ * The maximum length of a test function.
+ */
+#define MAX_FUNCTION_LENGTH 512
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct RenamePair_
+{
+    ZydisRegister from;
+    ZydisRegister to;
+} RenamePair;
+
+typedef struct TestCase_
+{
+    const char* name;
+    RenamePair pairs[2];
+    ZyanU8 length;
+    ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    ZyanStatus status;
+    ZyanU8 new_length;
+} TestCase;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+#define RAX ZYDIS_REGISTER_RAX
+#define RCX ZYDIS_REGISTER_RCX
+#define RDX ZYDIS_REGISTER_RDX
+#define RBX ZYDIS_REGISTER_RBX
+#define RSP ZYDIS_REGISTER_RSP
+#define RBP ZYDIS_REGISTER_RBP
+#define RSI ZYDIS_REGISTER_RSI
+#define RDI ZYDIS_REGISTER_RDI
+#define R8  ZYDIS_REGISTER_R8
+#define R9  ZYDIS_REGISTER_R9
+#define R10 ZYDIS_REGISTER_R10
+#define R12 ZYDIS_REGISTER_R12
+#define R13 ZYDIS_REGISTER_R13
+
+#define SUCCESS     ZYAN_STATUS_SUCCESS
+#define IMPOSSIBLE  ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION
+
+static const TestCase TEST_CASES[] =
+{
+    // mov rax, rbx
+    { "in place", { { RAX, RCX } }, 3, { 0x48, 0x89, 0xD8 }, SUCCESS, 3 },
+    { "swap", { { RAX, RBX }, { RBX, RAX } }, 3, { 0x48, 0x89, 0xD8 }, SUCCESS, 3 },
+    { "unrelated register", { { RDX, RSI } }, 3, { 0x48, 0x89, 0xD8 }, SUCCESS, 3 },
+    { "existing rex", { { RBX, R10 } }, 3, { 0x48, 0x89, 0xD8 }, SUCCESS, 3 },
+    // mov eax, ebx
+    { "missing rex", { { RBX, R8 } }, 2, { 0x89, 0xD8 }, SUCCESS, 3 },
+    // mov al, bl
+    { "low byte requiring rex", { { RBX, RSI } }, 2, { 0x88, 0xD8 }, SUCCESS, 3 },
+    // mov sil, al
+    { "low byte with rex", { { RSI, RBX } }, 3, { 0x40, 0x88, 0xC6 }, SUCCESS, 3 },
+    // mov ah, bl
+    { "high byte", { { RBX, RDX } }, 2, { 0x88, 0xDC }, SUCCESS, 2 },
+    // mov bl, ah
+    { "high byte and rex", { { RBX, RDI } }, 2, { 0x88, 0xE3 }, IMPOSSIBLE, 0 },
+    { "high byte without high byte", { { RAX, R8 } }, 2, { 0x88, 0xE3 }, IMPOSSIBLE, 0 },
+    // mov rax, [rbx]
+    { "base 4 requires sib", { { RBX, RSP } }, 3, { 0x48, 0x8B, 0x03 }, SUCCESS, 4 },
+    { "base 5 requires displacement", { { RBX, RBP } }, 3, { 0x48, 0x8B, 0x03 }, SUCCESS, 4 },
+    { "base 13 requires displacement", { { RBX, R13 } }, 3, { 0x48, 0x8B, 0x03 }, SUCCESS, 4 },
+    // mov rax, [rsp]
+    { "sib without index", { { RSP, RBX } }, 4, { 0x48, 0x8B, 0x04, 0x24 }, SUCCESS, 4 },
+    // mov rax, [rbx+rcx*2]
+    { "sib base 5 requires displacement", { { RBX, RBP } }, 4, { 0x48, 0x8B, 0x04, 0x4B },
+        SUCCESS, 5 },
+    { "sib base 12", { { RBX, R12 } }, 4, { 0x48, 0x8B, 0x04, 0x4B }, SUCCESS, 4 },
+    { "sib index 4", { { RCX, RSP } }, 4, { 0x48, 0x8B, 0x04, 0x4B }, IMPOSSIBLE, 0 },
+    { "sib index 12", { { RCX, R12 } }, 4, { 0x48, 0x8B, 0x04, 0x4B }, SUCCESS, 4 },
+    // push rbx
+    { "opcode register", { { RBX, RDI } }, 1, { 0x53 }, SUCCESS, 1 },
+    { "opcode register extension", { { RBX, R9 } }, 1, { 0x53 }, SUCCESS, 2 },
+    // mul rbx
+    { "hidden register", { { RAX, RCX } }, 3, { 0x48, 0xF7, 0xE3 }, IMPOSSIBLE, 0 },
+    { "visible register next to hidden", { { RBX, RCX } }, 3, { 0x48, 0xF7, 0xE3 }, SUCCESS, 3 },
+    // rep movsb
+    { "hidden memory", { { RSI, RBX } }, 2, { 0xF3, 0xA4 }, IMPOSSIBLE, 0 },
+    // lea rax, [rip+0x10]
+    { "rip-relative", { { RAX, R8 } }, 7, { 0x48, 0x8D, 0x05, 0x10, 0x00, 0x00, 0x00 },
+        SUCCESS, 7 },
+    // jz +0x10
+    { "relative branch", { { RAX, RCX } }, 2, { 0x74, 0x10 }, SUCCESS, 2 },
+    // vaddps xmm0, xmm1, xmm2
+    { "vvvv", { { ZYDIS_REGISTER_XMM1, ZYDIS_REGISTER_XMM9 } }, 4, { 0xC5, 0xF0, 0x58, 0xC2 },
+        SUCCESS, 4 },
+    { "2-byte vex without b", { { ZYDIS_REGISTER_XMM2, ZYDIS_REGISTER_XMM9 } }, 4,
+        { 0xC5, 0xF0, 0x58, 0xC2 }, SUCCESS, 5 },
+    { "vex to evex", { { ZYDIS_REGISTER_XMM0, ZYDIS_REGISTER_XMM17 } }, 4,
+        { 0xC5, 0xF0, 0x58, 0xC2 }, SUCCESS, 6 },
+    // vaddps xmm17, xmm1, xmm2
+    { "evex", { { ZYDIS_REGISTER_XMM17, ZYDIS_REGISTER_XMM30 },
+        { ZYDIS_REGISTER_XMM2, ZYDIS_REGISTER_XMM18 } }, 6, { 0x62, 0xE1, 0x74, 0x08, 0x58, 0xCA },
+        SUCCESS, 6 },
+    // vblendvps xmm0, xmm1, xmm2, xmm3
+    { "is4", { { ZYDIS_REGISTER_XMM3, ZYDIS_REGISTER_XMM12 } }, 6,
+        { 0xC4, 0xE3, 0x71, 0x4A, 0xC2, 0x30 }, SUCCESS, 6 }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+/**
+ * Returns the new absolute target of a relative operand of the original function.
+ */
+static ZyanU64 MapTarget(ZyanU64 target, const ZyanUSize* old_offsets,
+    const ZyanUSize* new_offsets, ZyanUSize count, ZyanUSize length, ZyanUSize new_length)
+{
+    if ((target < RUNTIME_ADDRESS) || (target > RUNTIME_ADDRESS + length))
+    {
+        return target;
+    }
+    if (target == RUNTIME_ADDRESS + length)
+    {
+        return RUNTIME_ADDRESS + new_length;
+    }
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        if (RUNTIME_ADDRESS + old_offsets[i] == target)
+        {
+            return RUNTIME_ADDRESS + new_offsets[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Collects the visible operands of an instruction, skipping the `k0` mask register that
+ * `EVEX` adds when a `VEX` instruction is encoded again.
+ */
+static ZyanU8 CollectOperands(const ZydisDecodedInstruction* instruction,
+    const ZydisDecodedOperand* operands, ZyanBool skip_mask, const ZydisDecodedOperand** result)
+{
+    ZyanU8 count = 0;
+    for (ZyanU8 i = 0; i < instruction->operand_count_visible; ++i)
+    {
+        if (skip_mask && (operands[i].type == ZYDIS_OPERAND_TYPE_REGISTER) &&
+            (operands[i].reg.value == ZYDIS_REGISTER_K0))
+        {
+            continue;
+        }
+        result[count++] = &operands[i];
+    }
+    return count;
+}
+
+/**
+ * Decodes the original and the renamed function and compares them instruction by instruction.
+ */
+static ZyanBool VerifyFunction(const ZydisDecoder* decoder, const ZydisRenameMap* map,
+    const ZyanU8* code, ZyanUSize length, const ZyanU8* renamed, ZyanUSize new_length)
+{
+    static ZyanUSize old_offsets[MAX_INSTRUCTIONS];
+    static ZyanUSize new_offsets[MAX_INSTRUCTIONS];
+    ZydisDecodedInstruction old_instruction;
+    ZydisDecodedInstruction new_instruction;
+    ZydisDecodedOperand old_operands[ZYDIS_MAX_OPERAND_COUNT];
+    ZydisDecodedOperand new_operands[ZYDIS_MAX_OPERAND_COUNT];
+
+    // Both functions have to consist of the same number of instructions
+    ZyanUSize count = 0;
+    ZyanUSize old_offset = 0;
+    ZyanUSize new_offset = 0;
+    while ((old_offset < length) && (new_offset < new_length) && (count < MAX_INSTRUCTIONS))
+    {
+        if (ZYAN_FAILED(ZydisDecoderDecodeInstruction(decoder, ZYAN_NULL, code + old_offset,
+                length - old_offset, &old_instruction)) ||
+            ZYAN_FAILED(ZydisDecoderDecodeInstruction(decoder, ZYAN_NULL,
+                renamed + new_offset, new_length - new_offset, &new_instruction)))
+        {
+            return ZYAN_FALSE;
+        }
+        old_offsets[count] = old_offset;
+        new_offsets[count] = new_offset;
+        old_offset += old_instruction.length;
+        new_offset += new_instruction.length;
+        ++count;
+    }
+    if ((old_offset != length) || (new_offset != new_length))
+    {
+        return ZYAN_FALSE;
+    }
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const ZyanU64 old_address = RUNTIME_ADDRESS + old_offsets[i];
+        const ZyanU64 new_address = RUNTIME_ADDRESS + new_offsets[i];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, code + old_offsets[i],
+                length - old_offsets[i], &old_instruction, old_operands)) ||
+            ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, renamed + new_offsets[i],
+                new_length - new_offsets[i], &new_instruction, new_operands)) ||
+            (old_instruction.mnemonic != new_instruction.mnemonic))
+        {
+            return ZYAN_FALSE;
+        }
+
+        const ZydisDecodedOperand* old_visible[ZYDIS_MAX_OPERAND_COUNT];
+        const ZydisDecodedOperand* new_visible[ZYDIS_MAX_OPERAND_COUNT];
+        const ZyanBool skip_mask =
+            (old_instruction.encoding == ZYDIS_INSTRUCTION_ENCODING_VEX) &&
+            (new_instruction.encoding == ZYDIS_INSTRUCTION_ENCODING_EVEX);
+        const ZyanU8 operand_count = CollectOperands(&old_instruction, old_operands, ZYAN_FALSE,
+            old_visible);
+        if (CollectOperands(&new_instruction, new_operands, skip_mask, new_visible) !=
+            operand_count)
+        {
+            return ZYAN_FALSE;
+        }
+
+        for (ZyanU8 j = 0; j < operand_count; ++j)
+        {
+            const ZydisDecodedOperand* const old_operand = old_visible[j];
+            const ZydisDecodedOperand* const new_operand = new_visible[j];
+            if (old_operand->type != new_operand->type)
+            {
+                return ZYAN_FALSE;
+            }
+
+            ZydisRegister expected;
+            ZyanU64 old_target;
+            ZyanU64 new_target;
+            switch (old_operand->type)
+            {
+            case ZYDIS_OPERAND_TYPE_REGISTER:
+                if (ZYAN_FAILED(ZydisRenameMapRegister(map, old_operand->reg.value,
+                        &expected)) ||
+                    (new_operand->reg.value != expected))
+                {
+                    return ZYAN_FALSE;
+                }
+                break;
+            case ZYDIS_OPERAND_TYPE_MEMORY:
+                // The default segment depends on the base register, so only overrides are
+                // compared
+                if (ZYAN_FAILED(ZydisRenameMapRegister(map, old_operand->mem.base, &expected)) ||
+                    (new_operand->mem.base != expected) ||
+                    ZYAN_FAILED(ZydisRenameMapRegister(map, old_operand->mem.index,
+                        &expected)) ||
+                    (new_operand->mem.index != expected) ||
+                    ((old_instruction.attributes & ZYDIS_ATTRIB_HAS_SEGMENT) &&
+                        (new_operand->mem.segment != old_operand->mem.segment)) ||
+                    (new_operand->size != old_operand->size) ||
+                    ((old_operand->mem.index != ZYDIS_REGISTER_NONE) &&
+                        (new_operand->mem.scale != old_operand->mem.scale)))
+                {
+                    return ZYAN_FALSE;
+                }
+                if (old_operand->mem.base != ZYDIS_REGISTER_RIP)
+                {
+                    if (new_operand->mem.disp.value != old_operand->mem.disp.value)
+                    {
+                        return ZYAN_FALSE;
+                    }
+                    break;
+                }
+                if (ZYAN_FAILED(ZydisCalcAbsoluteAddress(&old_instruction, old_operand,
+                        old_address, &old_target)) ||
+                    ZYAN_FAILED(ZydisCalcAbsoluteAddress(&new_instruction, new_operand,
+                        new_address, &new_target)) ||
+                    (new_target != MapTarget(old_target, old_offsets, new_offsets, count, length,
+                        new_length)))
+                {
+                    return ZYAN_FALSE;
+                }
+                break;
+            case ZYDIS_OPERAND_TYPE_IMMEDIATE:
+                if (!old_operand->imm.is_relative)
+                {
+                    if (new_operand->imm.value.u != old_operand->imm.value.u)
+                    {
+                        return ZYAN_FALSE;
+                    }
+                    break;
+                }
+                if (ZYAN_FAILED(ZydisCalcAbsoluteAddress(&old_instruction, old_operand,
+                        old_address, &old_target)) ||
+                    ZYAN_FAILED(ZydisCalcAbsoluteAddress(&new_instruction, new_operand,
+                        new_address, &new_target)) ||
+                    (new_target != MapTarget(old_target, old_offsets, new_offsets, count, length,
+                        new_length)))
+                {
+                    return ZYAN_FALSE;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+static void PrintBytes(const char* prefix, const ZyanU8* data, ZyanUSize length)
+{
+    ZYAN_PRINTF("%s", prefix);
+    for (ZyanUSize i = 0; i < length; ++i)
+    {
+        ZYAN_PRINTF(" %02X", data[i]);
+    }
+    ZYAN_PRINTF("\n");
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+/**
+ * Renames every test case using `ZydisRenameFunction` and `ZydisRenameInstruction`, which
+ * have to agree for single instructions.
+ */
+static ZyanBool TestInstructions(const ZydisDecoder* decoder)
+{
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(TEST_CASES); ++i)
+    {
+        const TestCase* test = &TEST_CASES[i];
+        ZydisRenameMap map;
+        ZydisRenameMapInit(&map);
+        for (ZyanU8 j = 0; j < ZYAN_ARRAY_LENGTH(test->pairs); ++j)
+        {
+            if (test->pairs[j].from != ZYDIS_REGISTER_NONE)
+            {
+                ZydisRenameMapSet(&map, test->pairs[j].from, test->pairs[j].to);
+            }
+        }
+
+        ZyanU8 workspace[256];
+        ZyanUSize workspace_size;
+        ZyanU8 function_buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize function_length = sizeof(function_buffer);
+        ZyanStatus status = ZydisRenameGetWorkspaceSize(decoder, test->code, test->length,
+            &workspace_size);
+        if (ZYAN_SUCCESS(status))
+        {
+            status = ZydisRenameFunction(decoder, &map, test->code, test->length,
+                RUNTIME_ADDRESS, function_buffer, &function_length, workspace, workspace_size);
+        }
+
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        ZyanU8 instruction_buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize instruction_length = sizeof(instruction_buffer);
+        ZyanStatus instruction_status = ZydisDecoderDecodeFull(decoder, test->code,
+            test->length, &instruction, operands);
+        if (ZYAN_SUCCESS(instruction_status))
+        {
+            instruction_status = ZydisRenameInstruction(&map, &instruction, operands, test->code,
+                RUNTIME_ADDRESS, instruction_buffer, &instruction_length);
+        }
+
+        if ((status != test->status) || (instruction_status != test->status))
+        {
+            ZYAN_PRINTF("FAILED: %s: expected status %08" PRIX32 ", got %08" PRIX32 " and %08"
+                PRIX32 "\n", test->name, test->status, status, instruction_status);
+            passed = ZYAN_FALSE;
+            continue;
+        }
+        if (ZYAN_FAILED(status))
+        {
+            continue;
+        }
+        if ((function_length != test->new_length) || (instruction_length != function_length) ||
+            ZYAN_MEMCMP(function_buffer, instruction_buffer, function_length) ||
+            !VerifyFunction(decoder, &map, test->code, test->length, function_buffer,
+                function_length))
+        {
+            ZYAN_PRINTF("FAILED: %s: expected %u bytes\n", test->name, test->new_length);
+            PrintBytes("  function:   ", function_buffer, function_length);
+            PrintBytes("  instruction:", instruction_buffer, instruction_length);
+            passed = ZYAN_FALSE;
+        }
+    }
+
+    ZYAN_PRINTF("%s: %u instructions\n", passed ? "PASSED" : "FAILED",
+        (unsigned)ZYAN_ARRAY_LENGTH(TEST_CASES));
+    return passed;
+}
+
+/**
+ * Renames a function whose `push rbx` instructions grow, which moves the targets of two short
+ * branches out of `rel8` range.
+ */
+static ZyanBool TestWidening(const ZydisDecoder* decoder)
+{
+    enum
+    {
+        PUSH_COUNT = 0x7F,
+        LENGTH     = 2 + PUSH_COUNT + 2 + 5 + 7 + 7 + 2 + 1
+    };
+
+    ZyanU8 code[LENGTH];
+    ZyanUSize offset = 0;
+
+    // jmp short past the last push
+    code[offset++] = 0xEB;
+    code[offset++] = PUSH_COUNT;
+    for (ZyanUSize i = 0; i < PUSH_COUNT; ++i)
+    {
+        code[offset++] = 0x53;
+    }
+    const ZyanUSize jnz_offset = offset;
+
+    // jnz short to the second push
+    code[offset++] = 0x75;
+    code[offset++] = (ZyanU8)(3 - (jnz_offset + 2));
+
+    // call outside of the function
+    code[offset++] = 0xE8;
+    code[offset++] = 0x00;
+    code[offset++] = 0xF0;
+    code[offset++] = 0xFF;
+    code[offset++] = 0xFF;
+
+    // lea rax, [rip+x] referencing the `jnz`
+    const ZyanU8 lea_displacement = (ZyanU8)(jnz_offset - (offset + 7));
+    const ZyanU8 lea[] = { 0x48, 0x8D, 0x05, lea_displacement, 0xFF, 0xFF, 0xFF };
+    ZYAN_MEMCPY(code + offset, lea, sizeof(lea));
+    offset += sizeof(lea);
+
+    // mov rcx, [rip+0x1000] outside of the function
+    const ZyanU8 mov[] = { 0x48, 0x8B, 0x0D, 0x00, 0x10, 0x00, 0x00 };
+    ZYAN_MEMCPY(code + offset, mov, sizeof(mov));
+    offset += sizeof(mov);
+
+    // jz short to the end of the function, which stays in range
+    code[offset++] = 0x74;
+    code[offset++] = 0x01;
+    code[offset++] = 0xC3;
+    ZYAN_ASSERT(offset == LENGTH);
+
+    ZydisRenameMap map;
+    ZydisRenameMapInit(&map);
+    ZydisRenameMapSet(&map, ZYDIS_REGISTER_RBX, ZYDIS_REGISTER_R9);
+
+    // Every push grows by a `REX` prefix, the `jmp` by 3 bytes and the `jnz` by 4 bytes
+    const ZyanUSize expected_length = LENGTH + PUSH_COUNT + 3 + 4;
+
+    ZyanUSize workspace_size;
+    static ZyanU8 workspace[MAX_INSTRUCTIONS * 64];
+    static ZyanU8 buffer[MAX_FUNCTION_LENGTH];
+    ZyanUSize length = sizeof(buffer);
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisRenameGetWorkspaceSize(decoder, code, LENGTH, &workspace_size)) &&
+        (workspace_size <= sizeof(workspace));
+    if (passed)
+    {
+        const ZyanStatus status = ZydisRenameFunction(decoder, &map, code, LENGTH,
+            RUNTIME_ADDRESS, buffer, &length, workspace, workspace_size);
+        passed = ZYAN_SUCCESS(status) && (length == expected_length) &&
+            (buffer[0] == 0xE9) && (buffer[2 + 2 * PUSH_COUNT + 3] == 0x0F) &&
+            VerifyFunction(decoder, &map, code, LENGTH, buffer, length);
+        if (!passed)
+        {
+            ZYAN_PRINTF("FAILED: status %08" PRIX32 ", %u bytes, expected %u bytes\n", status,
+                (unsigned)length, (unsigned)expected_length);
+        }
+    }
+
+    // The output buffer and the workspace have to be large enough
+    if (passed)
+    {
+        length = expected_length - 1;
+        passed = (ZydisRenameFunction(decoder, &map, code, LENGTH, RUNTIME_ADDRESS, buffer,
+                &length, workspace, workspace_size) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+        length = sizeof(buffer);
+        passed &= (ZydisRenameFunction(decoder, &map, code, LENGTH, RUNTIME_ADDRESS, buffer,
+                &length, workspace, workspace_size - 1) == ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+    }
+
+    ZYAN_PRINTF("%s: rel8 to rel32 widening\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(const ZydisDecoder* decoder)
+{
+    ZydisRenameMap map;
+    ZydisRenameMapInit(&map);
+    ZyanBool passed =
+        (ZydisRenameMapSet(&map, ZYDIS_REGISTER_RAX, ZYDIS_REGISTER_XMM0) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisRenameMapSet(&map, ZYDIS_REGISTER_XMM0, ZYDIS_REGISTER_RAX) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisRenameMapSet(&map, ZYDIS_REGISTER_K1, ZYDIS_REGISTER_K2) ==
+            ZYAN_STATUS_INVALID_ARGUMENT);
+
+    // Any width names the whole register, `AH` renames `RAX`
+    ZydisRegister renamed;
+    passed &= ZYAN_SUCCESS(ZydisRenameMapSet(&map, ZYDIS_REGISTER_AH, ZYDIS_REGISTER_EDX)) &&
+        ZYAN_SUCCESS(ZydisRenameMapRegister(&map, ZYDIS_REGISTER_AX, &renamed)) &&
+        (renamed == ZYDIS_REGISTER_DX) &&
+        ZYAN_SUCCESS(ZydisRenameMapRegister(&map, ZYDIS_REGISTER_AH, &renamed)) &&
+        (renamed == ZYDIS_REGISTER_DH) &&
+        ZYAN_SUCCESS(ZydisRenameMapRegister(&map, ZYDIS_REGISTER_RIP, &renamed)) &&
+        (renamed == ZYDIS_REGISTER_RIP);
+    passed &= ZYAN_SUCCESS(ZydisRenameMapSet(&map, ZYDIS_REGISTER_RAX, ZYDIS_REGISTER_R11B)) &&
+        (ZydisRenameMapRegister(&map, ZYDIS_REGISTER_AH, &renamed) ==
+            ZYDIS_STATUS_IMPOSSIBLE_INSTRUCTION) &&
+        ZYAN_SUCCESS(ZydisRenameMapRegister(&map, ZYDIS_REGISTER_AL, &renamed)) &&
+        (renamed == ZYDIS_REGISTER_R11B);
+
+    // jmp short into the middle of `mov rax, [rbx]`
+    static const ZyanU8 code[] = { 0xEB, 0x01, 0x48, 0x8B, 0x03 };
+    ZyanU8 workspace[64];
+    ZyanU8 buffer[16];
+    ZyanUSize length = sizeof(buffer);
+    passed &= (ZydisRenameFunction(decoder, &map, code, sizeof(code), RUNTIME_ADDRESS, buffer,
+        &length, workspace, sizeof(workspace)) == ZYAN_STATUS_NOT_FOUND);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+        ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestInstructions(&decoder);
+    all_passed &= TestWidening(&decoder);
+    all_passed &= TestArguments(&decoder);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,321 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the sample map (`ZydisSampleMapInit`) against a reference built from synthetic code.
+ *
+ * The code is generated from a fixed set of instructions, swept in several chunks with one range
+ * left out and queried with synthetic samples. Every lookup is compared to the known instruction
+ * boundaries. The lookup throughput is printed for information only.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The size of the synthetic code.
+ */
+#define CODE_SIZE 0x100000
+
+/**
+ * The number of synthetic samples.
+ */
+#define SAMPLE_COUNT 0x1000000
+
+/**
+ * The runtime address of the synthetic code.
+ */
+#define RUNTIME_ADDRESS 0x7F0000001000
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU32 Random(ZyanU64* state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (ZyanU32)(*state >> 33);
+}
+
+static ZyanBool InitMap(ZydisSampleMap* map, const ZydisDecoder* decoder, const ZyanU8* code,
+    ZyanUSize length, const ZyanU8* info, void** workspace)
+{
+    ZyanUSize count;
+    ZyanUSize size;
+    if (ZYAN_FAILED(ZydisSampleMapCountInstructions(info, length, &count)) ||
+        ZYAN_FAILED(ZydisSampleMapGetWorkspaceSize(length, count, &size)))
+    {
+        return ZYAN_FALSE;
+    }
+    *workspace = malloc(size);
+    return *workspace && ZYAN_SUCCESS(ZydisSampleMapInit(map, decoder, code, length,
+        RUNTIME_ADDRESS, info, *workspace, size));
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestBlocks(const ZydisDecoder* decoder)
+{
+    static const ZyanU8 code[] =
+    {
+        0x31, 0xC0,                   // 00: xor eax, eax
+        0x74, 0x03,                   // 02: jz 0x07
+        0x90,                         // 04: nop
+        0x90,                         // 05: nop
+        0x90,                         // 06: nop
+        0x90,                         // 07: nop
+        0xC3,                         // 08: ret
+        0xE8, 0xF2, 0xFF, 0xFF, 0xFF, // 09: call 0x00
+        0x0F, 0x0B,                   // 0E: ud2
+        0x90                          // 10: nop
+    };
+    static const ZyanU32 expected[] = { 0, 0, 1, 1, 1, 2, 2, 3, 3, 4 };
+
+    ZyanU8 info[sizeof(code)];
+    ZYAN_MEMSET(info, 0, sizeof(info));
+    ZydisSampleMap map;
+    void* workspace = ZYAN_NULL;
+    ZyanUSize count = 0;
+    ZyanBool passed =
+        ZYAN_SUCCESS(ZydisSampleMapSweep(decoder, code, sizeof(code), 0, sizeof(code), info)) &&
+        InitMap(&map, decoder, code, sizeof(code), info, &workspace) &&
+        ZYAN_SUCCESS(ZydisSampleMapGetInstructionCount(&map, &count)) &&
+        (count == ZYAN_ARRAY_LENGTH(expected));
+    for (ZyanUSize i = 0; passed && (i < count); ++i)
+    {
+        ZydisSampleMapInstruction instruction;
+        ZydisSampleMapGetInstruction(&map, i, &instruction);
+        passed = (instruction.block == expected[i]) &&
+            (instruction.is_block_start == (!i || (expected[i] != expected[i - 1])));
+    }
+
+    free(workspace);
+    ZYAN_PRINTF("%s: basic blocks\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestLookup(const ZydisDecoder* decoder)
+{
+    static const struct
+    {
+        ZyanU8 length;
+        ZyanU8 bytes[10];
+    } instructions[] =
+    {
+        {  1, { 0x90 } },                                           // nop
+        {  3, { 0x48, 0x89, 0xC8 } },                               // mov rax, rcx
+        {  5, { 0xB8, 0x78, 0x56, 0x34, 0x12 } },                   // mov eax, 0x12345678
+        { 10, { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 } },             // mov rax, imm64
+        {  2, { 0x74, 0x10 } },                                     // jz
+        {  2, { 0xEB, 0xF0 } },                                     // jmp
+        {  1, { 0xC3 } },                                           // ret
+        {  5, { 0xE8, 0x00, 0x01, 0x00, 0x00 } },                   // call
+        {  6, { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 } },             // nop word ptr [rax+rax]
+        {  1, { 0x06 } }                                            // invalid in 64-bit mode
+    };
+
+    ZyanU8* code = malloc(CODE_SIZE);
+    ZyanU8* info = calloc(CODE_SIZE, 1);
+    ZyanU32* starts = malloc(CODE_SIZE * sizeof(ZyanU32));
+    ZyanU32* reference = malloc(CODE_SIZE * sizeof(ZyanU32));
+    ZyanU64* samples = malloc(SAMPLE_COUNT * sizeof(ZyanU64));
+    ZyanU32* indices = malloc(SAMPLE_COUNT * sizeof(ZyanU32));
+    ZyanU64* hits = ZYAN_NULL;
+    void* workspace = ZYAN_NULL;
+    ZyanBool passed = ZYAN_FALSE;
+    if (!code || !info || !starts || !reference || !samples || !indices)
+    {
+        ZYAN_PRINTF("FAILED: Out of memory\n");
+        goto cleanup;
+    }
+
+    // Generate the code, the last instruction is padded with `nop`s
+    ZyanU64 state = 0x5A5A5A5A;
+    ZyanU32 start_count = 0;
+    for (ZyanU32 offset = 0; offset < CODE_SIZE; )
+    {
+        const ZyanUSize i = Random(&state) % ZYAN_ARRAY_LENGTH(instructions);
+        const ZyanU8 length = (offset + instructions[i].length <= CODE_SIZE) ?
+            instructions[i].length : 1;
+        ZYAN_MEMCPY(code + offset, (length != instructions[i].length) ?
+            instructions[0].bytes : instructions[i].bytes, length);
+        starts[start_count++] = offset;
+        offset += length;
+    }
+
+    // Sweep in eight chunks that start at instruction boundaries and leave out the sixth one
+    ZyanU32 skipped_begin = 0;
+    ZyanU32 skipped_end = 0;
+    for (ZyanU32 i = 0; i < 8; ++i)
+    {
+        const ZyanU32 begin = starts[start_count / 8 * i];
+        const ZyanU32 end = (i == 7) ? CODE_SIZE : starts[start_count / 8 * (i + 1)];
+        if (i == 5)
+        {
+            skipped_begin = begin;
+            skipped_end = end;
+            continue;
+        }
+        if (ZYAN_FAILED(ZydisSampleMapSweep(decoder, code, CODE_SIZE, begin, end, info)))
+        {
+            ZYAN_PRINTF("FAILED: ZydisSampleMapSweep\n");
+            goto cleanup;
+        }
+    }
+
+    // Build the reference mapping from code offsets to instruction indices
+    ZyanU32 index = 0;
+    for (ZyanU32 i = 0; i < start_count; ++i)
+    {
+        const ZyanU32 end = (i + 1 < start_count) ? starts[i + 1] : CODE_SIZE;
+        const ZyanBool is_skipped = (starts[i] >= skipped_begin) && (starts[i] < skipped_end);
+        for (ZyanU32 offset = starts[i]; offset < end; ++offset)
+        {
+            reference[offset] = is_skipped ? ZYDIS_SAMPLE_MAP_NO_INSTRUCTION : index;
+        }
+        index += is_skipped ? 0 : 1;
+    }
+
+    ZydisSampleMap map;
+    ZyanUSize count;
+    if (!InitMap(&map, decoder, code, CODE_SIZE, info, &workspace) ||
+        ZYAN_FAILED(ZydisSampleMapGetInstructionCount(&map, &count)) || (count != index))
+    {
+        ZYAN_PRINTF("FAILED: ZydisSampleMapInit\n");
+        goto cleanup;
+    }
+
+    // Every code byte and the bytes around the mapped range
+    for (ZyanU32 i = 0; i < CODE_SIZE + 32; ++i)
+    {
+        samples[i] = RUNTIME_ADDRESS - 16 + i;
+    }
+    ZydisSampleMapLookup(&map, samples, CODE_SIZE + 32, indices);
+    for (ZyanU32 i = 0; i < CODE_SIZE + 32; ++i)
+    {
+        const ZyanU32 expected = ((i < 16) || (i >= CODE_SIZE + 16)) ?
+            ZYDIS_SAMPLE_MAP_NO_INSTRUCTION : reference[i - 16];
+        if (indices[i] != expected)
+        {
+            ZYAN_PRINTF("FAILED: address 0x%" PRIX64 ", expected %u, got %u\n", samples[i],
+                expected, indices[i]);
+            goto cleanup;
+        }
+    }
+
+    // Random samples, one in eight outside of the code
+    ZyanU64 expected_misses = 0;
+    for (ZyanU32 i = 0; i < SAMPLE_COUNT; ++i)
+    {
+        const ZyanU32 value = Random(&state);
+        const ZyanU64 offset = (value & 7) ? (value >> 3) % CODE_SIZE : CODE_SIZE + (value >> 3);
+        samples[i] = RUNTIME_ADDRESS + offset;
+        expected_misses += (offset >= CODE_SIZE) ||
+            (reference[offset] == ZYDIS_SAMPLE_MAP_NO_INSTRUCTION);
+    }
+    hits = calloc(count, sizeof(ZyanU64));
+    if (!hits)
+    {
+        ZYAN_PRINTF("FAILED: Out of memory\n");
+        goto cleanup;
+    }
+    ZyanU64 misses = 0;
+    const clock_t time = clock();
+    ZydisSampleMapAccumulate(&map, samples, SAMPLE_COUNT, hits, &misses);
+    const double seconds = (double)(clock() - time) / CLOCKS_PER_SEC;
+    ZyanU64 total = 0;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        total += hits[i];
+    }
+    if ((misses != expected_misses) || (total + misses != SAMPLE_COUNT))
+    {
+        ZYAN_PRINTF("FAILED: %" PRIu64 " misses, expected %" PRIu64 "\n", misses,
+            expected_misses);
+        goto cleanup;
+    }
+
+    passed = ZYAN_TRUE;
+    ZYAN_PRINTF("PASSED: lookup (%zu instructions, %.1f M samples/s)\n", count,
+        (seconds > 0) ? SAMPLE_COUNT / seconds / 1000000 : 0.0);
+
+cleanup:
+    free(workspace);
+    free(hits);
+    free(indices);
+    free(samples);
+    free(reference);
+    free(starts);
+    free(info);
+    free(code);
+    if (!passed)
+    {
+        ZYAN_PRINTF("FAILED: lookup\n");
+    }
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) ||
+        ZYAN_FAILED(ZydisDecoderEnableMode(&decoder, ZYDIS_DECODER_MODE_MINIMAL, ZYAN_TRUE)))
+    {
+        ZYAN_PRINTF("FAILED: Could not initialize decoder\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestBlocks(&decoder);
+    all_passed &= TestLookup(&decoder);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
@@ -0,0 +1,615 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the instruction scheduler (`ZydisScheduler*`) with pseudo-random blocks.
+ *
+ * Every pair of instructions of a block is checked for a conflict independently of the
+ * dependency graph: a register, flag or memory access of one instruction that overlaps with a
+ * write of the other one, or a barrier on either side. The scheduled order has to keep every
+ * conflicting pair in its original order and every edge of the graph has to be justified by a
+ * conflict. The emitted code is decoded again to check the order and the relative targets.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+#define RUNTIME_ADDRESS 0x140001000ULL
+
+/**
+ * The number of pseudo-random blocks.
+ */
+#define BLOCK_COUNT 1500
+
+/**
+ * The maximum number of instructions of a block. Blocks with more than 64 instructions use
+ * several words per row of the dependency graph.
+ */
+#define MAX_BLOCK_SIZE 300
+
+/**
+ * The first resource index used for the CPU flags. Resources below this index are registers.
+ */
+#define RESOURCE_CPUFLAGS (ZYDIS_REGISTER_MAX_VALUE + 1)
+
+/**
+ * The resource index used for memory.
+ */
+#define RESOURCE_MEMORY (RESOURCE_CPUFLAGS + 32)
+
+/**
+ * The number of 64-bit words of a resource set.
+ */
+#define RESOURCE_WORDS ((RESOURCE_MEMORY + 64) / 64)
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+typedef struct TestInstruction_
+{
+    const char* name;
+    ZyanU8 length;
+    ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    /**
+     * Signals that no instruction may be moved across this one.
+     */
+    ZyanBool is_barrier;
+} TestInstruction;
+
+/**
+ * The resources read and written by an instruction.
+ */
+typedef struct Accesses_
+{
+    ZyanU64 reads[RESOURCE_WORDS];
+    ZyanU64 writes[RESOURCE_WORDS];
+    ZyanBool is_barrier;
+} Accesses;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+/**
+ * The instructions of the pseudo-random blocks. They share a few registers, so blocks contain
+ * dependency chains as well as independent instructions.
+ */
+static const TestInstruction INSTRUCTIONS[] =
+{
+    { "add rax, rcx",           3, { 0x48, 0x01, 0xC8 }, ZYAN_FALSE },
+    { "add ecx, edx",           2, { 0x01, 0xD1 }, ZYAN_FALSE },
+    { "sub rax, rbx",           3, { 0x48, 0x29, 0xD8 }, ZYAN_FALSE },
+    { "xor eax, eax",           2, { 0x31, 0xC0 }, ZYAN_FALSE },
+    { "mov al, ah",             2, { 0x88, 0xE0 }, ZYAN_FALSE },
+    { "mov ah, al",             2, { 0x88, 0xC4 }, ZYAN_FALSE },
+    { "mov rcx, rax",           3, { 0x48, 0x89, 0xC1 }, ZYAN_FALSE },
+    { "mov rax, [rsi]",         3, { 0x48, 0x8B, 0x06 }, ZYAN_FALSE },
+    { "mov [rsi+8], rcx",       4, { 0x48, 0x89, 0x4E, 0x08 }, ZYAN_FALSE },
+    { "mov edx, [rsi+0x10]",    3, { 0x8B, 0x56, 0x10 }, ZYAN_FALSE },
+    { "lea rax, [rbx+rcx*4]",   4, { 0x48, 0x8D, 0x04, 0x8B }, ZYAN_FALSE },
+    { "imul rax, rdx",          4, { 0x48, 0x0F, 0xAF, 0xC2 }, ZYAN_FALSE },
+    { "mul rcx",                3, { 0x48, 0xF7, 0xE1 }, ZYAN_FALSE },
+    { "div rbx",                3, { 0x48, 0xF7, 0xF3 }, ZYAN_FALSE },
+    { "shl rax, 1",             3, { 0x48, 0xD1, 0xE0 }, ZYAN_FALSE },
+    { "adc rcx, rbx",           3, { 0x48, 0x11, 0xD9 }, ZYAN_FALSE },
+    { "cmovz rax, rcx",         4, { 0x48, 0x0F, 0x44, 0xC1 }, ZYAN_FALSE },
+    { "setz dl",                3, { 0x0F, 0x94, 0xC2 }, ZYAN_FALSE },
+    { "stc",                    1, { 0xF9 }, ZYAN_FALSE },
+    { "inc rbx",                3, { 0x48, 0xFF, 0xC3 }, ZYAN_FALSE },
+    { "test rcx, rcx",          3, { 0x48, 0x85, 0xC9 }, ZYAN_FALSE },
+    { "push rbx",               1, { 0x53 }, ZYAN_FALSE },
+    { "pop rdx",                1, { 0x5A }, ZYAN_FALSE },
+    { "movaps xmm0, xmm1",      3, { 0x0F, 0x28, 0xC1 }, ZYAN_FALSE },
+    { "addps xmm1, xmm0",       3, { 0x0F, 0x58, 0xC8 }, ZYAN_FALSE },
+    { "vaddps ymm0, ymm0, ymm1", 4, { 0xC5, 0xFC, 0x58, 0xC1 }, ZYAN_FALSE },
+    { "movdqa xmm2, [rsi]",     4, { 0x66, 0x0F, 0x6F, 0x16 }, ZYAN_FALSE },
+    { "fld dword [rsi]",        2, { 0xD9, 0x06 }, ZYAN_FALSE },
+    { "faddp st1, st0",         2, { 0xDE, 0xC1 }, ZYAN_FALSE },
+    { "movq mm0, mm1",          3, { 0x0F, 0x6F, 0xC1 }, ZYAN_FALSE },
+    { "mov rax, [rip+0x100]",   7, { 0x48, 0x8B, 0x05, 0x00, 0x01, 0x00, 0x00 }, ZYAN_FALSE },
+    { "nop",                    1, { 0x90 }, ZYAN_FALSE },
+    { "lock add [rsi], rcx",    4, { 0xF0, 0x48, 0x01, 0x0E }, ZYAN_TRUE },
+    { "jnz +0",                 2, { 0x75, 0x00 }, ZYAN_TRUE },
+    { "call +0",                5, { 0xE8, 0x00, 0x00, 0x00, 0x00 }, ZYAN_TRUE },
+    { "cpuid",                  2, { 0x0F, 0xA2 }, ZYAN_TRUE },
+    { "syscall",                2, { 0x0F, 0x05 }, ZYAN_TRUE },
+    { "lfence",                 3, { 0x0F, 0xAE, 0xE8 }, ZYAN_TRUE },
+    { "mfence",                 3, { 0x0F, 0xAE, 0xF0 }, ZYAN_TRUE },
+    { "pause",                  2, { 0xF3, 0x90 }, ZYAN_TRUE },
+    { "leave",                  1, { 0xC9 }, ZYAN_FALSE },
+    { "xlat",                   1, { 0xD7 }, ZYAN_FALSE }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU64 NextRandom(ZyanU64* state)
+{
+    ZyanU64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+static void AddResource(ZyanU64* set, ZyanUSize resource)
+{
+    set[resource / 64] |= 1ULL << (resource % 64);
+}
+
+static ZyanBool Intersects(const ZyanU64* a, const ZyanU64* b)
+{
+    for (ZyanUSize i = 0; i < RESOURCE_WORDS; ++i)
+    {
+        if (a[i] & b[i])
+        {
+            return ZYAN_TRUE;
+        }
+    }
+    return ZYAN_FALSE;
+}
+
+/**
+ * Returns the resource of a register or `ZYDIS_REGISTER_NONE`, if it is not tracked.
+ *
+ * Sub-registers alias their largest enclosing register, all x87 and MMX registers alias each
+ * other and the flags register is tracked by individual flags instead.
+ */
+static ZyanUSize GetRegisterResource(ZydisRegister reg)
+{
+    switch (ZydisRegisterGetClass(reg))
+    {
+    case ZYDIS_REGCLASS_INVALID:
+    case ZYDIS_REGCLASS_IP:
+    case ZYDIS_REGCLASS_FLAGS:
+        return ZYDIS_REGISTER_NONE;
+    case ZYDIS_REGCLASS_X87:
+    case ZYDIS_REGCLASS_MMX:
+        return ZYDIS_REGISTER_X87STATUS;
+    default:
+        break;
+    }
+    const ZydisRegister enclosing = ZydisRegisterGetLargestEnclosing(ZYDIS_MACHINE_MODE_LONG_64,
+        reg);
+    return (enclosing != ZYDIS_REGISTER_NONE) ? enclosing : reg;
+}
+
+static void AddRegister(ZyanU64* set, ZydisRegister reg)
+{
+    const ZyanUSize resource = GetRegisterResource(reg);
+    if (resource != ZYDIS_REGISTER_NONE)
+    {
+        AddResource(set, resource);
+    }
+}
+
+/**
+ * Collects the resources accessed by an instruction.
+ */
+static void CollectAccesses(const ZydisSchedulerInstruction* item, ZyanBool is_barrier,
+    Accesses* accesses)
+{
+    const ZydisDecodedInstruction* const instruction = &item->instruction;
+    ZYAN_MEMSET(accesses, 0, sizeof(*accesses));
+    accesses->is_barrier = is_barrier;
+
+    for (ZyanU8 i = 0; i < instruction->operand_count; ++i)
+    {
+        const ZydisDecodedOperand* const operand = &item->operands[i];
+        if (operand->type == ZYDIS_OPERAND_TYPE_REGISTER)
+        {
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_READ)
+            {
+                AddRegister(accesses->reads, operand->reg.value);
+            }
+            if (operand->actions & ZYDIS_OPERAND_ACTION_MASK_WRITE)
+            {
+                AddRegister(accesses->writes, operand->reg.value);
+            }
+        }
+        if (operand->type == ZYDIS_OPERAND_TYPE_MEMORY)
+        {
+            AddRegister(accesses->reads, operand->mem.segment);
+            AddRegister(accesses->reads, operand->mem.base);
+            AddRegister(accesses->reads, operand->mem.index);
+            if (operand->mem.type != ZYDIS_MEMOP_TYPE_AGEN)
+            {
+                // Memory accesses keep their order, even if both of them are reads
+                AddResource(accesses->reads, RESOURCE_MEMORY);
+                AddResource(accesses->writes, RESOURCE_MEMORY);
+            }
+        }
+    }
+
+    const ZydisAccessedFlags* const flags = instruction->cpu_flags;
+    for (ZyanUSize i = 0; i < 32; ++i)
+    {
+        if (flags->tested & (1ul << i))
+        {
+            AddResource(accesses->reads, RESOURCE_CPUFLAGS + i);
+        }
+        if ((flags->modified | flags->set_0 | flags->set_1 | flags->undefined) & (1ul << i))
+        {
+            AddResource(accesses->writes, RESOURCE_CPUFLAGS + i);
+        }
+    }
+
+    // The FPU flags and the x87 stack are part of the x87 status word
+    const ZydisAccessedFlags* const fpu_flags = instruction->fpu_flags;
+    if (fpu_flags->tested)
+    {
+        AddResource(accesses->reads, ZYDIS_REGISTER_X87STATUS);
+    }
+    if ((instruction->meta.isa_ext == ZYDIS_ISA_EXT_X87) || fpu_flags->modified ||
+        fpu_flags->set_0 || fpu_flags->set_1 || fpu_flags->undefined)
+    {
+        AddResource(accesses->writes, ZYDIS_REGISTER_X87STATUS);
+    }
+}
+
+/**
+ * Checks if two instructions must keep their order.
+ */
+static ZyanBool IsConflict(const Accesses* first, const Accesses* second)
+{
+    return first->is_barrier || second->is_barrier ||
+        Intersects(first->writes, second->reads) ||   // Read after write
+        Intersects(first->reads, second->writes) ||   // Write after read
+        Intersects(first->writes, second->writes);    // Write after write
+}
+
+/**
+ * Builds a pseudo-random block.
+ *
+ * @return  `ZYAN_TRUE`, if all instructions were decoded or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool BuildBlock(const ZydisDecoder* decoder, ZyanUSize count, ZyanU64* state,
+    ZydisSchedulerInstruction* items, Accesses* accesses)
+{
+    ZyanU64 runtime_address = RUNTIME_ADDRESS;
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const TestInstruction* const test =
+            &INSTRUCTIONS[NextRandom(state) % ZYAN_ARRAY_LENGTH(INSTRUCTIONS)];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, test->code, test->length,
+            &items[i].instruction, items[i].operands)) ||
+            (items[i].instruction.length != test->length))
+        {
+            ZYAN_PRINTF("FAILED: %s: decoding\n", test->name);
+            return ZYAN_FALSE;
+        }
+        items[i].runtime_address = runtime_address;
+        runtime_address += test->length;
+        CollectAccesses(&items[i], test->is_barrier, &accesses[i]);
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Returns the absolute target of the first relative operand or `0`, if there is none.
+ */
+static ZyanU64 GetTarget(const ZydisDecodedInstruction* instruction,
+    const ZydisDecodedOperand* operands, ZyanU64 runtime_address)
+{
+    for (ZyanU8 i = 0; i < instruction->operand_count_visible; ++i)
+    {
+        const ZydisDecodedOperand* const operand = &operands[i];
+        ZyanU64 address;
+        if (((operand->type == ZYDIS_OPERAND_TYPE_IMMEDIATE) && operand->imm.is_relative) ||
+            ((operand->type == ZYDIS_OPERAND_TYPE_MEMORY) &&
+                (operand->mem.base == ZYDIS_REGISTER_RIP)))
+        {
+            if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(instruction, operand, runtime_address,
+                &address)))
+            {
+                return address;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Checks the graph and the scheduled order of a block.
+ */
+static ZyanBool CheckBlock(const ZydisScheduler* scheduler, const Accesses* accesses,
+    ZyanUSize count, const ZyanU32* order, ZyanU32* position, ZyanBool* is_reordered)
+{
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        position[i] = ZYAN_UINT32_MAX;
+    }
+    for (ZyanUSize k = 0; k < count; ++k)
+    {
+        if ((order[k] >= count) || (position[order[k]] != ZYAN_UINT32_MAX))
+        {
+            ZYAN_PRINTF("FAILED: order is not a permutation\n");
+            return ZYAN_FALSE;
+        }
+        position[order[k]] = (ZyanU32)k;
+        *is_reordered |= (order[k] != k);
+    }
+
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        for (ZyanUSize j = i + 1; j < count; ++j)
+        {
+            const ZyanBool is_conflict = IsConflict(&accesses[i], &accesses[j]);
+            if (is_conflict && (position[i] > position[j]))
+            {
+                ZYAN_PRINTF("FAILED: instruction %zu moved before conflicting instruction "
+                    "%zu\n", j, i);
+                return ZYAN_FALSE;
+            }
+            const ZyanStatus status = ZydisSchedulerHasDependency(scheduler, i, j);
+            if ((status != ZYAN_STATUS_TRUE) && (status != ZYAN_STATUS_FALSE))
+            {
+                ZYAN_PRINTF("FAILED: ZydisSchedulerHasDependency\n");
+                return ZYAN_FALSE;
+            }
+            if ((status == ZYAN_STATUS_TRUE) && !is_conflict)
+            {
+                ZYAN_PRINTF("FAILED: edge %zu -> %zu without conflict\n", i, j);
+                return ZYAN_FALSE;
+            }
+            if (ZydisSchedulerHasDependency(scheduler, j, i) != ZYAN_STATUS_FALSE)
+            {
+                ZYAN_PRINTF("FAILED: backward edge %zu -> %zu\n", j, i);
+                return ZYAN_FALSE;
+            }
+        }
+    }
+
+    return ZYAN_TRUE;
+}
+
+/**
+ * Emits the block in the scheduled order and decodes it again.
+ */
+static ZyanBool CheckEmit(const ZydisDecoder* decoder, const ZydisScheduler* scheduler,
+    const ZydisSchedulerInstruction* items, ZyanUSize count, const ZyanU32* order,
+    ZyanU8* buffer, ZyanUSize buffer_size)
+{
+    ZyanUSize length = buffer_size;
+    if (ZYAN_FAILED(ZydisSchedulerEmit(scheduler, order, RUNTIME_ADDRESS, buffer, &length)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisSchedulerEmit\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanUSize offset = 0;
+    for (ZyanUSize k = 0; k < count; ++k)
+    {
+        const ZydisSchedulerInstruction* const item = &items[order[k]];
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, buffer + offset, length - offset,
+                &instruction, operands)) ||
+            (instruction.mnemonic != item->instruction.mnemonic) ||
+            (GetTarget(&instruction, operands, RUNTIME_ADDRESS + offset) !=
+                GetTarget(&item->instruction, item->operands, item->runtime_address)))
+        {
+            ZYAN_PRINTF("FAILED: emitted instruction %zu (%s)\n", k,
+                ZydisMnemonicGetString(item->instruction.mnemonic));
+            return ZYAN_FALSE;
+        }
+        offset += instruction.length;
+    }
+    if (offset != length)
+    {
+        ZYAN_PRINTF("FAILED: emitted length\n");
+        return ZYAN_FALSE;
+    }
+
+    return ZYAN_TRUE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestBlocks(const ZydisDecoder* decoder, ZydisSchedulerInstruction* items,
+    Accesses* accesses, void* workspace, ZyanUSize workspace_size, ZyanU32* order,
+    ZyanU32* position, ZyanU8* buffer, ZyanUSize buffer_size)
+{
+    ZyanU64 state = 0x2545F4914F6CDD1DULL;
+    ZyanUSize reordered_count = 0;
+    for (ZyanUSize b = 0; b < BLOCK_COUNT; ++b)
+    {
+        // Mostly short blocks, but also some that need several words per row
+        const ZyanUSize count = (b % 10) ? (ZyanUSize)(NextRandom(&state) % 65) :
+            (ZyanUSize)(NextRandom(&state) % (MAX_BLOCK_SIZE + 1));
+        if (!BuildBlock(decoder, count, &state, items, accesses))
+        {
+            return ZYAN_FALSE;
+        }
+
+        ZydisScheduler scheduler;
+        if (ZYAN_FAILED(ZydisSchedulerInit(&scheduler, items, count, workspace,
+                workspace_size)) ||
+            ZYAN_FAILED(ZydisSchedulerSchedule(&scheduler, order)))
+        {
+            ZYAN_PRINTF("FAILED: block %zu: scheduling\n", b);
+            return ZYAN_FALSE;
+        }
+
+        ZyanBool is_reordered = ZYAN_FALSE;
+        if (!CheckBlock(&scheduler, accesses, count, order, position, &is_reordered) ||
+            !CheckEmit(decoder, &scheduler, items, count, order, buffer, buffer_size))
+        {
+            ZYAN_PRINTF("FAILED: block %zu with %zu instructions\n", b, count);
+            return ZYAN_FALSE;
+        }
+        reordered_count += is_reordered;
+    }
+
+    // The test is pointless, if the scheduler never changes the order
+    if (reordered_count < BLOCK_COUNT / 2)
+    {
+        ZYAN_PRINTF("FAILED: only %zu of %d blocks were reordered\n", reordered_count,
+            BLOCK_COUNT);
+        return ZYAN_FALSE;
+    }
+
+    ZYAN_PRINTF("PASSED: %d blocks (%zu reordered)\n", BLOCK_COUNT, reordered_count);
+    return ZYAN_TRUE;
+}
+
+/**
+ * Checks that a barrier is never moved and that instructions stay on their side of it.
+ */
+static ZyanBool TestBarriers(const ZydisDecoder* decoder, ZydisSchedulerInstruction* items,
+    Accesses* accesses, void* workspace, ZyanUSize workspace_size, ZyanU32* order)
+{
+    // Independent instructions on both sides of a `jnz` in reverse priority order
+    static const ZyanU8 INDICES[] = { 31, 11, 23, 33, 31, 11, 23 };
+
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(INDICES); ++i)
+    {
+        const TestInstruction* const test = &INSTRUCTIONS[INDICES[i]];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, test->code, test->length,
+            &items[i].instruction, items[i].operands)))
+        {
+            ZYAN_PRINTF("FAILED: barriers: decoding\n");
+            return ZYAN_FALSE;
+        }
+        items[i].runtime_address = RUNTIME_ADDRESS + i * ZYDIS_MAX_INSTRUCTION_LENGTH;
+        CollectAccesses(&items[i], test->is_barrier, &accesses[i]);
+    }
+
+    static const ZyanU32 EXPECTED[] = { 1, 2, 0, 3, 5, 6, 4 };
+    ZydisScheduler scheduler;
+    const ZyanBool passed =
+        ZYAN_SUCCESS(ZydisSchedulerInit(&scheduler, items, ZYAN_ARRAY_LENGTH(INDICES),
+            workspace, workspace_size)) &&
+        ZYAN_SUCCESS(ZydisSchedulerSchedule(&scheduler, order)) &&
+        !ZYAN_MEMCMP(order, EXPECTED, sizeof(EXPECTED));
+
+    ZYAN_PRINTF("%s: barriers\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(ZydisSchedulerInstruction* items, void* workspace,
+    ZyanUSize workspace_size)
+{
+    ZydisScheduler scheduler;
+    ZyanUSize size;
+    ZyanBool passed =
+        (ZydisSchedulerGetWorkspaceSize(ZYDIS_SCHEDULER_MAX_INSTRUCTION_COUNT + 1, &size) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSchedulerGetWorkspaceSize(1, ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisSchedulerGetWorkspaceSize(2, &size)) &&
+        (ZydisSchedulerInit(&scheduler, items, 2, (ZyanU8*)workspace + 4, workspace_size - 4) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSchedulerInit(&scheduler, items, 2, workspace, size - 1) ==
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) &&
+        ZYAN_SUCCESS(ZydisSchedulerInit(&scheduler, items, 2, workspace, size)) &&
+        (ZydisSchedulerHasDependency(&scheduler, 0, 2) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSchedulerSchedule(&scheduler, ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT);
+
+    // Instructions have to be decoded with flags
+    ZydisSchedulerInstruction item;
+    ZYAN_MEMSET(&item, 0, sizeof(item));
+    passed &= (ZydisSchedulerInit(&scheduler, &item, 1, workspace, workspace_size) ==
+        ZYAN_STATUS_INVALID_ARGUMENT);
+
+    // An empty block
+    passed &= ZYAN_SUCCESS(ZydisSchedulerInit(&scheduler, ZYAN_NULL, 0, workspace,
+        workspace_size)) && ZYAN_SUCCESS(ZydisSchedulerSchedule(&scheduler, ZYAN_NULL));
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+        ZYDIS_STACK_WIDTH_64)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder\n");
+        return 1;
+    }
+
+    int result = 1;
+    ZyanUSize workspace_size;
+    const ZyanUSize buffer_size = MAX_BLOCK_SIZE * ZYDIS_MAX_INSTRUCTION_LENGTH;
+    ZydisSchedulerInstruction* const items =
+        (ZydisSchedulerInstruction*)malloc(MAX_BLOCK_SIZE * sizeof(ZydisSchedulerInstruction));
+    Accesses* const accesses = (Accesses*)malloc(MAX_BLOCK_SIZE * sizeof(Accesses));
+    ZyanU32* const order = (ZyanU32*)malloc(MAX_BLOCK_SIZE * sizeof(ZyanU32));
+    ZyanU32* const position = (ZyanU32*)malloc(MAX_BLOCK_SIZE * sizeof(ZyanU32));
+    ZyanU8* const buffer = (ZyanU8*)malloc(buffer_size);
+    void* const workspace =
+        ZYAN_SUCCESS(ZydisSchedulerGetWorkspaceSize(MAX_BLOCK_SIZE, &workspace_size)) ?
+            malloc(workspace_size) : ZYAN_NULL;
+    if (!items || !accesses || !order || !position || !buffer || !workspace)
+    {
+        ZYAN_PRINTF("Failed to allocate memory\n");
+        goto cleanup;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestBlocks(&decoder, items, accesses, workspace, workspace_size, order,
+        position, buffer, buffer_size);
+    all_passed &= TestBarriers(&decoder, items, accesses, workspace, workspace_size, order);
+    all_passed &= TestArguments(items, workspace, workspace_size);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        goto cleanup;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    result = 0;
+
+cleanup:
+    free(workspace);
+    free(buffer);
+    free(position);
+    free(order);
+    free(accesses);
+    free(items);
+    return result;
+}
+
+/* ============================================================================================== */
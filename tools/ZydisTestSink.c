@@ -0,0 +1,551 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the output sinks (`ZydisSink*`).
+ *
+ * Instructions formatted into a sink are compared line by line to
+ * `ZydisFormatterFormatInstruction`. A custom flush function records every flush to check the
+ * flush threshold, writes that bypass the buffer and the space available to the formatter.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <Zycore/Format.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of pseudo-random instructions formatted per sink.
+ */
+#define INSTRUCTION_COUNT 5000
+
+/**
+ * The maximum number of flushes recorded by the flush function.
+ */
+#define MAX_FLUSH_COUNT 8192
+
+/**
+ * The capacity of the collected output.
+ */
+#define OUTPUT_CAPACITY (1024 * 1024)
+
+#define RUNTIME_ADDRESS 0x00007FF612340000ULL
+
+/**
+ * The length of the mnemonic printed by `PrintLongMnemonic`, which makes the line longer than
+ * `ZYDIS_SINK_LINE_LENGTH`.
+ */
+#define LONG_MNEMONIC_LENGTH 400
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Collects the output of a sink.
+ */
+typedef struct Output_
+{
+    char* data;
+    ZyanUSize size;
+    /**
+     * The pointers and sizes of all flushes.
+     */
+    const char* flush_data[MAX_FLUSH_COUNT];
+    ZyanUSize flush_size[MAX_FLUSH_COUNT];
+    ZyanUSize flush_count;
+    /**
+     * Makes the flush function fail.
+     */
+    ZyanBool fail;
+} Output;
+
+/**
+ * Describes the buffer configuration of a sink.
+ */
+typedef struct SinkConfig_
+{
+    ZyanUSize capacity;
+    ZyanUSize threshold;
+} SinkConfig;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const SinkConfig SINK_CONFIGS[] =
+{
+    { ZYDIS_SINK_LINE_LENGTH,       ZYDIS_SINK_LINE_LENGTH },
+    { ZYDIS_SINK_LINE_LENGTH + 1,   1 },
+    { 1000,                         0 },
+    { 1000,                         500 },
+    { 4096,                         4096 },
+    { 4096,                         8192 }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanStatus FlushOutput(ZydisSink* sink, const char* data, ZyanUSize length)
+{
+    Output* const output = (Output*)sink->user_data;
+    if (output->fail)
+    {
+        return ZYAN_STATUS_BAD_SYSTEMCALL;
+    }
+    if ((output->size + length > OUTPUT_CAPACITY) || (output->flush_count == MAX_FLUSH_COUNT))
+    {
+        return ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE;
+    }
+
+    output->flush_data[output->flush_count] = data;
+    output->flush_size[output->flush_count] = length;
+    ++output->flush_count;
+    ZYAN_MEMCPY(output->data + output->size, data, length);
+    output->size += length;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+static void ResetOutput(Output* output)
+{
+    output->size = 0;
+    output->flush_count = 0;
+    output->fail = ZYAN_FALSE;
+}
+
+static ZyanStatus PrintLongMnemonic(const ZydisFormatter* formatter,
+    ZydisFormatterBuffer* buffer, ZydisFormatterContext* context)
+{
+    ZYAN_UNUSED(formatter);
+    ZYAN_UNUSED(context);
+
+    ZyanString* string;
+    ZYAN_CHECK(ZydisFormatterBufferAppend(buffer, ZYDIS_TOKEN_MNEMONIC));
+    ZYAN_CHECK(ZydisFormatterBufferGetString(buffer, &string));
+    return ZyanStringAppendFormat(string, "%-*s", LONG_MNEMONIC_LENGTH, "long");
+}
+
+static ZyanU64 NextRandom(ZyanU64* state)
+{
+    ZyanU64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Formats pseudo-random instructions into the sink and the expected output.
+ *
+ * @return  `ZYAN_TRUE`, if all instructions were formatted or `ZYAN_FALSE`, if not.
+ */
+static ZyanBool FormatInstructions(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    ZydisSink* sink, char* expected, ZyanUSize* expected_size)
+{
+    ZyanU64 state = 0x243F6A8885A308D3ULL;
+    *expected_size = 0;
+    for (ZyanUSize i = 0; i < INSTRUCTION_COUNT; ++i)
+    {
+        ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        for (ZyanU8 j = 0; j < sizeof(code); ++j)
+        {
+            code[j] = (ZyanU8)NextRandom(&state);
+        }
+
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, code, sizeof(code), &instruction,
+            operands)))
+        {
+            continue;
+        }
+
+        char line[ZYDIS_SINK_LINE_LENGTH];
+        const ZyanU64 runtime_address = RUNTIME_ADDRESS + i * ZYDIS_MAX_INSTRUCTION_LENGTH;
+        if (ZYAN_FAILED(ZydisFormatterFormatInstruction(formatter, &instruction, operands,
+                instruction.operand_count_visible, line, sizeof(line), runtime_address,
+                ZYAN_NULL)) ||
+            ZYAN_FAILED(ZydisSinkFormatInstruction(sink, formatter, &instruction, operands,
+                instruction.operand_count_visible, runtime_address, ZYAN_NULL)))
+        {
+            return ZYAN_FALSE;
+        }
+
+        const ZyanUSize length = ZYAN_STRLEN(line);
+        ZYAN_MEMCPY(expected + *expected_size, line, length);
+        expected[*expected_size + length] = '\n';
+        *expected_size += length + 1;
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Compares the output to the expected output and prints the first differing line.
+ */
+static ZyanBool CompareLines(const char* name, const char* data, ZyanUSize size,
+    const char* expected, ZyanUSize expected_size)
+{
+    ZyanUSize line = 1;
+    for (ZyanUSize i = 0; (i < size) && (i < expected_size); ++i)
+    {
+        if (data[i] != expected[i])
+        {
+            ZYAN_PRINTF("FAILED: %s: line %u differs\n", name, (unsigned)line);
+            return ZYAN_FALSE;
+        }
+        line += (data[i] == '\n');
+    }
+    if (size != expected_size)
+    {
+        ZYAN_PRINTF("FAILED: %s: %u bytes, expected %u bytes\n", name, (unsigned)size,
+            (unsigned)expected_size);
+        return ZYAN_FALSE;
+    }
+    return ZYAN_TRUE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+/**
+ * Formats instructions into sinks of different capacities and flush thresholds.
+ */
+static ZyanBool TestFlush(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    Output* output, char* expected)
+{
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(SINK_CONFIGS); ++i)
+    {
+        const SinkConfig* config = &SINK_CONFIGS[i];
+        char* const buffer = (char*)malloc(config->capacity);
+        ZydisSink sink;
+        ZyanUSize expected_size;
+        ResetOutput(output);
+        if (!buffer ||
+            ZYAN_FAILED(ZydisSinkInit(&sink, buffer, config->capacity, config->threshold,
+                &FlushOutput, output)) ||
+            !FormatInstructions(decoder, formatter, &sink, expected, &expected_size))
+        {
+            ZYAN_PRINTF("FAILED: capacity %u, threshold %u: formatting failed\n",
+                (unsigned)config->capacity, (unsigned)config->threshold);
+            free(buffer);
+            passed = ZYAN_FALSE;
+            continue;
+        }
+
+        // Every flush but the last one is triggered by the threshold or by a full buffer
+        const ZyanUSize pending = sink.size;
+        ZyanBool flushes_valid = (pending < ZYAN_MAX(config->threshold, 1)) &&
+            (pending <= config->capacity);
+        for (ZyanUSize j = 0; j < output->flush_count; ++j)
+        {
+            const ZyanUSize size = output->flush_size[j];
+            flushes_valid &= (output->flush_data[j] == buffer) && (size <= config->capacity) &&
+                ((size >= config->threshold) ||
+                    (size + ZYDIS_SINK_LINE_LENGTH > config->capacity));
+        }
+
+        const ZyanUSize flush_count = output->flush_count;
+        passed &= ZYAN_SUCCESS(ZydisSinkDestroy(&sink)) &&
+            (output->flush_count == flush_count + (pending ? 1 : 0)) && flushes_valid &&
+            CompareLines("flush", output->data, output->size, expected, expected_size);
+        if (!flushes_valid)
+        {
+            ZYAN_PRINTF("FAILED: capacity %u, threshold %u: unexpected flush\n",
+                (unsigned)config->capacity, (unsigned)config->threshold);
+        }
+        free(buffer);
+    }
+
+    ZYAN_PRINTF("%s: flush thresholds\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/**
+ * Formats instructions into a growing memory sink.
+ */
+static ZyanBool TestMemory(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    char* expected)
+{
+    ZydisSink sink;
+    ZyanUSize expected_size;
+    if (ZYAN_FAILED(ZydisSinkInitMemory(&sink, 0)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisSinkInitMemory\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanBool passed = (sink.capacity == ZYDIS_SINK_LINE_LENGTH) &&
+        FormatInstructions(decoder, formatter, &sink, expected, &expected_size) &&
+        (sink.capacity >= sink.size + ZYDIS_SINK_LINE_LENGTH / 2) &&
+        CompareLines("memory", sink.data, sink.size, expected, expected_size);
+
+    // Flushing does not empty memory sinks
+    passed &= ZYAN_SUCCESS(ZydisSinkFlush(&sink)) && (sink.size == expected_size);
+
+    // Large writes grow the buffer instead of bypassing it
+    static char large[3 * ZYDIS_SINK_LINE_LENGTH * 64];
+    ZYAN_MEMSET(large, 'x', sizeof(large));
+    const ZyanUSize size = sink.size;
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, large, sizeof(large))) &&
+        (sink.size == size + sizeof(large)) && (sink.capacity >= sink.size) &&
+        !ZYAN_MEMCMP(sink.data, expected, expected_size) &&
+        !ZYAN_MEMCMP(sink.data + size, large, sizeof(large));
+
+    passed &= ZYAN_SUCCESS(ZydisSinkDestroy(&sink)) && !sink.data && !sink.size &&
+        !sink.capacity;
+
+    ZYAN_PRINTF("%s: memory sink growth\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/**
+ * Writes raw data into a sink.
+ */
+static ZyanBool TestWrite(Output* output)
+{
+    static char data[4 * ZYDIS_SINK_LINE_LENGTH];
+    for (ZyanUSize i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = (char)('a' + i % 26);
+    }
+
+    char buffer[ZYDIS_SINK_LINE_LENGTH];
+    ZydisSink sink;
+    ResetOutput(output);
+    ZyanBool passed = ZYAN_SUCCESS(ZydisSinkInit(&sink, buffer, sizeof(buffer), sizeof(buffer),
+        &FlushOutput, output));
+
+    // Small writes are buffered
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, data, 100)) && (sink.size == 100) &&
+        (output->flush_count == 0);
+
+    // Writes larger than the buffer flush the pending data and bypass the buffer
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, data + 100, 2 * ZYDIS_SINK_LINE_LENGTH)) &&
+        (sink.size == 0) && (output->flush_count == 2) &&
+        (output->flush_data[0] == buffer) && (output->flush_size[0] == 100) &&
+        (output->flush_data[1] == data + 100) &&
+        (output->flush_size[1] == 2 * ZYDIS_SINK_LINE_LENGTH);
+
+    // A write of exactly the capacity fits after flushing the pending data
+    const ZyanUSize offset = 100 + 2 * ZYDIS_SINK_LINE_LENGTH;
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, data + offset, 10)) &&
+        ZYAN_SUCCESS(ZydisSinkWrite(&sink, data + offset + 10, ZYDIS_SINK_LINE_LENGTH)) &&
+        (output->flush_count == 4) && (output->flush_data[2] == buffer) &&
+        (output->flush_size[2] == 10) && (output->flush_data[3] == buffer) &&
+        (output->flush_size[3] == ZYDIS_SINK_LINE_LENGTH) && (sink.size == 0);
+
+    // Empty writes do nothing
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, ZYAN_NULL, 0)) && (sink.size == 0);
+
+    const ZyanUSize total = offset + 10 + ZYDIS_SINK_LINE_LENGTH;
+    passed &= ZYAN_SUCCESS(ZydisSinkDestroy(&sink)) && (output->flush_count == 4) &&
+        (output->size == total) && !ZYAN_MEMCMP(output->data, data, total);
+
+    // Failing flushes keep the pending data
+    passed &= ZYAN_SUCCESS(ZydisSinkWrite(&sink, data, 100));
+    output->fail = ZYAN_TRUE;
+    passed &= (ZydisSinkWrite(&sink, data, 200) == ZYAN_STATUS_BAD_SYSTEMCALL) &&
+        (sink.size == 100) && (ZydisSinkFlush(&sink) == ZYAN_STATUS_BAD_SYSTEMCALL) &&
+        (sink.size == 100);
+    output->fail = ZYAN_FALSE;
+    passed &= ZYAN_SUCCESS(ZydisSinkFlush(&sink)) && (sink.size == 0) &&
+        (output->size == total + 100);
+
+    ZYAN_PRINTF("%s: bypass writes\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/**
+ * Checks that instructions are formatted into all of the remaining buffer space and that
+ * `ZydisSinkReserve` and `ZydisSinkCommit` interleave with formatted instructions.
+ */
+static ZyanBool TestRemainingSpace(const ZydisDecoder* decoder, const ZydisFormatter* formatter,
+    Output* output)
+{
+    // vpternlogd zmm0 {k1}{z}, zmm1, dword ptr [rax+rbx*4+0x12345678] {1to16}, 0x12
+    static const ZyanU8 code[] =
+    {
+        0x62, 0xF3, 0x75, 0xD9, 0x25, 0x84, 0x98, 0x78, 0x56, 0x34, 0x12, 0x12
+    };
+    ZydisDecodedInstruction instruction;
+    ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+    char line[ZYDIS_SINK_LINE_LENGTH];
+    if (ZYAN_FAILED(ZydisDecoderDecodeFull(decoder, code, sizeof(code), &instruction,
+            operands)) ||
+        ZYAN_FAILED(ZydisFormatterFormatInstruction(formatter, &instruction, operands,
+            instruction.operand_count_visible, line, sizeof(line), RUNTIME_ADDRESS, ZYAN_NULL)))
+    {
+        ZYAN_PRINTF("FAILED: test instruction\n");
+        return ZYAN_FALSE;
+    }
+    const ZyanUSize length = ZYAN_STRLEN(line);
+
+    char buffer[ZYDIS_SINK_LINE_LENGTH + 64];
+    ZydisSink sink;
+    ResetOutput(output);
+    ZyanBool passed = ZYAN_SUCCESS(ZydisSinkInit(&sink, buffer, sizeof(buffer), sizeof(buffer),
+        &FlushOutput, output));
+
+    // A failing formatter does not commit anything
+    passed &= (ZydisSinkFormatInstruction(&sink, formatter, &instruction, operands, 0,
+        RUNTIME_ADDRESS, ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) && (sink.size == 0);
+
+    // Exactly a line of free space is enough
+    char* reserved;
+    passed &= ZYAN_SUCCESS(ZydisSinkReserve(&sink, 64, &reserved)) && (reserved == buffer);
+    ZYAN_MEMSET(reserved, '#', 64);
+    passed &= ZYAN_SUCCESS(ZydisSinkCommit(&sink, 64)) &&
+        ZYAN_SUCCESS(ZydisSinkFormatInstruction(&sink, formatter, &instruction, operands,
+            instruction.operand_count_visible, RUNTIME_ADDRESS, ZYAN_NULL)) &&
+        (output->flush_count == 0) && (sink.size == 64 + length + 1) &&
+        !ZYAN_MEMCMP(buffer + 64, line, length) && (buffer[64 + length] == '\n');
+
+    // With less than a line of free space, the pending data is flushed first
+    passed &= ZYAN_SUCCESS(ZydisSinkFormatInstruction(&sink, formatter, &instruction, operands,
+            instruction.operand_count_visible, RUNTIME_ADDRESS, ZYAN_NULL)) &&
+        (output->flush_count == 1) && (output->flush_size[0] == 64 + length + 1) &&
+        (sink.size == length + 1) && !ZYAN_MEMCMP(buffer, line, length);
+
+    // Committing more than reserved is rejected
+    passed &= (ZydisSinkCommit(&sink, sizeof(buffer)) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (sink.size == length + 1);
+
+    passed &= ZYAN_SUCCESS(ZydisSinkDestroy(&sink)) && (output->flush_count == 2) &&
+        (output->size == 64 + 2 * (length + 1));
+
+    // Reservations larger than the buffer fail
+    passed &= (ZydisSinkReserve(&sink, sizeof(buffer) + 1, &reserved) ==
+        ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE);
+
+    // Lines longer than `ZYDIS_SINK_LINE_LENGTH` use all of the remaining space
+    ZydisFormatter long_formatter = *formatter;
+    const void* callback = (const void*)&PrintLongMnemonic;
+    static char long_line[2 * LONG_MNEMONIC_LENGTH];
+    static char long_buffer[4 * LONG_MNEMONIC_LENGTH];
+    passed &= ZYAN_SUCCESS(ZydisFormatterSetHook(&long_formatter,
+            ZYDIS_FORMATTER_FUNC_PRINT_MNEMONIC, &callback)) &&
+        ZYAN_SUCCESS(ZydisFormatterFormatInstruction(&long_formatter, &instruction, operands,
+            instruction.operand_count_visible, long_line, sizeof(long_line), RUNTIME_ADDRESS,
+            ZYAN_NULL));
+    const ZyanUSize long_length = ZYAN_STRLEN(long_line);
+    ResetOutput(output);
+    passed &= (long_length > LONG_MNEMONIC_LENGTH) &&
+        ZYAN_SUCCESS(ZydisSinkInit(&sink, long_buffer, sizeof(long_buffer), sizeof(long_buffer),
+            &FlushOutput, output)) &&
+        ZYAN_SUCCESS(ZydisSinkFormatInstruction(&sink, &long_formatter, &instruction, operands,
+            instruction.operand_count_visible, RUNTIME_ADDRESS, ZYAN_NULL)) &&
+        (sink.size == long_length + 1) && !ZYAN_MEMCMP(long_buffer, long_line, long_length) &&
+        (output->flush_count == 0);
+    passed &= ZYAN_SUCCESS(ZydisSinkInit(&sink, long_buffer, ZYDIS_SINK_LINE_LENGTH,
+            ZYDIS_SINK_LINE_LENGTH, &FlushOutput, output)) &&
+        (ZydisSinkFormatInstruction(&sink, &long_formatter, &instruction, operands,
+            instruction.operand_count_visible, RUNTIME_ADDRESS, ZYAN_NULL) ==
+            ZYAN_STATUS_INSUFFICIENT_BUFFER_SIZE) && (sink.size == 0);
+
+    ZYAN_PRINTF("%s: formatting into the remaining space\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(Output* output)
+{
+    char buffer[ZYDIS_SINK_LINE_LENGTH];
+    ZydisSink sink;
+    const ZyanBool passed =
+        (ZydisSinkInit(&sink, buffer, sizeof(buffer) - 1, 0, &FlushOutput, output) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSinkInit(&sink, buffer, sizeof(buffer), 0, ZYAN_NULL, output) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSinkInit(&sink, ZYAN_NULL, sizeof(buffer), 0, &FlushOutput, output) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSinkInitFile(&sink, buffer, sizeof(buffer), ZYAN_NULL) ==
+            ZYAN_STATUS_INVALID_ARGUMENT);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZydisDecoder decoder;
+    ZydisFormatter formatter;
+    if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64)) ||
+        ZYAN_FAILED(ZydisFormatterInit(&formatter, ZYDIS_FORMATTER_STYLE_INTEL)))
+    {
+        ZYAN_PRINTF("Failed to initialize decoder or formatter\n");
+        return 1;
+    }
+
+    int result = 1;
+    Output* const output = (Output*)malloc(sizeof(Output));
+    char* const output_data = (char*)malloc(OUTPUT_CAPACITY);
+    char* const expected = (char*)malloc(OUTPUT_CAPACITY);
+    if (!output || !output_data || !expected)
+    {
+        ZYAN_PRINTF("Failed to allocate memory\n");
+        goto cleanup;
+    }
+    output->data = output_data;
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestFlush(&decoder, &formatter, output, expected);
+    all_passed &= TestMemory(&decoder, &formatter, expected);
+    all_passed &= TestWrite(output);
+    all_passed &= TestRemainingSpace(&decoder, &formatter, output);
+    all_passed &= TestArguments(output);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        goto cleanup;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    result = 0;
+
+cleanup:
+    free(expected);
+    free(output_data);
+    free(output);
+    return result;
+}
+
+/* ============================================================================================== */
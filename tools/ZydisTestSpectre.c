@@ -0,0 +1,309 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the Spectre variant 1 scanner (`ZydisSpectreScan`) with hand-assembled bounds check
+ * bypass gadgets.
+ *
+ * Every case lists the exact gadget candidates that have to be reported. The negative cases
+ * cover the conditions that break the taint chain or end speculation along a path.
+ */
+
+#include <inttypes.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+#include "ZydisToolsShared.h"
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The runtime address of every test case.
+ */
+#define RUNTIME_ADDRESS 0x1000
+
+#define WINDOW ZYDIS_SPECTRE_DEFAULT_WINDOW
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Describes an expected gadget candidate. All addresses are offsets relative to the start of
+ * the code.
+ */
+typedef struct ExpectedGadget_
+{
+    ZyanU8 branch;
+    ZyanBool is_taken;
+    ZyanU8 load;
+    ZyanU8 dependent_load;
+} ExpectedGadget;
+
+typedef struct TestCase_
+{
+    const char* name;
+    ZydisMachineMode machine_mode;
+    ZyanU32 window;
+    ZyanU8 length;
+    ZyanU8 code[24];
+    ZyanU8 gadget_count;
+    ExpectedGadget gadgets[2];
+} TestCase;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+static const TestCase TEST_CASES[] =
+{
+    // Positive cases
+
+    // cmp rdi, rsi; jae 16; movzx eax, byte [rdx+rdi]; shl eax, 6; mov al, [rcx+rax]; ret;
+    // ret
+    { "gadget on the fall-through path", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 17,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0B, 0x0F, 0xB6, 0x04, 0x3A, 0xC1, 0xE0, 0x06, 0x8A, 0x04,
+          0x01, 0xC3, 0xC3 },
+        1, { { 3, ZYAN_FALSE, 5, 12 } } },
+    // cmp rdi, rsi; jb 6; ret; movzx eax, byte [rdx+rdi]; mov al, [rcx+rax]; ret
+    { "gadget on the taken path", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 14,
+        { 0x48, 0x39, 0xF7, 0x72, 0x01, 0xC3, 0x0F, 0xB6, 0x04, 0x3A, 0x8A, 0x04, 0x01, 0xC3 },
+        1, { { 3, ZYAN_TRUE, 6, 10 } } },
+    // cmp rdi, rsi; jae 20; mov r8, rdi; movzx eax, byte [rdx+r8]; mov r9, rax;
+    // mov al, [rcx+r9]; ret
+    { "taint propagates through register moves", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 21,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0F, 0x49, 0x89, 0xF8, 0x42, 0x0F, 0xB6, 0x04, 0x02, 0x49,
+          0x89, 0xC1, 0x42, 0x8A, 0x04, 0x09, 0xC3 },
+        1, { { 3, ZYAN_FALSE, 8, 16 } } },
+    // cmp rdi, rsi; jae 15; movzx eax, byte [rdx+rdi]; jmp 12; ret; mov al, [rcx+rax]; ret
+    { "unconditional jumps are followed", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 16,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0A, 0x0F, 0xB6, 0x04, 0x3A, 0xEB, 0x01, 0xC3, 0x8A, 0x04,
+          0x01, 0xC3 },
+        1, { { 3, ZYAN_FALSE, 5, 12 } } },
+    // cmp edi, esi; jae 15; movzx eax, byte [edx+edi]; shl eax, 6; mov al, [ecx+eax]; ret; ret
+    { "32-bit mode", ZYDIS_MACHINE_MODE_LONG_COMPAT_32, WINDOW, 16,
+        { 0x39, 0xF7, 0x73, 0x0B, 0x0F, 0xB6, 0x04, 0x3A, 0xC1, 0xE0, 0x06, 0x8A, 0x04, 0x01,
+          0xC3, 0xC3 },
+        1, { { 2, ZYAN_FALSE, 4, 11 } } },
+
+    // Negative cases
+
+    // cmp rdi, rsi; jae 16; lfence; movzx eax, byte [rdx+rdi]; mov al, [rcx+rax]; ret; ret
+    { "lfence ends speculation", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 17,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0B, 0x0F, 0xAE, 0xE8, 0x0F, 0xB6, 0x04, 0x3A, 0x8A, 0x04,
+          0x01, 0xC3, 0xC3 },
+        0, { { 0 } } },
+    // cmp rdi, rsi; jz 16; movzx eax, byte [rdx+rdi]; shl eax, 6; mov al, [rcx+rax]; ret; ret
+    { "equality branches are no bounds checks", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 17,
+        { 0x48, 0x39, 0xF7, 0x74, 0x0B, 0x0F, 0xB6, 0x04, 0x3A, 0xC1, 0xE0, 0x06, 0x8A, 0x04,
+          0x01, 0xC3, 0xC3 },
+        0, { { 0 } } },
+    // cmp rdi, rsi; jae 17; mov edi, 0; movzx eax, byte [rdx+rdi]; mov al, [rcx+rax]; ret
+    { "overwritten index", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 18,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0C, 0xBF, 0x00, 0x00, 0x00, 0x00, 0x0F, 0xB6, 0x04, 0x3A,
+          0x8A, 0x04, 0x01, 0xC3 },
+        0, { { 0 } } },
+    // cmp rdi, rsi; jae 11; movzx eax, byte [rdx+rdi]; mov al, [rcx]; ret
+    { "independent second load", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 12,
+        { 0x48, 0x39, 0xF7, 0x73, 0x06, 0x0F, 0xB6, 0x04, 0x3A, 0x8A, 0x01, 0xC3 },
+        0, { { 0 } } },
+    // cmp rdi, rsi; jae 17; movzx eax, byte [rdx+rdi]; call 14; mov al, [rcx+rax]; ret
+    { "calls end speculation", ZYDIS_MACHINE_MODE_LONG_64, WINDOW, 18,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0C, 0x0F, 0xB6, 0x04, 0x3A, 0xE8, 0x00, 0x00, 0x00, 0x00,
+          0x8A, 0x04, 0x01, 0xC3 },
+        0, { { 0 } } },
+    // Same as the first case, but the dependent load is the third instruction on the path
+    { "dependent load outside of the window", ZYDIS_MACHINE_MODE_LONG_64, 2, 17,
+        { 0x48, 0x39, 0xF7, 0x73, 0x0B, 0x0F, 0xB6, 0x04, 0x3A, 0xC1, 0xE0, 0x06, 0x8A, 0x04,
+          0x01, 0xC3, 0xC3 },
+        0, { { 0 } } }
+};
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanStatus CollectGadget(const ZydisSpectreGadget* gadget, void* user_data)
+{
+    return ResultListPush((ResultList*)user_data, gadget);
+}
+
+static ZyanStatus Scan(ZydisSpectreArena* arena, const TestCase* test, ZyanUSize begin,
+    ZyanUSize end, ResultList* list)
+{
+    ZydisSpectreScanner scanner;
+    ZYAN_CHECK(ZydisSpectreScannerInit(&scanner, test->machine_mode,
+        (test->machine_mode == ZYDIS_MACHINE_MODE_LONG_64) ?
+            ZYDIS_STACK_WIDTH_64 : ZYDIS_STACK_WIDTH_32, test->window));
+    return ZydisSpectreScan(&scanner, arena, test->code, test->length, RUNTIME_ADDRESS, begin,
+        end, &CollectGadget, list);
+}
+
+static void GetCaseInfo(const void* test_case, const char** name, size_t* expected_count)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    *name = test->name;
+    *expected_count = test->gadget_count;
+}
+
+static ZyanStatus RunCase(void* context, const void* test_case, ResultList* list)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    return Scan((ZydisSpectreArena*)context, test, 0, test->length, list);
+}
+
+static ZyanBool CompareGadget(const void* test_case, const void* result, size_t index)
+{
+    const TestCase* test = (const TestCase*)test_case;
+    const ZydisSpectreGadget* gadget = (const ZydisSpectreGadget*)result;
+    const ExpectedGadget* expected = &test->gadgets[index];
+    if ((gadget->branch == (ZyanU64)RUNTIME_ADDRESS + expected->branch) &&
+        (gadget->is_taken == expected->is_taken) &&
+        (gadget->load == (ZyanU64)RUNTIME_ADDRESS + expected->load) &&
+        (gadget->dependent_load == (ZyanU64)RUNTIME_ADDRESS + expected->dependent_load))
+    {
+        return ZYAN_TRUE;
+    }
+
+    ZYAN_PRINTF("FAILED: %s: expected gadget at +%u (taken %d, load +%u, dependent load +%u), " \
+        "got 0x%" PRIX64 " (taken %d, load 0x%" PRIX64 ", dependent load 0x%" PRIX64 ")\n",
+        test->name, expected->branch, expected->is_taken, expected->load,
+        expected->dependent_load, gadget->branch, gadget->is_taken, gadget->load,
+        gadget->dependent_load);
+    return ZYAN_FALSE;
+}
+
+static void PrintGadget(const void* result)
+{
+    const ZydisSpectreGadget* gadget = (const ZydisSpectreGadget*)result;
+    ZYAN_PRINTF("  gadget at 0x%" PRIX64 " (load 0x%" PRIX64 ", dependent load 0x%" PRIX64 ")\n",
+        gadget->branch, gadget->load, gadget->dependent_load);
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestCases(ZydisSpectreArena* arena)
+{
+    const TestTable table =
+    {
+        "hand-assembled cases", TEST_CASES, sizeof(TestCase), ZYAN_ARRAY_LENGTH(TEST_CASES),
+        sizeof(ZydisSpectreGadget), arena, &GetCaseInfo, &RunCase, &CompareGadget,
+        &PrintGadget
+    };
+    return RunTestTable(&table);
+}
+
+static ZyanBool TestRange(ZydisSpectreArena* arena)
+{
+    // The branch of the first case is at offset 3 and the flag-modifying `cmp` at offset 0
+    static const struct
+    {
+        ZyanU8 begin;
+        ZyanU8 end;
+        ZyanUSize gadget_count;
+    } ranges[] =
+    {
+        { 0,  5, 1 },   // Only the paths may leave the range
+        { 0,  3, 0 },   // The branch is outside of the range
+        { 3, 17, 0 },   // The flag-modifying instruction is outside of the range
+        { 0,  0, 0 }
+    };
+
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(ranges); ++i)
+    {
+        ResultList list;
+        ResultListInit(&list, sizeof(ZydisSpectreGadget), 4);
+        passed &= ZYAN_SUCCESS(Scan(arena, &TEST_CASES[0], ranges[i].begin, ranges[i].end,
+            &list)) && (list.results.count == ranges[i].gadget_count);
+        ResultListDestroy(&list);
+    }
+
+    ZYAN_PRINTF("%s: begin/end range\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+static ZyanBool TestArguments(ZydisSpectreArena* arena)
+{
+    const TestCase* test = &TEST_CASES[0];
+    ResultList list;
+    ResultListInit(&list, sizeof(ZydisSpectreGadget), 0);
+
+    // The first status code other than `ZYAN_STATUS_SUCCESS` has to stop the scan
+    ZydisSpectreScanner scanner;
+    ZyanBool passed =
+        (Scan(arena, test, 0, test->length, &list) == ZYAN_STATUS_FAILED) &&
+        (ZydisSpectreScannerInit(&scanner, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64,
+            0) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisSpectreScannerInit(&scanner, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64, WINDOW)) &&
+        (ZydisSpectreScan(&scanner, arena, test->code, test->length, RUNTIME_ADDRESS, 5, 4,
+            &CollectGadget, &list) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSpectreScan(&scanner, arena, test->code, test->length, RUNTIME_ADDRESS, 0,
+            test->length + 1, &CollectGadget, &list) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisSpectreScan(&scanner, arena, test->code, test->length, RUNTIME_ADDRESS, 0,
+            test->length, ZYAN_NULL, &list) == ZYAN_STATUS_INVALID_ARGUMENT);
+    ResultListDestroy(&list);
+
+    ZYAN_PRINTF("%s: callback status and invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    static ZydisSpectreArena arena;
+    if (ZYAN_FAILED(ZydisSpectreArenaInit(&arena)))
+    {
+        ZYAN_PRINTF("Failed to initialize arena\n");
+        return 1;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestCases(&arena);
+    all_passed &= TestRange(&arena);
+    all_passed &= TestArguments(&arena);
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
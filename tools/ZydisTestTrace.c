@@ -0,0 +1,586 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the trace codec (`ZydisTraceEncoderAppend`, `ZydisTraceReaderRead`) with traces of
+ * synthetic code.
+ *
+ * The code consists of functions made of basic blocks that end in conditional branches, jumps,
+ * direct and indirect calls and returns. A simple machine executes the code with random branch
+ * decisions, random interrupts and one round of self-modifying code. The decompressed trace is
+ * compared to a second run of the same machine. The compression ratio is checked against a raw
+ * trace of addresses, instruction bytes and memory addresses. The read throughput is printed for
+ * information only.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The number of synthetic functions.
+ */
+#define FUNCTION_COUNT 64
+
+/**
+ * The number of basic blocks per function.
+ */
+#define BLOCK_COUNT 16
+
+/**
+ * The maximum size of the synthetic code.
+ */
+#define CODE_SIZE 0x10000
+
+/**
+ * The number of executed instructions.
+ */
+#define STEP_COUNT 0x800000
+
+/**
+ * The number of steps read at once.
+ */
+#define STEP_BUFFER_SIZE 0x1000
+
+/**
+ * The number of functions that are modified halfway through the trace.
+ */
+#define MODIFIED_FUNCTION_COUNT 8
+
+/**
+ * The runtime address of the synthetic code.
+ */
+#define RUNTIME_ADDRESS 0x7F0000001000
+
+/**
+ * The address of the data read by load instructions.
+ */
+#define HEAP_ADDRESS 0x10000000
+
+/**
+ * The initial stack pointer.
+ */
+#define STACK_ADDRESS 0x7FFF00000000
+
+/**
+ * The maximum call depth of the machine.
+ */
+#define MAX_DEPTH 256
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+typedef enum Kind_
+{
+    KIND_BODY,
+    KIND_LOAD,
+    KIND_STORE,
+    KIND_JCC,
+    KIND_JMP,
+    KIND_CALL,
+    KIND_JMP_REG,
+    KIND_CALL_REG,
+    KIND_RET
+} Kind;
+
+typedef struct Program_
+{
+    ZyanU8 code[CODE_SIZE];
+    ZyanU8 kind[CODE_SIZE];
+    ZyanU8 length[CODE_SIZE];
+    ZyanU8 function[CODE_SIZE];
+    ZyanU8 block[CODE_SIZE];
+    ZyanU32 target[CODE_SIZE];
+    ZyanU32 block_start[FUNCTION_COUNT][BLOCK_COUNT];
+} Program;
+
+typedef struct Buffer_
+{
+    ZyanU8* data;
+    ZyanUSize size;
+    ZyanUSize capacity;
+} Buffer;
+
+typedef struct Machine_
+{
+    Program* program;
+    ZyanU64 random;
+    ZyanU64 pointer;
+    ZyanU64 step;
+    ZyanU32 pc;
+    ZyanU32 depth;
+    ZyanU32 stack[MAX_DEPTH];
+} Machine;
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU32 Random(ZyanU64* state)
+{
+    *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (ZyanU32)(*state >> 33);
+}
+
+static void Emit(Program* program, ZyanU32* offset, Kind kind, const ZyanU8* bytes,
+    ZyanU8 length, ZyanU8 function, ZyanU8 block)
+{
+    ZYAN_MEMCPY(program->code + *offset, bytes, length);
+    program->kind[*offset]     = (ZyanU8)kind;
+    program->length[*offset]   = length;
+    program->function[*offset] = function;
+    program->block[*offset]    = block;
+    program->target[*offset]   = 0;
+    *offset += length;
+}
+
+static void EmitBranch(Program* program, ZyanU32 offset, ZyanU32 target)
+{
+    const ZyanU32 end = offset + program->length[offset];
+    const ZyanU32 displacement = target - end;
+    for (ZyanU32 i = 0; i < 4; ++i)
+    {
+        program->code[end - 4 + i] = (ZyanU8)(displacement >> (i * 8));
+    }
+    program->target[offset] = target;
+}
+
+static ZyanBool GenerateProgram(Program* program)
+{
+    static const struct
+    {
+        Kind kind;
+        ZyanU8 length;
+        ZyanU8 bytes[6];
+    } instructions[] =
+    {
+        { KIND_BODY,     1, { 0x90 } },                               // nop
+        { KIND_BODY,     3, { 0x48, 0x89, 0xC8 } },                   // mov rax, rcx
+        { KIND_BODY,     3, { 0x83, 0xC1, 0x01 } },                   // add ecx, 1
+        { KIND_BODY,     4, { 0x48, 0x8D, 0x04, 0x8B } },             // lea rax, [rbx+rcx*4]
+        { KIND_LOAD,     4, { 0x48, 0x8B, 0x43, 0x08 } },             // mov rax, [rbx+8]
+        { KIND_STORE,    5, { 0x48, 0x89, 0x44, 0x24, 0x08 } },       // mov [rsp+8], rax
+        { KIND_JCC,      6, { 0x0F, 0x84 } },                         // jz rel32
+        { KIND_JMP,      5, { 0xE9 } },                               // jmp rel32
+        { KIND_CALL,     5, { 0xE8 } },                               // call rel32
+        { KIND_JMP_REG,  2, { 0xFF, 0xE0 } },                         // jmp rax
+        { KIND_CALL_REG, 2, { 0xFF, 0xD0 } },                         // call rax
+        { KIND_RET,      1, { 0xC3 } }                                // ret
+    };
+    static const ZyanU8 terminators[] =
+    {
+        KIND_JCC, KIND_JCC, KIND_JCC, KIND_JMP, KIND_CALL, KIND_CALL, KIND_CALL_REG, KIND_JMP_REG
+    };
+    ZyanU32 terminator_offsets[FUNCTION_COUNT * BLOCK_COUNT];
+    ZyanU32 terminator_targets[FUNCTION_COUNT * BLOCK_COUNT];
+    ZyanU32 terminator_count = 0;
+
+    ZYAN_MEMSET(program, 0, sizeof(*program));
+    ZyanU64 state = 0x5A5A5A5A;
+    ZyanU32 offset = 0;
+
+    // Lay out the code, branch targets are resolved once all blocks are placed
+    for (ZyanU8 f = 0; f < FUNCTION_COUNT; ++f)
+    {
+        for (ZyanU8 b = 0; b < BLOCK_COUNT; ++b)
+        {
+            if (offset + 64 > CODE_SIZE)
+            {
+                return ZYAN_FALSE;
+            }
+            program->block_start[f][b] = offset;
+
+            const ZyanU32 body_count = 1 + Random(&state) % 6;
+            for (ZyanU32 i = 0; i < body_count; ++i)
+            {
+                const ZyanUSize j = Random(&state) % 6;
+                Emit(program, &offset, instructions[j].kind, instructions[j].bytes,
+                    instructions[j].length, f, b);
+            }
+
+            Kind kind = (Kind)terminators[Random(&state) % ZYAN_ARRAY_LENGTH(terminators)];
+            if (b == BLOCK_COUNT - 1)
+            {
+                kind = KIND_RET;
+            }
+            if (((kind == KIND_CALL) || (kind == KIND_CALL_REG)) && (f == FUNCTION_COUNT - 1))
+            {
+                kind = KIND_JCC;
+            }
+            ZyanUSize j = 0;
+            while (instructions[j].kind != kind)
+            {
+                ++j;
+            }
+            const ZyanU32 terminator = offset;
+            Emit(program, &offset, kind, instructions[j].bytes, instructions[j].length, f, b);
+
+            // Targets are encoded as (function, block) pairs until the layout is complete
+            switch (kind)
+            {
+            case KIND_JCC:
+                terminator_targets[terminator_count] = f * BLOCK_COUNT +
+                    Random(&state) % BLOCK_COUNT;
+                break;
+            case KIND_JMP:
+                terminator_targets[terminator_count] = f * BLOCK_COUNT + b + 1 +
+                    Random(&state) % (BLOCK_COUNT - b - 1);
+                break;
+            case KIND_CALL:
+                terminator_targets[terminator_count] = (f + 1 +
+                    Random(&state) % (FUNCTION_COUNT - f - 1)) * BLOCK_COUNT;
+                break;
+            default:
+                continue;
+            }
+            terminator_offsets[terminator_count++] = terminator;
+        }
+    }
+
+    for (ZyanU32 i = 0; i < terminator_count; ++i)
+    {
+        const ZyanU32 target = terminator_targets[i];
+        EmitBranch(program, terminator_offsets[i],
+            program->block_start[target / BLOCK_COUNT][target % BLOCK_COUNT]);
+    }
+
+    return ZYAN_TRUE;
+}
+
+static void ModifyProgram(Program* program)
+{
+    // `mov rax, rcx` becomes `mov rdx, rcx`
+    const ZyanU32 end = program->block_start[MODIFIED_FUNCTION_COUNT][0];
+    for (ZyanU32 offset = 0; offset < end; offset += program->length[offset])
+    {
+        if ((program->length[offset] == 3) && (program->code[offset + 2] == 0xC8))
+        {
+            program->code[offset + 2] = 0xCA;
+        }
+    }
+}
+
+static void InitMachine(Machine* machine, Program* program)
+{
+    machine->program = program;
+    machine->random  = 0xC0FFEE;
+    machine->pointer = 0;
+    machine->step    = 0;
+    machine->pc      = 0;
+    machine->depth   = 0;
+}
+
+/**
+ * Executes a single instruction and returns its code offset and memory address.
+ */
+static ZyanU32 Step(Machine* machine, ZyanU64* memory_address)
+{
+    Program* const program = machine->program;
+    if (machine->step++ == STEP_COUNT / 2)
+    {
+        ModifyProgram(program);
+    }
+
+    const ZyanU32 pc = machine->pc;
+    const ZyanU8 function = program->function[pc];
+    const ZyanU8 block = program->block[pc];
+    ZyanU32 next = pc + program->length[pc];
+    *memory_address = 0;
+
+    switch (program->kind[pc])
+    {
+    case KIND_BODY:
+        break;
+    case KIND_LOAD:
+        *memory_address = HEAP_ADDRESS + 8 + machine->pointer;
+        machine->pointer = (machine->pointer + 24) % 0x100000;
+        break;
+    case KIND_STORE:
+        *memory_address = STACK_ADDRESS - machine->depth * 64 + 8;
+        break;
+    case KIND_JCC:
+        // Backward branches are loops and usually taken
+        if (Random(&machine->random) % 8 < ((program->target[pc] <= pc) ? 6u : 4u))
+        {
+            next = program->target[pc];
+        }
+        break;
+    case KIND_JMP:
+        next = program->target[pc];
+        break;
+    case KIND_CALL:
+    case KIND_CALL_REG:
+        if (machine->depth == MAX_DEPTH)
+        {
+            break;
+        }
+        machine->stack[machine->depth++] = next;
+        next = (program->kind[pc] == KIND_CALL) ? program->target[pc] :
+            program->block_start[function + 1 +
+                Random(&machine->random) % (FUNCTION_COUNT - function - 1)][0];
+        break;
+    case KIND_JMP_REG:
+        next = program->block_start[function][block + 1 +
+            Random(&machine->random) % (BLOCK_COUNT - block - 1)];
+        break;
+    case KIND_RET:
+        next = machine->depth ? machine->stack[--machine->depth] :
+            program->block_start[Random(&machine->random) % FUNCTION_COUNT][0];
+        break;
+    default:
+        ZYAN_UNREACHABLE;
+    }
+
+    // Interrupts
+    if (!(Random(&machine->random) % 4096) && (machine->depth < MAX_DEPTH))
+    {
+        machine->stack[machine->depth++] = next;
+        next = program->block_start[Random(&machine->random) % FUNCTION_COUNT][0];
+    }
+
+    machine->pc = next;
+    return pc;
+}
+
+static ZyanStatus WriteBuffer(void* user_data, const void* data, ZyanUSize length)
+{
+    Buffer* const buffer = user_data;
+    if (buffer->capacity - buffer->size < length)
+    {
+        const ZyanUSize capacity = ZYAN_MAX(buffer->capacity * 2, buffer->size + length);
+        ZyanU8* const data = realloc(buffer->data, capacity);
+        if (!data)
+        {
+            return ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    ZYAN_MEMCPY(buffer->data + buffer->size, data, length);
+    buffer->size += length;
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestRoundTrip(void)
+{
+    Buffer trace = { ZYAN_NULL, 0, 0 };
+    Program* program = malloc(sizeof(Program));
+    void* workspace = ZYAN_NULL;
+    ZydisTraceStep* steps = ZYAN_NULL;
+    ZyanBool passed = ZYAN_FALSE;
+    if (!program || !GenerateProgram(program))
+    {
+        ZYAN_PRINTF("FAILED: Could not generate code\n");
+        goto cleanup;
+    }
+
+    // Compress
+    ZydisTraceEncoder encoder;
+    ZyanUSize size;
+    if (ZYAN_FAILED(ZydisTraceEncoderGetWorkspaceSize(0x10000, &size)) ||
+        !(workspace = malloc(size)) ||
+        ZYAN_FAILED(ZydisTraceEncoderInit(&encoder, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64, 0x10000, workspace, size, &WriteBuffer, &trace)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisTraceEncoderInit\n");
+        goto cleanup;
+    }
+    Machine machine;
+    InitMachine(&machine, program);
+    ZyanU64 raw_size = 0;
+    for (ZyanU32 i = 0; i < STEP_COUNT; ++i)
+    {
+        ZyanU64 memory_address;
+        const ZyanU32 pc = Step(&machine, &memory_address);
+        const ZyanU8 length = program->length[pc];
+        raw_size += 8 + 1 + length + ((program->kind[pc] == KIND_LOAD) ||
+            (program->kind[pc] == KIND_STORE) ? 8 : 0);
+        if (ZYAN_FAILED(ZydisTraceEncoderAppend(&encoder, RUNTIME_ADDRESS + pc,
+            program->code + pc, length, memory_address)))
+        {
+            ZYAN_PRINTF("FAILED: ZydisTraceEncoderAppend at step %u\n", i);
+            goto cleanup;
+        }
+    }
+    if (ZYAN_FAILED(ZydisTraceEncoderFinish(&encoder)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisTraceEncoderFinish\n");
+        goto cleanup;
+    }
+    free(workspace);
+    workspace = ZYAN_NULL;
+
+    // Decompress and compare to a second run
+    ZydisTraceReader reader;
+    if (ZYAN_FAILED(ZydisTraceReaderGetWorkspaceSize(trace.data, trace.size, ZYAN_TRUE,
+            &size)) ||
+        !(workspace = malloc(size)) ||
+        ZYAN_FAILED(ZydisTraceReaderInit(&reader, trace.data, trace.size, ZYAN_TRUE, workspace,
+            size)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisTraceReaderInit\n");
+        goto cleanup;
+    }
+    steps = malloc(STEP_BUFFER_SIZE * sizeof(ZydisTraceStep));
+    if (!steps)
+    {
+        ZYAN_PRINTF("FAILED: Out of memory\n");
+        goto cleanup;
+    }
+    ZyanUSize count = 0;
+    ZyanUSize read = 0;
+    const clock_t time = clock();
+    while (ZYAN_SUCCESS(ZydisTraceReaderRead(&reader, steps, STEP_BUFFER_SIZE, &read)) && read)
+    {
+        count += read;
+    }
+    const double seconds = (double)(clock() - time) / CLOCKS_PER_SEC;
+    if (count != STEP_COUNT)
+    {
+        ZYAN_PRINTF("FAILED: Read %zu of %u steps\n", count, STEP_COUNT);
+        goto cleanup;
+    }
+
+    InitMachine(&machine, program);
+    GenerateProgram(program);
+    if (ZYAN_FAILED(ZydisTraceReaderInit(&reader, trace.data, trace.size, ZYAN_TRUE, workspace,
+        size)))
+    {
+        ZYAN_PRINTF("FAILED: ZydisTraceReaderInit\n");
+        goto cleanup;
+    }
+    for (ZyanU32 i = 0; i < STEP_COUNT; i += (ZyanU32)read)
+    {
+        if (ZYAN_FAILED(ZydisTraceReaderRead(&reader, steps, STEP_BUFFER_SIZE, &read)))
+        {
+            ZYAN_PRINTF("FAILED: ZydisTraceReaderRead at step %u\n", i);
+            goto cleanup;
+        }
+        for (ZyanUSize j = 0; j < read; ++j)
+        {
+            ZyanU64 memory_address;
+            const ZyanU32 pc = Step(&machine, &memory_address);
+            const ZydisTraceEntry* const entry =
+                ZydisTraceReaderGetEntry(&reader, steps[j].entry);
+            if (!entry || (steps[j].address != (ZyanU64)RUNTIME_ADDRESS + pc) ||
+                (steps[j].memory_address != memory_address) ||
+                (entry->address != steps[j].address) ||
+                (entry->length != program->length[pc]) ||
+                ZYAN_MEMCMP(entry->bytes, program->code + pc, entry->length))
+            {
+                ZYAN_PRINTF("FAILED: Step %zu differs\n", i + j);
+                goto cleanup;
+            }
+        }
+    }
+    if (ZydisTraceReaderRead(&reader, steps, 1, &read) != ZYDIS_STATUS_NO_MORE_DATA)
+    {
+        ZYAN_PRINTF("FAILED: Trace does not end after %u steps\n", STEP_COUNT);
+        goto cleanup;
+    }
+
+    // Lazily decoded instructions
+    for (ZyanU32 i = 0; i < reader.entry_count; ++i)
+    {
+        const ZydisTraceEntry* const entry = ZydisTraceReaderGetEntry(&reader, i);
+        ZydisDecodedInstruction first;
+        ZydisDecodedInstruction second;
+        if (ZYAN_FAILED(ZydisTraceReaderDecodeInstruction(&reader, i, &first)) ||
+            ZYAN_FAILED(ZydisTraceReaderDecodeInstruction(&reader, i, &second)) ||
+            (first.length != entry->length) || (first.mnemonic != second.mnemonic))
+        {
+            ZYAN_PRINTF("FAILED: ZydisTraceReaderDecodeInstruction for entry %u\n", i);
+            goto cleanup;
+        }
+    }
+
+    // Truncated traces are rejected
+    ZydisTraceReader truncated;
+    if (ZYAN_SUCCESS(ZydisTraceReaderInit(&truncated, trace.data, trace.size - 1, ZYAN_TRUE,
+        workspace, size)))
+    {
+        ZYAN_PRINTF("FAILED: Truncated trace accepted\n");
+        goto cleanup;
+    }
+
+    const double ratio = (double)raw_size / (double)trace.size;
+    if (ratio < 10.0)
+    {
+        ZYAN_PRINTF("FAILED: Compression ratio %.1f\n", ratio);
+        goto cleanup;
+    }
+
+    passed = ZYAN_TRUE;
+    ZYAN_PRINTF("PASSED: round trip (%u instructions, %u entries, %zu bytes, ratio %.1f, "
+        "%.1f M instructions/s, %.2f GB/s raw)\n", STEP_COUNT, reader.entry_count, trace.size,
+        ratio, (seconds > 0) ? STEP_COUNT / seconds / 1000000 : 0.0,
+        (seconds > 0) ? (double)raw_size / seconds / 1000000000 : 0.0);
+
+cleanup:
+    free(steps);
+    free(workspace);
+    free(trace.data);
+    free(program);
+    if (!passed)
+    {
+        ZYAN_PRINTF("FAILED: round trip\n");
+    }
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestRoundTrip();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        return 1;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    return 0;
+}
+
+/* ============================================================================================== */
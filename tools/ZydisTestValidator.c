@@ -0,0 +1,878 @@
+/***************************************************************************************************
+
+  Zyan Disassembler Library (Zydis)
+
+  Original Author : Florian Bernd
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+
+***************************************************************************************************/
+
+/**
+ * @file
+ *
+ * Tests the sandbox validator (`ZydisValidator*`).
+ *
+ * Every violation type is triggered by a single instruction behind a `nop`, including the
+ * order in which the checks are applied. Instructions are placed at every offset around the
+ * bundle boundaries and the stream is split into chunks at bundle and instruction boundaries, as
+ * the bundle checks and the reported offsets have to use the offset within the whole stream.
+ *
+ * Streams of repeated instruction forms with random displacement and immediate bytes exercise the
+ * instruction cache, which has to report the same violations as a plain decoder loop.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <Zycore/LibC.h>
+#include <Zydis/Zydis.h>
+
+/* ============================================================================================== */
+/* Macros                                                                                         */
+/* ============================================================================================== */
+
+/**
+ * The length of the `nop` in front of the instruction of a test case.
+ */
+#define PADDING 3
+
+/**
+ * The number of bundles of the generated stream.
+ */
+#define BUNDLE_COUNT 512
+
+/**
+ * The bundle size of the generated stream.
+ */
+#define BUNDLE_SIZE ZYDIS_VALIDATOR_DEFAULT_BUNDLE_SIZE
+
+#define STREAM_SIZE (BUNDLE_COUNT * BUNDLE_SIZE)
+
+/**
+ * The number of chunked validations of the generated stream.
+ */
+#define SPLIT_COUNT 200
+
+/**
+ * The number of instruction forms of a cache test stream.
+ */
+#define CACHE_FORM_COUNT 32
+
+/**
+ * The number of cache test streams per machine mode.
+ */
+#define CACHE_ROUNDS 32
+
+/* ============================================================================================== */
+/* Enums and Types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Modifies the policy that allows all mnemonics and ISA-sets.
+ */
+typedef enum PolicyChange_
+{
+    POLICY_DEFAULT              = 0,
+    POLICY_DENY_MNEMONIC        = 1,
+    POLICY_DENY_ISA_SET         = 2,
+    POLICY_ALLOW_PRIVILEGED     = 4,
+    POLICY_ALLOW_SYSTEM_CALLS   = 8,
+    POLICY_ALLOW_BREAKPOINTS    = 16
+} PolicyChange;
+
+typedef struct TestCase_
+{
+    const char* name;
+    ZyanU8 length;
+    ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+    ZyanU32 policy;
+    ZydisValidatorViolationType type;
+    ZydisMnemonic mnemonic;
+} TestCase;
+
+typedef struct TestInstruction_
+{
+    ZyanU8 length;
+    ZyanU8 code[ZYDIS_MAX_INSTRUCTION_LENGTH];
+} TestInstruction;
+
+/**
+ * A stream of allowed instructions that never cross a bundle boundary.
+ */
+typedef struct Stream_
+{
+    ZyanU8 code[STREAM_SIZE];
+    /**
+     * The offsets of all instructions, followed by `STREAM_SIZE`.
+     */
+    ZyanU32 offsets[STREAM_SIZE + 1];
+    ZyanUSize count;
+} Stream;
+
+/* ============================================================================================== */
+/* Test cases                                                                                     */
+/* ============================================================================================== */
+
+#define NONE        ZYDIS_VALIDATOR_VIOLATION_NONE
+#define INVALID     ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION
+#define MNEMONIC    ZYDIS_VALIDATOR_VIOLATION_MNEMONIC
+#define ISA_SET     ZYDIS_VALIDATOR_VIOLATION_ISA_SET
+#define PRIVILEGED  ZYDIS_VALIDATOR_VIOLATION_PRIVILEGED
+#define SYSTEM_CALL ZYDIS_VALIDATOR_VIOLATION_SYSTEM_CALL
+#define BREAKPOINT  ZYDIS_VALIDATOR_VIOLATION_BREAKPOINT
+
+static const TestCase TEST_CASES[] =
+{
+    { "add rax, rcx", 3, { 0x48, 0x01, 0xC8 }, POLICY_DEFAULT, NONE, ZYDIS_MNEMONIC_INVALID },
+    { "add rax, rcx (mnemonic denied)", 3, { 0x48, 0x01, 0xC8 }, POLICY_DENY_MNEMONIC,
+        MNEMONIC, ZYDIS_MNEMONIC_ADD },
+    { "vaddps ymm0, ymm0, ymm1 (isa set denied)", 4, { 0xC5, 0xFC, 0x58, 0xC1 },
+        POLICY_DENY_ISA_SET, ISA_SET, ZYDIS_MNEMONIC_VADDPS },
+    { "vaddps ymm0, ymm0, ymm1 (both denied)", 4, { 0xC5, 0xFC, 0x58, 0xC1 },
+        POLICY_DENY_MNEMONIC | POLICY_DENY_ISA_SET, MNEMONIC, ZYDIS_MNEMONIC_VADDPS },
+    { "hlt", 1, { 0xF4 }, POLICY_DEFAULT, PRIVILEGED, ZYDIS_MNEMONIC_HLT },
+    { "hlt (privileged allowed)", 1, { 0xF4 }, POLICY_ALLOW_PRIVILEGED, NONE,
+        ZYDIS_MNEMONIC_INVALID },
+    { "hlt (isa set denied)", 1, { 0xF4 }, POLICY_DENY_ISA_SET, ISA_SET, ZYDIS_MNEMONIC_HLT },
+    { "mov cr0, rax", 3, { 0x0F, 0x22, 0xC0 }, POLICY_DEFAULT, PRIVILEGED, ZYDIS_MNEMONIC_MOV },
+    { "wrmsr", 2, { 0x0F, 0x30 }, POLICY_DEFAULT, PRIVILEGED, ZYDIS_MNEMONIC_WRMSR },
+    { "syscall", 2, { 0x0F, 0x05 }, POLICY_DEFAULT, SYSTEM_CALL, ZYDIS_MNEMONIC_SYSCALL },
+    { "syscall (system calls allowed)", 2, { 0x0F, 0x05 }, POLICY_ALLOW_SYSTEM_CALLS, NONE,
+        ZYDIS_MNEMONIC_INVALID },
+    { "sysenter", 2, { 0x0F, 0x34 }, POLICY_DEFAULT, SYSTEM_CALL, ZYDIS_MNEMONIC_SYSENTER },
+    { "int 0x80", 2, { 0xCD, 0x80 }, POLICY_DEFAULT, SYSTEM_CALL, ZYDIS_MNEMONIC_INT },
+    { "int 0x80 (breakpoints allowed)", 2, { 0xCD, 0x80 }, POLICY_ALLOW_BREAKPOINTS, SYSTEM_CALL,
+        ZYDIS_MNEMONIC_INT },
+    { "int3", 1, { 0xCC }, POLICY_DEFAULT, BREAKPOINT, ZYDIS_MNEMONIC_INT3 },
+    { "int3 (system calls allowed)", 1, { 0xCC }, POLICY_ALLOW_SYSTEM_CALLS, BREAKPOINT,
+        ZYDIS_MNEMONIC_INT3 },
+    { "int3 (breakpoints allowed)", 1, { 0xCC }, POLICY_ALLOW_BREAKPOINTS, NONE,
+        ZYDIS_MNEMONIC_INVALID },
+    { "int1", 1, { 0xF1 }, POLICY_DEFAULT, BREAKPOINT, ZYDIS_MNEMONIC_INT1 },
+    { "ud2", 2, { 0x0F, 0x0B }, POLICY_DEFAULT, BREAKPOINT, ZYDIS_MNEMONIC_UD2 },
+    { "ud1 eax, [rax]", 3, { 0x0F, 0xB9, 0x00 }, POLICY_DEFAULT, BREAKPOINT,
+        ZYDIS_MNEMONIC_UD1 },
+    { "sysret", 3, { 0x48, 0x0F, 0x07 }, POLICY_DEFAULT, PRIVILEGED, ZYDIS_MNEMONIC_SYSRET },
+    { "sysret (privileged allowed)", 3, { 0x48, 0x0F, 0x07 }, POLICY_ALLOW_PRIVILEGED,
+        SYSTEM_CALL, ZYDIS_MNEMONIC_SYSRET },
+    { "sysret (both allowed)", 3, { 0x48, 0x0F, 0x07 },
+        POLICY_ALLOW_PRIVILEGED | POLICY_ALLOW_SYSTEM_CALLS, NONE, ZYDIS_MNEMONIC_INVALID },
+    { "push es", 1, { 0x06 }, POLICY_DEFAULT, INVALID, ZYDIS_MNEMONIC_INVALID },
+    { "truncated mov rax, imm64", 3, { 0x48, 0xB8, 0x00 }, POLICY_DEFAULT, INVALID,
+        ZYDIS_MNEMONIC_INVALID }
+};
+
+/**
+ * The instructions of the generated stream.
+ */
+static const TestInstruction INSTRUCTIONS[] =
+{
+    // nop
+    { 1, { 0x90 } },
+    // push rbx
+    { 1, { 0x53 } },
+    // add rax, rcx
+    { 3, { 0x48, 0x01, 0xC8 } },
+    // lea rax, [rbx+rcx*4]
+    { 4, { 0x48, 0x8D, 0x04, 0x8B } },
+    // vaddps ymm0, ymm0, ymm1
+    { 4, { 0xC5, 0xFC, 0x58, 0xC1 } },
+    // mov eax, [rip+0x100]
+    { 6, { 0x8B, 0x05, 0x00, 0x01, 0x00, 0x00 } },
+    // mov rax, 0x1122334455667788
+    { 10, { 0x48, 0xB8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11 } },
+    // nop word cs:[rax+rax*1]
+    { 15, { 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00,
+        0x00 } }
+};
+
+/**
+ * The bundle sizes of the bundle boundary tests. `0` disables the checks.
+ */
+static const ZyanU32 BUNDLE_SIZES[] = { 0, 16, 32, 64 };
+
+/* ============================================================================================== */
+/* Helper functions                                                                               */
+/* ============================================================================================== */
+
+static ZyanU64 NextRandom(ZyanU64* state)
+{
+    ZyanU64 x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * Initializes a policy that allows all mnemonics and ISA-sets.
+ */
+static ZyanStatus InitPolicy(ZydisValidatorPolicy* policy)
+{
+    ZYAN_CHECK(ZydisValidatorPolicyInit(policy));
+    for (ZyanUSize i = 0; i <= ZYDIS_MNEMONIC_MAX_VALUE; ++i)
+    {
+        ZYAN_CHECK(ZydisValidatorPolicyAllowMnemonic(policy, (ZydisMnemonic)i, ZYAN_TRUE));
+    }
+    for (ZyanUSize i = 0; i <= ZYDIS_ISA_SET_MAX_VALUE; ++i)
+    {
+        ZYAN_CHECK(ZydisValidatorPolicyAllowISASet(policy, (ZydisISASet)i, ZYAN_TRUE));
+    }
+    return ZYAN_STATUS_SUCCESS;
+}
+
+/**
+ * Validates the chunks `[splits[i], splits[i + 1])` and stops at the first violation.
+ *
+ * @return  The index of the chunk that contains the violation or `count`, if there is none.
+ */
+static ZyanUSize ValidateChunks(ZydisValidator* validator, const ZyanU8* code,
+    const ZyanUSize* splits, ZyanUSize count, ZydisValidatorViolation* violation)
+{
+    for (ZyanUSize i = 0; i < count; ++i)
+    {
+        const ZyanStatus status = ZydisValidatorValidate(validator, code + splits[i],
+            splits[i + 1] - splits[i], violation);
+        if (status != ZYAN_STATUS_TRUE)
+        {
+            return (status == ZYAN_STATUS_FALSE) ? i : ~(ZyanUSize)0;
+        }
+    }
+    return count;
+}
+
+static ZyanBool CheckViolation(const char* name, const ZydisValidatorViolation* violation,
+    ZydisValidatorViolationType type, ZyanU64 offset, ZydisMnemonic mnemonic, ZyanU8 length)
+{
+    const ZyanBool is_invalid = (type == ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION);
+    if ((violation->type != type) || (violation->offset != offset) ||
+        (violation->mnemonic != mnemonic) || (violation->length != length) ||
+        (is_invalid == ZYAN_SUCCESS(violation->status)))
+    {
+        ZYAN_PRINTF("FAILED: %s: type %d at 0x%04" PRIX64 " (%s, %u), expected type %d at "
+            "0x%04" PRIX64 " (%s, %u)\n", name, violation->type, violation->offset,
+            ZydisMnemonicGetString(violation->mnemonic), violation->length, type, offset,
+            ZydisMnemonicGetString(mnemonic), length);
+        return ZYAN_FALSE;
+    }
+    return ZYAN_TRUE;
+}
+
+/**
+ * Generates a stream of instructions that are padded with `nop`s to the bundle boundaries.
+ */
+static void GenerateStream(Stream* stream, ZyanU64* state)
+{
+    ZyanUSize offset = 0;
+    stream->count = 0;
+    while (offset < STREAM_SIZE)
+    {
+        const TestInstruction* instruction =
+            &INSTRUCTIONS[NextRandom(state) % ZYAN_ARRAY_LENGTH(INSTRUCTIONS)];
+        if ((offset % BUNDLE_SIZE) + instruction->length > BUNDLE_SIZE)
+        {
+            instruction = &INSTRUCTIONS[0];
+        }
+        ZYAN_MEMCPY(stream->code + offset, instruction->code, instruction->length);
+        stream->offsets[stream->count++] = (ZyanU32)offset;
+        offset += instruction->length;
+    }
+    stream->offsets[stream->count] = STREAM_SIZE;
+}
+
+/**
+ * Picks pseudo-random split points in ascending order.
+ *
+ * @param   bundles_only    `ZYAN_TRUE` to split at bundle boundaries only or `ZYAN_FALSE` to split
+ *                          at any instruction boundary.
+ *
+ * @return  The number of chunks.
+ */
+static ZyanUSize GenerateSplits(const Stream* stream, ZyanBool bundles_only, ZyanU64* state,
+    ZyanUSize* splits)
+{
+    ZyanUSize count = 0;
+    splits[count++] = 0;
+    for (ZyanUSize i = 1; i < stream->count; ++i)
+    {
+        const ZyanU32 offset = stream->offsets[i];
+        if ((!bundles_only || !(offset % BUNDLE_SIZE)) && !(NextRandom(state) % 16))
+        {
+            splits[count++] = offset;
+        }
+    }
+    splits[count] = STREAM_SIZE;
+    return count;
+}
+
+/**
+ * Generates a stream of random instruction forms with random bytes behind the byte that follows
+ * the opcode.
+ *
+ * A form consists of an optional `66`, `F3` or `F2` prefix, an optional `REX` prefix, an opcode
+ * map escape, the opcode and the byte that follows it. Forms that do not decode to a valid
+ * instruction are replaced, but some invalid bytes are kept to test the reported offsets.
+ */
+static void GenerateCacheStream(const ZydisDecoder* decoder, ZyanU8* code, ZyanU64* state)
+{
+    static const ZyanU8 PREFIXES[4] = { 0x00, 0x66, 0xF3, 0xF2 };
+    static const ZyanU8 ESCAPES[4][2] = { { 0 }, { 0x0F }, { 0x0F, 0x38 }, { 0x0F, 0x3A } };
+
+    ZyanU8 forms[CACHE_FORM_COUNT][6];
+    ZyanU8 form_lengths[CACHE_FORM_COUNT];
+    for (ZyanUSize i = 0; i < CACHE_FORM_COUNT; ++i)
+    {
+        const ZyanU64 value = NextRandom(state);
+        ZyanU8 length = 0;
+        if (PREFIXES[value & 3])
+        {
+            forms[i][length++] = PREFIXES[value & 3];
+        }
+        if ((decoder->machine_mode == ZYDIS_MACHINE_MODE_LONG_64) && (value & 4))
+        {
+            forms[i][length++] = 0x40 | ((value >> 3) & 0x0F);
+        }
+        for (ZyanUSize j = 0; (j < 2) && ESCAPES[(value >> 7) & 3][j]; ++j)
+        {
+            forms[i][length++] = ESCAPES[(value >> 7) & 3][j];
+        }
+        forms[i][length++] = (ZyanU8)(value >> 9);
+        forms[i][length++] = (ZyanU8)(value >> 17);
+        form_lengths[i] = length;
+    }
+
+    ZyanUSize offset = 0;
+    while (offset < STREAM_SIZE)
+    {
+        const ZyanU64 value = NextRandom(state);
+        const ZyanUSize index = value % CACHE_FORM_COUNT;
+        ZyanU8 instruction_bytes[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZYAN_MEMCPY(instruction_bytes, forms[index], form_lengths[index]);
+        for (ZyanUSize i = form_lengths[index]; i < sizeof(instruction_bytes); ++i)
+        {
+            instruction_bytes[i] = (ZyanU8)NextRandom(state);
+        }
+
+        ZydisDecoderContext context;
+        ZydisDecodedInstruction instruction;
+        ZyanUSize length = form_lengths[index];
+        if (ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(decoder, &context, instruction_bytes,
+            sizeof(instruction_bytes), &instruction)))
+        {
+            length = instruction.length;
+        } else if ((value >> 32) % 64)
+        {
+            // Replace the form to keep most of the stream valid
+            const ZyanU64 replacement = NextRandom(state);
+            forms[index][form_lengths[index] - 2] = (ZyanU8)replacement;
+            forms[index][form_lengths[index] - 1] = (ZyanU8)(replacement >> 8);
+            continue;
+        }
+
+        length = ZYAN_MIN(length, STREAM_SIZE - offset);
+        ZYAN_MEMCPY(code + offset, instruction_bytes, length);
+        offset += length;
+    }
+}
+
+/**
+ * Checks a single instruction of a cache test stream. All instructions are allowed, except for
+ * the denied mnemonics.
+ *
+ * @return  The violation type.
+ */
+static ZydisValidatorViolationType CheckCacheInstruction(const ZydisDecoder* decoder,
+    const ZydisValidatorPolicy* policy, const ZyanU8* code, ZyanUSize length,
+    ZyanU64 stream_offset, ZydisDecodedInstruction* instruction)
+{
+    ZydisDecoderContext context;
+    if (ZYAN_FAILED(ZydisDecoderDecodeInstruction(decoder, &context, code, length,
+        instruction)))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION;
+    }
+    if (!((policy->mnemonics[instruction->mnemonic / 64] >> (instruction->mnemonic % 64)) & 1))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_MNEMONIC;
+    }
+    if (policy->bundle_size &&
+        ((stream_offset % policy->bundle_size) + instruction->length > policy->bundle_size))
+    {
+        return ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING;
+    }
+    return ZYDIS_VALIDATOR_VIOLATION_NONE;
+}
+
+/* ============================================================================================== */
+/* Tests                                                                                          */
+/* ============================================================================================== */
+
+static ZyanBool TestViolations(void)
+{
+    ZyanBool all_passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(TEST_CASES); ++i)
+    {
+        const TestCase* const test = &TEST_CASES[i];
+
+        // `nop dword ptr [rax]` is neither in the mnemonic nor in the ISA-set of any test case
+        ZyanU8 code[PADDING + ZYDIS_MAX_INSTRUCTION_LENGTH] = { 0x0F, 0x1F, 0x00 };
+        ZYAN_MEMCPY(code + PADDING, test->code, test->length);
+
+        ZydisDecoder decoder;
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        ZydisValidatorPolicy policy;
+        if (ZYAN_FAILED(ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64,
+                ZYDIS_STACK_WIDTH_64)) ||
+            ZYAN_FAILED(InitPolicy(&policy)))
+        {
+            ZYAN_PRINTF("FAILED: %s: initialization\n", test->name);
+            all_passed = ZYAN_FALSE;
+            continue;
+        }
+        if (ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, test->code, test->length, &instruction,
+            operands)))
+        {
+            ZydisValidatorPolicyAllowMnemonic(&policy, instruction.mnemonic,
+                !(test->policy & POLICY_DENY_MNEMONIC));
+            ZydisValidatorPolicyAllowISASet(&policy, instruction.meta.isa_set,
+                !(test->policy & POLICY_DENY_ISA_SET));
+        }
+        policy.allow_privileged = (test->policy & POLICY_ALLOW_PRIVILEGED) ? 1 : 0;
+        policy.allow_system_calls = (test->policy & POLICY_ALLOW_SYSTEM_CALLS) ? 1 : 0;
+        policy.allow_breakpoints = (test->policy & POLICY_ALLOW_BREAKPOINTS) ? 1 : 0;
+
+        ZydisValidator validator;
+        ZydisValidatorViolation violation;
+        if (ZYAN_FAILED(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64, &policy)))
+        {
+            ZYAN_PRINTF("FAILED: %s: initialization\n", test->name);
+            all_passed = ZYAN_FALSE;
+            continue;
+        }
+        const ZyanStatus status = ZydisValidatorValidate(&validator, code,
+            PADDING + test->length, &violation);
+
+        const ZyanBool is_violation = (test->type != ZYDIS_VALIDATOR_VIOLATION_NONE);
+        const ZyanBool is_invalid = (test->type == ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION);
+        if (status != (is_violation ? ZYAN_STATUS_FALSE : ZYAN_STATUS_TRUE))
+        {
+            ZYAN_PRINTF("FAILED: %s: status 0x%08" PRIX32 "\n", test->name, status);
+            all_passed = ZYAN_FALSE;
+            continue;
+        }
+        if (!CheckViolation(test->name, &violation, test->type, is_violation ? PADDING : 0,
+            test->mnemonic, (is_violation && !is_invalid) ? test->length : 0))
+        {
+            all_passed = ZYAN_FALSE;
+            continue;
+        }
+
+        ZYAN_PRINTF("PASSED: %s\n", test->name);
+    }
+
+    return all_passed;
+}
+
+/**
+ * Places every instruction at every offset of the first bundles, validated in one chunk and in
+ * two chunks split in front of the instruction.
+ */
+static ZyanBool TestBundleEdges(void)
+{
+    ZydisValidatorPolicy policy;
+    if (ZYAN_FAILED(InitPolicy(&policy)))
+    {
+        ZYAN_PRINTF("FAILED: bundle edges: initialization\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanU8 code[3 * 64 + ZYDIS_MAX_INSTRUCTION_LENGTH];
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 0; (i < ZYAN_ARRAY_LENGTH(BUNDLE_SIZES)) && passed; ++i)
+    {
+        const ZyanU32 bundle_size = BUNDLE_SIZES[i];
+        passed = ZYAN_SUCCESS(ZydisValidatorPolicySetBundleSize(&policy, bundle_size));
+        for (ZyanUSize j = 0; (j < ZYAN_ARRAY_LENGTH(INSTRUCTIONS)) && passed; ++j)
+        {
+            const TestInstruction* const instruction = &INSTRUCTIONS[j];
+            for (ZyanUSize offset = 0; (offset <= 2 * 64) && passed; ++offset)
+            {
+                const ZyanUSize length = offset + instruction->length;
+                ZYAN_MEMSET(code, 0x90, offset);
+                ZYAN_MEMCPY(code + offset, instruction->code, instruction->length);
+
+                const ZyanBool is_crossing = bundle_size &&
+                    ((offset % bundle_size) + instruction->length > bundle_size);
+                for (ZyanUSize chunks = 1; (chunks <= 2) && passed; ++chunks)
+                {
+                    const ZyanUSize splits[3] = { 0, (chunks == 1) ? length : offset, length };
+                    ZydisValidator validator;
+                    ZydisValidatorViolation violation;
+                    passed = ZYAN_SUCCESS(ZydisValidatorInit(&validator,
+                        ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64, &policy));
+                    const ZyanUSize chunk = ValidateChunks(&validator, code, splits, chunks,
+                        &violation);
+                    if (!passed || (chunk != (is_crossing ? chunks - 1 : chunks)) ||
+                        (is_crossing && !CheckViolation("bundle edges", &violation,
+                            ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING, offset,
+                            violation.mnemonic, instruction->length)))
+                    {
+                        ZYAN_PRINTF("FAILED: bundle edges: bundle size %" PRIu32 ", length %u "
+                            "at offset %zu in %zu chunks\n", bundle_size, instruction->length,
+                            offset, chunks);
+                        passed = ZYAN_FALSE;
+                    }
+                }
+            }
+        }
+    }
+
+    // Policy violations are reported in place of bundle crossings
+    static const ZyanU8 SYSCALL[2] = { 0x0F, 0x05 };
+    ZYAN_MEMSET(code, 0x90, BUNDLE_SIZE - 1);
+    ZYAN_MEMCPY(code + BUNDLE_SIZE - 1, SYSCALL, sizeof(SYSCALL));
+    ZydisValidator validator;
+    ZydisValidatorViolation violation;
+    passed &= ZYAN_SUCCESS(ZydisValidatorPolicySetBundleSize(&policy, BUNDLE_SIZE)) &&
+        ZYAN_SUCCESS(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64, &policy)) &&
+        (ZydisValidatorValidate(&validator, code, BUNDLE_SIZE + 1, &violation) ==
+            ZYAN_STATUS_FALSE) &&
+        CheckViolation("bundle edges", &violation, ZYDIS_VALIDATOR_VIOLATION_SYSTEM_CALL,
+            BUNDLE_SIZE - 1, ZYDIS_MNEMONIC_SYSCALL, sizeof(SYSCALL));
+
+    if (passed)
+    {
+        ZYAN_PRINTF("PASSED: bundle edges\n");
+    }
+    return passed;
+}
+
+/**
+ * Validates a generated stream in chunks and injects violations.
+ */
+static ZyanBool TestChunks(Stream* stream, ZyanUSize* splits)
+{
+    ZydisValidatorPolicy policy;
+    if (ZYAN_FAILED(InitPolicy(&policy)))
+    {
+        ZYAN_PRINTF("FAILED: chunks: initialization\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanU64 state = 0x6A09E667F3BCC908ULL;
+    GenerateStream(stream, &state);
+    for (ZyanUSize i = 0; i < SPLIT_COUNT; ++i)
+    {
+        const ZyanUSize count = GenerateSplits(stream, (i % 2) == 0, &state, splits);
+
+        // The unmodified stream is valid
+        ZydisValidator validator;
+        ZydisValidatorViolation violation;
+        if (ZYAN_FAILED(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+                ZYDIS_STACK_WIDTH_64, &policy)) ||
+            (ValidateChunks(&validator, stream->code, splits, count, &violation) != count))
+        {
+            ZYAN_PRINTF("FAILED: chunks: valid stream (split %zu)\n", i);
+            return ZYAN_FALSE;
+        }
+
+        // Replace an instruction with a `syscall` and `nop`s
+        ZyanUSize index;
+        do
+        {
+            index = (ZyanUSize)(NextRandom(&state) % stream->count);
+        } while (stream->offsets[index + 1] - stream->offsets[index] < 2);
+        const ZyanU32 offset = stream->offsets[index];
+        const ZyanU8 length = (ZyanU8)(stream->offsets[index + 1] - offset);
+        ZyanU8 original[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZYAN_MEMCPY(original, stream->code + offset, length);
+        ZYAN_MEMSET(stream->code + offset, 0x90, length);
+        stream->code[offset] = 0x0F;
+        stream->code[offset + 1] = 0x05;
+
+        ZyanUSize expected = 0;
+        while (splits[expected + 1] <= offset)
+        {
+            ++expected;
+        }
+        const ZyanBool passed =
+            ZYAN_SUCCESS(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+                ZYDIS_STACK_WIDTH_64, &policy)) &&
+            (ValidateChunks(&validator, stream->code, splits, count, &violation) == expected) &&
+            CheckViolation("chunks", &violation, ZYDIS_VALIDATOR_VIOLATION_SYSTEM_CALL, offset,
+                ZYDIS_MNEMONIC_SYSCALL, 2);
+        ZYAN_MEMCPY(stream->code + offset, original, length);
+        if (!passed)
+        {
+            ZYAN_PRINTF("FAILED: chunks: syscall at 0x%04" PRIX32 " (split %zu)\n", offset, i);
+            return ZYAN_FALSE;
+        }
+    }
+
+    ZYAN_PRINTF("PASSED: chunks\n");
+    return ZYAN_TRUE;
+}
+
+/**
+ * Checks chunks that start in the middle of a bundle or end in the middle of an instruction.
+ */
+static ZyanBool TestChunkEdges(Stream* stream, ZyanUSize* splits)
+{
+    ZydisValidatorPolicy policy;
+    if (ZYAN_FAILED(InitPolicy(&policy)))
+    {
+        ZYAN_PRINTF("FAILED: chunk edges: initialization\n");
+        return ZYAN_FALSE;
+    }
+
+    ZyanBool passed = ZYAN_TRUE;
+    for (ZyanUSize i = 1; (i < stream->count) && passed; ++i)
+    {
+        const ZyanU32 offset = stream->offsets[i];
+        const ZyanU8 length = (ZyanU8)(stream->offsets[i + 1] - offset);
+        ZydisValidator validator;
+        ZydisValidatorViolation violation;
+
+        // A chunk that ends inside of an instruction is truncated
+        if (length > 1)
+        {
+            splits[0] = 0;
+            splits[1] = offset + length - 1;
+            splits[2] = STREAM_SIZE;
+            passed = ZYAN_SUCCESS(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+                    ZYDIS_STACK_WIDTH_64, &policy)) &&
+                (ValidateChunks(&validator, stream->code, splits, 2, &violation) == 0) &&
+                CheckViolation("chunk edges", &violation,
+                    ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION, offset,
+                    ZYDIS_MNEMONIC_INVALID, 0);
+        }
+
+        // The bundle offset of a chunk that starts inside of a bundle depends on the previous
+        // chunks. Shifting an instruction that ends on a bundle boundary by one byte makes it
+        // cross the boundary, unless it is a single byte that moves into the next bundle.
+        if (passed && (offset % BUNDLE_SIZE) && ((offset + length) % BUNDLE_SIZE == 0))
+        {
+            ZyanU8 shifted[BUNDLE_SIZE + 1];
+            shifted[0] = 0x90;
+            ZYAN_MEMCPY(shifted + 1, stream->code + offset, length);
+            passed = ZYAN_SUCCESS(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+                    ZYDIS_STACK_WIDTH_64, &policy)) &&
+                (ZydisValidatorValidate(&validator, stream->code, offset, &violation) ==
+                    ZYAN_STATUS_TRUE) &&
+                (ZydisValidatorValidate(&validator, shifted, 1 + length, &violation) ==
+                    (((offset + 1) % BUNDLE_SIZE + length > BUNDLE_SIZE) ?
+                        ZYAN_STATUS_FALSE : ZYAN_STATUS_TRUE));
+            if (passed && (length > 1))
+            {
+                passed = CheckViolation("chunk edges", &violation,
+                    ZYDIS_VALIDATOR_VIOLATION_BUNDLE_CROSSING, offset + 1, violation.mnemonic,
+                    length);
+            }
+        }
+
+        if (!passed)
+        {
+            ZYAN_PRINTF("FAILED: chunk edges: instruction at 0x%04" PRIX32 "\n", offset);
+        }
+    }
+
+    if (passed)
+    {
+        ZYAN_PRINTF("PASSED: chunk edges\n");
+    }
+    return passed;
+}
+
+/**
+ * Compares the violations of the validator with those of a plain decoder loop on streams of
+ * repeated instruction forms, so that most instructions are measured from the instruction
+ * cache. Validation continues behind every violation.
+ */
+static ZyanBool TestCache(ZyanU8* code)
+{
+    static const struct
+    {
+        ZydisMachineMode machine_mode;
+        ZydisStackWidth stack_width;
+    } MODES[] =
+    {
+        { ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64 },
+        { ZYDIS_MACHINE_MODE_LEGACY_32, ZYDIS_STACK_WIDTH_32 }
+    };
+
+    ZyanU64 state = 0xBB67AE8584CAA73BULL;
+    for (ZyanUSize i = 0; i < ZYAN_ARRAY_LENGTH(MODES); ++i)
+    {
+        for (ZyanUSize round = 0; round < CACHE_ROUNDS; ++round)
+        {
+            ZydisDecoder decoder;
+            ZydisValidatorPolicy policy;
+            ZydisValidator validator;
+            if (ZYAN_FAILED(ZydisDecoderInit(&decoder, MODES[i].machine_mode,
+                    MODES[i].stack_width)) ||
+                ZYAN_FAILED(InitPolicy(&policy)))
+            {
+                ZYAN_PRINTF("FAILED: cache: initialization\n");
+                return ZYAN_FALSE;
+            }
+            for (ZyanUSize j = 0; j <= ZYDIS_MNEMONIC_MAX_VALUE; ++j)
+            {
+                if (!(NextRandom(&state) % 8))
+                {
+                    ZydisValidatorPolicyAllowMnemonic(&policy, (ZydisMnemonic)j, ZYAN_FALSE);
+                }
+            }
+            policy.allow_privileged = ZYAN_TRUE;
+            policy.allow_system_calls = ZYAN_TRUE;
+            policy.allow_breakpoints = ZYAN_TRUE;
+            policy.bundle_size = (round % 2) ? BUNDLE_SIZE : 0;
+            if (ZYAN_FAILED(ZydisValidatorInit(&validator, MODES[i].machine_mode,
+                MODES[i].stack_width, &policy)))
+            {
+                ZYAN_PRINTF("FAILED: cache: initialization\n");
+                return ZYAN_FALSE;
+            }
+            GenerateCacheStream(&decoder, code, &state);
+
+            ZyanUSize offset = 0;
+            ZyanU64 stream_offset = 0;
+            while (offset < STREAM_SIZE)
+            {
+                ZydisValidatorViolation violation;
+                const ZyanStatus status = ZydisValidatorValidate(&validator, code + offset,
+                    STREAM_SIZE - offset, &violation);
+
+                ZydisDecodedInstruction instruction;
+                ZydisValidatorViolationType type = ZYDIS_VALIDATOR_VIOLATION_NONE;
+                while (offset < STREAM_SIZE)
+                {
+                    type = CheckCacheInstruction(&decoder, &policy, code + offset,
+                        STREAM_SIZE - offset, stream_offset, &instruction);
+                    if (type != ZYDIS_VALIDATOR_VIOLATION_NONE)
+                    {
+                        break;
+                    }
+                    offset += instruction.length;
+                    stream_offset += instruction.length;
+                }
+
+                const ZyanBool is_invalid =
+                    (type == ZYDIS_VALIDATOR_VIOLATION_INVALID_INSTRUCTION);
+                if ((status != ((type != ZYDIS_VALIDATOR_VIOLATION_NONE) ?
+                        ZYAN_STATUS_FALSE : ZYAN_STATUS_TRUE)) ||
+                    ((type != ZYDIS_VALIDATOR_VIOLATION_NONE) &&
+                     !CheckViolation("cache", &violation, type, stream_offset,
+                        is_invalid ? ZYDIS_MNEMONIC_INVALID : instruction.mnemonic,
+                        is_invalid ? 0 : instruction.length)))
+                {
+                    ZYAN_PRINTF("FAILED: cache: mode %d, round %zu, offset 0x%04zX\n",
+                        MODES[i].machine_mode, round, offset);
+                    return ZYAN_FALSE;
+                }
+
+                // Continue behind the violation, the validator resumes at its stream offset
+                offset += is_invalid ? 1 : instruction.length;
+            }
+        }
+    }
+
+    ZYAN_PRINTF("PASSED: cache\n");
+    return ZYAN_TRUE;
+}
+
+static ZyanBool TestArguments(void)
+{
+    ZydisValidatorPolicy policy;
+    ZydisValidator validator;
+    ZydisValidatorViolation violation;
+    ZyanBool passed =
+        (ZydisValidatorPolicyInit(ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisValidatorPolicyInit(&policy)) &&
+        (policy.bundle_size == ZYDIS_VALIDATOR_DEFAULT_BUNDLE_SIZE) &&
+        (ZydisValidatorPolicyAllowMnemonic(&policy,
+            (ZydisMnemonic)(ZYDIS_MNEMONIC_MAX_VALUE + 1), ZYAN_TRUE) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisValidatorPolicyAllowISASet(&policy,
+            (ZydisISASet)(ZYDIS_ISA_SET_MAX_VALUE + 1), ZYAN_TRUE) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisValidatorPolicySetBundleSize(&policy, 24) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisValidatorPolicySetBundleSize(&policy, 0)) &&
+        (ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64,
+            ZYAN_NULL) == ZYAN_STATUS_INVALID_ARGUMENT) &&
+        ZYAN_SUCCESS(ZydisValidatorInit(&validator, ZYDIS_MACHINE_MODE_LONG_64,
+            ZYDIS_STACK_WIDTH_64, &policy)) &&
+        (ZydisValidatorValidate(&validator, ZYAN_NULL, 1, &violation) ==
+            ZYAN_STATUS_INVALID_ARGUMENT) &&
+        (ZydisValidatorValidate(&validator, ZYAN_NULL, 0, ZYAN_NULL) ==
+            ZYAN_STATUS_INVALID_ARGUMENT);
+
+    // An empty chunk is valid, but a `nop` is rejected by the default policy
+    static const ZyanU8 NOP = 0x90;
+    passed &= (ZydisValidatorValidate(&validator, ZYAN_NULL, 0, &violation) ==
+        ZYAN_STATUS_TRUE) && (violation.type == ZYDIS_VALIDATOR_VIOLATION_NONE);
+    passed &= (ZydisValidatorValidate(&validator, &NOP, 1, &violation) == ZYAN_STATUS_FALSE) &&
+        (violation.type == ZYDIS_VALIDATOR_VIOLATION_MNEMONIC);
+
+    ZYAN_PRINTF("%s: invalid arguments\n", passed ? "PASSED" : "FAILED");
+    return passed;
+}
+
+/* ============================================================================================== */
+/* Entry point                                                                                    */
+/* ============================================================================================== */
+
+int main(void)
+{
+    int result = 1;
+    Stream* const stream = (Stream*)malloc(sizeof(Stream));
+    ZyanUSize* const splits = (ZyanUSize*)malloc((STREAM_SIZE + 2) * sizeof(ZyanUSize));
+    if (!stream || !splits)
+    {
+        ZYAN_PRINTF("Failed to allocate memory\n");
+        goto cleanup;
+    }
+
+    ZyanBool all_passed = ZYAN_TRUE;
+    all_passed &= TestViolations();
+    all_passed &= TestBundleEdges();
+    all_passed &= TestChunks(stream, splits);
+    all_passed &= TestChunkEdges(stream, splits);
+    all_passed &= TestCache(stream->code);
+    all_passed &= TestArguments();
+    ZYAN_PRINTF("\n");
+    if (!all_passed)
+    {
+        ZYAN_PRINTF("SOME TESTS FAILED\n");
+        goto cleanup;
+    }
+
+    ZYAN_PRINTF("ALL TESTS PASSED\n");
+    result = 0;
+
+cleanup:
+    free(splits);
+    free(stream);
+    return result;
+}
+
+/* ============================================================================================== */
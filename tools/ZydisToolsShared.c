@@ -33,6 +33,42 @@
 #include "ZydisToolsShared.h"
 
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef ZYAN_WINDOWS
+#   include <Windows.h>
+#else
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+
+/* ============================================================================================== */
+/* Enums and types                                                                                */
+/* ============================================================================================== */
+
+/**
+ * Defines the `WorkerArgs` struct.
+ */
+typedef struct WorkerArgs_
+{
+    /**
+     * The worker function.
+     */
+    WorkerFunc worker;
+    /**
+     * The context passed to the worker function.
+     */
+    void* context;
+    /**
+     * The index of the worker.
+     */
+    size_t index;
+    /**
+     * The total number of workers.
+     */
+    size_t count;
+} WorkerArgs;
 
 /* ============================================================================================== */
 /* Colors                                                                                         */
@@ -216,6 +252,273 @@ void PrintTokenizedInstruction(const ZydisFormatterToken* token)
     ZYAN_PRINTF("%s\n", CVT100_OUT(COLOR_DEFAULT));
 }
 
+/* ---------------------------------------------------------------------------------------------- */
+/* Vector                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+void VectorInit(Vector* vector, size_t element_size)
+{
+    ZYAN_MEMSET(vector, 0, sizeof(*vector));
+    vector->element_size = element_size;
+}
+
+ZyanBool VectorPush(Vector* vector, const void* element)
+{
+    if (vector->count == vector->capacity)
+    {
+        const size_t capacity = vector->capacity ? vector->capacity * 2 : 64;
+        ZyanU8* data = realloc(vector->data, capacity * vector->element_size);
+        if (!data)
+        {
+            return ZYAN_FALSE;
+        }
+        vector->data = data;
+        vector->capacity = capacity;
+    }
+    ZYAN_MEMCPY(vector->data + vector->count++ * vector->element_size, element,
+        vector->element_size);
+    return ZYAN_TRUE;
+}
+
+void VectorDestroy(Vector* vector)
+{
+    free(vector->data);
+    VectorInit(vector, vector->element_size);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+ZyanU8* ReadFile(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return ZYAN_NULL;
+    }
+
+    ZyanU8* data = ZYAN_NULL;
+    long length;
+    if (!fseek(file, 0, SEEK_END) && ((length = ftell(file)) >= 0) && !fseek(file, 0, SEEK_SET))
+    {
+        data = malloc(length ? (size_t)length : 1);
+        if (data && (fread(data, 1, (size_t)length, file) != (size_t)length))
+        {
+            free(data);
+            data = ZYAN_NULL;
+        }
+        *size = (size_t)length;
+    }
+
+    fclose(file);
+    return data;
+}
+
+ZyanU64 ReadLE(const ZyanU8* data, size_t size)
+{
+    ZyanU64 value = 0;
+    for (size_t i = size; i > 0; --i)
+    {
+        value = (value << 8) | data[i - 1];
+    }
+    return value;
+}
+
+ZyanBool ReadSectionTable(const ZyanU8* data, size_t size, ZyanBool is_64,
+    ElfSectionTable* table)
+{
+    const ZyanU64 offset = is_64 ? ReadLE(data + 0x28, 8) : ReadLE(data + 0x20, 4);
+    table->is_64 = is_64;
+    table->entry_size = ReadLE(data + (is_64 ? 0x3A : 0x2E), 2);
+    table->count = ReadLE(data + (is_64 ? 0x3C : 0x30), 2);
+    if ((table->entry_size < (is_64 ? 0x40u : 0x28u)) || (offset > size) ||
+        (table->count * table->entry_size > size - offset))
+    {
+        return ZYAN_FALSE;
+    }
+    table->data = data + offset;
+    return ZYAN_TRUE;
+}
+
+void ReadSection(const ElfSectionTable* table, ZyanU64 index, ElfSection* section)
+{
+    const ZyanU8* data = table->data + index * table->entry_size;
+    const ZyanBool is_64 = table->is_64;
+    section->type       = (ZyanU32)ReadLE(data + 0x04, 4);
+    section->flags      = is_64 ? ReadLE(data + 0x08, 8) : ReadLE(data + 0x08, 4);
+    section->address    = is_64 ? ReadLE(data + 0x10, 8) : ReadLE(data + 0x0C, 4);
+    section->offset     = is_64 ? ReadLE(data + 0x18, 8) : ReadLE(data + 0x10, 4);
+    section->size       = is_64 ? ReadLE(data + 0x20, 8) : ReadLE(data + 0x14, 4);
+    section->link       = (ZyanU32)(is_64 ? ReadLE(data + 0x28, 4) : ReadLE(data + 0x18, 4));
+    section->entry_size = is_64 ? ReadLE(data + 0x38, 8) : ReadLE(data + 0x24, 4);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+#ifdef ZYAN_WINDOWS
+static DWORD WINAPI WorkerThread(LPVOID args)
+{
+    const WorkerArgs* worker_args = (const WorkerArgs*)args;
+    worker_args->worker(worker_args->context, worker_args->index, worker_args->count);
+    return 0;
+}
+#else
+static void* WorkerThread(void* args)
+{
+    const WorkerArgs* worker_args = (const WorkerArgs*)args;
+    worker_args->worker(worker_args->context, worker_args->index, worker_args->count);
+    return ZYAN_NULL;
+}
+#endif
+
+size_t GetProcessorCount(void)
+{
+#ifdef ZYAN_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (size_t)count : 1;
+#endif
+}
+
+ZyanBool RunWorkers(size_t thread_count, WorkerFunc worker, void* context)
+{
+    ZYAN_ASSERT(thread_count);
+    ZYAN_ASSERT(worker);
+
+    WorkerArgs* args = calloc(thread_count, sizeof(WorkerArgs));
+#ifdef ZYAN_WINDOWS
+    HANDLE* threads = calloc(thread_count, sizeof(HANDLE));
+#else
+    pthread_t* threads = calloc(thread_count, sizeof(pthread_t));
+#endif
+
+    // The main thread acts as the first worker
+    size_t started = 1;
+    if (args && threads)
+    {
+        for (; started < thread_count; ++started)
+        {
+            args[started].worker = worker;
+            args[started].context = context;
+            args[started].index = started;
+            args[started].count = thread_count;
+#ifdef ZYAN_WINDOWS
+            threads[started] =
+                CreateThread(ZYAN_NULL, 0, &WorkerThread, &args[started], 0, ZYAN_NULL);
+            if (!threads[started])
+#else
+            if (pthread_create(&threads[started], ZYAN_NULL, &WorkerThread, &args[started]))
+#endif
+            {
+                break;
+            }
+        }
+    }
+    worker(context, 0, thread_count);
+    // Let the main thread pick up the work of the threads that could not be started
+    for (size_t i = started; i < thread_count; ++i)
+    {
+        worker(context, i, thread_count);
+    }
+
+    for (size_t i = 1; i < started; ++i)
+    {
+#ifdef ZYAN_WINDOWS
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], ZYAN_NULL);
+#endif
+    }
+
+    free(args);
+    free(threads);
+    return (started == thread_count);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Test tables                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * The maximum number of results collected for a single test case.
+ */
+#define TEST_TABLE_MAX_RESULTS 16
+
+void ResultListInit(ResultList* list, size_t result_size, size_t limit)
+{
+    VectorInit(&list->results, result_size);
+    list->limit = limit;
+}
+
+ZyanStatus ResultListPush(ResultList* list, const void* result)
+{
+    if (list->results.count == list->limit)
+    {
+        return ZYAN_STATUS_FAILED;
+    }
+    return VectorPush(&list->results, result) ?
+        ZYAN_STATUS_SUCCESS : ZYAN_STATUS_NOT_ENOUGH_MEMORY;
+}
+
+void ResultListDestroy(ResultList* list)
+{
+    VectorDestroy(&list->results);
+}
+
+static ZyanBool RunTestCase(const TestTable* table, const void* test)
+{
+    const char* name;
+    size_t expected_count;
+    table->info(test, &name, &expected_count);
+
+    ResultList list;
+    ResultListInit(&list, table->result_size, TEST_TABLE_MAX_RESULTS);
+    const ZyanStatus status = table->run(table->context, test, &list);
+
+    ZyanBool passed = ZYAN_FALSE;
+    if (!ZYAN_SUCCESS(status))
+    {
+        ZYAN_PRINTF("FAILED: %s: analysis failed with %s\n", name, FormatZyanStatus(status));
+    } else if (list.results.count != expected_count)
+    {
+        ZYAN_PRINTF("FAILED: %s: expected %u result(s), got %u\n", name,
+            (unsigned)expected_count, (unsigned)list.results.count);
+        for (size_t i = 0; i < list.results.count; ++i)
+        {
+            table->print(list.results.data + i * table->result_size);
+        }
+    } else
+    {
+        passed = ZYAN_TRUE;
+        for (size_t i = 0; passed && (i < list.results.count); ++i)
+        {
+            passed = table->compare(test, list.results.data + i * table->result_size, i);
+        }
+    }
+
+    ResultListDestroy(&list);
+    return passed;
+}
+
+ZyanBool RunTestTable(const TestTable* table)
+{
+    ZyanBool passed = ZYAN_TRUE;
+    for (size_t i = 0; i < table->case_count; ++i)
+    {
+        passed &= RunTestCase(table, (const ZyanU8*)table->cases + i * table->case_size);
+    }
+    ZYAN_PRINTF("%s: %u %s\n", passed ? "PASSED" : "FAILED", (unsigned)table->case_count,
+        table->description);
+    return passed;
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* ============================================================================================== */
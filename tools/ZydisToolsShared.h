@@ -127,6 +127,315 @@ void PrintStatusError(ZyanStatus status, const char* message);
  */
 void PrintTokenizedInstruction(const ZydisFormatterToken* token);
 
+/* ---------------------------------------------------------------------------------------------- */
+/* Vector                                                                                         */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `Vector` struct.
+ */
+typedef struct Vector_
+{
+    /**
+     * The element data.
+     */
+    ZyanU8* data;
+    /**
+     * The number of elements.
+     */
+    size_t count;
+    /**
+     * The number of allocated elements.
+     */
+    size_t capacity;
+    /**
+     * The size of a single element.
+     */
+    size_t element_size;
+} Vector;
+
+#define VECTOR_AT(vector, type, index) (((type*)(vector)->data)[index])
+
+/**
+ * Initializes the given vector.
+ *
+ * @param   vector          A pointer to the `Vector` struct.
+ * @param   element_size    The size of a single element.
+ */
+void VectorInit(Vector* vector, size_t element_size);
+
+/**
+ * Appends an element to the given vector.
+ *
+ * @param   vector  A pointer to the `Vector` struct.
+ * @param   element A pointer to the element.
+ *
+ * @return  `ZYAN_TRUE`, if the element was added or `ZYAN_FALSE`, if out of memory.
+ */
+ZyanBool VectorPush(Vector* vector, const void* element);
+
+/**
+ * Frees the given vector.
+ *
+ * @param   vector  A pointer to the `Vector` struct.
+ */
+void VectorDestroy(Vector* vector);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Input                                                                                          */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Describes a section header of an ELF file.
+ */
+typedef struct ElfSection_
+{
+    ZyanU32 type;
+    ZyanU64 flags;
+    ZyanU64 address;
+    ZyanU64 offset;
+    ZyanU64 size;
+    ZyanU32 link;
+    ZyanU64 entry_size;
+} ElfSection;
+
+/**
+ * Describes the section header table of an ELF file.
+ */
+typedef struct ElfSectionTable_
+{
+    const ZyanU8* data;
+    ZyanBool is_64;
+    ZyanU64 entry_size;
+    ZyanU64 count;
+} ElfSectionTable;
+
+/**
+ * Reads the whole file into memory.
+ *
+ * @param   path    The path of the file.
+ * @param   size    Receives the file size.
+ *
+ * @return  A pointer to the file data or `ZYAN_NULL`, if the file could not be read. The data
+ *          has to be released using `free`.
+ */
+ZyanU8* ReadFile(const char* path, size_t* size);
+
+/**
+ * Reads a little-endian value from the given buffer.
+ *
+ * @param   data    A pointer to the data.
+ * @param   size    The size of the value in bytes.
+ *
+ * @return  The value.
+ */
+ZyanU64 ReadLE(const ZyanU8* data, size_t size);
+
+/**
+ * Locates the section header table of the given ELF file.
+ *
+ * @param   data    A pointer to the file data. The caller has to validate the ELF identification
+ *                  and the size of the file header.
+ * @param   size    The file size.
+ * @param   is_64   Signals, if the file is an ELF64 file.
+ * @param   table   Receives the section header table.
+ *
+ * @return  `ZYAN_TRUE`, if successful or `ZYAN_FALSE`, if the table is malformed.
+ */
+ZyanBool ReadSectionTable(const ZyanU8* data, size_t size, ZyanBool is_64,
+    ElfSectionTable* table);
+
+/**
+ * Reads the header of the given ELF section.
+ *
+ * @param   table   A pointer to the section header table.
+ * @param   index   The index of the section. Has to be less than the section count.
+ * @param   section Receives the section information.
+ */
+void ReadSection(const ElfSectionTable* table, ZyanU64 index, ElfSection* section);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Threading                                                                                      */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `WorkerFunc` function prototype.
+ *
+ * @param   context The context passed to `RunWorkers`.
+ * @param   index   The index of the worker.
+ * @param   count   The total number of workers.
+ *
+ * Workers usually process every `count`-th work item, starting at `index`.
+ */
+typedef void (*WorkerFunc)(void* context, size_t index, size_t count);
+
+/**
+ * Returns the number of online processors.
+ *
+ * @return  The number of online processors.
+ */
+size_t GetProcessorCount(void);
+
+/**
+ * Runs `thread_count` workers in parallel and waits for all of them to finish.
+ *
+ * @param   thread_count    The number of workers. Must not be zero.
+ * @param   worker          The worker function.
+ * @param   context         The context passed to the worker function.
+ *
+ * @return  `ZYAN_TRUE`, if all threads were started or `ZYAN_FALSE`, if not.
+ *
+ * The main thread acts as the first worker. Workers that could not be started on their own
+ * thread are run by the main thread afterwards, so every index is processed exactly once.
+ */
+ZyanBool RunWorkers(size_t thread_count, WorkerFunc worker, void* context);
+
+/* ---------------------------------------------------------------------------------------------- */
+/* Test tables                                                                                    */
+/* ---------------------------------------------------------------------------------------------- */
+
+/**
+ * Defines the `ResultList` struct.
+ *
+ * Collects the results reported to an analysis callback.
+ */
+typedef struct ResultList_
+{
+    /**
+     * The collected results.
+     */
+    Vector results;
+    /**
+     * The maximum number of results. Any further result fails with `ZYAN_STATUS_FAILED`.
+     */
+    size_t limit;
+} ResultList;
+
+/**
+ * Defines the `TestInfoFunc` function prototype.
+ *
+ * @param   test            A pointer to the test case.
+ * @param   name            Receives the name of the test case.
+ * @param   expected_count  Receives the number of expected results.
+ */
+typedef void (*TestInfoFunc)(const void* test, const char** name, size_t* expected_count);
+
+/**
+ * Defines the `TestRunFunc` function prototype.
+ *
+ * @param   context The context of the `TestTable`.
+ * @param   test    A pointer to the test case.
+ * @param   list    A pointer to the `ResultList` that receives the results.
+ *
+ * @return  The status code of the analysis.
+ */
+typedef ZyanStatus (*TestRunFunc)(void* context, const void* test, ResultList* list);
+
+/**
+ * Defines the `TestCompareFunc` function prototype.
+ *
+ * @param   test    A pointer to the test case.
+ * @param   result  A pointer to the reported result.
+ * @param   index   The index of the expected result in the test case.
+ *
+ * @return  `ZYAN_TRUE`, if the result matches or `ZYAN_FALSE`, if not. A mismatch is printed by
+ *          the callback.
+ */
+typedef ZyanBool (*TestCompareFunc)(const void* test, const void* result, size_t index);
+
+/**
+ * Defines the `TestPrintFunc` function prototype.
+ *
+ * @param   result  A pointer to the reported result.
+ */
+typedef void (*TestPrintFunc)(const void* result);
+
+/**
+ * Defines the `TestTable` struct.
+ *
+ * Describes a table of hand-written test cases, each listing the exact results an analysis has
+ * to report.
+ */
+typedef struct TestTable_
+{
+    /**
+     * The description printed with the overall result (e.g. "hand-assembled cases").
+     */
+    const char* description;
+    /**
+     * The test cases.
+     */
+    const void* cases;
+    /**
+     * The size of a single test case.
+     */
+    size_t case_size;
+    /**
+     * The number of test cases.
+     */
+    size_t case_count;
+    /**
+     * The size of a single result.
+     */
+    size_t result_size;
+    /**
+     * The context passed to `run`.
+     */
+    void* context;
+    /**
+     * Returns the name and the number of expected results of a test case.
+     */
+    TestInfoFunc info;
+    /**
+     * Runs the analysis for a test case.
+     */
+    TestRunFunc run;
+    /**
+     * Compares a result with the expected one.
+     */
+    TestCompareFunc compare;
+    /**
+     * Prints a result, if the number of results does not match.
+     */
+    TestPrintFunc print;
+} TestTable;
+
+/**
+ * Initializes the given result list.
+ *
+ * @param   list        A pointer to the `ResultList` struct.
+ * @param   result_size The size of a single result.
+ * @param   limit       The maximum number of results.
+ */
+void ResultListInit(ResultList* list, size_t result_size, size_t limit);
+
+/**
+ * Appends a result to the given list.
+ *
+ * @param   list    A pointer to the `ResultList` struct.
+ * @param   result  A pointer to the result.
+ *
+ * @return  `ZYAN_STATUS_SUCCESS`, if the result was added, `ZYAN_STATUS_FAILED`, if the limit is
+ *          reached or `ZYAN_STATUS_NOT_ENOUGH_MEMORY`, if out of memory.
+ */
+ZyanStatus ResultListPush(ResultList* list, const void* result);
+
+/**
+ * Frees the given result list.
+ *
+ * @param   list    A pointer to the `ResultList` struct.
+ */
+void ResultListDestroy(ResultList* list);
+
+/**
+ * Runs every case of the given test table and prints the overall result.
+ *
+ * @param   table   A pointer to the `TestTable` struct.
+ *
+ * @return  `ZYAN_TRUE`, if all cases passed or `ZYAN_FALSE`, if not.
+ */
+ZyanBool RunTestTable(const TestTable* table);
+
 /* ---------------------------------------------------------------------------------------------- */
 
 /* ============================================================================================== */